@@ -0,0 +1,287 @@
+/// @file AveragedDataAccessor.cc
+/// @brief accessor holding data averaged by BaselineAveragingIterator
+/// @details All fields of this accessor are held in memory and filled by
+/// the averaging iterator. Rotated uvw coordinates and delays are computed
+/// from the averaged uvw the same way as for the table-based accessors.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// own includes
+#include <dataaccess/AveragedDataAccessor.h>
+#include <dataaccess/DataAccessError.h>
+#include <askap/AskapError.h>
+
+using namespace askap;
+using namespace askap::accessors;
+
+/// @brief construct an empty accessor
+/// @param[in] cacheSize a number of uvw machines in the cache
+/// @param[in] tolerance pointing direction tolerance in radians for uvw machine cache
+AveragedDataAccessor::AveragedDataAccessor(size_t cacheSize, double tolerance) :
+      itsTime(0.), itsRotatedUVW(cacheSize, tolerance) {}
+
+/// @brief resize all fields
+/// @param[in] nRow number of rows
+/// @param[in] nChannel number of spectral channels
+/// @param[in] nPol number of polarisation products
+void AveragedDataAccessor::resize(casa::uInt nRow, casa::uInt nChannel, casa::uInt nPol)
+{
+  itsVisibility.resize(nRow, nChannel, nPol);
+  itsFlag.resize(nRow, nChannel, nPol);
+  itsNoise.resize(nRow, nChannel, nPol);
+  itsUVW.resize(nRow);
+  itsAntenna1.resize(nRow);
+  itsAntenna2.resize(nRow);
+  itsFeed1.resize(nRow);
+  itsFeed2.resize(nRow);
+  itsFeed1PA.resize(nRow);
+  itsFeed2PA.resize(nRow);
+  itsPointingDir1.resize(nRow);
+  itsPointingDir2.resize(nRow);
+  itsDishPointing1.resize(nRow);
+  itsDishPointing2.resize(nRow);
+  itsFrequency.resize(nChannel);
+  itsStokes.resize(nPol);
+  itsRotatedUVW.invalidate();
+}
+
+/// @brief make a detached copy of another accessor
+/// @details All fields are copied (the storage is not shared), rotated uvws are
+/// recomputed on demand. Velocities are not copied.
+/// @param[in] acc accessor to copy
+void AveragedDataAccessor::assign(const IConstDataAccessor &acc)
+{
+  resize(acc.nRow(), acc.nChannel(), acc.nPol());
+  itsVisibility = acc.visibility();
+  itsFlag = acc.flag();
+  itsNoise = acc.noise();
+  itsUVW = acc.uvw();
+  itsAntenna1 = acc.antenna1();
+  itsAntenna2 = acc.antenna2();
+  itsFeed1 = acc.feed1();
+  itsFeed2 = acc.feed2();
+  itsFeed1PA = acc.feed1PA();
+  itsFeed2PA = acc.feed2PA();
+  itsPointingDir1 = acc.pointingDir1();
+  itsPointingDir2 = acc.pointingDir2();
+  itsDishPointing1 = acc.dishPointing1();
+  itsDishPointing2 = acc.dishPointing2();
+  itsFrequency = acc.frequency();
+  itsStokes = acc.stokes();
+  itsTime = acc.time();
+}
+
+/// The number of rows in this chunk
+/// @return the number of rows in this chunk
+casa::uInt AveragedDataAccessor::nRow() const throw()
+{
+  return itsVisibility.nrow();
+}
+
+/// The number of spectral channels (equal for all rows)
+/// @return the number of spectral channels
+casa::uInt AveragedDataAccessor::nChannel() const throw()
+{
+  return itsVisibility.ncolumn();
+}
+
+/// The number of polarization products (equal for all rows)
+/// @return the number of polarization products (can be 1,2 or 4)
+casa::uInt AveragedDataAccessor::nPol() const throw()
+{
+  return itsVisibility.nplane();
+}
+
+/// First antenna IDs for all rows
+/// @return a vector with IDs of the first antenna corresponding
+/// to each visibility (one for each row)
+const casa::Vector<casa::uInt>& AveragedDataAccessor::antenna1() const
+{
+  return itsAntenna1;
+}
+
+/// Second antenna IDs for all rows
+/// @return a vector with IDs of the second antenna corresponding
+/// to each visibility (one for each row)
+const casa::Vector<casa::uInt>& AveragedDataAccessor::antenna2() const
+{
+  return itsAntenna2;
+}
+
+/// First feed IDs for all rows
+/// @return a vector with IDs of the first feed corresponding
+/// to each visibility (one for each row)
+const casa::Vector<casa::uInt>& AveragedDataAccessor::feed1() const
+{
+  return itsFeed1;
+}
+
+/// Second feed IDs for all rows
+/// @return a vector with IDs of the second feed corresponding
+/// to each visibility (one for each row)
+const casa::Vector<casa::uInt>& AveragedDataAccessor::feed2() const
+{
+  return itsFeed2;
+}
+
+/// Position angles of the first feed for all rows
+/// @return a vector with position angles (in radians) of the
+/// first feed corresponding to each visibility
+const casa::Vector<casa::Float>& AveragedDataAccessor::feed1PA() const
+{
+  return itsFeed1PA;
+}
+
+/// Position angles of the second feed for all rows
+/// @return a vector with position angles (in radians) of the
+/// second feed corresponding to each visibility
+const casa::Vector<casa::Float>& AveragedDataAccessor::feed2PA() const
+{
+  return itsFeed2PA;
+}
+
+/// Return pointing centre directions of the first antenna/feed
+/// @return a vector with direction measures, one direction for each
+/// visibility/row
+const casa::Vector<casa::MVDirection>& AveragedDataAccessor::pointingDir1() const
+{
+  return itsPointingDir1;
+}
+
+/// Pointing centre directions of the second antenna/feed
+/// @return a vector with direction measures, one direction for each
+/// visibility/row
+const casa::Vector<casa::MVDirection>& AveragedDataAccessor::pointingDir2() const
+{
+  return itsPointingDir2;
+}
+
+/// pointing direction for the centre of the first antenna
+/// @return a vector with direction measures, one direction for each
+/// visibility/row
+const casa::Vector<casa::MVDirection>& AveragedDataAccessor::dishPointing1() const
+{
+  return itsDishPointing1;
+}
+
+/// pointing direction for the centre of the second antenna
+/// @return a vector with direction measures, one direction for each
+/// visibility/row
+const casa::Vector<casa::MVDirection>& AveragedDataAccessor::dishPointing2() const
+{
+  return itsDishPointing2;
+}
+
+/// Visibilities (a cube is nRow x nChannel x nPol; each element is
+/// a complex visibility)
+/// @return a reference to nRow x nChannel x nPol cube, containing
+/// all visibility data
+const casa::Cube<casa::Complex>& AveragedDataAccessor::visibility() const
+{
+  return itsVisibility;
+}
+
+/// Read-write access to visibilities (a cube is nRow x nChannel x nPol;
+/// each element is a complex visibility)
+/// @return a reference to nRow x nChannel x nPol cube, containing
+/// all visibility data
+casa::Cube<casa::Complex>& AveragedDataAccessor::rwVisibility()
+{
+  return itsVisibility;
+}
+
+/// Cube of flags corresponding to the output of visibility()
+/// @return a reference to nRow x nChannel x nPol cube with flag
+///         information. If True, the corresponding element is flagged.
+const casa::Cube<casa::Bool>& AveragedDataAccessor::flag() const
+{
+  return itsFlag;
+}
+
+/// UVW
+/// @return a reference to vector containing uvw-coordinates
+/// packed into a 3-D rigid vector
+const casa::Vector<casa::RigidVector<casa::Double, 3> >& AveragedDataAccessor::uvw() const
+{
+  return itsUVW;
+}
+
+/// @brief uvw after rotation
+/// @param[in] tangentPoint tangent point to rotate the coordinates to
+/// @return uvw after rotation to the new coordinate system for each row
+const casa::Vector<casa::RigidVector<casa::Double, 3> >&
+         AveragedDataAccessor::rotatedUVW(const casa::MDirection &tangentPoint) const
+{
+  return itsRotatedUVW.uvw(*this, tangentPoint);
+}
+
+/// @brief delay associated with uvw rotation
+/// @param[in] tangentPoint tangent point to rotate the coordinates to
+/// @param[in] imageCentre image centre (additional translation is done if imageCentre!=tangentPoint)
+/// @return delays corresponding to the uvw rotation for each row
+const casa::Vector<casa::Double>& AveragedDataAccessor::uvwRotationDelay(
+         const casa::MDirection &tangentPoint, const casa::MDirection &imageCentre) const
+{
+  return itsRotatedUVW.delays(*this, tangentPoint, imageCentre);
+}
+
+/// Noise level required for a proper weighting
+/// @return a reference to nRow x nChannel x nPol cube with
+///         complex noise estimates
+const casa::Cube<casa::Complex>& AveragedDataAccessor::noise() const
+{
+  return itsNoise;
+}
+
+/// Timestamp for each row
+/// @return a timestamp for this buffer (average over all rows)
+casa::Double AveragedDataAccessor::time() const
+{
+  return itsTime;
+}
+
+/// Frequency for each channel
+/// @return a reference to vector containing frequencies for each
+///         spectral channel (vector size is nChannel)
+const casa::Vector<casa::Double>& AveragedDataAccessor::frequency() const
+{
+  return itsFrequency;
+}
+
+/// Velocity for each channel
+/// @details Velocities are not averaged, an exception is thrown
+/// @return a reference to vector containing velocities for each
+///         spectral channel (vector size is nChannel)
+const casa::Vector<casa::Double>& AveragedDataAccessor::velocity() const
+{
+  ASKAPTHROW(DataAccessLogicError, "Velocities are not available for data held by AveragedDataAccessor");
+}
+
+/// @brief polarisation type for each product
+/// @return a reference to vector containing polarisation types for
+/// each product in the visibility cube (nPol() elements).
+const casa::Vector<casa::Stokes::StokesTypes>& AveragedDataAccessor::stokes() const
+{
+  return itsStokes;
+}
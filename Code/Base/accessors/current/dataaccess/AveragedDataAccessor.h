@@ -0,0 +1,314 @@
+/// @file AveragedDataAccessor.h
+/// @brief accessor holding data averaged by BaselineAveragingIterator
+/// @details All fields of this accessor are held in memory and filled by
+/// the averaging iterator. Rotated uvw coordinates and delays are computed
+/// from the averaged uvw the same way as for the table-based accessors.
+/// The accessor can also hold a detached copy of any other chunk of data, which
+/// stays valid after the iterator has moved on.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#ifndef ASKAP_ACCESSORS_AVERAGED_DATA_ACCESSOR_H
+#define ASKAP_ACCESSORS_AVERAGED_DATA_ACCESSOR_H
+
+#include <dataaccess/IDataAccessor.h>
+#include <dataaccess/UVWRotationHandler.h>
+
+namespace askap {
+
+namespace accessors {
+
+/// @brief accessor holding data averaged by BaselineAveragingIterator
+/// @details The iterator resizes the accessor and fills all fields via
+/// the non-virtual rw-methods. The visibilities can be modified via the
+/// IDataAccessor interface (e.g. to predict model visibilities), but the
+/// changes are not propagated to the original data.
+/// @ingroup dataaccess_hlp
+class AveragedDataAccessor : virtual public IDataAccessor
+{
+public:
+  /// @brief construct an empty accessor
+  /// @param[in] cacheSize a number of uvw machines in the cache
+  /// @param[in] tolerance pointing direction tolerance in radians for uvw machine cache
+  explicit AveragedDataAccessor(size_t cacheSize = 1, double tolerance = 1e-6);
+
+  /// @brief resize all fields
+  /// @param[in] nRow number of rows
+  /// @param[in] nChannel number of spectral channels
+  /// @param[in] nPol number of polarisation products
+  void resize(casa::uInt nRow, casa::uInt nChannel, casa::uInt nPol);
+
+  /// @brief make a detached copy of another accessor
+  /// @details All fields are copied (the storage is not shared), rotated uvws are
+  /// recomputed on demand. Velocities are not copied.
+  /// @param[in] acc accessor to copy
+  void assign(const IConstDataAccessor &acc);
+
+  // IConstDataAccessor methods
+
+  /// The number of rows in this chunk
+  /// @return the number of rows in this chunk
+  virtual casa::uInt nRow() const throw();
+
+  /// The number of spectral channels (equal for all rows)
+  /// @return the number of spectral channels
+  virtual casa::uInt nChannel() const throw();
+
+  /// The number of polarization products (equal for all rows)
+  /// @return the number of polarization products (can be 1,2 or 4)
+  virtual casa::uInt nPol() const throw();
+
+  /// First antenna IDs for all rows
+  /// @return a vector with IDs of the first antenna corresponding
+  /// to each visibility (one for each row)
+  virtual const casa::Vector<casa::uInt>& antenna1() const;
+
+  /// Second antenna IDs for all rows
+  /// @return a vector with IDs of the second antenna corresponding
+  /// to each visibility (one for each row)
+  virtual const casa::Vector<casa::uInt>& antenna2() const;
+
+  /// First feed IDs for all rows
+  /// @return a vector with IDs of the first feed corresponding
+  /// to each visibility (one for each row)
+  virtual const casa::Vector<casa::uInt>& feed1() const;
+
+  /// Second feed IDs for all rows
+  /// @return a vector with IDs of the second feed corresponding
+  /// to each visibility (one for each row)
+  virtual const casa::Vector<casa::uInt>& feed2() const;
+
+  /// Position angles of the first feed for all rows
+  /// @return a vector with position angles (in radians) of the
+  /// first feed corresponding to each visibility
+  virtual const casa::Vector<casa::Float>& feed1PA() const;
+
+  /// Position angles of the second feed for all rows
+  /// @return a vector with position angles (in radians) of the
+  /// second feed corresponding to each visibility
+  virtual const casa::Vector<casa::Float>& feed2PA() const;
+
+  /// Return pointing centre directions of the first antenna/feed
+  /// @return a vector with direction measures (coordinate system
+  /// is set via IDataConverter), one direction for each
+  /// visibility/row
+  virtual const casa::Vector<casa::MVDirection>& pointingDir1() const;
+
+  /// Pointing centre directions of the second antenna/feed
+  /// @return a vector with direction measures (coordinate system
+  /// is is set via IDataConverter), one direction for each
+  /// visibility/row
+  virtual const casa::Vector<casa::MVDirection>& pointingDir2() const;
+
+  /// pointing direction for the centre of the first antenna
+  /// @return a vector with direction measures (coordinate system
+  /// is is set via IDataConverter), one direction for each
+  /// visibility/row
+  virtual const casa::Vector<casa::MVDirection>& dishPointing1() const;
+
+  /// pointing direction for the centre of the first antenna
+  /// @return a vector with direction measures (coordinate system
+  /// is is set via IDataConverter), one direction for each
+  /// visibility/row
+  virtual const casa::Vector<casa::MVDirection>& dishPointing2() const;
+
+  /// Visibilities (a cube is nRow x nChannel x nPol; each element is
+  /// a complex visibility)
+  /// @return a reference to nRow x nChannel x nPol cube, containing
+  /// all visibility data
+  virtual const casa::Cube<casa::Complex>& visibility() const;
+
+  /// Read-write access to visibilities (a cube is nRow x nChannel x nPol;
+  /// each element is a complex visibility)
+  /// @return a reference to nRow x nChannel x nPol cube, containing
+  /// all visibility data
+  virtual casa::Cube<casa::Complex>& rwVisibility();
+
+  /// Cube of flags corresponding to the output of visibility()
+  /// @return a reference to nRow x nChannel x nPol cube with flag
+  ///         information. If True, the corresponding element is flagged.
+  virtual const casa::Cube<casa::Bool>& flag() const;
+
+  /// UVW
+  /// @return a reference to vector containing uvw-coordinates
+  /// packed into a 3-D rigid vector
+  virtual const casa::Vector<casa::RigidVector<casa::Double, 3> >& uvw() const;
+
+  /// @brief uvw after rotation
+  /// @details This method calls UVWMachine to rotate baseline coordinates
+  /// for a new tangent point. Delays corresponding to this correction are
+  /// returned by a separate method.
+  /// @param[in] tangentPoint tangent point to rotate the coordinates to
+  /// @return uvw after rotation to the new coordinate system for each row
+  virtual const casa::Vector<casa::RigidVector<casa::Double, 3> >&
+           rotatedUVW(const casa::MDirection &tangentPoint) const;
+
+  /// @brief delay associated with uvw rotation
+  /// @details This is a companion method to rotatedUVW. It returns delays corresponding
+  /// to the baseline coordinate rotation. An additional delay corresponding to the
+  /// translation in the tangent plane can also be applied using the image
+  /// centre parameter. Set it to tangent point to apply no extra translation.
+  /// @param[in] tangentPoint tangent point to rotate the coordinates to
+  /// @param[in] imageCentre image centre (additional translation is done if imageCentre!=tangentPoint)
+  /// @return delays corresponding to the uvw rotation for each row
+  virtual const casa::Vector<casa::Double>& uvwRotationDelay(
+           const casa::MDirection &tangentPoint, const casa::MDirection &imageCentre) const;
+
+  /// Noise level required for a proper weighting
+  /// @return a reference to nRow x nChannel x nPol cube with
+  ///         complex noise estimates
+  virtual const casa::Cube<casa::Complex>& noise() const;
+
+  /// Timestamp for each row
+  /// @return a timestamp for this buffer (average over all rows)
+  virtual casa::Double time() const;
+
+  /// Frequency for each channel
+  /// @return a reference to vector containing frequencies for each
+  ///         spectral channel (vector size is nChannel)
+  virtual const casa::Vector<casa::Double>& frequency() const;
+
+  /// Velocity for each channel
+  /// @details Velocities are not averaged, an exception is thrown
+  /// @return a reference to vector containing velocities for each
+  ///         spectral channel (vector size is nChannel)
+  virtual const casa::Vector<casa::Double>& velocity() const;
+
+  /// @brief polarisation type for each product
+  /// @return a reference to vector containing polarisation types for
+  /// each product in the visibility cube (nPol() elements).
+  virtual const casa::Vector<casa::Stokes::StokesTypes>& stokes() const;
+
+  // methods to fill the accessor
+
+  /// @brief read-write access to the first antenna IDs
+  inline casa::Vector<casa::uInt>& rwAntenna1() { return itsAntenna1; }
+
+  /// @brief read-write access to the second antenna IDs
+  inline casa::Vector<casa::uInt>& rwAntenna2() { return itsAntenna2; }
+
+  /// @brief read-write access to the first feed IDs
+  inline casa::Vector<casa::uInt>& rwFeed1() { return itsFeed1; }
+
+  /// @brief read-write access to the second feed IDs
+  inline casa::Vector<casa::uInt>& rwFeed2() { return itsFeed2; }
+
+  /// @brief read-write access to the position angles of the first feed
+  inline casa::Vector<casa::Float>& rwFeed1PA() { return itsFeed1PA; }
+
+  /// @brief read-write access to the position angles of the second feed
+  inline casa::Vector<casa::Float>& rwFeed2PA() { return itsFeed2PA; }
+
+  /// @brief read-write access to the pointing centres of the first antenna/feed
+  inline casa::Vector<casa::MVDirection>& rwPointingDir1() { return itsPointingDir1; }
+
+  /// @brief read-write access to the pointing centres of the second antenna/feed
+  inline casa::Vector<casa::MVDirection>& rwPointingDir2() { return itsPointingDir2; }
+
+  /// @brief read-write access to the dish pointings of the first antenna
+  inline casa::Vector<casa::MVDirection>& rwDishPointing1() { return itsDishPointing1; }
+
+  /// @brief read-write access to the dish pointings of the second antenna
+  inline casa::Vector<casa::MVDirection>& rwDishPointing2() { return itsDishPointing2; }
+
+  /// @brief read-write access to flags
+  inline casa::Cube<casa::Bool>& rwFlag() { return itsFlag; }
+
+  /// @brief read-write access to noise
+  inline casa::Cube<casa::Complex>& rwNoise() { return itsNoise; }
+
+  /// @brief read-write access to uvw
+  /// @note rotated uvws are cached, the cache is invalidated by resize
+  inline casa::Vector<casa::RigidVector<casa::Double, 3> >& rwUVW() { return itsUVW; }
+
+  /// @brief read-write access to frequencies
+  inline casa::Vector<casa::Double>& rwFrequency() { return itsFrequency; }
+
+  /// @brief read-write access to polarisation types
+  inline casa::Vector<casa::Stokes::StokesTypes>& rwStokes() { return itsStokes; }
+
+  /// @brief set the timestamp
+  /// @param[in] time new timestamp
+  inline void setTime(const casa::Double time) { itsTime = time; }
+
+private:
+  /// @brief visibilities
+  casa::Cube<casa::Complex> itsVisibility;
+
+  /// @brief flags
+  casa::Cube<casa::Bool> itsFlag;
+
+  /// @brief noise
+  casa::Cube<casa::Complex> itsNoise;
+
+  /// @brief uvw
+  casa::Vector<casa::RigidVector<casa::Double, 3> > itsUVW;
+
+  /// @brief first antenna IDs
+  casa::Vector<casa::uInt> itsAntenna1;
+
+  /// @brief second antenna IDs
+  casa::Vector<casa::uInt> itsAntenna2;
+
+  /// @brief first feed IDs
+  casa::Vector<casa::uInt> itsFeed1;
+
+  /// @brief second feed IDs
+  casa::Vector<casa::uInt> itsFeed2;
+
+  /// @brief position angles of the first feed
+  casa::Vector<casa::Float> itsFeed1PA;
+
+  /// @brief position angles of the second feed
+  casa::Vector<casa::Float> itsFeed2PA;
+
+  /// @brief pointing centres of the first antenna/feed
+  casa::Vector<casa::MVDirection> itsPointingDir1;
+
+  /// @brief pointing centres of the second antenna/feed
+  casa::Vector<casa::MVDirection> itsPointingDir2;
+
+  /// @brief dish pointings of the first antenna
+  casa::Vector<casa::MVDirection> itsDishPointing1;
+
+  /// @brief dish pointings of the second antenna
+  casa::Vector<casa::MVDirection> itsDishPointing2;
+
+  /// @brief timestamp
+  casa::Double itsTime;
+
+  /// @brief frequencies
+  casa::Vector<casa::Double> itsFrequency;
+
+  /// @brief polarisation types
+  casa::Vector<casa::Stokes::StokesTypes> itsStokes;
+
+  /// @brief rotated uvw and delays
+  UVWRotationHandler itsRotatedUVW;
+};
+
+} // namespace accessors
+
+} // namespace askap
+
+#endif // #ifndef ASKAP_ACCESSORS_AVERAGED_DATA_ACCESSOR_H
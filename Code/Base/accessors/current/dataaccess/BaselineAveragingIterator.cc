@@ -0,0 +1,483 @@
+/// @file BaselineAveragingIterator.cc
+/// @brief iterator adapter doing baseline-dependent averaging
+/// @details Short baselines can be averaged over a longer time interval and
+/// a wider bandwidth than long baselines before the decorrelation across the
+/// field of view becomes noticeable. This adapter wraps an arbitrary iterator
+/// and delivers chunks of data averaged up to a given decorrelation limit, so
+/// gridders and other algorithms can work on a reduced number of samples
+/// without any changes.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// own includes
+#include <dataaccess/BaselineAveragingIterator.h>
+#include <dataaccess/DataAccessError.h>
+#include <askap/AskapError.h>
+
+// casa includes
+#include <casa/BasicSL/Constants.h>
+#include <casa/BasicMath/Math.h>
+
+// std includes
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+using namespace askap;
+using namespace askap::accessors;
+
+/// @brief construct the adapter
+/// @param[in] iter input iterator
+/// @param[in] fieldOfView full field of view in radians
+/// @param[in] maxDecorrelation maximum fractional amplitude loss (e.g. 0.01)
+/// @param[in] maxInterval maximum averaging time in seconds
+/// @param[in] maxChannels maximum number of channels averaged together
+/// @param[in] uvwCacheSize number of uvw machines cached by the averaged accessors
+/// @param[in] uvwCacheTolerance pointing direction tolerance of the uvw machine cache
+BaselineAveragingIterator::BaselineAveragingIterator(const IConstDataSharedIter &iter,
+           const double fieldOfView, const double maxDecorrelation, const double maxInterval,
+           const casa::uInt maxChannels, const size_t uvwCacheSize, const double uvwCacheTolerance) :
+           itsIter(iter), itsMaxPhaseError(0.), itsHalfFOV(fieldOfView / 2.), itsMaxInterval(maxInterval),
+           itsMaxChannels(maxChannels), itsUVWCacheSize(uvwCacheSize), itsUVWCacheTolerance(uvwCacheTolerance),
+           itsChunkSize(1), itsInputDone(false), itsNInputRows(0), itsNOutputRows(0)
+{
+  ASKAPCHECK(itsIter, "An attempt to create BaselineAveragingIterator with an empty input iterator");
+  ASKAPCHECK(fieldOfView > 0, "Field of view should be positive, you have "<<fieldOfView);
+  ASKAPCHECK((maxDecorrelation > 0) && (maxDecorrelation < 1),
+             "Maximum decorrelation should be between 0 and 1, you have "<<maxDecorrelation);
+  ASKAPCHECK(maxInterval >= 0, "Maximum averaging interval should be non-negative, you have "<<maxInterval);
+  ASKAPCHECK(maxChannels > 0, "Maximum number of channels to average should be positive");
+  // amplitude loss for the box-car average of a linear phase gradient with the total
+  // phase change dphi is 1 - sinc(dphi/2) ~ dphi^2/24
+  itsMaxPhaseError = sqrt(24. * maxDecorrelation);
+  init();
+}
+
+/// @brief construct the key
+/// @param[in] ant1 first antenna
+/// @param[in] ant2 second antenna
+/// @param[in] feed1 first feed
+/// @param[in] feed2 second feed
+BaselineAveragingIterator::BaselineKey::BaselineKey(casa::uInt ant1, casa::uInt ant2,
+           casa::uInt feed1, casa::uInt feed2) : itsAnt1(ant1), itsAnt2(ant2),
+           itsFeed1(feed1), itsFeed2(feed2) {}
+
+/// @brief comparison operator for std::map
+/// @param[in] other another key
+/// @return true if this key is less than the other
+bool BaselineAveragingIterator::BaselineKey::operator<(const BaselineKey &other) const
+{
+  if (itsAnt1 != other.itsAnt1) {
+      return itsAnt1 < other.itsAnt1;
+  }
+  if (itsAnt2 != other.itsAnt2) {
+      return itsAnt2 < other.itsAnt2;
+  }
+  if (itsFeed1 != other.itsFeed1) {
+      return itsFeed1 < other.itsFeed1;
+  }
+  return itsFeed2 < other.itsFeed2;
+}
+
+/// @brief current averaged chunk
+/// @return a reference to the current chunk
+IDataAccessor& BaselineAveragingIterator::operator*() const
+{
+  ASKAPCHECK(!itsOutput.empty(), "An attempt to access data past the end of BaselineAveragingIterator");
+  ASKAPDEBUGASSERT(itsOutput.front());
+  return *itsOutput.front();
+}
+
+/// @brief switch to a buffer
+/// @param[in] bufferID the name of the buffer to choose
+void BaselineAveragingIterator::chooseBuffer(const std::string &bufferID)
+{
+  ASKAPTHROW(DataAccessLogicError, "Buffers are not supported by BaselineAveragingIterator, bufferID="<<
+             bufferID);
+}
+
+/// @brief switch to the original visibilities
+void BaselineAveragingIterator::chooseOriginal()
+{
+}
+
+/// @brief access to a buffer
+/// @param[in] bufferID the name of the buffer requested
+/// @return a reference to writable data accessor to the buffer requested
+IDataAccessor& BaselineAveragingIterator::buffer(const std::string &bufferID) const
+{
+  ASKAPTHROW(DataAccessLogicError, "Buffers are not supported by BaselineAveragingIterator, bufferID="<<
+             bufferID);
+}
+
+/// @brief restart the iteration from the beginning
+void BaselineAveragingIterator::init()
+{
+  itsIter.init();
+  itsAxes.clear();
+  itsOpenBins.clear();
+  itsClosedBins.clear();
+  itsOutput.clear();
+  itsChunkSize = 1;
+  itsInputDone = false;
+  itsNInputRows = 0;
+  itsNOutputRows = 0;
+  fillOutput();
+}
+
+/// @brief check whether there are more data available
+/// @return True if there are more data available
+casa::Bool BaselineAveragingIterator::hasMore() const throw()
+{
+  return !itsOutput.empty();
+}
+
+/// @brief advance the iterator one step further
+/// @return True if there are more data
+casa::Bool BaselineAveragingIterator::next()
+{
+  if (!itsOutput.empty()) {
+      itsOutput.pop_front();
+  }
+  fillOutput();
+  return hasMore();
+}
+
+/// @brief process input until there is an output chunk or the input is exhausted
+void BaselineAveragingIterator::fillOutput()
+{
+  while (itsOutput.empty() && !itsInputDone) {
+     if (itsIter.hasMore()) {
+         process(*itsIter);
+         itsIter.next();
+         if (itsClosedBins.size() >= itsChunkSize) {
+             emit();
+         }
+     } else {
+         itsInputDone = true;
+         for (std::map<BaselineKey, Bin>::const_iterator ci = itsOpenBins.begin();
+              ci != itsOpenBins.end(); ++ci) {
+              itsClosedBins.push_back(ci->second);
+         }
+         itsOpenBins.clear();
+         emit();
+     }
+  }
+}
+
+/// @brief process one chunk of input data
+/// @param[in] acc input accessor
+void BaselineAveragingIterator::process(const IConstDataAccessor &acc)
+{
+  const casa::uInt nRow = acc.nRow();
+  itsNInputRows += nRow;
+  itsChunkSize = std::max(nRow, casa::uInt(1));
+  const size_t axis = spectralAxis(acc);
+  const double time = acc.time();
+
+  // close bins which can't be extended any further in time
+  for (std::map<BaselineKey, Bin>::iterator it = itsOpenBins.begin(); it != itsOpenBins.end();) {
+       if (time - it->second.itsFirstTime > itsMaxInterval) {
+           itsClosedBins.push_back(it->second);
+           itsOpenBins.erase(it++);
+       } else {
+           ++it;
+       }
+  }
+
+  const casa::Vector<casa::uInt> &ant1 = acc.antenna1();
+  const casa::Vector<casa::uInt> &ant2 = acc.antenna2();
+  const casa::Vector<casa::uInt> &feed1 = acc.feed1();
+  const casa::Vector<casa::uInt> &feed2 = acc.feed2();
+  for (casa::uInt row = 0; row < nRow; ++row) {
+       const BaselineKey key(ant1[row], ant2[row], feed1[row], feed2[row]);
+       std::map<BaselineKey, Bin>::iterator it = itsOpenBins.find(key);
+       if ((it != itsOpenBins.end()) && !fitsBin(it->second, acc, row, axis)) {
+           itsClosedBins.push_back(it->second);
+           itsOpenBins.erase(it);
+           it = itsOpenBins.end();
+       }
+       if (it == itsOpenBins.end()) {
+           it = itsOpenBins.insert(std::make_pair(key, Bin())).first;
+           startBin(it->second, acc, row, axis);
+       }
+       addToBin(it->second, acc, row);
+  }
+}
+
+/// @brief obtain the index of the spectral axis matching the accessor
+/// @param[in] acc input accessor
+/// @return axis index
+size_t BaselineAveragingIterator::spectralAxis(const IConstDataAccessor &acc)
+{
+  const casa::Vector<casa::Double> &freq = acc.frequency();
+  const casa::Vector<casa::Stokes::StokesTypes> &stokes = acc.stokes();
+  for (size_t axis = 0; axis < itsAxes.size(); ++axis) {
+       const SpectralAxis &sa = itsAxes[axis];
+       if ((sa.itsFrequency.size() != freq.nelements()) || (sa.itsStokes.size() != stokes.nelements())) {
+           continue;
+       }
+       bool match = true;
+       for (casa::uInt ch = 0; match && (ch < freq.nelements()); ++ch) {
+            match = (sa.itsFrequency[ch] == freq[ch]);
+       }
+       for (casa::uInt pol = 0; match && (pol < stokes.nelements()); ++pol) {
+            match = (sa.itsStokes[pol] == stokes[pol]);
+       }
+       if (match) {
+           return axis;
+       }
+  }
+  ASKAPCHECK(freq.nelements() > 0, "BaselineAveragingIterator requires at least one spectral channel");
+  SpectralAxis sa;
+  sa.itsFrequency.assign(freq.begin(), freq.end());
+  sa.itsStokes.assign(stokes.begin(), stokes.end());
+  const double maxFreq = *std::max_element(sa.itsFrequency.begin(), sa.itsFrequency.end());
+  ASKAPCHECK(maxFreq > 0, "Frequencies are expected to be positive, the largest one is "<<maxFreq);
+  sa.itsMaxUVChange = itsMaxPhaseError * casa::C::c / (casa::C::_2pi * itsHalfFOV * maxFreq);
+  sa.itsChanWidth = freq.nelements() > 1 ? std::abs(freq[1] - freq[0]) : 0.;
+  itsAxes.push_back(sa);
+  return itsAxes.size() - 1;
+}
+
+/// @brief number of channels averaged together for the given baseline length
+/// @param[in] axis spectral axis
+/// @param[in] length baseline length in metres
+/// @return averaging factor (a power of two)
+casa::uInt BaselineAveragingIterator::channelFactor(const SpectralAxis &axis, const double length) const
+{
+  if ((itsMaxChannels <= 1) || (axis.itsChanWidth <= 0.)) {
+      return 1;
+  }
+  double limit = std::min(double(itsMaxChannels), double(axis.itsFrequency.size()));
+  if (length > 0.) {
+      limit = std::min(limit, itsMaxPhaseError * casa::C::c /
+                       (casa::C::_2pi * itsHalfFOV * length * axis.itsChanWidth));
+  }
+  casa::uInt factor = 1;
+  while (2. * factor <= limit) {
+     factor *= 2;
+  }
+  return factor;
+}
+
+/// @brief initialise a bin with the given row
+/// @param[in] bin bin to set up
+/// @param[in] acc input accessor
+/// @param[in] row row of the accessor
+/// @param[in] axis index of the spectral axis
+void BaselineAveragingIterator::startBin(Bin &bin, const IConstDataAccessor &acc, const casa::uInt row,
+                                         const size_t axis) const
+{
+  ASKAPDEBUGASSERT(axis < itsAxes.size());
+  bin.itsAnt1 = acc.antenna1()[row];
+  bin.itsAnt2 = acc.antenna2()[row];
+  bin.itsFeed1 = acc.feed1()[row];
+  bin.itsFeed2 = acc.feed2()[row];
+  bin.itsAxis = axis;
+  bin.itsFirstUVW = acc.uvw()[row];
+  const double length = sqrt(casa::square(bin.itsFirstUVW(0)) + casa::square(bin.itsFirstUVW(1)) +
+                             casa::square(bin.itsFirstUVW(2)));
+  bin.itsFactor = channelFactor(itsAxes[axis], length);
+  bin.itsPointingDir1 = acc.pointingDir1()[row];
+  bin.itsPointingDir2 = acc.pointingDir2()[row];
+  bin.itsDishPointing1 = acc.dishPointing1()[row];
+  bin.itsDishPointing2 = acc.dishPointing2()[row];
+  bin.itsFirstPA1 = acc.feed1PA()[row];
+  bin.itsFirstPA2 = acc.feed2PA()[row];
+  bin.itsFirstTime = acc.time();
+  for (size_t i = 0; i < 2; ++i) {
+       bin.itsSumUVW[i] = 0.;
+       bin.itsSumDPA1[i] = 0.;
+       bin.itsSumDPA2[i] = 0.;
+       bin.itsSumTime[i] = 0.;
+  }
+  bin.itsNSamples = 0;
+  bin.itsSumRowWeight = 0.;
+  const casa::uInt nChanOut = (acc.nChannel() + bin.itsFactor - 1) / bin.itsFactor;
+  const size_t size = nChanOut * acc.nPol();
+  bin.itsSumVis.assign(size, casa::Complex(0., 0.));
+  bin.itsSumWeight.assign(size, 0.);
+  bin.itsSumVarIm.assign(size, 0.);
+}
+
+/// @brief wrap the angle into [-pi,pi)
+/// @param[in] angle angle in radians
+/// @return wrapped angle
+static double wrapAngle(const double angle)
+{
+  return angle - casa::C::_2pi * floor((angle + casa::C::pi) / casa::C::_2pi);
+}
+
+/// @brief add the given row to the bin
+/// @param[in] bin bin to update
+/// @param[in] acc input accessor
+/// @param[in] row row of the accessor
+void BaselineAveragingIterator::addToBin(Bin &bin, const IConstDataAccessor &acc, const casa::uInt row)
+{
+  const casa::Cube<casa::Complex> &vis = acc.visibility();
+  const casa::Cube<casa::Complex> &noise = acc.noise();
+  const casa::Cube<casa::Bool> &flag = acc.flag();
+  const casa::uInt nChan = acc.nChannel();
+  const casa::uInt nPol = acc.nPol();
+  ASKAPDEBUGASSERT(bin.itsSumVis.size() == ((nChan + bin.itsFactor - 1) / bin.itsFactor) * nPol);
+  double rowWeight = 0.;
+  for (casa::uInt chan = 0; chan < nChan; ++chan) {
+       const size_t offset = (chan / bin.itsFactor) * nPol;
+       for (casa::uInt pol = 0; pol < nPol; ++pol) {
+            if (flag(row, chan, pol)) {
+                continue;
+            }
+            const float sigma = casa::real(noise(row, chan, pol));
+            const float wt = sigma > 0 ? 1. / (sigma * sigma) : 1.;
+            const size_t index = offset + pol;
+            bin.itsSumVis[index] += wt * vis(row, chan, pol);
+            bin.itsSumWeight[index] += wt;
+            bin.itsSumVarIm[index] += wt * wt * casa::square(casa::imag(noise(row, chan, pol)));
+            rowWeight += wt;
+       }
+  }
+
+  // metadata are averaged with the row weight to match the averaged visibilities
+  const casa::RigidVector<casa::Double, 3> &uvw = acc.uvw()[row];
+  const double dPA1 = wrapAngle(acc.feed1PA()[row] - bin.itsFirstPA1);
+  const double dPA2 = wrapAngle(acc.feed2PA()[row] - bin.itsFirstPA2);
+  const double weights[2] = {1., rowWeight};
+  for (size_t i = 0; i < 2; ++i) {
+       for (casa::uInt dim = 0; dim < 3; ++dim) {
+            bin.itsSumUVW[i](dim) += weights[i] * uvw(dim);
+       }
+       bin.itsSumDPA1[i] += weights[i] * dPA1;
+       bin.itsSumDPA2[i] += weights[i] * dPA2;
+       bin.itsSumTime[i] += weights[i] * acc.time();
+  }
+  bin.itsSumRowWeight += rowWeight;
+  ++bin.itsNSamples;
+}
+
+/// @brief check whether the given row can be added to the bin
+/// @param[in] bin bin to test
+/// @param[in] acc input accessor
+/// @param[in] row row of the accessor
+/// @param[in] axis index of the spectral axis
+/// @return true, if the row can be averaged with the bin
+bool BaselineAveragingIterator::fitsBin(const Bin &bin, const IConstDataAccessor &acc,
+                                        const casa::uInt row, const size_t axis) const
+{
+  if ((bin.itsAxis != axis) || (acc.time() - bin.itsFirstTime > itsMaxInterval)) {
+      return false;
+  }
+  if ((bin.itsPointingDir1.separation(acc.pointingDir1()[row]) >= 1e-9) ||
+      (bin.itsPointingDir2.separation(acc.pointingDir2()[row]) >= 1e-9)) {
+      return false;
+  }
+  const casa::RigidVector<casa::Double, 3> &uvw = acc.uvw()[row];
+  const double uvChange = sqrt(casa::square(uvw(0) - bin.itsFirstUVW(0)) +
+                               casa::square(uvw(1) - bin.itsFirstUVW(1)));
+  ASKAPDEBUGASSERT(axis < itsAxes.size());
+  return uvChange <= itsAxes[axis].itsMaxUVChange;
+}
+
+/// @brief convert closed bins into accessors
+/// @details Bins are grouped by the spectral axis and the channel averaging factor,
+/// each group gives one accessor.
+void BaselineAveragingIterator::emit()
+{
+  typedef std::map<std::pair<size_t, casa::uInt>, std::vector<size_t> > GroupMap;
+  GroupMap groups;
+  for (size_t index = 0; index < itsClosedBins.size(); ++index) {
+       const Bin &bin = itsClosedBins[index];
+       groups[std::make_pair(bin.itsAxis, bin.itsFactor)].push_back(index);
+  }
+  for (GroupMap::const_iterator ci = groups.begin(); ci != groups.end(); ++ci) {
+       const SpectralAxis &sa = itsAxes[ci->first.first];
+       const casa::uInt factor = ci->first.second;
+       const std::vector<size_t> &rows = ci->second;
+       const casa::uInt nChan = sa.itsFrequency.size();
+       const casa::uInt nChanOut = (nChan + factor - 1) / factor;
+       const casa::uInt nPol = sa.itsStokes.size();
+
+       boost::shared_ptr<AveragedDataAccessor> acc(new AveragedDataAccessor(itsUVWCacheSize,
+                                                   itsUVWCacheTolerance));
+       acc->resize(rows.size(), nChanOut, nPol);
+       casa::Vector<casa::Double> &freq = acc->rwFrequency();
+       for (casa::uInt chan = 0; chan < nChanOut; ++chan) {
+            const casa::uInt end = std::min((chan + 1) * factor, nChan);
+            double sum = 0.;
+            for (casa::uInt inChan = chan * factor; inChan < end; ++inChan) {
+                 sum += sa.itsFrequency[inChan];
+            }
+            freq[chan] = sum / (end - chan * factor);
+       }
+       for (casa::uInt pol = 0; pol < nPol; ++pol) {
+            acc->rwStokes()[pol] = sa.itsStokes[pol];
+       }
+
+       casa::Cube<casa::Complex> &vis = acc->rwVisibility();
+       casa::Cube<casa::Complex> &noise = acc->rwNoise();
+       casa::Cube<casa::Bool> &flag = acc->rwFlag();
+       double sumTime = 0.;
+       for (casa::uInt row = 0; row < rows.size(); ++row) {
+            const Bin &bin = itsClosedBins[rows[row]];
+            ASKAPDEBUGASSERT(bin.itsNSamples > 0);
+            // weighted means, unless all samples are flagged
+            const size_t sum = bin.itsSumRowWeight > 0. ? 1 : 0;
+            const double norm = sum == 1 ? bin.itsSumRowWeight : double(bin.itsNSamples);
+            acc->rwAntenna1()[row] = bin.itsAnt1;
+            acc->rwAntenna2()[row] = bin.itsAnt2;
+            acc->rwFeed1()[row] = bin.itsFeed1;
+            acc->rwFeed2()[row] = bin.itsFeed2;
+            acc->rwFeed1PA()[row] = bin.itsFirstPA1 + bin.itsSumDPA1[sum] / norm;
+            acc->rwFeed2PA()[row] = bin.itsFirstPA2 + bin.itsSumDPA2[sum] / norm;
+            acc->rwPointingDir1()[row] = bin.itsPointingDir1;
+            acc->rwPointingDir2()[row] = bin.itsPointingDir2;
+            acc->rwDishPointing1()[row] = bin.itsDishPointing1;
+            acc->rwDishPointing2()[row] = bin.itsDishPointing2;
+            for (casa::uInt dim = 0; dim < 3; ++dim) {
+                 acc->rwUVW()[row](dim) = bin.itsSumUVW[sum](dim) / norm;
+            }
+            sumTime += bin.itsSumTime[sum] / norm;
+            for (casa::uInt chan = 0; chan < nChanOut; ++chan) {
+                 for (casa::uInt pol = 0; pol < nPol; ++pol) {
+                      const size_t index = chan * nPol + pol;
+                      const float sumWt = bin.itsSumWeight[index];
+                      if (sumWt > 0) {
+                          vis(row, chan, pol) = bin.itsSumVis[index] / sumWt;
+                          noise(row, chan, pol) = casa::Complex(1. / sqrt(sumWt),
+                                                  sqrt(bin.itsSumVarIm[index]) / sumWt);
+                          flag(row, chan, pol) = casa::False;
+                      } else {
+                          vis(row, chan, pol) = casa::Complex(0., 0.);
+                          noise(row, chan, pol) = casa::Complex(1., 1.);
+                          flag(row, chan, pol) = casa::True;
+                      }
+                 }
+            }
+       }
+       acc->setTime(sumTime / rows.size());
+       itsNOutputRows += rows.size();
+       itsOutput.push_back(acc);
+  }
+  itsClosedBins.clear();
+}
@@ -0,0 +1,298 @@
+/// @file BaselineAveragingIterator.h
+/// @brief iterator adapter doing baseline-dependent averaging
+/// @details Short baselines can be averaged over a longer time interval and
+/// a wider bandwidth than long baselines before the decorrelation across the
+/// field of view becomes noticeable. This adapter wraps an arbitrary iterator
+/// and delivers chunks of data averaged up to a given decorrelation limit, so
+/// gridders and other algorithms can work on a reduced number of samples
+/// without any changes.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#ifndef ASKAP_ACCESSORS_BASELINE_AVERAGING_ITERATOR_H
+#define ASKAP_ACCESSORS_BASELINE_AVERAGING_ITERATOR_H
+
+#include <dataaccess/IDataIterator.h>
+#include <dataaccess/SharedIter.h>
+#include <dataaccess/AveragedDataAccessor.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <casa/Quanta/MVDirection.h>
+#include <scimath/Mathematics/RigidVector.h>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace askap {
+
+namespace accessors {
+
+/// @brief iterator adapter doing baseline-dependent averaging
+/// @details The visibilities of each baseline (and feed pair) are accumulated
+/// in a bin until the change of the uv-coordinates since the start of the bin
+/// would cause a phase change exceeding the allowed one at the edge of the field
+/// of view (for the highest frequency). The phase error corresponding to the
+/// given fractional amplitude loss d is sqrt(24 d), for the box-car averaging
+/// of a linear phase gradient. The same phase error defines the number of adjacent
+/// channels which can be averaged together (a power of two not exceeding the
+/// given maximum), which depends on the baseline length. The time and frequency
+/// criteria are applied independently, i.e. each of them uses the full budget.
+/// The bin is also closed if the time interval exceeds the given maximum, if the
+/// pointing changes or if the spectral setup changes.
+///
+/// Samples are weighted by the inverse variance derived from the real part of the
+/// noise, flagged samples are excluded. The noise of the averaged sample is propagated
+/// accordingly and averaged samples without any valid data are flagged. The uvw,
+/// time and position angles of an averaged row are the means over the input rows
+/// weighted with the total weight of the unflagged samples of each row, so rows which
+/// are completely flagged don't contribute (unless the whole bin is flagged, then the
+/// plain mean is taken). Rows averaged
+/// with the same number of channels are delivered together via AveragedDataAccessor.
+/// Averaging is done for the phase centre of the data, rotated uvws are computed
+/// from the averaged uvws (with the first pointing of the bin). Chunks are timestamped
+/// with the average time. Modification of the visibilities is allowed (e.g. to
+/// predict model visibilities) but is not propagated back to the original data;
+/// buffers are not supported.
+/// @ingroup dataaccess_hlp
+class BaselineAveragingIterator : virtual public IDataIterator
+{
+public:
+  /// @brief construct the adapter
+  /// @details The input iterator is rewound by the constructor. Manipulation with
+  /// the input iterator outside this adapter can lead to an unpredictable result.
+  /// @param[in] iter input iterator
+  /// @param[in] fieldOfView full field of view in radians (the phase error is
+  /// evaluated at half of this angle from the phase centre)
+  /// @param[in] maxDecorrelation maximum fractional amplitude loss (e.g. 0.01)
+  /// @param[in] maxInterval maximum averaging time in seconds
+  /// @param[in] maxChannels maximum number of channels averaged together (1 means
+  /// no frequency averaging)
+  /// @param[in] uvwCacheSize number of uvw machines cached by the averaged accessors
+  /// @param[in] uvwCacheTolerance pointing direction tolerance in radians, exceeding which
+  /// leads to initialisation of a new uvw machine
+  BaselineAveragingIterator(const IConstDataSharedIter &iter, const double fieldOfView,
+                            const double maxDecorrelation, const double maxInterval,
+                            const casa::uInt maxChannels = 1, const size_t uvwCacheSize = 1,
+                            const double uvwCacheTolerance = 1e-6);
+
+  /// @brief current averaged chunk
+  /// @return a reference to the current chunk
+  virtual IDataAccessor& operator*() const;
+
+  /// @brief switch to a buffer
+  /// @details Buffers are not supported, an exception is thrown
+  /// @param[in] bufferID the name of the buffer to choose
+  virtual void chooseBuffer(const std::string &bufferID);
+
+  /// @brief switch to the original visibilities
+  /// @details This is the only mode available, nothing is done
+  virtual void chooseOriginal();
+
+  /// @brief access to a buffer
+  /// @details Buffers are not supported, an exception is thrown
+  /// @param[in] bufferID the name of the buffer requested
+  /// @return a reference to writable data accessor to the buffer requested
+  virtual IDataAccessor& buffer(const std::string &bufferID) const;
+
+  /// @brief restart the iteration from the beginning
+  virtual void init();
+
+  /// @brief check whether there are more data available
+  /// @return True if there are more data available
+  virtual casa::Bool hasMore() const throw();
+
+  /// @brief advance the iterator one step further
+  /// @return True if there are more data (so constructions like
+  ///         while(it.next()) {} are possible)
+  virtual casa::Bool next();
+
+  /// @brief number of input rows processed so far
+  /// @return number of input rows
+  inline unsigned long nInputRows() const { return itsNInputRows; }
+
+  /// @brief number of averaged rows produced so far
+  /// @return number of output rows
+  inline unsigned long nOutputRows() const { return itsNOutputRows; }
+
+protected:
+  /// @brief spectral setup of the input data
+  struct SpectralAxis {
+     /// @brief frequencies of all input channels
+     std::vector<double> itsFrequency;
+     /// @brief polarisation products
+     std::vector<casa::Stokes::StokesTypes> itsStokes;
+     /// @brief maximum uv-distance change in metres allowed for the time averaging
+     double itsMaxUVChange;
+     /// @brief absolute channel spacing in Hz (zero for a single channel)
+     double itsChanWidth;
+  };
+
+  /// @brief key identifying a baseline
+  struct BaselineKey {
+     /// @brief construct the key
+     /// @param[in] ant1 first antenna
+     /// @param[in] ant2 second antenna
+     /// @param[in] feed1 first feed
+     /// @param[in] feed2 second feed
+     BaselineKey(casa::uInt ant1, casa::uInt ant2, casa::uInt feed1, casa::uInt feed2);
+     /// @brief comparison operator for std::map
+     /// @param[in] other another key
+     /// @return true if this key is less than the other
+     bool operator<(const BaselineKey &other) const;
+     /// @brief antenna and feed indices
+     casa::uInt itsAnt1, itsAnt2, itsFeed1, itsFeed2;
+  };
+
+  /// @brief accumulated data for one baseline
+  struct Bin {
+     /// @brief antenna and feed indices
+     casa::uInt itsAnt1, itsAnt2, itsFeed1, itsFeed2;
+     /// @brief index of the spectral axis
+     size_t itsAxis;
+     /// @brief number of channels averaged together
+     casa::uInt itsFactor;
+     /// @brief pointing directions of the first sample
+     casa::MVDirection itsPointingDir1, itsPointingDir2;
+     /// @brief dish pointings of the first sample
+     casa::MVDirection itsDishPointing1, itsDishPointing2;
+     /// @brief uvw of the first sample
+     casa::RigidVector<casa::Double, 3> itsFirstUVW;
+     /// @brief position angles of the first sample
+     double itsFirstPA1, itsFirstPA2;
+     /// @brief time of the first sample
+     double itsFirstTime;
+     /// @brief sums of uvws, position angle offsets from the first sample and times,
+     /// the first element is the plain sum, the second one is weighted with the row weight
+     casa::RigidVector<casa::Double, 3> itsSumUVW[2];
+     double itsSumDPA1[2], itsSumDPA2[2];
+     double itsSumTime[2];
+     /// @brief number of samples accumulated
+     casa::uInt itsNSamples;
+     /// @brief sum of the row weights (zero if all samples are flagged)
+     double itsSumRowWeight;
+     /// @brief weighted sum of visibilities (output channel major, polarisation minor)
+     std::vector<casa::Complex> itsSumVis;
+     /// @brief sum of weights
+     std::vector<float> itsSumWeight;
+     /// @brief sum of squared weights times the variance of the imaginary part
+     std::vector<float> itsSumVarIm;
+  };
+
+  /// @brief process one chunk of input data
+  /// @param[in] acc input accessor
+  void process(const IConstDataAccessor &acc);
+
+  /// @brief obtain the index of the spectral axis matching the accessor
+  /// @details A new axis is added if necessary
+  /// @param[in] acc input accessor
+  /// @return axis index
+  size_t spectralAxis(const IConstDataAccessor &acc);
+
+  /// @brief number of channels averaged together for the given baseline length
+  /// @param[in] axis spectral axis
+  /// @param[in] length baseline length in metres
+  /// @return averaging factor (a power of two)
+  casa::uInt channelFactor(const SpectralAxis &axis, const double length) const;
+
+  /// @brief initialise a bin with the given row
+  /// @param[in] bin bin to set up
+  /// @param[in] acc input accessor
+  /// @param[in] row row of the accessor
+  /// @param[in] axis index of the spectral axis
+  void startBin(Bin &bin, const IConstDataAccessor &acc, const casa::uInt row, const size_t axis) const;
+
+  /// @brief add the given row to the bin
+  /// @param[in] bin bin to update
+  /// @param[in] acc input accessor
+  /// @param[in] row row of the accessor
+  static void addToBin(Bin &bin, const IConstDataAccessor &acc, const casa::uInt row);
+
+  /// @brief check whether the given row can be added to the bin
+  /// @param[in] bin bin to test
+  /// @param[in] acc input accessor
+  /// @param[in] row row of the accessor
+  /// @param[in] axis index of the spectral axis
+  /// @return true, if the row can be averaged with the bin
+  bool fitsBin(const Bin &bin, const IConstDataAccessor &acc, const casa::uInt row, const size_t axis) const;
+
+  /// @brief convert closed bins into accessors
+  void emit();
+
+  /// @brief process input until there is an output chunk or the input is exhausted
+  void fillOutput();
+
+private:
+  /// @brief input iterator
+  IConstDataSharedIter itsIter;
+
+  /// @brief maximum phase error in radians
+  double itsMaxPhaseError;
+
+  /// @brief half of the field of view in radians
+  double itsHalfFOV;
+
+  /// @brief maximum averaging time in seconds
+  double itsMaxInterval;
+
+  /// @brief maximum channel averaging factor
+  casa::uInt itsMaxChannels;
+
+  /// @brief number of uvw machines cached by the averaged accessors
+  size_t itsUVWCacheSize;
+
+  /// @brief pointing direction tolerance of the uvw machine cache
+  double itsUVWCacheTolerance;
+
+  /// @brief spectral setups encountered so far
+  std::vector<SpectralAxis> itsAxes;
+
+  /// @brief bins being accumulated
+  std::map<BaselineKey, Bin> itsOpenBins;
+
+  /// @brief bins ready to be delivered
+  std::vector<Bin> itsClosedBins;
+
+  /// @brief averaged chunks, the front one is the current chunk
+  std::deque<boost::shared_ptr<AveragedDataAccessor> > itsOutput;
+
+  /// @brief number of closed bins which trigger the output
+  casa::uInt itsChunkSize;
+
+  /// @brief true, if the input iterator has reached the end
+  bool itsInputDone;
+
+  /// @brief number of input rows processed
+  unsigned long itsNInputRows;
+
+  /// @brief number of averaged rows delivered
+  unsigned long itsNOutputRows;
+};
+
+} // namespace accessors
+
+} // namespace askap
+
+#endif // #ifndef ASKAP_ACCESSORS_BASELINE_AVERAGING_ITERATOR_H
@@ -36,6 +36,7 @@
 /// ASKAPsoft includes
 #include <askap/AskapLogging.h>
 #include <askap/AskapError.h>
+#include <profile/Metrics.h>
 #include <tables/Tables/ArrayColumn.h>
 #include <tables/Tables/ScalarColumn.h>
 #include <measures/TableMeasures/ScalarMeasColumn.h>
@@ -475,7 +476,9 @@ void TableConstDataIterator::fillCube(casa::Cube<T> &cube,
 ///            cube to fill with the complex visibility data
 void TableConstDataIterator::fillVisibility(casa::Cube<casa::Complex> &vis) const
 {
+  ASKAPMETRICS_TIMER("accessor.read.visibility");
   fillCube(vis, getDataColumnName());
+  ASKAPMETRICS_COUNT("accessor.read.bytes", vis.nelements() * sizeof(casa::Complex));
 }
 
 /// @brief read flagging information
@@ -486,6 +489,7 @@ void TableConstDataIterator::fillVisibility(casa::Cube<casa::Complex> &vis) cons
 ///            bool type)
 void TableConstDataIterator::fillFlag(casa::Cube<casa::Bool> &flag) const
 {
+  ASKAPMETRICS_TIMER("accessor.read.flag");
   fillCube(flag,"FLAG");
 }
 
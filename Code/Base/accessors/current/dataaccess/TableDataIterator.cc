@@ -46,6 +46,9 @@
 #include <dataaccess/IBufferManager.h>
 #include <dataaccess/DataAccessError.h>
 
+// ASKAPsoft includes
+#include <profile/Metrics.h>
+
 // casa includes
 #include <tables/Tables/ArrayColumn.h>
 
@@ -280,6 +283,7 @@ TableDataIterator::~TableDataIterator()
 /// visibility cube (hence no parameters). 
 void TableDataIterator::writeOriginalVis() const
 {
+  ASKAPMETRICS_TIMER("accessor.write.visibility");
   const casa::Cube<casa::Complex> &originalVis=getAccessor().visibility();
   
   const casa::uInt nChan = nChannel();
@@ -31,14 +31,191 @@
 
 #include <imageaccess/CasaImageAccess.h>
 
+#include <askap/AskapError.h>
 #include <askap/AskapLogging.h>
+#include <askap/CasaTableLock.h>
+#include <casa/OS/Path.h>
 #include <images/Images/PagedImage.h>
+#include <profile/Metrics.h>
+#include <tables/Tables/TableLock.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/locks.hpp>
 
 ASKAP_LOGGER(logger, ".casaImageAccessor");
 
 using namespace askap;
 using namespace askap::accessors;
 
+namespace {
+
+/// @brief make the tile cache large enough for the given slice
+/// @details This way each tile intersecting the slice is read or written only once.
+/// @param[in] img image to access
+/// @param[in] blc bottom left corner of the slice
+/// @param[in] trc top right corner of the slice (inclusive)
+void setCacheForSlice(casa::PagedImage<float> &img, const casa::IPosition &blc, const casa::IPosition &trc)
+{
+   const casa::IPosition tile = img.niceCursorShape();
+   ASKAPDEBUGASSERT(tile.nelements() == blc.nelements());
+   casa::uInt nTiles = 1;
+   for (casa::uInt dim = 0; dim < blc.nelements(); ++dim) {
+        ASKAPDEBUGASSERT(tile[dim] > 0);
+        nTiles *= casa::uInt(trc[dim] / tile[dim] - blc[dim] / tile[dim] + 1);
+   }
+   img.setCacheSizeInTiles(nTiles);
+}
+
+/// @brief key of the image in the cache
+/// @details Different names of the same image (e.g. relative and absolute) map to the same key.
+/// @param[in] name image name
+/// @return absolute path
+std::string imageKey(const std::string &name)
+{
+   return casa::Path(name).absoluteName();
+}
+
+} // anonymous namespace
+
+/// @brief exclusive access to an open image for the duration of one operation
+/// @details The image is opened if it is not open yet. The process-wide CasaTableLock
+/// is held for the whole operation, as casacore tables (including pixel I/O) are not
+/// thread-safe. In the shared mode, the table lock is also acquired, so other processes
+/// can't access the image at the same time. Releasing the table lock writes all changes to disk.
+class CasaImageAccess::ImageLock : private boost::noncopyable {
+public:
+   /// @brief acquire the lock
+   /// @param[in] img cache entry of the image to lock
+   /// @param[in] shared true, if the table lock is to be taken
+   /// @param[in] write true, if the image is going to be modified
+   ImageLock(OpenImage &img, bool shared, bool write) : itsGuard(img.mutex), itsShared(shared)
+   {
+      if (!img.image) {
+          casa::PagedImage<float> *newImage = 0;
+          if (itsShared) {
+              newImage = new casa::PagedImage<float>(img.name, casa::TableLock(casa::TableLock::UserLocking));
+          } else {
+              newImage = new casa::PagedImage<float>(img.name);
+          }
+          img.image.reset(newImage, CasaTableLock::Deleter());
+      }
+      itsImage = img.image;
+      if (itsShared) {
+          // 0 attempts means wait until the lock is acquired
+          itsImage->lock(write ? casa::FileLocker::Write : casa::FileLocker::Read, 0);
+      }
+   }
+
+   /// @brief release the lock
+   ~ImageLock() 
+   {
+      if (itsShared) {
+          itsImage->unlock();
+      }
+   }
+
+   /// @brief access the image
+   /// @return reference to the image
+   casa::PagedImage<float>& image() const { return *itsImage; }
+
+   /// @brief write changes to disk
+   /// @details In the shared mode this is done when the table lock is released.
+   void flush() const 
+   {
+      if (!itsShared) {
+          itsImage->flush();
+      }
+   }
+
+private:
+   /// @brief lock of the in-process mutex
+   boost::lock_guard<boost::mutex> itsGuard;
+   /// @brief image being accessed
+   /// @note It is declared before itsTableLock, so it is released after the lock
+   /// (the deleter takes the lock if this is the last reference)
+   boost::shared_ptr<casa::PagedImage<float> > itsImage;
+   /// @brief process-wide lock serialising casacore table access
+   CasaTableLock itsTableLock;
+   /// @brief true, if the table lock has been taken
+   bool itsShared;
+};
+
+/// @brief constructor
+/// @param[in] maxOpenImages maximum number of images kept open
+/// @param[in] sharedWrites if true, the image is locked for each access, so it
+/// can be written by several processes at the same time
+CasaImageAccess::CasaImageAccess(size_t maxOpenImages, bool sharedWrites) : 
+         itsMaxOpenImages(maxOpenImages), itsSharedWrites(sharedWrites)
+{
+   ASKAPCHECK(itsMaxOpenImages > 0, "At least one image should be allowed to be open");
+}
+
+/// @brief destructor, closes all images
+CasaImageAccess::~CasaImageAccess()
+{
+   try {
+      closeAll();
+   }
+   catch (const std::exception &ex) {
+      ASKAPLOG_ERROR_STR(logger, "Error closing images: " << ex.what());
+   }
+}
+
+/// @brief obtain the cache entry for an image
+/// @details The entry is created if necessary and becomes the most recently used one.
+/// The image is opened on the first access via ImageLock.
+/// @param[in] name image name
+/// @return entry shared with the cache
+boost::shared_ptr<CasaImageAccess::OpenImage> CasaImageAccess::open(const std::string &name) const
+{
+   const std::string key = imageKey(name);
+   // images removed from the cache are closed when this list goes out of scope,
+   // i.e. after the cache mutex is released
+   std::list<boost::shared_ptr<OpenImage> > evicted;
+   boost::lock_guard<boost::mutex> lock(itsCacheMutex);
+   for (std::list<boost::shared_ptr<OpenImage> >::iterator it = itsImages.begin(); it != itsImages.end(); ++it) {
+        if ((*it)->name == key) {
+            itsImages.splice(itsImages.begin(), itsImages, it);
+            return itsImages.front();
+        }
+   }
+   const boost::shared_ptr<OpenImage> img(new OpenImage);
+   img->name = key;
+   insert(img, evicted);
+   return img;
+}
+
+/// @brief find the cache entry for an image
+/// @param[in] name image name
+/// @return entry shared with the cache or an empty pointer if the image is not open
+boost::shared_ptr<CasaImageAccess::OpenImage> CasaImageAccess::find(const std::string &name) const
+{
+   const std::string key = imageKey(name);
+   boost::lock_guard<boost::mutex> lock(itsCacheMutex);
+   for (std::list<boost::shared_ptr<OpenImage> >::const_iterator ci = itsImages.begin(); ci != itsImages.end(); ++ci) {
+        if ((*ci)->name == key) {
+            return *ci;
+        }
+   }
+   return boost::shared_ptr<OpenImage>();
+}
+
+/// @brief add an image to the cache as the most recently used one
+/// @details The least recently used images are moved to the given list if the cache
+/// is full. This method should be called with itsCacheMutex locked.
+/// @param[in] img image to add
+/// @param[out] evicted list to receive images removed from the cache
+void CasaImageAccess::insert(const boost::shared_ptr<OpenImage> &img,
+                             std::list<boost::shared_ptr<OpenImage> > &evicted) const
+{
+   itsImages.push_front(img);
+   while (itsImages.size() > itsMaxOpenImages) {
+      std::list<boost::shared_ptr<OpenImage> >::iterator last = itsImages.end();
+      --last;
+      evicted.splice(evicted.end(), itsImages, last);
+   }
+}
+
 // reading methods
 
 /// @brief obtain the shape
@@ -46,8 +223,9 @@ using namespace askap::accessors;
 /// @return full shape of the given image
 casa::IPosition CasaImageAccess::shape(const std::string &name) const
 {
-    casa::PagedImage<float> img(name);
-    return img.shape();
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    return lock.image().shape();
 }
 
 /// @brief read full image
@@ -55,9 +233,11 @@ casa::IPosition CasaImageAccess::shape(const std::string &name) const
 /// @return array with pixels
 casa::Array<float> CasaImageAccess::read(const std::string &name) const
 {
+    ASKAPMETRICS_TIMER("imageaccess.read");
     ASKAPLOG_INFO_STR(logger, "Reading CASA image " << name);
-    casa::PagedImage<float> img(name);
-    return img.get();
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    return lock.image().get();
 }
 
 /// @brief read part of the image
@@ -68,9 +248,12 @@ casa::Array<float> CasaImageAccess::read(const std::string &name) const
 casa::Array<float> CasaImageAccess::read(const std::string &name, const casa::IPosition &blc,
         const casa::IPosition &trc) const
 {
+    ASKAPMETRICS_TIMER("imageaccess.read");
     ASKAPLOG_INFO_STR(logger, "Reading a slice of the CASA image " << name << " from " << blc << " to " << trc);
-    casa::PagedImage<float> img(name);
-    return img.getSlice(casa::Slicer(blc, trc, casa::Slicer::endIsLast));
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    setCacheForSlice(lock.image(), blc, trc);
+    return lock.image().getSlice(casa::Slicer(blc, trc, casa::Slicer::endIsLast));
 }
 
 /// @brief obtain coordinate system info
@@ -78,8 +261,9 @@ casa::Array<float> CasaImageAccess::read(const std::string &name, const casa::IP
 /// @return coordinate system object
 casa::CoordinateSystem CasaImageAccess::coordSys(const std::string &name) const
 {
-    casa::PagedImage<float> img(name);
-    return img.coordinates();
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    return lock.image().coordinates();
 }
 
 /// @brief obtain beam info
@@ -87,8 +271,9 @@ casa::CoordinateSystem CasaImageAccess::coordSys(const std::string &name) const
 /// @return beam info vector
 casa::Vector<casa::Quantum<double> > CasaImageAccess::beamInfo(const std::string &name) const
 {
-    casa::PagedImage<float> img(name);
-    casa::ImageInfo ii = img.imageInfo();
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    casa::ImageInfo ii = lock.image().imageInfo();
     return ii.restoringBeam();
 }
 
@@ -105,7 +290,23 @@ void CasaImageAccess::create(const std::string &name, const casa::IPosition &sha
                              const casa::CoordinateSystem &csys)
 {
     ASKAPLOG_INFO_STR(logger, "Creating a new CASA image " << name << " with the shape " << shape);
-    casa::PagedImage<float> img(casa::TiledShape(shape), csys, name);
+    const boost::shared_ptr<OpenImage> img = open(name);
+    boost::lock_guard<boost::mutex> lock(img->mutex);
+    // the old image (if any) is replaced, this closes it with the table lock held
+    img->image.reset();
+    casa::PagedImage<float> *newImage = 0;
+    {
+        CasaTableLock tableLock;
+        if (itsSharedWrites) {
+            newImage = new casa::PagedImage<float>(casa::TiledShape(shape), csys, img->name,
+                            casa::TableLock(casa::TableLock::UserLocking));
+            // make the new image visible to other processes
+            newImage->unlock();
+        } else {
+            newImage = new casa::PagedImage<float>(casa::TiledShape(shape), csys, img->name);
+        }
+    }
+    img->image.reset(newImage, CasaTableLock::Deleter());
 }
 
 /// @brief write full image
@@ -113,22 +314,34 @@ void CasaImageAccess::create(const std::string &name, const casa::IPosition &sha
 /// @param[in] arr array with pixels
 void CasaImageAccess::write(const std::string &name, const casa::Array<float> &arr)
 {
+    ASKAPMETRICS_TIMER("imageaccess.write");
     ASKAPLOG_INFO_STR(logger, "Writing an array with the shape " << arr.shape() << " into a CASA image " << name);
-    casa::PagedImage<float> img(name);
-    img.put(arr);
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, true);
+    lock.image().put(arr);
+    lock.flush();
 }
 
 /// @brief write a slice of an image
+/// @details Slices can be written from different threads, but the writes are serialised
+/// on the table lock. In the shared mode, several processes can write non-overlapping
+/// slices into the same image.
 /// @param[in] name image name
 /// @param[in] arr array with pixels
 /// @param[in] where bottom left corner where to put the slice to (trc is deduced from the array shape)
 void CasaImageAccess::write(const std::string &name, const casa::Array<float> &arr,
                             const casa::IPosition &where)
 {
+    ASKAPMETRICS_TIMER("imageaccess.write");
     ASKAPLOG_INFO_STR(logger, "Writing a slice with the shape " << arr.shape() << " into a CASA image " <<
                       name << " at " << where);
-    casa::PagedImage<float> img(name);
-    img.putSlice(arr, where);
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, true);
+    if (arr.nelements() > 0) {
+        setCacheForSlice(lock.image(), where, where + arr.shape() - 1);
+    }
+    lock.image().putSlice(arr, where);
+    lock.flush();
 }
 
 /// @brief set brightness units of the image
@@ -137,8 +350,10 @@ void CasaImageAccess::write(const std::string &name, const casa::Array<float> &a
 /// @param[in] units string describing brightness units of the image (e.g. "Jy/beam")
 void CasaImageAccess::setUnits(const std::string &name, const std::string &units)
 {
-    casa::PagedImage<float> img(name);
-    img.setUnits(casa::Unit(units));
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, true);
+    lock.image().setUnits(casa::Unit(units));
+    lock.flush();
 }
 
 /// @brief set restoring beam info
@@ -150,8 +365,61 @@ void CasaImageAccess::setUnits(const std::string &name, const std::string &units
 /// @param[in] pa position angle in radians
 void CasaImageAccess::setBeamInfo(const std::string &name, double maj, double min, double pa)
 {
-    casa::PagedImage<float> img(name);
-    casa::ImageInfo ii = img.imageInfo();
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, true);
+    casa::ImageInfo ii = lock.image().imageInfo();
     ii.setRestoringBeam(casa::Quantity(maj, "rad"), casa::Quantity(min, "rad"), casa::Quantity(pa, "rad"));
-    img.setImageInfo(ii);
+    lock.image().setImageInfo(ii);
+    lock.flush();
+}
+
+// storage-related methods
+
+/// @brief obtain the tile shape
+/// @param[in] name image name
+/// @return shape of the tile used to store the given image
+casa::IPosition CasaImageAccess::tileShape(const std::string &name) const
+{
+    const boost::shared_ptr<OpenImage> img = open(name);
+    ImageLock lock(*img, itsSharedWrites, false);
+    return lock.image().niceCursorShape();
+}
+
+/// @brief write buffered changes to disk
+/// @details Nothing is done if the image is not open.
+/// @param[in] name image name
+void CasaImageAccess::flush(const std::string &name)
+{
+    const boost::shared_ptr<OpenImage> img = find(name);
+    if (img) {
+        boost::lock_guard<boost::mutex> lock(img->mutex);
+        if (img->image) {
+            CasaTableLock tableLock;
+            img->image->flush();
+        }
+    }
+}
+
+/// @brief release resources associated with the image
+/// @details The image is closed when the last operation using it is finished.
+/// @param[in] name image name
+void CasaImageAccess::close(const std::string &name)
+{
+    const std::string key = imageKey(name);
+    std::list<boost::shared_ptr<OpenImage> > closed;
+    boost::lock_guard<boost::mutex> lock(itsCacheMutex);
+    for (std::list<boost::shared_ptr<OpenImage> >::iterator it = itsImages.begin(); it != itsImages.end(); ++it) {
+         if ((*it)->name == key) {
+             closed.splice(closed.end(), itsImages, it);
+             break;
+         }
+    }
+}
+
+/// @brief close all images kept open
+void CasaImageAccess::closeAll()
+{
+    std::list<boost::shared_ptr<OpenImage> > closed;
+    boost::lock_guard<boost::mutex> lock(itsCacheMutex);
+    closed.splice(closed.end(), itsImages);
 }
@@ -33,14 +33,49 @@
 
 #include <imageaccess/IImageAccess.h>
 
+#include <list>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace casa {
+template<class T> class PagedImage;
+} // namespace casa
+
 namespace askap {
 namespace accessors {
 
 /// @brief Access casa image
-/// @details This class implements IImageAccess interface for CASA image
+/// @details This class implements IImageAccess interface for CASA image.
+/// Images are kept open between calls, so the table and its metadata are 
+/// not re-read for every slice. A limited number of most recently used images
+/// is kept open, the least recently used one is closed (and flushed) when the limit
+/// is reached. All methods are thread-safe. Images are keyed by the absolute path,
+/// so all threads share one table object per image. Each access (including pixel I/O)
+/// holds the process-wide CasaTableLock, as casacore is not thread-safe. Therefore,
+/// accesses from different threads are serialised, but do not require the image to
+/// be reopened.
+///
+/// Every writing method flushes the image before it returns, so the pixels are on
+/// disk even if the image is kept open. An accessor which lives until the end of 
+/// the program (e.g. held by a static pointer) should still be closed with
+/// closeAll() before main() returns, as casacore may be shut down by the time
+/// static objects are destroyed. If shared writes
+/// are enabled, each access takes the table lock, so several processes (e.g. MPI ranks)
+/// can write non-overlapping slices into the same cube.
 /// @ingroup imageaccess
 struct CasaImageAccess : public IImageAccess {
 
+    /// @brief constructor
+    /// @param[in] maxOpenImages maximum number of images kept open
+    /// @param[in] sharedWrites if true, the image is locked for each access, so it
+    /// can be written by several processes at the same time
+    explicit CasaImageAccess(size_t maxOpenImages = 8, bool sharedWrites = false);
+
+    /// @brief destructor, closes all images
+    virtual ~CasaImageAccess();
+
     //////////////////
     // Reading methods
     //////////////////
@@ -113,6 +148,76 @@ struct CasaImageAccess : public IImageAccess {
     /// @param[in] min minor axis in radians
     /// @param[in] pa position angle in radians
     virtual void setBeamInfo(const std::string &name, double maj, double min, double pa);
+
+    /////////////////////////
+    // Storage-related methods
+    /////////////////////////
+
+    /// @brief obtain the tile shape
+    /// @param[in] name image name
+    /// @return shape of the tile used to store the given image
+    virtual casa::IPosition tileShape(const std::string &name) const;
+
+    /// @brief write buffered changes to disk
+    /// @param[in] name image name
+    virtual void flush(const std::string &name);
+
+    /// @brief release resources associated with the image
+    /// @param[in] name image name
+    virtual void close(const std::string &name);
+
+    /// @brief close all images kept open
+    void closeAll();
+
+private:
+    /// @brief image kept open
+    /// @details There is one such object per image path. The image itself is opened
+    /// on the first access (with the mutex held), so concurrent first accesses from
+    /// several threads share a single table object.
+    struct OpenImage {
+        /// @brief absolute path of the image, used as the key
+        std::string name;
+        /// @brief image object, empty until the image is opened
+        boost::shared_ptr<casa::PagedImage<float> > image;
+        /// @brief mutex serialising accesses to this image
+        boost::mutex mutex;
+    };
+
+    /// @brief exclusive access to an open image for the duration of one operation
+    class ImageLock;
+
+    /// @brief obtain the cache entry for an image
+    /// @details The entry is created if necessary and becomes the most recently used one.
+    /// The image is opened on the first access via ImageLock.
+    /// @param[in] name image name
+    /// @return entry shared with the cache
+    boost::shared_ptr<OpenImage> open(const std::string &name) const;
+
+    /// @brief find the cache entry for an image
+    /// @param[in] name image name
+    /// @return entry shared with the cache or an empty pointer if the image is not open
+    boost::shared_ptr<OpenImage> find(const std::string &name) const;
+
+    /// @brief add an image to the cache as the most recently used one
+    /// @details The least recently used images are moved to the given list if the cache
+    /// is full. They're closed when the list is destroyed, which the caller can do
+    /// without holding the cache mutex. This method should be called with itsCacheMutex locked.
+    /// @param[in] img image to add
+    /// @param[out] evicted list to receive images removed from the cache
+    void insert(const boost::shared_ptr<OpenImage> &img,
+                std::list<boost::shared_ptr<OpenImage> > &evicted) const;
+
+    /// @brief protects itsImages
+    mutable boost::mutex itsCacheMutex;
+
+    /// @brief open images, the most recently used first
+    mutable std::list<boost::shared_ptr<OpenImage> > itsImages;
+
+    /// @brief maximum number of images kept open
+    size_t itsMaxOpenImages;
+
+    /// @brief true if table locking is used for each access
+    bool itsSharedWrites;
 };
 
 
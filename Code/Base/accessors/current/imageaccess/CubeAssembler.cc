@@ -0,0 +1,193 @@
+/// @file CubeAssembler.cc
+///
+/// @brief Assembly of a cube from individual planes
+/// @details Planes (e.g. channel images) are read in parallel into a memory buffer
+/// and written to the cube in batches, which cover whole tiles along the last axis.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <askap_accessors.h>
+
+#include <imageaccess/CubeAssembler.h>
+
+// System includes
+#include <algorithm>
+
+// ASKAPsoft includes
+#include <askap/AskapError.h>
+#include <askap/AskapLogging.h>
+#include <askap/CasaTableLock.h>
+#include <askap/TaskScheduler.h>
+#include <boost/bind.hpp>
+#include <casa/OS/Timer.h>
+
+ASKAP_LOGGER(logger, ".CubeAssembler");
+
+using namespace askap;
+using namespace askap::accessors;
+
+namespace {
+
+/// @brief maximum tile length along each of the first two axes
+const int maxSpatialTile = 128;
+
+/// @brief maximum tile length along the last axis
+const int maxPlanesInTile = 64;
+
+/// @brief number of planes fitting into the memory budget (at least one)
+size_t planesInBudget(const casa::IPosition &cubeShape, size_t memoryBudget)
+{
+   ASKAPDEBUGASSERT(cubeShape.nelements() > 0);
+   const size_t planeBytes = size_t(cubeShape.product() / cubeShape[cubeShape.nelements() - 1]) * sizeof(float);
+   return std::max(size_t(1), memoryBudget / planeBytes);
+}
+
+} // anonymous namespace
+
+/// @brief constructor
+/// @param[in] cube cube to write (should exist while this object is used)
+/// @param[in] memoryBudget maximum size of the plane buffer in bytes
+CubeAssembler::CubeAssembler(casa::PagedImage<float> &cube, size_t memoryBudget) : itsCube(cube)
+{
+   const casa::IPosition shape = itsCube.shape();
+   ASKAPCHECK(shape.nelements() > 1, "Cube should have at least 2 dimensions, shape = "<<shape);
+   const casa::uInt lastAxis = shape.nelements() - 1;
+   itsPlaneSize = size_t(shape.product() / shape[lastAxis]);
+
+   // planes are written in multiples of the tile length along the last axis, if memory permits
+   const size_t planesInTile = size_t(itsCube.niceCursorShape()[lastAxis]);
+   const size_t maxPlanes = std::min(planesInBudget(shape, memoryBudget), size_t(shape[lastAxis]));
+   itsPlanesPerBatch = maxPlanes >= planesInTile ? (maxPlanes / planesInTile) * planesInTile : maxPlanes;
+   if (itsPlanesPerBatch < planesInTile) {
+       ASKAPLOG_WARN_STR(logger, "Memory budget of "<<memoryBudget / 1024 / 1024<<
+              " MB is too small to hold a whole layer of tiles ("<<planesInTile<<
+              " planes), tiles will be rewritten");
+   }
+   ASKAPLOG_INFO_STR(logger, "Assembling cube of shape "<<shape<<" in batches of "<<itsPlanesPerBatch<<
+              " planes, tile shape is "<<itsCube.niceCursorShape());
+}
+
+/// @brief choose a tile shape for a cube assembled plane by plane
+/// @details The spatial part of the tile is limited to keep tiles small. The length
+/// along the last axis is chosen so that at least one layer of tiles fits into the
+/// memory budget.
+/// @param[in] cubeShape shape of the cube
+/// @param[in] memoryBudget maximum size of the plane buffer in bytes
+/// @return tile shape
+casa::IPosition CubeAssembler::tileShape(const casa::IPosition &cubeShape, size_t memoryBudget)
+{
+   ASKAPCHECK(cubeShape.nelements() > 1, "Cube should have at least 2 dimensions, shape = "<<cubeShape);
+   const casa::uInt lastAxis = cubeShape.nelements() - 1;
+   casa::IPosition tile(cubeShape.nelements(), 1);
+   for (casa::uInt dim = 0; dim < lastAxis && dim < 2; ++dim) {
+        tile[dim] = std::min(cubeShape[dim], ssize_t(maxSpatialTile));
+   }
+   const size_t planes = std::min(planesInBudget(cubeShape, memoryBudget), size_t(maxPlanesInTile));
+   tile[lastAxis] = std::min(cubeShape[lastAxis], ssize_t(planes));
+   return tile;
+}
+
+/// @brief read all planes and write them into the cube
+/// @param[in] reader function reading one plane
+void CubeAssembler::assemble(const PlaneReader &reader)
+{
+   const casa::IPosition shape = itsCube.shape();
+   const casa::uInt lastAxis = shape.nelements() - 1;
+   const size_t nPlanes = size_t(shape[lastAxis]);
+   casa::IPosition bufferShape(shape);
+   bufferShape[lastAxis] = ssize_t(itsPlanesPerBatch);
+   casa::Array<float> buffer(bufferShape);
+   casa::Timer timer;
+   double readTime = 0.;
+   double writeTime = 0.;
+   for (size_t first = 0; first < nPlanes; first += itsPlanesPerBatch) {
+        const size_t nInBatch = std::min(itsPlanesPerBatch, nPlanes - first);
+        if (nInBatch < itsPlanesPerBatch) {
+            bufferShape[lastAxis] = ssize_t(nInBatch);
+            buffer.resize(bufferShape);
+        }
+        ASKAPDEBUGASSERT(buffer.contiguousStorage());
+        timer.mark();
+        TaskScheduler::instance().parallelFor(first, first + nInBatch, 
+                 boost::bind(&CubeAssembler::readPlanes, this, boost::cref(reader), buffer.data(), first, _1, _2),
+                 "cubeplane", 1);
+        readTime += timer.real();
+        timer.mark();
+        casa::IPosition where(shape.nelements(), 0);
+        where[lastAxis] = ssize_t(first);
+        {
+           // the cube is written with the table lock held like any other casacore table
+           CasaTableLock lock;
+           itsCube.putSlice(buffer, where);
+        }
+        writeTime += timer.real();
+        ASKAPLOG_DEBUG_STR(logger, "Written planes "<<first<<" to "<<first + nInBatch - 1);
+   }
+   {
+      CasaTableLock lock;
+      itsCube.flush();
+   }
+   ASKAPLOG_INFO_STR(logger, "Assembled "<<nPlanes<<" planes, reading took "<<readTime<<
+                     " s, writing took "<<writeTime<<" s");
+}
+
+/// @brief read a range of planes into the buffer
+/// @param[in] reader function reading one plane
+/// @param[in] buffer pointer to the start of the buffer
+/// @param[in] first index of the plane corresponding to the start of the buffer
+/// @param[in] begin first index of the plane to read
+/// @param[in] end index past the last plane to read
+void CubeAssembler::readPlanes(const PlaneReader &reader, float *buffer, size_t first,
+                               size_t begin, size_t end) const
+{
+   for (size_t plane = begin; plane < end; ++plane) {
+        const casa::Array<float> arr = reader(plane);
+        ASKAPCHECK(arr.nelements() == itsPlaneSize, "Plane "<<plane<<" has "<<arr.nelements()<<
+                   " pixels, "<<itsPlaneSize<<" are expected");
+        // the buffer is accessed via the raw pointer because casa arrays referencing 
+        // the same storage should not be created in parallel
+        bool deleteIt;
+        const float *data = arr.getStorage(deleteIt);
+        std::copy(data, data + itsPlaneSize, buffer + (plane - first) * itsPlaneSize);
+        arr.freeStorage(data, deleteIt);
+   }
+}
+
+/// @brief open a CASA image in a way safe to do from several threads
+/// @details The casacore table system is not thread-safe. This method opens
+/// the image with the process-wide CasaTableLock held and the image is closed in
+/// the same way when the last copy of the returned pointer is destroyed. Other
+/// accesses to the image (e.g. reading the pixels) should also be done with the lock
+/// held, so only the work done by the reader outside casacore runs in parallel.
+/// @param[in] name image name
+/// @return shared pointer to the open image
+boost::shared_ptr<casa::PagedImage<float> > CubeAssembler::openImage(const std::string &name)
+{
+   casa::PagedImage<float> *img = 0;
+   {
+      CasaTableLock lock;
+      img = new casa::PagedImage<float>(name);
+   }
+   return boost::shared_ptr<casa::PagedImage<float> >(img, CasaTableLock::Deleter());
+}
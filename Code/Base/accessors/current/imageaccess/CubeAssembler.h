@@ -0,0 +1,119 @@
+/// @file CubeAssembler.h
+///
+/// @brief Assembly of a cube from individual planes
+/// @details Planes (e.g. channel images) are read in parallel into a memory buffer
+/// and written to the cube in batches, which cover whole tiles along the last axis.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_ACCESSORS_CUBE_ASSEMBLER_H
+#define ASKAP_ACCESSORS_CUBE_ASSEMBLER_H
+
+// System includes
+#include <string>
+#include <cstddef>
+
+// ASKAPsoft includes
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+#include <images/Images/PagedImage.h>
+
+namespace askap {
+namespace accessors {
+
+/// @brief Assembly of a cube from individual planes
+/// @details Writing a cube one plane at a time is slow if a tile spans many planes,
+/// because every tile is then read and written many times. This class reads as many
+/// planes as the memory budget allows (a multiple of the tile length along the last axis),
+/// and writes them with a single call, so every tile is written once. Planes are read by
+/// askap::TaskScheduler tasks. The last axis of the cube is the one along which the planes are 
+/// stacked (e.g. the spectral axis).
+/// @ingroup imageaccess
+class CubeAssembler {
+    public:
+        /// @brief function reading one plane
+        /// @details It is called with the plane index, possibly from several threads at
+        /// the same time. The result should have the same number of elements as one
+        /// plane of the cube (degenerate axes don't matter). Errors are reported via exceptions.
+        /// Calls to casacore made by the reader should hold the CasaTableLock (see openImage).
+        typedef boost::function<casa::Array<float>(size_t)> PlaneReader;
+
+        /// @brief constructor
+        /// @param[in] cube cube to write (should exist while this object is used)
+        /// @param[in] memoryBudget maximum size of the plane buffer in bytes
+        CubeAssembler(casa::PagedImage<float> &cube, size_t memoryBudget);
+
+        /// @brief choose a tile shape for a cube assembled plane by plane
+        /// @details The spatial part of the tile is limited to keep tiles small. The length
+        /// along the last axis is chosen so that at least one layer of tiles fits into the
+        /// memory budget.
+        /// @param[in] cubeShape shape of the cube
+        /// @param[in] memoryBudget maximum size of the plane buffer in bytes
+        /// @return tile shape
+        static casa::IPosition tileShape(const casa::IPosition &cubeShape, size_t memoryBudget);
+
+        /// @brief read all planes and write them into the cube
+        /// @param[in] reader function reading one plane
+        void assemble(const PlaneReader &reader);
+
+        /// @brief number of planes written with one call
+        /// @return number of planes in the buffer
+        size_t planesPerBatch() const { return itsPlanesPerBatch; }
+
+        /// @brief open a CASA image in a way safe to do from several threads
+        /// @details The casacore table system is not thread-safe. This method opens
+        /// the image with the process-wide CasaTableLock held and the image is closed in
+        /// the same way when the last copy of the returned pointer is destroyed. Other
+        /// accesses to the image (e.g. reading the pixels) should also be done with the lock
+        /// held, so only the work done by the reader outside casacore runs in parallel.
+        /// @param[in] name image name
+        /// @return shared pointer to the open image
+        static boost::shared_ptr<casa::PagedImage<float> > openImage(const std::string &name);
+
+    private:
+        /// @brief read a range of planes into the buffer
+        /// @param[in] reader function reading one plane
+        /// @param[in] buffer pointer to the start of the buffer
+        /// @param[in] first index of the plane corresponding to the start of the buffer
+        /// @param[in] begin first index of the plane to read
+        /// @param[in] end index past the last plane to read
+        void readPlanes(const PlaneReader &reader, float *buffer, size_t first,
+                        size_t begin, size_t end) const;
+
+        /// @brief cube to write
+        casa::PagedImage<float> &itsCube;
+
+        /// @brief number of pixels in one plane
+        size_t itsPlaneSize;
+
+        /// @brief number of planes written with one call
+        size_t itsPlanesPerBatch;
+};
+
+} // namespace accessors
+} // namespace askap
+
+#endif
@@ -40,6 +40,26 @@ namespace accessors {
 /// @brief void virtual desctructor, to keep the compiler happy
 IImageAccess::~IImageAccess() {}
 
+/// @brief obtain the tile shape
+/// @details Slices aligned with tiles are read and written most efficiently.
+/// The default implementation treats the whole image as a single tile.
+/// @param[in] name image name
+/// @return shape of the tile used to store the given image
+casa::IPosition IImageAccess::tileShape(const std::string &name) const
+{
+  return shape(name);
+}
+
+/// @brief write buffered changes to disk
+/// @details The default implementation does nothing.
+/// @param[in] name image name
+void IImageAccess::flush(const std::string &) {}
+
+/// @brief release resources associated with the image
+/// @details The default implementation does nothing.
+/// @param[in] name image name
+void IImageAccess::close(const std::string &) {}
+
 } // namespace accessors
 
 } // namespace askap
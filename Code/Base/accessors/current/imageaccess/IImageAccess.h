@@ -126,6 +126,30 @@ struct IImageAccess {
     /// @param[in] min minor axis in radians
     /// @param[in] pa position angle in radians
     virtual void setBeamInfo(const std::string &name, double maj, double min, double pa) = 0;
+
+    /////////////////////////
+    // Storage-related methods
+    /////////////////////////
+
+    /// @brief obtain the tile shape
+    /// @details Slices aligned with tiles are read and written most efficiently.
+    /// The default implementation treats the whole image as a single tile.
+    /// @param[in] name image name
+    /// @return shape of the tile used to store the given image
+    virtual casa::IPosition tileShape(const std::string &name) const;
+
+    /// @brief write buffered changes to disk
+    /// @details Implementations may keep images open between calls. This method
+    /// ensures all changes made so far are visible to other processes. The default
+    /// implementation does nothing.
+    /// @param[in] name image name
+    virtual void flush(const std::string &name);
+
+    /// @brief release resources associated with the image
+    /// @details The image is flushed and closed if it has been kept open. It will
+    /// be reopened by the next call accessing it. The default implementation does nothing.
+    /// @param[in] name image name
+    virtual void close(const std::string &name);
 };
 
 } // namespace accessors
@@ -50,7 +50,11 @@ boost::shared_ptr<IImageAccess> askap::accessors::imageAccessFactory(const LOFAR
    const std::string imageType = parset.getString("imagetype","casa");
    boost::shared_ptr<IImageAccess> result;
    if (imageType == "casa") {
-       boost::shared_ptr<CasaImageAccess> iaCASA(new CasaImageAccess());
+       // number of images kept open between calls and whether several processes
+       // write into the same image
+       const casa::uInt maxOpenImages = parset.getUint("imageaccess.maxopen", 8);
+       const bool sharedWrites = parset.getBool("imageaccess.sharedwrites", false);
+       boost::shared_ptr<CasaImageAccess> iaCASA(new CasaImageAccess(maxOpenImages, sharedWrites));
        // optional parameter setting may come here
        result = iaCASA;
    } else {
@@ -0,0 +1,219 @@
+/// @file 
+/// @brief Tests of the baseline-dependent averaging iterator
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef BASELINE_AVERAGING_ITERATOR_TEST_H
+#define BASELINE_AVERAGING_ITERATOR_TEST_H
+
+// cppunit includes
+#include <cppunit/extensions/HelperMacros.h>
+// own includes
+#include <dataaccess/BaselineAveragingIterator.h>
+#include <dataaccess/DataIteratorStub.h>
+#include <askap/AskapError.h>
+
+// std includes
+#include <cmath>
+#include <set>
+
+namespace askap {
+
+namespace accessors {
+
+/// @brief iterator stub emulating the earth rotation
+/// @details uvw's are rotated by the angle corresponding to 10 seconds at each step
+struct RotatingIteratorStub : public DataIteratorStub {
+  explicit RotatingIteratorStub(casa::uInt nsteps) : DataIteratorStub(nsteps) {}
+  
+  virtual casa::Bool next() {
+     const double angle = 7.2921e-5 * 10.;
+     for (casa::uInt row = 0; row < itsAccessor.itsUVW.nelements(); ++row) {
+          casa::RigidVector<casa::Double, 3> &uvw = itsAccessor.itsUVW[row];
+          const double u = uvw(0) * cos(angle) - uvw(1) * sin(angle);
+          const double v = uvw(0) * sin(angle) + uvw(1) * cos(angle);
+          uvw(0) = u;
+          uvw(1) = v;
+     }
+     itsAccessor.itsTime += 10.;
+     return DataIteratorStub::next();
+  }
+};
+
+/// @brief iterator stub with the first step completely flagged
+/// @details uvw's of the flagged step are offset by 10 cm in u, the time advances
+/// by 10 seconds at each step
+struct FlaggedFirstStepIteratorStub : public DataIteratorStub {
+  explicit FlaggedFirstStepIteratorStub(casa::uInt nsteps) : DataIteratorStub(nsteps) {
+     itsAccessor.itsFlag.set(casa::True);
+     for (casa::uInt row = 0; row < itsAccessor.itsUVW.nelements(); ++row) {
+          itsAccessor.itsUVW[row](0) += 0.1;
+     }
+  }
+
+  virtual casa::Bool next() {
+     if (itsAccessor.itsFlag(0, 0, 0)) {
+         itsAccessor.itsFlag.set(casa::False);
+         for (casa::uInt row = 0; row < itsAccessor.itsUVW.nelements(); ++row) {
+              itsAccessor.itsUVW[row](0) -= 0.1;
+         }
+     }
+     itsAccessor.itsTime += 10.;
+     return DataIteratorStub::next();
+  }
+};
+
+class BaselineAveragingIteratorTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(BaselineAveragingIteratorTest);
+  CPPUNIT_TEST(testTimeAveraging);  
+  CPPUNIT_TEST(testNoAveraging);  
+  CPPUNIT_TEST(testFrequencyAveraging);  
+  CPPUNIT_TEST(testFlaggedSamples);  
+  CPPUNIT_TEST_EXCEPTION(testBuffer,AskapError);  
+  CPPUNIT_TEST(testDetachedCopy);  
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testTimeAveraging() {
+     // the stub returns the same chunk at each step, so all steps are averaged together
+     const casa::uInt nSteps = 5;
+     BaselineAveragingIterator it(IConstDataSharedIter(new DataIteratorStub(nSteps)), 0.1, 0.01, 100.);
+     CPPUNIT_ASSERT(it.hasMore());
+     const IConstDataAccessor &acc = *it;
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(435), acc.nRow());
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(8), acc.nChannel());
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(1), acc.nPol());
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(0., acc.time(), 1e-6);
+     std::set<std::pair<casa::uInt, casa::uInt> > baselines;
+     for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+          baselines.insert(std::make_pair(acc.antenna1()[row], acc.antenna2()[row]));
+          for (casa::uInt chan = 0; chan < acc.nChannel(); ++chan) {
+               CPPUNIT_ASSERT(!acc.flag()(row, chan, 0));
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(1. / sqrt(double(nSteps)), casa::real(acc.noise()(row, chan, 0)), 1e-6);
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(0., casa::abs(acc.visibility()(row, chan, 0)), 1e-6);
+          }
+     }
+     CPPUNIT_ASSERT_EQUAL(size_t(435), baselines.size());
+     CPPUNIT_ASSERT(!it.next());
+     CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long>(435 * nSteps), it.nInputRows());
+     CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long>(435), it.nOutputRows());
+     // restart
+     it.init();
+     CPPUNIT_ASSERT(it.hasMore());
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(435), (*it).nRow());
+  }
+  
+  void testNoAveraging() {
+     // a wide field of view and a small decorrelation limit don't allow averaging
+     // of 10 second samples or 20 MHz channels for any baseline
+     BaselineAveragingIterator it(IConstDataSharedIter(new RotatingIteratorStub(3)), 1., 1e-4, 100., 8);
+     casa::uInt counter = 0;
+     for (; it.hasMore(); it.next(), ++counter) {
+          CPPUNIT_ASSERT_EQUAL(casa::uInt(435), (*it).nRow());
+          CPPUNIT_ASSERT_EQUAL(casa::uInt(8), (*it).nChannel());
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(10. * counter, (*it).time(), 1e-6);
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(1., casa::real((*it).noise()(0, 0, 0)), 1e-6);
+     }
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(3), counter);
+  }
+
+  void testFrequencyAveraging() {
+     BaselineAveragingIterator it(IConstDataSharedIter(new DataIteratorStub(1)), 1e-3, 0.01, 100., 8);
+     casa::uInt nRows = 0;
+     casa::uInt nChunks = 0;
+     // chunks are ordered by the averaging factor, shorter baselines are averaged more
+     double minLengthPrev = 1e30;
+     for (; it.hasMore(); it.next(), ++nChunks) {
+          const IConstDataAccessor &acc = *it;
+          const casa::uInt factor = 8 / acc.nChannel();
+          CPPUNIT_ASSERT_EQUAL(casa::uInt(8), acc.nChannel() * factor);
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(1.4e9 - 10e6 * (factor - 1), acc.frequency()[0], 1.);
+          double maxLength = 0.;
+          for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+               const casa::RigidVector<casa::Double, 3> &uvw = acc.uvw()[row];
+               maxLength = std::max(maxLength, sqrt(uvw(0) * uvw(0) + uvw(1) * uvw(1) + uvw(2) * uvw(2)));
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(1. / sqrt(double(factor)), casa::real(acc.noise()(row, 0, 0)), 1e-6);
+          }
+          CPPUNIT_ASSERT(maxLength < minLengthPrev);
+          minLengthPrev = 1e30;
+          for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+               const casa::RigidVector<casa::Double, 3> &uvw = acc.uvw()[row];
+               minLengthPrev = std::min(minLengthPrev, sqrt(uvw(0) * uvw(0) + uvw(1) * uvw(1) + uvw(2) * uvw(2)));
+          }
+          nRows += acc.nRow();
+     }
+     CPPUNIT_ASSERT(nChunks > 1);
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(435), nRows);
+  }
+
+  void testFlaggedSamples() {
+     // the flagged first step must not bias the averaged uvw and time
+     const DataAccessorStub reference(true);
+     BaselineAveragingIterator it(IConstDataSharedIter(new FlaggedFirstStepIteratorStub(3)), 0.1, 0.01, 100.,
+                                  1, 4, 1e-5);
+     CPPUNIT_ASSERT(it.hasMore());
+     const IConstDataAccessor &acc = *it;
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(435), acc.nRow());
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(15., acc.time(), 1e-6);
+     for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+          for (casa::uInt dim = 0; dim < 3; ++dim) {
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(reference.itsUVW[row](dim), acc.uvw()[row](dim), 1e-9);
+          }
+          CPPUNIT_ASSERT(!acc.flag()(row, 0, 0));
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(1. / sqrt(2.), casa::real(acc.noise()(row, 0, 0)), 1e-6);
+     }
+     CPPUNIT_ASSERT(!it.next());
+  }
+
+  void testBuffer() {
+     BaselineAveragingIterator it(IConstDataSharedIter(new DataIteratorStub(1)), 0.1, 0.01, 100.);
+     // this should generate an exception
+     it.buffer("TEST");
+  }
+
+  void testDetachedCopy() {
+     DataIteratorStub it(2);
+     AveragedDataAccessor copy;
+     copy.assign(*it);
+     const casa::RigidVector<casa::Double, 3> uvw = it->uvw()[1];
+     // the copy must stay intact when the original changes
+     it->rwVisibility().set(casa::Complex(1.,-1.));
+     CPPUNIT_ASSERT_EQUAL(casa::uInt(435), copy.nRow());
+     CPPUNIT_ASSERT_EQUAL(it->nChannel(), copy.nChannel());
+     CPPUNIT_ASSERT_EQUAL(it->nPol(), copy.nPol());
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(it->time(), copy.time(), 1e-6);
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(it->frequency()[3], copy.frequency()[3], 1e-6);
+     CPPUNIT_ASSERT_EQUAL(it->antenna2()[10], copy.antenna2()[10]);
+     for (casa::uInt i = 0; i < 3; ++i) {
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(uvw(i), copy.uvw()[1](i), 1e-6);
+     }
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(0., casa::abs(copy.visibility()(0, 0, 0)), 1e-6);
+     CPPUNIT_ASSERT_DOUBLES_EQUAL(sqrt(2.), casa::abs(it->visibility()(0, 0, 0)), 1e-6);
+  }
+};
+
+} // namespace accessors
+
+} // namespace askap
+
+#endif // #ifndef BASELINE_AVERAGING_ITERATOR_TEST_H
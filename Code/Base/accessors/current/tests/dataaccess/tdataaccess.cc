@@ -37,6 +37,7 @@
 #include "DataAccessorAdapterTest.h"
 #include "CachedAccessorFieldTest.h"
 #include "TimeChunkIteratorAdapterTest.h"
+#include "BaselineAveragingIteratorTest.h"
 
 #include "TableTestRunner.h"
 
@@ -52,6 +53,7 @@ int main(int argc, char *argv[])
    runner.addTest(askap::accessors::DataAccessorAdapterTest::suite());
    runner.addTest(askap::accessors::CachedAccessorFieldTest::suite());
    runner.addTest(askap::accessors::TimeChunkIteratorAdapterTest::suite());
+   runner.addTest(askap::accessors::BaselineAveragingIteratorTest::suite());
    runner.run();
    return 0;
  }
@@ -36,6 +36,8 @@
 
 
 #include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <Common/ParameterSet.h>
 
@@ -48,6 +50,8 @@ class CasaImageAccessTest : public CppUnit::TestFixture
 {
    CPPUNIT_TEST_SUITE(CasaImageAccessTest);
    CPPUNIT_TEST(testReadWrite);
+   CPPUNIT_TEST(testOpenImageCache);
+   CPPUNIT_TEST(testSamePathSharesHandle);
    CPPUNIT_TEST_SUITE_END();
 public:
    void setUp() {
@@ -111,7 +115,76 @@ public:
       itsImageAccessor->setBeamInfo(name,0.02,0.01,1.0);
    }
    
+   void testOpenImageCache() {
+      // only one image is kept open, so they're reopened in turn
+      LOFAR::ParameterSet parset;
+      parset.add("imagetype","casa");
+      parset.add("imageaccess.maxopen","1");
+      boost::shared_ptr<IImageAccess> accessor = imageAccessFactory(parset);
+      CPPUNIT_ASSERT(accessor);
+      const casa::IPosition shape(3,10,5,4);
+      casa::CoordinateSystem coordsys(makeCoords());
+      coordsys.addCoordinate(casa::LinearCoordinate(1));
+      const std::string names[2] = {"tmp.testimage1", "tmp.testimage2"};
+      for (size_t im = 0; im < 2; ++im) {
+           accessor->create(names[im], shape, coordsys);
+      }
+      // write planes alternating between images
+      for (int plane = 0; plane < shape[2]; ++plane) {
+           for (size_t im = 0; im < 2; ++im) {
+                casa::Array<float> arr(casa::IPosition(3,shape[0],shape[1],1), float(plane + 10 * im));
+                accessor->write(names[im], arr, casa::IPosition(3,0,0,plane));
+           }
+      }
+      accessor->flush(names[1]);
+      for (size_t im = 0; im < 2; ++im) {
+           CPPUNIT_ASSERT(accessor->shape(names[im]) == shape);
+           const casa::IPosition tile = accessor->tileShape(names[im]);
+           CPPUNIT_ASSERT_EQUAL(shape.nelements(), tile.nelements());
+           for (int plane = 0; plane < shape[2]; ++plane) {
+                const casa::Array<float> arr = accessor->read(names[im], casa::IPosition(3,0,0,plane),
+                                       casa::IPosition(3,shape[0]-1,shape[1]-1,plane));
+                CPPUNIT_ASSERT_EQUAL(size_t(shape[0] * shape[1]), size_t(arr.nelements()));
+                CPPUNIT_ASSERT(fabs(arr(casa::IPosition(3,3,2,0)) - float(plane + 10 * im)) < 1e-7);
+           }
+           accessor->close(names[im]);
+      }
+      // the image is reopened after close
+      CPPUNIT_ASSERT(accessor->shape(names[0]) == shape);
+   }
+   
+   void testSamePathSharesHandle() {
+      // the image is accessed via two spellings of its path from several threads,
+      // writes through one name have to be seen through the other without a flush
+      const std::string names[2] = {"tmp.testimage3", "./tmp.testimage3"};
+      const casa::IPosition shape(3,10,5,8);
+      casa::CoordinateSystem coordsys(makeCoords());
+      coordsys.addCoordinate(casa::LinearCoordinate(1));
+      itsImageAccessor->create(names[0], shape, coordsys);
+      boost::thread_group threads;
+      for (int plane = 0; plane < shape[2]; ++plane) {
+           threads.create_thread(boost::bind(&CasaImageAccessTest::writePlane, this,
+                                 names[plane % 2], shape, plane));
+      }
+      threads.join_all();
+      for (int plane = 0; plane < shape[2]; ++plane) {
+           const casa::Array<float> arr = itsImageAccessor->read(names[(plane + 1) % 2],
+                      casa::IPosition(3,0,0,plane), casa::IPosition(3,shape[0]-1,shape[1]-1,plane));
+           CPPUNIT_ASSERT(fabs(arr(casa::IPosition(3,4,1,0)) - float(plane + 1)) < 1e-7);
+      }
+      itsImageAccessor->close(names[1]);
+   }
+
 protected:
+
+   /// @brief write a constant plane
+   /// @param[in] name image name
+   /// @param[in] shape shape of the cube
+   /// @param[in] plane plane to write, the value is plane + 1
+   void writePlane(const std::string &name, const casa::IPosition &shape, int plane) {
+      const casa::Array<float> arr(casa::IPosition(3,shape[0],shape[1],1), float(plane + 1));
+      itsImageAccessor->write(name, arr, casa::IPosition(3,0,0,plane));
+   }
    
    casa::CoordinateSystem makeCoords() {
       casa::Vector<casa::String> names(2);
@@ -0,0 +1,132 @@
+/// @file
+///
+/// Unit test for the assembly of a cube from individual planes
+///
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+#include <imageaccess/CubeAssembler.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <askap/AskapError.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+#include <coordinates/Coordinates/CoordinateSystem.h>
+#include <coordinates/Coordinates/LinearCoordinate.h>
+#include <images/Images/PagedImage.h>
+#include <images/Images/TiledShape.h>
+
+#include <boost/bind.hpp>
+
+namespace askap {
+
+namespace accessors {
+
+class CubeAssemblerTest : public CppUnit::TestFixture 
+{
+   CPPUNIT_TEST_SUITE(CubeAssemblerTest);
+   CPPUNIT_TEST(testTileShape);
+   CPPUNIT_TEST(testAssemble);
+   CPPUNIT_TEST_EXCEPTION(testBadPlane, AskapError);
+   CPPUNIT_TEST_SUITE_END();
+public:
+   void testTileShape() {
+      // 4 planes of 1000x1000 fit into the budget
+      const size_t budget = 16000000;
+      const casa::IPosition tile = CubeAssembler::tileShape(casa::IPosition(4,1000,1000,1,300), budget);
+      CPPUNIT_ASSERT(tile == casa::IPosition(4,128,128,1,4));
+      // small cube, tile is limited by its shape
+      const casa::IPosition smallTile = CubeAssembler::tileShape(casa::IPosition(3,10,20,30), budget);
+      CPPUNIT_ASSERT(smallTile == casa::IPosition(3,10,20,30));
+      // a single plane doesn't fit, the budget is exceeded by one plane
+      const casa::IPosition thinTile = CubeAssembler::tileShape(casa::IPosition(3,1000,1000,30), 1000);
+      CPPUNIT_ASSERT(thinTile == casa::IPosition(3,128,128,1));
+   }
+   
+   void testAssemble() {
+      // 3 planes fit into the budget, so the last batch is incomplete 
+      const casa::IPosition shape(3,10,5,8);
+      const size_t budget = 3 * 10 * 5 * sizeof(float);
+      const casa::IPosition tile = CubeAssembler::tileShape(shape, budget);
+      CPPUNIT_ASSERT(tile == casa::IPosition(3,10,5,3));
+      casa::PagedImage<float> cube(casa::TiledShape(shape, tile), makeCoords(), "tmp.testcube");
+      CubeAssembler assembler(cube, budget);
+      CPPUNIT_ASSERT_EQUAL(size_t(3), assembler.planesPerBatch());
+      assembler.assemble(boost::bind(&CubeAssemblerTest::makePlane, _1));
+      const casa::Array<float> result = cube.get();
+      for (int plane = 0; plane < shape[2]; ++plane) {
+           for (int y = 0; y < shape[1]; ++y) {
+                for (int x = 0; x < shape[0]; ++x) {
+                     CPPUNIT_ASSERT_DOUBLES_EQUAL(pixelValue(x, y, plane), 
+                           result(casa::IPosition(3, x, y, plane)), 1e-6);
+                }
+           }
+      }
+   }
+
+   void testBadPlane() {
+      const casa::IPosition shape(3,10,6,4);
+      casa::PagedImage<float> cube(casa::TiledShape(shape), makeCoords(), "tmp.testcube");
+      CubeAssembler assembler(cube, 1000000);
+      // planes have a wrong number of pixels
+      assembler.assemble(boost::bind(&CubeAssemblerTest::makePlane, _1));
+   }
+   
+protected:
+
+   static float pixelValue(int x, int y, size_t plane) {
+      return float(x + 100 * y) + 0.5 * plane;
+   }
+
+   static casa::Array<float> makePlane(size_t plane) {
+      // planes are returned without the degenerate axis
+      casa::Array<float> arr(casa::IPosition(2,10,5));
+      for (int y = 0; y < 5; ++y) {
+           for (int x = 0; x < 10; ++x) {
+                arr(casa::IPosition(2, x, y)) = pixelValue(x, y, plane);
+           }
+      }
+      return arr;
+   }
+   
+   static casa::CoordinateSystem makeCoords() {
+      casa::Vector<casa::String> names(2);
+      names[0]="x"; names[1]="y";
+      casa::Vector<double> increment(2 ,1.);
+      
+      casa::Matrix<double> xform(2,2,0.);
+      xform.diagonal() = 1.;
+      casa::LinearCoordinate linear(names, casa::Vector<casa::String>(2,"pixel"),
+             casa::Vector<double>(2,0.),increment, xform, casa::Vector<double>(2,0.));
+     
+      casa::CoordinateSystem coords; 
+      coords.addCoordinate(linear);
+      coords.addCoordinate(casa::LinearCoordinate(1));
+      return coords;
+   }   
+};
+    
+} // namespace accessors
+
+} // namespace askap
+
@@ -26,11 +26,13 @@
 
 // Test includes
 #include <CasaImageAccessTest.h>
+#include <CubeAssemblerTest.h>
 
 int main(int argc, char *argv[])
 {
     askapdev::testutils::AskapTestRunner runner(argv[0]);
     runner.addTest( askap::accessors::CasaImageAccessTest::suite());
+    runner.addTest( askap::accessors::CubeAssemblerTest::suite());
     bool wasSucessful = runner.run();
 
     return wasSucessful ? 0 : 1;
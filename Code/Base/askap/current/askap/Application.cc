@@ -41,6 +41,7 @@
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
 #include "askap/Log4cxxLogSink.h"
+#include "profile/Metrics.h"
 #include "log4cxx/logger.h"
 #include "log4cxx/logmanager.h"
 #include "log4cxx/consoleappender.h"
@@ -78,8 +79,11 @@ int Application::main(int argc, char *argv[])
         processCmdLineArgs(argc, argv);
         initLogging(argv[0]);
         initConfig();
+        Metrics::instance().configure(itsParset);
         status = run(argc, argv);
+        Metrics::instance().stopReporting();
     } catch (const std::exception& e) {
+        Metrics::instance().stopReporting();
         if (ASKAPLOG_ISCONFIGURED) {
             ASKAPLOG_FATAL_STR(logger, "Error: " << e.what());
         } else {
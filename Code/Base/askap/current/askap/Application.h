@@ -44,6 +44,7 @@ namespace askap {
     /// - Usage/help message
     /// - Setup logging
     /// - Parsing of ParameterSet configuration file
+    /// - Periodic reporting of metrics, if configured (see Metrics::configure)
     /// - Handling of exceptions so they don't propogate out of main()
     ///
     /// Here is an example usage:
@@ -21,9 +21,7 @@
 #include <coordinates/Coordinates/DirectionCoordinate.h>
 #include <measures/Measures/MDirection.h>
 
-#ifdef _OPENMP
 #include <boost/thread/mutex.hpp>
-#endif
 
 namespace askap {
 
@@ -35,10 +33,10 @@ namespace  utility {
 /// either in a class of its own (to avoid carrying unnecessary locks) or even be 
 /// integrated into casacore. For now we use this class to avoid overloading the
 /// code by the synchronisation primitives.
+/// The locks are held regardless of openmp, as gridders also run in the tasks of
+/// the task scheduler and casacore is built without thread-safe reference counting.
 struct CasaSyncHelper {
    
-   #ifdef _OPENMP
-
    /// @brief extract zVector from an x,y,z cube for reading
    /// @details it is equivalent to yzPlane(x).row(y)
    /// @param[in] cube input cube
@@ -84,39 +82,6 @@ private:
    /// @brief synchronisation mutex for toWorld
    mutable boost::mutex itsToWorldMutex;
    
-   #else
-
-   /// @brief extract zVector from an x,y,z cube for reading
-   /// @details it is equivalent to yzPlane(x).row(y)
-   /// @param[in] cube input cube
-   /// @param[in] x first coordinate
-   /// @param[in] y second coordinate
-   template<typename T>
-   static inline casa::Vector<T> zVector(const casa::Cube<T> &cube, const casa::uInt x, const casa::uInt y) {
-       return cube.yzPlane(x).row(y).copy();
-   }
-
-   /// @brief pixel to world conversion for direction
-   /// @details This is a wrapper around toWorld method of the direction coordinate
-   /// @param[in] dc direction coordinate
-   /// @param[out] out direction measure to fill
-   /// @param[in] pixel vector with pixel coordinate (size of two is expected)
-   /// @return true if the conversion is successful
-   static inline bool toWorld(const casa::DirectionCoordinate &dc, casa::MDirection &out, const casa::Vector<casa::Double> &pixel) {
-      return dc.toWorld(out, pixel);
-   }
-
-   /// @brief generalised copy for array clases
-   /// @param[in] in reference to input object
-   /// @return a copy
-   /// @note the method is templated so it can be used with Array, Vector or Matrix
-   template<typename T>
-   static inline T copy(const T &in) {
-      return in.copy();
-   }
-
-
-   #endif
 };
 
 
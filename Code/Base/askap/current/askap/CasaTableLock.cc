@@ -0,0 +1,45 @@
+/// @file CasaTableLock.cc
+/// @brief Process-wide lock serialising casacore table access
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// Include own header file first
+#include "askap/CasaTableLock.h"
+
+using namespace askap;
+
+/// @brief lock the process-wide table mutex
+CasaTableLock::CasaTableLock() : itsLock(mutex())
+{
+}
+
+/// @brief the process-wide table mutex
+/// @return reference to the mutex
+boost::mutex& CasaTableLock::mutex()
+{
+    // constructed on first use and never destroyed, so the lock is safe
+    // to take from constructors and destructors of other static objects
+    static boost::mutex *theMutex = new boost::mutex;
+    return *theMutex;
+}
@@ -0,0 +1,83 @@
+/// @file CasaTableLock.h
+/// @brief Process-wide lock serialising casacore table access
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_CASATABLELOCK_H
+#define ASKAP_CASATABLELOCK_H
+
+// Boost includes
+#include <boost/noncopyable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace askap {
+
+    /// @brief Process-wide lock serialising casacore table access
+    /// @details The casacore table system (and the measures code reading its
+    /// tables) is not thread-safe. Code which opens, closes, reads or writes
+    /// tables from more than one thread should hold this lock for the duration
+    /// of the casacore calls. There is a single mutex per process, so
+    /// independent classes (image accessors, measurement set writers) are
+    /// serialised with respect to each other as well. The mutex is not recursive.
+    ///
+    /// @code
+    /// {
+    ///    CasaTableLock lock;
+    ///    casa::PagedImage<float> img(name);
+    ///    ...
+    /// }
+    /// @endcode
+    class CasaTableLock : private boost::noncopyable {
+        public:
+            /// @brief lock the process-wide table mutex
+            CasaTableLock();
+
+            /// @brief the process-wide table mutex
+            /// @details For code which needs to manage the lock itself, e.g.
+            /// to unlock it for a while or to use it in a deleter.
+            /// @return reference to the mutex
+            static boost::mutex& mutex();
+
+            /// @brief deleter for smart pointers to table-based objects
+            /// @details Destroying a table (e.g. a PagedImage) flushes and
+            /// closes it, so it is done with the lock held.
+            struct Deleter {
+                /// @brief destroy the object
+                /// @param[in] obj object to destroy
+                template<typename T>
+                void operator()(T *obj) const {
+                    CasaTableLock lock;
+                    delete obj;
+                }
+            };
+
+        private:
+            /// @brief the lock held by this object
+            boost::lock_guard<boost::mutex> itsLock;
+    };
+
+} // namespace askap
+
+#endif
@@ -72,6 +72,20 @@ void StatReporter::logMemorySummary(void)
 {
     long vmpeak = -1;
     long rsspeak = -1;
+    if (!peakMemory(vmpeak, rsspeak)) {
+        return;
+    }
+
+    // Report
+    ASKAPLOG_INFO_STR(logger, "Memory stats - PeakVM: "
+            << StatReporter::kbToMb(vmpeak) << "  PeakRSS: "
+            << StatReporter::kbToMb(rsspeak));
+}
+
+bool StatReporter::peakMemory(long& vmpeak, long& rsspeak)
+{
+    vmpeak = -1;
+    rsspeak = -1;
 
 #ifdef __MACH__
     struct rusage ru;
@@ -79,7 +93,7 @@ void StatReporter::logMemorySummary(void)
     if (err != 0) {
         ASKAPLOG_INFO_STR(logger,
                 "Memory stats - Error: getrusage() failed (" << err << ")");
-        return;
+        return false;
     }
 
     rsspeak = ru.ru_maxrss / 1024L; // ru_maxrss is in bytes
@@ -93,7 +107,7 @@ void StatReporter::logMemorySummary(void)
     if (!file) {
         ASKAPLOG_INFO_STR(logger,
                 "Memory stats - Error: Could not open procfs to obtain status");
-        return;
+        return false;
     }
 
     // Find the VmPeak and RSSPeak
@@ -113,10 +127,24 @@ void StatReporter::logMemorySummary(void)
 
 #endif //__MACH__
 
-    // Report
-    ASKAPLOG_INFO_STR(logger, "Memory stats - PeakVM: "
-            << StatReporter::kbToMb(vmpeak) << "  PeakRSS: "
-            << StatReporter::kbToMb(rsspeak));
+    return true;
+}
+
+bool StatReporter::resetPeakRSS(void)
+{
+#ifdef __MACH__
+    return false;
+#else // __MACH__
+    // Writing 5 to clear_refs resets VmHWM to the current resident set size
+    std::stringstream ss;
+    ss << "/proc/" << int(getpid()) << "/clear_refs";
+    std::ofstream file(ss.str().c_str());
+    if (!file) {
+        return false;
+    }
+    file << "5" << std::endl;
+    return file.good();
+#endif //__MACH__
 }
 
 long StatReporter::parseValue(std::ifstream& file)
@@ -59,6 +59,19 @@ namespace askap {
             /// the process was forked.
             void logTimeSummary(void);
 
+            /// Obtain the peak memory usage of the process
+            /// @param[out] vmpeak peak virtual memory size in kB, -1 if unknown
+            /// @param[out] rsspeak peak resident set size in kB, -1 if unknown
+            /// @return false if the statistics could not be obtained
+            bool peakMemory(long& vmpeak, long& rsspeak);
+
+            /// Reset the peak resident set size to the current one, so
+            /// the next call to peakMemory() reports the high-water mark
+            /// of the following part of the run only. This is only supported
+            /// by Linux kernels 4.0 and later.
+            /// @return false if the reset is not supported
+            static bool resetPeakRSS(void);
+
         private:
             // Utility function - parses the two tokens which should be
             // an integer (size in kB), then the token "kB".
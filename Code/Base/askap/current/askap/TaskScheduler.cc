@@ -0,0 +1,505 @@
+/// @file TaskScheduler.cc
+/// @brief Process-wide pool of worker threads executing short tasks
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// Include own header file first
+#include "askap/TaskScheduler.h"
+
+// System includes
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/tss.hpp>
+
+// ASKAPsoft includes
+#include "askap/AskapLogging.h"
+#include "askap/AskapError.h"
+
+// Using
+using namespace askap;
+
+ASKAP_LOGGER(logger, ".TaskScheduler");
+
+namespace {
+
+/// @brief identity of a worker thread
+struct WorkerId {
+    const TaskScheduler* owner;
+    int index;
+};
+
+/// @brief set in worker threads only
+boost::thread_specific_ptr<WorkerId> theWorkerId;
+
+/// @brief first non-negative integer given by the listed environment variables
+/// @param[in] names names of the variables, terminated by a null pointer
+/// @param[in] fallback value returned if none of the variables is set
+int intFromEnv(const char* const* names, int fallback)
+{
+    for (; *names != 0; ++names) {
+        const char* env = std::getenv(*names);
+        if ((env != 0) && (*env != '\0')) {
+            const int value = std::atoi(env);
+            if (value >= 0) {
+                return value;
+            }
+        }
+    }
+    return fallback;
+}
+
+/// @brief variables set by the MPI launchers (Open MPI, MPICH/Hydra, Slurm)
+const char* const theLocalSizeVars[] = {"OMPI_COMM_WORLD_LOCAL_SIZE", "MPI_LOCALNRANKS",
+                                        "SLURM_NTASKS_PER_NODE", 0};
+const char* const theLocalRankVars[] = {"OMPI_COMM_WORLD_LOCAL_RANK", "MPI_LOCALRANKID",
+                                        "SLURM_LOCALID", 0};
+const char* const theNThreadsVars[] = {"ASKAP_NTHREADS", 0};
+const char* const thePinVars[] = {"ASKAP_PIN_THREADS", 0};
+
+/// @brief parse the cpulist format used by sysfs, e.g. "0-7,16-23"
+std::vector<int> parseCpuList(const std::string& list)
+{
+    std::vector<int> result;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        const std::string::size_type dash = range.find('-');
+        const int first = std::atoi(range.substr(0, dash).c_str());
+        const int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int cpu = first; cpu <= last; ++cpu) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TaskScheduler::TaskGroup::TaskGroup(TaskScheduler& scheduler) :
+        itsScheduler(scheduler), itsPending(0)
+{
+}
+
+TaskScheduler::TaskGroup::~TaskGroup()
+{
+    try {
+        wait();
+    } catch (const std::exception& ex) {
+        ASKAPLOG_ERROR_STR(logger, "Task failed: " << ex.what());
+    }
+}
+
+void TaskScheduler::TaskGroup::run(const Task& task, const std::string& type)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(itsMutex);
+        ++itsPending;
+    }
+    Job job;
+    job.task = task;
+    job.group = this;
+    job.type = type;
+    itsScheduler.submit(job);
+}
+
+void TaskScheduler::TaskGroup::wait()
+{
+    while (true) {
+        {
+            boost::lock_guard<boost::mutex> lock(itsMutex);
+            if (itsPending == 0) {
+                break;
+            }
+        }
+        // help with the queued work instead of blocking
+        if (!itsScheduler.tryRunOne()) {
+            boost::unique_lock<boost::mutex> lock(itsMutex);
+            if (itsPending > 0) {
+                // the timeout allows us to pick up tasks queued in the meantime
+                itsCondition.timed_wait(lock, boost::posix_time::milliseconds(1));
+            }
+        }
+    }
+    std::string error;
+    {
+        boost::lock_guard<boost::mutex> lock(itsMutex);
+        error.swap(itsError);
+    }
+    if (!error.empty()) {
+        ASKAPTHROW(AskapError, "Task failed: " << error);
+    }
+}
+
+void TaskScheduler::TaskGroup::taskDone(const std::string& error)
+{
+    boost::lock_guard<boost::mutex> lock(itsMutex);
+    if (!error.empty() && itsError.empty()) {
+        itsError = error;
+    }
+    ASKAPDEBUGASSERT(itsPending > 0);
+    --itsPending;
+    if (itsPending == 0) {
+        itsCondition.notify_all();
+    }
+}
+
+TaskScheduler::TaskScheduler(size_t nThreads, bool pin) :
+        itsQueuedJobs(0), itsStopping(false), itsNextQueue(0), itsBudget(1)
+{
+    start(nThreads, pin, 0);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    stop();
+}
+
+TaskScheduler& TaskScheduler::instance()
+{
+    static TaskScheduler scheduler(0, defaultPinning());
+    return scheduler;
+}
+
+size_t TaskScheduler::ranksPerNode()
+{
+    return static_cast<size_t>(std::max(1, intFromEnv(theLocalSizeVars, 1)));
+}
+
+size_t TaskScheduler::localRank()
+{
+    return static_cast<size_t>(intFromEnv(theLocalRankVars, 0));
+}
+
+size_t TaskScheduler::defaultThreadBudget()
+{
+    const int nThreads = intFromEnv(theNThreadsVars, 0);
+    if (nThreads > 0) {
+        return static_cast<size_t>(nThreads);
+    }
+    // share the cores of the node between the ranks running on it
+    const size_t hwThreads = boost::thread::hardware_concurrency();
+    return std::max(size_t(1), hwThreads / ranksPerNode());
+}
+
+bool TaskScheduler::defaultPinning()
+{
+    return intFromEnv(thePinVars, 0) > 0;
+}
+
+void TaskScheduler::setThreadBudget(size_t nThreads, bool pin, size_t cpuOffset)
+{
+    ASKAPCHECK(currentWorker() < 0, "Thread budget cannot be changed from a task");
+    stop();
+    start(nThreads, pin, cpuOffset);
+}
+
+size_t TaskScheduler::threadBudget() const
+{
+    return itsBudget;
+}
+
+void TaskScheduler::start(size_t nThreads, bool pin, size_t cpuOffset)
+{
+    itsBudget = nThreads > 0 ? nThreads : defaultThreadBudget();
+    // the thread waiting for the results executes tasks too
+    const size_t nWorkers = itsBudget - 1;
+    {
+        boost::lock_guard<boost::mutex> lock(itsSleepMutex);
+        itsStopping = false;
+        itsQueuedJobs = 0;
+        itsNextQueue = 0;
+    }
+    itsQueues.resize(nWorkers);
+    for (size_t i = 0; i < nWorkers; ++i) {
+        itsQueues[i].reset(new WorkQueue);
+    }
+    const std::vector<int> cpus = pin ? spreadCpus() : std::vector<int>();
+    if (pin && (cpuOffset == 0)) {
+        // ranks sharing the node get disjoint sets of cores
+        cpuOffset = localRank() * itsBudget;
+    }
+    for (size_t i = 0; i < nWorkers; ++i) {
+        const int cpu = cpus.size() > 0 ? cpus[(i + cpuOffset) % cpus.size()] : -1;
+        itsThreads.push_back(boost::shared_ptr<boost::thread>(
+                new boost::thread(boost::bind(&TaskScheduler::workerLoop, this, int(i), cpu))));
+    }
+    if (nWorkers > 0) {
+        ASKAPLOG_DEBUG_STR(logger, "Started " << nWorkers << " worker threads" <<
+                           (cpus.size() > 0 ? " pinned to cores" : ""));
+    }
+}
+
+void TaskScheduler::stop()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(itsSleepMutex);
+        itsStopping = true;
+    }
+    itsWakeUp.notify_all();
+    for (size_t i = 0; i < itsThreads.size(); ++i) {
+        itsThreads[i]->join();
+    }
+    itsThreads.clear();
+    itsQueues.clear();
+}
+
+void TaskScheduler::submit(const Job& job)
+{
+    if (itsQueues.size() == 0) {
+        // no workers, execute in place
+        Job inPlace(job);
+        execute(inPlace);
+        return;
+    }
+    const int self = currentWorker();
+    size_t queue = 0;
+    {
+        // the counter is incremented before the job becomes visible, so it never underflows
+        boost::lock_guard<boost::mutex> lock(itsSleepMutex);
+        ++itsQueuedJobs;
+        if (self < 0) {
+            queue = itsNextQueue;
+            itsNextQueue = (itsNextQueue + 1) % itsQueues.size();
+        } else {
+            queue = static_cast<size_t>(self);
+        }
+    }
+    {
+        boost::lock_guard<boost::mutex> lock(itsQueues[queue]->mutex);
+        itsQueues[queue]->jobs.push_back(job);
+    }
+    itsWakeUp.notify_one();
+}
+
+bool TaskScheduler::popJob(int self, Job& job)
+{
+    const size_t nQueues = itsQueues.size();
+    if (nQueues == 0) {
+        return false;
+    }
+    bool found = false;
+    // own queue first, the most recent job is likely to have its data in cache
+    if (self >= 0) {
+        WorkQueue& own = *itsQueues[self];
+        boost::lock_guard<boost::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    // steal the oldest job from somebody else
+    const size_t start = self >= 0 ? size_t(self) + 1 : 0;
+    for (size_t i = 0; (i < nQueues) && !found; ++i) {
+        WorkQueue& other = *itsQueues[(start + i) % nQueues];
+        boost::lock_guard<boost::mutex> lock(other.mutex);
+        if (!other.jobs.empty()) {
+            job = other.jobs.front();
+            other.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (found) {
+        boost::lock_guard<boost::mutex> lock(itsSleepMutex);
+        ASKAPDEBUGASSERT(itsQueuedJobs > 0);
+        --itsQueuedJobs;
+    }
+    return found;
+}
+
+bool TaskScheduler::tryRunOne()
+{
+    Job job;
+    if (popJob(currentWorker(), job)) {
+        execute(job);
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::execute(Job& job)
+{
+    std::string error;
+    const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::universal_time();
+    try {
+        job.task();
+    } catch (const std::exception& ex) {
+        error = ex.what();
+        if (error.empty()) {
+            error = "unknown error";
+        }
+    } catch (...) {
+        error = "unknown exception";
+    }
+    const double elapsed = (boost::posix_time::microsec_clock::universal_time() - startTime).total_microseconds() * 1e-6;
+    {
+        boost::lock_guard<boost::mutex> lock(itsStatsMutex);
+        TaskStats& stats = itsStats[job.type];
+        ++stats.count;
+        stats.totalTime += elapsed;
+        stats.maxTime = std::max(stats.maxTime, elapsed);
+    }
+    ASKAPDEBUGASSERT(job.group != 0);
+    job.group->taskDone(error);
+}
+
+void TaskScheduler::workerLoop(int index, int cpu)
+{
+    WorkerId* id = new WorkerId;
+    id->owner = this;
+    id->index = index;
+    theWorkerId.reset(id);
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0) {
+            ASKAPLOG_WARN_STR(logger, "Unable to pin worker " << index << " to core " << cpu);
+        }
+    }
+#endif
+    while (true) {
+        Job job;
+        if (popJob(index, job)) {
+            execute(job);
+            continue;
+        }
+        boost::unique_lock<boost::mutex> lock(itsSleepMutex);
+        while (!itsStopping && (itsQueuedJobs == 0)) {
+            itsWakeUp.wait(lock);
+        }
+        if (itsStopping && (itsQueuedJobs == 0)) {
+            break;
+        }
+    }
+}
+
+int TaskScheduler::currentWorker() const
+{
+    const WorkerId* id = theWorkerId.get();
+    return (id != 0) && (id->owner == this) ? id->index : -1;
+}
+
+std::vector<int> TaskScheduler::spreadCpus()
+{
+    // cores of each NUMA node
+    std::vector<std::vector<int> > nodes;
+#ifdef __linux__
+    for (int node = 0; ; ++node) {
+        std::ostringstream fname;
+        fname << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream is(fname.str().c_str());
+        if (!is) {
+            break;
+        }
+        std::string list;
+        std::getline(is, list);
+        const std::vector<int> cpus = parseCpuList(list);
+        if (cpus.size() > 0) {
+            nodes.push_back(cpus);
+        }
+    }
+#endif
+    if (nodes.size() == 0) {
+        // no topology information, assume a single node
+        nodes.resize(1);
+        const unsigned int hwThreads = boost::thread::hardware_concurrency();
+        for (unsigned int cpu = 0; cpu < hwThreads; ++cpu) {
+            nodes[0].push_back(int(cpu));
+        }
+    }
+    // interleave the nodes, so consecutive workers end up on different nodes
+    std::vector<int> result;
+    for (size_t i = 0; ; ++i) {
+        bool added = false;
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            if (i < nodes[node].size()) {
+                result.push_back(nodes[node][i]);
+                added = true;
+            }
+        }
+        if (!added) {
+            break;
+        }
+    }
+    return result;
+}
+
+void TaskScheduler::parallelFor(size_t begin, size_t end, const RangeTask& body,
+                                const std::string& type, size_t grain)
+{
+    if (end <= begin) {
+        return;
+    }
+    const size_t size = end - begin;
+    if (grain == 0) {
+        // a few chunks per thread to balance the load
+        grain = std::max(size_t(1), size / (4 * itsBudget));
+    }
+    if ((itsBudget == 1) || (grain >= size)) {
+        body(begin, end);
+        return;
+    }
+    TaskGroup group(*this);
+    for (size_t chunk = begin; chunk < end; chunk += grain) {
+        group.run(boost::bind(body, chunk, std::min(chunk + grain, end)), type);
+    }
+    group.wait();
+}
+
+std::map<std::string, TaskScheduler::TaskStats> TaskScheduler::statistics() const
+{
+    boost::lock_guard<boost::mutex> lock(itsStatsMutex);
+    return itsStats;
+}
+
+void TaskScheduler::resetStatistics()
+{
+    boost::lock_guard<boost::mutex> lock(itsStatsMutex);
+    itsStats.clear();
+}
+
+void TaskScheduler::logStatistics() const
+{
+    const std::map<std::string, TaskStats> stats = statistics();
+    ASKAPLOG_INFO_STR(logger, "Task statistics for the thread budget of " << itsBudget << ":");
+    for (std::map<std::string, TaskStats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        ASKAPLOG_INFO_STR(logger, "   " << it->first << ": " << it->second.count << " tasks, total " <<
+                          it->second.totalTime << " s, mean " <<
+                          (it->second.count > 0 ? it->second.totalTime / it->second.count : 0.) <<
+                          " s, max " << it->second.maxTime << " s");
+    }
+}
@@ -0,0 +1,283 @@
+/// @file TaskScheduler.h
+/// @brief Process-wide pool of worker threads executing short tasks
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_TASKSCHEDULER_H
+#define ASKAP_TASKSCHEDULER_H
+
+// System includes
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace askap {
+
+    /// @brief Process-wide pool of worker threads executing short tasks
+    /// @details All parallel stages of a process (gridding, FFTs, deconvolution)
+    /// are expected to submit their work here rather than to create threads of
+    /// their own. Then a single thread budget per process (i.e. per MPI rank)
+    /// controls the total number of busy cores, and stages running at the same
+    /// time share the workers instead of oversubscribing the node.
+    ///
+    /// Each worker has its own queue. A task submitted from a worker goes to that
+    /// worker's queue and is executed last-in first-out. Idle workers steal the
+    /// oldest tasks from the other queues. A thread waiting for a TaskGroup
+    /// executes queued tasks in the meantime. So nested parallelism does not
+    /// deadlock, and the calling thread counts towards the budget.
+    ///
+    /// The thread budget is taken from the ASKAP_NTHREADS environment variable.
+    /// If it is not set, the hardware threads are shared evenly between the ranks
+    /// running on the node (as reported by the MPI launcher). Applications can
+    /// change it with setThreadBudget. A budget of 1 means all tasks are executed
+    /// by the calling thread. Workers can optionally be pinned to cores (set
+    /// ASKAP_PIN_THREADS=1 or use setThreadBudget). They are then spread evenly
+    /// across NUMA nodes, ranks sharing a node get different cores (Linux only).
+    ///
+    /// Execution time is accumulated for each task type, to help choose how
+    /// many ranks and threads to run on a node.
+    class TaskScheduler : private boost::noncopyable {
+        public:
+            /// @brief task to execute
+            typedef boost::function<void()> Task;
+
+            /// @brief body of a parallel loop, called with a sub-range [begin, end)
+            typedef boost::function<void(size_t, size_t)> RangeTask;
+
+            /// @brief accumulated statistics for one task type
+            struct TaskStats {
+                TaskStats() : count(0), totalTime(0.), maxTime(0.) {}
+
+                /// @brief number of tasks executed
+                unsigned long count;
+
+                /// @brief total execution time in seconds
+                double totalTime;
+
+                /// @brief longest execution time in seconds
+                double maxTime;
+            };
+
+            /// @brief set of tasks which can be waited for
+            /// @details Errors in the tasks are caught and rethrown by wait as AskapError
+            /// (the message of the first error is used).
+            class TaskGroup : private boost::noncopyable {
+                public:
+                    /// @brief constructor
+                    /// @param[in] scheduler scheduler to execute tasks
+                    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance());
+
+                    /// @brief destructor, waits for all tasks of this group
+                    /// @details Errors are logged, not thrown.
+                    ~TaskGroup();
+
+                    /// @brief submit a task
+                    /// @param[in] task task to execute
+                    /// @param[in] type task type used for statistics
+                    void run(const Task& task, const std::string& type = "default");
+
+                    /// @brief wait until all submitted tasks are finished
+                    /// @details The calling thread executes queued tasks while waiting.
+                    void wait();
+
+                private:
+                    friend class TaskScheduler;
+
+                    /// @brief called by the scheduler when a task of this group has finished
+                    /// @param[in] error error message, empty if the task succeeded
+                    void taskDone(const std::string& error);
+
+                    /// @brief scheduler executing the tasks
+                    TaskScheduler& itsScheduler;
+
+                    /// @brief protects the data below
+                    boost::mutex itsMutex;
+
+                    /// @brief signalled when a task is finished
+                    boost::condition_variable itsCondition;
+
+                    /// @brief number of tasks submitted but not finished
+                    size_t itsPending;
+
+                    /// @brief message of the first error
+                    std::string itsError;
+            };
+
+            /// @brief constructor
+            /// @param[in] nThreads thread budget (0 means the default budget)
+            /// @param[in] pin if true, workers are pinned to cores
+            explicit TaskScheduler(size_t nThreads = 0, bool pin = false);
+
+            /// @brief destructor, stops all workers
+            ~TaskScheduler();
+
+            /// @brief scheduler shared by the whole process
+            /// @return reference to the scheduler
+            static TaskScheduler& instance();
+
+            /// @brief number of ranks running on this node
+            /// @details Taken from the environment set up by the MPI launcher (Open MPI,
+            /// MPICH or Slurm), 1 if it is not available.
+            /// @return number of processes sharing the node
+            static size_t ranksPerNode();
+
+            /// @brief index of this rank among the ranks running on this node
+            /// @return local rank, 0 if it is not available
+            static size_t localRank();
+
+            /// @brief default thread budget
+            /// @details ASKAP_NTHREADS, if set, otherwise the number of hardware threads
+            /// divided by the number of ranks per node.
+            /// @return number of threads
+            static size_t defaultThreadBudget();
+
+            /// @brief default pinning switch
+            /// @return true, if ASKAP_PIN_THREADS is set to a positive value
+            static bool defaultPinning();
+
+            /// @brief change the thread budget
+            /// @details Workers are restarted. This method must not be called while
+            /// tasks are being executed.
+            /// @param[in] nThreads total number of threads (including the waiting one), 0 means default
+            /// @param[in] pin if true, workers are pinned to cores spread across NUMA nodes
+            /// @param[in] cpuOffset first core to use for pinning, 0 means the offset is derived
+            /// from the local rank (so ranks sharing a node are separated)
+            void setThreadBudget(size_t nThreads, bool pin = false, size_t cpuOffset = 0);
+
+            /// @brief current thread budget
+            /// @return total number of threads executing tasks
+            size_t threadBudget() const;
+
+            /// @brief execute a loop in parallel
+            /// @details The range is split into chunks of at most grain elements and the
+            /// body is called for each chunk. The call returns when all chunks are done.
+            /// @param[in] begin first index
+            /// @param[in] end index past the last one
+            /// @param[in] body loop body
+            /// @param[in] type task type used for statistics
+            /// @param[in] grain chunk size, 0 means a few chunks per thread
+            void parallelFor(size_t begin, size_t end, const RangeTask& body,
+                             const std::string& type = "default", size_t grain = 0);
+
+            /// @brief obtain statistics accumulated so far
+            /// @return map of task type to statistics
+            std::map<std::string, TaskStats> statistics() const;
+
+            /// @brief reset statistics
+            void resetStatistics();
+
+            /// @brief write statistics to the log
+            void logStatistics() const;
+
+        private:
+            /// @brief queued task
+            struct Job {
+                Task task;
+                TaskGroup* group;
+                std::string type;
+            };
+
+            /// @brief queue of one worker
+            struct WorkQueue {
+                boost::mutex mutex;
+                std::deque<Job> jobs;
+            };
+
+            /// @brief start workers
+            void start(size_t nThreads, bool pin, size_t cpuOffset);
+
+            /// @brief stop and join all workers
+            void stop();
+
+            /// @brief queue a job or execute it in place if there are no workers
+            void submit(const Job& job);
+
+            /// @brief take one job from the queues and execute it
+            /// @return true if a job has been executed
+            bool tryRunOne();
+
+            /// @brief take a job from the queues
+            /// @param[in] self index of the calling worker or -1 for other threads
+            /// @param[out] job job taken
+            /// @return true if a job has been taken
+            bool popJob(int self, Job& job);
+
+            /// @brief execute a job and notify its group
+            void execute(Job& job);
+
+            /// @brief main loop of a worker
+            /// @param[in] index index of the worker
+            /// @param[in] cpu core to pin the worker to, negative means no pinning
+            void workerLoop(int index, int cpu);
+
+            /// @brief index of the calling worker of this scheduler, -1 for other threads
+            int currentWorker() const;
+
+            /// @brief cores ordered so that consecutive entries are on different NUMA nodes
+            static std::vector<int> spreadCpus();
+
+            /// @brief queues of the workers
+            std::vector<boost::shared_ptr<WorkQueue> > itsQueues;
+
+            /// @brief worker threads
+            std::vector<boost::shared_ptr<boost::thread> > itsThreads;
+
+            /// @brief protects itsQueuedJobs, itsStopping and itsNextQueue
+            boost::mutex itsSleepMutex;
+
+            /// @brief signalled when a job is queued or the workers are stopped
+            boost::condition_variable itsWakeUp;
+
+            /// @brief number of jobs in all queues
+            size_t itsQueuedJobs;
+
+            /// @brief true if workers are asked to stop
+            bool itsStopping;
+
+            /// @brief queue for the next job submitted by a thread which is not a worker
+            size_t itsNextQueue;
+
+            /// @brief thread budget
+            size_t itsBudget;
+
+            /// @brief protects itsStats
+            mutable boost::mutex itsStatsMutex;
+
+            /// @brief statistics per task type
+            std::map<std::string, TaskStats> itsStats;
+    };
+
+} // end namespace askap
+
+#endif
@@ -0,0 +1,482 @@
+/// @file
+/// @brief in-process metrics: counters, timers and histograms
+///
+/// @details Unlike the profile tree, which is reported once at the end of the run,
+/// metrics are meant to be collected continuously from production runs. They are
+/// accumulated per thread without locking and can be dumped periodically as
+/// lines of JSON into a file and/or a local datagram socket.
+///
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <profile/Metrics.h>
+#include <askap/AskapError.h>
+#include <askap/AskapLogging.h>
+
+// std includes
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// system includes
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// boost includes
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread_time.hpp>
+
+using namespace askap;
+
+ASKAP_LOGGER(logger, ".Metrics");
+
+namespace {
+
+/// @brief store a double in an integer slot
+inline boost::uint64_t toBits(double value)
+{
+   boost::uint64_t bits;
+   std::memcpy(&bits, &value, sizeof(bits));
+   return bits;
+}
+
+/// @brief extract a double from an integer slot
+inline double fromBits(boost::uint64_t bits)
+{
+   double value;
+   std::memcpy(&value, &bits, sizeof(value));
+   return value;
+}
+
+/// @brief write a string as a JSON string literal
+void writeJSONString(std::ostream &os, const std::string &str)
+{
+   os<<'"';
+   for (std::string::const_iterator ci = str.begin(); ci != str.end(); ++ci) {
+        if (*ci == '"' || *ci == '\\') {
+            os<<'\\'<<*ci;
+        } else if (static_cast<unsigned char>(*ci) < 0x20) {
+            os<<"\\u"<<std::hex<<std::setw(4)<<std::setfill('0')<<int(*ci)<<std::dec<<std::setfill(' ');
+        } else {
+            os<<*ci;
+        }
+   }
+   os<<'"';
+}
+
+/// @brief host name without the domain
+std::string hostName()
+{
+   char name[256];
+   name[sizeof(name) - 1] = '\0';
+   if (gethostname(name, sizeof(name) - 1) != 0) {
+       return "unknown";
+   }
+   const std::string host(name);
+   return host.substr(0, host.find('.'));
+}
+
+} // anonymous namespace
+
+/// @brief constructor of the thread block
+Metrics::ThreadBlock::ThreadBlock() : inUse(true)
+{
+   for (size_t slot = 0; slot < theirMaxSlots; ++slot) {
+        slots[slot].store(0, boost::memory_order_relaxed);
+   }
+}
+
+/// @brief constructor
+Metrics::Metrics() : itsNextSlot(0), itsThreadBlock(&Metrics::releaseBlock), itsStopping(false)
+{
+   itsMetrics.reserve(theirMaxMetrics);
+}
+
+/// @brief metrics shared by the whole process
+/// @details The object is never destroyed, so it can be used from destructors
+/// of other static objects and by threads finishing at exit.
+/// @return reference to the registry
+Metrics& Metrics::instance()
+{
+   static Metrics* theirInstance = new Metrics;
+   return *theirInstance;
+}
+
+/// @brief register a counter
+/// @details Registering an existing name returns the same identifier.
+/// @param[in] name name of the counter
+/// @return identifier of the counter
+Metrics::Id Metrics::counter(const std::string &name)
+{
+   return registerMetric(name, COUNTER, std::vector<double>());
+}
+
+/// @brief register a timer
+/// @details Registering an existing name returns the same identifier.
+/// @param[in] name name of the timer
+/// @return identifier of the timer
+Metrics::Id Metrics::timer(const std::string &name)
+{
+   return registerMetric(name, TIMER, std::vector<double>());
+}
+
+/// @brief register a histogram
+/// @details Registering an existing name returns the same identifier (edges are
+/// not compared).
+/// @param[in] name name of the histogram
+/// @param[in] edges bin edges in the increasing order
+/// @return identifier of the histogram
+Metrics::Id Metrics::histogram(const std::string &name, const std::vector<double> &edges)
+{
+   ASKAPCHECK(edges.size() > 0, "Histogram "<<name<<" should have at least one bin edge");
+   for (size_t i = 1; i < edges.size(); ++i) {
+        ASKAPCHECK(edges[i - 1] < edges[i], "Bin edges of histogram "<<name<<" should be increasing");
+   }
+   return registerMetric(name, HISTOGRAM, edges);
+}
+
+/// @brief register a metric
+/// @details Counters use one slot (the value). Timers use three: count,
+/// total time and maximum time. Histograms use two slots (count and sum) plus one per bin.
+Metrics::Id Metrics::registerMetric(const std::string &name, Type type, const std::vector<double> &edges)
+{
+   boost::lock_guard<boost::mutex> lock(itsMutex);
+   for (size_t id = 0; id < itsMetrics.size(); ++id) {
+        if (itsMetrics[id].name == name) {
+            ASKAPCHECK(itsMetrics[id].type == type, "Metric "<<name<<" is already registered with a different type");
+            return id;
+        }
+   }
+   const size_t nSlots = type == COUNTER ? 1 : (type == TIMER ? 3 : edges.size() + 3);
+   ASKAPCHECK(itsMetrics.size() < theirMaxMetrics, "Too many metrics, unable to register "<<name);
+   ASKAPCHECK(itsNextSlot + nSlots <= theirMaxSlots, "Too many metric values, unable to register "<<name);
+   MetricInfo info;
+   info.name = name;
+   info.type = type;
+   info.firstSlot = itsNextSlot;
+   info.edges = edges;
+   itsMetrics.push_back(info);
+   itsNextSlot += nSlots;
+   return itsMetrics.size() - 1;
+}
+
+/// @brief block of the calling thread
+/// @details A block is allocated on the first call in a thread
+Metrics::ThreadBlock& Metrics::block()
+{
+   ThreadBlock *blk = itsThreadBlock.get();
+   if (blk == 0) {
+       boost::lock_guard<boost::mutex> lock(itsMutex);
+       for (size_t i = 0; i < itsBlocks.size(); ++i) {
+            if (!itsBlocks[i]->inUse) {
+                blk = itsBlocks[i].get();
+                blk->inUse = true;
+                break;
+            }
+       }
+       if (blk == 0) {
+           itsBlocks.push_back(boost::shared_ptr<ThreadBlock>(new ThreadBlock));
+           blk = itsBlocks.back().get();
+       }
+       itsThreadBlock.reset(blk);
+   }
+   return *blk;
+}
+
+/// @brief called at thread exit to give the block back
+/// @details The values stay in the block and the next thread continues to add to them.
+void Metrics::releaseBlock(ThreadBlock *blk)
+{
+   boost::lock_guard<boost::mutex> lock(instance().itsMutex);
+   blk->inUse = false;
+}
+
+/// @brief increment a counter
+/// @param[in] id identifier of the counter
+/// @param[in] value increment
+void Metrics::add(Id id, boost::uint64_t value)
+{
+   ASKAPDEBUGASSERT(id < itsMetrics.size());
+   ASKAPDEBUGASSERT(itsMetrics[id].type == COUNTER);
+   // only this thread writes to the slot, so no read-modify-write operation is necessary
+   boost::atomic<boost::uint64_t> &slot = block().slots[itsMetrics[id].firstSlot];
+   slot.store(slot.load(boost::memory_order_relaxed) + value, boost::memory_order_relaxed);
+}
+
+/// @brief add a timed interval
+/// @param[in] id identifier of the timer
+/// @param[in] seconds duration of the interval
+void Metrics::addTime(Id id, double seconds)
+{
+   ASKAPDEBUGASSERT(id < itsMetrics.size());
+   ASKAPDEBUGASSERT(itsMetrics[id].type == TIMER);
+   boost::atomic<boost::uint64_t> *slots = block().slots + itsMetrics[id].firstSlot;
+   slots[0].store(slots[0].load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+   slots[1].store(toBits(fromBits(slots[1].load(boost::memory_order_relaxed)) + seconds), boost::memory_order_relaxed);
+   if (seconds > fromBits(slots[2].load(boost::memory_order_relaxed))) {
+       slots[2].store(toBits(seconds), boost::memory_order_relaxed);
+   }
+}
+
+/// @brief record a value in a histogram
+/// @param[in] id identifier of the histogram
+/// @param[in] value value to record
+void Metrics::record(Id id, double value)
+{
+   ASKAPDEBUGASSERT(id < itsMetrics.size());
+   const MetricInfo &info = itsMetrics[id];
+   ASKAPDEBUGASSERT(info.type == HISTOGRAM);
+   boost::atomic<boost::uint64_t> *slots = block().slots + info.firstSlot;
+   slots[0].store(slots[0].load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+   slots[1].store(toBits(fromBits(slots[1].load(boost::memory_order_relaxed)) + value), boost::memory_order_relaxed);
+   const size_t bin = std::upper_bound(info.edges.begin(), info.edges.end(), value) - info.edges.begin();
+   boost::atomic<boost::uint64_t> &binSlot = slots[2 + bin];
+   binSlot.store(binSlot.load(boost::memory_order_relaxed) + 1, boost::memory_order_relaxed);
+}
+
+/// @brief sum of an integer slot across all blocks
+boost::uint64_t Metrics::sumSlot(size_t slot) const
+{
+   boost::uint64_t result = 0;
+   for (size_t i = 0; i < itsBlocks.size(); ++i) {
+        result += itsBlocks[i]->slots[slot].load(boost::memory_order_relaxed);
+   }
+   return result;
+}
+
+/// @brief sum of a floating point slot across all blocks
+double Metrics::sumDoubleSlot(size_t slot) const
+{
+   double result = 0.;
+   for (size_t i = 0; i < itsBlocks.size(); ++i) {
+        result += fromBits(itsBlocks[i]->slots[slot].load(boost::memory_order_relaxed));
+   }
+   return result;
+}
+
+/// @brief maximum of a floating point slot across all blocks
+double Metrics::maxDoubleSlot(size_t slot) const
+{
+   double result = 0.;
+   for (size_t i = 0; i < itsBlocks.size(); ++i) {
+        result = std::max(result, fromBits(itsBlocks[i]->slots[slot].load(boost::memory_order_relaxed)));
+   }
+   return result;
+}
+
+/// @brief number of registered metrics
+size_t Metrics::size() const
+{
+   boost::lock_guard<boost::mutex> lock(itsMutex);
+   return itsMetrics.size();
+}
+
+/// @brief name of a metric
+/// @param[in] id identifier of the metric
+/// @return name used at registration
+std::string Metrics::name(Id id) const
+{
+   boost::lock_guard<boost::mutex> lock(itsMutex);
+   ASKAPCHECK(id < itsMetrics.size(), "Metric "<<id<<" is not registered");
+   return itsMetrics[id].name;
+}
+
+/// @brief obtain the value of a metric accumulated across all threads
+/// @param[in] id identifier of the metric
+/// @return accumulated value
+Metrics::Value Metrics::value(Id id) const
+{
+   boost::lock_guard<boost::mutex> lock(itsMutex);
+   ASKAPCHECK(id < itsMetrics.size(), "Metric "<<id<<" is not registered");
+   const MetricInfo &info = itsMetrics[id];
+   Value result;
+   result.type = info.type;
+   result.count = sumSlot(info.firstSlot);
+   if (info.type == TIMER) {
+       result.sum = sumDoubleSlot(info.firstSlot + 1);
+       result.max = maxDoubleSlot(info.firstSlot + 2);
+   } else if (info.type == HISTOGRAM) {
+       result.sum = sumDoubleSlot(info.firstSlot + 1);
+       result.edges = info.edges;
+       result.bins.resize(info.edges.size() + 1);
+       for (size_t bin = 0; bin < result.bins.size(); ++bin) {
+            result.bins[bin] = sumSlot(info.firstSlot + 2 + bin);
+       }
+   }
+   return result;
+}
+
+/// @brief write all metrics as a single line of JSON
+/// @details The line looks like
+/// {"time":1400000000.5,"host":"node1","pid":123,"metrics":{"gridder.grid":{"type":"timer","count":10,
+/// "total":1.5,"max":0.2},...}}
+/// @param[in] os stream to write to
+void Metrics::writeJSON(std::ostream &os) const
+{
+   struct timeval now;
+   gettimeofday(&now, 0);
+   std::ostringstream line;
+   line<<std::setprecision(15)<<"{\"time\":"<<double(now.tv_sec) + 1e-6 * now.tv_usec<<",\"host\":";
+   writeJSONString(line, hostName());
+   line<<",\"pid\":"<<int(getpid())<<",\"metrics\":{";
+   const size_t nMetrics = size();
+   for (Id id = 0; id < nMetrics; ++id) {
+        const Value val = value(id);
+        if (id > 0) {
+            line<<',';
+        }
+        writeJSONString(line, name(id));
+        if (val.type == COUNTER) {
+            line<<":{\"type\":\"counter\",\"value\":"<<val.count<<'}';
+        } else if (val.type == TIMER) {
+            line<<":{\"type\":\"timer\",\"count\":"<<val.count<<",\"total\":"<<val.sum<<",\"max\":"<<val.max<<'}';
+        } else {
+            line<<":{\"type\":\"histogram\",\"count\":"<<val.count<<",\"sum\":"<<val.sum<<",\"edges\":[";
+            for (size_t i = 0; i < val.edges.size(); ++i) {
+                 line<<(i > 0 ? "," : "")<<val.edges[i];
+            }
+            line<<"],\"bins\":[";
+            for (size_t i = 0; i < val.bins.size(); ++i) {
+                 line<<(i > 0 ? "," : "")<<val.bins[i];
+            }
+            line<<"]}";
+        }
+   }
+   line<<"}}";
+   os<<line.str()<<std::endl;
+}
+
+/// @brief start writing metrics periodically
+/// @details Reporting is restarted if it is already active.
+/// @param[in] fileName file to append lines to, empty string means no file. Any "%p"
+/// in the name is replaced by the process id, so ranks sharing a directory don't collide
+/// @param[in] interval time between two lines in seconds
+/// @param[in] socketPath unix domain datagram socket to send lines to, empty string means no socket
+void Metrics::startReporting(const std::string &fileName, double interval, const std::string &socketPath)
+{
+   ASKAPCHECK(interval > 0., "Metrics reporting interval should be positive, you have "<<interval);
+   stopReporting();
+   itsFileName = fileName;
+   const size_t pos = itsFileName.find("%p");
+   if (pos != std::string::npos) {
+       std::ostringstream pid;
+       pid<<int(getpid());
+       itsFileName.replace(pos, 2, pid.str());
+   }
+   if (itsFileName != "") {
+       // truncate the output of previous runs
+       std::ofstream os(itsFileName.c_str());
+       ASKAPCHECK(os, "Unable to open "<<itsFileName<<" to write metrics");
+   }
+   itsSocketPath = socketPath;
+   ASKAPCHECK(itsSocketPath.size() < sizeof(sockaddr_un().sun_path), "Socket path "<<itsSocketPath<<" is too long");
+   itsInterval = boost::posix_time::microseconds(static_cast<long>(interval * 1e6));
+   itsStopping = false;
+   ASKAPLOG_INFO_STR(logger, "Metrics will be written every "<<interval<<" s"<<
+                     (itsFileName != "" ? " to "+itsFileName : std::string())<<
+                     (itsSocketPath != "" ? " and sent to "+itsSocketPath : std::string()));
+   itsReportThread.reset(new boost::thread(boost::bind(&Metrics::reportLoop, this)));
+}
+
+/// @brief stop periodic reporting
+/// @details The final state of all metrics is written before this method returns.
+/// It does nothing if reporting is not active.
+void Metrics::stopReporting()
+{
+   if (itsReportThread) {
+       {
+          boost::lock_guard<boost::mutex> lock(itsReportMutex);
+          itsStopping = true;
+       }
+       itsReportCondition.notify_all();
+       itsReportThread->join();
+       itsReportThread.reset();
+       report();
+   }
+}
+
+/// @brief start periodic reporting if the parset asks for it
+/// @details Recognised keys are metrics.file, metrics.socket and metrics.interval
+/// (in seconds, 60 by default). Nothing is done if neither the file nor the socket is given.
+/// @param[in] parset parset to take the parameters from
+void Metrics::configure(const LOFAR::ParameterSet &parset)
+{
+   const std::string fileName = parset.getString("metrics.file", "");
+   const std::string socketPath = parset.getString("metrics.socket", "");
+   if (fileName != "" || socketPath != "") {
+       startReporting(fileName, parset.getDouble("metrics.interval", 60.), socketPath);
+   }
+}
+
+/// @brief main loop of the reporting thread
+void Metrics::reportLoop()
+{
+   boost::unique_lock<boost::mutex> lock(itsReportMutex);
+   while (!itsStopping) {
+      const boost::system_time deadline = boost::get_system_time() + itsInterval;
+      while (!itsStopping && itsReportCondition.timed_wait(lock, deadline)) {}
+      if (!itsStopping) {
+          lock.unlock();
+          report();
+          lock.lock();
+      }
+   }
+}
+
+/// @brief write one line to the configured outputs
+/// @details Errors are logged, but don't interrupt the application. The socket is
+/// non-blocking and nobody listening on it is not an error.
+void Metrics::report()
+{
+   std::ostringstream os;
+   writeJSON(os);
+   const std::string line = os.str();
+   if (itsFileName != "") {
+       std::ofstream file(itsFileName.c_str(), std::ios::app);
+       if (!file || !(file<<line<<std::flush)) {
+           ASKAPLOG_WARN_STR(logger, "Failed to write metrics to "<<itsFileName);
+       }
+   }
+   if (itsSocketPath != "") {
+       const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+       if (fd >= 0) {
+           sockaddr_un addr;
+           std::memset(&addr, 0, sizeof(addr));
+           addr.sun_family = AF_UNIX;
+           std::strncpy(addr.sun_path, itsSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+           if (sendto(fd, line.data(), line.size(), MSG_DONTWAIT,
+                      reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+               ASKAPLOG_DEBUG_STR(logger, "Failed to send metrics to "<<itsSocketPath<<": "<<std::strerror(errno));
+           }
+           close(fd);
+       }
+   }
+}
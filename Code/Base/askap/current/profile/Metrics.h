@@ -0,0 +1,321 @@
+/// @file
+/// @brief in-process metrics: counters, timers and histograms
+///
+/// @details Unlike the profile tree, which is reported once at the end of the run,
+/// metrics are meant to be collected continuously from production runs. They are
+/// accumulated per thread without locking and can be dumped periodically as
+/// lines of JSON into a file and/or a local datagram socket.
+///
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_METRICS_H
+#define ASKAP_METRICS_H
+
+// std includes
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+// LOFAR includes
+#include "Common/ParameterSet.h"
+
+namespace askap {
+
+/// @brief time a block of code with a timer metric
+/// @details The name should be a literal, the metric is registered on the first pass.
+#define ASKAPMETRICS_TIMER(name) \
+    static const askap::Metrics::Id askapMetricsTimerId = askap::Metrics::instance().timer(name); \
+    askap::ScopedTimer askapMetricsTimerGuard(askapMetricsTimerId);
+
+/// @brief increment a counter metric
+/// @details The name should be a literal, the metric is registered on the first pass.
+#define ASKAPMETRICS_COUNT(name, value) \
+    { \
+      static const askap::Metrics::Id askapMetricsCounterId = askap::Metrics::instance().counter(name); \
+      askap::Metrics::instance().add(askapMetricsCounterId, value); \
+    }
+
+/// @brief registry of counters, timers and histograms
+/// @details Metrics are registered by name once (typically into a static variable) and
+/// then updated via the returned identifier. Each thread accumulates values in a
+/// block of its own, which only this thread writes to. Therefore, updates are lock-free
+/// and don't involve any contended cache lines. Blocks of finished threads are reused
+/// by new threads, so the values are never lost. A snapshot sums the values across all
+/// blocks (it is consistent per value, but not necessarily across values).
+///
+/// A background thread can write the snapshot periodically as a single line of JSON
+/// into a file and/or send it as a datagram to a unix domain socket. The latter allows
+/// a monitoring process to follow a run without any HTTP stack in the application.
+/// @ingroup profile
+class Metrics : private boost::noncopyable {
+public:
+   /// @brief identifier of a registered metric
+   typedef size_t Id;
+
+   /// @brief type of a metric
+   enum Type {
+      COUNTER,
+      TIMER,
+      HISTOGRAM
+   };
+
+   /// @brief accumulated value of a metric
+   struct Value {
+      Value() : type(COUNTER), count(0), sum(0.), max(0.) {}
+
+      /// @brief type of the metric
+      Type type;
+
+      /// @brief counter value or number of timed intervals / recorded values
+      boost::uint64_t count;
+
+      /// @brief total time in seconds or sum of the recorded values
+      double sum;
+
+      /// @brief longest interval in seconds (timers only)
+      double max;
+
+      /// @brief bin edges (histograms only)
+      std::vector<double> edges;
+
+      /// @brief number of values in each bin (histograms only)
+      /// @details There is one more bin than edges. The first bin counts values
+      /// below the first edge and the last one counts values at or above the last edge.
+      std::vector<boost::uint64_t> bins;
+   };
+
+   /// @brief metrics shared by the whole process
+   /// @return reference to the registry
+   static Metrics& instance();
+
+   /// @brief register a counter
+   /// @details Registering an existing name returns the same identifier.
+   /// @param[in] name name of the counter
+   /// @return identifier of the counter
+   Id counter(const std::string &name);
+
+   /// @brief register a timer
+   /// @details Registering an existing name returns the same identifier.
+   /// @param[in] name name of the timer
+   /// @return identifier of the timer
+   Id timer(const std::string &name);
+
+   /// @brief register a histogram
+   /// @details Registering an existing name returns the same identifier (edges are
+   /// not compared).
+   /// @param[in] name name of the histogram
+   /// @param[in] edges bin edges in the increasing order
+   /// @return identifier of the histogram
+   Id histogram(const std::string &name, const std::vector<double> &edges);
+
+   /// @brief increment a counter
+   /// @param[in] id identifier of the counter
+   /// @param[in] value increment
+   void add(Id id, boost::uint64_t value = 1);
+
+   /// @brief add a timed interval
+   /// @param[in] id identifier of the timer
+   /// @param[in] seconds duration of the interval
+   void addTime(Id id, double seconds);
+
+   /// @brief record a value in a histogram
+   /// @param[in] id identifier of the histogram
+   /// @param[in] value value to record
+   void record(Id id, double value);
+
+   /// @brief number of registered metrics
+   size_t size() const;
+
+   /// @brief name of a metric
+   /// @param[in] id identifier of the metric
+   /// @return name used at registration
+   std::string name(Id id) const;
+
+   /// @brief obtain the value of a metric accumulated across all threads
+   /// @param[in] id identifier of the metric
+   /// @return accumulated value
+   Value value(Id id) const;
+
+   /// @brief write all metrics as a single line of JSON
+   /// @param[in] os stream to write to
+   void writeJSON(std::ostream &os) const;
+
+   /// @brief start writing metrics periodically
+   /// @details Reporting is restarted if it is already active.
+   /// @param[in] fileName file to append lines to, empty string means no file. Any "%p"
+   /// in the name is replaced by the process id, so ranks sharing a directory don't collide
+   /// @param[in] interval time between two lines in seconds
+   /// @param[in] socketPath unix domain datagram socket to send lines to, empty string means no socket
+   void startReporting(const std::string &fileName, double interval,
+                       const std::string &socketPath = std::string());
+
+   /// @brief stop periodic reporting
+   /// @details The final state of all metrics is written before this method returns.
+   /// It does nothing if reporting is not active.
+   void stopReporting();
+
+   /// @brief start periodic reporting if the parset asks for it
+   /// @details Recognised keys are metrics.file, metrics.socket and metrics.interval
+   /// (in seconds, 60 by default). Nothing is done if neither the file nor the socket is given.
+   /// @param[in] parset parset to take the parameters from
+   void configure(const LOFAR::ParameterSet &parset);
+
+private:
+   /// @brief maximum number of metrics
+   static const size_t theirMaxMetrics = 512;
+
+   /// @brief number of 64-bit values available in a block
+   static const size_t theirMaxSlots = 4096;
+
+   /// @brief description of a registered metric
+   struct MetricInfo {
+      std::string name;
+      Type type;
+      size_t firstSlot;
+      std::vector<double> edges;
+   };
+
+   /// @brief values accumulated by a single thread
+   struct ThreadBlock {
+      ThreadBlock();
+
+      /// @brief values written by the owning thread only
+      boost::atomic<boost::uint64_t> slots[theirMaxSlots];
+
+      /// @brief true while a thread owns this block
+      bool inUse;
+   };
+
+   /// @brief constructor
+   Metrics();
+
+   /// @brief register a metric
+   Id registerMetric(const std::string &name, Type type, const std::vector<double> &edges);
+
+   /// @brief block of the calling thread
+   /// @details A block is allocated on the first call in a thread
+   ThreadBlock& block();
+
+   /// @brief called at thread exit to give the block back
+   static void releaseBlock(ThreadBlock *blk);
+
+   /// @brief sum of an integer slot across all blocks
+   boost::uint64_t sumSlot(size_t slot) const;
+
+   /// @brief sum of a floating point slot across all blocks
+   double sumDoubleSlot(size_t slot) const;
+
+   /// @brief maximum of a floating point slot across all blocks
+   double maxDoubleSlot(size_t slot) const;
+
+   /// @brief main loop of the reporting thread
+   void reportLoop();
+
+   /// @brief write one line to the configured outputs
+   void report();
+
+   /// @brief registered metrics (capacity is reserved, so elements never move)
+   std::vector<MetricInfo> itsMetrics;
+
+   /// @brief next free slot
+   size_t itsNextSlot;
+
+   /// @brief all blocks ever allocated
+   std::vector<boost::shared_ptr<ThreadBlock> > itsBlocks;
+
+   /// @brief block of the current thread
+   boost::thread_specific_ptr<ThreadBlock> itsThreadBlock;
+
+   /// @brief protects registration and the list of blocks
+   mutable boost::mutex itsMutex;
+
+   /// @brief file to write lines to
+   std::string itsFileName;
+
+   /// @brief socket to send lines to
+   std::string itsSocketPath;
+
+   /// @brief reporting interval
+   boost::posix_time::time_duration itsInterval;
+
+   /// @brief true if the reporting thread is asked to stop
+   bool itsStopping;
+
+   /// @brief protects itsStopping
+   boost::mutex itsReportMutex;
+
+   /// @brief signalled to stop the reporting thread
+   boost::condition_variable itsReportCondition;
+
+   /// @brief reporting thread
+   boost::shared_ptr<boost::thread> itsReportThread;
+};
+
+/// @brief add the time spent in a scope to a timer metric
+/// @ingroup profile
+class ScopedTimer : private boost::noncopyable {
+public:
+   /// @brief constructor, starts timing
+   /// @param[in] id identifier of the timer
+   /// @param[in] metrics registry the timer belongs to
+   explicit ScopedTimer(Metrics::Id id, Metrics &metrics = Metrics::instance()) :
+         itsId(id), itsMetrics(metrics),
+         itsStart(boost::posix_time::microsec_clock::universal_time()) {}
+
+   /// @brief destructor, adds the time since construction
+   ~ScopedTimer() { itsMetrics.addTime(itsId, elapsed()); }
+
+   /// @brief time since construction
+   /// @return time in seconds
+   double elapsed() const {
+      return (boost::posix_time::microsec_clock::universal_time() - itsStart).total_microseconds() * 1e-6;
+   }
+
+private:
+   /// @brief identifier of the timer
+   const Metrics::Id itsId;
+
+   /// @brief registry to update
+   Metrics &itsMetrics;
+
+   /// @brief start time
+   const boost::posix_time::ptime itsStart;
+};
+
+} // namespace askap
+
+#endif // #ifndef ASKAP_METRICS_H
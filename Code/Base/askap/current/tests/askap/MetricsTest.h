@@ -0,0 +1,140 @@
+/// @file MetricsTest.h
+///
+/// @brief Tests of the Metrics class
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_METRICS_TEST_H
+#define ASKAP_METRICS_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "profile/Metrics.h"
+#include "askap/AskapError.h"
+
+namespace askap
+{
+  // metrics are process-wide, so every test uses names of its own
+  class MetricsTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(MetricsTest);
+    CPPUNIT_TEST(testCounter);
+    CPPUNIT_TEST(testTimer);
+    CPPUNIT_TEST(testHistogram);
+    CPPUNIT_TEST_EXCEPTION(testTypeMismatch, AskapError);
+    CPPUNIT_TEST(testJSON);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+
+    void testCounter() {
+        Metrics& metrics = Metrics::instance();
+        const Metrics::Id id = metrics.counter("test.counter");
+        CPPUNIT_ASSERT_EQUAL(id, metrics.counter("test.counter"));
+        CPPUNIT_ASSERT_EQUAL(std::string("test.counter"), metrics.name(id));
+        // blocks of finished threads are reused, values must survive
+        for (int pass = 0; pass < 2; ++pass) {
+             boost::thread_group threads;
+             for (int i = 0; i < 4; ++i) {
+                  threads.create_thread(boost::bind(&MetricsTest::increment, id, 1000));
+             }
+             threads.join_all();
+        }
+        increment(id, 5);
+        const Metrics::Value val = metrics.value(id);
+        CPPUNIT_ASSERT(val.type == Metrics::COUNTER);
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(8005), val.count);
+    }
+
+    void testTimer() {
+        Metrics& metrics = Metrics::instance();
+        const Metrics::Id id = metrics.timer("test.timer");
+        metrics.addTime(id, 0.5);
+        metrics.addTime(id, 1.5);
+        {
+           ScopedTimer timer(id);
+        }
+        const Metrics::Value val = metrics.value(id);
+        CPPUNIT_ASSERT(val.type == Metrics::TIMER);
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(3), val.count);
+        CPPUNIT_ASSERT(val.sum >= 2.);
+        CPPUNIT_ASSERT(val.sum < 2.5);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.5, val.max, 1e-10);
+    }
+
+    void testHistogram() {
+        Metrics& metrics = Metrics::instance();
+        std::vector<double> edges(2, 1.);
+        edges[1] = 10.;
+        const Metrics::Id id = metrics.histogram("test.histogram", edges);
+        metrics.record(id, 0.5);
+        metrics.record(id, 1.);
+        metrics.record(id, 5.);
+        metrics.record(id, 100.);
+        const Metrics::Value val = metrics.value(id);
+        CPPUNIT_ASSERT(val.type == Metrics::HISTOGRAM);
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(4), val.count);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(106.5, val.sum, 1e-10);
+        CPPUNIT_ASSERT_EQUAL(size_t(3), val.bins.size());
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(1), val.bins[0]);
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(2), val.bins[1]);
+        CPPUNIT_ASSERT_EQUAL(boost::uint64_t(1), val.bins[2]);
+    }
+
+    void testTypeMismatch() {
+        Metrics::instance().counter("test.mismatch");
+        Metrics::instance().timer("test.mismatch");
+    }
+
+    void testJSON() {
+        Metrics& metrics = Metrics::instance();
+        metrics.add(metrics.counter("test.json\"quoted"), 3);
+        std::ostringstream os;
+        metrics.writeJSON(os);
+        const std::string line = os.str();
+        // single line
+        CPPUNIT_ASSERT_EQUAL(line.size() - 1, line.find('\n'));
+        CPPUNIT_ASSERT(line.find("\"test.json\\\"quoted\":{\"type\":\"counter\",\"value\":3}") != std::string::npos);
+        CPPUNIT_ASSERT(line.find("\"metrics\":{") != std::string::npos);
+    }
+
+  private:
+
+    static void increment(Metrics::Id id, int times) {
+        for (int i = 0; i < times; ++i) {
+             Metrics::instance().add(id);
+        }
+    }
+
+  };
+
+} // namespace askap
+
+#endif // #ifndef
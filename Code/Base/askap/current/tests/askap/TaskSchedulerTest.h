@@ -0,0 +1,179 @@
+/// @file TaskSchedulerTest.h
+///
+/// @brief Tests of the TaskScheduler class
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_TASK_SCHEDULER_TEST_H
+#define ASKAP_TASK_SCHEDULER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "askap/TaskScheduler.h"
+#include "askap/AskapError.h"
+
+namespace askap
+{
+  class TaskSchedulerTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(TaskSchedulerTest);
+    CPPUNIT_TEST(testRun);
+    CPPUNIT_TEST(testInline);
+    CPPUNIT_TEST(testNested);
+    CPPUNIT_TEST_EXCEPTION(testError, AskapError);
+    CPPUNIT_TEST(testParallelFor);
+    CPPUNIT_TEST(testStatistics);
+    CPPUNIT_TEST(testDefaultBudget);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+
+    void tearDown() {
+        unsetenv("ASKAP_NTHREADS");
+        unsetenv("OMPI_COMM_WORLD_LOCAL_SIZE");
+    }
+
+    void testRun() {
+        TaskScheduler scheduler(4);
+        CPPUNIT_ASSERT_EQUAL(size_t(4), scheduler.threadBudget());
+        std::vector<int> result(100, 0);
+        TaskScheduler::TaskGroup group(scheduler);
+        for (size_t i = 0; i < result.size(); ++i) {
+             group.run(boost::bind(&TaskSchedulerTest::setValue, &result[i], int(i)));
+        }
+        group.wait();
+        for (size_t i = 0; i < result.size(); ++i) {
+             CPPUNIT_ASSERT_EQUAL(int(i), result[i]);
+        }
+    }
+
+    void testInline() {
+        TaskScheduler scheduler(1);
+        int value = 0;
+        TaskScheduler::TaskGroup group(scheduler);
+        group.run(boost::bind(&TaskSchedulerTest::setValue, &value, 5));
+        // no worker threads, so the task is done already
+        CPPUNIT_ASSERT_EQUAL(5, value);
+        group.wait();
+    }
+
+    void testNested() {
+        TaskScheduler scheduler(3);
+        boost::mutex mutex;
+        int counter = 0;
+        TaskScheduler::TaskGroup group(scheduler);
+        for (int i = 0; i < 10; ++i) {
+             group.run(boost::bind(&TaskSchedulerTest::spawn, boost::ref(scheduler),
+                       boost::ref(mutex), &counter));
+        }
+        group.wait();
+        CPPUNIT_ASSERT_EQUAL(100, counter);
+    }
+
+    void testError() {
+        TaskScheduler scheduler(2);
+        TaskScheduler::TaskGroup group(scheduler);
+        group.run(&TaskSchedulerTest::fail);
+        group.wait();
+    }
+
+    void testParallelFor() {
+        TaskScheduler scheduler(4);
+        std::vector<int> hits(1001, 0);
+        scheduler.parallelFor(0, hits.size(), boost::bind(&TaskSchedulerTest::mark, &hits, _1, _2), "loop", 7);
+        for (size_t i = 0; i < hits.size(); ++i) {
+             CPPUNIT_ASSERT_EQUAL(1, hits[i]);
+        }
+        // empty range is fine
+        scheduler.parallelFor(5, 5, boost::bind(&TaskSchedulerTest::mark, &hits, _1, _2));
+    }
+
+    void testStatistics() {
+        TaskScheduler scheduler(2);
+        std::vector<int> hits(10, 0);
+        scheduler.parallelFor(0, hits.size(), boost::bind(&TaskSchedulerTest::mark, &hits, _1, _2), "loop", 1);
+        std::map<std::string, TaskScheduler::TaskStats> stats = scheduler.statistics();
+        CPPUNIT_ASSERT_EQUAL(size_t(1), stats.size());
+        CPPUNIT_ASSERT_EQUAL(10ul, stats["loop"].count);
+        CPPUNIT_ASSERT(stats["loop"].maxTime <= stats["loop"].totalTime);
+        scheduler.resetStatistics();
+        CPPUNIT_ASSERT_EQUAL(size_t(0), scheduler.statistics().size());
+    }
+
+    void testDefaultBudget() {
+        unsetenv("ASKAP_NTHREADS");
+        setenv("OMPI_COMM_WORLD_LOCAL_SIZE", "1", 1);
+        const size_t wholeNode = TaskScheduler::defaultThreadBudget();
+        CPPUNIT_ASSERT(wholeNode >= 1);
+        // the cores are shared between the ranks on the node
+        setenv("OMPI_COMM_WORLD_LOCAL_SIZE", "2", 1);
+        CPPUNIT_ASSERT_EQUAL(size_t(2), TaskScheduler::ranksPerNode());
+        CPPUNIT_ASSERT_EQUAL(std::max(size_t(1), wholeNode / 2), TaskScheduler::defaultThreadBudget());
+        // explicit setting takes precedence
+        setenv("ASKAP_NTHREADS", "3", 1);
+        CPPUNIT_ASSERT_EQUAL(size_t(3), TaskScheduler::defaultThreadBudget());
+        TaskScheduler scheduler;
+        CPPUNIT_ASSERT_EQUAL(size_t(3), scheduler.threadBudget());
+    }
+
+  private:
+
+    static void setValue(int* target, int value) {
+        *target = value;
+    }
+
+    static void increment(boost::mutex* mutex, int* counter) {
+        boost::lock_guard<boost::mutex> lock(*mutex);
+        ++(*counter);
+    }
+
+    static void spawn(TaskScheduler& scheduler, boost::mutex& mutex, int* counter) {
+        TaskScheduler::TaskGroup group(scheduler);
+        for (int i = 0; i < 10; ++i) {
+             group.run(boost::bind(&TaskSchedulerTest::increment, &mutex, counter));
+        }
+        group.wait();
+    }
+
+    static void fail() {
+        ASKAPTHROW(AskapError, "Task error");
+    }
+
+    static void mark(std::vector<int>* hits, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+             ++(*hits)[i];
+        }
+    }
+
+  };
+
+} // namespace askap
+
+#endif // #ifndef
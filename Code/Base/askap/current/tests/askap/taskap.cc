@@ -33,6 +33,8 @@
 #include <SignalManagerTest.h>
 #include <SignalCounterTest.h>
 #include <IndexConverterTest.h>
+#include <TaskSchedulerTest.h>
+#include <MetricsTest.h>
 
 
 const double askap::AskapUtilTest::dblTolerance;
@@ -48,6 +50,8 @@ int main(int argc, char *argv[])
     runner.addTest(askap::SignalManagerTest::suite());
     runner.addTest(askap::SignalCounterTest::suite());
     runner.addTest(askap::utility::IndexConverterTest::suite());
+    runner.addTest(askap::TaskSchedulerTest::suite());
+    runner.addTest(askap::MetricsTest::suite());
 
     bool wasSucessful = runner.run();
 
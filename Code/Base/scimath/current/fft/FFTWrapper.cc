@@ -34,25 +34,24 @@
 // ASKAPsoft includes
 #include "askap/AskapError.h"
 #include "profile/AskapProfiler.h"
+#include "profile/Metrics.h"
 #include "casa/Arrays/Vector.h"
 #include "casa/Arrays/Matrix.h"
 #include "casa/Arrays/ArrayIter.h"
 #include "fftw3.h"
 
-#ifdef _OPENMP
 // boost include
 #include "boost/thread/mutex.hpp"
-#endif
 
 using namespace casa;
 
 namespace askap {
     namespace scimath {
 
-#ifdef _OPENMP
         /// @brief mutex to ensure thread safety in the calls to fft
+        /// @details Only the creation and destruction of plans need to be
+        /// serialised, executing a plan is thread-safe in FFTW.
         static boost::mutex fftWrapperMutex;
-#endif
 
         /**
          * Scale the array by 1/N were N is the total number of elements in
@@ -132,9 +131,6 @@ namespace askap {
         void fft(casa::Vector<casa::DComplex>& vec, const bool forward)
         {
             ASKAPTRACE("fft<casa::DComplex>");
-#ifdef _OPENMP
-            boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
-#endif
 
             Bool deleteIt;
             DComplex *dataPtr = vec.getStorage(deleteIt);
@@ -143,9 +139,13 @@ namespace askap {
             // rotate input because the origin for FFTW is at 0, not n/2 (casa fft)
             std::rotate(dataPtr, dataPtr + (nElements / 2), dataPtr + nElements);
 
-            fftw_plan p = fftw_plan_dft_1d(nElements, reinterpret_cast<fftw_complex*>(dataPtr),
-                                           reinterpret_cast<fftw_complex*>(dataPtr),
-                                           (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            fftw_plan p;
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                p = fftw_plan_dft_1d(nElements, reinterpret_cast<fftw_complex*>(dataPtr),
+                                     reinterpret_cast<fftw_complex*>(dataPtr),
+                                     (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            }
 
             fftw_execute(p);
 
@@ -157,15 +157,15 @@ namespace askap {
             std::rotate(dataPtr, dataPtr + (nElements / 2), dataPtr + nElements);
 
             vec.putStorage(dataPtr, deleteIt);
-            fftw_destroy_plan(p);
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                fftw_destroy_plan(p);
+            }
         }
 
         void fft(casa::Vector<casa::Complex>& vec, const bool forward)
         {
             ASKAPTRACE("fft<casa::Complex>");
-#ifdef _OPENMP
-            boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
-#endif
 
             Bool deleteIt;
             Complex *dataPtr = vec.getStorage(deleteIt);
@@ -174,9 +174,14 @@ namespace askap {
             // rotate input because the origin for FFTW is at 0, not n/2 (casa fft)
             std::rotate(dataPtr, dataPtr + (nElements / 2), dataPtr + nElements);
 
-            fftwf_plan p = fftwf_plan_dft_1d(nElements, reinterpret_cast<fftwf_complex*>(dataPtr),
-                                             reinterpret_cast<fftwf_complex*>(dataPtr),
-                                             (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            fftwf_plan p;
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                p = fftwf_plan_dft_1d(nElements, reinterpret_cast<fftwf_complex*>(dataPtr),
+                                      reinterpret_cast<fftwf_complex*>(dataPtr),
+                                      (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            }
+
             fftwf_execute(p);
 
             if (!forward) {
@@ -187,15 +192,16 @@ namespace askap {
             std::rotate(dataPtr, dataPtr + (nElements / 2), dataPtr + nElements);
 
             vec.putStorage(dataPtr, deleteIt);
-            fftwf_destroy_plan(p);
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                fftwf_destroy_plan(p);
+            }
         }
 
         void fft2d(casa::Array<casa::Complex>& arr, const bool forward)
         {
             ASKAPTRACE("fft2d<casa::Complex>");
-#ifdef _OPENMP
-            boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
-#endif
+            ASKAPMETRICS_TIMER("fft.fft2d");
 
             // 1: Make an iterator that returns plane by plane
             casa::ArrayIterator<casa::Complex> it(arr, 2);
@@ -207,8 +213,12 @@ namespace askap {
                 // 2: Setup a buffer and fft plan based on the size of the first column
                 size_t bufsz = mat.nrow();
                 fftwf_complex* buf = (fftwf_complex*) fftw_malloc(sizeof(fftwf_complex) * bufsz);
-                fftwf_plan p = fftwf_plan_dft_1d(bufsz, buf, buf,
-                                                 (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+                fftwf_plan p;
+                {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                    p = fftwf_plan_dft_1d(bufsz, buf, buf,
+                                          (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+                }
 
                 // 3: FFT each column
                 for (uInt col = 0; col < mat.ncolumn(); col++) {
@@ -219,10 +229,11 @@ namespace askap {
                 // 4: If the row are of different length to the rows then
                 // re-allocate buffer and regen the plan
                 if (mat.ncolumn() != mat.nrow()) {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
                     fftwf_destroy_plan(p);
                     fftwf_free(buf);
                     bufsz = mat.ncolumn();
-                    fftwf_complex* buf = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * bufsz);
+                    buf = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * bufsz);
                     p = fftwf_plan_dft_1d(bufsz, buf, buf,
                                           (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_MEASURE);
                 }
@@ -234,7 +245,10 @@ namespace askap {
                 }
 
                 // 6: Delete the plan and temporary buffer
-                fftwf_destroy_plan(p);
+                {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                    fftwf_destroy_plan(p);
+                }
                 fftwf_free(buf);
 
                 it.next();
@@ -244,9 +258,7 @@ namespace askap {
         void fft2d(casa::Array<casa::DComplex>& arr, const bool forward)
         {
             ASKAPTRACE("fft2d<casa::DComplex>");
-#ifdef _OPENMP
-            boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
-#endif
+            ASKAPMETRICS_TIMER("fft.fft2d");
 
             /// 1: Make an iterator that returns plane by plane
             casa::ArrayIterator<casa::DComplex> it(arr, 2);
@@ -258,8 +270,12 @@ namespace askap {
                 // 2: Setup a buffer and fft plan based on the size of the first column
                 size_t bufsz = mat.nrow();
                 fftw_complex* buf = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufsz);
-                fftw_plan p = fftw_plan_dft_1d(bufsz, buf, buf,
-                                               (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+                fftw_plan p;
+                {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                    p = fftw_plan_dft_1d(bufsz, buf, buf,
+                                         (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+                }
 
                 // 3: FFT each column
                 for (uInt col = 0; col < mat.ncolumn(); col++) {
@@ -270,10 +286,11 @@ namespace askap {
                 // 4: If the rows are of different length to the columns then
                 // re-allocate buffer and regen the plan
                 if (mat.ncolumn() != mat.nrow()) {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
                     fftw_destroy_plan(p);
                     fftw_free(buf);
                     bufsz = mat.ncolumn();
-                    fftw_complex* buf = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufsz);
+                    buf = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufsz);
                     p = fftw_plan_dft_1d(bufsz, buf, buf,
                                          (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_MEASURE);
                 }
@@ -285,11 +302,51 @@ namespace askap {
                 }
 
                 // 6: Delete the plan and temporary buffer
-                fftw_destroy_plan(p);
+                {
+                    boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                    fftw_destroy_plan(p);
+                }
                 fftw_free(buf);
 
                 it.next();
             }
         }
+
+        void fft1d(casa::Array<casa::DComplex>& arr, const bool forward)
+        {
+            ASKAPTRACE("fft1d<casa::DComplex>");
+            ASKAPMETRICS_TIMER("fft.fft1d");
+
+            if (arr.nelements() == 0) {
+                return;
+            }
+
+            // 1: Make an iterator that returns vector by vector
+            casa::ArrayIterator<casa::DComplex> it(arr, 1);
+
+            // 2: Setup a buffer and fft plan based on the length of the first axis
+            const size_t bufsz = arr.shape()(0);
+            fftw_complex* buf = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * bufsz);
+            fftw_plan p;
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                p = fftw_plan_dft_1d(bufsz, buf, buf,
+                                     (forward) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+            }
+
+            // 3: FFT each vector
+            while (!it.pastEnd()) {
+                casa::Vector<casa::DComplex> vec(it.array());
+                fftExec(vec, forward, p, buf, bufsz);
+                it.next();
+            }
+
+            // 4: Delete the plan and temporary buffer
+            {
+                boost::unique_lock<boost::mutex> lock(fftWrapperMutex);
+                fftw_destroy_plan(p);
+            }
+            fftw_free(buf);
+        }
     }
 }
@@ -62,6 +62,15 @@ namespace askap
         /// @param forward Forward transform?
         /// @ingroup fft
         void fft2d(casa::Array<casa::DComplex>& arr, const bool forward);
+
+        /// @brief FFT first axis only
+        /// @details All vectors along the first axis are transformed with the
+        /// same plan. This is one pass of fft2d, e.g. for a 2D transform of
+        /// an array distributed between processes.
+        /// @param arr Complex array
+        /// @param forward Forward transform?
+        /// @ingroup fft
+        void fft1d(casa::Array<casa::DComplex>& arr, const bool forward);
     }
 }
 #endif
@@ -237,6 +237,10 @@ struct ComplexDiffMatrix {
    /// parameters known for all elements of this matrix.
    inline parameter_iterator paramEnd() const;
    
+   /// @brief number of parameters known for all elements of this matrix
+   /// @return number of distinct parameters
+   inline size_t nParameters() const;
+   
    /// @brief checks whether a given parameter is conceptually real
    /// @details Some parameters are conceptually real. Underlying 
    /// ComplexDiff classes don't track derivatives by imaginary part
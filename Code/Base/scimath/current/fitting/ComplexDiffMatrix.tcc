@@ -338,6 +338,16 @@ inline ComplexDiffMatrix::parameter_iterator ComplexDiffMatrix::paramEnd() const
   return utility::mapKeyEnd(itsParameters);
 }
 
+/// @brief number of parameters known for all elements of this matrix
+/// @return number of distinct parameters
+inline size_t ComplexDiffMatrix::nParameters() const
+{
+  if (itsParameterMapInvalid) {
+      buildParameterMap();
+  }
+  return itsParameters.size();
+}
+
 /// @brief extract a block 
 /// @details This method extracts a range of columns.
 /// @param[in] startCol first column to extract
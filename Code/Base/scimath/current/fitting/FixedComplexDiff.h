@@ -0,0 +1,152 @@
+/// @file
+/// 
+/// @brief Autodifferentiation class with a fixed number of parameters
+/// @details This is a light-weight counterpart of ComplexDiff. Parameters are
+/// addressed by an integer index in the range [0,N) instead of a name and 
+/// derivatives are stored in fixed-size arrays. No memory allocation or map
+/// search is done in the arithmetic operations, which makes this class suitable 
+/// for inner loops (e.g. building normal equations for each channel). The names
+/// are resolved into indices once (see FixedComplexDiffMatrix).
+/// 
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+#ifndef FIXED_COMPLEX_DIFF_H
+#define FIXED_COMPLEX_DIFF_H
+
+// casa includes
+#include <casa/BasicSL/Complex.h>
+
+// std includes
+#include <cstddef>
+
+namespace askap {
+
+namespace scimath {
+
+/// @brief Autodifferentiation class with a fixed number of parameters
+/// @details This class works like ComplexDiff (derivatives are tracked by 
+/// real and imaginary part of each parameter), but parameters are addressed 
+/// by an integer index and the number of parameters is a template argument.
+/// Derivatives by the imaginary part of real parameters are kept as zeros.
+/// @ingroup fitting
+template<size_t N> struct FixedComplexDiff {
+  /// @brief default constructor -  a constant (0.,0.)
+  inline FixedComplexDiff();
+  
+  /// @brief construct a complex constant
+  /// @param[in] in a reference to input complex value
+  inline FixedComplexDiff(const casa::Complex &in);
+  
+  /// @brief construct a real constant
+  /// @param[in] in input real value
+  inline FixedComplexDiff(double in);
+  
+  /// @brief construct a complex parameter
+  /// @param[in] index parameter index (should be less than N)
+  /// @param[in] in a reference to input complex value
+  inline FixedComplexDiff(size_t index, const casa::Complex &in); 
+  
+  /// @brief construct a real parameter
+  /// @param[in] index parameter index (should be less than N)
+  /// @param[in] in input real value
+  inline FixedComplexDiff(size_t index, double in); 
+  
+  /// @brief obtain value
+  /// @return value of the function associated with this object
+  inline const casa::Complex& value() const { return itsValue; }
+  
+  /// @brief obtain derivatives by real part of the parameter
+  /// @param[in] index parameter index
+  /// @return value of the derivative by real part of the given parameter
+  inline const casa::Complex& derivRe(size_t index) const;
+  
+  /// @brief obtain derivatives by imaginary part of the parameter
+  /// @param[in] index parameter index
+  /// @return value of the derivative by imaginary part of the given parameter
+  inline const casa::Complex& derivIm(size_t index) const;
+  
+  /// @brief set value and derivatives for one parameter
+  /// @details This method is used to convert ComplexDiff objects.
+  /// @param[in] index parameter index
+  /// @param[in] derivRe derivative by real part 
+  /// @param[in] derivIm derivative by imaginary part
+  inline void setDerivatives(size_t index, const casa::Complex &derivRe,
+                             const casa::Complex &derivIm);
+  
+  /// @brief set value
+  /// @param[in] in new value
+  inline void setValue(const casa::Complex &in) { itsValue = in; }
+  
+  /// @brief add up another autodifferentiator
+  /// @param[in] other autodifferentiator to add up
+  inline void operator+=(const FixedComplexDiff<N> &other);
+
+  /// @brief multiply to another autodifferentiator
+  /// @param[in] other autodifferentiator to multiply this one to
+  inline void operator*=(const FixedComplexDiff<N> &other);
+  
+  /// @brief multiply to a constant
+  /// @param[in] other constant to multiply this object to
+  inline void operator*=(const casa::Complex &other);
+  
+  /// @brief complex conjugation in situ
+  inline void conjugate();
+  
+private:
+  /// @brief value
+  casa::Complex itsValue;
+  
+  /// @brief derivatives by real part of the parameters
+  casa::Complex itsDerivRe[N];
+  
+  /// @brief derivatives by imaginary part of the parameters
+  casa::Complex itsDerivIm[N];
+};
+
+/// @brief form a sum of two parts
+/// @param[in] in1 the first argument
+/// @param[in] in2 the second argument
+/// @return result of addition
+template<size_t N> inline FixedComplexDiff<N> operator+(const FixedComplexDiff<N> &in1,
+                                                       const FixedComplexDiff<N> &in2);
+
+/// @brief form a product of two parts
+/// @param[in] in1 the first argument
+/// @param[in] in2 the second argument
+/// @return result of multiplication
+template<size_t N> inline FixedComplexDiff<N> operator*(const FixedComplexDiff<N> &in1,
+                                                       const FixedComplexDiff<N> &in2);
+
+/// @brief form a conjugate of the object
+/// @param[in] in the object to conjugate
+/// @return conjugated object
+template<size_t N> inline FixedComplexDiff<N> conj(const FixedComplexDiff<N> &in);
+
+} // namespace scimath
+
+} // namespace askap
+
+#include <fitting/FixedComplexDiff.tcc>
+
+#endif // #ifndef FIXED_COMPLEX_DIFF_H
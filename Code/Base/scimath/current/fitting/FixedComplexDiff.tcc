@@ -0,0 +1,208 @@
+/// @file
+/// 
+/// @brief Autodifferentiation class with a fixed number of parameters
+/// @details This file contains the implementation of inline methods of
+/// the FixedComplexDiff template.
+/// 
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+#ifndef FIXED_COMPLEX_DIFF_TCC
+#define FIXED_COMPLEX_DIFF_TCC
+
+#include <askap/AskapError.h>
+
+namespace askap {
+
+namespace scimath {
+
+/// @brief default constructor -  a constant (0.,0.)
+template<size_t N> inline FixedComplexDiff<N>::FixedComplexDiff() : itsValue(0.,0.)
+{
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::Complex(0.,0.);
+       itsDerivIm[i] = casa::Complex(0.,0.);
+  }
+}
+  
+/// @brief construct a complex constant
+/// @param[in] in a reference to input complex value
+template<size_t N> inline FixedComplexDiff<N>::FixedComplexDiff(const casa::Complex &in) : itsValue(in)
+{
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::Complex(0.,0.);
+       itsDerivIm[i] = casa::Complex(0.,0.);
+  }
+}
+  
+/// @brief construct a real constant
+/// @param[in] in input real value
+template<size_t N> inline FixedComplexDiff<N>::FixedComplexDiff(double in) : itsValue(in,0.)
+{
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::Complex(0.,0.);
+       itsDerivIm[i] = casa::Complex(0.,0.);
+  }
+}
+  
+/// @brief construct a complex parameter
+/// @param[in] index parameter index (should be less than N)
+/// @param[in] in a reference to input complex value
+template<size_t N> inline FixedComplexDiff<N>::FixedComplexDiff(size_t index, const casa::Complex &in) : 
+              itsValue(in)
+{
+  ASKAPDEBUGASSERT(index < N);
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::Complex(0.,0.);
+       itsDerivIm[i] = casa::Complex(0.,0.);
+  }
+  itsDerivRe[index] = casa::Complex(1.,0.);
+  itsDerivIm[index] = casa::Complex(0.,1.);
+}
+  
+/// @brief construct a real parameter
+/// @param[in] index parameter index (should be less than N)
+/// @param[in] in input real value
+template<size_t N> inline FixedComplexDiff<N>::FixedComplexDiff(size_t index, double in) : 
+              itsValue(in,0.)
+{
+  ASKAPDEBUGASSERT(index < N);
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::Complex(0.,0.);
+       itsDerivIm[i] = casa::Complex(0.,0.);
+  }
+  itsDerivRe[index] = casa::Complex(1.,0.);
+}
+  
+/// @brief obtain derivatives by real part of the parameter
+/// @param[in] index parameter index
+/// @return value of the derivative by real part of the given parameter
+template<size_t N> inline const casa::Complex& FixedComplexDiff<N>::derivRe(size_t index) const
+{
+  ASKAPDEBUGASSERT(index < N);
+  return itsDerivRe[index];
+}
+  
+/// @brief obtain derivatives by imaginary part of the parameter
+/// @param[in] index parameter index
+/// @return value of the derivative by imaginary part of the given parameter
+template<size_t N> inline const casa::Complex& FixedComplexDiff<N>::derivIm(size_t index) const
+{
+  ASKAPDEBUGASSERT(index < N);
+  return itsDerivIm[index];
+}
+  
+/// @brief set value and derivatives for one parameter
+/// @param[in] index parameter index
+/// @param[in] derivRe derivative by real part 
+/// @param[in] derivIm derivative by imaginary part
+template<size_t N> inline void FixedComplexDiff<N>::setDerivatives(size_t index, 
+                   const casa::Complex &derivRe, const casa::Complex &derivIm)
+{
+  ASKAPDEBUGASSERT(index < N);
+  itsDerivRe[index] = derivRe;
+  itsDerivIm[index] = derivIm;
+}
+  
+/// @brief add up another autodifferentiator
+/// @param[in] other autodifferentiator to add up
+template<size_t N> inline void FixedComplexDiff<N>::operator+=(const FixedComplexDiff<N> &other)
+{
+  itsValue += other.itsValue;
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] += other.itsDerivRe[i];
+       itsDerivIm[i] += other.itsDerivIm[i];
+  }
+}
+
+/// @brief multiply to another autodifferentiator
+/// @param[in] other autodifferentiator to multiply this one to
+template<size_t N> inline void FixedComplexDiff<N>::operator*=(const FixedComplexDiff<N> &other)
+{
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = itsDerivRe[i] * other.itsValue + itsValue * other.itsDerivRe[i];
+       itsDerivIm[i] = itsDerivIm[i] * other.itsValue + itsValue * other.itsDerivIm[i];
+  }
+  itsValue *= other.itsValue;
+}
+  
+/// @brief multiply to a constant
+/// @param[in] other constant to multiply this object to
+template<size_t N> inline void FixedComplexDiff<N>::operator*=(const casa::Complex &other)
+{
+  itsValue *= other;
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] *= other;
+       itsDerivIm[i] *= other;
+  }
+}
+  
+/// @brief complex conjugation in situ
+template<size_t N> inline void FixedComplexDiff<N>::conjugate()
+{
+  itsValue = casa::conj(itsValue);
+  for (size_t i = 0; i < N; ++i) {
+       itsDerivRe[i] = casa::conj(itsDerivRe[i]);
+       itsDerivIm[i] = casa::conj(itsDerivIm[i]);
+  }
+}
+
+/// @brief form a sum of two parts
+/// @param[in] in1 the first argument
+/// @param[in] in2 the second argument
+/// @return result of addition
+template<size_t N> inline FixedComplexDiff<N> operator+(const FixedComplexDiff<N> &in1,
+                                                       const FixedComplexDiff<N> &in2)
+{
+  FixedComplexDiff<N> result(in1);
+  result += in2;
+  return result;
+}
+
+/// @brief form a product of two parts
+/// @param[in] in1 the first argument
+/// @param[in] in2 the second argument
+/// @return result of multiplication
+template<size_t N> inline FixedComplexDiff<N> operator*(const FixedComplexDiff<N> &in1,
+                                                       const FixedComplexDiff<N> &in2)
+{
+  FixedComplexDiff<N> result(in1);
+  result *= in2;
+  return result;
+}
+
+/// @brief form a conjugate of the object
+/// @param[in] in the object to conjugate
+/// @return conjugated object
+template<size_t N> inline FixedComplexDiff<N> conj(const FixedComplexDiff<N> &in)
+{
+  FixedComplexDiff<N> result(in);
+  result.conjugate();
+  return result;
+}
+
+} // namespace scimath
+
+} // namespace askap
+
+#endif // #ifndef FIXED_COMPLEX_DIFF_TCC
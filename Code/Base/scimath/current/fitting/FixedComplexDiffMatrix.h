@@ -0,0 +1,152 @@
+/// @file
+/// 
+/// @brief A matrix of FixedComplexDiff classes
+/// @details This class is an integer-indexed counterpart of ComplexDiffMatrix.
+/// It is either filled directly by the measurement equation components (parameter
+/// names are resolved into indices once per matrix) or converted from a ComplexDiffMatrix.
+/// Normal equations can then be built from this matrix for many cross-products 
+/// (e.g. all spectral channels) without searching parameter maps in the inner loops.
+/// 
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+#ifndef FIXED_COMPLEX_DIFF_MATRIX_H
+#define FIXED_COMPLEX_DIFF_MATRIX_H
+
+// std includes
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// own includes
+#include <fitting/FixedComplexDiff.h>
+#include <fitting/ComplexDiffMatrix.h>
+
+namespace askap {
+
+namespace scimath {
+
+/// @brief A matrix of FixedComplexDiff classes
+/// @details The number of parameters, N, is the capacity of the autodifferentiator.
+/// The actual number of parameters known to the matrix (nParameters) can be smaller,
+/// derivatives by the unused indices are zero. Parameters are indexed in the order
+/// they are added to the matrix (or returned by ComplexDiffMatrix::paramBegin, i.e. sorted 
+/// by name, if the matrix is converted).
+/// @ingroup fitting
+template<size_t N> struct FixedComplexDiffMatrix {
+   /// @brief convert a ComplexDiffMatrix
+   /// @details An exception is thrown if the input matrix has more than N parameters.
+   /// @param[in] cdm input matrix
+   explicit FixedComplexDiffMatrix(const ComplexDiffMatrix &cdm);
+   
+   /// @brief construct a matrix filled with a constant
+   /// @details Parameters are added by the parameter method when the elements are set.
+   /// @param[in] nrow number of rows
+   /// @param[in] ncol number of columns
+   /// @param[in] val value for all elements
+   FixedComplexDiffMatrix(size_t nrow, size_t ncol, const casa::Complex &val = casa::Complex(0.,0.));
+   
+   /// @brief obtain number of rows
+   /// @return the number of rows
+   inline size_t nRow() const { return itsNRows;}
+   
+   /// @brief obtain number of columns
+   /// @return the number of columns
+   inline size_t nColumn() const {return itsNColumns;}
+   
+   /// @brief read-only access to given matrix element
+   /// @param[in] row row index
+   /// @param[in] col column index
+   /// @return reference to the element
+   inline const FixedComplexDiff<N>& operator()(size_t row, size_t col) const;
+
+   /// @brief read-write access to given matrix element
+   /// @param[in] row row index
+   /// @param[in] col column index
+   /// @return reference to the element
+   inline FixedComplexDiff<N>& operator()(size_t row, size_t col);
+   
+   /// @brief obtain index of a parameter
+   /// @details A new index is assigned if the parameter is not yet known to this matrix.
+   /// An exception is thrown if this would exceed N parameters.
+   /// @param[in] name parameter name
+   /// @param[in] isReal true if the parameter is always real
+   /// @return parameter index
+   size_t parameterIndex(const std::string &name, bool isReal = false);
+   
+   /// @brief obtain a complex parameter
+   /// @details This method resolves the name into an index (see parameterIndex) and 
+   /// returns an autodifferentiator for the parameter, which can be used to set the elements.
+   /// @param[in] name parameter name
+   /// @param[in] value value of the parameter
+   /// @return autodifferentiator representing the parameter
+   inline FixedComplexDiff<N> parameter(const std::string &name, const casa::Complex &value)
+          { return FixedComplexDiff<N>(parameterIndex(name), value); }
+   
+   /// @brief number of parameters known to this matrix
+   /// @return number of parameters (not exceeding N)
+   inline size_t nParameters() const { return itsNames.size(); }
+   
+   /// @brief name of the given parameter
+   /// @param[in] index parameter index
+   /// @return parameter name
+   inline const std::string& parameterName(size_t index) const;
+   
+   /// @brief checks whether a given parameter is conceptually real
+   /// @param[in] index parameter index
+   /// @return true if the given parameter is always real
+   inline bool isReal(size_t index) const;
+   
+private:
+   /// @brief number of rows 
+   size_t itsNRows;
+   
+   /// @brief number of columns
+   size_t itsNColumns;
+   
+   /// @brief flattened storage for the matrix elements
+   std::vector<FixedComplexDiff<N> > itsElements;
+   
+   /// @brief parameter names in the order of indices
+   std::vector<std::string> itsNames;
+   
+   /// @brief true for real parameters
+   std::vector<bool> itsIsReal;
+};
+
+/// @brief matrix product
+/// @details Operands may have different parameters, indices of the first operand are
+/// preserved and the parameters of the second operand are mapped by name.
+/// @param[in] in1 first operand
+/// @param[in] in2 second operand
+/// @return product matrix
+template<size_t N> FixedComplexDiffMatrix<N> operator*(const FixedComplexDiffMatrix<N> &in1,
+                                                      const FixedComplexDiffMatrix<N> &in2);
+
+} // namespace scimath
+
+} // namespace askap
+
+#include <fitting/FixedComplexDiffMatrix.tcc>
+
+#endif // #ifndef FIXED_COMPLEX_DIFF_MATRIX_H
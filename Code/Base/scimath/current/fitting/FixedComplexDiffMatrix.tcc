@@ -0,0 +1,186 @@
+/// @file
+/// 
+/// @brief A matrix of FixedComplexDiff classes
+/// @details This file contains the implementation of the template methods.
+/// 
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+#ifndef FIXED_COMPLEX_DIFF_MATRIX_TCC
+#define FIXED_COMPLEX_DIFF_MATRIX_TCC
+
+// own includes
+#include <askap/AskapError.h>
+
+// std includes
+#include <map>
+
+namespace askap {
+
+namespace scimath {
+
+/// @brief convert a ComplexDiffMatrix
+/// @details An exception is thrown if the input matrix has more than N parameters.
+/// @param[in] cdm input matrix
+template<size_t N> FixedComplexDiffMatrix<N>::FixedComplexDiffMatrix(const ComplexDiffMatrix &cdm) :
+       itsNRows(cdm.nRow()), itsNColumns(cdm.nColumn()), itsElements(cdm.nRow() * cdm.nColumn())
+{
+   // resolve names into indices once
+   std::map<std::string, size_t> indices;
+   for (ComplexDiffMatrix::parameter_iterator it = cdm.paramBegin(); it != cdm.paramEnd(); ++it) {
+        ASKAPCHECK(itsNames.size() < N, "FixedComplexDiffMatrix can handle at most "<<N<<
+                   " parameters, the input matrix has "<<cdm.nParameters());
+        indices[*it] = itsNames.size();
+        itsNames.push_back(*it);
+        itsIsReal.push_back(cdm.isReal(*it));
+   }
+   
+   // both containers use the same flattened storage order
+   typename std::vector<FixedComplexDiff<N> >::iterator outIt = itsElements.begin();
+   for (ComplexDiffMatrix::const_iterator inIt = cdm.begin(); inIt != cdm.end(); ++inIt, ++outIt) {
+        outIt->setValue(inIt->value());
+        for (ComplexDiff::parameter_iterator parIt = inIt->begin(); parIt != inIt->end(); ++parIt) {
+             const std::map<std::string, size_t>::const_iterator ci = indices.find(*parIt);
+             ASKAPDEBUGASSERT(ci != indices.end());
+             outIt->setDerivatives(ci->second, inIt->derivRe(*parIt), inIt->derivIm(*parIt));
+        }
+   }
+}
+
+/// @brief construct a matrix filled with a constant
+/// @details Parameters are added by the parameter method when the elements are set.
+/// @param[in] nrow number of rows
+/// @param[in] ncol number of columns
+/// @param[in] val value for all elements
+template<size_t N> FixedComplexDiffMatrix<N>::FixedComplexDiffMatrix(size_t nrow, size_t ncol,
+       const casa::Complex &val) : itsNRows(nrow), itsNColumns(ncol), 
+       itsElements(nrow * ncol, FixedComplexDiff<N>(val)) {}
+
+/// @brief obtain index of a parameter
+/// @details A new index is assigned if the parameter is not yet known to this matrix.
+/// An exception is thrown if this would exceed N parameters.
+/// @param[in] name parameter name
+/// @param[in] isReal true if the parameter is always real
+/// @return parameter index
+template<size_t N> size_t FixedComplexDiffMatrix<N>::parameterIndex(const std::string &name, bool isReal)
+{
+   // there are at most N parameters, a linear search is faster than a map
+   for (size_t index = 0; index < itsNames.size(); ++index) {
+        if (itsNames[index] == name) {
+            ASKAPDEBUGASSERT(itsIsReal[index] == isReal);
+            return index;
+        }
+   }
+   ASKAPCHECK(itsNames.size() < N, "FixedComplexDiffMatrix can handle at most "<<N<<
+              " parameters, unable to add "<<name);
+   itsNames.push_back(name);
+   itsIsReal.push_back(isReal);
+   return itsNames.size() - 1;
+}
+
+/// @brief read-only access to given matrix element
+/// @param[in] row row index
+/// @param[in] col column index
+/// @return reference to the element
+template<size_t N> inline const FixedComplexDiff<N>& 
+FixedComplexDiffMatrix<N>::operator()(size_t row, size_t col) const
+{
+   ASKAPDEBUGASSERT(row<itsNRows && col<itsNColumns);
+   return itsElements[itsNRows*col+row];
+}
+
+/// @brief read-write access to given matrix element
+/// @param[in] row row index
+/// @param[in] col column index
+/// @return reference to the element
+template<size_t N> inline FixedComplexDiff<N>& 
+FixedComplexDiffMatrix<N>::operator()(size_t row, size_t col)
+{
+   ASKAPDEBUGASSERT(row<itsNRows && col<itsNColumns);
+   return itsElements[itsNRows*col+row];
+}
+
+/// @brief name of the given parameter
+/// @param[in] index parameter index
+/// @return parameter name
+template<size_t N> inline const std::string& FixedComplexDiffMatrix<N>::parameterName(size_t index) const
+{
+   ASKAPDEBUGASSERT(index < itsNames.size());
+   return itsNames[index];
+}
+
+/// @brief checks whether a given parameter is conceptually real
+/// @param[in] index parameter index
+/// @return true if the given parameter is always real
+template<size_t N> inline bool FixedComplexDiffMatrix<N>::isReal(size_t index) const
+{
+   ASKAPDEBUGASSERT(index < itsIsReal.size());
+   return itsIsReal[index];
+}
+
+/// @brief matrix product
+/// @details Operands may have different parameters, indices of the first operand are
+/// preserved and the parameters of the second operand are mapped by name.
+/// @param[in] in1 first operand
+/// @param[in] in2 second operand
+/// @return product matrix
+template<size_t N> FixedComplexDiffMatrix<N> operator*(const FixedComplexDiffMatrix<N> &in1,
+                                                      const FixedComplexDiffMatrix<N> &in2)
+{
+   ASKAPDEBUGASSERT(in1.nColumn() == in2.nRow());
+   FixedComplexDiffMatrix<N> result(in1.nRow(), in2.nColumn());
+   for (size_t par = 0; par < in1.nParameters(); ++par) {
+        result.parameterIndex(in1.parameterName(par), in1.isReal(par));
+   }
+   std::vector<size_t> indices(in2.nParameters());
+   for (size_t par = 0; par < in2.nParameters(); ++par) {
+        indices[par] = result.parameterIndex(in2.parameterName(par), in2.isReal(par));
+   }
+   // elements of the second operand with derivatives moved to the indices of the result
+   std::vector<FixedComplexDiff<N> > mapped(in2.nRow() * in2.nColumn());
+   for (size_t col = 0; col < in2.nColumn(); ++col) {
+        for (size_t row = 0; row < in2.nRow(); ++row) {
+             const FixedComplexDiff<N> &src = in2(row, col);
+             FixedComplexDiff<N> &dst = mapped[in2.nRow() * col + row];
+             dst.setValue(src.value());
+             for (size_t par = 0; par < indices.size(); ++par) {
+                  dst.setDerivatives(indices[par], src.derivRe(par), src.derivIm(par));
+             }
+        }
+   }
+   for (size_t row = 0; row < result.nRow(); ++row) {
+        for (size_t col = 0; col < result.nColumn(); ++col) {
+             FixedComplexDiff<N> &element = result(row, col);
+             for (size_t k = 0; k < in1.nColumn(); ++k) {
+                  element += in1(row, k) * mapped[in2.nRow() * col + k];
+             }
+        }
+   }
+   return result;
+}
+
+} // namespace scimath
+
+} // namespace askap
+
+#endif // #ifndef FIXED_COMPLEX_DIFF_MATRIX_TCC
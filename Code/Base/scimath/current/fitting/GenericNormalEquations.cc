@@ -39,6 +39,7 @@
 #include <fitting/DesignMatrix.h>
 #include <askap/AskapError.h>
 #include <utils/DeepCopyUtils.h>
+#include <profile/Metrics.h>
 
 #include <Blob/BlobArray.h>
 #include <Blob/BlobSTL.h>
@@ -139,6 +140,7 @@ GenericNormalEquations::ShPtr GenericNormalEquations::clone() const
 /// @param[in] src an object to get the normal equations from
 void GenericNormalEquations::merge(const INormalEquations& src) 
 {
+   ASKAPMETRICS_TIMER("normalequations.merge");
    try {
       const GenericNormalEquations &gne = 
                 dynamic_cast<const GenericNormalEquations&>(src);
@@ -322,6 +324,31 @@ casa::uInt GenericNormalEquations::parameterDimension(const MapOfMatrices &nmRow
 /// @param[in] pxp cross-products (model by measured and model by model, where 
 /// measured is the vector cdm is multiplied to).
 void GenericNormalEquations::add(const ComplexDiffMatrix &cdm, const PolXProducts &pxp)
+{
+  if (pxp.nPol() == 0) {
+      return; // nothing to process     
+  }
+  // calibration problems have just a few parameters per equation, use 
+  // integer-indexed derivatives for them
+  const size_t nParams = cdm.nParameters();
+  if (nParams <= 2) {
+      add(FixedComplexDiffMatrix<2>(cdm), pxp);
+  } else if (nParams <= 4) {
+      add(FixedComplexDiffMatrix<4>(cdm), pxp);
+  } else if (nParams <= 8) {
+      add(FixedComplexDiffMatrix<8>(cdm), pxp);
+  } else {
+      addGeneric(cdm, pxp);
+  }
+}
+
+/// @brief add design equations formed as a matrix product (generic case)
+/// @details This is the original implementation of add(ComplexDiffMatrix, PolXProducts),
+/// which works with parameter names directly. It is used for matrices with too
+/// many parameters to be converted to FixedComplexDiffMatrix.
+/// @param[in] cdm matrix with derivatives and values (npol x npol)
+/// @param[in] pxp cross-products
+void GenericNormalEquations::addGeneric(const ComplexDiffMatrix &cdm, const PolXProducts &pxp)
 {
   if (pxp.nPol() == 0) {
       return; // nothing to process     
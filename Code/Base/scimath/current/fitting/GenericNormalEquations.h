@@ -44,12 +44,14 @@
 // own includes
 #include <fitting/INormalEquations.h>
 #include <fitting/ComplexDiffMatrix.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 #include <fitting/PolXProducts.h>
 #include <fitting/Params.h>
 
 // std includes
 #include <map>
 #include <string>
+#include <vector>
 
 namespace askap {
 
@@ -134,7 +136,46 @@ struct GenericNormalEquations : public INormalEquations {
   /// a square matrix of npol x npol size.
   /// @param[in] pxp cross-products (model by measured and model by model, where 
   /// measured is the vector cdm is multiplied to).
+  /// @note Matrices with up to 8 parameters are converted to FixedComplexDiffMatrix
+  /// internally, so parameter names are resolved only once per call. The measurement
+  /// equation components (gains, leakages, bandpass and their products) still build
+  /// name-keyed ComplexDiffMatrix objects. They combine arbitrary sets of parameters,
+  /// which are only known after the product is formed, so they are converted here
+  /// (or once per row by PreAvgCalMEBase) rather than ported to the fixed-size type.
   void add(const ComplexDiffMatrix &cdm, const PolXProducts &pxp);
+  
+  /// @brief add special type of design equations formed as a matrix product
+  /// @details This is the version of the method above working with parameters
+  /// resolved to integer indices. It is worth using directly if the same matrix 
+  /// is added with many different cross-products (e.g. for all spectral channels),
+  /// because the conversion from ComplexDiffMatrix is done only once then.
+  /// @param[in] cdm matrix with derivatives and values (npol x npol)
+  /// @param[in] pxp cross-products (model by measured and model by model, where 
+  /// measured is the vector cdm is multiplied to).
+  template<size_t N>
+  void add(const FixedComplexDiffMatrix<N> &cdm, const PolXProducts &pxp);
+
+  /// @brief add the same design equations for a number of channels
+  /// @details The contributions of all channels are summed in dense arrays
+  /// indexed by parameter, which are merged into the normal equations once
+  /// (i.e. parameter names are only used once per call). The result is the same
+  /// as calling the method above for pxp.roSlice(row, chan) for every channel.
+  /// @param[in] cdm matrix with derivatives and values (npol x npol)
+  /// @param[in] pxp buffered cross-products, indexed by row and channel
+  /// @param[in] row row of the buffer
+  /// @param[in] nChan number of channels to add
+  template<size_t N>
+  void add(const FixedComplexDiffMatrix<N> &cdm, const PolXProducts &pxp,
+           const casa::uInt row, const casa::uInt nChan);
+
+  /// @brief add design equations formed as a matrix product (generic case)
+  /// @details This is the original implementation of add(ComplexDiffMatrix, PolXProducts),
+  /// which works with parameter names directly. It is used for matrices with too
+  /// many parameters to be converted to FixedComplexDiffMatrix and can serve as
+  /// a reference for the faster methods.
+  /// @param[in] cdm matrix with derivatives and values (npol x npol)
+  /// @param[in] pxp cross-products
+  void addGeneric(const ComplexDiffMatrix &cdm, const PolXProducts &pxp);
     
   /// @brief add normal matrix for a given parameter
   /// @details This means that the cross terms between parameters 
@@ -252,6 +293,40 @@ protected:
   /// @return dimension of the corresponding parameter
   static casa::uInt parameterDimension(const MapOfMatrices &nmRow);  
   
+  /// @brief dense normal equations for the parameters of a FixedComplexDiffMatrix
+  /// @details Real and imaginary parts of each parameter are interleaved, i.e.
+  /// parameter i corresponds to elements 2i and 2i+1.
+  template<size_t N>
+  struct DenseNormalEquations {
+     /// @brief initialise with zeros
+     /// @param[in] nParams number of parameters used (not exceeding N)
+     explicit DenseNormalEquations(size_t nParams);
+     /// @brief number of parameters used
+     size_t itsNParams;
+     /// @brief data vector
+     double itsDataVector[2 * N];
+     /// @brief normal matrix
+     double itsNormalMatrix[2 * N][2 * N];
+  };
+
+  /// @brief accumulate design equations in the dense buffer
+  /// @param[in] cdm matrix with derivatives and values (npol x npol)
+  /// @param[in] modelProducts model by model cross-products, npol x npol (pol1 * npol + pol2)
+  /// @param[in] modelMeasProducts model by measured cross-products, npol x npol (pol1 * npol + pol2)
+  /// @param[in,out] dense buffer to add to
+  template<size_t N>
+  static void accumulate(const FixedComplexDiffMatrix<N> &cdm, 
+                         const std::vector<casa::Complex> &modelProducts,
+                         const std::vector<casa::Complex> &modelMeasProducts,
+                         DenseNormalEquations<N> &dense);
+
+  /// @brief merge the dense buffer into these normal equations
+  /// @details This is the only place where parameter names are used.
+  /// @param[in] cdm matrix the buffer was accumulated for (gives parameter names)
+  /// @param[in] dense buffer with the accumulated normal matrix and data vector
+  template<size_t N>
+  void merge(const FixedComplexDiffMatrix<N> &cdm, const DenseNormalEquations<N> &dense);
+  
   
   /// @brief Calculate an element of A^tA
   /// @details Each element of a sparse normal matrix is also a matrix
@@ -317,4 +392,6 @@ private:
 
 } // namespace askap
 
+#include <fitting/GenericNormalEquations.tcc>
+
 #endif // #ifndef GENERIC_NORMAL_EQUATIONS_H
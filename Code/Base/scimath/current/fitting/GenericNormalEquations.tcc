@@ -0,0 +1,224 @@
+/// @file
+/// @brief Normal equations without any approximation
+/// @details This file contains template methods of GenericNormalEquations
+/// working with integer-indexed autodifferentiators.
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef GENERIC_NORMAL_EQUATIONS_TCC
+#define GENERIC_NORMAL_EQUATIONS_TCC
+
+// own includes
+#include <askap/AskapError.h>
+
+// std includes
+#include <vector>
+
+namespace askap {
+
+namespace scimath {
+
+/// @brief initialise with zeros
+/// @param[in] nParams number of parameters used (not exceeding N)
+template<size_t N>
+GenericNormalEquations::DenseNormalEquations<N>::DenseNormalEquations(size_t nParams) :
+     itsNParams(nParams)
+{
+  ASKAPDEBUGASSERT(nParams <= N);
+  for (size_t row = 0; row < 2 * N; ++row) {
+       itsDataVector[row] = 0.;
+       for (size_t col = 0; col < 2 * N; ++col) {
+            itsNormalMatrix[row][col] = 0.;
+       }
+  }
+}
+
+/// @brief add special type of design equations formed as a matrix product
+/// @details This is the version of the method working with parameters
+/// resolved to integer indices. The result is the same as for the 
+/// ComplexDiffMatrix version, all parameters are treated as complex (i.e.
+/// each element of the normal matrix is a 2x2 matrix).
+/// @param[in] cdm matrix with derivatives and values (npol x npol)
+/// @param[in] pxp cross-products (model by measured and model by model, where 
+/// measured is the vector cdm is multiplied to).
+template<size_t N>
+void GenericNormalEquations::add(const FixedComplexDiffMatrix<N> &cdm, const PolXProducts &pxp)
+{
+  const casa::uInt nDataPoints = pxp.nPol();
+  if (nDataPoints == 0) {
+      return; // nothing to process     
+  }
+  ASKAPDEBUGASSERT(nDataPoints == cdm.nRow());
+  ASKAPCHECK(nDataPoints <= 4, "Only up to 4 polarisation products are supported, you have "<<nDataPoints);
+  std::vector<casa::Complex> modelProducts(nDataPoints * nDataPoints);
+  std::vector<casa::Complex> modelMeasProducts(nDataPoints * nDataPoints);
+  for (casa::uInt p1 = 0; p1 < nDataPoints; ++p1) {
+       for (casa::uInt p2 = 0; p2 < nDataPoints; ++p2) {
+            modelProducts[p1 * nDataPoints + p2] = pxp.getModelProduct(p1, p2);
+            modelMeasProducts[p1 * nDataPoints + p2] = pxp.getModelMeasProduct(p1, p2);
+       }
+  }
+  DenseNormalEquations<N> dense(cdm.nParameters());
+  accumulate(cdm, modelProducts, modelMeasProducts, dense);
+  merge(cdm, dense);
+}
+
+/// @brief add the same design equations for a number of channels
+/// @details The contributions of all channels are summed in dense arrays
+/// indexed by parameter, which are merged into the normal equations once
+/// (i.e. parameter names are only used once per call). The result is the same
+/// as calling the method above for pxp.roSlice(row, chan) for every channel.
+/// @param[in] cdm matrix with derivatives and values (npol x npol)
+/// @param[in] pxp buffered cross-products, indexed by row and channel
+/// @param[in] row row of the buffer
+/// @param[in] nChan number of channels to add
+template<size_t N>
+void GenericNormalEquations::add(const FixedComplexDiffMatrix<N> &cdm, const PolXProducts &pxp,
+                                 const casa::uInt row, const casa::uInt nChan)
+{
+  const casa::uInt nDataPoints = pxp.nPol();
+  if ((nDataPoints == 0) || (nChan == 0)) {
+      return; // nothing to process     
+  }
+  ASKAPDEBUGASSERT(nDataPoints == cdm.nRow());
+  ASKAPCHECK(nDataPoints <= 4, "Only up to 4 polarisation products are supported, you have "<<nDataPoints);
+  std::vector<casa::Complex> modelProducts(nDataPoints * nDataPoints);
+  std::vector<casa::Complex> modelMeasProducts(nDataPoints * nDataPoints);
+  DenseNormalEquations<N> dense(cdm.nParameters());
+  for (casa::uInt chan = 0; chan < nChan; ++chan) {
+       for (casa::uInt p1 = 0; p1 < nDataPoints; ++p1) {
+            for (casa::uInt p2 = 0; p2 < nDataPoints; ++p2) {
+                 modelProducts[p1 * nDataPoints + p2] = pxp.getModelProduct(row, chan, p1, p2);
+                 modelMeasProducts[p1 * nDataPoints + p2] = pxp.getModelMeasProduct(row, chan, p1, p2);
+            }
+       }
+       accumulate(cdm, modelProducts, modelMeasProducts, dense);
+  }
+  merge(cdm, dense);
+}
+
+/// @brief accumulate design equations in the dense buffer
+/// @param[in] cdm matrix with derivatives and values (npol x npol)
+/// @param[in] modelProducts model by model cross-products, npol x npol (pol1 * npol + pol2)
+/// @param[in] modelMeasProducts model by measured cross-products, npol x npol (pol1 * npol + pol2)
+/// @param[in,out] dense buffer to add to
+template<size_t N>
+void GenericNormalEquations::accumulate(const FixedComplexDiffMatrix<N> &cdm, 
+                                        const std::vector<casa::Complex> &modelProducts,
+                                        const std::vector<casa::Complex> &modelMeasProducts,
+                                        DenseNormalEquations<N> &dense)
+{
+  const size_t nDataPoints = cdm.nRow();
+  ASKAPDEBUGASSERT(nDataPoints == cdm.nColumn());
+  ASKAPDEBUGASSERT(modelProducts.size() == nDataPoints * nDataPoints);
+  ASKAPDEBUGASSERT(modelMeasProducts.size() == nDataPoints * nDataPoints);
+  const size_t nParams = dense.itsNParams;
+  ASKAPDEBUGASSERT(nParams == cdm.nParameters());
+  
+  // projected residuals: model by measured product less the contribution of the current model
+  casa::Complex residuals[4 * 4];
+  ASKAPDEBUGASSERT(nDataPoints <= 4);
+  for (size_t p = 0; p < nDataPoints; ++p) {
+       for (size_t p1 = 0; p1 < nDataPoints; ++p1) {
+            casa::Complex resid = modelMeasProducts[p1 * nDataPoints + p];
+            for (size_t p2 = 0; p2 < nDataPoints; ++p2) {
+                 resid -= cdm(p, p2).value() * modelProducts[p1 * nDataPoints + p2];
+            }
+            residuals[p * nDataPoints + p1] = resid;
+       }
+  }
+  
+  // buffers for derivatives multiplied by model products
+  casa::Complex weightedRe[N];
+  casa::Complex weightedIm[N];
+  
+  // the first loop is over polarisations, essentially summing over
+  // data points in the calculation of normal matrix
+  for (size_t p = 0; p < nDataPoints; ++p) {
+       for (size_t p1 = 0; p1 < nDataPoints; ++p1) {
+            const FixedComplexDiff<N> &cd1 = cdm(p, p1);
+            const casa::Complex resid = residuals[p * nDataPoints + p1];
+            
+            for (size_t col = 0; col < nParams; ++col) {
+                 weightedRe[col] = casa::Complex(0., 0.);
+                 weightedIm[col] = casa::Complex(0., 0.);
+            }
+            for (size_t p2 = 0; p2 < nDataPoints; ++p2) {
+                 const FixedComplexDiff<N> &cd2 = cdm(p, p2);
+                 const casa::Complex modelProduct = modelProducts[p1 * nDataPoints + p2];
+                 for (size_t col = 0; col < nParams; ++col) {
+                      weightedRe[col] += cd2.derivRe(col) * modelProduct;
+                      weightedIm[col] += cd2.derivIm(col) * modelProduct;
+                 }
+            }
+            
+            for (size_t row = 0; row < nParams; ++row) {
+                 const casa::Complex rowParDerivRe = conj(cd1.derivRe(row));
+                 const casa::Complex rowParDerivIm = conj(cd1.derivIm(row));
+                 dense.itsDataVector[2 * row] += real(rowParDerivRe * resid);
+                 dense.itsDataVector[2 * row + 1] += real(rowParDerivIm * resid);
+                 double *nmRowRe = dense.itsNormalMatrix[2 * row];
+                 double *nmRowIm = dense.itsNormalMatrix[2 * row + 1];
+                 for (size_t col = 0; col < nParams; ++col) {
+                      nmRowRe[2 * col] += real(rowParDerivRe * weightedRe[col]);
+                      nmRowRe[2 * col + 1] += real(rowParDerivRe * weightedIm[col]);
+                      nmRowIm[2 * col] += real(rowParDerivIm * weightedRe[col]);
+                      nmRowIm[2 * col + 1] += real(rowParDerivIm * weightedIm[col]);
+                 }
+            }
+       }
+  }
+}
+
+/// @brief merge the dense buffer into these normal equations
+/// @details This is the only place where parameter names are used.
+/// @param[in] cdm matrix the buffer was accumulated for (gives parameter names)
+/// @param[in] dense buffer with the accumulated normal matrix and data vector
+template<size_t N>
+void GenericNormalEquations::merge(const FixedComplexDiffMatrix<N> &cdm, const DenseNormalEquations<N> &dense)
+{
+  const size_t nParams = dense.itsNParams;
+  ASKAPDEBUGASSERT(nParams == cdm.nParameters());
+  for (size_t row = 0; row < nParams; ++row) {
+       casa::Vector<double> dv(2);
+       dv[0] = dense.itsDataVector[2 * row];
+       dv[1] = dense.itsDataVector[2 * row + 1];
+       MapOfMatrices nmRow;
+       for (size_t col = 0; col < nParams; ++col) {
+            casa::Matrix<double> nmElementBuf(2, 2);
+            nmElementBuf(0, 0) = dense.itsNormalMatrix[2 * row][2 * col];
+            nmElementBuf(0, 1) = dense.itsNormalMatrix[2 * row][2 * col + 1];
+            nmElementBuf(1, 0) = dense.itsNormalMatrix[2 * row + 1][2 * col];
+            nmElementBuf(1, 1) = dense.itsNormalMatrix[2 * row + 1][2 * col + 1];
+            nmRow.insert(std::make_pair(cdm.parameterName(col), nmElementBuf));
+       }
+       addParameter(cdm.parameterName(row), nmRow, dv);
+  }
+}
+
+} // namespace scimath
+
+} // namespace askap
+
+#endif // #ifndef GENERIC_NORMAL_EQUATIONS_TCC
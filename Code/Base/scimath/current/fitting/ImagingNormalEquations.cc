@@ -37,6 +37,7 @@
 #include <fitting/ImagingNormalEquations.h>
 #include <fitting/Params.h>
 #include <profile/AskapProfiler.h>
+#include <profile/Metrics.h>
 
 #include <casa/aips.h>
 #include <casa/Arrays/Array.h>
@@ -137,6 +138,7 @@ namespace askap
   void ImagingNormalEquations::merge(const INormalEquations& src)
   {
     ASKAPTRACE("ImagingNormalEquations::merge");
+    ASKAPMETRICS_TIMER("normalequations.merge");
     try {
       const ImagingNormalEquations &other = 
                          dynamic_cast<const ImagingNormalEquations&>(src); 
@@ -40,7 +40,6 @@
 
 #include <askap/AskapUtil.h>
 #include <askap/AskapError.h>
-#include <utils/DeepCopyUtils.h>
 
 #include <iostream>
 #include <map>
@@ -50,6 +49,13 @@ using std::map;
 using std::string;
 using std::ostream;
 
+namespace {
+
+/// @brief characters which make a completion pattern more than a plain prefix
+const char* theirWildcards = "*?[]{}\\";
+
+} // anonymous namespace
+
 namespace askap
 {
 	namespace scimath
@@ -59,27 +65,102 @@ namespace askap
 		{
 		}
 
-		Params::Params(const Params& other) :  itsAxes(other.itsAxes),
-		      itsFree(other.itsFree)
+		Params::Params(const Params& other)
 		{
-            deepCopyOfSTDMap(other.itsArrays, itsArrays);
- 
-			// itsChangeMonitors is not copied deliberately
-			ASKAPDEBUGASSERT(itsChangeMonitors.size() == 0);
+			// change monitors are not copied deliberately
+			copyRecords(other);
 		}
 
 		Params& Params::operator=(const Params& other)
 		{
 			if(this!=&other)
 			{
-                deepCopyOfSTDMap(other.itsArrays, itsArrays);
-				itsAxes=other.itsAxes;
-				itsFree=other.itsFree;
-				// change monitor map is reset deliberately
-				itsChangeMonitors.clear();
+				// change monitors are reset deliberately
+				copyRecords(other);
 			}
 			return *this;
 		}
+
+        /// @brief deep copy of the other object's parameters
+        /// @details Handles are preserved, change monitors are not copied.
+        /// @param[in] other object to copy from
+        void Params::copyRecords(const Params& other)
+        {
+            itsRecords = other.itsRecords;
+            for (std::deque<ParamRecord>::iterator it = itsRecords.begin(); it != itsRecords.end(); ++it) {
+                 it->value.reference(it->value.copy());
+                 it->monitored = false;
+                 it->changeMonitor = ChangeMonitor();
+            }
+            itsIndex = other.itsIndex;
+        }
+
+        /// @brief add a new record
+        /// @details An exception is thrown if the parameter already exists
+        /// @param[in] name parameter name
+        /// @return reference to the new record
+        Params::ParamRecord& Params::addRecord(const std::string& name)
+        {
+            const std::pair<std::map<std::string, Handle>::iterator, bool> res = 
+                  itsIndex.insert(std::make_pair(name, itsRecords.size()));
+            ASKAPCHECK(res.second, "Parameter " + name + " already exists");
+            itsRecords.push_back(ParamRecord());
+            itsRecords.back().name = name;
+            return itsRecords.back();
+        }
+
+        /// @brief access to the record of the parameter with the given name
+        /// @details An exception is thrown if the parameter does not exist
+        /// @param[in] name parameter name
+        /// @return reference to the record
+        const Params::ParamRecord& Params::record(const std::string& name) const
+        {
+            const std::map<std::string, Handle>::const_iterator ci = itsIndex.find(name);
+            ASKAPCHECK(ci != itsIndex.end(), "Parameter " + name + " does not already exist");
+            return itsRecords[ci->second];
+        }
+
+        /// @brief access to the record of the parameter with the given name (non-const)
+        /// @param[in] name parameter name
+        /// @return reference to the record
+        Params::ParamRecord& Params::record(const std::string& name)
+        {
+            const std::map<std::string, Handle>::const_iterator ci = itsIndex.find(name);
+            ASKAPCHECK(ci != itsIndex.end(), "Parameter " + name + " does not already exist");
+            return itsRecords[ci->second];
+        }
+
+        /// @brief obtain handle of the parameter
+        /// @details An exception is thrown if the parameter does not exist
+        /// @param[in] name parameter name
+        /// @return handle
+        Params::Handle Params::handle(const std::string& name) const
+        {
+            const std::map<std::string, Handle>::const_iterator ci = itsIndex.find(name);
+            ASKAPCHECK(ci != itsIndex.end(), "Parameter " + name + " does not already exist");
+            return ci->second;
+        }
+
+        /// @brief Return array value for the parameter with this handle (non-const)
+        /// @param[in] h parameter handle
+        /// @return value of the parameter
+        casa::Array<double>& Params::value(const Handle h)
+        {
+            ParamRecord &rec = record(h);
+            notifyAboutChange(rec);
+            return rec.value;
+        }
+
+        /// @brief update the parameter with this handle
+        /// @param[in] h parameter handle
+        /// @param[in] value new value
+        void Params::update(const Handle h, const casa::Array<double>& value)
+        {
+            ParamRecord &rec = record(h);
+            rec.value = value.copy();
+            rec.free = true;
+            notifyAboutChange(rec);
+        }
 		
 		/// @brief make a slice of another params class
         /// @details This method extracts one or more parameters 
@@ -96,9 +177,11 @@ namespace askap
         void Params::makeSlice(const Params &other, const std::vector<std::string> &names2copy) {
             reset();
             for (std::vector<std::string>::const_iterator ci=names2copy.begin(); ci!=names2copy.end(); ++ci) {
-                 itsArrays[*ci] = other.value(*ci);
-                 itsAxes[*ci] = other.axes(*ci);
-                 itsFree[*ci] = other.isFree(*ci);
+                 const ParamRecord &otherRec = other.record(*ci);
+                 ParamRecord &rec = addRecord(*ci);
+                 rec.value = otherRec.value;
+                 rec.axes = otherRec.axes;
+                 rec.free = otherRec.free;
             }
         }
 		
@@ -115,49 +198,40 @@ namespace askap
 		bool Params::isFree(const std::string& name) const
 		{
             ASKAPCHECK(has(name), "Parameter " + name + " does not exist");
-			return itsFree.find(name)->second;
+			return record(name).free;
 		}
 
 		void Params::free(const std::string& name)
 		{
             ASKAPCHECK(has(name), "Parameter " + name + " does not exist");
-            itsFree[name]=true;
+            record(name).free=true;
 		}
 
 		void Params::fix(const std::string& name)
 		{
             ASKAPCHECK(has(name), "Parameter " + name + " does not exist");
-            itsFree[name]=false;
+            record(name).free=false;
 		}
 
 		void Params::add(const std::string& name, const double ip)
 		{
-			ASKAPCHECK(!has(name), "Parameter " + name + " already exists");
-			casa::Array<double> ipArray(casa::IPosition(1,1));
-			ipArray(casa::IPosition(1,0))=ip;
-			itsArrays[name]=ipArray.copy();
-			itsFree[name]=true;
-			itsAxes[name]=Axes();
-            notifyAboutChange(name);
+			ParamRecord &rec = addRecord(name);
+			rec.value.resize(casa::IPosition(1,1));
+			rec.value(casa::IPosition(1,0))=ip;
 		}
 
 		void Params::add(const std::string& name, const casa::Array<double>& ip)
 		{
-			ASKAPCHECK(!has(name), "Parameter " + name + " already exists");
-			itsArrays[name]=ip.copy();
-			itsFree[name]=true;
-			itsAxes[name]=Axes();
-            notifyAboutChange(name);
+			ParamRecord &rec = addRecord(name);
+			rec.value=ip.copy();
 		}
 
 		void Params::add(const std::string& name, const casa::Array<double>& ip,
 				const Axes& axes)
 		{
-			ASKAPCHECK(!has(name), "Parameter " + name + " already exists");
-			itsArrays[name]=ip.copy();
-			itsFree[name]=true;
-			itsAxes[name]=axes;
-            notifyAboutChange(name);
+			ParamRecord &rec = addRecord(name);
+			rec.value=ip.copy();
+			rec.axes=axes;
 		}
 		
 		/// @brief add a complex-valued parameter
@@ -195,21 +269,18 @@ namespace askap
 
 		void Params::add(const std::string& name, const double ip, const Axes& axes)
 		{
-			ASKAPCHECK(!has(name), "Parameter " + name + " already exists");
-			casa::Array<double> ipArray(casa::IPosition(1,1));
-			ipArray(casa::IPosition(1,0))=ip;
-			itsArrays[name]=ipArray.copy();
-			itsFree[name]=true;
-			itsAxes[name]=axes;
-			notifyAboutChange(name);
+			ParamRecord &rec = addRecord(name);
+			rec.value.resize(casa::IPosition(1,1));
+			rec.value(casa::IPosition(1,0))=ip;
+			rec.axes=axes;
 		}
 
 		void Params::update(const std::string& name, const casa::Array<double>& ip)
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
-			itsArrays[name]=ip.copy();
-			itsFree[name]=true;
-            notifyAboutChange(name);	
+			ParamRecord &rec = record(name);
+			rec.value=ip.copy();
+			rec.free=true;
+            notifyAboutChange(rec);	
 		}
 		
         /// @brief Update a slice of an array parameter        
@@ -224,9 +295,9 @@ namespace askap
         void Params::update(const std::string &name, const casa::Array<double> &value, 
                             const casa::IPosition &blc)
         {
-           ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
+           ParamRecord &rec = record(name);
            ASKAPDEBUGASSERT(value.shape().nelements() == blc.nelements());
-           casa::Array<double> &arr = itsArrays[name];
+           casa::Array<double> &arr = rec.value;
            casa::IPosition trc(value.shape());
            trc += blc;
            for (casa::uInt i=0; i<trc.nelements(); ++i) {
@@ -237,8 +308,8 @@ namespace askap
                 ASKAPDEBUGASSERT(blc[i]<=trc[i]);
            }
            arr(blc,trc) = value.copy();
-           itsFree[name]=true;
-           notifyAboutChange(name);
+           rec.free=true;
+           notifyAboutChange(rec);
         }		
 		
 		/// @brief Add an empty array parameter        
@@ -250,11 +321,9 @@ namespace askap
         /// @param[in] axes optional axes of the parameter
         void Params::add(const std::string &name, const casa::IPosition &shape, const Axes &axes)
         {
-         	ASKAPCHECK(!has(name), "Parameter " + name + " already exists");
-			itsArrays[name].resize(shape);
-			itsFree[name]=true;
-			itsAxes[name]=axes;
-			notifyAboutChange(name);
+			ParamRecord &rec = addRecord(name);
+			rec.value.resize(shape);
+			rec.axes=axes;
 		}
 		
 		
@@ -292,22 +361,22 @@ namespace askap
 
 		void Params::update(const std::string& name, const double ip)
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
+			ParamRecord &rec = record(name);
 			casa::Array<double> ipArray(casa::IPosition(1,1));
 			ipArray(casa::IPosition(1,0))=ip;
-			itsArrays[name]=ipArray.copy();
-			itsFree[name]=true;
-			notifyAboutChange(name);
+			rec.value.reference(ipArray);
+			rec.free=true;
+			notifyAboutChange(rec);
 		}
 
 		uint Params::size() const
 		{
-			return static_cast<uint>(itsFree.size());
+			return static_cast<uint>(itsIndex.size());
 		}
 
 		bool Params::has(const std::string& name) const
 		{
-			return itsArrays.find(name) != itsArrays.end();
+			return itsIndex.find(name) != itsIndex.end();
 		}
 
 		bool Params::isScalar(const std::string& name) const
@@ -318,15 +387,14 @@ namespace askap
 
 		const casa::Array<double>& Params::value(const std::string& name) const
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
-			return itsArrays.find(name)->second;
+			return record(name).value;
 		}
 
 		casa::Array<double>& Params::value(const std::string& name)
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
-			notifyAboutChange(name);
-			return itsArrays.find(name)->second;
+			ParamRecord &rec = record(name);
+			notifyAboutChange(rec);
+			return rec.value;
 		}
 
 		double Params::scalarValue(const std::string& name) const
@@ -383,22 +451,21 @@ namespace askap
 
 		const Axes& Params::axes(const std::string& name) const
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
-			return itsAxes.find(name)->second;
+			return record(name).axes;
 		}
 
 		Axes& Params::axes(const std::string& name) 
 		{
-			ASKAPCHECK(has(name), "Parameter " + name + " does not already exist");
-			notifyAboutChange(name);
-			return itsAxes.find(name)->second;
+			ParamRecord &rec = record(name);
+			notifyAboutChange(rec);
+			return rec.axes;
 		}
 
         bool Params::isCongruent(const Params& other) const
         {
-            for(std::map<string,bool>::const_iterator iter = itsFree.begin(); iter != itsFree.end(); iter++)
+            for(std::map<string,Handle>::const_iterator iter = itsIndex.begin(); iter != itsIndex.end(); iter++)
             {
-                if (other.itsFree.find(iter->first) == other.itsFree.end()) {
+                if (!other.has(iter->first)) {
 					return false;
                 }
             }
@@ -407,16 +474,17 @@ namespace askap
 
 		void Params::merge(const Params& other)
 		{
-			std::vector<string> names(other.names());
-			for(std::vector<string>::const_iterator iter = names.begin(); iter != names.end(); iter++)
+			for(std::map<string,Handle>::const_iterator iter = other.itsIndex.begin(); iter != other.itsIndex.end(); iter++)
 			{
 				/// @todo Improve merging logic for Params
-				if(!has(*iter))
+				if(!has(iter->first))
 				{
-					itsArrays[*iter]=other.itsArrays.find(*iter)->second;
-					itsFree[*iter]=other.itsFree.find(*iter)->second;
-					itsAxes[*iter]=other.itsAxes.find(*iter)->second;
-					// we deliberately don't copy itsChangeMonitors map here as 
+					const ParamRecord &otherRec = other.itsRecords[iter->second];
+					ParamRecord &rec = addRecord(iter->first);
+					rec.value=otherRec.value;
+					rec.free=otherRec.free;
+					rec.axes=otherRec.axes;
+					// we deliberately don't copy change monitors here as 
 					// otherwise we would need some kind of global counter and a more
 					// complicated logic. The working model is that change monitor should always
 					// be first obtained from the same instance of the class.
@@ -427,8 +495,9 @@ namespace askap
 		vector<string> Params::names() const
 		{
 			vector<string> names;
-			for(std::map<string,bool>::const_iterator iter = itsFree.begin();
-					iter != itsFree.end(); iter++)
+			names.reserve(itsIndex.size());
+			for(std::map<string,Handle>::const_iterator iter = itsIndex.begin();
+					iter != itsIndex.end(); iter++)
 			{
 				names.push_back(iter->first);
 			}
@@ -438,9 +507,9 @@ namespace askap
 		vector<string> Params::freeNames() const
 		{
 			vector<string> names;
-			for(std::map<string,bool>::const_iterator iter = itsFree.begin(); iter != itsFree.end(); iter++)
+			for(std::map<string,Handle>::const_iterator iter = itsIndex.begin(); iter != itsIndex.end(); iter++)
 			{
-				if(isFree(iter->first)) names.push_back(iter->first);
+				if(itsRecords[iter->second].free) names.push_back(iter->first);
 			}
 			return names;
 		}
@@ -448,33 +517,69 @@ namespace askap
 		vector<string> Params::fixedNames() const
 		{
 			vector<string> names;
-			for(std::map<string,bool>::const_iterator iter = itsFree.begin(); iter != itsFree.end(); iter++)
+			for(std::map<string,Handle>::const_iterator iter = itsIndex.begin(); iter != itsIndex.end(); iter++)
 			{
-				if(!isFree(iter->first)) names.push_back(iter->first);
+				if(!itsRecords[iter->second].free) names.push_back(iter->first);
 			}
 			return names;
 		}
 
 		vector<string> Params::completions(const std::string& pattern) const
 		{
-			casa::Regex regex(casa::Regex::fromPattern(pattern+"*"));
-			casa::Regex sub(casa::Regex::fromPattern(pattern));
+			const vector<Handle> handles = completionHandles(pattern);
 			vector<string> completions;
-			uint ncomplete=0;
-			for(std::map<string,bool>::const_iterator iter = itsFree.begin(); iter != itsFree.end(); iter++)
-			{
-				if(casa::String(iter->first).matches(regex))
-				{
-                                   if (iter->second) {
-				       casa::String complete(iter->first);
-				       complete.gsub(sub, "");
-				       completions.push_back(complete);
-				       ncomplete++;
-                                   }
-				}
+			completions.reserve(handles.size());
+			if (pattern.find_first_of(theirWildcards) == std::string::npos) {
+			    // a literal pattern, remove all its occurrences (same as gsub)
+			    for (vector<Handle>::const_iterator ci = handles.begin(); ci != handles.end(); ++ci) {
+			         const std::string &name = itsRecords[*ci].name;
+			         std::string complete;
+			         size_t start = 0;
+			         for (size_t pos = name.find(pattern); pos != std::string::npos && pattern.size() > 0; 
+			              pos = name.find(pattern, start)) {
+			              complete.append(name, start, pos - start);
+			              start = pos + pattern.size();
+			         }
+			         complete.append(name, start, std::string::npos);
+			         completions.push_back(complete);
+			    }
+			} else {
+			    casa::Regex sub(casa::Regex::fromPattern(pattern));
+			    for (vector<Handle>::const_iterator ci = handles.begin(); ci != handles.end(); ++ci) {
+			         casa::String complete(itsRecords[*ci].name);
+			         complete.gsub(sub, "");
+			         completions.push_back(complete);
+			    }
 			}
 			return completions;
 		}
+
+        /// @brief obtain handles of the free parameters matching the pattern
+        /// @details A pattern without wildcards is a prefix. In this case, the
+        /// sorted index is searched directly. Otherwise, all names are matched
+        /// against the regular expression derived from the pattern.
+        /// @param[in] pattern pattern e.g. "gain.g11"
+        /// @return handles of free parameters matching the pattern
+        vector<Params::Handle> Params::completionHandles(const std::string& pattern) const
+        {
+            vector<Handle> handles;
+            if (pattern.find_first_of(theirWildcards) == std::string::npos) {
+                for (std::map<string,Handle>::const_iterator iter = itsIndex.lower_bound(pattern); 
+                     iter != itsIndex.end() && iter->first.compare(0, pattern.size(), pattern) == 0; ++iter) {
+                     if (itsRecords[iter->second].free) {
+                         handles.push_back(iter->second);
+                     }
+                }
+            } else {
+                const casa::Regex regex(casa::Regex::fromPattern(pattern+"*"));
+                for (std::map<string,Handle>::const_iterator iter = itsIndex.begin(); iter != itsIndex.end(); ++iter) {
+                     if (itsRecords[iter->second].free && casa::String(iter->first).matches(regex)) {
+                         handles.push_back(iter->second);
+                     }
+                }
+            }
+            return handles;
+        }
 		
 		/// @brief remove a parameter
         /// @details One needs to be able to remove a given parameter to avoid passing
@@ -483,23 +588,22 @@ namespace askap
         void Params::remove(const std::string &name)
         {
           ASKAPDEBUGASSERT(has(name));
-          itsArrays.erase(name);
-          itsAxes.erase(name);
-          itsFree.erase(name);
-          // change monitor map doesn't need to contain all parameters
-          std::map<std::string, ChangeMonitor>::iterator it = itsChangeMonitors.find(name);
-          if (it != itsChangeMonitors.end()) {          
-              itsChangeMonitors.erase(it);
+          const std::map<std::string, Handle>::iterator it = itsIndex.find(name);
+          if (it != itsIndex.end()) {
+              // the record stays in place, so other handles remain valid 
+              ParamRecord &rec = itsRecords[it->second];
+              rec.removed = true;
+              rec.monitored = false;
+              rec.value.resize();
+              itsIndex.erase(it);
           }
         }
 		
 
 		void Params::reset()
 		{
-			itsArrays.clear();
-			itsAxes.clear();
-			itsFree.clear();
-			itsChangeMonitors.clear();
+			itsRecords.clear();
+			itsIndex.clear();
 		}
 
 		std::ostream& operator<<(std::ostream& os, const Params& params)
@@ -564,19 +668,19 @@ namespace askap
 ChangeMonitor Params::monitorChanges(const std::string& name) const
 {
   ASKAPDEBUGASSERT(has(name));
-  std::map<std::string, ChangeMonitor>::const_iterator cit = itsChangeMonitors.find(name);
-  if (cit != itsChangeMonitors.end()) {
-      return cit->second;
+  const ParamRecord &rec = record(name);
+  if (!rec.monitored) {
+      rec.changeMonitor = ChangeMonitor();
+      rec.monitored = true;
   } 
-  // the following line will call the default constructor behind the scene.
-  return itsChangeMonitors[name];
+  return rec.changeMonitor;
 }
 
 /// @brief notify change monitors about parameter update
 /// @details Change monitors are used to track updates of some
 /// parameters. This method first searches whether a particular
 /// parameter is monitored. If yes, it notifies the appropriate
-/// change monitor object (stored in itsChangeMonitors map).  
+/// change monitor object (stored in the parameter record).  
 /// Nothing happens if the given parameter is not monitored.
 /// @note Althoguh this method could have been made const because
 /// it works with a mutable data member only, it is conceptually
@@ -585,10 +689,9 @@ ChangeMonitor Params::monitorChanges(const std::string& name) const
 /// @param[in] name  name of the parameter
 void Params::notifyAboutChange(const std::string &name)
 {
-  std::map<std::string, ChangeMonitor>::iterator it = itsChangeMonitors.find(name);
-  if (it != itsChangeMonitors.end()) {
-      // parameter is monitored
-      it->second.notifyOfChanges();
+  const std::map<std::string, Handle>::const_iterator it = itsIndex.find(name);
+  if (it != itsIndex.end()) {
+      notifyAboutChange(itsRecords[it->second]);
   }   
 }
 
@@ -602,25 +705,37 @@ void Params::notifyAboutChange(const std::string &name)
 /// @return true, if the given parameter has been changed
 bool Params::isChanged(const std::string &name, const ChangeMonitor &cm) const
 {
-  std::map<std::string, ChangeMonitor>::const_iterator cit = itsChangeMonitors.find(name);
-  ASKAPCHECK(cit != itsChangeMonitors.end(), "Value change for parameter "<<name<<
+  const std::map<std::string, Handle>::const_iterator cit = itsIndex.find(name);
+  ASKAPCHECK(cit != itsIndex.end() && itsRecords[cit->second].monitored, "Value change for parameter "<<name<<
              " is not tracked, run monitorChanges first");
-  return cm != cit->second;
+  return cm != itsRecords[cit->second].changeMonitor;
 }
 
 /// @brief increment this if there is any change to the stuff written into blob
 #define BLOBVERSION 2
 
-		// These are the items that we need to write to and read from a blob stream
-		// note itsChangeMonitors is not written to blob deliberately
-		// std::map<std::string, casa::Array<double> > itsArrays;
-		// std::map<std::string, Axes> itsAxes;
-		// std::map<std::string, bool> itsFree;
+		// These are the items that we need to write to and read from a blob stream,
+		// the format is that of the maps used before parameter records were introduced
+		// note change monitors are not written to blob deliberately
+		// std::map<std::string, casa::Array<double> > arrays;
+		// std::map<std::string, Axes> axes;
+		// std::map<std::string, bool> free;
 
 		LOFAR::BlobOStream& operator<<(LOFAR::BlobOStream& os, const Params& par)
 		{
+		    std::map<std::string, casa::Array<double> > arrays;
+		    std::map<std::string, Axes> axes;
+		    std::map<std::string, bool> free;
+		    // the index is sorted, so insertion at the end is constant time
+		    for (std::map<std::string, Params::Handle>::const_iterator ci = par.itsIndex.begin();
+		         ci != par.itsIndex.end(); ++ci) {
+		         const Params::ParamRecord &rec = par.itsRecords[ci->second];
+		         arrays.insert(arrays.end(), std::make_pair(ci->first, rec.value));
+		         axes.insert(axes.end(), std::make_pair(ci->first, rec.axes));
+		         free.insert(free.end(), std::make_pair(ci->first, rec.free));
+		    }
 		    os.putStart("Params",BLOBVERSION);		
-			os << par.itsArrays << par.itsAxes << par.itsFree;
+			os << arrays << axes << free;
 			os.putEnd();			
             return os;
 		}
@@ -631,13 +746,41 @@ bool Params::isChanged(const std::string &name, const ChangeMonitor &cm) const
 		    ASKAPCHECK(version == BLOBVERSION, 
 		        "Attempting to read from a blob stream a Params object of the wrong version, expect "<<
 		        BLOBVERSION<<" got "<<version);		
-			is >> par.itsArrays >> par.itsAxes >> par.itsFree;
+		    std::map<std::string, casa::Array<double> > arrays;
+		    std::map<std::string, Axes> axes;
+		    std::map<std::string, bool> free;
+			is >> arrays >> axes >> free;
             is.getEnd();
-            // as the object has been updated one needs to obtain new change monitor
-            par.itsChangeMonitors.clear();			
+            // as the object has been updated one needs to obtain new change monitor,
+            // fromMaps starts from scratch
+            par.fromMaps(arrays, axes, free);
             return is;
 		}
 
+        /// @brief rebuild records from maps read from a blob stream
+        void Params::fromMaps(const std::map<std::string, casa::Array<double> > &arrays,
+                              const std::map<std::string, Axes> &axes, 
+                              const std::map<std::string, bool> &free)
+        {
+            ASKAPCHECK(arrays.size() == axes.size() && arrays.size() == free.size(), 
+                       "Inconsistent Params object read from a blob stream");
+            reset();
+            std::map<std::string, Axes>::const_iterator axesIt = axes.begin();
+            std::map<std::string, bool>::const_iterator freeIt = free.begin();
+            for (std::map<std::string, casa::Array<double> >::const_iterator ci = arrays.begin();
+                 ci != arrays.end(); ++ci, ++axesIt, ++freeIt) {
+                 ASKAPCHECK(axesIt->first == ci->first && freeIt->first == ci->first,
+                       "Inconsistent Params object read from a blob stream");
+                 itsIndex.insert(itsIndex.end(), std::make_pair(ci->first, itsRecords.size()));
+                 itsRecords.push_back(ParamRecord());
+                 ParamRecord &rec = itsRecords.back();
+                 rec.name = ci->first;
+                 rec.value.reference(ci->second);
+                 rec.axes = axesIt->second;
+                 rec.free = freeIt->second;
+            }
+        }
+
 	} // namespace scimath
 	
     /// @brief populate scimath parameters from a LOFAR Parset object
@@ -47,8 +47,10 @@
 #include <Blob/BlobIStream.h>
 
 #include <utils/ChangeMonitor.h>
+#include <askap/AskapError.h>
 
 #include <map>
+#include <deque>
 #include <vector>
 #include <string>
 #include <ostream>
@@ -60,10 +62,19 @@ namespace askap
   namespace scimath
   {
     /// @brief Represent parameters for an Equation
+    /// @details Each parameter is kept in a single record addressed by an
+    /// integer handle. Handles are stable: they are not reused when a parameter
+    /// is removed and remain valid until reset or assignment. Names are resolved
+    /// to handles via a sorted index, which is also used to find completions
+    /// of a prefix without scanning all parameters. Code which accesses the same 
+    /// parameters many times (e.g. calibration with millions of gains) can obtain
+    /// handles once and avoid string look-ups afterwards.
     /// @ingroup fitting
     class Params
     {
       public:
+        /// @brief type of the parameter handle
+        typedef size_t Handle;
 
          /// Default constructor
         Params();
@@ -231,6 +242,43 @@ casa::Vector<casa::Complex> complexVectorValue(const std::string &name) const;
 /// @param match Match e.g. "flux.i.*"
         std::vector<std::string> completions(const std::string& match) const;
 
+        /// @brief obtain handles of the free parameters matching the pattern
+        /// @details This is the handle-based counterpart of completions. 
+        /// @param[in] match pattern e.g. "gain.g11"
+        /// @return handles of free parameters matching the pattern
+        std::vector<Handle> completionHandles(const std::string& match) const;
+
+        /// @brief obtain handle of the parameter
+        /// @details An exception is thrown if the parameter does not exist
+        /// @param[in] name parameter name
+        /// @return handle
+        Handle handle(const std::string& name) const;
+
+        /// @brief obtain name of the parameter
+        /// @param[in] h parameter handle
+        /// @return parameter name
+        inline const std::string& name(const Handle h) const { return record(h).name; }
+
+        /// @brief Return array value for the parameter with this handle (const)
+        /// @param[in] h parameter handle
+        /// @return value of the parameter
+        inline const casa::Array<double>& value(const Handle h) const { return record(h).value; }
+
+        /// @brief Return array value for the parameter with this handle (non-const)
+        /// @param[in] h parameter handle
+        /// @return value of the parameter
+        casa::Array<double>& value(const Handle h);
+
+        /// @brief check whether the parameter with this handle is free
+        /// @param[in] h parameter handle
+        /// @return True if free to vary
+        inline bool isFree(const Handle h) const { return record(h).free; }
+
+        /// @brief update the parameter with this handle
+        /// @param[in] h parameter handle
+        /// @param[in] value new value
+        void update(const Handle h, const casa::Array<double>& value);
+
 /// Return the key names
         std::vector<std::string> names() const;
 
@@ -316,7 +364,7 @@ casa::Vector<casa::Complex> complexVectorValue(const std::string &name) const;
         /// @details Change monitors are used to track updates of some
         /// parameters. This method first searches whether a particular
         /// parameter is monitored. If yes, it notifies the appropriate
-        /// change monitor object (stored in itsChangeMonitors map).  
+        /// change monitor object (stored in the parameter record).  
         /// Nothing happens if the given parameter is not monitored.
         /// @note Althoguh this method could have been made const because
         /// it works with a mutable data member only, it is conceptually
@@ -326,22 +374,80 @@ casa::Vector<casa::Complex> complexVectorValue(const std::string &name) const;
         void notifyAboutChange(const std::string &name); 
         
      private:
-        /// @todo Use single map map<string, struct>
-        /// The value arrays, ordered as a map
-        std::map<std::string, casa::Array<double> > itsArrays;
-        /// The axes, ordered as a map
-        std::map<std::string, Axes> itsAxes;
-        /// The free/fixed status, ordered as a map
-        std::map<std::string, bool> itsFree;
-        /// The update count, ordered as a map. This is logically a cache 
-
-        /// @brief change monitors for all tracked parameters
-        /// @details This map contains change monitors for
-        /// parameters which are tracked (i.e. for which the value
-        /// change is monitored by some other code). It may not have
-        /// all parameters. It is intentional, that this map is not
-        /// copied when the object is cloned or restored from a Blob.
-        mutable std::map<std::string, ChangeMonitor> itsChangeMonitors;
+        /// @brief everything known about one parameter
+        struct ParamRecord {
+            /// @brief default constructor, creates a free unmonitored parameter
+            ParamRecord() : free(true), removed(false), monitored(false) {}
+
+            /// @brief parameter name
+            std::string name;
+            /// @brief value
+            casa::Array<double> value;
+            /// @brief axes
+            Axes axes;
+            /// @brief free/fixed status
+            bool free;
+            /// @brief true if the parameter has been removed (the handle is not reused)
+            bool removed;
+            /// @brief true if the value change is tracked by some other code
+            /// @details It is intentional, that change monitors are not
+            /// copied when the object is cloned or restored from a Blob.
+            mutable bool monitored;
+            /// @brief change monitor, meaningful only if monitored is true
+            mutable ChangeMonitor changeMonitor;
+        };
+
+        /// @brief add a new record
+        /// @details An exception is thrown if the parameter already exists
+        /// @param[in] name parameter name
+        /// @return reference to the new record
+        ParamRecord& addRecord(const std::string& name);
+
+        /// @brief access to the record of the parameter with the given name
+        /// @details An exception is thrown if the parameter does not exist
+        /// @param[in] name parameter name
+        /// @return reference to the record
+        const ParamRecord& record(const std::string& name) const;
+
+        /// @brief access to the record of the parameter with the given name (non-const)
+        /// @param[in] name parameter name
+        /// @return reference to the record
+        ParamRecord& record(const std::string& name);
+
+        /// @brief access to the record with the given handle
+        /// @param[in] h parameter handle
+        /// @return reference to the record
+        inline const ParamRecord& record(const Handle h) const
+           { ASKAPDEBUGASSERT(h < itsRecords.size() && !itsRecords[h].removed); return itsRecords[h]; }
+
+        /// @brief access to the record with the given handle (non-const)
+        /// @param[in] h parameter handle
+        /// @return reference to the record
+        inline ParamRecord& record(const Handle h)
+           { ASKAPDEBUGASSERT(h < itsRecords.size() && !itsRecords[h].removed); return itsRecords[h]; }
+
+        /// @brief notify change monitor of the given record, if any
+        /// @param[in] rec parameter record
+        static inline void notifyAboutChange(const ParamRecord &rec)
+           { if (rec.monitored) { rec.changeMonitor.notifyOfChanges(); } }
+
+        /// @brief deep copy of the other object's parameters
+        /// @details Handles are preserved, change monitors are not copied.
+        /// @param[in] other object to copy from
+        void copyRecords(const Params& other);
+
+        /// @brief rebuild records from maps read from a blob stream
+        void fromMaps(const std::map<std::string, casa::Array<double> > &arrays,
+                      const std::map<std::string, Axes> &axes, 
+                      const std::map<std::string, bool> &free);
+
+        /// @brief records for all parameters, indexed by handle
+        /// @details A deque is used, so references to values remain valid when
+        /// parameters are added.
+        std::deque<ParamRecord> itsRecords;
+
+        /// @brief sorted index of names to handles for all existing parameters
+        std::map<std::string, Handle> itsIndex;
     };
 
   } // namespace scimath
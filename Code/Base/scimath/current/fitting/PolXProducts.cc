@@ -375,6 +375,46 @@ void PolXProducts::addModelMeasProduct(const casa::uInt pol1, const casa::uInt p
   itsModelMeasProducts(casa::IPosition(1,index)) += modelMeasProduct;
 }
    
+/// @brief add products for all polarisation pairs at once
+/// @details This is a bulk version of addModelProduct and addModelMeasProduct intended
+/// for 3-dimensional buffers. It does all index handling once and works directly with the 
+/// storage of the underlying arrays, so it is considerably faster than adding products one by
+/// one. Calls for different (x,y) update disjoint parts of the buffers, therefore they can be 
+/// made concurrently from different threads.
+/// @param[in] x first coordinate
+/// @param[in] y second coordinate
+/// @param[in] modelProducts pointer to nPol*nPol complex values to add to the modelProduct buffer,
+/// the value for (pol1,pol2) is at index pol1 + nPol*pol2. Only values with pol1>=pol2 are used.
+/// @param[in] modelMeasProducts pointer to nPol*nPol complex values to add to the modelMeasProduct 
+/// buffer, the value for (pol1,pol2) is at index pol1 + nPol*pol2
+/// @note the buffers are required to be contiguous (i.e. not a slice of another buffer)
+void PolXProducts::addProducts(const casa::uInt x, const casa::uInt y, const casa::Complex *modelProducts,
+                               const casa::Complex *modelMeasProducts)
+{
+  ASKAPDEBUGASSERT(itsModelProducts.shape().nelements() == 3);
+  ASKAPDEBUGASSERT(itsModelMeasProducts.shape().nelements() == 3);
+  ASKAPDEBUGASSERT(itsModelProducts.contiguousStorage());
+  ASKAPDEBUGASSERT(itsModelMeasProducts.contiguousStorage());
+  const casa::IPosition &shape = itsModelMeasProducts.shape();
+  ASKAPDEBUGASSERT((x < casa::uInt(shape(0))) && (y < casa::uInt(shape(1))));
+  // the polarisation axis is the last one, so the products for the given position
+  // are separated by the size of the first two dimensions
+  const size_t stride = size_t(shape(0)) * size_t(shape(1));
+  const size_t offset = size_t(x) + size_t(shape(0)) * size_t(y);
+  casa::Complex *modelBuf = itsModelProducts.data() + offset;
+  casa::Complex *modelMeasBuf = itsModelMeasProducts.data() + offset;
+  const casa::uInt npol = nPol();
+  for (casa::uInt pol2 = 0; pol2 < npol; ++pol2) {
+       for (casa::uInt pol1 = 0; pol1 < npol; ++pol1) {
+            const casa::uInt index = pol1 + npol * pol2;
+            modelMeasBuf[index * stride] += modelMeasProducts[index];
+            if (pol1 >= pol2) {
+                modelBuf[polToIndex(pol1, pol2) * stride] += modelProducts[index];
+            }
+       }
+  }
+}
+   
 /// @brief polarisation index for a given pair of polarisations
 /// @details We need to keep track of cross-polarisation products. These cross-products are
 /// kept alongside with the parallel-hand products in the same cube. This method translates
@@ -246,6 +246,22 @@ public:
    void addModelMeasProduct(const casa::uInt pol1, const casa::uInt pol2, const casa::Complex modelMeasProduct);   
    
    
+   /// @brief add products for all polarisation pairs at once
+   /// @details This is a bulk version of addModelProduct and addModelMeasProduct intended
+   /// for 3-dimensional buffers. It does all index handling once and works directly with the 
+   /// storage of the underlying arrays, so it is considerably faster than adding products one by
+   /// one. Calls for different (x,y) update disjoint parts of the buffers, therefore they can be 
+   /// made concurrently from different threads.
+   /// @param[in] x first coordinate
+   /// @param[in] y second coordinate
+   /// @param[in] modelProducts pointer to nPol*nPol complex values to add to the modelProduct buffer,
+   /// the value for (pol1,pol2) is at index pol1 + nPol*pol2. Only values with pol1>=pol2 are used.
+   /// @param[in] modelMeasProducts pointer to nPol*nPol complex values to add to the modelMeasProduct 
+   /// buffer, the value for (pol1,pol2) is at index pol1 + nPol*pol2
+   /// @note the buffers are required to be contiguous (i.e. not a slice of another buffer)
+   void addProducts(const casa::uInt x, const casa::uInt y, const casa::Complex *modelProducts,
+                    const casa::Complex *modelMeasProducts);
+
    /// @brief obtain number of polarisations
    /// @return the number of polarisations
    inline casa::uInt nPol() const { return itsNPol; }
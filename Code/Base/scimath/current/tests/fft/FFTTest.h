@@ -150,6 +150,7 @@ namespace askap
       CPPUNIT_TEST_SUITE(FFTTest);
       CPPUNIT_TEST(testForwardBackwardSinglePrecision);
       CPPUNIT_TEST(testForwardBackwardDoublePrecision);      
+      CPPUNIT_TEST(testFirstAxis);
       CPPUNIT_TEST_SUITE_END();
 
       private:
@@ -194,6 +195,30 @@ namespace askap
                 CPPUNIT_ASSERT(forward_backward_test(N, dp_mat, NRMSE, dp_precision) == true);
             }
         }
+
+        void testFirstAxis()
+        {
+            // fft1d transforms along the first axis only, i.e. each column of the matrix
+            casa::Matrix<casa::DComplex> mat(16, 6);
+            for (casa::uInt c = 0; c < mat.ncolumn(); ++c) {
+                 for (casa::uInt r = 0; r < mat.nrow(); ++r) {
+                      mat(r,c) = casa::DComplex(myRand(-0.5,0.5), myRand(-0.5,0.5));
+                 }
+            }
+            const casa::Matrix<casa::DComplex> original = mat.copy();
+            casa::Matrix<casa::DComplex> expected = mat.copy();
+            for (casa::uInt c = 0; c < expected.ncolumn(); ++c) {
+                 casa::Vector<casa::DComplex> y = expected.column(c);
+                 askap::scimath::fft(y, IFFT);
+            }
+            casa::Array<casa::DComplex> arr(mat);
+            askap::scimath::fft1d(arr, IFFT);
+            double diff = 0.;
+            CPPUNIT_ASSERT(test_for_equality(arr, casa::Array<casa::DComplex>(expected), RMSE, dp_precision, diff));
+            // and back
+            askap::scimath::fft1d(arr, FFT);
+            CPPUNIT_ASSERT(test_for_equality(arr, casa::Array<casa::DComplex>(original), RMSE, dp_precision, diff));
+        }
         
     };
     
@@ -0,0 +1,267 @@
+/// @file
+/// 
+/// @brief Tests of FixedComplexDiff autodifferentiation class
+/// @details See FixedComplexDiff and FixedComplexDiffMatrix for description
+/// of what these classes are supposed to do. The results are compared
+/// with those obtained with the string-indexed ComplexDiff.
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+
+#ifndef FIXED_COMPLEX_DIFF_TEST
+#define FIXED_COMPLEX_DIFF_TEST
+
+#include <fitting/FixedComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
+#include <fitting/ComplexDiff.h>
+#include <fitting/ComplexDiffMatrix.h>
+#include <fitting/GenericNormalEquations.h>
+#include <fitting/PolXProducts.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <askap/AskapError.h>
+
+namespace askap {
+
+namespace scimath {
+
+class FixedComplexDiffTest : public CppUnit::TestFixture
+{
+
+  CPPUNIT_TEST_SUITE(FixedComplexDiffTest);
+  CPPUNIT_TEST(testArithmetic);
+  CPPUNIT_TEST(testMatrixConversion);
+  CPPUNIT_TEST(testMatrixProduct);
+  CPPUNIT_TEST(testNormalEquations);
+  CPPUNIT_TEST_EXCEPTION(testTooManyParameters, askap::CheckError);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void testArithmetic();
+  void testMatrixConversion();
+  void testMatrixProduct();
+  void testNormalEquations();
+  void testTooManyParameters();
+
+private:
+  /// @brief compare two normal equations with the same unknowns
+  static void compare(const GenericNormalEquations &ne1, const GenericNormalEquations &ne2);
+
+  /// @brief compare fixed-size and string-indexed autodifferentiators
+  static void compare(const FixedComplexDiff<3> &fixed, const ComplexDiff &cd);
+};
+
+void FixedComplexDiffTest::compare(const FixedComplexDiff<3> &fixed, const ComplexDiff &cd)
+{
+  const char* names[3] = {"g1", "g2", "real"};
+  CPPUNIT_ASSERT(abs(fixed.value() - cd.value()) < 1e-5);
+  for (size_t i = 0; i < 3; ++i) {
+       CPPUNIT_ASSERT(abs(fixed.derivRe(i) - cd.derivRe(names[i])) < 1e-5);
+       CPPUNIT_ASSERT(abs(fixed.derivIm(i) - cd.derivIm(names[i])) < 1e-5);
+  }
+}
+
+void FixedComplexDiffTest::testArithmetic()
+{
+  const FixedComplexDiff<3> f(0, casa::Complex(35.,-15.));
+  const FixedComplexDiff<3> g(1, casa::Complex(-35.,15.));
+  const FixedComplexDiff<3> r(2, 5.);
+  const ComplexDiff cf("g1", casa::Complex(35.,-15.));
+  const ComplexDiff cg("g2", casa::Complex(-35.,15.));
+  const ComplexDiff cr("real", 5.);
+  
+  compare(f + g, cf + cg);
+  compare(f * g, cf * cg);
+  compare(conj(f) * g * r, conj(cf) * cg * cr);
+  compare(f * FixedComplexDiff<3>(casa::Complex(0.,-2.)) + FixedComplexDiff<3>(1.), cf * casa::Complex(0.,-2.) + 1.);
+  FixedComplexDiff<3> h(f);
+  h *= casa::Complex(1.,2.);
+  ComplexDiff ch(cf);
+  ch *= casa::Complex(1.,2.);
+  compare(h, ch);
+  // no cross-terms for the real parameter
+  CPPUNIT_ASSERT(abs(r.derivIm(2)) < 1e-7);
+}
+
+void FixedComplexDiffTest::testMatrixConversion()
+{
+  ComplexDiffMatrix cdm(2,2);
+  cdm(0,0) = ComplexDiff("g2", casa::Complex(1.1,-1.1));
+  cdm(0,1) = ComplexDiff("g1", casa::Complex(1.2,-1.2)) * ComplexDiff("real", 2.);
+  cdm(1,0) = casa::Complex(2.1,-2.1);
+  cdm(1,1) = ComplexDiff("g2", casa::Complex(2.2,-2.2)) * ComplexDiff("g1", casa::Complex(0.,1.));
+  CPPUNIT_ASSERT_EQUAL(size_t(3), cdm.nParameters());
+  
+  const FixedComplexDiffMatrix<4> fixed(cdm);
+  CPPUNIT_ASSERT_EQUAL(size_t(2), fixed.nRow());
+  CPPUNIT_ASSERT_EQUAL(size_t(2), fixed.nColumn());
+  CPPUNIT_ASSERT_EQUAL(size_t(3), fixed.nParameters());
+  // parameters are sorted by name
+  CPPUNIT_ASSERT_EQUAL(std::string("g1"), fixed.parameterName(0));
+  CPPUNIT_ASSERT_EQUAL(std::string("g2"), fixed.parameterName(1));
+  CPPUNIT_ASSERT_EQUAL(std::string("real"), fixed.parameterName(2));
+  CPPUNIT_ASSERT(!fixed.isReal(0));
+  CPPUNIT_ASSERT(!fixed.isReal(1));
+  CPPUNIT_ASSERT(fixed.isReal(2));
+  for (size_t row = 0; row < 2; ++row) {
+       for (size_t col = 0; col < 2; ++col) {
+            const ComplexDiff &cd = cdm(row,col);
+            const FixedComplexDiff<4> &fcd = fixed(row,col);
+            CPPUNIT_ASSERT(abs(fcd.value() - cd.value()) < 1e-5);
+            for (size_t par = 0; par < 3; ++par) {
+                 CPPUNIT_ASSERT(abs(fcd.derivRe(par) - cd.derivRe(fixed.parameterName(par))) < 1e-5);
+                 CPPUNIT_ASSERT(abs(fcd.derivIm(par) - cd.derivIm(fixed.parameterName(par))) < 1e-5);
+            }
+            // unused index
+            CPPUNIT_ASSERT(abs(fcd.derivRe(3)) < 1e-7);
+       }
+  }
+}
+
+void FixedComplexDiffTest::testMatrixProduct()
+{
+  // matrices filled directly, "g2" is shared by both operands
+  FixedComplexDiffMatrix<4> fixed1(2, 2);
+  fixed1(0,0) = fixed1.parameter("g1", casa::Complex(1.1,-1.1));
+  fixed1(1,1) = conj(fixed1.parameter("g2", casa::Complex(2.2,0.5)));
+  FixedComplexDiffMatrix<4> fixed2(2, 2, casa::Complex(1.,0.));
+  fixed2(0,1) = fixed2.parameter("g3", casa::Complex(0.1,0.2));
+  fixed2(1,0) = fixed2.parameter("g2", casa::Complex(2.2,0.5)) * fixed2.parameter("g3", casa::Complex(0.1,0.2));
+  CPPUNIT_ASSERT_EQUAL(size_t(2), fixed1.nParameters());
+  CPPUNIT_ASSERT_EQUAL(size_t(2), fixed2.nParameters());
+  
+  ComplexDiffMatrix cdm1(2, 2, 0.);
+  cdm1(0,0) = ComplexDiff("g1", casa::Complex(1.1,-1.1));
+  cdm1(1,1) = conj(ComplexDiff("g2", casa::Complex(2.2,0.5)));
+  ComplexDiffMatrix cdm2(2, 2, 1.);
+  cdm2(0,1) = ComplexDiff("g3", casa::Complex(0.1,0.2));
+  cdm2(1,0) = ComplexDiff("g2", casa::Complex(2.2,0.5)) * ComplexDiff("g3", casa::Complex(0.1,0.2));
+  
+  const FixedComplexDiffMatrix<4> fixed = fixed1 * fixed2;
+  const ComplexDiffMatrix cdm = cdm1 * cdm2;
+  CPPUNIT_ASSERT_EQUAL(size_t(3), fixed.nParameters());
+  // indices of the first operand are preserved
+  CPPUNIT_ASSERT_EQUAL(std::string("g1"), fixed.parameterName(0));
+  CPPUNIT_ASSERT_EQUAL(std::string("g2"), fixed.parameterName(1));
+  CPPUNIT_ASSERT_EQUAL(std::string("g3"), fixed.parameterName(2));
+  for (size_t row = 0; row < 2; ++row) {
+       for (size_t col = 0; col < 2; ++col) {
+            const ComplexDiff &cd = cdm(row,col);
+            const FixedComplexDiff<4> &fcd = fixed(row,col);
+            CPPUNIT_ASSERT(abs(fcd.value() - cd.value()) < 1e-5);
+            for (size_t par = 0; par < 3; ++par) {
+                 CPPUNIT_ASSERT(abs(fcd.derivRe(par) - cd.derivRe(fixed.parameterName(par))) < 1e-5);
+                 CPPUNIT_ASSERT(abs(fcd.derivIm(par) - cd.derivIm(fixed.parameterName(par))) < 1e-5);
+            }
+       }
+  }
+}
+
+void FixedComplexDiffTest::compare(const GenericNormalEquations &ne1, const GenericNormalEquations &ne2)
+{
+  const std::vector<std::string> names = ne1.unknowns();
+  CPPUNIT_ASSERT_EQUAL(names.size(), ne2.unknowns().size());
+  for (size_t i = 0; i < names.size(); ++i) {
+       const casa::Vector<double> &dv1 = ne1.dataVector(names[i]);
+       const casa::Vector<double> &dv2 = ne2.dataVector(names[i]);
+       CPPUNIT_ASSERT_EQUAL(dv1.nelements(), dv2.nelements());
+       for (casa::uInt k = 0; k < dv1.nelements(); ++k) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(dv1[k], dv2[k], 1e-4);
+       }
+       for (size_t j = 0; j < names.size(); ++j) {
+            const casa::Matrix<double> &nm1 = ne1.normalMatrix(names[i], names[j]);
+            const casa::Matrix<double> &nm2 = ne2.normalMatrix(names[i], names[j]);
+            CPPUNIT_ASSERT(nm1.shape() == nm2.shape());
+            for (casa::uInt row = 0; row < nm1.nrow(); ++row) {
+                 for (casa::uInt col = 0; col < nm1.ncolumn(); ++col) {
+                      CPPUNIT_ASSERT_DOUBLES_EQUAL(nm1(row,col), nm2(row,col), 1e-4);
+                 }
+            }
+       }
+  }
+}
+
+void FixedComplexDiffTest::testNormalEquations()
+{
+  // gains and a leakage for two polarisations, the same matrix for all channels
+  ComplexDiffMatrix cdm(2,2);
+  const ComplexDiff g1("gain.g11", casa::Complex(1.1,-0.1));
+  const ComplexDiff g2("gain.g22", casa::Complex(0.9,0.2));
+  const ComplexDiff d("leakage.d12", casa::Complex(0.05,-0.02));
+  cdm(0,0) = g1;
+  cdm(0,1) = g1 * d;
+  cdm(1,0) = g2 * conj(d);
+  cdm(1,1) = g2;
+  CPPUNIT_ASSERT_EQUAL(size_t(3), cdm.nParameters());
+  
+  const casa::uInt nChan = 5;
+  PolXProducts pxp(2, casa::IPosition(2, 2, nChan));
+  for (casa::uInt row = 0; row < 2; ++row) {
+       for (casa::uInt chan = 0; chan < nChan; ++chan) {
+            for (casa::uInt pol1 = 0; pol1 < 2; ++pol1) {
+                 for (casa::uInt pol2 = 0; pol2 < 2; ++pol2) {
+                      const float scale = 1. + 0.1 * chan + 0.3 * row;
+                      if (pol1 >= pol2) {
+                          pxp.addModelProduct(row, chan, pol1, pol2, pol1 == pol2 ? 
+                               casa::Complex(scale, 0.) : casa::Complex(0.1 * scale, -0.05));
+                      }
+                      pxp.addModelMeasProduct(row, chan, pol1, pol2, 
+                               casa::Complex(scale * (pol1 + 1), 0.1 * (pol2 + chan)));
+                 }
+            }
+       }
+  }
+  
+  // reference: name-based implementation, one channel at a time
+  GenericNormalEquations reference;
+  // integer-indexed implementation, one channel at a time
+  GenericNormalEquations perChannel;
+  // integer-indexed implementation, all channels merged once
+  GenericNormalEquations perRow;
+  const FixedComplexDiffMatrix<4> fixed(cdm);
+  const casa::uInt row = 1;
+  for (casa::uInt chan = 0; chan < nChan; ++chan) {
+       reference.addGeneric(cdm, pxp.roSlice(row, chan));
+       perChannel.add(fixed, pxp.roSlice(row, chan));
+  }
+  perRow.add(fixed, pxp, row, nChan);
+  CPPUNIT_ASSERT_EQUAL(size_t(3), reference.unknowns().size());
+  compare(reference, perChannel);
+  compare(reference, perRow);
+}
+
+void FixedComplexDiffTest::testTooManyParameters()
+{
+  ComplexDiffMatrix cdm(1,3);
+  cdm(0,0) = ComplexDiff("g1", casa::Complex(1.,0.));
+  cdm(0,1) = ComplexDiff("g2", casa::Complex(1.,0.));
+  cdm(0,2) = ComplexDiff("g3", casa::Complex(1.,0.));
+  FixedComplexDiffMatrix<2> fixed(cdm);
+}
+
+} // namespace scimath
+
+} // namespace askap
+
+#endif // #ifndef FIXED_COMPLEX_DIFF_TEST
@@ -58,6 +58,7 @@ namespace askap
       CPPUNIT_TEST_EXCEPTION(testDuplicate, askap::CheckError);
       CPPUNIT_TEST_EXCEPTION(testNotScalar, askap::CheckError);
       CPPUNIT_TEST(testChangeMonitor);
+      CPPUNIT_TEST(testHandles);
       CPPUNIT_TEST_SUITE_END();
 
       private:
@@ -121,6 +122,40 @@ namespace askap
           CPPUNIT_ASSERT(p1->completions("Roo*9").size()==1);
           CPPUNIT_ASSERT(p1->completions("Root.*").size()==10);
           CPPUNIT_ASSERT(p1->completions("Nothing").size()==0);
+          // literal prefix, the pattern is removed from the names
+          const std::vector<std::string> comps = p1->completions("Root.");
+          CPPUNIT_ASSERT_EQUAL(size_t(10), comps.size());
+          CPPUNIT_ASSERT_EQUAL(std::string("0"), comps[0]);
+          CPPUNIT_ASSERT_EQUAL(std::string("9"), comps[9]);
+          // fixed parameters are not included
+          p1->fix("Root.3");
+          CPPUNIT_ASSERT(p1->completions("Root.").size()==9);
+          CPPUNIT_ASSERT(p1->completionHandles("Root.").size()==9);
+        }
+
+        void testHandles()
+        {
+          p1->add("gain.g11.0", casa::Complex(1.,0.));
+          p1->add("gain.g11.1", casa::Complex(0.,1.));
+          p1->add("Value0", 1.5);
+          const Params::Handle h = p1->handle("gain.g11.1");
+          CPPUNIT_ASSERT_EQUAL(std::string("gain.g11.1"), p1->name(h));
+          CPPUNIT_ASSERT(p1->isFree(h));
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(1., p1->value(h)(casa::IPosition(1,1)), 1e-7);
+          // removal of another parameter doesn't affect existing handles
+          p1->remove("gain.g11.0");
+          CPPUNIT_ASSERT_EQUAL(h, p1->handle("gain.g11.1"));
+          const ChangeMonitor cm = p1->monitorChanges("gain.g11.1");
+          casa::Vector<double> newVal(2, 3.);
+          p1->update(h, newVal);
+          CPPUNIT_ASSERT(p1->isChanged("gain.g11.1", cm));
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(3., p1->value("gain.g11.1")(casa::IPosition(1,0)), 1e-7);
+          const std::vector<Params::Handle> handles = p1->completionHandles("gain.");
+          CPPUNIT_ASSERT_EQUAL(size_t(1), handles.size());
+          CPPUNIT_ASSERT_EQUAL(h, handles[0]);
+          // handles are preserved in copies
+          const Params copy(*p1);
+          CPPUNIT_ASSERT_EQUAL(std::string("Value0"), copy.name(p1->handle("Value0")));
         }
 
         void testCopy()
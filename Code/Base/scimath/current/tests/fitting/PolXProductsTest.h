@@ -34,6 +34,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <fitting/PolXProducts.h>
 #include <askap/AskapError.h>
+#include <vector>
 
 namespace askap {
 
@@ -49,6 +50,7 @@ class PolXProductsTest : public CppUnit::TestFixture
   CPPUNIT_TEST(testResize);
   CPPUNIT_TEST(testPolIndices);
   CPPUNIT_TEST(testAdd);
+  CPPUNIT_TEST(testAddProducts);
 #ifdef ASKAP_DEBUG  
   // dimension mismatch is detected in the debug mode only
   CPPUNIT_TEST_EXCEPTION(testDimensionMismatch, askap::AssertError);
@@ -252,6 +254,40 @@ public:
      pxp.getModelProduct(0,1);     
   }
   
+  void testAddProducts() {
+     PolXProducts pxp(4,casa::IPosition(2,3,5),true);
+     PolXProducts pxpRef(4,casa::IPosition(2,3,5),true);
+     std::vector<casa::Complex> modelProducts(16), modelMeasProducts(16);
+     for (casa::uInt x=0; x<3; ++x) {
+          for (casa::uInt y=0; y<5; ++y) {
+               for (casa::uInt p1=0; p1<pxp.nPol(); ++p1) {
+                    for (casa::uInt p2=0; p2<pxp.nPol(); ++p2) {
+                         const float tagValue = 10.*x+100.*y+float(p1)+0.1*p2;
+                         const casa::Complex cTag(tagValue,-tagValue);
+                         modelMeasProducts[p1 + 4 * p2] = cTag;
+                         // elements with p1<p2 are to be ignored
+                         modelProducts[p1 + 4 * p2] = (p1 >= p2) ? -cTag : casa::Complex(1e6,1e6);
+                         pxpRef.addModelMeasProduct(x,y,p1,p2,cTag);
+                         if (p1 >= p2) {
+                             pxpRef.addModelProduct(x,y,p1,p2,-cTag);
+                         }
+                    }
+               }
+               pxp.addProducts(x,y,&modelProducts[0],&modelMeasProducts[0]);
+          }
+     }
+     for (casa::uInt x=0; x<3; ++x) {
+          for (casa::uInt y=0; y<5; ++y) {
+               for (casa::uInt p1=0; p1<pxp.nPol(); ++p1) {
+                    for (casa::uInt p2=0; p2<pxp.nPol(); ++p2) {
+                         compareComplex(pxpRef.getModelMeasProduct(x,y,p1,p2), pxp.getModelMeasProduct(x,y,p1,p2));
+                         compareComplex(pxpRef.getModelProduct(x,y,p1,p2), pxp.getModelProduct(x,y,p1,p2));
+                    }
+               }
+          }
+     }
+  }
+
   void testAdd() {
      PolXProducts pxp(4,casa::IPosition(2,3,5),true);
      CPPUNIT_ASSERT_EQUAL(4u,pxp.nPol());
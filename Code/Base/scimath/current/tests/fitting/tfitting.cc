@@ -34,6 +34,7 @@
 #include <GeneralFittingTest.h>
 #include <ComplexDiffTest.h>
 #include <ComplexDiffMatrixTest.h>
+#include <FixedComplexDiffTest.h>
 #include <AxesTest.h>
 #include <PolXProductsTest.h>
 
@@ -52,6 +53,7 @@ int main(int argc, char *argv[])
     runner.addTest(askap::scimath::GeneralFittingTest::suite());
     runner.addTest(askap::scimath::ComplexDiffTest::suite());
     runner.addTest(askap::scimath::ComplexDiffMatrixTest::suite());
+    runner.addTest(askap::scimath::FixedComplexDiffTest::suite());
     runner.addTest(askap::scimath::PolXProductsTest::suite());
 
     bool wasSucessful = runner.run();
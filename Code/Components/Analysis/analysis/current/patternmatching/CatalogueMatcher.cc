@@ -35,6 +35,7 @@
 #include <patternmatching/Triangle.h>
 #include <patternmatching/Point.h>
 #include <patternmatching/PointCatalogue.h>
+#include <patternmatching/PointIndex.h>
 #include <patternmatching/MatchingUtilities.h>
 #include <casainterface/CasaInterface.h>
 
@@ -50,6 +51,8 @@
 #include <casa/Quanta.h>
 
 #include <vector>
+#include <map>
+#include <set>
 
 ASKAP_LOGGER(logger, ".cataloguematching");
 
@@ -209,22 +212,27 @@ void CatalogueMatcher::zeroOffsetMatch()
     std::sort(itsSrcCatalogue.pointList().begin(), itsSrcCatalogue.pointList().end());
     std::sort(itsRefCatalogue.pointList().begin(), itsRefCatalogue.pointList().end());
 
+    PointIndex refIndex(itsRefCatalogue.pointList());
+
     for (size_t s = 0; s < itsSrcCatalogue.pointList().size(); s++) {
 
-        for (size_t r = 0; r < itsRefCatalogue.pointList().size() && !srcMatched[s]; r++) {
+        // candidates come in increasing order, so the first unmatched one is taken
+        std::vector<size_t> near = refIndex.withinRadius(itsSrcCatalogue.pointList()[s].x(),
+                                   itsSrcCatalogue.pointList()[s].y(),
+                                   itsEpsilon);
+
+        for (size_t i = 0; i < near.size() && !srcMatched[s]; i++) {
 
+            size_t r = near[i];
             if (!refMatched[r]) {
-                if (itsSrcCatalogue.pointList()[s].sep(itsRefCatalogue.pointList()[r]) <
-                        itsEpsilon) {
 
-                    itsMatchingPixList.push_back(
-                        std::pair<Point, Point>(itsSrcCatalogue.pointList()[s],
-                                                itsRefCatalogue.pointList()[r]));
+                itsMatchingPixList.push_back(
+                    std::pair<Point, Point>(itsSrcCatalogue.pointList()[s],
+                                            itsRefCatalogue.pointList()[r]));
 
-                    refMatched[r] = true;
-                    srcMatched[s] = true;
-                    nmatch++;
-                }
+                refMatched[r] = true;
+                srcMatched[s] = true;
+                nmatch++;
             }
         }
     }
@@ -285,24 +293,29 @@ void CatalogueMatcher::addNewMatches()
         std::vector<Point>::iterator src, ref;
         std::vector<std::pair<Point, Point> >::iterator match;
 
+        std::set<std::string> matchedSrc;
+        for (match = itsMatchingPixList.begin(); match < itsMatchingPixList.end(); match++) {
+            matchedSrc.insert(match->first.ID());
+        }
+
+        // The candidates are found with a slightly larger radius, so
+        // that the offset test below decides on its own.
+        PointIndex refIndex(itsRefCatalogue.fullPointList());
+        const double searchRadius = 1.01 * matchRadius * itsEpsilon;
+
         for (src = itsSrcCatalogue.fullPointList().begin();
                 src < itsSrcCatalogue.fullPointList().end();
                 src++) {
 
-            bool isMatch = false;
-            match = itsMatchingPixList.begin();
-
-            for (; match < itsMatchingPixList.end() && !isMatch; match++) {
-                isMatch = (src->ID() == match->first.ID());
-            }
-
-            if (!isMatch) {
+            if (matchedSrc.count(src->ID()) == 0) {
                 float minOffset = 0.;
                 int minRef = -1;
 
-                for (ref = itsRefCatalogue.fullPointList().begin();
-                        ref < itsRefCatalogue.fullPointList().end();
-                        ref++) {
+                std::vector<size_t> near = refIndex.withinRadius(src->x() - itsMeanDx,
+                                           src->y() - itsMeanDy,
+                                           searchRadius);
+                for (size_t i = 0; i < near.size(); i++) {
+                    ref = itsRefCatalogue.fullPointList().begin() + near[i];
 
                     float offset = hypot(src->x() - ref->x() - itsMeanDx,
                                          src->y() - ref->y() - itsMeanDy);
@@ -310,7 +323,7 @@ void CatalogueMatcher::addNewMatches()
                     if (offset < matchRadius * itsEpsilon) {
                         if ((minRef == -1) || (offset < minOffset)) {
                             minOffset = offset;
-                            minRef = int(ref - itsRefCatalogue.fullPointList().begin());
+                            minRef = int(near[i]);
                         }
                     }
                 }
@@ -319,6 +332,7 @@ void CatalogueMatcher::addNewMatches()
                     ref = itsRefCatalogue.fullPointList().begin() + minRef;
                     std::pair<Point, Point> newMatch(*src, *ref);
                     itsMatchingPixList.push_back(newMatch);
+                    matchedSrc.insert(src->ID());
                 }
             }
         }
@@ -333,36 +347,7 @@ void CatalogueMatcher::addNewMatches()
 
 void CatalogueMatcher::rejectMultipleMatches()
 {
-
-    if (itsMatchingPixList.size() < 2) return;
-
-    std::vector<std::pair<Point, Point> >::iterator alice, bob;
-    alice = itsMatchingPixList.begin();
-
-    while (alice < itsMatchingPixList.end() - 1) {
-        bool aliceGone = false;
-        bob = alice + 1;
-
-        while (bob < itsMatchingPixList.end() && !aliceGone) {
-            bool bobGone = false;
-            if (alice->second.ID() == bob->second.ID()) {
-                // alice & bob have the same reference source
-                double df_alice = alice->first.flux() - alice->second.flux();
-                double df_bob   = bob->first.flux() - bob->second.flux();
-
-                if (fabs(df_alice) < fabs(df_bob)) {
-                    itsMatchingPixList.erase(bob);
-                    bobGone = true;
-                } else {
-                    itsMatchingPixList.erase(alice);
-                    aliceGone = true;
-                }
-            }
-            if (!bobGone) bob++;
-        }
-
-        if (!aliceGone) alice++;
-    }
+    matching::rejectMultipleMatches(itsMatchingPixList);
 }
 
 //**************************************************************//
@@ -420,6 +405,12 @@ void CatalogueMatcher::outputMisses()
         std::vector<Point>::iterator pt;
         std::vector<std::pair<Point, Point> >::iterator match;
 
+        std::set<std::string> matchedSrc, matchedRef;
+        for (match = itsMatchingPixList.begin(); match < itsMatchingPixList.end(); match++) {
+            matchedSrc.insert(match->first.ID());
+            matchedRef.insert(match->second.ID());
+        }
+
         size_t width = 0;
         for (pt = itsRefCatalogue.fullPointList().begin();
                 pt < itsRefCatalogue.fullPointList().end();
@@ -431,15 +422,7 @@ void CatalogueMatcher::outputMisses()
                 pt < itsRefCatalogue.fullPointList().end();
                 pt++) {
 
-            bool isMatch = false;
-
-            for (match = itsMatchingPixList.begin();
-                    match < itsMatchingPixList.end() && !isMatch;
-                    match++) {
-                isMatch = (pt->ID() == match->second.ID());
-            }
-
-            if (!isMatch) {
+            if (matchedRef.count(pt->ID()) == 0) {
                 fout << "R "
                      << std::setw(width) << pt->ID() << " "
                      << std::setw(10) << std::setprecision(3) << pt->x()  << " "
@@ -459,15 +442,7 @@ void CatalogueMatcher::outputMisses()
                 pt < itsSrcCatalogue.fullPointList().end();
                 pt++) {
 
-            bool isMatch = false;
-
-            for (match = itsMatchingPixList.begin();
-                    match < itsMatchingPixList.end() && !isMatch;
-                    match++) {
-                isMatch = (pt->ID() == match->first.ID());
-            }
-
-            if (!isMatch) {
+            if (matchedSrc.count(pt->ID()) == 0) {
                 fout << "S "
                      << std::setw(width) << pt->ID() << " "
                      << std::setw(10) << std::setprecision(3) << pt->x()  << " "
@@ -501,14 +476,23 @@ void CatalogueMatcher::outputSummary(PointCatalogue &cat, std::string filename)
     size_t width = 0;
     std::string matchID;
     std::vector<Point>::iterator pt;
-    std::vector<std::pair<Point, Point> >::iterator mpair;
     std::vector<std::pair<Point, Point> >::iterator match;
+    std::map<std::string, std::string>::iterator matchIt;
+
+    // map the IDs of this catalogue to those of their (first) matches
+    bool isSource = (&cat == &itsSrcCatalogue);
+    std::map<std::string, std::string> matchIDs;
 
     for (match = itsMatchingPixList.begin();
             match < itsMatchingPixList.end();
             match++) {
         width = std::max(width, match->first.ID().size());
         width = std::max(width, match->second.ID().size());
+        if (isSource) {
+            matchIDs.insert(std::make_pair(match->first.ID(), match->second.ID()));
+        } else {
+            matchIDs.insert(std::make_pair(match->second.ID(), match->first.ID()));
+        }
     }
 
     std::ofstream fout(filename.c_str());
@@ -517,13 +501,8 @@ void CatalogueMatcher::outputSummary(PointCatalogue &cat, std::string filename)
                 pt < cat.fullPointList().end();
                 pt++) {
 
-            bool isMatch = false;
-            for (mpair = itsMatchingPixList.begin();
-                    mpair < itsMatchingPixList.end() && !isMatch;
-                    mpair++) {
-                isMatch = (pt->ID() == mpair->second.ID());
-                matchID = isMatch ? mpair->first.ID() : "---";
-            }
+            matchIt = matchIDs.find(pt->ID());
+            matchID = (matchIt != matchIDs.end()) ? matchIt->second : "---";
             fout << std::setw(width) << pt->ID() << " "
                  << std::setw(width) << matchID << " "
                  << std::setw(10) << std::setprecision(7) << pt->x()  << " "
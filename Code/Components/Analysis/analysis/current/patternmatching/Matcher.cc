@@ -34,6 +34,7 @@
 #include <patternmatching/Matcher.h>
 #include <patternmatching/Triangle.h>
 #include <patternmatching/Point.h>
+#include <patternmatching/PointIndex.h>
 #include <patternmatching/MatchingUtilities.h>
 
 #include <Common/ParameterSet.h>
@@ -44,6 +45,8 @@
 #include <iomanip>
 #include <fstream>
 #include <vector>
+#include <map>
+#include <set>
 #include <utility>
 #include <string>
 #include <math.h>
@@ -61,6 +64,7 @@ namespace matching {
 
 Matcher::Matcher()
 {
+    itsNumNeighbours = defaultNumNeighbours;
     itsMeanDx = 0.;
     itsMeanDy = 0.;
     itsRmsDx = 0.;
@@ -98,6 +102,7 @@ Matcher& Matcher::operator=(const Matcher &m)
     itsMatchingPixList = m.itsMatchingPixList;
     itsEpsilon = m.itsEpsilon;
     itsTrimSize = m.itsTrimSize;
+    itsNumNeighbours = m.itsNumNeighbours;
     itsMeanDx = m.itsMeanDx;
     itsMeanDy = m.itsMeanDy;
     itsRmsDx = m.itsRmsDx;
@@ -123,6 +128,7 @@ Matcher::Matcher(const LOFAR::ParameterSet& parset)
     itsRadius = parset.getDouble("radius", -1.);
     itsEpsilon = parset.getDouble("epsilon", defaultEpsilon);
     itsTrimSize = parset.getInt16("trimsize", matching::maxSizePointList);
+    itsNumNeighbours = parset.getUint32("numNeighbours", defaultNumNeighbours);
     itsMeanDx = 0.;
     itsMeanDy = 0.;
     itsRmsDx = 0.;
@@ -244,7 +250,7 @@ void Matcher::setTriangleLists()
     // std::vector<Point> reflist = trimList(itsRefPixList, itsTrimSize);
     // ASKAPLOG_INFO_STR(logger, "Trimmed ref list to " << reflist.size() << " points");
 
-    itsSrcTriList = getTriList(srclist);
+    itsSrcTriList = getTriList(srclist, 10., itsNumNeighbours);
 
     ASKAPLOG_INFO_STR(logger, "Performing crude match on reference list");
     std::vector<Point> newreflist = crudeMatchList(itsRefPixList, itsSrcPixList, 5);
@@ -258,7 +264,7 @@ void Matcher::setTriangleLists()
                       newreflist.size() << " points");
 
     //                itsRefTriList = getTriList(reflist);
-    itsRefTriList = getTriList(newreflist);
+    itsRefTriList = getTriList(newreflist, 10., itsNumNeighbours);
     itsMatchingTriList = matchLists(itsSrcTriList,
                                           itsRefTriList,
                                           itsEpsilon);
@@ -345,26 +351,34 @@ void Matcher::addNewMatches()
         std::vector<Point>::iterator src, ref;
         std::vector<std::pair<Point, Point> >::iterator match;
 
-        for (src = itsSrcPixList.begin(); src < itsSrcPixList.end(); src++) {
-            bool isMatch = false;
-            match = itsMatchingPixList.begin();
+        std::set<std::string> matchedSrc;
+        for (match = itsMatchingPixList.begin(); match < itsMatchingPixList.end(); match++) {
+            matchedSrc.insert(match->first.ID());
+        }
 
-            for (; match < itsMatchingPixList.end() && !isMatch; match++) {
-                isMatch = (src->ID() == match->first.ID());
-            }
+        // The candidates are found with a slightly larger radius, so
+        // that the offset test below decides on its own.
+        PointIndex refIndex(itsRefPixList);
+        const double searchRadius = 1.01 * matchRadius * itsEpsilon;
 
-            if (!isMatch) {
+        for (src = itsSrcPixList.begin(); src < itsSrcPixList.end(); src++) {
+
+            if (matchedSrc.count(src->ID()) == 0) {
                 float minOffset = 0.;
                 int minRef = -1;
 
-                for (ref = itsRefPixList.begin(); ref < itsRefPixList.end(); ref++) {
+                std::vector<size_t> near = refIndex.withinRadius(src->x() - itsMeanDx,
+                                           src->y() - itsMeanDy,
+                                           searchRadius);
+                for (size_t i = 0; i < near.size(); i++) {
+                    ref = itsRefPixList.begin() + near[i];
                     float offset = hypot(src->x() - ref->x() - itsMeanDx,
                                          src->y() - ref->y() - itsMeanDy);
 
                     if (offset < matchRadius * itsEpsilon) {
                         if ((minRef == -1) || (offset < minOffset)) {
                             minOffset = offset;
-                            minRef = int(ref - itsRefPixList.begin());
+                            minRef = int(near[i]);
                         }
                     }
                 }
@@ -373,6 +387,7 @@ void Matcher::addNewMatches()
                     ref = itsRefPixList.begin() + minRef;
                     std::pair<Point, Point> newMatch(*src, *ref);
                     itsMatchingPixList.push_back(newMatch);
+                    matchedSrc.insert(src->ID());
                 }
             }
         }
@@ -386,46 +401,7 @@ void Matcher::addNewMatches()
 
 void Matcher::rejectMultipleMatches()
 {
-    if (itsMatchingPixList.size() < 2) return;
-
-    std::vector<std::pair<Point, Point> >::iterator alice, bob;
-    alice = itsMatchingPixList.begin();
-
-    while (alice < itsMatchingPixList.end() - 1) {
-        bool bobGone = false;
-        bool aliceGone = false;
-        bob = alice + 1;
-
-        while (bob < itsMatchingPixList.end() && !aliceGone) {
-            if (alice->second.ID() == bob->second.ID()) {
-                // alice & bob have the same reference source
-                float df_alice, df_bob;
-
-                // if (itsFluxMethod == "integrated") {
-                //     df_alice = alice->first.stuff().flux() - alice->second.flux();
-                //     df_bob   = bob->first.stuff().flux() - bob->second.flux();
-                // } else {
-                df_alice = alice->first.flux() - alice->second.flux();
-                df_bob   = bob->first.flux() - bob->second.flux();
-                // }
-
-                if (fabs(df_alice) < fabs(df_bob)) {
-                    // delete bob
-                    itsMatchingPixList.erase(bob);
-                    bobGone = true;
-                } else {
-                    // delete alice
-                    itsMatchingPixList.erase(alice);
-                    aliceGone = true;
-                }
-            }
-
-            if (!bobGone) bob++;
-            else bobGone = false;
-        }
-
-        if (!aliceGone) alice++;
-    }
+    matching::rejectMultipleMatches(itsMatchingPixList);
 }
 
 
@@ -506,15 +482,15 @@ void Matcher::outputMisses()
     std::vector<std::pair<Point, Point> >::iterator match;
     //                Stuff nullstuff(0., 0., 0., 0, 0, 0, 0, 0.);
 
-    for (pt = itsRefPixList.begin(); pt < itsRefPixList.end(); pt++) {
-        bool isMatch = false;
-        match = itsMatchingPixList.begin();
+    std::set<std::string> matchedSrc, matchedRef;
+    for (match = itsMatchingPixList.begin(); match < itsMatchingPixList.end(); match++) {
+        matchedSrc.insert(match->first.ID());
+        matchedRef.insert(match->second.ID());
+    }
 
-        for (; match < itsMatchingPixList.end() && !isMatch; match++) {
-            isMatch = (pt->ID() == match->second.ID());
-        }
+    for (pt = itsRefPixList.begin(); pt < itsRefPixList.end(); pt++) {
 
-        if (!isMatch) {
+        if (matchedRef.count(pt->ID()) == 0) {
             fout << "R\t[" << pt->ID() << "]\t"
                  << std::setw(10) << std::setprecision(3) << pt->x()  << " "
                  << std::setw(10) << std::setprecision(3) << pt->y() << " "
@@ -528,14 +504,8 @@ void Matcher::outputMisses()
     }
 
     for (pt = itsSrcPixList.begin(); pt < itsSrcPixList.end(); pt++) {
-        bool isMatch = false;
-        match = itsMatchingPixList.begin();
 
-        for (; match < itsMatchingPixList.end() && !isMatch; match++) {
-            isMatch = (pt->ID() == match->first.ID());
-        }
-
-        if (!isMatch) {
+        if (matchedSrc.count(pt->ID()) == 0) {
             fout << "S\t[" << pt->ID() << "]\t"
                  << std::setw(10) << std::setprecision(3) << pt->x()  << " "
                  << std::setw(10) << std::setprecision(3) << pt->y()  << " "
@@ -558,20 +528,19 @@ void Matcher::outputSummary()
 
     std::vector<Point>::iterator pt;
     std::vector<std::pair<Point, Point> >::iterator mpair;
-    Point match;
+    std::map<std::string, std::string>::iterator match;
+
+    // map the IDs of each list to those of their (first) matches
+    std::map<std::string, std::string> srcMatch, refMatch;
+    for (mpair = itsMatchingPixList.begin(); mpair < itsMatchingPixList.end(); mpair++) {
+        srcMatch.insert(std::make_pair(mpair->first.ID(), mpair->second.ID()));
+        refMatch.insert(std::make_pair(mpair->second.ID(), mpair->first.ID()));
+    }
 
     fout.open("match-summary-sources.txt");
     for (pt = itsSrcPixList.begin(); pt < itsSrcPixList.end(); pt++) {
-        bool isMatch = false;
-        for (mpair = itsMatchingPixList.begin();
-                mpair < itsMatchingPixList.end() && !isMatch;
-                mpair++) {
-            isMatch = (pt->ID() == mpair->first.ID());
-            if (isMatch) {
-                match = mpair->second;
-            }
-        }
-        std::string matchID = isMatch ? match.ID() : "---";
+        match = srcMatch.find(pt->ID());
+        std::string matchID = (match != srcMatch.end()) ? match->second : "---";
         fout << pt->ID() << " " << matchID << "\t"
              << std::setw(10) << std::setprecision(3) << pt->x()  << " "
              << std::setw(10) << std::setprecision(3) << pt->y()  << " "
@@ -586,16 +555,8 @@ void Matcher::outputSummary()
 
     fout.open("match-summary-reference.txt");
     for (pt = itsRefPixList.begin(); pt < itsRefPixList.end(); pt++) {
-        bool isMatch = false;
-        for (mpair = itsMatchingPixList.begin();
-                mpair < itsMatchingPixList.end() && !isMatch;
-                mpair++) {
-            isMatch = (pt->ID() == mpair->second.ID());
-            if (isMatch) {
-                match = mpair->first;
-            }
-        }
-        std::string matchID = isMatch ? match.ID() : "---";
+        match = refMatch.find(pt->ID());
+        std::string matchID = (match != refMatch.end()) ? match->second : "---";
         fout << pt->ID() << " " << matchID << "\t"
              << std::setw(10) << std::setprecision(3) << pt->x()  << " "
              << std::setw(10) << std::setprecision(3) << pt->y() << " "
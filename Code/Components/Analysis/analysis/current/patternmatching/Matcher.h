@@ -56,6 +56,10 @@ const double defaultEpsilon = 1.0;
 /// @brief Maximum size for list of points
 const unsigned int maxSizePointList = 25;
 
+/// @brief Default number of nearest neighbours of each point used to
+/// make triangles (0 means all points are used)
+const unsigned int defaultNumNeighbours = 10;
+
 /// @brief Class to handle matching of patterns of sources
 /// @details This class uses Triangle and Point classes to match
 /// lists of points. It handles the file input and output, as well as the
@@ -209,6 +213,9 @@ class Matcher {
 
         /// @brief The size of the lists used to generate triangles
         int itsTrimSize;
+        /// @brief The number of nearest neighbours used to generate
+        /// triangles (0 means all points)
+        unsigned int itsNumNeighbours;
 
         /// @brief The list of matching triangles
         std::vector<std::pair<Triangle, Triangle> > itsMatchingTriList;
@@ -34,6 +34,7 @@
 #include <patternmatching/MatchingUtilities.h>
 #include <patternmatching/Triangle.h>
 #include <patternmatching/Point.h>
+#include <patternmatching/PointIndex.h>
 #include <patternmatching/Matcher.h>
 
 #include <coordutils/PositionUtilities.h>
@@ -46,6 +47,8 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <map>
+#include <set>
 #include <algorithm>
 #include <string>
 #include <math.h>
@@ -353,12 +356,14 @@ crudeMatchList(std::vector<matching::Point> &reflist,
                std::vector<matching::Point> &srclist,
                float maxOffset)
 {
-    std::vector<matching::Point>::iterator ref, src;
+    PointIndex refIndex(reflist);
+    std::vector<matching::Point>::iterator src;
     std::vector<matching::Point> newreflist;
     for (src = srclist.begin(); src < srclist.end(); src++) {
 
-        for (ref = reflist.begin(); ref < reflist.end(); ref++) {
-            if (src->sep(*ref) < maxOffset) newreflist.push_back(*ref);
+        std::vector<size_t> near = refIndex.withinRadius(src->x(), src->y(), maxOffset);
+        for (size_t i = 0; i < near.size(); i++) {
+            newreflist.push_back(reflist[near[i]]);
         }
 
     }
@@ -367,19 +372,53 @@ crudeMatchList(std::vector<matching::Point> &reflist,
 
 }
 
-std::vector<Triangle> getTriList(std::vector<Point> &pixlist)
+std::vector<Triangle> getTriList(std::vector<Point> &pixlist, double ratioLimit,
+                                 unsigned int numNeighbours)
 {
     std::vector<Triangle> triList;
     int npix = pixlist.size();
 
-    for (int i = 0; i < npix - 2; i++) {
-        for (int j = i + 1; j < npix - 1; j++) {
-            for (int k = j + 1; k < npix; k++) {
-                Triangle tri(pixlist[i], pixlist[j], pixlist[k]);
+    if (numNeighbours == 0 || int(numNeighbours) >= npix - 1) {
+        for (int i = 0; i < npix - 2; i++) {
+            for (int j = i + 1; j < npix - 1; j++) {
+                for (int k = j + 1; k < npix; k++) {
+                    Triangle tri(pixlist[i], pixlist[j], pixlist[k]);
 
-                if (tri.ratio() < 10.) triList.push_back(tri);
+                    if (tri.ratio() < ratioLimit) triList.push_back(tri);
+                }
+            }
+        }
+    } else {
+        // Collect the vertex triples first, as the same triangle is
+        // found from each of its vertices. The set also keeps them in
+        // the order of the full enumeration above.
+        typedef std::pair<size_t, std::pair<size_t, size_t> > Triple;
+        std::set<Triple> triples;
+        PointIndex index(pixlist);
+
+        for (int i = 0; i < npix; i++) {
+            // the point itself is the nearest one, so ask for one extra
+            std::vector<size_t> near = index.nearest(pixlist[i].x(), pixlist[i].y(),
+                                       numNeighbours + 1);
+            near.erase(std::remove(near.begin(), near.end(), size_t(i)), near.end());
+
+            for (size_t a = 0; a < near.size(); a++) {
+                for (size_t b = a + 1; b < near.size(); b++) {
+                    size_t vertex[3] = {size_t(i), near[a], near[b]};
+                    std::sort(vertex, vertex + 3);
+                    triples.insert(Triple(vertex[0], std::pair<size_t, size_t>(vertex[1], vertex[2])));
+                }
             }
         }
+
+        std::set<Triple>::iterator triple;
+        for (triple = triples.begin(); triple != triples.end(); triple++) {
+            Triangle tri(pixlist[triple->first],
+                         pixlist[triple->second.first],
+                         pixlist[triple->second.second]);
+
+            if (tri.ratio() < ratioLimit) triList.push_back(tri);
+        }
     }
 
     ASKAPLOG_INFO_STR(logger, "Generated a list of " << triList.size() << " triangles");
@@ -414,7 +453,13 @@ matchLists(std::vector<Triangle> &list1, std::vector<Triangle> &list2, double ep
         if (i == 0 || list2[i].ratioTol() > maxTol2) maxTol2 = list2[i].ratioTol();
     }
 
-    // std::vector<bool> matches(size1*size2, false);
+    // the second list is sorted, so the candidates for each triangle
+    // of the first list form a contiguous range of ratios
+    std::vector<double> ratio2(size2);
+    for (size_t j = 0; j < size2; j++) {
+        ratio2[j] = list2[j].ratio();
+    }
+
     int nmatch = 0;
     std::vector<std::pair<Triangle, Triangle> > matchList;
 
@@ -423,9 +468,9 @@ matchLists(std::vector<Triangle> &list1, std::vector<Triangle> &list2, double ep
         double maxRatioB = list1[i].ratio() + sqrt(maxTol1 + maxTol2);
         double minRatioB = list1[i].ratio() - sqrt(maxTol1 + maxTol2);
 
-        std::vector<Triangle> matches;
-        for (size_t j = 0; j < size2 && list2[j].ratio() < maxRatioB; j++) {
-            if (list2[j].ratio() > minRatioB && list1[i].isMatch(list2[j], epsilon)) {
+        size_t j = std::upper_bound(ratio2.begin(), ratio2.end(), minRatioB) - ratio2.begin();
+        for (; j < size2 && ratio2[j] < maxRatioB; j++) {
+            if (list1[i].isMatch(list2[j], epsilon)) {
                 nmatch++;
                 std::pair<Triangle, Triangle> match(list1[i], list2[j]);
                 matchList.push_back(match);
@@ -518,7 +563,8 @@ std::vector<std::pair<Point, Point> > vote(std::vector<std::pair<Triangle, Trian
     std::multimap<int, std::pair<Point, Point> > voteList;
     std::vector<std::pair<Point, Point> > pts;
     std::vector<int> votes;
-    std::multimap<int, std::pair<Point, Point> >::iterator vote;
+    std::map<std::pair<std::string, std::string>, size_t> voteIndex;
+    std::map<std::pair<std::string, std::string>, size_t>::iterator index;
     std::multimap<int, std::pair<Point, Point> >::reverse_iterator rvote;
 
     for (unsigned int i = 0; i < trilist.size(); i++) {
@@ -526,20 +572,13 @@ std::vector<std::pair<Point, Point> > vote(std::vector<std::pair<Triangle, Trian
         std::vector<Point> ptlist2 = trilist[i].second.getPtList();
 
         for (int p = 0; p < 3; p++) { // for each of the three points:
-            bool foundMatch = false;
-            if (votes.size() > 0) {
-
-                for (size_t i = 0; i < votes.size() && !foundMatch; i++) {
-                    if ((pts[i].first.ID() == ptlist1[p].ID()) &&
-                            (pts[i].second.ID() == ptlist2[p].ID())) {
-                        votes[i]++;
-                        foundMatch = true;
-                    }
-                }
-
-            }
+            std::pair<std::string, std::string> ids(ptlist1[p].ID(), ptlist2[p].ID());
+            index = voteIndex.find(ids);
 
-            if (!foundMatch) {
+            if (index != voteIndex.end()) {
+                votes[index->second]++;
+            } else {
+                voteIndex.insert(std::make_pair(ids, votes.size()));
                 votes.push_back(1);
                 pts.push_back(std::pair<Point, Point>(ptlist1[p], ptlist2[p]));
             }
@@ -560,12 +599,11 @@ std::vector<std::pair<Point, Point> > vote(std::vector<std::pair<Triangle, Trian
 
     bool stop = false;
     int prevVote = voteList.rbegin()->first;
+    std::set<std::string> accepted;
 
     for (rvote = voteList.rbegin(); rvote != voteList.rend() && !stop; rvote++) {
 
-        for (unsigned int i = 0; i < outlist.size() && !stop; i++) {
-            stop = ((rvote->second.first.ID() == outlist[i].first.ID()));
-        }
+        stop = (accepted.count(rvote->second.first.ID()) > 0);
 
         if (rvote != voteList.rbegin()) {
             stop = stop || (rvote->first < 0.5 * prevVote);
@@ -573,6 +611,7 @@ std::vector<std::pair<Point, Point> > vote(std::vector<std::pair<Triangle, Trian
 
         if (!stop) {
             outlist.push_back(rvote->second);
+            accepted.insert(rvote->second.first.ID());
         }
 
         prevVote = rvote->first;
@@ -581,6 +620,43 @@ std::vector<std::pair<Point, Point> > vote(std::vector<std::pair<Triangle, Trian
     return outlist;
 }
 
+//**************************************************************//
+
+void rejectMultipleMatches(std::vector<std::pair<Point, Point> > &matchlist)
+{
+    if (matchlist.size() < 2) return;
+
+    // the best match found so far for each reference point
+    std::map<std::string, size_t> best;
+    std::map<std::string, size_t>::iterator current;
+    std::vector<bool> keep(matchlist.size(), true);
+
+    for (size_t i = 0; i < matchlist.size(); i++) {
+        current = best.find(matchlist[i].second.ID());
+
+        if (current == best.end()) {
+            best.insert(std::make_pair(matchlist[i].second.ID(), i));
+        } else {
+            size_t j = current->second;
+            double df_best = matchlist[j].first.flux() - matchlist[j].second.flux();
+            double df_new  = matchlist[i].first.flux() - matchlist[i].second.flux();
+
+            if (fabs(df_best) < fabs(df_new)) {
+                keep[i] = false;
+            } else {
+                keep[j] = false;
+                current->second = i;
+            }
+        }
+    }
+
+    std::vector<std::pair<Point, Point> > newlist;
+    for (size_t i = 0; i < matchlist.size(); i++) {
+        if (keep[i]) newlist.push_back(matchlist[i]);
+    }
+    matchlist = newlist;
+}
+
 
 }
 
@@ -161,13 +161,34 @@ getPixList(std::ifstream &fin, std::string raBaseStr, std::string decBaseStr,
 std::vector<matching::Point>
 trimList(std::vector<matching::Point> &inputList, const unsigned int maxSize);
 
+/// @brief Find the reference points close to any source point
+/// @details For each source point in turn, every reference point
+/// within maxOffset of it is added to the returned list (so a
+/// reference point can appear more than once). The reference
+/// positions are searched through a PointIndex.
+/// @param reflist The list of reference points
+/// @param srclist The list of source points
+/// @param maxOffset The maximum separation of a match
+/// @return The reference points near source points
 std::vector<matching::Point>
 crudeMatchList(std::vector<matching::Point> &reflist,
                std::vector<matching::Point> &srclist,
                float maxOffset);
 
 /// @brief Create a list of triangles from a list of points
-std::vector<Triangle> getTriList(std::vector<Point> &pixlist);
+/// @details With numNeighbours=0 every triangle of the list is
+/// considered, which is O(n^3). Otherwise a triangle is only made
+/// between a point and two of its numNeighbours nearest neighbours,
+/// giving O(n numNeighbours^2) triangles. In both cases the vertices
+/// are in the order they appear in the list and only triangles with
+/// a ratio of longest to shortest side below ratioLimit are kept.
+/// @param pixlist The list of points
+/// @param ratioLimit The maximum ratio of a triangle
+/// @param numNeighbours The number of neighbours of each point used
+/// to build triangles, or 0 to use all points
+/// @return The list of triangles
+std::vector<Triangle> getTriList(std::vector<Point> &pixlist, double ratioLimit = 10.,
+                                 unsigned int numNeighbours = defaultNumNeighbours);
 
 /// @brief Match two lists of triangles
 /// @details Finds a list of matching triangles from two
@@ -224,6 +245,15 @@ void trimTriList(std::vector<std::pair<Triangle, Triangle> > &trilist);
 std::vector<std::pair<Point, Point> >
 vote(std::vector<std::pair<Triangle, Triangle> > &trilist);
 
+/// @brief Remove matches that share a reference point
+/// @details When several source points are matched to the same
+/// reference point, only the one with the closest flux is
+/// kept. Pairs are compared in list order, a later pair replacing
+/// the current best one unless the latter has a strictly smaller
+/// flux difference. The order of the remaining pairs is unchanged.
+/// @param matchlist The list of matching (source, reference) pairs
+void rejectMultipleMatches(std::vector<std::pair<Point, Point> > &matchlist);
+
 
 }
 
@@ -30,6 +30,8 @@
 #include <patternmatching/PointCatalogue.h>
 #include <patternmatching/Point.h>
 #include <patternmatching/Triangle.h>
+#include <patternmatching/PointIndex.h>
+#include <patternmatching/MatchingUtilities.h>
 #include <modelcomponents/ModelFactory.h>
 #include <modelcomponents/Spectrum.h>
 #include <coordutils/PositionUtilities.h>
@@ -60,6 +62,7 @@ PointCatalogue::PointCatalogue():
     itsFilename(""),
     itsTrimSize(0),
     itsRatioLimit(defaultRatioLimit),
+    itsNumNeighbours(defaultNumNeighbours),
     itsFlagOffsetPositions(false),
     itsRAref(0.),
     itsDECref(0.),
@@ -85,6 +88,7 @@ PointCatalogue::PointCatalogue(LOFAR::ParameterSet &parset)
                           "will be used to generate triangles.");
     }
     itsRatioLimit = parset.getFloat("ratioLimit", defaultRatioLimit);
+    itsNumNeighbours = parset.getUint32("numNeighbours", defaultNumNeighbours);
     itsFullPointList = std::vector<Point>(0);
     itsWorkingPointList = std::vector<Point>(0);
     itsTriangleList = std::vector<Triangle>(0);
@@ -177,20 +181,9 @@ void PointCatalogue::makeTriangleList()
     ASKAPLOG_DEBUG_STR(logger, "First of list has flux " << itsWorkingPointList[0].flux());
     ASKAPLOG_DEBUG_STR(logger, "Second of list has flux " << itsWorkingPointList[1].flux());
 
-    itsTriangleList = std::vector<Triangle>(0);
-    for (size_t i = 0; i < maxPoint - 2; i++) {
-        for (size_t j = i + 1; j < maxPoint - 1; j++) {
-            for (size_t k = j + 1; k < maxPoint; k++) {
-                Triangle tri(itsWorkingPointList[i],
-                             itsWorkingPointList[j],
-                             itsWorkingPointList[k]);
-
-                if (tri.ratio() < itsRatioLimit) itsTriangleList.push_back(tri);
-            }
-        }
-    }
-
-    ASKAPLOG_INFO_STR(logger, "Generated a list of " << itsTriangleList.size() << " triangles");
+    std::vector<Point> trianglePoints(itsWorkingPointList.begin(),
+                                      itsWorkingPointList.begin() + maxPoint);
+    itsTriangleList = getTriList(trianglePoints, itsRatioLimit, itsNumNeighbours);
 
 }
 
@@ -198,19 +191,18 @@ bool PointCatalogue::crudeMatch(std::vector<Point> &other, double maxSep)
 {
     ASKAPLOG_DEBUG_STR(logger, "Performing crude match with maximum separation = " << maxSep);
     std::vector<Point>::iterator mine, theirs;
+    PointIndex otherIndex(other);
     itsWorkingPointList = std::vector<Point>(0);
     for (mine = itsFullPointList.begin(); mine < itsFullPointList.end(); mine++) {
-        bool stop = false;
-        for (theirs = other.begin(); theirs < other.end() && !stop; theirs++) {
-
-            if (theirs->sep(*mine) < maxSep) {
-                itsWorkingPointList.push_back(*mine);
-                ASKAPLOG_DEBUG_STR(logger, "crude match: (" <<
-                                   theirs->ID() << ": " << theirs->x() << "," << theirs->y() <<
-                                   ") <-> (" <<
-                                   mine->ID() << ": " << mine->x() << "," << mine->y() << ")");
-                stop = true;
-            }
+        std::vector<size_t> near = otherIndex.withinRadius(mine->x(), mine->y(), maxSep);
+
+        if (near.size() > 0) {
+            theirs = other.begin() + near[0];
+            itsWorkingPointList.push_back(*mine);
+            ASKAPLOG_DEBUG_STR(logger, "crude match: (" <<
+                               theirs->ID() << ": " << theirs->x() << "," << theirs->y() <<
+                               ") <-> (" <<
+                               mine->ID() << ": " << mine->x() << "," << mine->y() << ")");
         }
 
     }
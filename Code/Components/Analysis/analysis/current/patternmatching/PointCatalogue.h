@@ -60,6 +60,7 @@ class PointCatalogue {
         std::vector<Point> &pointList() {return itsWorkingPointList;};
         std::vector<Triangle> &triangleList() {return itsTriangleList;};
         double ratioLimit() {return itsRatioLimit;};
+        unsigned int numNeighbours() {return itsNumNeighbours;};
         double raRef() {return itsRAref;};
         double decRef() {return itsDECref;};
         double radius() {return itsRadius;};
@@ -72,6 +73,7 @@ class PointCatalogue {
         analysisutilities::ModelFactory itsFactory;
         size_t itsTrimSize; // only use the first itsTrimSize points to make the triangle list
         double itsRatioLimit;
+        unsigned int itsNumNeighbours; // triangles only between this many nearest neighbours (0=all)
         bool   itsFlagOffsetPositions;
         double itsRAref;
         double itsDECref;
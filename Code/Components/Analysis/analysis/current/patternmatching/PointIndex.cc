@@ -0,0 +1,172 @@
+/// @file
+///
+/// @brief Spatial index over a list of points
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#include <askap_analysis.h>
+
+#include <patternmatching/PointIndex.h>
+#include <patternmatching/Point.h>
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <math.h>
+
+namespace askap {
+
+namespace analysis {
+
+namespace matching {
+
+namespace {
+
+/// @brief Orders nodes along one axis
+template <class NodeType>
+struct AxisLess {
+    explicit AxisLess(int axis) : itsAxis(axis) {};
+    bool operator()(const NodeType &lhs, const NodeType &rhs) const
+    {
+        return itsAxis == 0 ? lhs.x < rhs.x : lhs.y < rhs.y;
+    };
+    int itsAxis;
+};
+
+}
+
+PointIndex::PointIndex()
+{
+}
+
+PointIndex::PointIndex(std::vector<Point> &pointlist)
+{
+    this->build(pointlist);
+}
+
+void PointIndex::build(std::vector<Point> &pointlist)
+{
+    itsNodes.resize(pointlist.size());
+    for (size_t i = 0; i < pointlist.size(); i++) {
+        itsNodes[i].x = pointlist[i].x();
+        itsNodes[i].y = pointlist[i].y();
+        itsNodes[i].index = i;
+    }
+    this->buildRange(0, itsNodes.size(), 0);
+}
+
+void PointIndex::buildRange(size_t begin, size_t end, int axis)
+{
+    if (end - begin < 2) return;
+
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(itsNodes.begin() + begin, itsNodes.begin() + mid,
+                     itsNodes.begin() + end, AxisLess<Node>(axis));
+    this->buildRange(begin, mid, 1 - axis);
+    this->buildRange(mid + 1, end, 1 - axis);
+}
+
+std::vector<size_t> PointIndex::withinRadius(double x, double y, double radius) const
+{
+    std::vector<size_t> result;
+    if (radius > 0.) {
+        this->searchRadius(0, itsNodes.size(), 0, x, y, radius, result);
+        std::sort(result.begin(), result.end());
+    }
+    return result;
+}
+
+void PointIndex::searchRadius(size_t begin, size_t end, int axis,
+                              double x, double y, double radius,
+                              std::vector<size_t> &result) const
+{
+    if (begin >= end) return;
+
+    size_t mid = begin + (end - begin) / 2;
+    const Node &node = itsNodes[mid];
+    if (hypot(x - node.x, y - node.y) < radius) {
+        result.push_back(node.index);
+    }
+
+    double diff = (axis == 0) ? x - node.x : y - node.y;
+    if (diff < radius) {
+        this->searchRadius(begin, mid, 1 - axis, x, y, radius, result);
+    }
+    if (diff > -radius) {
+        this->searchRadius(mid + 1, end, 1 - axis, x, y, radius, result);
+    }
+}
+
+std::vector<size_t> PointIndex::nearest(double x, double y, size_t num) const
+{
+    NeighbourQueue best;
+    if (num > 0) {
+        this->searchNearest(0, itsNodes.size(), 0, x, y, num, best);
+    }
+
+    std::vector<size_t> result(best.size());
+    for (size_t i = result.size(); i > 0; i--) {
+        result[i - 1] = best.top().second;
+        best.pop();
+    }
+    return result;
+}
+
+void PointIndex::searchNearest(size_t begin, size_t end, int axis,
+                               double x, double y, size_t num,
+                               NeighbourQueue &best) const
+{
+    if (begin >= end) return;
+
+    size_t mid = begin + (end - begin) / 2;
+    const Node &node = itsNodes[mid];
+    double dx = x - node.x;
+    double dy = y - node.y;
+    std::pair<double, size_t> candidate(dx * dx + dy * dy, node.index);
+    if (best.size() < num) {
+        best.push(candidate);
+    } else if (candidate < best.top()) {
+        best.pop();
+        best.push(candidate);
+    }
+
+    // search the side containing the position first, as that
+    // shrinks the search radius quickest
+    double diff = (axis == 0) ? dx : dy;
+    size_t nearBegin = begin, nearEnd = mid, farBegin = mid + 1, farEnd = end;
+    if (diff > 0.) {
+        std::swap(nearBegin, farBegin);
+        std::swap(nearEnd, farEnd);
+    }
+    this->searchNearest(nearBegin, nearEnd, 1 - axis, x, y, num, best);
+    if (best.size() < num || diff * diff <= best.top().first) {
+        this->searchNearest(farBegin, farEnd, 1 - axis, x, y, num, best);
+    }
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,118 @@
+/// @file
+///
+/// @brief Spatial index over a list of points
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#ifndef ASKAP_ANALYSIS_POINTINDEX_H_
+#define ASKAP_ANALYSIS_POINTINDEX_H_
+
+#include <patternmatching/Point.h>
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <cstddef>
+
+namespace askap {
+
+namespace analysis {
+
+namespace matching {
+
+/// @brief A k-d tree over the positions of a list of points
+/// @details The index holds a copy of the positions, stored as an
+/// implicit balanced tree (the median of each range is the node,
+/// with the split axis alternating between x and y). Queries return
+/// indices into the list the index was built from, so they remain
+/// valid as long as that list is not reordered. Building is
+/// O(n log n), and a radius or nearest-neighbour query is
+/// O(log n) plus the number of points returned.
+class PointIndex {
+    public:
+        /// @brief Default constructor, makes an empty index
+        PointIndex();
+        /// @brief Constructor from a list of points
+        PointIndex(std::vector<Point> &pointlist);
+        /// @brief Destructor
+        virtual ~PointIndex() {};
+
+        /// @brief Rebuild the index from a list of points
+        void build(std::vector<Point> &pointlist);
+
+        /// @brief Number of points in the index
+        size_t size() const {return itsNodes.size();};
+
+        /// @brief Find all points closer than a given radius
+        /// @details A point is returned if hypot(x-px, y-py) < radius,
+        /// which is the same test as Point::sep() uses.
+        /// @param x The x coordinate of the search position
+        /// @param y The y coordinate of the search position
+        /// @param radius The search radius
+        /// @return Indices of the points found, in increasing order
+        std::vector<size_t> withinRadius(double x, double y, double radius) const;
+
+        /// @brief Find the nearest points to a given position
+        /// @details Points at equal distance are ordered by their
+        /// index, so the result does not depend on the tree layout.
+        /// @param x The x coordinate of the search position
+        /// @param y The y coordinate of the search position
+        /// @param num The number of points to return
+        /// @return Indices of at most num points, nearest first
+        std::vector<size_t> nearest(double x, double y, size_t num) const;
+
+    protected:
+        /// @brief A single node of the tree
+        struct Node {
+            double x;
+            double y;
+            size_t index;
+        };
+
+        /// @brief Candidates of a nearest-neighbour search, the furthest on top
+        typedef std::priority_queue<std::pair<double, size_t> > NeighbourQueue;
+
+        /// @brief Arrange a range of nodes into a subtree
+        void buildRange(size_t begin, size_t end, int axis);
+
+        /// @brief Radius search within a subtree
+        void searchRadius(size_t begin, size_t end, int axis,
+                          double x, double y, double radius,
+                          std::vector<size_t> &result) const;
+
+        /// @brief Nearest-neighbour search within a subtree
+        void searchNearest(size_t begin, size_t end, int axis,
+                           double x, double y, size_t num,
+                           NeighbourQueue &best) const;
+
+        /// @brief The nodes of the implicit tree
+        std::vector<Node> itsNodes;
+};
+
+}
+
+}
+
+}
+
+#endif
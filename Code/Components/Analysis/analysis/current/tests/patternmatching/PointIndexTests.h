@@ -0,0 +1,173 @@
+/// @file
+///
+/// @brief Tests of the PointIndex class and the triangle lists built with it
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#include <patternmatching/PointIndex.h>
+#include <patternmatching/Point.h>
+#include <patternmatching/Triangle.h>
+#include <patternmatching/MatchingUtilities.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <sstream>
+#include <stdlib.h>
+#include <math.h>
+
+namespace askap {
+namespace analysis {
+
+namespace matching {
+
+class PointIndexTest : public CppUnit::TestFixture {
+        CPPUNIT_TEST_SUITE(PointIndexTest);
+        CPPUNIT_TEST(testWithinRadius);
+        CPPUNIT_TEST(testNearest);
+        CPPUNIT_TEST(testNeighbourTriangles);
+        CPPUNIT_TEST(testRejectMultipleMatches);
+        CPPUNIT_TEST_SUITE_END();
+
+    private:
+        std::vector<Point> itsPoints;
+
+    public:
+
+        void setUp()
+        {
+            // a fixed pseudo-random field, with a few coincident points
+            srand(1234);
+            itsPoints.clear();
+            for (int i = 0; i < 300; i++) {
+                std::stringstream id;
+                id << i;
+                double x = 100. * rand() / double(RAND_MAX);
+                double y = 100. * rand() / double(RAND_MAX);
+                if (i % 50 == 49) {
+                    x = itsPoints[i - 1].x();
+                    y = itsPoints[i - 1].y();
+                }
+                itsPoints.push_back(Point(x, y, 1., id.str()));
+            }
+        }
+
+        void testWithinRadius()
+        {
+            PointIndex index(itsPoints);
+            CPPUNIT_ASSERT_EQUAL(itsPoints.size(), index.size());
+            const double radius[3] = {0.5, 5., 30.};
+            for (int r = 0; r < 3; r++) {
+                for (int q = 0; q < 20; q++) {
+                    Point centre(5. * q, 100. - 4. * q);
+                    std::vector<size_t> expected;
+                    for (size_t i = 0; i < itsPoints.size(); i++) {
+                        if (centre.sep(itsPoints[i]) < radius[r]) expected.push_back(i);
+                    }
+                    std::vector<size_t> found =
+                        index.withinRadius(centre.x(), centre.y(), radius[r]);
+                    CPPUNIT_ASSERT(found == expected);
+                }
+            }
+            CPPUNIT_ASSERT(index.withinRadius(50., 50., 0.).empty());
+            CPPUNIT_ASSERT(PointIndex().withinRadius(50., 50., 10.).empty());
+        }
+
+        void testNearest()
+        {
+            PointIndex index(itsPoints);
+            for (int q = 0; q < 20; q++) {
+                Point centre(5. * q, 3. * q);
+                std::vector<std::pair<double, size_t> > sorted;
+                for (size_t i = 0; i < itsPoints.size(); i++) {
+                    double dx = centre.x() - itsPoints[i].x();
+                    double dy = centre.y() - itsPoints[i].y();
+                    sorted.push_back(std::make_pair(dx * dx + dy * dy, i));
+                }
+                std::sort(sorted.begin(), sorted.end());
+                std::vector<size_t> found = index.nearest(centre.x(), centre.y(), 7);
+                CPPUNIT_ASSERT_EQUAL(size_t(7), found.size());
+                for (size_t i = 0; i < found.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL(sorted[i].second, found[i]);
+                }
+            }
+            // asking for more than there is returns everything
+            CPPUNIT_ASSERT_EQUAL(itsPoints.size(), index.nearest(0., 0., 1000).size());
+            CPPUNIT_ASSERT(index.nearest(0., 0., 0).empty());
+        }
+
+        void testNeighbourTriangles()
+        {
+            std::vector<Point> pts(itsPoints.begin(), itsPoints.begin() + 40);
+            std::vector<Triangle> all = getTriList(pts, 10., 0);
+            std::vector<Triangle> some = getTriList(pts, 10., 5);
+            CPPUNIT_ASSERT(some.size() > 0);
+            CPPUNIT_ASSERT(some.size() < all.size());
+            // every neighbour triangle is one of the full list, in the same order
+            size_t j = 0;
+            for (size_t i = 0; i < some.size(); i++) {
+                while (j < all.size() && !sameVertices(all[j], some[i])) j++;
+                CPPUNIT_ASSERT(j < all.size());
+            }
+            // enough neighbours to include every point gives the full list
+            CPPUNIT_ASSERT_EQUAL(all.size(), getTriList(pts, 10., 39).size());
+            // the neighbour mode is the default
+            CPPUNIT_ASSERT_EQUAL(getTriList(pts, 10., defaultNumNeighbours).size(),
+                                 getTriList(pts).size());
+            CPPUNIT_ASSERT(getTriList(pts).size() < all.size());
+        }
+
+        void testRejectMultipleMatches()
+        {
+            std::vector<std::pair<Point, Point> > matches;
+            matches.push_back(std::make_pair(Point(0., 0., 2., "s1"), Point(0., 0., 1., "r1")));
+            matches.push_back(std::make_pair(Point(0., 0., 5., "s2"), Point(0., 0., 5., "r2")));
+            matches.push_back(std::make_pair(Point(0., 0., 1.5, "s3"), Point(0., 0., 1., "r1")));
+            matches.push_back(std::make_pair(Point(0., 0., 3., "s4"), Point(0., 0., 1., "r1")));
+            matches.push_back(std::make_pair(Point(0., 0., 6., "s5"), Point(0., 0., 5., "r2")));
+            rejectMultipleMatches(matches);
+            CPPUNIT_ASSERT_EQUAL(size_t(2), matches.size());
+            CPPUNIT_ASSERT_EQUAL(std::string("s2"), matches[0].first.ID());
+            CPPUNIT_ASSERT_EQUAL(std::string("s3"), matches[1].first.ID());
+        }
+
+    private:
+
+        static bool sameVertices(Triangle &a, Triangle &b)
+        {
+            std::vector<Point> pa = a.getPtList(), pb = b.getPtList();
+            std::set<std::string> ida, idb;
+            for (size_t i = 0; i < pa.size(); i++) {
+                ida.insert(pa[i].ID());
+                idb.insert(pb[i].ID());
+            }
+            return ida == idb;
+        }
+
+};
+
+
+}
+}
+}
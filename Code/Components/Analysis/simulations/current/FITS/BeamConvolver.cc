@@ -0,0 +1,318 @@
+/// @file
+///
+/// Convolution of image planes with a Gaussian beam
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#include <askap_simulations.h>
+
+#include <askap/AskapLogging.h>
+#include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
+
+#include <FITS/BeamConvolver.h>
+
+#include <fft/FFTWrapper.h>
+
+#include <casa/aips.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+#include <casa/BasicSL/Complex.h>
+
+#include <duchamp/Utils/GaussSmooth2D.hh>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <math.h>
+
+ASKAP_LOGGER(logger, ".beamconvolver");
+
+namespace askap {
+namespace simulations {
+namespace FITS {
+
+BeamConvolver::BeamConvolver(float maj, float min, float pa, size_t xdim, size_t ydim):
+    itsMaj(maj), itsMin(min), itsPA(pa), itsXdim(xdim), itsYdim(ydim)
+{
+    ASKAPCHECK(xdim > 0 && ydim > 0, "BeamConvolver needs a non-empty plane");
+
+    // The kernel is the response of GaussSmooth2D to a point source, placed
+    // so that the kernel falls fully inside the image around it.
+    GaussSmooth2D<float> smoother(maj, min, pa);
+    itsWidth = smoother.getKernelWidth();
+    itsHalfWidth = itsWidth / 2;
+    ASKAPCHECK(itsWidth % 2 == 1, "Expect an odd kernel width, have " << itsWidth);
+
+    const size_t h = itsHalfWidth;
+    const size_t n = 4 * h + 1;
+    std::vector<float> impulse(n * n, 0.);
+    impulse[2 * h * n + 2 * h] = 1.;
+    boost::scoped_array<float> response(smoother.smooth(&impulse[0], n, n, SCALEBYCOVERAGE));
+
+    itsKernel.resize(itsWidth * itsWidth);
+    for (size_t j = 0; j < itsWidth; j++) {
+        for (size_t i = 0; i < itsWidth; i++) {
+            itsKernel[j * itsWidth + i] = response[(h + j) * n + h + i];
+        }
+    }
+
+    const float centre = itsKernel[h * itsWidth + h];
+    ASKAPCHECK(centre > 0., "Kernel of the beam has no peak at its centre");
+
+    // a circular or axis-aligned beam gives a kernel that is the
+    // product of its central row and column
+    bool separable = true;
+    for (size_t j = 0; j < itsWidth && separable; j++) {
+        for (size_t i = 0; i < itsWidth && separable; i++) {
+            const float product = itsKernel[h * itsWidth + i] * itsKernel[j * itsWidth + h] / centre;
+            separable = fabs(itsKernel[j * itsWidth + i] - product) <= 1.e-5 * centre;
+        }
+    }
+
+    if (itsWidth <= theirMaxDirectWidth) {
+        itsMethod = DIRECT;
+    } else if (separable && itsWidth <= theirMaxSeparableWidth) {
+        itsMethod = SEPARABLE;
+    } else {
+        itsMethod = FFT;
+    }
+
+    if (itsMethod == SEPARABLE) {
+        itsKernelX.resize(itsWidth);
+        itsKernelY.resize(itsWidth);
+        for (size_t i = 0; i < itsWidth; i++) {
+            itsKernelX[i] = itsKernel[h * itsWidth + i];
+            itsKernelY[i] = itsKernel[i * itsWidth + h] / centre;
+        }
+    }
+
+    if (itsMethod != DIRECT) {
+        // The part of the kernel inside the image, for each pixel, from
+        // the cumulative sums of the kernel. A pixel at x sees kernel
+        // offsets dx (where x-dx is the pixel contributing) from
+        // max(-h, x-xdim+1) to min(h, x).
+        const size_t w1 = itsWidth + 1;
+        std::vector<double> cumul(w1 * w1, 0.);
+        for (size_t j = 0; j < itsWidth; j++) {
+            for (size_t i = 0; i < itsWidth; i++) {
+                cumul[(j + 1) * w1 + i + 1] = itsKernel[j * itsWidth + i] + cumul[j * w1 + i + 1] +
+                                              cumul[(j + 1) * w1 + i] - cumul[j * w1 + i];
+            }
+        }
+        const double total = cumul[itsWidth * w1 + itsWidth];
+
+        std::vector<size_t> xlo(xdim), xhi(xdim);
+        for (size_t x = 0; x < xdim; x++) {
+            // kernel indices are offset by h
+            xlo[x] = (x + 2 * h + 1 > xdim + h) ? x + h + 1 - xdim : 0;
+            xhi[x] = std::min(x + h, 2 * h) + 1;
+        }
+        itsEdgeScale.resize(xdim * ydim);
+        for (size_t y = 0; y < ydim; y++) {
+            const size_t ylo = (y + 2 * h + 1 > ydim + h) ? y + h + 1 - ydim : 0;
+            const size_t yhi = std::min(y + h, 2 * h) + 1;
+            for (size_t x = 0; x < xdim; x++) {
+                const double covered = cumul[yhi * w1 + xhi[x]] - cumul[ylo * w1 + xhi[x]] -
+                                       cumul[yhi * w1 + xlo[x]] + cumul[ylo * w1 + xlo[x]];
+                itsEdgeScale[y * xdim + x] = (covered > 0.) ? total / covered : 0.;
+            }
+        }
+    }
+
+    if (itsMethod == FFT) {
+        // the FFT wrapper has its origin in the middle of the array
+        const size_t nx = fftSize(xdim + h);
+        const size_t ny = fftSize(ydim + h);
+        itsTransfer.resize(casa::IPosition(2, nx, ny));
+        itsTransfer.set(casa::Complex(0., 0.));
+        casa::IPosition pos(2, 0);
+        for (size_t j = 0; j < itsWidth; j++) {
+            pos(1) = ny / 2 + j - h;
+            for (size_t i = 0; i < itsWidth; i++) {
+                pos(0) = nx / 2 + i - h;
+                itsTransfer(pos) = casa::Complex(itsKernel[j * itsWidth + i], 0.);
+            }
+        }
+        scimath::fft2d(itsTransfer, true);
+    }
+
+    ASKAPLOG_DEBUG_STR(logger, "Convolving with a kernel of width " << itsWidth <<
+                       " using the " << this->method() << " method");
+}
+
+std::string BeamConvolver::method() const
+{
+    switch (itsMethod) {
+        case DIRECT: return "direct";
+        case SEPARABLE: return "separable";
+        default: return "fft";
+    }
+}
+
+size_t BeamConvolver::fftSize(size_t n)
+{
+    for (size_t size = std::max(size_t(2), n + n % 2); ; size += 2) {
+        size_t rest = size;
+        while (rest % 2 == 0) rest /= 2;
+        while (rest % 3 == 0) rest /= 3;
+        while (rest % 5 == 0) rest /= 5;
+        if (rest == 1) return size;
+    }
+}
+
+void BeamConvolver::convolve(float *data, size_t nPlanes, float scale) const
+{
+    if (nPlanes == 0) return;
+
+    TaskScheduler &scheduler = TaskScheduler::instance();
+    if (itsMethod == DIRECT) {
+        scheduler.parallelFor(0, nPlanes, boost::bind(&BeamConvolver::convolveDirect, this,
+                              data, scale, _1, _2), "beamconvolve");
+    } else if (itsMethod == SEPARABLE) {
+        scheduler.parallelFor(0, nPlanes, boost::bind(&BeamConvolver::convolveSeparable, this,
+                              data, scale, _1, _2), "beamconvolve");
+    } else {
+        scheduler.parallelFor(0, (nPlanes + 1) / 2, boost::bind(&BeamConvolver::convolveFFT, this,
+                              data, nPlanes, scale, _1, _2), "beamconvolve");
+    }
+}
+
+void BeamConvolver::convolveDirect(float *data, float scale, size_t begin, size_t end) const
+{
+    const size_t planeSize = itsXdim * itsYdim;
+    GaussSmooth2D<float> smoother(itsMaj, itsMin, itsPA);
+    for (size_t plane = begin; plane < end; plane++) {
+        float *image = data + plane * planeSize;
+        boost::scoped_array<float> smoothed(smoother.smooth(image, itsXdim, itsYdim,
+                                                            SCALEBYCOVERAGE));
+        for (size_t pix = 0; pix < planeSize; pix++) {
+            image[pix] = smoothed[pix] / scale;
+        }
+    }
+}
+
+void BeamConvolver::convolveSeparable(float *data, float scale, size_t begin, size_t end) const
+{
+    const size_t planeSize = itsXdim * itsYdim;
+    const size_t h = itsHalfWidth;
+    std::vector<float> rows(planeSize);
+    std::vector<double> sum(itsXdim);
+
+    for (size_t plane = begin; plane < end; plane++) {
+        float *image = data + plane * planeSize;
+
+        // along x: rows[x] = sum over dx of kernelX(dx) image[x-dx]
+        for (size_t y = 0; y < itsYdim; y++) {
+            const float *in = image + y * itsXdim;
+            float *out = &rows[y * itsXdim];
+            for (size_t x = 0; x < itsXdim; x++) {
+                const size_t first = (x + h + 1 > itsXdim) ? x + h + 1 - itsXdim : 0;
+                const size_t last = std::min(x + h, 2 * h);
+                double value = 0.;
+                for (size_t k = first; k <= last; k++) {
+                    value += itsKernelX[k] * in[x + h - k];
+                }
+                out[x] = value;
+            }
+        }
+
+        // along y, a whole row at a time
+        for (size_t y = 0; y < itsYdim; y++) {
+            std::fill(sum.begin(), sum.end(), 0.);
+            const size_t first = (y + h + 1 > itsYdim) ? y + h + 1 - itsYdim : 0;
+            const size_t last = std::min(y + h, 2 * h);
+            for (size_t k = first; k <= last; k++) {
+                const float weight = itsKernelY[k];
+                const float *in = &rows[(y + h - k) * itsXdim];
+                for (size_t x = 0; x < itsXdim; x++) {
+                    sum[x] += weight * in[x];
+                }
+            }
+            float *out = image + y * itsXdim;
+            const float *edge = &itsEdgeScale[y * itsXdim];
+            for (size_t x = 0; x < itsXdim; x++) {
+                out[x] = sum[x] * edge[x] / scale;
+            }
+        }
+    }
+}
+
+void BeamConvolver::convolveFFT(float *data, size_t nPlanes, float scale,
+                                size_t begin, size_t end) const
+{
+    const size_t planeSize = itsXdim * itsYdim;
+    const size_t nx = itsTransfer.shape()(0);
+    casa::Array<casa::Complex> work(itsTransfer.shape());
+    casa::Bool deleteWork, deleteTransfer;
+    casa::Complex *buffer = work.getStorage(deleteWork);
+    const casa::Complex *transfer = itsTransfer.getStorage(deleteTransfer);
+    const size_t nElements = work.nelements();
+
+    for (size_t pair = begin; pair < end; pair++) {
+        // the second plane of the last pair may not exist
+        float *first = data + 2 * pair * planeSize;
+        float *second = (2 * pair + 1 < nPlanes) ? first + planeSize : 0;
+
+        std::fill(buffer, buffer + nElements, casa::Complex(0., 0.));
+        for (size_t y = 0; y < itsYdim; y++) {
+            casa::Complex *row = buffer + y * nx;
+            for (size_t x = 0; x < itsXdim; x++) {
+                row[x] = casa::Complex(first[y * itsXdim + x],
+                                       second ? second[y * itsXdim + x] : 0.);
+            }
+        }
+
+        work.putStorage(buffer, deleteWork);
+        scimath::fft2d(work, true);
+        buffer = work.getStorage(deleteWork);
+        for (size_t i = 0; i < nElements; i++) {
+            buffer[i] *= transfer[i];
+        }
+        work.putStorage(buffer, deleteWork);
+        scimath::fft2d(work, false);
+        buffer = work.getStorage(deleteWork);
+
+        // the kernel is real, so the two planes stay apart
+        for (size_t y = 0; y < itsYdim; y++) {
+            const casa::Complex *row = buffer + y * nx;
+            const float *edge = &itsEdgeScale[y * itsXdim];
+            for (size_t x = 0; x < itsXdim; x++) {
+                first[y * itsXdim + x] = row[x].real() * edge[x] / scale;
+                if (second) {
+                    second[y * itsXdim + x] = row[x].imag() * edge[x] / scale;
+                }
+            }
+        }
+    }
+
+    work.putStorage(buffer, deleteWork);
+    itsTransfer.freeStorage(transfer, deleteTransfer);
+}
+
+}
+}
+}
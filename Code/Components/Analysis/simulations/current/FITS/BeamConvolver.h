@@ -0,0 +1,141 @@
+/// @file
+///
+/// Convolution of image planes with a Gaussian beam
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+#ifndef ASKAP_SIMULATIONS_BEAMCONVOLVER_H_
+#define ASKAP_SIMULATIONS_BEAMCONVOLVER_H_
+
+#include <casa/aips.h>
+#include <casa/Arrays/Array.h>
+#include <casa/BasicSL/Complex.h>
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace askap {
+namespace simulations {
+namespace FITS {
+
+/// @brief Convolution of a stack of image planes with a Gaussian beam
+///
+/// @details The result is the same as smoothing each plane with
+/// duchamp's GaussSmooth2D using the SCALEBYCOVERAGE edge treatment:
+/// the kernel is taken from GaussSmooth2D (as its response to a point
+/// source), and near the edges the sum is scaled up by the fraction of
+/// the kernel that falls outside the image. Depending on the kernel
+/// size, one of three methods is used:
+/// @li "direct": small kernels are done by GaussSmooth2D itself
+/// @li "separable": kernels of a circular or axis-aligned beam are
+/// done as a convolution along x followed by one along y
+/// @li "fft": large kernels are done via the scimath FFT wrapper, with
+/// the transfer function of the beam computed once. Two planes are
+/// transformed together as the real and imaginary parts of one array.
+///
+/// The kernel, the edge scaling and the transfer function depend only
+/// on the beam and the plane size, so they are set up in the
+/// constructor. Planes are processed concurrently with
+/// askap::TaskScheduler tasks.
+class BeamConvolver {
+    public:
+        /// @brief Constructor
+        /// @param maj FWHM of the major axis, in pixels
+        /// @param min FWHM of the minor axis, in pixels
+        /// @param pa Position angle, as passed to GaussSmooth2D
+        /// @param xdim Length of the x axis of a plane
+        /// @param ydim Length of the y axis of a plane
+        BeamConvolver(float maj, float min, float pa, size_t xdim, size_t ydim);
+
+        /// @brief Convolve a stack of planes in place
+        /// @param data Pointer to the first plane. Planes are stored one
+        /// after another, each with x varying fastest.
+        /// @param nPlanes Number of planes
+        /// @param scale Every output value is divided by this
+        void convolve(float *data, size_t nPlanes, float scale = 1.) const;
+
+        /// @brief Name of the method chosen for the kernel
+        std::string method() const;
+
+        /// @brief Width of the (square) kernel in pixels
+        size_t kernelWidth() const {return itsWidth;};
+
+    protected:
+        /// @brief The methods available
+        enum Method {DIRECT, SEPARABLE, FFT};
+
+        /// @brief Kernels up to this width are done with GaussSmooth2D
+        static const size_t theirMaxDirectWidth = 9;
+
+        /// @brief Separable kernels up to this width are done spatially
+        static const size_t theirMaxSeparableWidth = 63;
+
+        /// @brief Convolve a range of planes with GaussSmooth2D
+        void convolveDirect(float *data, float scale, size_t begin, size_t end) const;
+
+        /// @brief Convolve a range of planes with the separable kernel
+        void convolveSeparable(float *data, float scale, size_t begin, size_t end) const;
+
+        /// @brief Convolve a range of pairs of planes via FFT
+        void convolveFFT(float *data, size_t nPlanes, float scale,
+                         size_t begin, size_t end) const;
+
+        /// @brief Smallest even size of at least n with no prime factors above 5
+        static size_t fftSize(size_t n);
+
+        /// @brief Beam parameters, for the GaussSmooth2D of the direct method
+        float itsMaj;
+        float itsMin;
+        float itsPA;
+
+        /// @brief Size of a plane
+        size_t itsXdim;
+        size_t itsYdim;
+
+        /// @brief Kernel width (odd) and half width
+        size_t itsWidth;
+        size_t itsHalfWidth;
+
+        /// @brief The method used
+        Method itsMethod;
+
+        /// @brief The kernel, itsWidth x itsWidth with x varying fastest
+        std::vector<float> itsKernel;
+
+        /// @brief Separable kernel factors along x and y
+        std::vector<float> itsKernelX;
+        std::vector<float> itsKernelY;
+
+        /// @brief Per-pixel factor correcting for the kernel falling off the edge
+        std::vector<float> itsEdgeScale;
+
+        /// @brief Transfer function of the kernel, for the FFT method
+        casa::Array<casa::Complex> itsTransfer;
+};
+
+}
+}
+}
+
+#endif
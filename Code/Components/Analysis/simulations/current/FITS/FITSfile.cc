@@ -30,8 +30,10 @@
 
 #include <askap/AskapLogging.h>
 #include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
 
 #include <FITS/FITSfile.h>
+#include <FITS/BeamConvolver.h>
 #include <simulationutilities/SimulationUtilities.h>
 #include <simulationutilities/FluxGenerator.h>
 
@@ -56,6 +58,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/pointer_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 #include <duchamp/Utils/Section.hh>
 
@@ -70,7 +74,8 @@
 #include <images/Images/ImageInfo.h>
 #include <casa/Arrays/ArrayBase.h>
 
-#include <gsl/gsl_multifit.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_machine.h>
 
 #include <wcslib/wcs.h>
 #include <wcslib/wcshdr.h>
@@ -81,7 +86,6 @@
 #include <fitsio.h>
 #include <duchamp/duchamp.hh>
 #include <duchamp/Utils/utils.hh>
-#include <duchamp/Utils/GaussSmooth2D.hh>
 
 #include <iostream>
 #include <sstream>
@@ -90,6 +94,7 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <algorithm>
 #include <math.h>
 
 ASKAP_LOGGER(logger, ".fitsfile");
@@ -830,12 +835,6 @@ void FITSfile::convolveWithBeam()
         float maj = itsBeamInfo[0] / fabs(itsWCS->cdelt[0]);
         float min = itsBeamInfo[1] / fabs(itsWCS->cdelt[1]);
         float pa = itsBeamInfo[2];
-        GaussSmooth2D<float> smoother(maj, min, pa);
-        ASKAPLOG_DEBUG_STR(logger, "Defined the smoother with beam=(" << maj << ","
-                           << min << "," << pa << "), now to do the smoothing");
-        ASKAPLOG_DEBUG_STR(logger, "Smoothing kernel width = " << smoother.getKernelWidth() <<
-                           ", stddev scale = " << smoother.getStddevScale());
-
         float scaleFactor = 1.;
         if (itsBunit.getName() == "Jy/beam") {
             duchamp::Beam beam(maj, min, pa);
@@ -845,25 +844,15 @@ void FITSfile::convolveWithBeam()
         }
 
         ASKAPASSERT(itsDim <= 4);
-        size_t xySize = itsAxes[0] * itsAxes[1];
-        std::vector<float> image(xySize);
-        int specdim = (itsDim > 2) ? itsAxes[2] : 1;
-        int stokesdim = (itsDim > 3) ? itsAxes[3] : 1;
-        for (int z = 0; z < specdim; z++) {
-            for (int j = 0; j < stokesdim; j++) {
-                for (size_t pix = 0; pix < xySize; pix++) {
-                    image[pix] = itsArray[z * xySize + pix + j * specdim * xySize];
-                }
-                boost::scoped_ptr<float>
-                newArray(smoother.smooth(image.data(), itsAxes[0],
-                                         itsAxes[1], SCALEBYCOVERAGE));
+        size_t specdim = (itsDim > 2) ? itsAxes[2] : 1;
+        size_t stokesdim = (itsDim > 3) ? itsAxes[3] : 1;
+        BeamConvolver convolver(maj, min, pa, itsAxes[0], itsAxes[1]);
+        ASKAPLOG_DEBUG_STR(logger, "Defined the convolver with beam=(" << maj << ","
+                           << min << "," << pa << "), kernel width = " <<
+                           convolver.kernelWidth() << ", using the " <<
+                           convolver.method() << " method");
 
-                for (size_t pix = 0; pix < xySize; pix++) {
-                    itsArray[z * xySize + pix + j * specdim * xySize] =
-                        newArray.get()[pix] / scaleFactor;
-                }
-            }
-        }
+        convolver.convolve(&itsArray[0], specdim * stokesdim, scaleFactor);
 
         ASKAPLOG_DEBUG_STR(logger, "Convolving done.");
 
@@ -1305,14 +1294,18 @@ void FITSfile::defineTaylorTerms()
         }
         const size_t ndata = itsAxes[itsWCS->spec];
         const size_t degree = itsMaxTaylorTerm + 3;
-        double chisq;
-        gsl_matrix *xdat, *cov;
-        gsl_vector *ydat, *w, *c;
-        xdat = gsl_matrix_alloc(ndata, degree);
-        ydat = gsl_vector_alloc(ndata);
-        w = gsl_vector_alloc(ndata);
-        c = gsl_vector_alloc(degree);
-        cov = gsl_matrix_alloc(degree, degree);
+        ASKAPCHECK(ndata >= degree, "Need at least " << degree <<
+                   " channels to fit the Taylor terms, have only " << ndata);
+
+        // The design matrix is the same for every pixel, so the least-squares
+        // solution is a fixed linear map of the log-flux spectrum. Find its
+        // pseudo-inverse once via the SVD, with the same column balancing and
+        // singular value cutoff that gsl_multifit_wlinear uses.
+        gsl_matrix *xdat = gsl_matrix_alloc(ndata, degree);
+        gsl_matrix *v = gsl_matrix_alloc(degree, degree);
+        gsl_vector *s = gsl_vector_alloc(degree);
+        gsl_vector *work = gsl_vector_alloc(degree);
+        std::vector<double> scale(degree, 0.);
 
         for (size_t i = 0; i < ndata; i++) {
             // Set the frequency values, normalised by the reference frequency nuZero.
@@ -1323,58 +1316,130 @@ void FITSfile::defineTaylorTerms()
             float xval = 1.;
             for (size_t d = 0; d < degree; d++) {
                 gsl_matrix_set(xdat, i, d, xval);
+                scale[d] += xval * xval;
                 xval *= logfreq;
             }
-            gsl_vector_set(w, i, 1.);
+        }
+        for (size_t d = 0; d < degree; d++) {
+            scale[d] = (scale[d] > 0.) ? sqrt(scale[d]) : 1.;
+            for (size_t i = 0; i < ndata; i++) {
+                gsl_matrix_set(xdat, i, d, gsl_matrix_get(xdat, i, d) / scale[d]);
+            }
         }
 
-        const size_t xlen = itsAxes[itsWCS->lng];
+        gsl_linalg_SV_decomp(xdat, v, s, work);
+
+        // Only the first three coefficients are needed for the Taylor terms
+        const size_t ncoeff = 3;
+        const double smax = gsl_vector_get(s, 0);
+        std::vector<double> pinv(ncoeff * ndata, 0.);
+        for (size_t d = 0; d < ncoeff; d++) {
+            for (size_t j = 0; j < degree; j++) {
+                const double sj = gsl_vector_get(s, j);
+                if (sj > GSL_DBL_EPSILON * smax) {
+                    const double factor = gsl_matrix_get(v, d, j) / (sj * scale[d]);
+                    for (size_t i = 0; i < ndata; i++) {
+                        pinv[d * ndata + i] += factor * gsl_matrix_get(xdat, i, j);
+                    }
+                }
+            }
+        }
+
+        gsl_vector_free(work);
+        gsl_vector_free(s);
+        gsl_matrix_free(v);
+        gsl_matrix_free(xdat);
+
         const size_t ylen = itsAxes[itsWCS->lat];
-        casa::IPosition outpos(shape.size(), 0);
-        for (size_t y = 0; y < ylen; y++) {
-            outpos[1] = y;
+        const size_t logInterval = std::max(size_t(1), size_t(ylen * itsTTlogevery / 100.));
+        TaskScheduler::instance().parallelFor(0, ylen,
+                                              boost::bind(&FITSfile::fitTaylorTermRows, this,
+                                                          boost::cref(pinv), logInterval, _1, _2),
+                                              "taylorterms");
 
-            for (size_t x = 0; x < xlen; x++) {
-                outpos[0] = x;
+    }
+}
 
-                size_t pos = x + y * xlen;
+void FITSfile::fitTaylorTermRows(const std::vector<double> &pinv, size_t logInterval,
+                                 size_t rowBegin, size_t rowEnd)
+{
+    const size_t xlen = itsAxes[itsWCS->lng];
+    const size_t ylen = itsAxes[itsWCS->lat];
+    const size_t ndata = itsAxes[itsWCS->spec];
+    const size_t planeSize = xlen * ylen;
+
+    float *ttData[3] = {0, 0, 0};
+    for (size_t t = 0; t <= std::min(itsMaxTaylorTerm, 2u); t++) {
+        ttData[t] = itsTTmaps[t].data();
+    }
 
-                if (pos % int(xlen * ylen * itsTTlogevery / 100.) == 0) {
-                    ASKAPLOG_INFO_STR(logger, "Found Taylor terms for " << pos <<
-                                      " spectra out of " << xlen * ylen <<
-                                      " with x=" << x << " and y=" << y);
-                }
+    // coefficients for all pixels of a row, accumulated channel by channel
+    std::vector<double> c0(xlen), c1(xlen), c2(xlen);
+    std::vector<size_t> fitted;
+    fitted.reserve(xlen);
 
-                if (itsArray[pos] > 1.e-20) {
-                    for (size_t i = 0; i < ndata; i++) {
-                        gsl_vector_set(ydat, i, log(itsArray[pos + i * xlen * ylen]));
-                    }
-                    gsl_multifit_linear_workspace * work = gsl_multifit_linear_alloc(ndata,
-                                                           degree);
-                    gsl_multifit_wlinear(xdat, w, ydat, c, cov, &chisq, work);
-                    gsl_multifit_linear_free(work);
-
-                    float Izero = exp(gsl_vector_get(c, 0));
-                    float alpha = gsl_vector_get(c, 1);
-                    float beta = gsl_vector_get(c, 2);
-                    itsTTmaps[0](outpos) = Izero;
-                    if (itsMaxTaylorTerm >= 1) {
-                        itsTTmaps[1](outpos) = Izero * alpha;
-                    }
-                    if (itsMaxTaylorTerm >= 2) {
-                        itsTTmaps[2](outpos) = Izero * (0.5 * alpha * (alpha - 1) + beta);
-                    }
+    for (size_t y = rowBegin; y < rowEnd; y++) {
 
+        if (y % logInterval == 0) {
+            ASKAPLOG_INFO_STR(logger, "Finding Taylor terms for row " << y <<
+                              " out of " << ylen);
+        }
+
+        // Only pixels with positive flux in every channel are fitted, as the
+        // fit is done to the log of the flux. The others are left at zero.
+        const size_t rowStart = y * xlen;
+        fitted.clear();
+        for (size_t x = 0; x < xlen; x++) {
+            if (itsArray[rowStart + x] > 1.e-20) {
+                fitted.push_back(x);
+            }
+        }
+        for (size_t i = 1; i < ndata && fitted.size() > 0; i++) {
+            const float *chan = &itsArray[rowStart + i * planeSize];
+            size_t nkept = 0;
+            for (size_t p = 0; p < fitted.size(); p++) {
+                if (chan[fitted[p]] > 1.e-20) {
+                    fitted[nkept++] = fitted[p];
                 }
             }
+            fitted.resize(nkept);
+        }
+        if (fitted.size() == 0) {
+            continue;
         }
 
-        gsl_matrix_free(cov);
-        gsl_vector_free(c);
-        gsl_vector_free(w);
-        gsl_vector_free(ydat);
-        gsl_matrix_free(xdat);
-        
+        // The row of spectra times the pseudo-inverse, i.e. a
+        // (3 x ndata) by (ndata x npix) matrix product.
+        const size_t npix = fitted.size();
+        std::fill(c0.begin(), c0.begin() + npix, 0.);
+        std::fill(c1.begin(), c1.begin() + npix, 0.);
+        std::fill(c2.begin(), c2.begin() + npix, 0.);
+        for (size_t i = 0; i < ndata; i++) {
+            const float *chan = &itsArray[rowStart + i * planeSize];
+            const double p0 = pinv[i];
+            const double p1 = pinv[ndata + i];
+            const double p2 = pinv[2 * ndata + i];
+            for (size_t p = 0; p < npix; p++) {
+                const double logflux = log(chan[fitted[p]]);
+                c0[p] += p0 * logflux;
+                c1[p] += p1 * logflux;
+                c2[p] += p2 * logflux;
+            }
+        }
+
+        for (size_t p = 0; p < npix; p++) {
+            const size_t pos = rowStart + fitted[p];
+            float Izero = exp(c0[p]);
+            float alpha = c1[p];
+            float beta = c2[p];
+            ttData[0][pos] = Izero;
+            if (ttData[1] != 0) {
+                ttData[1][pos] = Izero * alpha;
+            }
+            if (ttData[2] != 0) {
+                ttData[2][pos] = Izero * (0.5 * alpha * (alpha - 1) + beta);
+            }
+        }
     }
 }
 
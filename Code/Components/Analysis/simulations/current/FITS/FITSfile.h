@@ -195,8 +195,10 @@ class FITSfile {
 
         /// @brief Convolve the flux array with a beam
         /// @brief The array is convolved with the Gaussian beam
-        /// specified in itsBeamInfo. The GaussSmooth2D class from the
-        /// Duchamp library is used. Note that this is only done if
+        /// specified in itsBeamInfo, using a BeamConvolver. This gives
+        /// the same result as Duchamp's GaussSmooth2D, but larger beams
+        /// are done with a separable kernel or via FFT, and the planes
+        /// are processed in parallel. Note that this is only done if
         /// itsHaveBeam is set true.
         void convolveWithBeam();
 
@@ -234,6 +236,20 @@ class FITSfile {
 
     protected:
 
+        /// @brief Fit the Taylor terms for a range of image rows
+        /// @details Applies the pseudo-inverse of the spectral design
+        /// matrix (the first three rows of it, one per fitted
+        /// coefficient) to the log-flux spectrum of every pixel in
+        /// the rows. Pixels without positive flux in every channel
+        /// are skipped and their Taylor terms stay zero. Rows are
+        /// independent, so ranges of rows can be done in parallel.
+        /// @param pinv Pseudo-inverse, 3 x nchan, row-major
+        /// @param logInterval Log progress every this many rows
+        /// @param rowBegin First row to do
+        /// @param rowEnd Row past the last one
+        void fitTaylorTermRows(const std::vector<double> &pinv, size_t logInterval,
+                               size_t rowBegin, size_t rowEnd);
+
         /// @brief The name of the file to be written to
         std::string itsFileName;
         /// @brief Whether to write to a FITS-format image
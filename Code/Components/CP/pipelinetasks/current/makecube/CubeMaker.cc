@@ -39,8 +39,12 @@
 // ASKAPsoft includes
 #include <askap/AskapError.h>
 #include <askap/AskapLogging.h>
+#include <askap/CasaTableLock.h>
 #include <imageaccess/BeamLogger.h>
+#include <imageaccess/CubeAssembler.h>
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <Common/ParameterSet.h>
 #include <casa/Arrays/IPosition.h>
 #include <coordinates/Coordinates/CoordinateSystem.h>
@@ -57,13 +61,15 @@ using namespace askap::cp::pipelinetasks;
 
 /// @details
 /// Read the input parameters from the ParameterSet. Accepted parameters:
-/// 'inputNamePattern', 'outputCube', 'restFrequency', 'beamReference', 'beamLog'.
+/// 'inputNamePattern', 'outputCube', 'restFrequency', 'beamReference', 'beamLog',
+/// 'memoryBudget' (in MB).
 /// Also initialises the cube pointer to zero.
 CubeMaker::CubeMaker(const LOFAR::ParameterSet& parset)
     : itsInputNamePattern(parset.getString("inputNamePattern", "")),
       itsCubeName(parset.getString("outputCube", "")),
       itsBeamReference(parset.getString("beamReference", "mid")),
-      itsBeamLog(parset.getString("beamLog", ""))
+      itsBeamLog(parset.getString("beamLog", "")),
+      itsMemoryBudget(size_t(parset.getUint("memoryBudget", 1024)) * 1024 * 1024)
 {
     const std::string restFreqString = parset.getString("restFrequency", "-1.");
     if (restFreqString == "HI") {
@@ -132,6 +138,8 @@ void CubeMaker::getReferenceData()
 /// The coordinate system for the cube is constructed using the makeCoordinates
 /// function. If required, the rest frequency is added. The cube is then created
 /// using the reference shape and the number of channels in the input file list.
+/// The tiles span as many channels as fit into the memory budget (up to a limit),
+/// so the cube can be written a whole layer of tiles at a time.
 void CubeMaker::createCube()
 {
     casa::CoordinateSystem newCsys = CubeMakerHelperFunctions::makeCoordinates(
@@ -145,7 +153,8 @@ void CubeMaker::createCube()
                       << "  of size approximately " << std::setprecision(2)
                       << (size / 1024.0 / 1024.0 / 1024.0) << "GB. This may take a few minutes.");
 
-    itsCube.reset(new casa::PagedImage<float>(casa::TiledShape(cubeShape), newCsys, itsCubeName));
+    const casa::IPosition tileShape = accessors::CubeAssembler::tileShape(cubeShape, itsMemoryBudget);
+    itsCube.reset(new casa::PagedImage<float>(casa::TiledShape(cubeShape, tileShape), newCsys, itsCubeName));
 }
 
 /// @details
@@ -184,67 +193,53 @@ void CubeMaker::setImageInfo()
 }
 
 /// @details
-/// Each input channel image is added in order to the output cube.
+/// The input channel images are read in parallel and written to the output cube
+/// in batches covering whole tiles along the spectral axis.
 void CubeMaker::writeSlices()
 {
-    for (size_t i = 0; i < itsInputNames.size(); ++i) {
-        if (!writeSlice(i))
-            ASKAPTHROW(AskapError, "Could not write slice #" << i);
-    }
+    if (!itsCube.get()) ASKAPTHROW(AskapError, "Cube not open");
+
+    accessors::CubeAssembler assembler(*itsCube, itsMemoryBudget);
+    assembler.assemble(boost::bind(&CubeMaker::readSlice, this, _1));
 }
 
 //// @details
-/// An individual channel image is added to the cube in the appropriate location.
+/// An individual channel image is read for addition to the cube.
 /// Checks are performed to verify that the channel image has the same shape and
 /// units as the reference (ie. the first in the vector list), and has compatible
 /// coordinates (as defined by the compatibleCoordinates function).
-/// 
+/// This method is called from several threads at the same time.
+///
 /// @param[in] i The number of the image in the vector list
 ///              of input images.
 ///
-/// @return  Returns true if things work. If any checks fail, the index is out
-///          of bounds, or the cube is not yet open, then false is returned
-///          (and an ERROR log message written).
-bool CubeMaker::writeSlice(size_t i)
+/// @return  The pixels of the channel image. If any checks fail or the index is
+///          out of bounds, an exception is thrown.
+casa::Array<float> CubeMaker::readSlice(size_t i) const
 {
-    if (itsCube.get()) {
-        if (i > itsInputNames.size()) {
-            ASKAPLOG_ERROR_STR(logger, "writeSlice - index " << i << " out of bounds");
-            return false;
-        }
+    ASKAPCHECK(i < itsInputNames.size(), "readSlice - index " << i << " out of bounds");
 
-        ASKAPLOG_INFO_STR(logger, "Adding slice from image " << itsInputNames[i]);
-        casa::PagedImage<float> img(itsInputNames[i]);
+    ASKAPLOG_INFO_STR(logger, "Adding slice from image " << itsInputNames[i]);
+    const boost::shared_ptr<casa::PagedImage<float> > img =
+        accessors::CubeAssembler::openImage(itsInputNames[i]);
 
-        // Ensure shape is the same
-        if (img.shape() != itsRefShape) {
-            ASKAPLOG_ERROR_STR(logger, "Error: Input images must all have the same shape");
-            return false;
-        }
+    // casacore is not thread-safe, the image is only accessed with the table lock held
+    CasaTableLock lock;
 
-        // Ensure coordinate system is the same
-        if (!CubeMakerHelperFunctions::compatibleCoordinates(img.coordinates(),
-                    itsRefCoordinates)) {
-            ASKAPLOG_ERROR_STR(logger,
-                               "Error: Input images must all have compatible coordinate systems");
-            return false;
-        }
+    // Ensure shape is the same
+    ASKAPCHECK(img->shape() == itsRefShape, "Error: Input images must all have the same shape, "
+               << itsInputNames[i] << " differs");
 
-        // Ensure units are the same
-        if (img.units() != itsRefUnits) {
-            ASKAPLOG_ERROR_STR(logger, "Error: Input images must all have the same units");
-            return false;
-        }
+    // Ensure coordinate system is the same
+    ASKAPCHECK(CubeMakerHelperFunctions::compatibleCoordinates(img->coordinates(), itsRefCoordinates),
+               "Error: Input images must all have compatible coordinate systems, "
+               << itsInputNames[i] << " differs");
 
-        casa::Array<float> arr = img.get();
-        casa::IPosition where(4, 0, 0, 0, i);
-        itsCube->putSlice(arr, where);
-        return true;
+    // Ensure units are the same
+    ASKAPCHECK(img->units() == itsRefUnits, "Error: Input images must all have the same units, "
+               << itsInputNames[i] << " differs");
 
-    } else {
-        ASKAPLOG_ERROR_STR(logger, "Cube not open");
-        return false;
-    }
+    return img->get();
 }
 
 /// @details
@@ -36,6 +36,7 @@
 // ASKAPsoft includes
 #include <Common/ParameterSet.h>
 #include <boost/scoped_ptr.hpp>
+#include <casa/Arrays/Array.h>
 #include <casa/Arrays/IPosition.h>
 #include <casa/Quanta/Unit.h>
 #include <coordinates/Coordinates/CoordinateSystem.h>
@@ -85,14 +86,17 @@ class CubeMaker {
         /// @brief Write the rest frequency to a coordinate system
         void setRestFreq(casa::CoordinateSystem& csys);
 
-        /// @brief Write an individual channel image to the cube
-        bool writeSlice(size_t i);
+        /// @brief Read and check an individual channel image
+        casa::Array<float> readSlice(size_t i) const;
 
         const std::string itsInputNamePattern;
         const std::string itsCubeName;
         const std::string itsBeamReference;
         const std::string itsBeamLog;
 
+        /// @brief Memory available for buffering channel images [bytes]
+        const size_t itsMemoryBudget;
+
         std::vector<std::string> itsInputNames;
         double itsRestFrequency;
 
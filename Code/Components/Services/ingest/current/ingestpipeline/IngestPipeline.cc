@@ -39,6 +39,7 @@
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
 #include "casa/OS/Timer.h"
+#include "profile/Metrics.h"
 #include "Common/ParameterSet.h"
 #include "cpcommon/VisChunk.h"
 
@@ -59,7 +60,7 @@ using namespace askap::cp::ingest;
 
 IngestPipeline::IngestPipeline(const LOFAR::ParameterSet& parset,
                                int rank, int ntasks)
-    : itsConfig(parset, rank, ntasks), itsRunning(false)
+    : itsConfig(parset, rank, ntasks), itsRunning(false), itsSourceTimer(0)
 {
 }
 
@@ -104,10 +105,12 @@ void IngestPipeline::ingest(void)
         ASKAPTHROW(AskapError, "First task should be a Source");
     }
 
-    // 5) Setup tasks
+    // 5) Setup tasks, each gets a timer metric
+    itsSourceTimer = Metrics::instance().timer("ingest.source");
     for (size_t i = 1; i < tasks.size(); ++i) {
         ITask::ShPtr task = factory.createTask(tasks[i]);
         itsTasks.push_back(task);
+        itsTaskTimers.push_back(Metrics::instance().timer("ingest.task." + task->getName()));
     }
 
     // 6) Process correlator integrations, one at a time
@@ -135,7 +138,11 @@ bool IngestPipeline::ingestOne(void)
     casa::Timer timer;
     ASKAPLOG_DEBUG_STR(logger, "Waiting for data");
     timer.mark();
-    VisChunk::ShPtr chunk(itsSource->next());
+    VisChunk::ShPtr chunk;
+    {
+        const ScopedTimer sourceTimer(itsSourceTimer);
+        chunk = itsSource->next();
+    }
     ASKAPLOG_DEBUG_STR(logger, "Source task execution time " << timer.real() << "s");
     if (chunk.get() == 0) {
         return true; // Finished
@@ -146,6 +153,7 @@ bool IngestPipeline::ingestOne(void)
     // For each task call process on the VisChunk
     for (unsigned int i = 0; i < itsTasks.size(); ++i) {
         timer.mark();
+        const ScopedTimer taskTimer(itsTaskTimers[i]);
         itsTasks[i]->process(chunk);
         ASKAPLOG_DEBUG_STR(logger, itsTasks[i]->getName() << " execution time "
                 << timer.real() << "s");
@@ -33,6 +33,7 @@
 // ASKAPsoft includes
 #include "Common/ParameterSet.h"
 #include "boost/shared_ptr.hpp"
+#include "profile/Metrics.h"
 
 // Local package includes
 #include "ingestpipeline/sourcetask/ISource.h"
@@ -80,6 +81,12 @@ class IngestPipeline {
 
         std::vector<ITask::ShPtr> itsTasks;
 
+        // Timer metric for the source
+        Metrics::Id itsSourceTimer;
+
+        // Timer metrics for the tasks, in the same order as itsTasks
+        std::vector<Metrics::Id> itsTaskTimers;
+
         // No support for assignment
         IngestPipeline& operator=(const IngestPipeline& rhs);
 
@@ -37,6 +37,7 @@
 // ASKAPsoft includes
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
+#include "askap/CasaTableLock.h"
 #include "Common/ParameterSet.h"
 #include "casa/Arrays/Matrix.h"
 #include "casa/Arrays/MatrixMath.h"
@@ -76,10 +77,68 @@ CalcUVWTask::~CalcUVWTask()
     ASKAPLOG_DEBUG_STR(logger, "Destructor");
 }
 
+namespace {
+
+/// @brief per-antenna UVWs for one dish pointing direction
+struct AntennaUVW {
+    casa::MVDirection pointing;
+    casa::Matrix<double> uvw;
+};
+
+}
+
 void CalcUVWTask::process(VisChunk::ShPtr chunk)
 {
+    const casa::uInt nAnt = nAntennas();
+    const casa::Vector<casa::uInt>& antenna1 = chunk->antenna1();
+    const casa::Vector<casa::uInt>& antenna2 = chunk->antenna2();
+    const casa::Vector<casa::uInt>& beam1 = chunk->beam1();
+    const casa::Vector<casa::MVDirection>& phaseCentre1 = chunk->phaseCentre1();
+    casa::Vector<casa::RigidVector<double, 3> >& uvw = chunk->uvw();
+
+    // The measures conversions below read casacore tables, MSSink may be
+    // writing the measurement set from another thread at the same time
+    CasaTableLock lock;
+
+    // Epoch-dependent quantities are the same for all rows
+    const double gast = calcGAST(chunk->time());
+    const casa::MeasFrame frame(casa::MEpoch(chunk->time(), casa::MEpoch::UTC));
+
+    // Per-antenna UVWs are cached per beam. Normally there is just one
+    // dish pointing per beam, but rows can in principle have different ones.
+    std::vector<std::vector<AntennaUVW> > cache(nBeams());
+
     for (casa::uInt row = 0; row < chunk->nRow(); ++row) {
-        calcForRow(chunk, row);
+        const casa::uInt ant1 = antenna1(row);
+        const casa::uInt ant2 = antenna2(row);
+        const casa::uInt beam = beam1(row);
+        ASKAPCHECK(ant1 < nAnt, "Antenna index (" << ant1 << ") is invalid");
+        ASKAPCHECK(ant2 < nAnt, "Antenna index (" << ant2 << ") is invalid");
+        ASKAPCHECK(beam < nBeams(), "Beam index (" << beam << ") is invalid");
+
+        std::vector<AntennaUVW>& beamCache = cache[beam];
+        const casa::MVDirection& pointing = phaseCentre1(row);
+        size_t index = 0;
+        for (; index < beamCache.size(); ++index) {
+            const casa::MVDirection& cached = beamCache[index].pointing;
+            if ((cached(0) == pointing(0)) && (cached(1) == pointing(1)) &&
+                    (cached(2) == pointing(2))) {
+                break;
+            }
+        }
+        if (index == beamCache.size()) {
+            beamCache.push_back(AntennaUVW());
+            beamCache.back().pointing = pointing;
+            calcAntennaUVW(pointing, beam, gast, frame, beamCache.back().uvw);
+        }
+
+        // Baseline uvw is the difference between antenna uvws
+        const double* uvw1 = beamCache[index].uvw.data() + 3 * ant1;
+        const double* uvw2 = beamCache[index].uvw.data() + 3 * ant2;
+        casa::RigidVector<double, 3>& rowUVW = uvw(row);
+        rowUVW(0) = uvw2[0] - uvw1[0];
+        rowUVW(1) = uvw2[1] - uvw1[1];
+        rowUVW(2) = uvw2[2] - uvw1[2];
     }
 }
 
@@ -115,28 +174,17 @@ double CalcUVWTask::calcGAST(const casa::MVEpoch &epoch)
     return (gast - Int(gast)) * C::_2pi; // Into Radians
 }
 
-void CalcUVWTask::calcForRow(VisChunk::ShPtr chunk, const casa::uInt row)
+void CalcUVWTask::calcAntennaUVW(const casa::MDirection& dishPointing, const casa::uInt beam,
+                                 const double gast, const casa::MeasFrame& frame,
+                                 casa::Matrix<double>& antUVW) const
 {
-    const casa::uInt ant1 = chunk->antenna1()(row);
-    const casa::uInt ant2 = chunk->antenna2()(row);
-
-    const casa::uInt nAnt = nAntennas();
-
-    ASKAPCHECK(ant1 < nAnt, "Antenna index (" << ant1 << ") is invalid");
-    ASKAPCHECK(ant2 < nAnt, "Antenna index (" << ant2 << ") is invalid");
-
-    // Determine Greenwich Mean Sidereal Time
-    const double gast = calcGAST(chunk->time()); 
-    casa::MeasFrame frame(casa::MEpoch(chunk->time(), casa::MEpoch::UTC));
-
     // phase center for a given beam
-    //const casa::MDirection fpc = phaseCentre(chunk->phaseCentre1()(row),chunk->beam1()(row));
-    const casa::MDirection fpc = casa::MDirection::Convert(phaseCentre(chunk->phaseCentre1()(row),chunk->beam1()(row)),
+    const casa::MDirection fpc = casa::MDirection::Convert(phaseCentre(dishPointing, beam),
                                     casa::MDirection::Ref(casa::MDirection::TOPO, frame))();
     const double ra = fpc.getAngle().getValue()(0);
     const double dec = fpc.getAngle().getValue()(1);
 
-    // Transformation from antenna position difference (ant2-ant1) to uvw
+    // Transformation from antenna position to uvw
     const double H0 = gast - ra;
     const double sH0 = sin(H0);
     const double cH0 = cos(H0);
@@ -148,39 +196,18 @@ void CalcUVWTask::calcForRow(VisChunk::ShPtr chunk, const casa::uInt row)
     trans(2, 0) = -cd * cH0; trans(2, 1) = cd * sH0; trans(2, 2) = -sd;
 
     // Rotate antennas to correct frame
+    antUVW = casa::product(trans, itsAntXYZ);
+    ASKAPDEBUGASSERT(antUVW.nrow() == 3);
+    ASKAPDEBUGASSERT(antUVW.contiguousStorage());
 
-    /*
-    // there is no need to calculate uvw per antenna here as we recalculate it per row
-    // caching it per row and beam would be the optimal approach in terms of the number of
-    // operations, but we leave such implementation for some time in the future
-
-    Matrix<double> antUVW(3, nAnt);
-    
-    for (uInt i = 0; i < nAnt; ++i) {
-        antUVW.column(i) = casa::product(trans, antXYZ(i));
-    }
-
-    double x1 = antUVW(0, ant1), y1 = antUVW(1, ant1), z1 = antUVW(2, ant1);
-    double x2 = antUVW(0, ant2), y2 = antUVW(1, ant2), z2 = antUVW(2, ant2);
-    Vector<double> uvwvec(3);
-    uvwvec(0) = x2 - x1;
-    uvwvec(1) = y2 - y1;
-    uvwvec(2) = z2 - z1;
-    */
-
-    const Vector<double> baseline = antXYZ(ant2) - antXYZ(ant1);
-    ASKAPDEBUGASSERT(baseline.nelements() == 3);
-    Vector<double> uvwvec = casa::product(trans,baseline);
-    ASKAPDEBUGASSERT(uvwvec.nelements() == 3);
-    // do the conversion to J2000 in a quick and dirty way for now
-    // some optimisation and caching of rotation matrix are definitely possible here
-    // but cache class in accessors needs to be adapted first.
+    // The conversion to J2000 is a rotation, so it can be applied per antenna
     casa::UVWMachine uvm(casa::MDirection::Ref(casa::MDirection::J2000), fpc);
-    uvm.convertUVW(uvwvec);
-    ASKAPDEBUGASSERT(uvwvec.nelements() == 3);
-
-    // Finally set the uvwvec in the VisChunk
-    chunk->uvw()(row) = uvwvec;
+    casa::Vector<double> uvwvec(3);
+    for (casa::uInt ant = 0; ant < antUVW.ncolumn(); ++ant) {
+        uvwvec = antUVW.column(ant);
+        uvm.convertUVW(uvwvec);
+        antUVW.column(ant) = uvwvec;
+    }
 }
 
 /// @brief obtain ITRF coordinates of a given antenna
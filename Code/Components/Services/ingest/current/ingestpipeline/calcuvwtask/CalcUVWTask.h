@@ -32,6 +32,9 @@
 #include "Common/ParameterSet.h"
 #include "scimath/Mathematics/RigidVector.h"
 #include "casa/Arrays/Vector.h"
+#include "casa/Arrays/Matrix.h"
+#include "measures/Measures/MDirection.h"
+#include "measures/Measures/MeasFrame.h"
 #include "cpcommon/VisChunk.h"
 
 // Local package includes
@@ -67,6 +70,9 @@ class CalcUVWTask : public askap::cp::ingest::ITask {
 
         /// @brief Calculates UVW coordinates for each for in the
         /// specified VisChunk.
+        /// @details Epoch conversions are done once per chunk and the
+        /// phase centre conversions once per (dish pointing, beam) pair,
+        /// rather than for every row.
         ///
         /// @param[in,out] chunk  the instance of VisChunk for which UVW
         ///                       coordinates are to be calculated.
@@ -103,8 +109,13 @@ class CalcUVWTask : public askap::cp::ingest::ITask {
         static double calcGAST(const casa::MVEpoch &epoch);
  
     private:
-        // Calculates UVW coordinates for the specified "row" in the "chunk"
-        void calcForRow(askap::cp::common::VisChunk::ShPtr chunk, const casa::uInt row);
+        // Calculates J2000 UVW coordinates of every antenna for the given
+        // (dish pointing, beam) pair. Baseline UVWs are differences of the
+        // columns of the result, as all transformations involved are linear.
+        // The result is a 3 (u, v & w) rows by nAntenna columns matrix.
+        void calcAntennaUVW(const casa::MDirection& dishPointing, const casa::uInt beam,
+                            const double gast, const casa::MeasFrame& frame,
+                            casa::Matrix<double>& antUVW) const;
 
         // Populates the antenna Position Matrix
         void createPositionMatrix(const Configuration& config);
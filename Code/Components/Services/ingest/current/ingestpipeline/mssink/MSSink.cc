@@ -39,6 +39,9 @@
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
 #include <askap/AskapUtil.h>
+#include <askap/CasaTableLock.h>
+#include "boost/bind.hpp"
+#include "boost/shared_ptr.hpp"
 #include "cpcommon/VisChunk.h"
 
 // Casecore includes
@@ -48,7 +51,10 @@
 #include "casa/Arrays/Matrix.h"
 #include "casa/Arrays/Cube.h"
 #include "casa/Arrays/MatrixMath.h"
+#include "casa/Arrays/ArrayUtil.h"
+#include "casa/Arrays/Slicer.h"
 #include "casa/OS/Time.h"
+#include "casa/OS/Timer.h"
 #include "tables/Tables/TableDesc.h"
 #include "tables/Tables/SetupNewTab.h"
 #include "tables/Tables/IncrementalStMan.h"
@@ -74,6 +80,58 @@ using namespace askap::cp::common;
 using namespace askap::cp::ingest;
 using namespace casa;
 
+namespace {
+
+/// @brief make a deep copy of the chunk
+/// @details VisChunk members have reference semantics, so the copy
+/// constructor would share the arrays with the original chunk.
+/// @param[in] chunk chunk to copy
+/// @return a new chunk which does not share any storage with the original
+VisChunk::ShPtr copyChunk(const VisChunk& chunk)
+{
+    VisChunk::ShPtr result(new VisChunk(chunk.nRow(), chunk.nChannel(),
+                chunk.nPol(), chunk.nAntenna()));
+    // shapes match, so the assignments below copy the values
+    result->time() = chunk.time();
+    result->targetName() = chunk.targetName();
+    result->interval() = chunk.interval();
+    result->scan() = chunk.scan();
+    result->antenna1() = chunk.antenna1();
+    result->antenna2() = chunk.antenna2();
+    result->beam1() = chunk.beam1();
+    result->beam2() = chunk.beam2();
+    result->beam1PA() = chunk.beam1PA();
+    result->beam2PA() = chunk.beam2PA();
+    result->phaseCentre1() = chunk.phaseCentre1();
+    result->phaseCentre2() = chunk.phaseCentre2();
+    result->targetPointingCentre() = chunk.targetPointingCentre();
+    result->actualPointingCentre() = chunk.actualPointingCentre();
+    result->actualPolAngle() = chunk.actualPolAngle();
+    result->visibility() = chunk.visibility();
+    result->flag() = chunk.flag();
+    result->uvw() = chunk.uvw();
+    result->frequency() = chunk.frequency();
+    result->channelWidth() = chunk.channelWidth();
+    result->stokes() = chunk.stokes();
+    result->directionFrame() = chunk.directionFrame();
+    return result;
+}
+
+/// @brief write a range of rows into a column
+/// @details The table lock is only held for this call, so the tasks running
+/// in the main thread can use casacore between the column writes.
+/// @param[in] column column to write
+/// @param[in] rows range of rows
+/// @param[in] values values to write (one per row)
+template<typename Column, typename Value>
+void putRows(Column& column, const casa::Slicer& rows, const Value& values)
+{
+    CasaTableLock lock;
+    column.putColumnRange(rows, values);
+}
+
+} // anonymous namespace
+
 //////////////////////////////////
 // Public methods
 //////////////////////////////////
@@ -81,18 +139,38 @@ using namespace casa;
 MSSink::MSSink(const LOFAR::ParameterSet& parset,
         const Configuration& config) :
     itsParset(parset), itsConfig(config), itsPreviousScanIndex(-1),
-    itsFieldRow(-1), itsDataDescRow(-1)
+    itsFieldRow(-1), itsDataDescRow(-1), itsStopWriter(false)
 {
     ASKAPLOG_DEBUG_STR(logger, "Constructor");
     itsPointingTableEnabled = parset.getBool("pointingtable.enable", false);
-    create();
-    initAntennas(); // Includes FEED table
-    initObs();
+    itsAsyncWrite = parset.getBool("asyncwrite", true);
+    {
+        CasaTableLock lock;
+        create();
+        initAntennas(); // Includes FEED table
+        initObs();
+    }
+    if (itsAsyncWrite) {
+        itsWriterThread.reset(new boost::thread(boost::bind(&MSSink::runWriter, this)));
+    }
 }
 
 MSSink::~MSSink()
 {
     ASKAPLOG_DEBUG_STR(logger, "Destructor");
+    if (itsWriterThread.get()) {
+        {
+            boost::mutex::scoped_lock lock(itsWriteMutex);
+            itsStopWriter = true;
+        }
+        itsWriteCondition.notify_all();
+        // the queue is drained before the thread exits
+        itsWriterThread->join();
+        if (!itsWriteError.empty()) {
+            ASKAPLOG_ERROR_STR(logger, "Measurement set is incomplete: " << itsWriteError);
+        }
+    }
+    CasaTableLock lock;
     itsMs.reset();
 }
 
@@ -101,53 +179,109 @@ void MSSink::process(VisChunk::ShPtr chunk)
     // Calculate monitoring points and submit them
     submitMonitoringPoints(chunk);
 
-    // Handle the details for when a new scan starts
-    if (itsPreviousScanIndex != static_cast<casa::Int>(chunk->scan())) {
-        itsFieldRow = findOrAddField(chunk);
-        itsDataDescRow = findOrAddDataDesc(chunk);
-        itsPreviousScanIndex = chunk->scan();
+    if (!itsAsyncWrite) {
+        write(chunk);
+        return;
     }
 
-    MSColumns msc(*itsMs);
-    const casa::uInt baseRow = msc.nrow();
-    const casa::uInt newRows = chunk->nRow();
-    itsMs->addRow(newRows);
+    // the chunk is passed on to the following tasks, which may modify it
+    // while it is being written
+    const VisChunk::ShPtr copy = copyChunk(*chunk);
 
-    // First set the constant things outside the loop,
-    // as they apply to all rows
-    msc.scanNumber().put(baseRow, chunk->scan());
-    msc.fieldId().put(baseRow, itsFieldRow);
-    msc.dataDescId().put(baseRow, itsDataDescRow);
+    boost::mutex::scoped_lock lock(itsWriteMutex);
+    // wait until the previous chunk has been picked up by the writer
+    while (!itsWriteQueue.empty() && itsWriteError.empty()) {
+        itsWriteCondition.wait(lock);
+    }
+    ASKAPCHECK(itsWriteError.empty(), "Failed to write the measurement set: " << itsWriteError);
+    itsWriteQueue.push_back(copy);
+    lock.unlock();
+    itsWriteCondition.notify_all();
+}
 
-    const casa::Quantity chunkMidpoint = chunk->time().getTime();
-    msc.time().put(baseRow, chunkMidpoint.getValue("s"));
-    msc.time().put(baseRow, chunkMidpoint.getValue("s"));
-    msc.timeCentroid().put(baseRow, chunkMidpoint.getValue("s"));
-
-    msc.arrayId().put(baseRow, 0);
-    msc.processorId().put(baseRow, 0);
-    msc.exposure().put(baseRow, chunk->interval());
-    msc.interval().put(baseRow, chunk->interval());
-    msc.observationId().put(baseRow, 0);
-    msc.stateId().put(baseRow, -1);
-
-    for (casa::uInt i = 0; i < newRows; ++i) {
-        const casa::uInt row = i + baseRow;
-        msc.antenna1().put(row, chunk->antenna1()(i));
-        msc.antenna2().put(row, chunk->antenna2()(i));
-        msc.feed1().put(row, chunk->beam1()(i));
-        msc.feed2().put(row, chunk->beam2()(i));
-        msc.uvw().put(row, chunk->uvw()(i).vector());
-
-        msc.data().put(row, casa::transpose(chunk->visibility().yzPlane(i)));
-        msc.flag().put(row, casa::transpose(chunk->flag().yzPlane(i)));
-        msc.flagRow().put(row, False);
-
-        // TODO: Need to get this data from somewhere
-        const Vector<Float> tmp(chunk->nPol(), 1.0);
-        msc.weight().put(row, tmp);
-        msc.sigma().put(row, tmp);
+//////////////////////////////////
+// Private methods
+//////////////////////////////////
+
+void MSSink::runWriter(void)
+{
+    ASKAPLOG_DEBUG_STR(logger, "Writer thread started");
+    while (true) {
+        VisChunk::ShPtr chunk;
+        {
+            boost::mutex::scoped_lock lock(itsWriteMutex);
+            while (itsWriteQueue.empty() && !itsStopWriter) {
+                itsWriteCondition.wait(lock);
+            }
+            if (itsWriteQueue.empty()) {
+                break;
+            }
+            chunk = itsWriteQueue.front();
+            itsWriteQueue.pop_front();
+        }
+        // the slot is free, the next chunk can be queued while this one is written
+        itsWriteCondition.notify_all();
+        try {
+            write(chunk);
+        } catch (const std::exception& ex) {
+            ASKAPLOG_ERROR_STR(logger, "Error writing the measurement set: " << ex.what());
+            boost::mutex::scoped_lock lock(itsWriteMutex);
+            itsWriteError = ex.what();
+            itsWriteQueue.clear();
+            lock.unlock();
+            itsWriteCondition.notify_all();
+            break;
+        }
+    }
+    ASKAPLOG_DEBUG_STR(logger, "Writer thread exiting");
+}
+
+void MSSink::write(VisChunk::ShPtr chunk)
+{
+    casa::Timer timer;
+    writeTables(chunk);
+
+    const double latency = timer.real();
+    const double nBytes = chunk->visibility().size() * sizeof(casa::Complex) +
+        chunk->flag().size() * sizeof(casa::Bool);
+    MonitoringSingleton::update("MSWriteLatency", static_cast<float>(latency),
+            MonitorPointStatus::OK, "s");
+    if (latency > 0) {
+        MonitoringSingleton::update("MSWriteRate", static_cast<float>(nBytes / latency),
+                MonitorPointStatus::OK, "B/s");
+    } else {
+        MonitoringSingleton::invalidatePoint("MSWriteRate");
     }
+}
+
+void MSSink::writeTables(VisChunk::ShPtr chunk)
+{
+    // VisChunk cubes are (row, channel, pol), the tiles of the DATA and FLAG
+    // columns are (pol, channel, row). One reordering for the whole integration
+    // gives arrays which can be passed to the storage manager as is. This is
+    // done before the table lock is taken.
+    const casa::IPosition toMSOrder(3, 2, 1, 0);
+    const casa::Array<casa::Complex> data = casa::reorderArray(chunk->visibility(), toMSOrder);
+    const casa::Array<casa::Bool> flag = casa::reorderArray(chunk->flag(), toMSOrder);
+
+    // the casacore table system is shared with the tasks running in the main
+    // thread, the lock is only held for the table calls and measures conversions
+    {
+        CasaTableLock lock;
+
+        // Handle the details for when a new scan starts
+        if (itsPreviousScanIndex != static_cast<casa::Int>(chunk->scan())) {
+            itsFieldRow = findOrAddField(chunk);
+            itsDataDescRow = findOrAddDataDesc(chunk);
+            itsPreviousScanIndex = chunk->scan();
+        }
+    }
+
+    writeMainRows(*chunk, data, flag);
+
+    CasaTableLock lock;
+    MSColumns msc(*itsMs);
+    const casa::Quantity chunkMidpoint = chunk->time().getTime();
 
     //
     // Update the observation table
@@ -176,9 +310,75 @@ void MSSink::process(VisChunk::ShPtr chunk)
     itsMs->flush();
 }
 
-//////////////////////////////////
-// Private methods
-//////////////////////////////////
+void MSSink::writeMainRows(const VisChunk& chunk, const casa::Array<casa::Complex>& data,
+        const casa::Array<casa::Bool>& flag)
+{
+    const casa::uInt newRows = chunk.nRow();
+    const casa::uInt nPol = chunk.nPol();
+
+    // The values of the columns are prepared without the table lock
+    casa::Vector<casa::Int> antenna1(newRows);
+    casa::convertArray(antenna1, chunk.antenna1());
+    casa::Vector<casa::Int> antenna2(newRows);
+    casa::convertArray(antenna2, chunk.antenna2());
+    casa::Vector<casa::Int> feed1(newRows);
+    casa::convertArray(feed1, chunk.beam1());
+    casa::Vector<casa::Int> feed2(newRows);
+    casa::convertArray(feed2, chunk.beam2());
+    const casa::Vector<casa::Bool> flagRow(newRows, casa::False);
+
+    casa::Matrix<casa::Double> uvw(3, newRows);
+    for (casa::uInt row = 0; row < newRows; ++row) {
+        const casa::RigidVector<casa::Double, 3>& rowUVW = chunk.uvw()(row);
+        uvw(0, row) = rowUVW(0);
+        uvw(1, row) = rowUVW(1);
+        uvw(2, row) = rowUVW(2);
+    }
+
+    // TODO: Need to get this data from somewhere
+    const casa::Matrix<casa::Float> unity(nPol, newRows, 1.0);
+
+    // the columns are destroyed with the table lock held
+    boost::shared_ptr<MSColumns> msc;
+    casa::uInt baseRow = 0;
+    {
+        CasaTableLock lock;
+        msc.reset(new MSColumns(*itsMs), CasaTableLock::Deleter());
+        baseRow = msc->nrow();
+        itsMs->addRow(newRows);
+
+        // First set the constant things, as they apply to all rows
+        // (these columns use the incremental storage manager)
+        msc->scanNumber().put(baseRow, chunk.scan());
+        msc->fieldId().put(baseRow, itsFieldRow);
+        msc->dataDescId().put(baseRow, itsDataDescRow);
+
+        const casa::Double chunkMidpoint = chunk.time().getTime().getValue("s");
+        msc->time().put(baseRow, chunkMidpoint);
+        msc->timeCentroid().put(baseRow, chunkMidpoint);
+
+        msc->arrayId().put(baseRow, 0);
+        msc->processorId().put(baseRow, 0);
+        msc->exposure().put(baseRow, chunk.interval());
+        msc->interval().put(baseRow, chunk.interval());
+        msc->observationId().put(baseRow, 0);
+        msc->stateId().put(baseRow, -1);
+    }
+
+    // Now write the whole integration with one call per column
+    const casa::Slicer rowRange(casa::IPosition(1, baseRow), casa::IPosition(1, newRows));
+
+    putRows(msc->antenna1(), rowRange, antenna1);
+    putRows(msc->antenna2(), rowRange, antenna2);
+    putRows(msc->feed1(), rowRange, feed1);
+    putRows(msc->feed2(), rowRange, feed2);
+    putRows(msc->flagRow(), rowRange, flagRow);
+    putRows(msc->uvw(), rowRange, uvw);
+    putRows(msc->data(), rowRange, data);
+    putRows(msc->flag(), rowRange, flag);
+    putRows(msc->weight(), rowRange, unity);
+    putRows(msc->sigma(), rowRange, unity);
+}
 
 /// @brief make substitution in the file name
 /// @details To simplify configuring the pipeline for different purposes certain
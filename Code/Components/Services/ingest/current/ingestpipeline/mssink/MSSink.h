@@ -27,8 +27,15 @@
 #ifndef ASKAP_CP_INGEST_MSSINK_H
 #define ASKAP_CP_INGEST_MSSINK_H
 
+// System includes
+#include <deque>
+#include <string>
+
 // ASKAPsoft includes
 #include "boost/scoped_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/condition.hpp"
+#include "boost/thread.hpp"
 #include "Common/ParameterSet.h"
 #include "ms/MeasurementSets/MeasurementSet.h"
 #include "casa/aips.h"
@@ -57,6 +64,15 @@ namespace ingest {
 /// the VisChunk passed to process() is the first chunk for a new scan then rows
 /// are added to the SPECTRAL WINDOW, POLARIZATION and DATA DESCRIPTION tables.
 /// The visibilities and related data are also written into the main table.
+///
+/// Unless "asyncwrite" is set to false, the main table is written by a separate
+/// thread. One chunk can wait in the queue while the previous one is being
+/// written, so process() only blocks if the disk cannot keep up. The queued
+/// chunk is a copy, so the following tasks are free to modify the original.
+/// All casacore table access is done with the process-wide CasaTableLock held,
+/// tasks using casacore in the main thread must take the same lock. The lock is
+/// taken for each table call (e.g. one column of the integration) rather than for
+/// the whole integration, so these tasks are not blocked while a chunk is written.
 class MSSink : public askap::cp::ingest::ITask {
     public:
         /// @brief Constructor.
@@ -96,6 +112,24 @@ class MSSink : public askap::cp::ingest::ITask {
         static std::string makeTwoElementString(const casa::uInt in);
           
 
+        // Writes the chunk to the measurement set and updates the monitoring
+        // points. In the asynchronous mode this is only called from the writer thread.
+        void write(askap::cp::common::VisChunk::ShPtr chunk);
+
+        // Updates the measurement set tables for the chunk, this takes
+        // the table lock for the table calls only
+        void writeTables(askap::cp::common::VisChunk::ShPtr chunk);
+
+        // Writes the main table rows for the chunk with one call per column.
+        // The data and flag arrays are already in the order of the columns,
+        // i.e. (pol, channel, row). The table lock is taken for each call.
+        void writeMainRows(const askap::cp::common::VisChunk& chunk,
+                           const casa::Array<casa::Complex>& data,
+                           const casa::Array<casa::Bool>& flag);
+
+        // The main loop for the "writer" thread
+        void runWriter(void);
+
         // Initialises the ANTENNA table
         void initAntennas(void);
 
@@ -196,6 +230,28 @@ class MSSink : public askap::cp::ingest::ITask {
         // Measurement set
         boost::scoped_ptr<casa::MeasurementSet> itsMs;
 
+        // True if the chunks are written by the writer thread
+        bool itsAsyncWrite;
+
+        // Copies of the chunks waiting to be written. There is at most one,
+        // the chunk being written has already been removed from the queue.
+        std::deque<askap::cp::common::VisChunk::ShPtr> itsWriteQueue;
+
+        // Set to request the writer thread to exit once the queue is empty
+        bool itsStopWriter;
+
+        // Error message from the writer thread, reported by process()
+        std::string itsWriteError;
+
+        // Mutex used to synchronise access to the three members above
+        boost::mutex itsWriteMutex;
+
+        // Signalled when the queue or the error state changes
+        boost::condition itsWriteCondition;
+
+        // Writer thread
+        boost::scoped_ptr<boost::thread> itsWriterThread;
+
         // No support for assignment
         MSSink& operator=(const MSSink& rhs);
 
@@ -32,6 +32,7 @@
 // ASKAPsoft includes
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
+#include "askap/CasaTableLock.h"
 
 // casa includes
 #include <measures/Measures/MeasFrame.h>
@@ -152,15 +153,24 @@ void PhaseTrackTask::phaseRotateRow(askap::cp::common::VisChunk::ShPtr chunk,
     ASKAPCHECK(ant1 < nAnt, "Antenna index (" << ant1 << ") is invalid");
     ASKAPCHECK(ant2 < nAnt, "Antenna index (" << ant2 << ") is invalid");
 
-    // Determine Greenwich Apparent Sidereal Time
-    const double gast = calcGAST(chunk->time());
-
-    // Current JTRUE phase center
-    casa::MeasFrame frame(casa::MEpoch(chunk->time(), casa::MEpoch::UTC));
-    const casa::MDirection fpc = casa::MDirection::Convert(phaseCentre(chunk->phaseCentre1()(row), chunk->beam1()(row)),
-                                 casa::MDirection::Ref(casa::MDirection::JTRUE, frame))();
-    const double ra = fpc.getAngle().getValue()(0);
-    const double dec = fpc.getAngle().getValue()(1);
+    double gast = 0.;
+    double ra = 0.;
+    double dec = 0.;
+    {
+        // measures conversions use casacore tables shared with other threads
+        // (e.g. MSSink writer), the phase rotation itself is done without the lock
+        CasaTableLock lock;
+
+        // Determine Greenwich Apparent Sidereal Time
+        gast = calcGAST(chunk->time());
+
+        // Current JTRUE phase center
+        casa::MeasFrame frame(casa::MEpoch(chunk->time(), casa::MEpoch::UTC));
+        const casa::MDirection fpc = casa::MDirection::Convert(phaseCentre(chunk->phaseCentre1()(row), chunk->beam1()(row)),
+                                     casa::MDirection::Ref(casa::MDirection::JTRUE, frame))();
+        ra = fpc.getAngle().getValue()(0);
+        dec = fpc.getAngle().getValue()(1);
+    }
 
     // Transformation from antenna position difference (ant2-ant1) to uvw
     const double H0 = gast - ra;
@@ -0,0 +1,181 @@
+/// @file MSSinkTest.h
+///
+/// @copyright (c) 2010 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// CPPUnit includes
+#include <cppunit/extensions/HelperMacros.h>
+
+// Support classes
+#include <string>
+#include "askap/AskapError.h"
+#include "Common/ParameterSet.h"
+#include "cpcommon/VisChunk.h"
+#include "measures/Measures.h"
+#include "measures/Measures/MEpoch.h"
+#include "measures/Measures/MDirection.h"
+#include "measures/Measures/Stokes.h"
+#include "casa/Quanta/MVEpoch.h"
+#include "tables/Tables/Table.h"
+#include "ms/MeasurementSets/MeasurementSet.h"
+#include "ms/MeasurementSets/MSColumns.h"
+#include "configuration/Configuration.h"
+#include "ConfigurationHelper.h"
+
+// Classes to test
+#include "ingestpipeline/mssink/MSSink.h"
+
+using namespace casa;
+using askap::cp::common::VisChunk;
+
+namespace askap {
+namespace cp {
+namespace ingest {
+
+class MSSinkTest : public CppUnit::TestFixture {
+        CPPUNIT_TEST_SUITE(MSSinkTest);
+        CPPUNIT_TEST(testAsyncWrite);
+        CPPUNIT_TEST(testSyncWrite);
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp() {
+            itsFileName = "MSSinkTest_tmp.ms";
+        };
+
+        void tearDown() {
+            if (casa::Table::isReadable(itsFileName)) {
+                casa::Table::deleteTable(itsFileName);
+            }
+        }
+
+        void testAsyncWrite() {
+            // the chunks are copied and written by the writer thread
+            testDriver(true);
+        }
+
+        void testSyncWrite() {
+            testDriver(false);
+        }
+
+        void testDriver(const bool async) {
+            const casa::uInt nRow = 3;
+            const casa::uInt nChan = 4;
+            const casa::uInt nPol = 4;
+            const casa::uInt nCycles = 3;
+            const double interval = 5.;
+
+            LOFAR::ParameterSet parset;
+            parset.add("filename", itsFileName);
+            parset.add("asyncwrite", async ? "true" : "false");
+
+            const MEpoch startTime(MVEpoch(Quantity(54165.73871, "d")),
+                                   MEpoch::Ref(MEpoch::UTC));
+            {
+                MSSink sink(parset, ConfigurationHelper::createDummyConfig());
+                VisChunk::ShPtr chunk = createChunk(nRow, nChan, nPol);
+                for (casa::uInt cycle = 0; cycle < nCycles; ++cycle) {
+                     chunk->time() = MVEpoch(startTime.getValue().get() + cycle * interval / 86400.);
+                     chunk->visibility().set(casa::Complex(cycle, -1.));
+                     chunk->flag().set(cycle % 2 == 1);
+                     sink.process(chunk);
+                     // tasks following the sink may modify the chunk while it is written
+                     chunk->visibility().set(casa::Complex(-100., 100.));
+                     chunk->flag().set(true);
+                     chunk->antenna1().set(5);
+                }
+            }
+            // the destructor waits until all chunks are written
+
+            const casa::MeasurementSet ms(itsFileName);
+            const ROMSColumns msc(ms);
+            CPPUNIT_ASSERT_EQUAL(nRow * nCycles, ms.nrow());
+            for (casa::uInt row = 0; row < ms.nrow(); ++row) {
+                 const casa::uInt cycle = row / nRow;
+                 CPPUNIT_ASSERT_EQUAL(0, msc.antenna1()(row));
+                 CPPUNIT_ASSERT_EQUAL(static_cast<casa::Int>(row % nRow), msc.antenna2()(row));
+                 CPPUNIT_ASSERT_DOUBLES_EQUAL(interval, msc.interval()(row), 1e-6);
+                 CPPUNIT_ASSERT_DOUBLES_EQUAL(msc.time()(0) + cycle * interval, msc.time()(row), 1e-3);
+                 const casa::Matrix<casa::Complex> data = msc.data()(row);
+                 const casa::Matrix<casa::Bool> flag = msc.flag()(row);
+                 CPPUNIT_ASSERT_EQUAL(nPol, static_cast<casa::uInt>(data.nrow()));
+                 CPPUNIT_ASSERT_EQUAL(nChan, static_cast<casa::uInt>(data.ncolumn()));
+                 for (casa::uInt chan = 0; chan < nChan; ++chan) {
+                      for (casa::uInt pol = 0; pol < nPol; ++pol) {
+                           CPPUNIT_ASSERT_DOUBLES_EQUAL(double(cycle), double(real(data(pol, chan))), 1e-6);
+                           CPPUNIT_ASSERT_DOUBLES_EQUAL(-1., double(imag(data(pol, chan))), 1e-6);
+                           CPPUNIT_ASSERT_EQUAL(cycle % 2 == 1, bool(flag(pol, chan)));
+                      }
+                 }
+            }
+        }
+
+    private:
+        /// @brief create a chunk with autocorrelation and two baselines
+        /// @param[in] nRow number of rows
+        /// @param[in] nChan number of channels
+        /// @param[in] nPol number of polarisations
+        /// @return new chunk
+        static VisChunk::ShPtr createChunk(const casa::uInt nRow, const casa::uInt nChan,
+                                           const casa::uInt nPol) {
+            const MDirection fieldCenter(Quantity(187.5, "deg"),
+                                         Quantity(-45, "deg"),
+                                         MDirection::Ref(MDirection::J2000));
+            const unsigned int nAntenna = 6;
+            VisChunk::ShPtr chunk(new VisChunk(nRow, nChan, nPol, nAntenna));
+            chunk->targetName() = "test-field";
+            chunk->interval() = 5.;
+            chunk->scan() = 0;
+            for (casa::uInt row = 0; row < nRow; ++row) {
+                 chunk->antenna1()(row) = 0;
+                 chunk->antenna2()(row) = row;
+                 chunk->beam1()(row) = 0;
+                 chunk->beam2()(row) = 0;
+                 chunk->beam1PA()(row) = 0.0;
+                 chunk->beam2PA()(row) = 0.0;
+                 chunk->phaseCentre1()(row) = fieldCenter.getAngle();
+                 chunk->phaseCentre2()(row) = fieldCenter.getAngle();
+                 chunk->uvw()(row) = 0.0;
+            }
+            for (casa::uInt chan = 0; chan < nChan; ++chan) {
+                 chunk->frequency()(chan) = 1.4e9 + 1e6 * chan;
+            }
+            chunk->channelWidth() = 1e6;
+            chunk->stokes()(0) = casa::Stokes::XX;
+            chunk->stokes()(1) = casa::Stokes::XY;
+            chunk->stokes()(2) = casa::Stokes::YX;
+            chunk->stokes()(3) = casa::Stokes::YY;
+            chunk->directionFrame() = fieldCenter.getRef();
+            chunk->targetPointingCentre() = fieldCenter;
+            chunk->actualPointingCentre() = fieldCenter;
+            chunk->actualPolAngle() = 0.0;
+            return chunk;
+        }
+
+        /// @brief name of the measurement set written by the tests
+        std::string itsFileName;
+};
+
+}   // End namespace ingest
+}   // End namespace cp
+}   // End namespace askap
@@ -37,6 +37,7 @@
 #include "CalcUVWTaskTest.h"
 #include "ChannelAvgTaskTest.h"
 #include "CalTaskTest.h"
+#include "MSSinkTest.h"
 
 int main(int argc, char *argv[])
 {
@@ -50,6 +51,7 @@ int main(int argc, char *argv[])
     //runner.addTest(askap::cp::ingest::CalcUVWTaskTest::suite());
     runner.addTest(askap::cp::ingest::ChannelAvgTaskTest::suite());
     runner.addTest(askap::cp::ingest::CalTaskTest::suite());
+    runner.addTest(askap::cp::ingest::MSSinkTest::suite());
     bool wasSucessful = runner.run();
 
     return wasSucessful ? 0 : 1;
@@ -32,7 +32,6 @@
 
 // System includes
 #include <vector>
-#include <set>
 #include <complex>
 #include <stdint.h>
 
@@ -64,7 +63,6 @@ ASKAP_LOGGER(logger, ".PublisherApp");
 
 int PublisherApp::run(int argc, char* argv[])
 {
-    const uint32_t N_POLS = 4;
     StatReporter stats;
     const LOFAR::ParameterSet subset = config().makeSubset("vispublisher.");
     const uint16_t inPort = subset.getUint16("in.port");
@@ -88,6 +86,10 @@ int PublisherApp::run(int argc, char* argv[])
     tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), inPort));
     tcp::socket socket(io_service);
     casa::Timer timer;
+
+    // SPD output messages are reused between integrations to avoid
+    // reallocating their (large) vectors each time
+    vector<SpdOutputMessage> spdmsgs;
     while (true) {
         acceptor.accept(socket);
         ASKAPLOG_DEBUG_STR(logger, "Accepted incoming connection from: "
@@ -103,16 +105,12 @@ int PublisherApp::run(int argc, char* argv[])
                 ///////////////////
                 // Publish SPD data
                 ///////////////////
-                const vector<uint32_t> beamvector(inMsg.beam());
-                const set<uint32_t> beamset(beamvector.begin(), beamvector.end());
-                for (set<uint32_t>::const_iterator beamit = beamset.begin();
-                        beamit != beamset.end(); ++beamit) {
-                    for (uint32_t pol = 0; pol < N_POLS; ++pol) {
-                        SpdOutputMessage outmsg = SubsetExtractor::subset(inMsg, *beamit, pol);
-                        ASKAPLOG_DEBUG_STR(logger, "Publishing Spd message for beam " << *beamit
-                                << " pol " << pol);
-                        spdpub.publish(outmsg);
-                    }
+                SubsetExtractor::subsetAll(inMsg, spdmsgs);
+                for (vector<SpdOutputMessage>::iterator it = spdmsgs.begin();
+                        it != spdmsgs.end(); ++it) {
+                    ASKAPLOG_DEBUG_STR(logger, "Publishing Spd message for beam "
+                            << it->beamId() << " pol " << it->polId());
+                    spdpub.publish(*it);
                 }
 
                 ///////////////////
@@ -128,8 +126,7 @@ int PublisherApp::run(int argc, char* argv[])
                     tvChanEnd = tvchan.second;
                 }
 
-                if (tvChanEnd < tvChanBegin
-                        || (tvChanEnd - tvChanBegin + 1) > inMsg.nChannels()) {
+                if (tvChanEnd < tvChanBegin || tvChanEnd >= inMsg.nChannels()) {
                     ASKAPLOG_WARN_STR(logger, "Invalid TV Chan range: "
                             << tvChanBegin << "-" << tvChanEnd);
                     continue;
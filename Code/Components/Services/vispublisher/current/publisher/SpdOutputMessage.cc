@@ -46,6 +46,26 @@ SpdOutputMessage::SpdOutputMessage()
 }
 
 void SpdOutputMessage::encode(zmq::message_t& msg) const
+{
+    const size_t sz = sizeInBytes();
+    msg.rebuild(sz);
+    uint8_t* ptr = encodeTo(static_cast<uint8_t*>(msg.data()));
+
+    // Post-conditions
+    ASKAPASSERT(ptr == static_cast<uint8_t*>(msg.data()) + sz);
+}
+
+void SpdOutputMessage::encode(std::vector<uint8_t>& buf) const
+{
+    const size_t sz = sizeInBytes();
+    buf.resize(sz);
+    uint8_t* ptr = encodeTo(&buf[0]);
+
+    // Post-conditions
+    ASKAPASSERT(ptr == &buf[0] + sz);
+}
+
+uint8_t* SpdOutputMessage::encodeTo(uint8_t* ptr) const
 {
     // Preconditions
     ASKAPASSERT(itsFrequency.size() == itsNChannels);
@@ -54,9 +74,6 @@ void SpdOutputMessage::encode(zmq::message_t& msg) const
     ASKAPASSERT(itsVisibilities.size() == itsNChannels * itsNBaselines);
     ASKAPASSERT(itsFlag.size() == itsNChannels * itsNBaselines);
 
-    const size_t sz = sizeInBytes();
-    msg.rebuild(sz);
-    uint8_t* ptr = static_cast<uint8_t*>(msg.data());
     ptr = pushBack<uint64_t>(itsTimestamp, ptr);
     ptr = pushBack<uint32_t>(itsScan, ptr);
     ptr = pushBack<uint32_t>(itsBeamId, ptr);
@@ -69,9 +86,7 @@ void SpdOutputMessage::encode(zmq::message_t& msg) const
     ptr = pushBackVector<uint32_t>(itsAntenna2, ptr);
     ptr = pushBackVector< std::complex<float> >(itsVisibilities, ptr);
     ptr = pushBackVector<uint8_t>(itsFlag, ptr);
-
-    // Post-conditions
-    ASKAPASSERT(ptr == static_cast<uint8_t*>(msg.data()) + sz);
+    return ptr;
 }
 
 size_t SpdOutputMessage::sizeInBytes(void) const
@@ -98,6 +113,8 @@ template <typename T>
 uint8_t* SpdOutputMessage::pushBackVector(const std::vector<T>& src, uint8_t* ptr)
 {
     const size_t sz = src.size() * sizeof (T);
-    memcpy(ptr, &src[0], sz);
+    if (sz > 0) {
+        memcpy(ptr, &src[0], sz);
+    }
     return ptr + sz;
 }
@@ -31,6 +31,8 @@
 #include "askap_vispublisher.h"
 
 // System includes
+#include <vector>
+#include <map>
 
 // ASKAPsoft includes
 #include "askap/AskapLogging.h"
@@ -102,6 +104,102 @@ SpdOutputMessage SubsetExtractor::subset(const InputMessage& in, uint32_t beam,
     return out;
 }
 
+void SubsetExtractor::subsetAll(const InputMessage& in,
+                                std::vector<SpdOutputMessage>& out)
+{
+    // Pre-conditions
+    ASKAPCHECK(in.beam().size() == in.nRow(), "Beams vector incorrect size");
+    ASKAPCHECK(in.antenna1().size() == in.nRow(), "Antenna 1 vector incorrect size");
+    ASKAPCHECK(in.antenna2().size() == in.nRow(), "Antenna 2 vector incorrect size");
+    ASKAPCHECK(in.stokes().size() == in.nPol(), "Stokes vector incorrect size");
+
+    const uint32_t nRow = in.nRow();
+    const uint32_t nChannels = in.nChannels();
+    const uint32_t nPols = in.nPol();
+    const vector<uint32_t>& beams = in.beam();
+
+    // Map each beam to its output index (ascending beam order) and each
+    // row to its baseline index within that beam
+    map<uint32_t, uint32_t> beamIndex;
+    for (size_t row = 0; row < nRow; ++row) {
+        beamIndex.insert(make_pair(beams[row], 0u));
+    }
+    uint32_t idx = 0;
+    for (map<uint32_t, uint32_t>::iterator it = beamIndex.begin();
+            it != beamIndex.end(); ++it) {
+        it->second = idx++;
+    }
+    const uint32_t nBeams = beamIndex.size();
+
+    vector<uint32_t> rowBeam(nRow);
+    vector<uint32_t> rowBaseline(nRow);
+    vector<uint32_t> nBaselines(nBeams, 0);
+    for (size_t row = 0; row < nRow; ++row) {
+        rowBeam[row] = beamIndex[beams[row]];
+        rowBaseline[row] = nBaselines[rowBeam[row]]++;
+    }
+
+    // Setup the output messages, one per beam/pol, indexed by
+    // (beamIdx * nPols) + polIdx
+    out.resize(nBeams * nPols);
+    for (map<uint32_t, uint32_t>::const_iterator it = beamIndex.begin();
+            it != beamIndex.end(); ++it) {
+        const uint32_t beamIdx = it->second;
+        for (uint32_t polidx = 0; polidx < nPols; ++polidx) {
+            SpdOutputMessage& msg = out[(beamIdx * nPols) + polidx];
+            msg.timestamp() = in.timestamp();
+            msg.scan() = in.scan();
+            msg.beamId() = it->first;
+            msg.polId() = in.stokes()[polidx];
+            msg.nChannels() = nChannels;
+            msg.chanWidth() = in.chanWidth();
+            msg.frequency() = in.frequency();
+            msg.nBaselines() = nBaselines[beamIdx];
+            msg.antenna1().resize(nBaselines[beamIdx]);
+            msg.antenna2().resize(nBaselines[beamIdx]);
+            msg.visibilities().resize(nBaselines[beamIdx] * nChannels);
+            msg.flag().resize(nBaselines[beamIdx] * nChannels);
+        }
+    }
+
+    for (size_t row = 0; row < nRow; ++row) {
+        for (uint32_t polidx = 0; polidx < nPols; ++polidx) {
+            SpdOutputMessage& msg = out[(rowBeam[row] * nPols) + polidx];
+            msg.antenna1()[rowBaseline[row]] = in.antenna1()[row];
+            msg.antenna2()[rowBaseline[row]] = in.antenna2()[row];
+        }
+    }
+
+    ASKAPCHECK(in.visibilities().size() == static_cast<size_t>(nRow) * nChannels * nPols,
+            "Visibility vector incorrect size");
+    ASKAPCHECK(in.flag().size() == in.visibilities().size(), "Flag vector incorrect size");
+    if (in.visibilities().empty()) return;
+
+    // Single pass over the input, which is ordered row fastest, then
+    // channel, then polarisation
+    const complex<float>* invis = &in.visibilities()[0];
+    const uint8_t* inflag = &in.flag()[0];
+    for (uint32_t polidx = 0; polidx < nPols; ++polidx) {
+        // Cache the output pointers for this pol to keep the inner loop tight
+        vector< complex<float>* > outvis(nBeams);
+        vector<uint8_t*> outflag(nBeams);
+        for (uint32_t beamIdx = 0; beamIdx < nBeams; ++beamIdx) {
+            SpdOutputMessage& msg = out[(beamIdx * nPols) + polidx];
+            outvis[beamIdx] = msg.visibilities().empty() ? 0 : &msg.visibilities()[0];
+            outflag[beamIdx] = msg.flag().empty() ? 0 : &msg.flag()[0];
+        }
+
+        for (uint32_t chan = 0; chan < nChannels; ++chan) {
+            const size_t offset = in.index(0, chan, polidx);
+            for (uint32_t row = 0; row < nRow; ++row) {
+                const size_t outidx = chan + (nChannels * rowBaseline[row]);
+                outvis[rowBeam[row]][outidx] = invis[offset + row];
+                outflag[rowBeam[row]][outidx] = inflag[offset + row];
+            }
+        }
+    }
+}
+
 uint32_t SubsetExtractor::makeAntennaVectors(const InputMessage& in, uint32_t beam,
         std::vector<uint32_t>& ant1out, std::vector<uint32_t>& ant2out)
 {
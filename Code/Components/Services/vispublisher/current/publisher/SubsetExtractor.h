@@ -54,6 +54,22 @@ class SubsetExtractor {
         static SpdOutputMessage subset(const InputMessage& in, uint32_t beam,
                                     uint32_t pol);
 
+        /// Extract the subsets for all beams and polarisation products
+        /// present in the InputMessage in a single pass over its data.
+        ///
+        /// The output is equivalent to calling subset() for each beam (in
+        /// ascending order) and each polarisation product (in the order
+        /// they appear in the stokes vector of the InputMessage), but the
+        /// visibilities and flags are read only once.
+        ///
+        /// @param[in] in   the input message from which the subsets will be
+        ///                 extracted.
+        /// @param[out] out the output messages. This vector is resized as
+        ///                 needed, and existing elements (and the capacity of
+        ///                 their vectors) are reused.
+        static void subsetAll(const InputMessage& in,
+                              std::vector<SpdOutputMessage>& out);
+
     private:
 
         /// Creates filtered antenna index vectors.
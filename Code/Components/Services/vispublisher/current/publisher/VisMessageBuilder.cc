@@ -33,16 +33,19 @@
 // System includes
 #include <vector>
 #include <complex>
-#include <utility>
+#include <algorithm>
 #include <cmath>
 
 // ASKAPsoft includes
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
 #include "utils/DelayEstimator.h"
+#include "casa/BasicSL/Complex.h"
+#include "casa/Arrays/Vector.h"
 
 // Local package includes
 #include "publisher/VisOutputMessage.h"
+#include "publisher/VisElement.h"
 #include "publisher/InputMessage.h"
 
 ASKAP_LOGGER(logger, ".VisMessageBuilder");
@@ -56,115 +59,140 @@ VisOutputMessage VisMessageBuilder::build(const InputMessage& in,
 {
     ASKAPCHECK(tvChanEnd >= tvChanBegin, "End chan must be >= start chan");
     const uint32_t nChannel = tvChanEnd - tvChanBegin + 1;
-    ASKAPCHECK(nChannel <= in.nChannels(),
-            "Number of channels selected exceeds number of channels available");
+    ASKAPCHECK(tvChanEnd < in.nChannels(),
+            "Channel range selected exceeds number of channels available");
+    if (nChannel / NCHAN_TO_AVG >= 2) {
+        ASKAPCHECK(nChannel % NCHAN_TO_AVG == 0,
+                "Channels to average must divide nChannels");
+    }
     const uint32_t nRow = in.nRow();
     const uint32_t nPol = in.nPol();
-    const double chanWidth = in.chanWidth();
-    const vector< complex<float> >& invis = in.visibilities();
-    const vector<uint8_t>& inflag = in.flag();
+    ASKAPCHECK(in.visibilities().size() == static_cast<size_t>(nRow) * in.nChannels() * nPol,
+            "Visibility vector incorrect size");
+    ASKAPCHECK(in.flag().size() == in.visibilities().size(), "Flag vector incorrect size");
 
     VisOutputMessage out;
     out.timestamp() = in.timestamp();
     out.chanBegin() = tvChanBegin;
     out.chanEnd() = tvChanEnd;
-    out.data().reserve(nRow * nPol);
-
-    // Process each row, creating nPol VisElements for each row
-    vector< complex<float> > vis(nChannel);
-    vector<bool> flag(nChannel);
-    for (uint32_t row = 0; row < nRow; ++row) {
-        for (uint32_t pol = 0; pol < nPol; ++pol) {
-            VisElement ve;
-            ve.pol = pol;
-            ve.beam = in.beam()[row];
-            ve.antenna1 = in.antenna1()[row];
-            ve.antenna2 = in.antenna2()[row];
-
-            // Build the flag and visibility vectors
-            for (uint32_t chan = tvChanBegin; chan <= tvChanEnd; ++chan) {
-                const size_t idx = in.index(row, chan, pol);
-                vis[chan] = invis[idx];
-                flag[chan] = inflag[idx];
-            }
-
-            // Calculate the summary statistics
-            const std::pair<double, double> ap = ampAndPhase(vis, flag);
-            ve.amplitude = ap.first;
-            ve.phase = ap.second;
-            ve.delay = calcDelay(vis, flag, chanWidth);
-
-            out.data().push_back(ve);
-        }
+    out.data().resize(static_cast<size_t>(nRow) * nPol);
+    if (out.data().empty()) return out;
+
+    // Each unit of work is one polarisation product for a block of rows.
+    // Units write to disjoint elements of the output vector, so no
+    // synchronisation is required.
+    const int nRowBlocks = (nRow + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE;
+    const int nWorkUnits = nRowBlocks * nPol;
+    VisElement* outData = &out.data()[0];
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for (int unit = 0; unit < nWorkUnits; ++unit) {
+        const uint32_t pol = unit % nPol;
+        const uint32_t rowBegin = (unit / nPol) * ROW_BLOCK_SIZE;
+        const uint32_t rowEnd = std::min(rowBegin + ROW_BLOCK_SIZE, nRow);
+        processRows(in, pol, rowBegin, rowEnd, tvChanBegin, tvChanEnd, outData);
     }
 
     return out;
 }
 
-std::pair<double, double> VisMessageBuilder::ampAndPhase(const std::vector< std::complex<float> >& vis,
-                                                       const std::vector<bool>& flag)
-{
-    ASKAPCHECK(vis.size() == flag.size(), "Vis and Flag vectors not equal size");
-
-    std::complex<double> avg(0,0);
-    size_t count = 0;
-    for (size_t i = 0; i < vis.size(); ++i) {
-        if (!flag[i]) {
-            avg += vis[i];
-            ++count;
-        }
-    }
-    if (count > 0) {
-        avg /= static_cast<double>(count);
-    }
-
-    return make_pair(abs(avg), arg(avg) * 180.0 / M_PI);
-}
-
-double VisMessageBuilder::calcDelay(const std::vector< std::complex<float> >& vis,
-                                    const std::vector<bool>& flag,
-                                    const double chanWidth)
+void VisMessageBuilder::processRows(const InputMessage& in,
+        uint32_t pol, uint32_t rowBegin, uint32_t rowEnd,
+        uint32_t tvChanBegin, uint32_t tvChanEnd, VisElement* out)
 {
-    const uint32_t NCHAN_TO_AVG = 54;
+    const uint32_t nPol = in.nPol();
+    const uint32_t nRows = rowEnd - rowBegin;
+    const uint32_t nChannel = tvChanEnd - tvChanBegin + 1;
 
-    if (vis.size() / NCHAN_TO_AVG < 2) return 0.0;
-    ASKAPCHECK(vis.size() % NCHAN_TO_AVG == 0, "Channels to average must divide nChannels");
+    // The delay is estimated from a spectrum averaged to NCHAN_TO_AVG channel
+    // resolution, and only if there are at least two such averaged channels
+    const uint32_t nAvgChan = nChannel / NCHAN_TO_AVG;
+    const bool estimateDelay = nAvgChan >= 2;
+
+    // Accumulators for the whole channel range (double precision) and for the
+    // current block of NCHAN_TO_AVG channels (single precision)
+    vector<double> sumRe(nRows, 0.0);
+    vector<double> sumIm(nRows, 0.0);
+    vector<uint32_t> sumCount(nRows, 0);
+    vector<float> blockRe(nRows);
+    vector<float> blockIm(nRows);
+    vector<uint32_t> blockCount(nRows);
+
+    // Averaged spectra, stored contiguously for each row so they can be
+    // passed to the delay estimator without copying
+    vector<casa::Complex> avgSpectra(estimateDelay ? nRows * nAvgChan : 0);
+
+    const complex<float>* const invis = &in.visibilities()[0];
+    const uint8_t* const inflag = &in.flag()[0];
+
+    uint32_t avgChan = 0;
+    for (uint32_t blockBegin = 0; blockBegin < nChannel;
+            blockBegin += NCHAN_TO_AVG, ++avgChan) {
+        const uint32_t blockEnd = std::min(blockBegin + NCHAN_TO_AVG, nChannel);
+        std::fill(blockRe.begin(), blockRe.end(), 0.0f);
+        std::fill(blockIm.begin(), blockIm.end(), 0.0f);
+        std::fill(blockCount.begin(), blockCount.end(), 0u);
+
+        for (uint32_t chan = blockBegin; chan < blockEnd; ++chan) {
+            // Rows are contiguous in the input for a given channel and pol
+            const size_t offset = in.index(rowBegin, tvChanBegin + chan, pol);
+            const complex<float>* vis = invis + offset;
+            const uint8_t* flag = inflag + offset;
+            for (uint32_t i = 0; i < nRows; ++i) {
+                const bool unflagged = (flag[i] == 0);
+                blockRe[i] += unflagged ? vis[i].real() : 0.0f;
+                blockIm[i] += unflagged ? vis[i].imag() : 0.0f;
+                blockCount[i] += unflagged ? 1u : 0u;
+            }
+        }
 
-    askap::scimath::DelayEstimator de(chanWidth * NCHAN_TO_AVG);
-    const std::vector< std::complex<float> > avg = averageChannels(vis, flag, NCHAN_TO_AVG);
-    return de.getDelay(avg);
-}
+        for (uint32_t i = 0; i < nRows; ++i) {
+            sumRe[i] += blockRe[i];
+            sumIm[i] += blockIm[i];
+            sumCount[i] += blockCount[i];
+        }
 
-std::vector< std::complex<float> > VisMessageBuilder::averageChannels(
-        const std::vector< std::complex<float> >& vis,
-        const std::vector<bool>& flag,
-        uint32_t numberToAverage)
-{
-    ASKAPASSERT(numberToAverage > 0);
-    std::vector< std::complex<float> > avg;
-    const size_t outputVectorSize = vis.size() / numberToAverage;
-    avg.reserve(outputVectorSize);
-    for (size_t i = 0; i < outputVectorSize; i += numberToAverage) {
-        std::complex<float> a(0.0, 0.0);
-        size_t count = 0;
-        for (size_t j = 0; j < numberToAverage; ++j) {
-            if (!flag[i + j]) {
-                a += vis[i + j];
-                ++count;
+        if (estimateDelay && avgChan < nAvgChan) {
+            for (uint32_t i = 0; i < nRows; ++i) {
+                casa::Complex* spectrum = &avgSpectra[i * nAvgChan];
+                if (blockCount[i] > 0) {
+                    spectrum[avgChan] = casa::Complex(blockRe[i], blockIm[i])
+                        / static_cast<float>(blockCount[i]);
+                } else {
+                    // If the whole block of NCHAN_TO_AVG channels is flagged we
+                    // use the value from the neighbouring channel, or zero if
+                    // this is the first
+                    spectrum[avgChan] = (avgChan == 0) ?
+                        casa::Complex(0.0, 0.0) : spectrum[avgChan - 1];
+                }
             }
         }
-        if (count > 0) {
-            avg.push_back(a /= count);
+    }
+
+    const scimath::DelayEstimator de(in.chanWidth() * NCHAN_TO_AVG);
+    for (uint32_t i = 0; i < nRows; ++i) {
+        const uint32_t row = rowBegin + i;
+        VisElement& ve = out[(static_cast<size_t>(row) * nPol) + pol];
+        ve.pol = pol;
+        ve.beam = in.beam()[row];
+        ve.antenna1 = in.antenna1()[row];
+        ve.antenna2 = in.antenna2()[row];
+
+        complex<double> avg(sumRe[i], sumIm[i]);
+        if (sumCount[i] > 0) {
+            avg /= static_cast<double>(sumCount[i]);
+        }
+        ve.amplitude = abs(avg);
+        ve.phase = arg(avg) * 180.0 / M_PI;
+
+        if (estimateDelay) {
+            const casa::Vector<casa::Complex> spectrum(casa::IPosition(1, nAvgChan),
+                    &avgSpectra[i * nAvgChan], casa::SHARE);
+            ve.delay = de.getDelay(spectrum);
         } else {
-            // If the whole block of NCHAN_TO_AVG channels is flagged we try to
-            // use the value from the neighbouring channel, or zero if this is the
-            // first
-            if (avg.empty()) {
-                avg.push_back(0.0);
-            } else {
-                avg.push_back(avg.back());
-            }
+            ve.delay = 0.0;
         }
     }
-    return avg;
 }
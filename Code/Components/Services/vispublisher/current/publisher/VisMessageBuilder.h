@@ -35,6 +35,7 @@
 
 // Local package includes
 #include "publisher/VisOutputMessage.h"
+#include "publisher/VisElement.h"
 #include "publisher/InputMessage.h"
 
 namespace askap {
@@ -43,6 +44,12 @@ namespace vispublisher {
 
 /// @brief Pure utility class used for transforming input visibilities into
 /// Vis summary data (amplitude, phase, delay).
+///
+/// The input message stores visibilities with the row index varying fastest,
+/// so the statistics are accumulated for a block of rows at a time, one
+/// channel after another. This keeps the inner loop unit stride (and
+/// vectorisable) and allows the row blocks to be processed concurrently
+/// when built with OpenMP support.
 class VisMessageBuilder {
     public:
 
@@ -61,25 +68,31 @@ class VisMessageBuilder {
 
     private:
 
-        /// Calculate amplitude and phase
-        static std::pair<double, double> ampAndPhase(
-                const std::vector< std::complex<float> >& vis,
-                const std::vector<bool>& flag);
+        /// Number of channels averaged together prior to delay estimation
+        static const uint32_t NCHAN_TO_AVG = 54;
 
-        /// Estimate delays
-        static double calcDelay(const std::vector< std::complex<float> >& vis,
-                                const std::vector<bool>& flag,
-                                double chanWidth);
+        /// Number of rows processed as one unit of work
+        static const uint32_t ROW_BLOCK_SIZE = 512;
 
-        /// Average channels in vis
-        /// @param[in] vis              input visibilities
-        /// @param[in] numberToAverage  number of visibilities to average
-        ///                             together to form one.
-        /// @return a vector of length (vis.size() / numberToAverage)
-        static std::vector< std::complex<float> > averageChannels(
-            const std::vector< std::complex<float> >& vis,
-            const std::vector<bool>& flag,
-            uint32_t numberToAverage);
+        /// Calculate amplitude, phase and delay for a contiguous range of rows
+        /// and a single polarisation product.
+        ///
+        /// @param[in] in           the input message.
+        /// @param[in] pol          polarisation product index.
+        /// @param[in] rowBegin     first row of the range (inclusive).
+        /// @param[in] rowEnd       last row of the range (exclusive).
+        /// @param[in] tvChanBegin  first channel to use (inclusive).
+        /// @param[in] tvChanEnd    last channel to use (inclusive).
+        /// @param[out] out         the output elements, indexed by
+        ///                         (row * nPol) + pol. Only the elements for
+        ///                         the given rows and polarisation are written.
+        static void processRows(const InputMessage& in,
+                                uint32_t pol,
+                                uint32_t rowBegin,
+                                uint32_t rowEnd,
+                                uint32_t tvChanBegin,
+                                uint32_t tvChanEnd,
+                                VisElement* out);
 };
 
 }
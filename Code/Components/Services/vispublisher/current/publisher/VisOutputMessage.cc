@@ -48,15 +48,29 @@ void VisOutputMessage::encode(zmq::message_t& msg) const
 {
     const size_t sz = sizeInBytes();
     msg.rebuild(sz);
-    uint8_t* ptr = static_cast<uint8_t*>(msg.data());
+    uint8_t* ptr = encodeTo(static_cast<uint8_t*>(msg.data()));
+
+    // Post-conditions
+    ASKAPASSERT(ptr == static_cast<uint8_t*>(msg.data()) + sz);
+}
+
+void VisOutputMessage::encode(std::vector<uint8_t>& buf) const
+{
+    const size_t sz = sizeInBytes();
+    buf.resize(sz);
+    uint8_t* ptr = encodeTo(&buf[0]);
+
+    // Post-conditions
+    ASKAPASSERT(ptr == &buf[0] + sz);
+}
+
+uint8_t* VisOutputMessage::encodeTo(uint8_t* ptr) const
+{
     ptr = pushBack<uint64_t>(itsTimestamp, ptr);
     ptr = pushBack<uint32_t>(itsChanBegin, ptr);
     ptr = pushBack<uint32_t>(itsChanEnd, ptr);
     ptr = pushBack<uint32_t>(itsData.size(), ptr);
-    ptr = pushBackVisElements(itsData, ptr);
-
-    // Post-conditions
-    ASKAPASSERT(ptr == static_cast<uint8_t*>(msg.data()) + sz);
+    return pushBackVisElements(itsData, ptr);
 }
 
 size_t VisOutputMessage::sizeInBytes(void) const
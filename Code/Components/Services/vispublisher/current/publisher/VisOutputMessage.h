@@ -58,6 +58,16 @@ class VisOutputMessage {
         ///                     this class.
         void encode(zmq::message_t& msg) const;
 
+        /// Encodes this instance of VisOutputMessage to the buffer passed.
+        ///
+        /// @param[out] buf     the buffer to populate. The buffer will be
+        ///                     resized to the size of the encoded message.
+        ///                     Any capacity it already has is reused, so a
+        ///                     buffer that is kept between calls will not be
+        ///                     reallocated once it has grown to the size of
+        ///                     the largest message.
+        void encode(std::vector<uint8_t>& buf) const;
+
         /// Binary Atomic Time (BAT) of the correlator integration midpoint.
         /// The number of microseconds since Modified Julian Day (MJD) = 0
         uint64_t& timestamp(void) { return itsTimestamp; };
@@ -78,6 +88,11 @@ class VisOutputMessage {
         /// This is used by encode() to build a message object.
         size_t sizeInBytes(void) const;
 
+        /// Serialises this instance to the memory pointed to by ptr, which
+        /// must have at least sizeInBytes() bytes available.
+        /// @return a pointer to the byte following the encoded message.
+        uint8_t* encodeTo(uint8_t* ptr) const;
+
         template <typename T>
         static uint8_t* pushBack(const T src, uint8_t* ptr);
 
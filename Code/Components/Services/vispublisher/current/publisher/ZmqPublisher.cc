@@ -33,11 +33,13 @@
 // System includes
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 // ASKAPsoft includes
 #include "askap/AskapLogging.h"
 #include "askap/AskapError.h"
 #include "askap/AskapUtil.h"
+#include <boost/thread/mutex.hpp>
 
 // Local package includes
 
@@ -51,14 +53,29 @@ ZmqPublisher::ZmqPublisher(uint16_t port) :itsSocket(itsContext, ZMQ_PUB)
 {
     // Limit the number of buffered messages as we don't want to have the
     // consumer read stale data, rather drop messages if the buffer is full.
-    // Need to buffer one "cycle" worth which is 9-beams x 4-pols
-    const int SEND_HIGH_WATER_MARK = 9 * 4;
+    // Need to buffer one "cycle" worth which is 36-beams x 4-pols
+    const int SEND_HIGH_WATER_MARK = 36 * 4;
     itsSocket.setsockopt(ZMQ_SNDHWM, &SEND_HIGH_WATER_MARK, sizeof (int));
 
     const string endpoint = "tcp://*:" + utility::toString(port);
     itsSocket.bind(endpoint.c_str());
 }
 
+ZmqPublisher::~ZmqPublisher()
+{
+    // Close the socket and context now, rather than as part of member
+    // destruction, so all outstanding messages have been released before
+    // the buffers are deleted.
+    const int LINGER = 0;
+    itsSocket.setsockopt(ZMQ_LINGER, &LINGER, sizeof (int));
+    itsSocket.close();
+    itsContext.close();
+
+    for (size_t i = 0; i < itsAllBuffers.size(); ++i) {
+        delete itsAllBuffers[i];
+    }
+}
+
 void ZmqPublisher::publish(SpdOutputMessage& outmsg)
 {
     // Encode and send the identity (e.g. "0XX")
@@ -72,17 +89,51 @@ void ZmqPublisher::publish(SpdOutputMessage& outmsg)
     itsSocket.send(identity, ZMQ_SNDMORE);
 
     // Encode and send message
-    zmq::message_t msg;
-    outmsg.encode(msg);
-    itsSocket.send(msg);
+    PooledBuffer* buf = acquireBuffer();
+    outmsg.encode(buf->data);
+    send(buf);
 }
 
 void ZmqPublisher::publish(VisOutputMessage& outmsg)
 {
     // Encode and send message
-    zmq::message_t msg;
-    outmsg.encode(msg);
-    itsSocket.send(msg);
+    PooledBuffer* buf = acquireBuffer();
+    outmsg.encode(buf->data);
+    send(buf);
+}
+
+ZmqPublisher::PooledBuffer* ZmqPublisher::acquireBuffer(void)
+{
+    boost::mutex::scoped_lock lock(itsPoolMutex);
+    if (!itsFreeBuffers.empty()) {
+        PooledBuffer* buf = itsFreeBuffers.back();
+        itsFreeBuffers.pop_back();
+        return buf;
+    }
+
+    PooledBuffer* buf = new PooledBuffer;
+    buf->owner = this;
+    itsAllBuffers.push_back(buf);
+    itsFreeBuffers.reserve(itsAllBuffers.size());
+    ASKAPLOG_DEBUG_STR(logger, "Allocated message buffer, pool size is now "
+            << itsAllBuffers.size());
+    return buf;
+}
+
+void ZmqPublisher::send(PooledBuffer* buf, int flags)
+{
+    ASKAPDEBUGASSERT(!buf->data.empty());
+    zmq::message_t msg(&buf->data[0], buf->data.size(), releaseBuffer, buf);
+    itsSocket.send(msg, flags);
+}
+
+void ZmqPublisher::releaseBuffer(void*, void* hint)
+{
+    PooledBuffer* buf = static_cast<PooledBuffer*>(hint);
+    ZmqPublisher* owner = buf->owner;
+    boost::mutex::scoped_lock lock(owner->itsPoolMutex);
+    // Capacity was reserved in acquireBuffer() so this never reallocates
+    owner->itsFreeBuffers.push_back(buf);
 }
 
 std::string ZmqPublisher::polToString(int pol)
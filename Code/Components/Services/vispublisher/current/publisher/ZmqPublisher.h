@@ -30,9 +30,12 @@
 // System includes
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 // ASKAPsoft includes
 #include <zmq.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
 
 // Local package includes
 #include "publisher/SpdOutputMessage.h"
@@ -44,12 +47,21 @@ namespace vispublisher {
 
 /// @brief Encapsulates the code needed to send instance of SpdOutputMessage
 /// to subscribers via ZeroMQ.
-class ZmqPublisher {
+///
+/// Messages are encoded into a pool of reusable buffers which are handed to
+/// ZeroMQ without copying (i.e. via zmq_msg_init_data). ZeroMQ returns each
+/// buffer to the pool, from its I/O thread, once the message has been sent.
+class ZmqPublisher : private boost::noncopyable {
     public:
 
         /// @brief Constructor
         ZmqPublisher(uint16_t port);
 
+        /// @brief Destructor
+        /// Closes the socket (discarding any unsent messages) before
+        /// releasing the buffer pool.
+        ~ZmqPublisher();
+
         /// @brief Publish the SPD output message.
         /// @param[in] outmsg   the SpdOutputMessage to publish. The outmsg is actually
         ///                     not modified (despite the reference being non-const),
@@ -65,10 +77,40 @@ class ZmqPublisher {
         void publish(VisOutputMessage& outmsg);
 
     private:
+        /// A reusable message buffer. The owner pointer allows the ZeroMQ
+        /// free callback to return the buffer to the correct pool.
+        struct PooledBuffer {
+            ZmqPublisher* owner;
+            std::vector<uint8_t> data;
+        };
+
+        /// Returns a buffer from the pool, allocating a new one if the pool
+        /// is empty.
+        PooledBuffer* acquireBuffer(void);
+
+        /// Sends the contents of the buffer without copying. Ownership of
+        /// the buffer passes to ZeroMQ, which returns it to the pool via
+        /// releaseBuffer() once it has been sent (or discarded).
+        void send(PooledBuffer* buf, int flags = 0);
+
+        /// ZeroMQ free function (see zmq_msg_init_data). May be called from
+        /// the ZeroMQ I/O thread.
+        static void releaseBuffer(void* data, void* hint);
+
         /// Converts a polarisation index to a string.
         /// 0="XX", 1="XY", 2="YX", 3="YY"
         static std::string polToString(int pol);
 
+        /// All buffers allocated by this instance. Declared before the
+        /// ZeroMQ objects so the buffers outlive any messages in flight.
+        std::vector<PooledBuffer*> itsAllBuffers;
+
+        /// Buffers available for reuse
+        std::vector<PooledBuffer*> itsFreeBuffers;
+
+        /// Protects itsFreeBuffers
+        boost::mutex itsPoolMutex;
+
         /// ZeroMQ context object
         zmq::context_t itsContext;
 
@@ -56,6 +56,7 @@ class SubsetExtractorTest : public CppUnit::TestFixture {
         CPPUNIT_TEST(testIndexOfFirst);
         CPPUNIT_TEST(testMakeAntennaVectors);
         CPPUNIT_TEST(testSubset);
+        CPPUNIT_TEST(testSubsetAll);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -110,6 +111,33 @@ class SubsetExtractorTest : public CppUnit::TestFixture {
             }
         }
 
+        void testSubsetAll() {
+            std::vector<SpdOutputMessage> all;
+            SubsetExtractor::subsetAll(itsInMsg, all);
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(N_BEAM * N_POL), all.size());
+
+            for (uint32_t beam = 0; beam < N_BEAM; ++beam) {
+                for (uint32_t pol = 0; pol < N_POL; ++pol) {
+                    SpdOutputMessage expected = SubsetExtractor::subset(itsInMsg, beam, pol);
+                    SpdOutputMessage& actual = all[(beam * N_POL) + pol];
+                    CPPUNIT_ASSERT_EQUAL(expected.timestamp(), actual.timestamp());
+                    CPPUNIT_ASSERT_EQUAL(expected.beamId(), actual.beamId());
+                    CPPUNIT_ASSERT_EQUAL(expected.polId(), actual.polId());
+                    CPPUNIT_ASSERT_EQUAL(expected.nChannels(), actual.nChannels());
+                    CPPUNIT_ASSERT_EQUAL(expected.nBaselines(), actual.nBaselines());
+                    CPPUNIT_ASSERT(expected.antenna1() == actual.antenna1());
+                    CPPUNIT_ASSERT(expected.antenna2() == actual.antenna2());
+                    CPPUNIT_ASSERT(expected.visibilities() == actual.visibilities());
+                    CPPUNIT_ASSERT(expected.flag() == actual.flag());
+                }
+            }
+
+            // Output vector is reused when called again
+            SubsetExtractor::subsetAll(itsInMsg, all);
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(N_BEAM * N_POL), all.size());
+            CPPUNIT_ASSERT_EQUAL(N_BASELINE, all[0].nBaselines());
+        }
+
         void testIndexOfFirst() {
             std::vector<uint32_t> v;
             v.push_back(10);
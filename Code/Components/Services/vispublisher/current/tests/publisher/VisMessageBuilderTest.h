@@ -34,6 +34,7 @@
 #include <stdint.h>
 #include <complex>
 #include <vector>
+#include <algorithm>
 #include "publisher/InputMessage.h"
 #include "publisher/VisOutputMessage.h"
 #include "publisher/VisElement.h"
@@ -51,6 +52,8 @@ namespace vispublisher {
 class VisMessageBuilderTest : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(VisMessageBuilderTest);
         CPPUNIT_TEST(testBuild);
+        CPPUNIT_TEST(testAmpAndPhase);
+        CPPUNIT_TEST(testChannelSubset);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -81,6 +84,44 @@ class VisMessageBuilderTest : public CppUnit::TestFixture {
                     data.size());
         }
 
+        void testAmpAndPhase() {
+            const double EPSILON = 1e-3;
+            std::fill(itsInMsg.flag().begin(), itsInMsg.flag().end(), 0);
+
+            VisOutputMessage out = VisMessageBuilder::build(itsInMsg, 0, N_CHAN - 1);
+            const std::vector<VisElement>& data = out.data();
+            for (size_t i = 0; i < data.size(); ++i) {
+                const VisElement& ve = data[i];
+                double expected = 0.0;
+                for (uint32_t chan = 0; chan < N_CHAN; ++chan) {
+                    expected += TestHelperFunctions::visgen(chan, ve.antenna1,
+                            ve.antenna2, ve.beam, ve.pol).real();
+                }
+                expected /= N_CHAN;
+                CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(i % N_POL), ve.pol);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, ve.amplitude, EPSILON);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, ve.phase, EPSILON);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, ve.delay, EPSILON);
+            }
+        }
+
+        void testChannelSubset() {
+            const double EPSILON = 1e-3;
+            std::fill(itsInMsg.flag().begin(), itsInMsg.flag().end(), 0);
+            const uint32_t chan = N_CHAN - 1;
+
+            VisOutputMessage out = VisMessageBuilder::build(itsInMsg, chan, chan);
+            const std::vector<VisElement>& data = out.data();
+            CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(N_BASELINE * N_BEAM * N_POL),
+                    data.size());
+            for (size_t i = 0; i < data.size(); ++i) {
+                const VisElement& ve = data[i];
+                const double expected = TestHelperFunctions::visgen(chan, ve.antenna1,
+                        ve.antenna2, ve.beam, ve.pol).real();
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, ve.amplitude, EPSILON);
+            }
+        }
+
     private:
 
         InputMessage itsInMsg;
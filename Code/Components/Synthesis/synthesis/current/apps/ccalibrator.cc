@@ -105,6 +105,8 @@ class CcalibratorApp : public askap::Application
                     // the master, but doesn't hurt at the worker.
                     calib.removeNextChunkFlag();
                 }
+                // solutions may be buffered to write them in batches
+                calib.flushSolutions();
                 stats.logSummary();
             } catch (const askap::AskapError& x) {
                 ASKAPLOG_FATAL_STR(logger, "Askap error in " << argv[0] << ": " << x.what());
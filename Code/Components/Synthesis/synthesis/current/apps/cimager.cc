@@ -49,6 +49,7 @@
 #include "askap/SignalManagerSingleton.h"
 #include "askap/SignalCounter.h"
 #include "askap/StatReporter.h"
+#include "askap/TaskScheduler.h"
 #include "boost/scoped_ptr.hpp"
 #include <parallel/ImagerParallel.h>
 #include <measurementequation/MEParsetInterface.h>
@@ -91,8 +92,13 @@ class CimagerApp : public askap::Application
                     const int nWorkerGroups = subset.getInt32("nworkergroups", 1);
                     ASKAPCHECK(nWorkerGroups > 0, "nworkergroups is supposed to be greater than 0");
                     if (nWorkerGroups > 1) {
-                        ASKAPLOG_INFO_STR(logger, "Model parameters will be distributed between "<<nWorkerGroups<<
-                                " groups of workers");
+                        if (subset.getBool("distributegrid", false)) {
+                            ASKAPLOG_INFO_STR(logger, "The uv-grid will be split into slabs between "<<nWorkerGroups<<
+                                    " groups of workers");
+                        } else {
+                            ASKAPLOG_INFO_STR(logger, "Model parameters will be distributed between "<<nWorkerGroups<<
+                                    " groups of workers");
+                        }
                         ASKAPCHECK(comms.isParallel(), "This option is only allowed in the parallel mode");
                         comms.defineGroups(nWorkerGroups);
                     } else {
@@ -198,6 +204,7 @@ class CimagerApp : public askap::Application
                     /// This is the final step - restore the image and write it out
                     imager.writeModel();
                 }
+                TaskScheduler::instance().logStatistics();
                 stats.logSummary();
             } catch (const askap::AskapError& x) {
                 ASKAPLOG_FATAL_STR(logger, "Askap error in " << argv[0] << ": " << x.what());
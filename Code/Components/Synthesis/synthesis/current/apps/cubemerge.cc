@@ -35,26 +35,70 @@
 #include <casa/Arrays/IPosition.h>
 #include <CommandLineParser.h>
 #include <askap/AskapError.h>
+#include <askap/CasaTableLock.h>
 #include <coordinates/Coordinates/CoordinateSystem.h>
 #include <coordinates/Coordinates/Coordinate.h>
 #include <coordinates/Coordinates/LinearCoordinate.h>
 #include <casa/Quanta/MVDirection.h>
 #include <imageaccess/CasaImageAccess.h>
+#include <imageaccess/CubeAssembler.h>
 #include <images/Images/PagedImage.h>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
 
 // Using
 using namespace askap;
 using namespace std;
 
+namespace {
+
+/// @brief read one input image
+/// @details This function is called from several threads at the same time. The pixels
+/// are read with the table lock held, as casacore is not thread-safe.
+/// @param[in] inputFiles names of all input images
+/// @param[in] shape shape of the first image
+/// @param[in] i index of the image to read
+/// @return pixels of the image
+casa::Array<float> readInput(const std::vector<std::string> &inputFiles, const casa::IPosition &shape, size_t i)
+{
+    const boost::shared_ptr<casa::PagedImage<float> > img = accessors::CubeAssembler::openImage(inputFiles[i]);
+    casa::Array<float> buf;
+    {
+        CasaTableLock lock;
+        buf = img->get();
+    }
+    ASKAPCHECK(buf.shape().nonDegenerate() == shape.nonDegenerate(), "Image "<<inputFiles[i]<<
+            " has "<<buf.shape()<<" shape which is different from the shape of the first image "<<shape);
+    const float peak = casa::abs(casa::max(buf));
+    const float sum = casa::abs(casa::sum(buf));
+    // format the whole line first, so lines from different threads don't interleave
+    std::ostringstream os;
+    os<<"Image "<<inputFiles[i]<<" has a peak of "<<peak<<", sum of "<<sum << std::endl;
+    std::cout<<os.str()<<std::flush;
+    return buf;
+}
+
+} // anonymous namespace
+
 // Main function
 int main(int argc, const char** argv) { 
     try {
-        if (argc < 3) {
+        cmdlineparser::Parser parser; // a command line parser
+        // command line parameters
+        // memory used to buffer input images before they're written (in MB)
+        cmdlineparser::FlaggedParameter<int> memoryBudgetPar("-m", 1024);
+        parser.add(memoryBudgetPar, cmdlineparser::Parser::return_default);
+        // the remaining arguments are image names
+        int nImages = argc - 1;
+        for (int arg = 1; arg < argc; ++arg) {
+             if (std::string(argv[arg]) == "-m") {
+                 nImages -= 2;
+             }
+        }
+        if (nImages < 2) {
             throw cmdlineparser::XParser();
         }
-        cmdlineparser::Parser parser; // a command line parser
-        // command line parameter
-        std::vector<cmdlineparser::GenericParameter<std::string> > inputParameters(argc-2);     
+        std::vector<cmdlineparser::GenericParameter<std::string> > inputParameters(nImages - 1);     
         for (std::vector<cmdlineparser::GenericParameter<std::string> >::iterator it = inputParameters.begin();
                 it!= inputParameters.end(); ++it) {
             parser.add(*it);
@@ -63,6 +107,9 @@ int main(int argc, const char** argv) {
         parser.add(outfile);
 
         parser.process(argc, argv);
+        ASKAPCHECK(memoryBudgetPar.getValue() > 0, "Memory budget should be positive, you have "<<
+                   memoryBudgetPar.getValue()<<" MB");
+        const size_t memoryBudget = size_t(memoryBudgetPar.getValue()) * 1024 * 1024;
 
         std::vector<std::string> inputFiles(inputParameters.size());
         for (size_t i=0;i<inputFiles.size();++i) {
@@ -85,39 +132,14 @@ int main(int argc, const char** argv) {
         casa::CoordinateSystem csys = ia.coordSys(inputFiles[0]);     
         csys.addCoordinate(casa::LinearCoordinate(1));
 
-        casa::PagedImage<float> outimg(casa::TiledShape(newShape), csys, outfile.getValue());
-        for (size_t i=0; i<inputFiles.size(); ++i) {
-            const casa::Array<float> buf = ia.read(inputFiles[i]);
-            ASKAPCHECK(buf.shape().nonDegenerate() == shape.nonDegenerate(), "Image "<<inputFiles[i]<<
-                    " has "<<buf.shape()<<" shape which is different from the shape of the first image "<<shape);
-
-#ifdef _OPENMP
-            #pragma omp parallel sections
-            {
-                #pragma omp section
-#endif
-                {
-                    const float peak = casa::abs(casa::max(buf));
-                    const float sum = casa::abs(casa::sum(buf));
-                    std::cout<<"Image "<<inputFiles[i]<<" has a peak of "<<peak<<", sum of "<<sum << std::endl;
-                }
-
-#ifdef _OPENMP
-                #pragma omp section
-#endif
-                { 
-                    casa::IPosition where(newShape.nelements(),0);
-                    where[shape.nelements()] = int(i);
-                    outimg.putSlice(buf, where);
-                }
-#ifdef _OPENMP
-            }
-#endif
-        }         
+        casa::PagedImage<float> outimg(casa::TiledShape(newShape, accessors::CubeAssembler::tileShape(newShape, memoryBudget)),
+                                       csys, outfile.getValue());
+        accessors::CubeAssembler assembler(outimg, memoryBudget);
+        assembler.assemble(boost::bind(readInput, boost::cref(inputFiles), boost::cref(shape), _1));
     }
     ///==============================================================================
     catch (const cmdlineparser::XParser &ex) {
-        std::cerr << "Usage: " << argv[0] << " input_cube1 [input_cube2 ... input_cubeLast] output_image"
+        std::cerr << "Usage: " << argv[0] << " [-m memoryBudgetMB] input_cube1 [input_cube2 ... input_cubeLast] output_image"
             << std::endl;
     }
 
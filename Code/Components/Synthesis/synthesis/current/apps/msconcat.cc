@@ -42,18 +42,27 @@
 #include "askap/AskapLogging.h"
 #include "askap/StatReporter.h"
 #include "askap/Log4cxxLogSink.h"
+#include "askap/TaskScheduler.h"
 #include "boost/shared_ptr.hpp"
+#include "boost/bind.hpp"
 #include "CommandLineParser.h"
 #include "casa/OS/File.h"
 #include "casa/aips.h"
 #include "casa/Quanta.h"
 #include "casa/Arrays/Vector.h"
 #include "casa/Arrays/MatrixMath.h"
+#include "casa/Arrays/ArrayMath.h"
+#include "casa/Arrays/ArrayLogical.h"
+#include "casa/Arrays/Slicer.h"
+#include "casa/Utilities/ValType.h"
 #include "tables/Tables/TableDesc.h"
 #include "tables/Tables/SetupNewTab.h"
 #include "tables/Tables/IncrementalStMan.h"
 #include "tables/Tables/StandardStMan.h"
 #include "tables/Tables/TiledShapeStMan.h"
+#include "tables/Tables/ScalarColumn.h"
+#include "tables/Tables/ArrayColumn.h"
+#include "tables/Tables/TableCopy.h"
 
 #include "ms/MeasurementSets/MSConcat.h"
 #include "ms/MeasurementSets/MeasurementSet.h"
@@ -64,6 +73,339 @@ ASKAP_LOGGER(logger, ".msconcat");
 using namespace askap;
 using namespace casa;
 
+// Copies a range of rows of one column. Concrete copiers hold the data read
+// from the input until they are written to the output, so reading and
+// writing can be done by different threads.
+struct ColumnCopier {
+    virtual ~ColumnCopier() {}
+    // Reads the given rows of the input table
+    virtual void read(const casa::Table& in, const casa::Slicer& rows) = 0;
+    // Writes the data read to the given rows of the output table
+    virtual void write(casa::Table& out, const casa::Slicer& rows) const = 0;
+};
+
+template<typename T>
+struct ScalarColumnCopier : public ColumnCopier {
+    explicit ScalarColumnCopier(const std::string& name) : itsName(name) {}
+    virtual void read(const casa::Table& in, const casa::Slicer& rows) {
+        itsBuffer.reference(casa::ROScalarColumn<T>(in, itsName).getColumnRange(rows));
+    }
+    virtual void write(casa::Table& out, const casa::Slicer& rows) const {
+        casa::ScalarColumn<T>(out, itsName).putColumnRange(rows, itsBuffer);
+    }
+private:
+    std::string itsName;
+    casa::Vector<T> itsBuffer;
+};
+
+// Copies an integer ID column adding a constant offset, so IDs of different
+// inputs don't collide
+struct OffsetColumnCopier : public ColumnCopier {
+    OffsetColumnCopier(const std::string& name, casa::Int offset) : itsName(name), itsOffset(offset) {}
+    virtual void read(const casa::Table& in, const casa::Slicer& rows) {
+        itsBuffer.reference(casa::ROScalarColumn<casa::Int>(in, itsName).getColumnRange(rows));
+        itsBuffer += itsOffset;
+    }
+    virtual void write(casa::Table& out, const casa::Slicer& rows) const {
+        casa::ScalarColumn<casa::Int>(out, itsName).putColumnRange(rows, itsBuffer);
+    }
+private:
+    std::string itsName;
+    casa::Int itsOffset;
+    casa::Vector<casa::Int> itsBuffer;
+};
+
+template<typename T>
+struct ArrayColumnCopier : public ColumnCopier {
+    explicit ArrayColumnCopier(const std::string& name) : itsName(name) {}
+    virtual void read(const casa::Table& in, const casa::Slicer& rows) {
+        itsBuffer.reference(casa::ROArrayColumn<T>(in, itsName).getColumnRange(rows));
+    }
+    virtual void write(casa::Table& out, const casa::Slicer& rows) const {
+        casa::ArrayColumn<T> col(out, itsName);
+        if ((col.columnDesc().options() & casa::ColumnDesc::FixedShape) == 0) {
+            // cells of the new rows have no shape yet
+            const casa::IPosition cellShape = itsBuffer.shape().getFirst(itsBuffer.ndim() - 1);
+            for (casa::uInt row = rows.start()(0); row <= casa::uInt(rows.end()(0)); ++row) {
+                col.setShape(row, cellShape);
+            }
+        }
+        col.putColumnRange(rows, itsBuffer);
+    }
+private:
+    std::string itsName;
+    casa::Array<T> itsBuffer;
+};
+
+// Checks whether the fast copy supports the data type of the given column
+bool canCopy(const casa::ColumnDesc& desc)
+{
+    switch (desc.dataType()) {
+        case TpBool:
+        case TpInt:
+        case TpFloat:
+        case TpDouble:
+        case TpComplex:
+        case TpString:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Creates a copier for the given column, which has to pass canCopy
+boost::shared_ptr<ColumnCopier> createCopier(const casa::ColumnDesc& desc)
+{
+    const std::string& name = desc.name();
+    const bool scalar = desc.isScalar();
+    switch (desc.dataType()) {
+        case TpBool:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::Bool>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::Bool>(name));
+        case TpInt:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::Int>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::Int>(name));
+        case TpFloat:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::Float>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::Float>(name));
+        case TpDouble:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::Double>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::Double>(name));
+        case TpComplex:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::Complex>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::Complex>(name));
+        case TpString:
+            return scalar ? boost::shared_ptr<ColumnCopier>(new ScalarColumnCopier<casa::String>(name)) :
+                            boost::shared_ptr<ColumnCopier>(new ArrayColumnCopier<casa::String>(name));
+        default:
+            ASKAPTHROW(AskapError, "Column " << name << " has a data type not supported by the fast copy");
+    }
+}
+
+// A block of rows of one input, all columns of the output are read
+struct RowBlock {
+    // index of the input
+    size_t input;
+    // offsets added to SCAN_NUMBER and OBSERVATION_ID
+    casa::Int scanOffset;
+    casa::Int obsOffset;
+    // rows in the input
+    casa::Slicer inRows;
+    // rows in the output
+    casa::Slicer outRows;
+    // data of each column
+    std::vector<boost::shared_ptr<ColumnCopier> > columns;
+};
+
+// Creates the copiers of all columns for the given block
+void createCopiers(const casa::TableDesc& desc, RowBlock& block)
+{
+    const std::string scanName = MS::columnName(MS::SCAN_NUMBER);
+    const std::string obsName = MS::columnName(MS::OBSERVATION_ID);
+    for (casa::uInt col = 0; col < desc.ncolumn(); ++col) {
+        const std::string& name = desc[col].name();
+        if (name == scanName) {
+            block.columns.push_back(boost::shared_ptr<ColumnCopier>(new OffsetColumnCopier(name, block.scanOffset)));
+        } else if (name == obsName) {
+            block.columns.push_back(boost::shared_ptr<ColumnCopier>(new OffsetColumnCopier(name, block.obsOffset)));
+        } else {
+            block.columns.push_back(createCopier(desc[col]));
+        }
+    }
+}
+
+// Reads a block of rows, done by a separate task. No CasaTableLock is taken:
+// only one read task runs at a time and it only touches the input table, while
+// the main thread only writes the output, which is a different table (it is
+// created by copying the first input). The tables are opened before and
+// closed after the tasks run, both by the main thread.
+void readBlock(const casa::Table* in, RowBlock* block)
+{
+    for (size_t col = 0; col < block->columns.size(); ++col) {
+        block->columns[col]->read(*in, block->inRows);
+    }
+}
+
+// Writes a block of rows into the output
+void writeBlock(const RowBlock& block, casa::Table& out)
+{
+    for (size_t col = 0; col < block.columns.size(); ++col) {
+        block.columns[col]->write(out, block.outRows);
+    }
+}
+
+// Checks that an array column of a subtable is the same in two measurement sets
+template<typename T>
+bool sameArrayColumn(const casa::Table& t1, const casa::Table& t2, const std::string& name)
+{
+    if (t1.nrow() != t2.nrow()) {
+        return false;
+    }
+    const casa::ROArrayColumn<T> c1(t1, name);
+    const casa::ROArrayColumn<T> c2(t2, name);
+    for (casa::uInt row = 0; row < t1.nrow(); ++row) {
+        const casa::Array<T> a1 = c1(row);
+        const casa::Array<T> a2 = c2(row);
+        if (!a1.shape().isEqual(a2.shape()) || !casa::allEQ(a1, a2)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks that a scalar column of a subtable is the same in two measurement sets
+template<typename T>
+bool sameScalarColumn(const casa::Table& t1, const casa::Table& t2, const std::string& name)
+{
+    if (t1.nrow() != t2.nrow()) {
+        return false;
+    }
+    return casa::allEQ(casa::ROScalarColumn<T>(t1, name).getColumn(),
+                       casa::ROScalarColumn<T>(t2, name).getColumn());
+}
+
+// Checks whether the given measurement set can be appended to the first one
+// by copying the main table rows only, i.e. whether all subtables referred to
+// by the main table are the same and the main table has the same columns of
+// the types supported by the fast copy. The OBSERVATION table may differ, its rows
+// are appended. This is done once for each input, before any data are copied.
+bool canAppendRows(const casa::MeasurementSet& first, const casa::MeasurementSet& ms)
+{
+    const casa::TableDesc& desc = first.tableDesc();
+    casa::Bool equalDataTypes = casa::False;
+    if (!ms.tableDesc().isEqual(desc, equalDataTypes) || !equalDataTypes) {
+        ASKAPLOG_INFO_STR(logger, "Main table columns differ");
+        return false;
+    }
+    for (casa::uInt col = 0; col < desc.ncolumn(); ++col) {
+        if (!canCopy(desc[col])) {
+            ASKAPLOG_INFO_STR(logger, "Column " << desc[col].name() << " has a data type not supported by the fast copy");
+            return false;
+        }
+    }
+    if (ms.pointing().nrow() != 0) {
+        ASKAPLOG_INFO_STR(logger, "POINTING table is not empty");
+        return false;
+    }
+    if (!sameScalarColumn<casa::String>(first.antenna(), ms.antenna(), MSAntenna::columnName(MSAntenna::NAME)) ||
+        !sameArrayColumn<casa::Double>(first.antenna(), ms.antenna(), MSAntenna::columnName(MSAntenna::POSITION))) {
+        ASKAPLOG_INFO_STR(logger, "ANTENNA tables differ");
+        return false;
+    }
+    if (!sameScalarColumn<casa::Int>(first.feed(), ms.feed(), MSFeed::columnName(MSFeed::ANTENNA_ID)) ||
+        !sameScalarColumn<casa::Int>(first.feed(), ms.feed(), MSFeed::columnName(MSFeed::FEED_ID)) ||
+        !sameArrayColumn<casa::Double>(first.feed(), ms.feed(), MSFeed::columnName(MSFeed::BEAM_OFFSET))) {
+        ASKAPLOG_INFO_STR(logger, "FEED tables differ");
+        return false;
+    }
+    if (!sameArrayColumn<casa::Double>(first.field(), ms.field(), MSField::columnName(MSField::PHASE_DIR))) {
+        ASKAPLOG_INFO_STR(logger, "FIELD tables differ");
+        return false;
+    }
+    if (!sameArrayColumn<casa::Double>(first.spectralWindow(), ms.spectralWindow(),
+                                       MSSpectralWindow::columnName(MSSpectralWindow::CHAN_FREQ))) {
+        ASKAPLOG_INFO_STR(logger, "SPECTRAL_WINDOW tables differ");
+        return false;
+    }
+    if (!sameArrayColumn<casa::Int>(first.polarization(), ms.polarization(),
+                                    MSPolarization::columnName(MSPolarization::CORR_TYPE))) {
+        ASKAPLOG_INFO_STR(logger, "POLARIZATION tables differ");
+        return false;
+    }
+    if (!sameScalarColumn<casa::Int>(first.dataDescription(), ms.dataDescription(),
+                   MSDataDescription::columnName(MSDataDescription::SPECTRAL_WINDOW_ID)) ||
+        !sameScalarColumn<casa::Int>(first.dataDescription(), ms.dataDescription(),
+                   MSDataDescription::columnName(MSDataDescription::POLARIZATION_ID))) {
+        ASKAPLOG_INFO_STR(logger, "DATA_DESCRIPTION tables differ");
+        return false;
+    }
+    return true;
+}
+
+// Appends the main table rows of the inputs to the output, which already
+// contains the first input. All rows are added up front, then blocks of rows
+// are copied column by column with large range transfers. The next block is
+// read by a separate task while the current one is written.
+// As done by MSConcat, the OBSERVATION rows of each input are appended and
+// OBSERVATION_ID is offset accordingly, and SCAN_NUMBER is offset so that the
+// scans of each input follow those already in the output.
+void appendRows(const std::vector< boost::shared_ptr<const casa::MeasurementSet> >& in,
+                casa::MeasurementSet& out)
+{
+    const casa::uInt firstRow = out.nrow();
+    casa::uInt nRowsTotal = firstRow;
+    std::vector<casa::Int> scanOffsets(in.size(), 0);
+    std::vector<casa::Int> obsOffsets(in.size(), 0);
+    casa::Int maxScan = firstRow > 0 ? casa::max(ROMSMainColumns(out).scanNumber().getColumn()) : 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        const casa::uInt nRows = in[i]->nrow();
+        nRowsTotal += nRows;
+        if (nRows > 0) {
+            const casa::Vector<casa::Int> scans = ROMSMainColumns(*in[i]).scanNumber().getColumn();
+            scanOffsets[i] = maxScan + 1 - casa::min(scans);
+            maxScan = casa::max(scans) + scanOffsets[i];
+        }
+        // observations of this input go after those already in the output
+        casa::Table obsOut = out.observation();
+        const casa::Table& obsIn = in[i]->observation();
+        obsOffsets[i] = obsOut.nrow();
+        obsOut.addRow(obsIn.nrow());
+        casa::TableCopy::copyRows(obsOut, obsIn, obsOffsets[i], 0, obsIn.nrow());
+    }
+    out.addRow(nRowsTotal - firstRow);
+    ASKAPLOG_INFO_STR(logger, "Output has " << nRowsTotal << " rows");
+
+    // Decide how many rows to process simultaneously from the size of the
+    // first row. Two blocks are held in memory, assume 64MB for each.
+    const casa::TableDesc& desc = out.tableDesc();
+    std::size_t rowSize = 0;
+    for (casa::uInt col = 0; col < desc.ncolumn(); ++col) {
+        const casa::ColumnDesc& cd = desc[col];
+        const std::size_t nElements = (cd.isScalar() || firstRow == 0) ? 1 :
+                   casa::ROTableColumn(out, cd.name()).shape(0).product();
+        rowSize += nElements * casa::ValType::getTypeSize(cd.dataType());
+    }
+    const casa::uInt blockSize = std::max(std::size_t(1), (64 * 1024 * 1024) / std::max(std::size_t(1), rowSize));
+
+    // Split the inputs into blocks
+    std::vector<RowBlock> blocks;
+    casa::uInt outRow = firstRow;
+    for (size_t i = 0; i < in.size(); ++i) {
+        const casa::uInt nRows = in[i]->nrow();
+        for (casa::uInt row = 0; row < nRows; row += blockSize) {
+            const casa::uInt n = std::min(blockSize, nRows - row);
+            RowBlock block;
+            block.input = i;
+            block.scanOffset = scanOffsets[i];
+            block.obsOffset = obsOffsets[i];
+            block.inRows = Slicer(IPosition(1, row), IPosition(1, n), Slicer::endIsLength);
+            block.outRows = Slicer(IPosition(1, outRow), IPosition(1, n), Slicer::endIsLength);
+            blocks.push_back(block);
+            outRow += n;
+        }
+    }
+
+    TaskScheduler::TaskGroup tasks;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (b == 0) {
+            createCopiers(desc, blocks[b]);
+            tasks.run(boost::bind(readBlock, in[blocks[b].input].get(), &blocks[b]), "msconcat");
+        }
+        tasks.wait();
+        // Start reading the next block
+        if (b + 1 < blocks.size()) {
+            createCopiers(desc, blocks[b + 1]);
+            tasks.run(boost::bind(readBlock, in[blocks[b + 1].input].get(), &blocks[b + 1]), "msconcat");
+        }
+        writeBlock(blocks[b], out);
+        // Release the memory
+        blocks[b].columns.clear();
+        if (b + 1 == blocks.size() || blocks[b + 1].input != blocks[b].input) {
+            ASKAPLOG_INFO_STR(logger, "Copied input " << blocks[b].input + 2 << " of " << in.size() + 1);
+        }
+    }
+}
+
 void concat(const std::vector<std::string>& inFiles, const std::string& outFile)
 {
     ASKAPCHECK(!casa::File(outFile).exists(),
@@ -74,36 +416,51 @@ void concat(const std::vector<std::string>& inFiles, const std::string& outFile)
     ASKAPLOG_INFO_STR(logger, "Concatenating " << inFiles.size() <<
             " measurement sets");
 
+    // open all inputs up front
+    std::vector< boost::shared_ptr<const casa::MeasurementSet> > in;
+    std::vector<std::string>::const_iterator it;
+    for (it = inFiles.begin(); it != inFiles.end(); ++it) {
+        ASKAPCHECK(Table::isReadable(*it), "ms "+*it+" is not readable!");
+        if (it != inFiles.begin()) {
+            in.push_back(boost::shared_ptr<const casa::MeasurementSet>(new MeasurementSet(*it, Table::Old)));
+        }
+    }
+
     // copy the first file to the output file
     const std::string &first = inFiles[0];
 
     ASKAPLOG_INFO_STR(logger, "Adding ms " << first);
-    ASKAPCHECK(Table::isReadable(first), "ms "+first+" is not readable!");
 
     const string command = "cp -r "+first+" "+outFile;
     const int cp_status = system(command.c_str());
     ASKAPCHECK(cp_status==0, "Error copying "+first+" to "+outFile);
  
-    // load the output ms and initialise MSConcat
+    // load the output ms
     MeasurementSet ms_out(outFile, Table::Update);
-    MSConcat mscat(ms_out);
-
-    // check and concatenate the measurement sets
-    std::vector<std::string>::const_iterator it;
-    for (it = inFiles.begin(); it != inFiles.end(); ++it) {
 
-        if (it == inFiles.begin()) {
-            // already copied in
-            continue;
+    // check whether the main table rows can just be appended
+    bool appendOnly = true;
+    for (size_t i = 0; i < in.size() && appendOnly; ++i) {
+        appendOnly = canAppendRows(ms_out, *in[i]);
+        if (!appendOnly) {
+            ASKAPLOG_INFO_STR(logger, "Input " << inFiles[i + 1] <<
+                    " has different subtables, using the general concatenation");
         }
+    }
 
-        ASKAPLOG_INFO_STR(logger, "Adding ms " << *it);
-        ASKAPCHECK(Table::isReadable(*it), "ms "+*it+" is not readable!");
+    if (appendOnly) {
+        ASKAPLOG_INFO_STR(logger, "All inputs have the same subtables, appending main table rows");
+        appendRows(in, ms_out);
+        return;
+    }
 
-        // load the ms and concatenate
-        MeasurementSet ms(*it, Table::Old);
-        mscat.concatenate(ms);
+    // initialise MSConcat
+    MSConcat mscat(ms_out);
 
+    // check and concatenate the measurement sets
+    for (size_t i = 0; i < in.size(); ++i) {
+        ASKAPLOG_INFO_STR(logger, "Adding ms " << inFiles[i + 1]);
+        mscat.concatenate(*in[i]);
     }
 
 }
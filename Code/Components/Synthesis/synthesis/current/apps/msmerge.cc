@@ -42,18 +42,23 @@
 #include "askap/AskapLogging.h"
 #include "askap/StatReporter.h"
 #include "askap/Log4cxxLogSink.h"
+#include "askap/TaskScheduler.h"
 #include "boost/shared_ptr.hpp"
+#include "boost/bind.hpp"
 #include "CommandLineParser.h"
 #include "casa/OS/File.h"
 #include "casa/aips.h"
 #include "casa/Quanta.h"
 #include "casa/Arrays/Vector.h"
 #include "casa/Arrays/MatrixMath.h"
+#include "casa/Arrays/ArrayLogical.h"
+#include "casa/Arrays/Slicer.h"
 #include "tables/Tables/TableDesc.h"
 #include "tables/Tables/SetupNewTab.h"
 #include "tables/Tables/IncrementalStMan.h"
 #include "tables/Tables/StandardStMan.h"
-#include "tables/Tables/TiledShapeStMan.h"
+#include "tables/Tables/TiledColumnStMan.h"
+#include "tables/Tables/TiledStManAccessor.h"
 #include "ms/MeasurementSets/MeasurementSet.h"
 #include "ms/MeasurementSets/MSColumns.h"
 
@@ -62,12 +67,21 @@ ASKAP_LOGGER(logger, ".msmerge2");
 using namespace askap;
 using namespace casa;
 
-boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
+// Creates the output measurement set. DATA, FLAG, WEIGHT and SIGMA have a
+// fixed shape corresponding to the merged dimensions and are stored with
+// the tiled column storage manager. The tile holds the channels of one input
+// (a whole number of tiles is written at a time), all rows are added here,
+// so the storage is allocated up front.
+boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename,
+                                               const casa::uInt nRows,
+                                               const casa::uInt nPol,
+                                               const casa::uInt nChan,
+                                               const casa::uInt tileNchan)
 {
     // Get configuration first to ensure all parameters are present
     casa::uInt bucketSize =  128 * 1024;
-    casa::uInt tileNcorr = 4;
-    casa::uInt tileNchan = 1;
+    casa::uInt dataBucketSize = 1024 * 1024;
+    casa::uInt tileNcorr = nPol;
 
     if (bucketSize < 8192) {
         bucketSize = 8192;
@@ -75,9 +89,8 @@ boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
     if (tileNcorr < 1) {
         tileNcorr = 1;
     }
-    if (tileNchan < 1) {
-        tileNchan = 1;
-    }
+    ASKAPCHECK(tileNchan > 0 && tileNchan <= nChan, "Tile size in channels ("<<tileNchan<<
+               ") should be between 1 and the number of channels ("<<nChan<<")");
 
     ASKAPLOG_DEBUG_STR(logger, "Creating dataset " << filename);
 
@@ -85,7 +98,12 @@ boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
     TableDesc msDesc(MS::requiredTableDesc());
 
     // Add the DATA column.
-    MS::addColumnToDesc(msDesc, MS::DATA, 2);
+    MS::addColumnToDesc(msDesc, MS::DATA, IPosition(2, nPol, nChan), ColumnDesc::FixedShape);
+
+    // Fix the shape of other array columns
+    msDesc.rwColumnDesc(MS::columnName(MS::FLAG)).setShape(IPosition(2, nPol, nChan));
+    msDesc.rwColumnDesc(MS::columnName(MS::WEIGHT)).setShape(IPosition(1, nPol));
+    msDesc.rwColumnDesc(MS::columnName(MS::SIGMA)).setShape(IPosition(1, nPol));
 
     SetupNewTable newMS(filename, msDesc, Table::New);
 
@@ -109,8 +127,8 @@ boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
     // These columns contain the bulk of the data so save them in a tiled way
     {
         // Get nr of rows in a tile.
-        const int nrowTile = std::max(1u, bucketSize / (8*tileNcorr*tileNchan));
-        TiledShapeStMan dataMan("TiledData",
+        const int nrowTile = std::max(1u, dataBucketSize / (8*tileNcorr*tileNchan));
+        TiledColumnStMan dataMan("TiledData",
                 IPosition(3, tileNcorr, tileNchan, nrowTile));
         newMS.bindColumn(MeasurementSet::columnName(MeasurementSet::DATA),
                 dataMan);
@@ -119,8 +137,8 @@ boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
     }
     {
         const int nrowTile = std::max(1u, bucketSize / (4*8));
-        TiledShapeStMan dataMan("TiledWeight",
-                IPosition(2, 4, nrowTile));
+        TiledColumnStMan dataMan("TiledWeight",
+                IPosition(2, tileNcorr, nrowTile));
         newMS.bindColumn(MeasurementSet::columnName(MeasurementSet::SIGMA),
                 dataMan);
         newMS.bindColumn(MeasurementSet::columnName(MeasurementSet::WEIGHT),
@@ -128,7 +146,7 @@ boost::shared_ptr<casa::MeasurementSet> create(const std::string& filename)
     }
 
     // Now we can create the MeasurementSet and add the (empty) subtables
-    boost::shared_ptr<casa::MeasurementSet> ms(new MeasurementSet(newMS, 0));
+    boost::shared_ptr<casa::MeasurementSet> ms(new MeasurementSet(newMS, nRows));
     ms->createDefaultSubtables(Table::New);
     ms->flush();
 
@@ -289,37 +307,112 @@ void appendToVector(const casa::Vector<double>& src, std::vector<double>& dest)
     std::copy(src.begin(), src.end(), std::back_inserter(dest));
 }
 
+// Description of one input measurement set, obtained once up front
+struct InputInfo {
+    // Spectral window referred to by all rows of the main table
+    casa::Int spwId;
+    // Number of channels
+    casa::uInt nChan;
+    // Position of the first channel in the merged spectral window
+    casa::uInt chanOffset;
+};
+
+// Checks that an array column of a subtable is the same in two measurement sets
+template<typename T>
+bool sameArrayColumn(const casa::Table& t1, const casa::Table& t2, const std::string& name)
+{
+    if (t1.nrow() != t2.nrow()) {
+        return false;
+    }
+    const casa::ROArrayColumn<T> c1(t1, name);
+    const casa::ROArrayColumn<T> c2(t2, name);
+    for (casa::uInt row = 0; row < t1.nrow(); ++row) {
+        const casa::Array<T> a1 = c1(row);
+        const casa::Array<T> a2 = c2(row);
+        if (!a1.shape().isEqual(a2.shape()) || !casa::allEQ(a1, a2)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks that all rows of the main table refer to the same spectral window
+// and returns it. The DATA_DESC_ID column is read in one go.
 casa::Int findSpectralWindowId(const ROMSColumns& msc)
 {
     const casa::uInt nrows = msc.nrow();
     ASKAPCHECK(nrows > 0, "No rows in main table");
-    const casa::ROMSDataDescColumns& ddc = msc.dataDescription();
-
-    casa::Int r0 = -1; // Row zero SpWindow id
-
-    for (casa::uInt row = 0; row < nrows; ++row) {
-        const casa::Int dataDescId = msc.dataDescId()(row);
-        const casa::Int spwId = ddc.spectralWindowId()(dataDescId);
+    const casa::Vector<casa::Int> dataDescIds = msc.dataDescId().getColumn();
+    ASKAPCHECK(casa::allEQ(dataDescIds, dataDescIds[0]), "All rows must be of the same spectral window");
+    return msc.dataDescription().spectralWindowId()(dataDescIds[0]);
+}
 
-        if (row == 0) {
-            r0 = spwId;
-        } else {
-            ASKAPCHECK(spwId == r0, "All rows must be of the same spectral window");
+// Verifies that the input measurement sets can be merged in frequency, i.e.
+// they have the same number of rows, polarisation products, antennas, feeds
+// and fields, and the main tables start and end with the same timestamp and
+// baseline. This is done once, the main table is not compared row by row.
+// Returns the spectral window and channel range of each input.
+std::vector<InputInfo> verifyInputs(const std::vector< boost::shared_ptr<const casa::MeasurementSet> >& in,
+                                    const std::vector< boost::shared_ptr<const ROMSColumns> >& srcMscs)
+{
+    ASKAPCHECK(!srcMscs.empty(), "Vector of source measurement sets is empty");
+    ASKAPDEBUGASSERT(in.size() == srcMscs.size());
+    const ROMSColumns& first = *srcMscs[0];
+    const casa::uInt nRows = first.nrow();
+    ASKAPCHECK(nRows > 0, "No rows in main table");
+    const casa::uInt nPol = first.data().shape(0)(0);
+
+    std::vector<InputInfo> info(srcMscs.size());
+    casa::uInt chanOffset = 0;
+    for (uInt i = 0; i < srcMscs.size(); ++i) {
+        const ROMSColumns& sc = *srcMscs[i];
+        ASKAPCHECK(sc.nrow() == nRows, "Input " << i << " has " << sc.nrow() <<
+                   " rows, the first input has " << nRows);
+        ASKAPCHECK(sc.data().shape(0)(0) == nPol, "Input " << i <<
+                   " has a different number of polarisation products");
+        const casa::uInt checkRows[2] = {0, nRows - 1};
+        for (casa::uInt k = 0; k < 2; ++k) {
+            const casa::uInt row = checkRows[k];
+            ASKAPCHECK(sc.time()(row) == first.time()(row) &&
+                       sc.antenna1()(row) == first.antenna1()(row) &&
+                       sc.antenna2()(row) == first.antenna2()(row) &&
+                       sc.feed1()(row) == first.feed1()(row),
+                       "Main table of input " << i << " is not aligned with the first input at row " << row);
+        }
+        if (i > 0) {
+            ASKAPCHECK(sameArrayColumn<casa::Double>(in[0]->antenna(), in[i]->antenna(),
+                       MSAntenna::columnName(MSAntenna::POSITION)),
+                       "ANTENNA table of input " << i << " differs from the first input");
+            ASKAPCHECK(in[i]->feed().nrow() == in[0]->feed().nrow(),
+                       "FEED table of input " << i << " differs from the first input");
+            ASKAPCHECK(sameArrayColumn<casa::Double>(in[0]->field(), in[i]->field(),
+                       MSField::columnName(MSField::PHASE_DIR)),
+                       "FIELD table of input " << i << " differs from the first input");
+            ASKAPCHECK(sameArrayColumn<casa::Int>(in[0]->polarization(), in[i]->polarization(),
+                       MSPolarization::columnName(MSPolarization::CORR_TYPE)),
+                       "POLARIZATION table of input " << i << " differs from the first input");
         }
-    }
 
-    return r0;
+        info[i].spwId = findSpectralWindowId(sc);
+        info[i].nChan = sc.spectralWindow().numChan()(info[i].spwId);
+        info[i].chanOffset = chanOffset;
+        ASKAPCHECK(sc.data().shape(0)(1) == info[i].nChan, "Input " << i <<
+                   " has a different number of channels in the DATA column and the SPECTRAL_WINDOW table");
+        chanOffset += info[i].nChan;
+    }
+    return info;
 }
 
 // Creates a single spectral window in the "dest" measurement set, which
 // is the concatenation of the spectral windows used in the source measurement
-// set. Each source measurement set is read through once to determine which
-// spectral window id is used. All rows in a given source measurement set
-// must refer to the same spectral window id.
+// set. All rows in a given source measurement set must refer to the same
+// spectral window id (this is checked by verifyInputs).
 void mergeSpectralWindow(const std::vector< boost::shared_ptr<const ROMSColumns> >& srcMscs,
+                         const std::vector<InputInfo>& info,
                          casa::MeasurementSet& dest)
 {
     ASKAPCHECK(!srcMscs.empty(), "Vector of source measurement sets is empty");
+    ASKAPDEBUGASSERT(info.size() == srcMscs.size());
 
     MSColumns destMsc(dest);
     MSSpWindowColumns& dc = destMsc.spectralWindow();
@@ -327,7 +420,7 @@ void mergeSpectralWindow(const std::vector< boost::shared_ptr<const ROMSColumns>
 
     // 1: Create a single spectral window in the destination measurement set.
     // Populate it with the simple cells (i.e. those not needing merging)
-    const casa::Int spwIdForFirstMs = findSpectralWindowId(*srcMscs[0]);
+    const casa::Int spwIdForFirstMs = info[0].spwId;
     const ROMSSpWindowColumns& sc = srcMscs[0]->spectralWindow();
     dest.spectralWindow().addRow();
     dc.measFreqRef().put(DEST_ROW, sc.measFreqRef()(spwIdForFirstMs));
@@ -348,9 +441,7 @@ void mergeSpectralWindow(const std::vector< boost::shared_ptr<const ROMSColumns>
     double totalBandwidth = 0.0;
 
     for (uInt i = 0; i < srcMscs.size(); ++i) {
-        // The below function obtains the spwid refered to by all rows in the
-        // main table. This throws an exception if they are not all identical.
-        const casa::Int srcSpwId = findSpectralWindowId(*srcMscs[i]);
+        const casa::Int srcSpwId = info[i].spwId;
 
         const ROMSSpWindowColumns& spwc = srcMscs[i]->spectralWindow();
         nChan += spwc.numChan()(srcSpwId);
@@ -371,74 +462,181 @@ void mergeSpectralWindow(const std::vector< boost::shared_ptr<const ROMSColumns>
     dc.totalBandwidth().put(DEST_ROW, totalBandwidth);
 }
 
+// A block of rows read from all inputs. The metadata are taken from the
+// first input, visibilities and flags from each of the inputs.
+struct RowBlock {
+    casa::Vector<casa::Int> scanNumber;
+    casa::Vector<casa::Int> fieldId;
+    casa::Vector<casa::Double> time;
+    casa::Vector<casa::Double> timeCentroid;
+    casa::Vector<casa::Int> arrayId;
+    casa::Vector<casa::Int> processorId;
+    casa::Vector<casa::Double> exposure;
+    casa::Vector<casa::Double> interval;
+    casa::Vector<casa::Int> observationId;
+    casa::Vector<casa::Int> antenna1;
+    casa::Vector<casa::Int> antenna2;
+    casa::Vector<casa::Int> feed1;
+    casa::Vector<casa::Int> feed2;
+    casa::Matrix<casa::Double> uvw;
+    casa::Vector<casa::Bool> flagRow;
+    casa::Matrix<casa::Float> weight;
+    casa::Matrix<casa::Float> sigma;
+    // visibilities and flags of each input (nPol x nChan x nRow)
+    std::vector<casa::Cube<casa::Complex> > data;
+    std::vector<casa::Cube<casa::Bool> > flag;
+};
+
+// Reads the metadata for the given rows
+void readMetadata(const ROMSColumns* sc, const casa::Slicer rows, RowBlock* block)
+{
+    block->scanNumber.reference(sc->scanNumber().getColumnRange(rows));
+    block->fieldId.reference(sc->fieldId().getColumnRange(rows));
+    block->time.reference(sc->time().getColumnRange(rows));
+    block->timeCentroid.reference(sc->timeCentroid().getColumnRange(rows));
+    block->arrayId.reference(sc->arrayId().getColumnRange(rows));
+    block->processorId.reference(sc->processorId().getColumnRange(rows));
+    block->exposure.reference(sc->exposure().getColumnRange(rows));
+    block->interval.reference(sc->interval().getColumnRange(rows));
+    block->observationId.reference(sc->observationId().getColumnRange(rows));
+    block->antenna1.reference(sc->antenna1().getColumnRange(rows));
+    block->antenna2.reference(sc->antenna2().getColumnRange(rows));
+    block->feed1.reference(sc->feed1().getColumnRange(rows));
+    block->feed2.reference(sc->feed2().getColumnRange(rows));
+    block->uvw.reference(sc->uvw().getColumnRange(rows));
+    block->flagRow.reference(sc->flagRow().getColumnRange(rows));
+    block->weight.reference(sc->weight().getColumnRange(rows));
+    block->sigma.reference(sc->sigma().getColumnRange(rows));
+}
+
+// Reads the given rows of one input. This runs in a worker task without the
+// CasaTableLock: each task only touches the columns of its own input table
+// (merge() checks that no table is given twice), the main thread only writes
+// the output table while the tasks run, and all tables are opened and closed
+// by the main thread while no task is running. The metadata are read by the
+// task reading the first input as the same table must not be accessed by two
+// threads.
+void readInput(const ROMSColumns* sc, const casa::Slicer rows, RowBlock* block, const casa::uInt index)
+{
+    if (index == 0) {
+        readMetadata(sc, rows, block);
+    }
+    block->data[index].reference(sc->data().getColumnRange(rows));
+    block->flag[index].reference(sc->flag().getColumnRange(rows));
+}
+
+// Submits the tasks reading the given rows of all inputs
+void readBlock(const std::vector< boost::shared_ptr<const ROMSColumns> >& srcMscs,
+               const casa::Slicer& rows, RowBlock& block, TaskScheduler::TaskGroup& tasks)
+{
+    block.data.resize(srcMscs.size());
+    block.flag.resize(srcMscs.size());
+    for (casa::uInt i = 0; i < srcMscs.size(); ++i) {
+        tasks.run(boost::bind(readInput, srcMscs[i].get(), rows, &block, i), "msmerge");
+    }
+}
+
+// Writes a block of rows into the output. The channels of each input go into
+// their own (tile aligned) part of the merged spectrum.
+void writeBlock(const RowBlock& block, const std::vector<InputInfo>& info,
+                const casa::Slicer& rows, MSColumns& dc)
+{
+    dc.scanNumber().putColumnRange(rows, block.scanNumber);
+    dc.fieldId().putColumnRange(rows, block.fieldId);
+    dc.dataDescId().putColumnRange(rows, casa::Vector<casa::Int>(block.scanNumber.nelements(), 0));
+    dc.time().putColumnRange(rows, block.time);
+    dc.timeCentroid().putColumnRange(rows, block.timeCentroid);
+    dc.arrayId().putColumnRange(rows, block.arrayId);
+    dc.processorId().putColumnRange(rows, block.processorId);
+    dc.exposure().putColumnRange(rows, block.exposure);
+    dc.interval().putColumnRange(rows, block.interval);
+    dc.observationId().putColumnRange(rows, block.observationId);
+    dc.antenna1().putColumnRange(rows, block.antenna1);
+    dc.antenna2().putColumnRange(rows, block.antenna2);
+    dc.feed1().putColumnRange(rows, block.feed1);
+    dc.feed2().putColumnRange(rows, block.feed2);
+    dc.uvw().putColumnRange(rows, block.uvw);
+    dc.flagRow().putColumnRange(rows, block.flagRow);
+    dc.weight().putColumnRange(rows, block.weight);
+    dc.sigma().putColumnRange(rows, block.sigma);
+
+    for (casa::uInt i = 0; i < info.size(); ++i) {
+        const casa::uInt nPol = block.data[i].shape()(0);
+        const Slicer chans(IPosition(2, 0, info[i].chanOffset),
+                           IPosition(2, nPol, info[i].nChan), Slicer::endIsLength);
+        dc.data().putColumnRange(rows, chans, block.data[i]);
+        dc.flag().putColumnRange(rows, chans, block.flag[i]);
+    }
+}
+
+// Merges the main tables. Rows are processed in blocks, the next block is read
+// from all inputs concurrently while the current one is written to the output.
 void mergeMainTable(const std::vector< boost::shared_ptr<const ROMSColumns> >& srcMscs,
-                    casa::MeasurementSet& dest)
+                    const std::vector<InputInfo>& info,
+                    casa::MeasurementSet& dest, const casa::uInt tileNrow)
 {
     MSColumns dc(dest);
 
-    // Add rows upfront
-    const ROMSColumns& sc = *(srcMscs[0]);
-    const casa::uInt nRows = sc.nrow();
-    dest.addRow(nRows);
+    // Rows have been added when the output was created
+    const casa::uInt nRows = srcMscs[0]->nrow();
+    ASKAPCHECK(dest.nrow() == nRows, "Output measurement set has " << dest.nrow() <<
+               " rows, expected " << nRows);
+    const casa::uInt nPol = srcMscs[0]->data().shape(0)(0);
+    const casa::uInt nChanTotal = info.back().chanOffset + info.back().nChan;
+
+    // Decide how many rows to process simultaneously. Two blocks are held in
+    // memory, assume 64MB working space for each. The block is a whole number
+    // of tiles, so each tile of the output is written once.
+    const std::size_t rowSize = nPol * nChanTotal * (sizeof(casa::Complex) + sizeof(casa::Bool));
+    casa::uInt blockSize = (64 * 1024 * 1024) / rowSize;
+    blockSize = std::max(1u, blockSize / tileNrow) * tileNrow;
+    ASKAPLOG_INFO_STR(logger, "Copying " << nRows << " rows in blocks of " << blockSize << " rows");
+
+    // Set a 64MB maximum cache size for the large columns
+    const casa::uInt cacheSize = 64 * 1024 * 1024;
+    dc.data().setMaximumCacheSize(cacheSize);
+    dc.flag().setMaximumCacheSize(cacheSize);
+    for (uInt i = 0; i < srcMscs.size(); ++i) {
+        srcMscs[i]->data().setMaximumCacheSize(cacheSize / srcMscs.size());
+        srcMscs[i]->flag().setMaximumCacheSize(cacheSize / srcMscs.size());
+    }
 
-    // For each row
-    for (uInt row = 0; row < nRows; ++row) {
-        if (row % 10000 == 0) {
-            ASKAPLOG_INFO_STR(logger,  "Merging row " << row << " of " << nRows);
+    RowBlock blocks[2];
+    TaskScheduler::TaskGroup tasks;
+    const uInt PROGRESS_INTERVAL_IN_ROWS = std::max(1u, nRows / 100);
+    uInt progressCounter = 0;
+    readBlock(srcMscs, Slicer(IPosition(1, 0), IPosition(1, std::min(blockSize, nRows)), Slicer::endIsLength),
+              blocks[0], tasks);
+    for (uInt row = 0, blockIndex = 0; row < nRows; row += blockSize, ++blockIndex) {
+        // Wait for the current block to be read
+        tasks.wait();
+        const RowBlock& current = blocks[blockIndex % 2];
+        const uInt nRowsThisIteration = std::min(blockSize, nRows - row);
+        const Slicer rows(IPosition(1, row), IPosition(1, nRowsThisIteration), Slicer::endIsLength);
+
+        // Start reading the next block
+        const uInt nextRow = row + nRowsThisIteration;
+        if (nextRow < nRows) {
+            readBlock(srcMscs, Slicer(IPosition(1, nextRow), IPosition(1, std::min(blockSize, nRows - nextRow)),
+                      Slicer::endIsLength), blocks[(blockIndex + 1) % 2], tasks);
         }
 
-        // 1: Copy over the simple cells (i.e. those not needing merging)
-        dc.scanNumber().put(row, sc.scanNumber()(row));
-        dc.fieldId().put(row, sc.fieldId()(row));
-        dc.dataDescId().put(row, 0);
-        dc.time().put(row, sc.time()(row));
-        dc.timeCentroid().put(row, sc.timeCentroid()(row));
-        dc.arrayId().put(row, sc.arrayId()(row));
-        dc.processorId().put(row, sc.processorId()(row));
-        dc.exposure().put(row, sc.exposure()(row));
-        dc.interval().put(row, sc.interval()(row));
-        dc.observationId().put(row, sc.observationId()(row));
-        dc.antenna1().put(row, sc.antenna1()(row));
-        dc.antenna2().put(row, sc.antenna2()(row));
-        dc.feed1().put(row, sc.feed1()(row));
-        dc.feed2().put(row, sc.feed2()(row));
-        dc.uvw().put(row, sc.uvw()(row));
-        dc.flagRow().put(row, sc.flagRow()(row));
-        dc.weight().put(row, sc.weight()(row));
-        dc.sigma().put(row, sc.sigma()(row));
-
-        // 2: Size the matrix for data and flag
-        const uInt nPol = sc.data()(row).shape()(0);
-        const uInt nChan = sc.data()(row).shape()(1);
-        const uInt nChanTotal = nChan * srcMscs.size();
-
-        casa::Matrix<casa::Complex> data(nPol, nChanTotal);
-        casa::Matrix<casa::Bool> flag(nPol, nChanTotal);
-
-        // 3: Copy the data from each input into the output matrix
-        for (uInt i = 0; i < srcMscs.size(); ++i) {
-            const casa::Matrix<casa::Complex> srcData = srcMscs[i]->data()(row);
-            const casa::Matrix<casa::Bool> srcFlag = srcMscs[i]->flag()(row);
-            for (uInt pol = 0; pol < nPol; ++pol) {
-                for (uInt chan = 0; chan < nChan; ++chan) {
-                    data(pol, chan + (nChan * i)) = srcData(pol, chan);
-                    flag(pol, chan + (nChan * i)) = srcFlag(pol, chan);
-                }
-            }
-        }
+        writeBlock(current, info, rows, dc);
 
-        // 4: Add those merged cells
-        dc.data().put(row, data);
-        dc.flag().put(row, flag);
+        // Report progress at intervals and on completion
+        progressCounter += nRowsThisIteration;
+        if (progressCounter >= PROGRESS_INTERVAL_IN_ROWS || nextRow >= nRows) {
+            ASKAPLOG_INFO_STR(logger,  "Merged row " << nextRow << " of " << nRows);
+            progressCounter = 0;
+        }
     }
 }
 
 void merge(const std::vector<std::string>& inFiles, const std::string& outFile)
 {
-    // Create the output measurement set
     ASKAPCHECK(!casa::File(outFile).exists(), "File or table "
             << outFile << " already exists!");
-    boost::shared_ptr<casa::MeasurementSet> out(create(outFile));
+    ASKAPCHECK(!inFiles.empty(), "No input measurement sets!");
 
     // Open the input measurement sets
     std::vector< boost::shared_ptr<const casa::MeasurementSet> > in;
@@ -450,6 +648,33 @@ void merge(const std::vector<std::string>& inFiles, const std::string& outFile)
         inColumns.push_back(boost::shared_ptr<const ROMSColumns>(new ROMSColumns(*p)));
     }
 
+    // The inputs are read concurrently without locking, which is only safe
+    // if they are distinct tables (the same path opens the same table object)
+    for (uInt i = 1; i < in.size(); ++i) {
+        for (uInt j = 0; j < i; ++j) {
+            ASKAPCHECK(in[i]->tableName() != in[j]->tableName(), "Input " << inFiles[i] <<
+                       " is the same table as " << inFiles[j]);
+        }
+    }
+
+    // Verify consistency of the inputs
+    ASKAPLOG_INFO_STR(logger,  "Verifying " << inFiles.size() << " input measurement sets");
+    const std::vector<InputInfo> info = verifyInputs(in, inColumns);
+    const casa::uInt nRows = inColumns[0]->nrow();
+    const casa::uInt nPol = inColumns[0]->data().shape(0)(0);
+    const casa::uInt nChanTotal = info.back().chanOffset + info.back().nChan;
+
+    // Create the output measurement set. The tile is as wide as the smallest input
+    // and the block copy below is aligned with tiles if all inputs are of the same width.
+    casa::uInt tileNchan = info[0].nChan;
+    for (uInt i = 1; i < info.size(); ++i) {
+        tileNchan = std::min(tileNchan, info[i].nChan);
+    }
+    ASKAPLOG_INFO_STR(logger,  "Creating " << outFile << " with " << nRows << " rows, " << nChanTotal <<
+                      " channels and " << nPol << " polarisation products");
+    boost::shared_ptr<casa::MeasurementSet> out(create(outFile, nRows, nPol, nChanTotal, tileNchan));
+    const casa::uInt tileNrow = ROTiledStManAccessor(*out, "TiledData").tileShape(0).last();
+
     ASKAPLOG_INFO_STR(logger,  "First copy " << inFiles[0]<< " into " << outFile);
 
     // Copy ANTENNA
@@ -484,11 +709,11 @@ void merge(const std::vector<std::string>& inFiles, const std::string& outFile)
 
     // Merge SPECTRAL_WINDOW
     ASKAPLOG_INFO_STR(logger,  "Merging SPECTRAL_WINDOW table");
-    mergeSpectralWindow(inColumns, *out);
+    mergeSpectralWindow(inColumns, info, *out);
 
     // Merge main table
     ASKAPLOG_INFO_STR(logger,  "Merging main table");
-    mergeMainTable(inColumns, *out);
+    mergeMainTable(inColumns, info, *out, tileNrow);
 }
 
 // Main function
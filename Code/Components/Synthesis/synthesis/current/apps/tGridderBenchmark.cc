@@ -0,0 +1,425 @@
+/// @file
+///
+/// @brief benchmark of gridding and degridding with the real gridders
+///
+/// @details This application drives gridders created by VisGridderFactory with
+/// synthetic data (the array layout of DataAccessorStub tracked over a range of
+/// hour angles) and measures the gridding and degridding throughput, time spent in
+/// convolution function generation and FFTs and the memory high-water mark. It doesn't
+/// need any measurement set, so the results are comparable between machines and
+/// builds. Each configuration (gridder, grid size, oversampling factor and the
+/// number of threads) produces one line of JSON in the output, so the results can
+/// be processed by scripts.
+///
+/// Control parameters are passed in from a LOFAR ParameterSet file (all are optional):
+/// @code
+/// Benchmark.gridders      = [Box, SphFunc, WProject, AWProject, WStack]
+/// Benchmark.gridsizes     = [1024, 2048]    # grid sizes to try
+/// Benchmark.oversample    = [4, 8]          # oversampling factors to try
+/// Benchmark.threads       = [1, 4]          # thread counts to try
+/// Benchmark.cellsize      = 10arcsec
+/// Benchmark.nchan         = 16
+/// Benchmark.npol          = 1               # 1, 2 or 4
+/// Benchmark.nintegrations = 64              # number of data chunks
+/// Benchmark.duration      = 12              # track length in hours
+/// Benchmark.declination   = -45deg
+/// Benchmark.frequency     = 1.4e9           # frequency of the first channel in Hz
+/// Benchmark.chanwidth     = 1e6             # channel width in Hz
+/// Benchmark.output        = benchmark.json  # empty string means stdout
+/// @endcode
+/// Any other parameters are passed to the gridders, i.e. gridder.WProject.wmax
+/// can be used to change the wmax of the WProject gridder.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+// Package level header file
+#include "askap_synthesis.h"
+
+// ASKAPsoft includes
+#include "askap/AskapLogging.h"
+#include "askap/AskapError.h"
+#include <fitting/Params.h>
+#include "askap/StatReporter.h"
+#include <askap/TaskScheduler.h>
+#include <profile/Metrics.h>
+#include <casa/Logging/LogIO.h>
+#include <askap/Log4cxxLogSink.h>
+#include <CommandLineParser.h>
+#include <askapparallel/AskapParallel.h>
+#include <Common/ParameterSet.h>
+#include <gridding/VisGridderFactory.h>
+#include <measurementequation/SynthesisParamsHelper.h>
+#include <askap/AskapUtil.h>
+#include <dataaccess/DataAccessorStub.h>
+
+// casa includes
+#include <casa/OS/Timer.h>
+#include <casa/BasicSL/Constants.h>
+
+// boost includes
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+// std includes
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+ASKAP_LOGGER(logger, ".tGridderBenchmark");
+
+using namespace askap;
+using namespace askap::synthesis;
+using namespace askap::scimath;
+using namespace askap::accessors;
+
+/// @brief list of data chunks
+typedef std::vector<boost::shared_ptr<DataAccessorStub> > ChunkList;
+
+/// @brief make synthetic data
+/// @details Baselines of DataAccessorStub are tracked over the given range of
+/// hour angles, one chunk per integration.
+/// @param[in] parset parset with the benchmark parameters
+/// @param[in] dec declination of the phase centre in radians
+/// @return list of chunks
+ChunkList makeChunks(const LOFAR::ParameterSet &parset, const double dec)
+{
+   const int nChunks = parset.getInt32("nintegrations", 64);
+   const int nChan = parset.getInt32("nchan", 16);
+   const int nPol = parset.getInt32("npol", 1);
+   const double duration = parset.getDouble("duration", 12.) * casa::C::pi / 12.;
+   const double startFreq = parset.getDouble("frequency", 1.4e9);
+   const double chanWidth = parset.getDouble("chanwidth", 1e6);
+   ASKAPCHECK(nChunks > 0, "Number of integrations should be positive, you have "<<nChunks);
+   ASKAPCHECK(nChan > 0, "Number of channels should be positive, you have "<<nChan);
+   ASKAPCHECK((nPol == 1) || (nPol == 2) || (nPol == 4), "Number of polarisations should be 1, 2 or 4, you have "<<nPol);
+
+   casa::Vector<casa::Stokes::StokesTypes> stokes(nPol);
+   if (nPol == 1) {
+       stokes[0] = casa::Stokes::I;
+   } else if (nPol == 2) {
+       stokes[0] = casa::Stokes::XX;
+       stokes[1] = casa::Stokes::YY;
+   } else {
+       stokes[0] = casa::Stokes::XX;
+       stokes[1] = casa::Stokes::XY;
+       stokes[2] = casa::Stokes::YX;
+       stokes[3] = casa::Stokes::YY;
+   }
+   const casa::MVDirection pointing(0., dec);
+   const double sd = sin(dec);
+   const double cd = cos(dec);
+
+   ChunkList chunks(nChunks);
+   for (int chunk = 0; chunk < nChunks; ++chunk) {
+        boost::shared_ptr<DataAccessorStub> acc(new DataAccessorStub(true));
+        const casa::uInt nRow = acc->nRow();
+        acc->itsFrequency.resize(nChan);
+        for (int chan = 0; chan < nChan; ++chan) {
+             acc->itsFrequency[chan] = startFreq + chanWidth * chan;
+        }
+        acc->itsVisibility.resize(nRow, nChan, nPol);
+        acc->itsVisibility.set(casa::Complex(1.0, 0.0));
+        acc->itsNoise.resize(nRow, nChan, nPol);
+        acc->itsNoise.set(casa::Complex(1.0, 0.0));
+        acc->itsFlag.resize(nRow, nChan, nPol);
+        acc->itsFlag.set(casa::False);
+        acc->itsStokes.resize(nPol);
+        acc->itsStokes = stokes;
+        acc->itsPointingDir1.set(pointing);
+        acc->itsPointingDir2.set(pointing);
+        acc->itsDishPointing1.set(pointing);
+        acc->itsDishPointing2.set(pointing);
+        const double ha = nChunks > 1 ? duration * (double(chunk) / (nChunks - 1) - 0.5) : 0.;
+        acc->itsTime = ha / casa::C::_2pi * 86400.;
+        const double sh = sin(ha);
+        const double ch = cos(ha);
+        for (casa::uInt row = 0; row < nRow; ++row) {
+             // the stub gives baselines as differences of geocentric positions
+             const casa::RigidVector<casa::Double, 3> xyz = acc->itsUVW[row];
+             acc->itsUVW[row](0) = sh * xyz(0) + ch * xyz(1);
+             acc->itsUVW[row](1) = -sd * ch * xyz(0) + sd * sh * xyz(1) + cd * xyz(2);
+             acc->itsUVW[row](2) = cd * ch * xyz(0) - cd * sh * xyz(1) + sd * xyz(2);
+        }
+        chunks[chunk] = acc;
+   }
+   return chunks;
+}
+
+/// @brief grid a range of chunks
+/// @param[in] gridder gridder to use (owned by the calling task only)
+/// @param[in] chunks data
+/// @param[in] begin first chunk
+/// @param[in] end chunk past the last one
+void gridChunks(const IVisGridder::ShPtr &gridder, const ChunkList *chunks, size_t begin, size_t end)
+{
+   for (size_t i = begin; i < end; ++i) {
+        gridder->grid(*(*chunks)[i]);
+   }
+}
+
+/// @brief degrid a range of chunks
+/// @param[in] gridder gridder to use (owned by the calling task only)
+/// @param[in] chunks data
+/// @param[in] begin first chunk
+/// @param[in] end chunk past the last one
+void degridChunks(const IVisGridder::ShPtr &gridder, const ChunkList *chunks, size_t begin, size_t end)
+{
+   for (size_t i = begin; i < end; ++i) {
+        gridder->degrid(*(*chunks)[i]);
+   }
+}
+
+/// @brief total time accumulated by a timer metric
+/// @param[in] name name of the timer
+/// @return time in seconds
+double timerTotal(const std::string &name)
+{
+   return Metrics::instance().value(Metrics::instance().timer(name)).sum;
+}
+
+/// @brief benchmark one configuration
+/// @details The data are split into one contiguous range per thread, each
+/// range is processed by a separate clone of the gridder (as the imager does
+/// for different images). Only the grid of the first clone is finalised
+/// as the grids would be merged before the FFT in the real processing.
+/// @param[in] parset parset with the benchmark parameters and gridder definitions
+/// @param[in] chunks data
+/// @param[in] gridderName name of the gridder
+/// @param[in] gridSize size of the image (square)
+/// @param[in] oversample oversampling factor, 0 means the gridder default
+/// @param[in] nThreads number of threads
+/// @param[in] os stream to write the results to
+void benchmark(const LOFAR::ParameterSet &parset, const ChunkList &chunks,
+               const std::string &gridderName, const int gridSize, const int oversample,
+               const size_t nThreads, std::ostream &os)
+{
+   LOFAR::ParameterSet gridderParset(parset);
+   gridderParset.replace("gridder", gridderName);
+   if (oversample > 0) {
+       gridderParset.replace("gridder." + gridderName + ".oversample", utility::toString(oversample));
+   }
+   if (gridderName == "AWProject") {
+       if (!gridderParset.isDefined("gridder.AWProject.diameter")) {
+           gridderParset.replace("gridder.AWProject.diameter", "12m");
+       }
+       if (!gridderParset.isDefined("gridder.AWProject.blockage")) {
+           gridderParset.replace("gridder.AWProject.blockage", "2m");
+       }
+   }
+   ASKAPLOG_INFO_STR(logger, "Benchmarking "<<gridderName<<" gridder, grid size "<<gridSize<<
+                     ", oversampling "<<oversample<<", "<<nThreads<<" thread(s)");
+
+   TaskScheduler &scheduler = TaskScheduler::instance();
+   scheduler.setThreadBudget(nThreads);
+   StatReporter::resetPeakRSS();
+   const double cfStart = timerTotal("gridder.cf");
+   const double fftStart = timerTotal("fft.fft2d");
+
+   // model image with a single point source off the centre
+   ASKAPDEBUGASSERT(chunks.size() > 0);
+   const DataAccessorStub &first = *chunks[0];
+   const casa::uInt nChan = first.nChannel();
+   const double freqMin = first.frequency()[0];
+   const double freqMax = first.frequency()[nChan - 1];
+   const std::string imageName = "image.bench";
+   std::vector<std::string> direction(3);
+   direction[0] = "00h00m00.000";
+   direction[1] = parset.getString("declination", "-45deg");
+   direction[2] = "J2000";
+   const std::string cellSize = parset.getString("cellsize", "10arcsec");
+   const std::vector<std::string> cellSizes(2, cellSize);
+   const std::vector<int> shape(2, gridSize);
+   Params model;
+   SynthesisParamsHelper::add(model, imageName, direction, cellSizes, shape, false, freqMin, freqMax,
+                              nChan, first.stokes());
+   casa::Array<double> image = model.value(imageName).copy();
+   casa::IPosition source(image.shape().nelements(), 0);
+   source(0) = gridSize / 2 + gridSize / 8;
+   source(1) = gridSize / 2 - gridSize / 16;
+   image(source) = 1.;
+   model.update(imageName, image);
+   const Axes axes(model.axes(imageName));
+
+   IVisGridder::ShPtr gridder = VisGridderFactory::make(gridderParset);
+   ASKAPCHECK(gridder, "Gridder "<<gridderName<<" is not defined");
+   const size_t nParts = std::min(nThreads, chunks.size());
+   std::vector<IVisGridder::ShPtr> gridders(nParts);
+   for (size_t part = 0; part < nParts; ++part) {
+        gridders[part] = gridder->clone();
+        ASKAPDEBUGASSERT(gridders[part]);
+   }
+
+   size_t nSamples = 0;
+   for (size_t i = 0; i < chunks.size(); ++i) {
+        nSamples += chunks[i]->nRow() * chunks[i]->nChannel() * chunks[i]->nPol();
+   }
+
+   // gridding
+   casa::Timer timer;
+   timer.mark();
+   {
+     TaskScheduler::TaskGroup group(scheduler);
+     for (size_t part = 0; part < nParts; ++part) {
+          gridders[part]->initialiseGrid(axes, image.shape(), false);
+          gridders[part]->customiseForContext(imageName);
+          group.run(boost::bind(gridChunks, gridders[part], &chunks, part * chunks.size() / nParts,
+                    (part + 1) * chunks.size() / nParts), "gridding");
+     }
+     group.wait();
+   }
+   const double gridTime = timer.real();
+   timer.mark();
+   casa::Array<double> out(image.shape());
+   gridders[0]->finaliseGrid(out);
+   const double finaliseGridTime = timer.real();
+
+   // degridding
+   timer.mark();
+   {
+     TaskScheduler::TaskGroup group(scheduler);
+     for (size_t part = 0; part < nParts; ++part) {
+          gridders[part]->initialiseDegrid(axes, image);
+          gridders[part]->customiseForContext(imageName);
+          group.run(boost::bind(degridChunks, gridders[part], &chunks, part * chunks.size() / nParts,
+                    (part + 1) * chunks.size() / nParts), "degridding");
+     }
+     group.wait();
+   }
+   for (size_t part = 0; part < nParts; ++part) {
+        gridders[part]->finaliseDegrid();
+   }
+   const double degridTime = timer.real();
+
+   long vmPeak = -1;
+   long rssPeak = -1;
+   StatReporter reporter;
+   reporter.peakMemory(vmPeak, rssPeak);
+
+   os<<"{\"gridder\":\""<<gridderName<<"\",\"gridsize\":"<<gridSize<<",\"oversample\":"<<oversample<<
+       ",\"threads\":"<<nThreads<<",\"nchan\":"<<nChan<<",\"npol\":"<<first.nPol()<<
+       ",\"samples\":"<<nSamples<<",\"grid_time\":"<<gridTime<<
+       ",\"grid_rate\":"<<(gridTime > 0. ? nSamples / gridTime : 0.)<<
+       ",\"finalise_time\":"<<finaliseGridTime<<",\"degrid_time\":"<<degridTime<<
+       ",\"degrid_rate\":"<<(degridTime > 0. ? nSamples / degridTime : 0.)<<
+       ",\"cf_time\":"<<timerTotal("gridder.cf") - cfStart<<
+       ",\"fft_time\":"<<timerTotal("fft.fft2d") - fftStart<<
+       ",\"peak_rss_mb\":"<<(rssPeak < 0 ? -1. : rssPeak / 1024.)<<"}"<<std::endl;
+}
+
+// Main function
+int main(int argc, const char** argv)
+{
+    // This class must have scope outside the main try/catch block
+    askap::askapparallel::AskapParallel comms(argc, argv);
+
+    try {
+        // Ensure that CASA log messages are captured
+        casa::LogSinkInterface* globalSink = new Log4cxxLogSink();
+        casa::LogSink::globalSink(globalSink);
+
+        StatReporter stats;
+
+        // Put everything in scope to ensure that all destructors are called
+        // before the final message
+        {
+            cmdlineparser::Parser parser; // a command line parser
+            // command line parameter
+            cmdlineparser::FlaggedParameter<std::string> inputsPar("-inputs",
+                    "tgridderbenchmark.in");
+            // this parameter is optional
+            parser.add(inputsPar, cmdlineparser::Parser::return_default);
+
+            parser.process(argc, argv);
+
+            const std::string parsetFile = inputsPar;
+
+            LOFAR::ParameterSet parset(parsetFile);
+            LOFAR::ParameterSet subset(parset.makeSubset("Benchmark."));
+
+            std::vector<std::string> defaultGridders;
+            defaultGridders.push_back("Box");
+            defaultGridders.push_back("SphFunc");
+            defaultGridders.push_back("WProject");
+            defaultGridders.push_back("AWProject");
+            defaultGridders.push_back("WStack");
+            const std::vector<std::string> gridders = subset.getStringVector("gridders", defaultGridders);
+            const std::vector<int> gridSizes = subset.getInt32Vector("gridsizes", std::vector<int>(1, 2048));
+            const std::vector<int> oversampling = subset.getInt32Vector("oversample", std::vector<int>(1, 0));
+            const std::vector<int> threads = subset.getInt32Vector("threads", std::vector<int>(1, 1));
+            for (size_t i = 0; i < threads.size(); ++i) {
+                 ASKAPCHECK(threads[i] > 0, "Number of threads should be positive, you have "<<threads[i]);
+            }
+            for (size_t i = 0; i < gridSizes.size(); ++i) {
+                 ASKAPCHECK(gridSizes[i] > 0, "Grid size should be positive, you have "<<gridSizes[i]);
+            }
+
+            const double dec = SynthesisParamsHelper::convertQuantity(subset.getString("declination", "-45deg"), "rad");
+            ASKAPLOG_INFO_STR(logger, "Making synthetic data");
+            const ChunkList chunks = makeChunks(subset, dec);
+
+            const std::string outName = subset.getString("output", "");
+            std::ofstream outFile;
+            if (outName != "") {
+                outFile.open(outName.c_str());
+                ASKAPCHECK(outFile.is_open(), "Unable to open "<<outName<<" for writing");
+                ASKAPLOG_INFO_STR(logger, "Results will be written into "<<outName);
+            }
+            std::ostream &os = outName != "" ? outFile : std::cout;
+
+            for (size_t g = 0; g < gridders.size(); ++g) {
+                 // the box gridder has no oversampling
+                 const std::vector<int> osList = gridders[g] == "Box" ? std::vector<int>(1, 0) : oversampling;
+                 for (size_t s = 0; s < gridSizes.size(); ++s) {
+                      for (size_t o = 0; o < osList.size(); ++o) {
+                           for (size_t t = 0; t < threads.size(); ++t) {
+                                benchmark(subset, chunks, gridders[g], gridSizes[s], osList[o],
+                                          size_t(threads[t]), os);
+                           }
+                      }
+                 }
+            }
+        }
+        stats.logSummary();
+        ///==============================================================================
+    } catch (const cmdlineparser::XParser &ex) {
+        ASKAPLOG_FATAL_STR(logger, "Command line parser error, wrong arguments " << argv[0]);
+        std::cerr << "Usage: " << argv[0] << " [-inputs parsetFile]"
+                      << std::endl;
+    } catch (const askap::AskapError& x) {
+        ASKAPLOG_FATAL_STR(logger, "Askap error in " << argv[0] << ": " << x.what());
+        std::cerr << "Askap error in " << argv[0] << ": " << x.what()
+                      << std::endl;
+        exit(1);
+    } catch (const std::exception& x) {
+        ASKAPLOG_FATAL_STR(logger, "Unexpected exception in " << argv[0] << ": " << x.what());
+        std::cerr << "Unexpected exception in " << argv[0] << ": " << x.what()
+                      << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
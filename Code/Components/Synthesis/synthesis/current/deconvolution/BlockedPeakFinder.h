@@ -0,0 +1,204 @@
+/// @file BlockedPeakFinder.h
+/// @brief Incremental peak search for the clean minor cycle
+/// @details The residual image is split into square blocks and the (weighted)
+/// minimum and maximum of each block are cached. PSF subtraction through this class
+/// marks the affected blocks, so only they are rescanned before the next peak search.
+/// @ingroup Deconvolver
+///
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_SYNTHESIS_BLOCKEDPEAKFINDER_H
+#define ASKAP_SYNTHESIS_BLOCKEDPEAKFINDER_H
+
+#include <vector>
+#include <cstddef>
+
+#include <casa/aips.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+
+namespace askap {
+
+    namespace synthesis {
+
+        /// @brief Incremental peak search for the clean minor cycle
+        /// @details This class is attached to a residual image plane (and optionally
+        /// a weight image of the same size). It finds the minimum and maximum of
+        /// residual * weight with the same semantics as casa::minMaxMasked (the first
+        /// occurrence in storage order wins, returned values are unweighted). Block
+        /// minima and maxima are computed by askap::TaskScheduler tasks and cached. Residual updates done
+        /// via subtract or declared via invalidate cause only the affected blocks
+        /// to be rescanned.
+        /// @note The residual array is referenced, not copied. It must not be resized
+        /// or reassigned to different storage while attached.
+        /// @ingroup Deconvolver
+        template<class T> class BlockedPeakFinder {
+
+            public:
+                /// @brief constructor
+                /// @param[in] blockSize size of the square block in pixels
+                explicit BlockedPeakFinder(casa::uInt blockSize = 64);
+
+                /// @brief attach to a residual plane
+                /// @details A full scan of the image is done here. Only the first two axes
+                /// can have a length greater than one.
+                /// @param[in] residual residual image (referenced)
+                /// @param[in] weight optional weight image of the same number of elements
+                /// (empty array means no weighting)
+                void attach(casa::Array<T>& residual, const casa::Array<T>& weight = casa::Array<T>());
+
+                /// @brief check whether this object is attached to an image
+                /// @return true, if attach has been called
+                bool attached() const { return itsData != 0; }
+
+                /// @brief find the minimum and maximum of the weighted residual
+                /// @details Blocks invalidated since the last call are rescanned first.
+                /// @param[out] minVal residual value (without weight) at the minimum
+                /// @param[out] maxVal residual value (without weight) at the maximum
+                /// @param[out] minPos position of the minimum
+                /// @param[out] maxPos position of the maximum
+                void findPeaks(T& minVal, T& maxVal, casa::IPosition& minPos, casa::IPosition& maxPos);
+
+                /// @brief find the minimum and maximum of the weighted residual
+                /// @details This version also returns the weighted extrema, which is handy
+                /// to compare peaks found in different planes.
+                /// @param[out] minVal residual value (without weight) at the minimum
+                /// @param[out] maxVal residual value (without weight) at the maximum
+                /// @param[out] minPos position of the minimum
+                /// @param[out] maxPos position of the maximum
+                /// @param[out] minWeighted weighted value at the minimum
+                /// @param[out] maxWeighted weighted value at the maximum
+                void findPeaks(T& minVal, T& maxVal, casa::IPosition& minPos, casa::IPosition& maxPos,
+                               T& minWeighted, T& maxWeighted);
+
+                /// @brief subtract a scaled patch of the psf from the residual
+                /// @details residual[residualStart + i] -= factor * psf[psfStart + i] for
+                /// all i within length. The affected blocks are marked for rescanning.
+                /// @param[in] psf 2D psf image
+                /// @param[in] psfStart bottom left corner of the patch in the psf
+                /// @param[in] residualStart bottom left corner of the patch in the residual
+                /// @param[in] length size of the patch
+                /// @param[in] factor scaling factor
+                void subtract(const casa::Array<T>& psf, const casa::IPosition& psfStart,
+                              const casa::IPosition& residualStart, const casa::IPosition& length,
+                              const T factor);
+
+                /// @brief mark a region of the residual as changed
+                /// @param[in] start bottom left corner of the region
+                /// @param[in] end top right corner of the region (inclusive)
+                void invalidate(const casa::IPosition& start, const casa::IPosition& end);
+
+            private:
+                /// @brief cached extrema of a single block
+                struct BlockPeaks {
+                    T minVal;
+                    T maxVal;
+                    size_t minIndex;
+                    size_t maxIndex;
+                };
+
+                /// @brief rescan all blocks marked as changed
+                void update();
+
+                /// @brief rescan a range of the changed blocks
+                /// @param[in] begin first index into the list of changed blocks
+                /// @param[in] end index past the last one
+                void scanBlocks(size_t begin, size_t end);
+
+                /// @brief subtract a range of rows of the psf patch
+                /// @param[in] psfData pointer to the bottom left corner of the psf patch
+                /// @param[in] psfWidth row length of the psf
+                /// @param[in] resOffset offset of the bottom left corner of the patch in the residual
+                /// @param[in] nCols number of columns in the patch
+                /// @param[in] factor scaling factor
+                /// @param[in] rowBegin first row of the patch
+                /// @param[in] rowEnd row past the last one
+                void subtractRows(const T* psfData, size_t psfWidth, size_t resOffset,
+                                  size_t nCols, T factor, size_t rowBegin, size_t rowEnd);
+
+                /// @brief compute extrema for one block
+                /// @param[in] block index of the block
+                void scanBlock(size_t block);
+
+                /// @brief extrema of a single row, optionally weighted
+                /// @details The loops are free of data-dependent branches, so they vectorise.
+                /// @param[in] row pointer to the first element of the row
+                /// @param[in] wRow pointer to the weights for this row, zero if no weighting
+                /// @param[in] n number of elements
+                /// @param[out] minVal minimum (weighted) value
+                /// @param[out] maxVal maximum (weighted) value
+                static void rowMinMax(const T* row, const T* wRow, const size_t n, T& minVal, T& maxVal);
+
+                /// @brief first index in the row where the (weighted) value equals the given one
+                /// @param[in] row pointer to the first element of the row
+                /// @param[in] wRow pointer to the weights for this row, zero if no weighting
+                /// @param[in] n number of elements
+                /// @param[in] value value to search for
+                /// @return index of the element
+                static size_t findInRow(const T* row, const T* wRow, const size_t n, const T value);
+
+                /// @brief convert linear index into position with the residual dimensionality
+                casa::IPosition toPosition(size_t index) const;
+
+                /// @brief block size in pixels
+                casa::uInt itsBlockSize;
+
+                /// @brief residual image (reference semantics)
+                casa::Array<T> itsResidual;
+
+                /// @brief weight image (reference semantics), may be empty
+                casa::Array<T> itsWeight;
+
+                /// @brief direct pointer to the residual storage
+                T* itsData;
+
+                /// @brief direct pointer to the weight storage, zero if no weighting
+                const T* itsWeightData;
+
+                /// @brief image size
+                size_t itsNx;
+                size_t itsNy;
+
+                /// @brief number of blocks along each axis
+                size_t itsNBlockX;
+                size_t itsNBlockY;
+
+                /// @brief cached extrema for each block
+                std::vector<BlockPeaks> itsBlocks;
+
+                /// @brief flags for blocks which need rescanning
+                std::vector<unsigned char> itsBlockChanged;
+
+                /// @brief list of blocks which need rescanning
+                std::vector<size_t> itsChangedBlocks;
+        };
+
+    } // namespace synthesis
+
+} // namespace askap
+
+#include <deconvolution/BlockedPeakFinder.tcc>
+
+#endif
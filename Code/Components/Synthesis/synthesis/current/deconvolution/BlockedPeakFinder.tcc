@@ -0,0 +1,292 @@
+/// @file BlockedPeakFinder.tcc
+/// @brief Incremental peak search for the clean minor cycle
+/// @details The residual image is split into square blocks and the (weighted)
+/// minimum and maximum of each block are cached. PSF subtraction through this class
+/// marks the affected blocks, so only they are rescanned before the next peak search.
+/// @ingroup Deconvolver
+///
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/bind.hpp>
+
+#include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
+
+namespace askap {
+
+    namespace synthesis {
+
+        template<class T>
+        BlockedPeakFinder<T>::BlockedPeakFinder(casa::uInt blockSize) : itsBlockSize(blockSize),
+                itsData(0), itsWeightData(0), itsNx(0), itsNy(0), itsNBlockX(0), itsNBlockY(0)
+        {
+            ASKAPCHECK(itsBlockSize > 0, "Block size should be positive");
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::attach(casa::Array<T>& residual, const casa::Array<T>& weight)
+        {
+            const casa::IPosition shape = residual.shape();
+            ASKAPCHECK(shape.nelements() >= 2, "Residual image is expected to be at least two dimensional, shape = " << shape);
+            ASKAPCHECK(shape.product() == shape(0) * shape(1),
+                       "Only the first two axes of the residual can be non-degenerate, shape = " << shape);
+            ASKAPCHECK(residual.contiguousStorage(), "Residual image is expected to have contiguous storage");
+            itsResidual.reference(residual);
+            itsData = itsResidual.data();
+            itsNx = shape(0);
+            itsNy = shape(1);
+
+            itsWeightData = 0;
+            itsWeight.resize();
+            if (weight.nelements() > 0) {
+                ASKAPCHECK(weight.nelements() == itsNx * itsNy, "Weight image has " << weight.nelements() <<
+                           " elements, the residual has " << itsNx * itsNy);
+                if (weight.contiguousStorage()) {
+                    itsWeight.reference(weight);
+                } else {
+                    itsWeight.reference(weight.copy());
+                }
+                itsWeightData = itsWeight.data();
+            }
+
+            itsNBlockX = (itsNx + itsBlockSize - 1) / itsBlockSize;
+            itsNBlockY = (itsNy + itsBlockSize - 1) / itsBlockSize;
+            const size_t nBlocks = itsNBlockX * itsNBlockY;
+            itsBlocks.resize(nBlocks);
+            itsBlockChanged.assign(nBlocks, 1);
+            itsChangedBlocks.resize(nBlocks);
+            for (size_t block = 0; block < nBlocks; ++block) {
+                itsChangedBlocks[block] = block;
+            }
+            update();
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::scanBlock(size_t block)
+        {
+            const size_t xStart = (block % itsNBlockX) * itsBlockSize;
+            const size_t yStart = (block / itsNBlockX) * itsBlockSize;
+            const size_t xEnd = std::min(xStart + itsBlockSize, itsNx);
+            const size_t yEnd = std::min(yStart + itsBlockSize, itsNy);
+            const size_t n = xEnd - xStart;
+
+            BlockPeaks peaks;
+            peaks.minVal = std::numeric_limits<T>::max();
+            peaks.maxVal = -std::numeric_limits<T>::max();
+            peaks.minIndex = peaks.maxIndex = yStart * itsNx + xStart;
+
+            for (size_t y = yStart; y < yEnd; ++y) {
+                const size_t offset = y * itsNx + xStart;
+                const T* row = itsData + offset;
+                const T* wRow = itsWeightData != 0 ? itsWeightData + offset : 0;
+                T rowMin, rowMax;
+                rowMinMax(row, wRow, n, rowMin, rowMax);
+                // strict comparison keeps the first occurrence
+                if (rowMin < peaks.minVal) {
+                    peaks.minVal = rowMin;
+                    peaks.minIndex = offset + findInRow(row, wRow, n, rowMin);
+                }
+                if (rowMax > peaks.maxVal) {
+                    peaks.maxVal = rowMax;
+                    peaks.maxIndex = offset + findInRow(row, wRow, n, rowMax);
+                }
+            }
+            itsBlocks[block] = peaks;
+        }
+
+        template<class T>
+        inline void BlockedPeakFinder<T>::rowMinMax(const T* row, const T* wRow, const size_t n, T& minVal, T& maxVal)
+        {
+            if (wRow != 0) {
+                minVal = maxVal = row[0] * wRow[0];
+                for (size_t i = 1; i < n; ++i) {
+                    const T val = row[i] * wRow[i];
+                    minVal = val < minVal ? val : minVal;
+                    maxVal = val > maxVal ? val : maxVal;
+                }
+            } else {
+                minVal = maxVal = row[0];
+                for (size_t i = 1; i < n; ++i) {
+                    const T val = row[i];
+                    minVal = val < minVal ? val : minVal;
+                    maxVal = val > maxVal ? val : maxVal;
+                }
+            }
+        }
+
+        template<class T>
+        inline size_t BlockedPeakFinder<T>::findInRow(const T* row, const T* wRow, const size_t n, const T value)
+        {
+            for (size_t i = 0; i < n; ++i) {
+                const T val = wRow != 0 ? row[i] * wRow[i] : row[i];
+                if (val == value) {
+                    return i;
+                }
+            }
+            // not reachable as the value has been obtained from the same row; we don't throw
+            // because this method is executed by concurrent tasks
+            return 0;
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::update()
+        {
+            const size_t nChanged = itsChangedBlocks.size();
+            // one block per task, the number of changed blocks is usually small
+            TaskScheduler::instance().parallelFor(0, nChanged,
+                    boost::bind(&BlockedPeakFinder<T>::scanBlocks, this, _1, _2), "peaksearch", 1);
+            for (size_t i = 0; i < nChanged; ++i) {
+                itsBlockChanged[itsChangedBlocks[i]] = 0;
+            }
+            itsChangedBlocks.clear();
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::scanBlocks(size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) {
+                scanBlock(itsChangedBlocks[i]);
+            }
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::findPeaks(T& minVal, T& maxVal, casa::IPosition& minPos, casa::IPosition& maxPos)
+        {
+            T minWeighted, maxWeighted;
+            findPeaks(minVal, maxVal, minPos, maxPos, minWeighted, maxWeighted);
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::findPeaks(T& minVal, T& maxVal, casa::IPosition& minPos, casa::IPosition& maxPos,
+                                             T& minWeighted, T& maxWeighted)
+        {
+            ASKAPCHECK(attached(), "BlockedPeakFinder is not attached to an image");
+            update();
+            ASKAPDEBUGASSERT(itsBlocks.size() > 0);
+            size_t minBlock = 0;
+            size_t maxBlock = 0;
+            for (size_t block = 1; block < itsBlocks.size(); ++block) {
+                const BlockPeaks& peaks = itsBlocks[block];
+                const BlockPeaks& minPeaks = itsBlocks[minBlock];
+                const BlockPeaks& maxPeaks = itsBlocks[maxBlock];
+                // ties are resolved in favour of the lower index to match casa::minMax
+                if ((peaks.minVal < minPeaks.minVal) ||
+                        ((peaks.minVal == minPeaks.minVal) && (peaks.minIndex < minPeaks.minIndex))) {
+                    minBlock = block;
+                }
+                if ((peaks.maxVal > maxPeaks.maxVal) ||
+                        ((peaks.maxVal == maxPeaks.maxVal) && (peaks.maxIndex < maxPeaks.maxIndex))) {
+                    maxBlock = block;
+                }
+            }
+            const size_t minIndex = itsBlocks[minBlock].minIndex;
+            const size_t maxIndex = itsBlocks[maxBlock].maxIndex;
+            minVal = itsData[minIndex];
+            maxVal = itsData[maxIndex];
+            minWeighted = itsBlocks[minBlock].minVal;
+            maxWeighted = itsBlocks[maxBlock].maxVal;
+            minPos = toPosition(minIndex);
+            maxPos = toPosition(maxIndex);
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::subtract(const casa::Array<T>& psf, const casa::IPosition& psfStart,
+                                            const casa::IPosition& residualStart, const casa::IPosition& length,
+                                            const T factor)
+        {
+            ASKAPCHECK(attached(), "BlockedPeakFinder is not attached to an image");
+            const casa::IPosition psfShape = psf.shape();
+            ASKAPCHECK(psfShape.nelements() >= 2, "PSF is expected to be at least two dimensional");
+            for (casa::uInt dim = 0; dim < 2; ++dim) {
+                ASKAPCHECK((length(dim) >= 0) && (psfStart(dim) >= 0) && (residualStart(dim) >= 0) &&
+                           (psfStart(dim) + length(dim) <= psfShape(dim)) &&
+                           (residualStart(dim) + length(dim) <= casa::Int(dim == 0 ? itsNx : itsNy)),
+                           "Patch is outside the image: psf start = " << psfStart << ", residual start = " <<
+                           residualStart << ", length = " << length);
+            }
+            if ((length(0) == 0) || (length(1) == 0)) {
+                return;
+            }
+            const size_t psfWidth = psfShape(0);
+
+            casa::Bool deleteIt;
+            const T* psfData = psf.getStorage(deleteIt);
+            TaskScheduler::instance().parallelFor(0, length(1),
+                    boost::bind(&BlockedPeakFinder<T>::subtractRows, this,
+                                psfData + psfStart(1) * psfWidth + psfStart(0), psfWidth,
+                                size_t(residualStart(1) * itsNx + residualStart(0)), size_t(length(0)),
+                                factor, _1, _2), "psfsubtract");
+            psf.freeStorage(psfData, deleteIt);
+
+            invalidate(residualStart, residualStart + length - 1);
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::subtractRows(const T* psfData, size_t psfWidth, size_t resOffset,
+                                                size_t nCols, T factor, size_t rowBegin, size_t rowEnd)
+        {
+            for (size_t row = rowBegin; row < rowEnd; ++row) {
+                T* res = itsData + resOffset + row * itsNx;
+                const T* src = psfData + row * psfWidth;
+                for (size_t i = 0; i < nCols; ++i) {
+                    res[i] -= factor * src[i];
+                }
+            }
+        }
+
+        template<class T>
+        void BlockedPeakFinder<T>::invalidate(const casa::IPosition& start, const casa::IPosition& end)
+        {
+            ASKAPCHECK(attached(), "BlockedPeakFinder is not attached to an image");
+            const size_t bxStart = size_t(start(0) > 0 ? start(0) : 0) / itsBlockSize;
+            const size_t byStart = size_t(start(1) > 0 ? start(1) : 0) / itsBlockSize;
+            const size_t bxEnd = std::min(size_t(end(0) > 0 ? end(0) : 0) / itsBlockSize, itsNBlockX - 1);
+            const size_t byEnd = std::min(size_t(end(1) > 0 ? end(1) : 0) / itsBlockSize, itsNBlockY - 1);
+            for (size_t by = byStart; by <= byEnd; ++by) {
+                for (size_t bx = bxStart; bx <= bxEnd; ++bx) {
+                    const size_t block = by * itsNBlockX + bx;
+                    if (!itsBlockChanged[block]) {
+                        itsBlockChanged[block] = 1;
+                        itsChangedBlocks.push_back(block);
+                    }
+                }
+            }
+        }
+
+        template<class T>
+        casa::IPosition BlockedPeakFinder<T>::toPosition(size_t index) const
+        {
+            casa::IPosition pos(itsResidual.ndim(), 0);
+            pos(0) = index % itsNx;
+            pos(1) = index / itsNx;
+            return pos;
+        }
+
+    } // namespace synthesis
+
+} // namespace askap
@@ -34,6 +34,7 @@
 #define ASKAP_SYNTHESIS_DECONVOLVERBASISFUNCTION_H
 
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <casa/aips.h>
@@ -44,6 +45,7 @@
 #include <deconvolution/DeconvolverControl.h>
 #include <deconvolution/DeconvolverMonitor.h>
 #include <deconvolution/BasisFunction.h>
+#include <deconvolution/BlockedPeakFinder.h>
 
 namespace askap {
 
@@ -124,10 +126,15 @@ namespace askap {
 
                 void initialiseResidual();
 
+                /// @brief attach peak finders to each plane of the residual cube
+                /// @details Also sets the weight used in the peak search.
+                void attachPeakFinders();
+
+                /// @brief find the extrema of the weighted residuals over all scales
+                /// @details The values returned are without weights, the positions
+                /// are three dimensional (the last axis is the scale).
                 void minMaxMaskedScales(T& minVal, T& maxVal,
-                                        casa::IPosition& minPos, casa::IPosition& maxPos,
-                                        const casa::Array<T>& dataArray,
-                                        const casa::Array<T>& maskArray);
+                                        casa::IPosition& minPos, casa::IPosition& maxPos);
 
                 // Find the coefficients for each scale by applying the
                 // inverse of the coupling matrix
@@ -148,6 +155,9 @@ namespace askap {
                 /// Point spread functions convolved with basis functions
                 casa::Array<T> itsPSFBasisFunction;
 
+                /// Peak search for each plane of itsResidualBasisFunction
+                std::vector<BlockedPeakFinder<T> > itsPeakFinders;
+
                 /// Use cross terms in the source removal step?
                 casa::Bool itsUseCrossTerms;
 
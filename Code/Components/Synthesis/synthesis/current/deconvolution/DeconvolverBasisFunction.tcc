@@ -44,6 +44,7 @@
 #include <measurementequation/SynthesisParamsHelper.h>
 #include <deconvolution/DeconvolverBasisFunction.h>
 #include <deconvolution/MultiScaleBasisFunction.h>
+#include <profile/Metrics.h>
 
 ASKAP_LOGGER(decbflogger, ".deconvolution.basisfunction");
 
@@ -434,8 +435,14 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverBasisFunction<T, FT>::deconvolve()
         {
+            ASKAPMETRICS_TIMER("deconvolver.deconvolve");
             this->initialise();
 
+            // the residuals are modified in place, the peak finders keep track of the
+            // regions changed by the psf subtraction
+            attachPeakFinders();
+            this->state()->setTotalFlux(sum(this->model()));
+
             ASKAPLOG_INFO_STR(decbflogger, "Performing BasisFunction CLEAN for "
                                   << this->control()->targetIter() << " iterations");
 
@@ -467,8 +474,7 @@ namespace askap {
             // Here the weights image is used as a weight in the determination
             // of the maximum i.e. it finds the max in weight . residual. The values
             // returned are without the weight
-            minMaxMaskedScales(minVal, maxVal, minPos, maxPos, this->itsResidualBasisFunction,
-                               this->weight(0));
+            minMaxMaskedScales(minVal, maxVal, minPos, maxPos);
             casa::IPosition absPeakPos;
 
             if (abs(minVal) < abs(maxVal)) {
@@ -555,16 +561,14 @@ namespace askap {
 
             this->state()->setPeakResidual(abs(absPeakVal));
             this->state()->setObjectiveFunction(abs(absPeakVal));
-            this->state()->setTotalFlux(sum(this->model()));
 
             const casa::IPosition residualShape(this->itsResidualBasisFunction.shape());
             const casa::IPosition psfShape(this->itsPSFBasisFunction.shape());
 
             const casa::uInt ndim(this->itsResidualBasisFunction.shape().size());
 
-            casa::IPosition residualStart(ndim, 0), residualEnd(ndim, 0), residualStride(ndim, 1);
+            casa::IPosition residualStart(ndim, 0), residualEnd(ndim, 0);
             casa::IPosition psfStart(ndim, 0), psfEnd(ndim, 0), psfStride(ndim, 1);
-            casa::IPosition psfCrossTermsStart(ndim + 1, 0), psfCrossTermsEnd(ndim + 1, 0), psfCrossTermsStride(ndim + 1, 1);
 
             const casa::IPosition modelShape(this->model().shape());
             const casa::uInt modelNdim(this->model().shape().size());
@@ -583,9 +587,6 @@ namespace askap {
                 psfEnd(dim) = min(Int(this->itsPeakPSFPos(dim) - (absPeakPos(dim) - residualEnd(dim))),
                                   Int(psfShape(dim) - 1));
 
-                psfCrossTermsStart(dim) = psfStart(dim);
-                psfCrossTermsEnd(dim) = psfEnd(dim);
-
                 modelStart(dim) = residualStart(dim);
                 modelEnd(dim) = residualEnd(dim);
             }
@@ -603,8 +604,10 @@ namespace askap {
                     psfStart(2) = psfEnd(2) = term;
                     casa::Slicer psfSlicer(psfStart, psfEnd, psfStride, Slicer::endIsLast);
                     typename casa::Array<T> modelSlice = this->model()(modelSlicer).nonDegenerate();
-                    modelSlice += this->control()->gain() * peakValues(term) *
-                                  this->itsBasisFunction->basisFunction()(psfSlicer).nonDegenerate();
+                    const casa::Array<T> bfSlice = this->itsBasisFunction->basisFunction()(psfSlicer).nonDegenerate();
+                    modelSlice += this->control()->gain() * peakValues(term) * bfSlice;
+                    this->state()->setTotalFlux(this->state()->totalFlux() +
+                                                this->control()->gain() * peakValues(term) * sum(bfSlice));
                 }
             }
 
@@ -618,35 +621,30 @@ namespace askap {
                 }
             }
 
-            // Subtract PSFs
+            // Subtract PSFs. Only the affected blocks of each scale are
+            // searched again at the next iteration
+            const casa::IPosition patchStart(2, residualStart(0), residualStart(1));
+            const casa::IPosition patchPsfStart(2, psfStart(0), psfStart(1));
+            const casa::IPosition patchShape(2, residualEnd(0) - residualStart(0) + 1,
+                                             residualEnd(1) - residualStart(1) + 1);
+            const Cube<T> psfBasisFunction(this->itsPSFBasisFunction);
             for (uInt term = 0; term < nterms; term++) {
                 if (abs(peakValues(term)) > 0.0) {
-                    psfStart(2) = psfEnd(2) = term;
-                    casa::Slicer psfSlicer(psfStart, psfEnd, psfStride, Slicer::endIsLast);
-                    residualStart(2) = residualEnd(2) = term;
-                    casa::Slicer residualSlicer(residualStart, residualEnd, residualStride, Slicer::endIsLast);
-                    typename casa::Array<T> residualBFSlice = this->itsResidualBasisFunction(residualSlicer).nonDegenerate();
-                    residualBFSlice -= this->control()->gain() * peakValues(term) * this->itsPSFBasisFunction(psfSlicer).nonDegenerate();
+                    itsPeakFinders[term].subtract(psfBasisFunction.xyPlane(term), patchPsfStart, patchStart,
+                                                  patchShape, this->control()->gain() * peakValues(term));
                 }
             }
 
             if (itsUseCrossTerms) {
+                const casa::IPosition crossTermsPlane(4, psfShape(0), psfShape(1), 1, 1);
                 for (uInt term1 = 0; term1 < nterms; term1++) {
                     if (abs(peakValues(term1)) > 0.0) {
                         for (uInt term = 0; term < nterms; term++) {
                             if (term != term1) {
-                                residualStart(2) = term;
-                                residualEnd(2) = term;
-                                casa::Slicer residualSlicer(residualStart, residualEnd, residualStride, Slicer::endIsLast);
-
-                                psfCrossTermsStart(2) = term1;
-                                psfCrossTermsEnd(2) = term1;
-                                psfCrossTermsStart(3) = term;
-                                psfCrossTermsEnd(3) = term;
-                                casa::Slicer psfCrossTermsSlicer(psfCrossTermsStart, psfCrossTermsEnd, psfCrossTermsStride, Slicer::endIsLast);
-                                typename casa::Array<T> residualBFSlice = this->itsResidualBasisFunction(residualSlicer).nonDegenerate();
-                                residualBFSlice -= this->control()->gain() * peakValues(term1) *
-                                                   this->itsPSFCrossTerms(psfCrossTermsSlicer).nonDegenerate();
+                                const casa::Slicer crossTermsSlicer(IPosition(4, 0, 0, term1, term), crossTermsPlane);
+                                itsPeakFinders[term].subtract(this->itsPSFCrossTerms(crossTermsSlicer).nonDegenerate(2),
+                                                              patchPsfStart, patchStart, patchShape,
+                                                              this->control()->gain() * peakValues(term1));
                             }
                         }
                     }
@@ -657,55 +655,45 @@ namespace askap {
         }
 
         template<class T, class FT>
-        void DeconvolverBasisFunction<T, FT>::minMaxMaskedScales(T& minVal, T& maxVal,
-                IPosition& minPos, IPosition& maxPos,
-                const Array<T>& dataArray,
-                const Array<T>& weightArray)
+        void DeconvolverBasisFunction<T, FT>::attachPeakFinders()
         {
-            const Cube<T> data(dataArray);
-            bool isWeighted(weightArray.shape().nonDegenerate().conform(data.xyPlane(0).shape()));
-
+            Cube<T> data(this->itsResidualBasisFunction);
+            const bool isWeighted(this->weight(0).shape().nonDegenerate().conform(data.xyPlane(0).shape()));
             const uInt nScales = data.shape()(2);
-
-            Vector<T> sMaxVal(nScales);
-            Vector<T> sMinVal(nScales);
-            Vector<IPosition> sMinPos(nScales);
-            Vector<IPosition> sMaxPos(nScales);
-            {
-                if (isWeighted) {
-                    for (uInt scale = 0; scale < nScales; scale++) {
-                        casa::minMaxMasked(sMinVal(scale), sMaxVal(scale), sMinPos(scale), sMaxPos(scale),
-                                           Cube<T>(dataArray).xyPlane(scale), weightArray.nonDegenerate());
-                    }
-                } else {
-                    for (uInt scale = 0; scale < nScales; scale++) {
-                        casa::minMax(sMinVal(scale), sMaxVal(scale), sMinPos(scale), sMaxPos(scale),
-                                     Cube<T>(dataArray).xyPlane(scale));
-                    }
-                }
+            itsPeakFinders.resize(nScales);
+            for (uInt scale = 0; scale < nScales; scale++) {
+                casa::Array<T> plane(data.xyPlane(scale));
+                itsPeakFinders[scale].attach(plane, isWeighted ? this->weight(0) : casa::Array<T>());
             }
-            minPos = IPosition(3, sMinPos(0)(0), sMinPos(0)(1), 0);
-            maxPos = IPosition(3, sMaxPos(0)(0), sMaxPos(0)(1), 0);
-            minVal = sMinVal(0);
-            maxVal = sMaxVal(0);
-
-            for (uInt scale = 1; scale < nScales; scale++) {
-                if (sMinVal(scale) <= minVal) {
-                    minVal = sMinVal(scale);
-                    minPos = IPosition(3, sMinPos(scale)(0), sMinPos(scale)(1), scale);
-                }
+        }
+
+        template<class T, class FT>
+        void DeconvolverBasisFunction<T, FT>::minMaxMaskedScales(T& minVal, T& maxVal,
+                IPosition& minPos, IPosition& maxPos)
+        {
+            const uInt nScales = itsPeakFinders.size();
+            ASKAPCHECK(nScales > 0, "Peak finders have not been set up");
 
-                if (sMaxVal(scale) >= maxVal) {
-                    maxVal = sMaxVal(scale);
-                    maxPos = IPosition(3, sMaxPos(scale)(0), sMaxPos(scale)(1), scale);
+            // the comparison between scales is done with the weighted values, the returned
+            // values are without weights
+            T minWeighted(0.0), maxWeighted(0.0);
+            for (uInt scale = 0; scale < nScales; scale++) {
+                T sMinVal(0.0), sMaxVal(0.0), sMinWeighted(0.0), sMaxWeighted(0.0);
+                IPosition sMinPos, sMaxPos;
+                itsPeakFinders[scale].findPeaks(sMinVal, sMaxVal, sMinPos, sMaxPos, sMinWeighted, sMaxWeighted);
+                if ((scale == 0) || (sMinWeighted <= minWeighted)) {
+                    minWeighted = sMinWeighted;
+                    minVal = sMinVal;
+                    minPos = IPosition(3, sMinPos(0), sMinPos(1), scale);
+                }
+                if ((scale == 0) || (sMaxWeighted >= maxWeighted)) {
+                    maxWeighted = sMaxWeighted;
+                    maxVal = sMaxVal;
+                    maxPos = IPosition(3, sMaxPos(0), sMaxPos(1), scale);
                 }
             }
-
-            // If weighting (presumably with weights) was done we need to
-            // look up the original values (without the weights).
-            minVal = data.xyPlane(minPos(2))(minPos);
-            maxVal = data.xyPlane(maxPos(2))(maxPos);
         }
+
         template<class T, class FT>
         Vector<T> DeconvolverBasisFunction<T, FT>::findCoefficients(const Matrix<Double>& invCoupling,
                 const Vector<T>& peakValues)
@@ -42,6 +42,7 @@ ASKAP_LOGGER(decentropylogger, ".deconvolution.entropy");
 #include <deconvolution/EntropyBase.h>
 #include <deconvolution/EntropyI.h>
 #include <deconvolution/Emptiness.h>
+#include <profile/Metrics.h>
 
 using namespace casa;
 
@@ -100,6 +101,7 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverEntropy<T, FT>::deconvolve()
         {
+            ASKAPMETRICS_TIMER("deconvolver.deconvolve");
             this->initialise();
 
             ASKAPLOG_INFO_STR(decentropylogger, "Performing Entropy deconvolution for "
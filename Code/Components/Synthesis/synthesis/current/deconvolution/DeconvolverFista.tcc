@@ -41,6 +41,7 @@ ASKAP_LOGGER(decfistalogger, ".deconvolution.fista");
 
 #include <deconvolution/DeconvolverFista.h>
 #include <deconvolution/MultiScaleBasisFunction.h>
+#include <profile/Metrics.h>
 #include <measurementequation/SynthesisParamsHelper.h>
 #include <utils/ImageUtils.h>
 
@@ -117,6 +118,7 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverFista<T, FT>::deconvolve()
         {
+            ASKAPMETRICS_TIMER("deconvolver.deconvolve");
             this->initialise();
 
             bool isMasked(this->itsWeight.nelements());
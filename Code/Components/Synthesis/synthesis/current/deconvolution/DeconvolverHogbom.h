@@ -42,6 +42,7 @@
 #include <deconvolution/DeconvolverState.h>
 #include <deconvolution/DeconvolverControl.h>
 #include <deconvolution/DeconvolverMonitor.h>
+#include <deconvolution/BlockedPeakFinder.h>
 
 namespace askap {
 
@@ -98,6 +99,10 @@ namespace askap {
                 /// @brief Perform the deconvolution
                 /// @detail This is the main deconvolution method.
                 bool oneIteration();
+
+                /// @brief peak search over the residual image
+                /// @details Attached to the residual at the start of deconvolve
+                BlockedPeakFinder<T> itsPeakFinder;
         };
 
     } // namespace synthesis
@@ -39,6 +39,7 @@
 ASKAP_LOGGER(dechogbomlogger, ".deconvolution.hogbom");
 
 #include <deconvolution/DeconvolverHogbom.h>
+#include <profile/Metrics.h>
 
 namespace askap {
 
@@ -80,8 +81,15 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverHogbom<T, FT>::deconvolve()
         {
+            ASKAPMETRICS_TIMER("deconvolver.deconvolve");
             this->initialise();
 
+            // the residual is modified in place, so the peak finder is attached once
+            // and keeps track of the regions changed by the psf subtraction
+            const bool isMasked(this->weight(0).shape().conform(this->dirty(0).shape()));
+            itsPeakFinder.attach(this->dirty(0), isMasked ? this->weight(0) : casa::Array<T>());
+            this->state()->setTotalFlux(sum(this->model()));
+
             ASKAPLOG_INFO_STR(dechogbomlogger, "Performing Hogbom CLEAN for " << this->control()->targetIter() << " iterations");
             do {
                 this->oneIteration();
@@ -108,19 +116,12 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverHogbom<T, FT>::oneIteration()
         {
-            const bool isMasked(this->weight(0).shape().conform(this->dirty(0).shape()));
-
-            // Find peak in residual image
+            // Find peak in residual image. The weight (if any) is applied in the
+            // search, but the values are returned without it
             casa::IPosition minPos;
             casa::IPosition maxPos;
             T minVal, maxVal;
-            if (isMasked) {
-                casa::minMaxMasked(minVal, maxVal, minPos, maxPos, this->dirty(0), this->weight(0));
-                minVal = this->dirty(0)(minPos);
-                maxVal = this->dirty(0)(maxPos);
-            } else {
-                casa::minMax(minVal, maxVal, minPos, maxPos, this->dirty(0));
-            }
+            itsPeakFinder.findPeaks(minVal, maxVal, minPos, maxPos);
             //
             ASKAPLOG_INFO_STR(dechogbomlogger, "Maximum = " << maxVal << " at location " << maxPos);
             ASKAPLOG_INFO_STR(dechogbomlogger, "Minimum = " << minVal << " at location " << minPos);
@@ -137,7 +138,6 @@ namespace askap {
 
             this->state()->setPeakResidual(absPeakVal);
             this->state()->setObjectiveFunction(absPeakVal);
-            this->state()->setTotalFlux(sum(this->model()));
 
             // Has this terminated for any reason?
             if (this->control()->terminate(*(this->state()))) {
@@ -147,23 +147,12 @@ namespace askap {
             const uInt nx(this->psf(0).shape()(0));
             const uInt ny(this->psf(0).shape()(1));
 
-            IPosition subPsfShape(this->findSubPsfShape());
-
             // Now we adjust model and residual for this component
             const casa::IPosition residualShape(this->dirty(0).shape().nonDegenerate());
-            const IPosition subPsfStart(2, nx / 2 - subPsfShape(0) / 2, ny / 2 - subPsfShape(1) / 2);
-            const IPosition subPsfEnd(2, nx / 2 + subPsfShape(0) / 2 - 1, ny / 2 + subPsfShape(1) / 2 - 1);
-            const IPosition subPsfStride(2, 1, 1);
-
-            Slicer subPsfSlicer(subPsfStart, subPsfEnd, subPsfStride, Slicer::endIsLast);
-
             const casa::IPosition psfShape(2, nx, ny);
 
-            casa::IPosition residualStart(2, 0), residualEnd(2, 0), residualStride(2, 1);
-            casa::IPosition psfStart(2, 0), psfEnd(2, 0), psfStride(2, 1);
-
-            const casa::IPosition modelShape(this->model(0).shape().nonDegenerate());
-            casa::IPosition modelStart(2, 0), modelEnd(2, 0), modelStride(2, 1);
+            casa::IPosition residualStart(2, 0), residualEnd(2, 0);
+            casa::IPosition psfStart(2, 0), psfEnd(2, 0);
 
             // Wrangle the start, end, and shape into consistent form.
             for (uInt dim = 0; dim < 2; dim++) {
@@ -174,32 +163,25 @@ namespace askap {
                 psfStart(dim) = max(0, Int(this->itsPeakPSFPos(dim) - (absPeakPos(dim) - residualStart(dim))));
                 psfEnd(dim) = min(Int(this->itsPeakPSFPos(dim) - (absPeakPos(dim) - residualEnd(dim))),
                                   Int(psfShape(dim) - 1));
-
-                modelStart(dim) = residualStart(dim);
-                modelEnd(dim) = residualEnd(dim);
             }
 
-            casa::Slicer psfSlicer(psfStart, psfEnd, psfStride, Slicer::endIsLast);
-            casa::Slicer residualSlicer(residualStart, residualEnd, residualStride, Slicer::endIsLast);
-            casa::Slicer modelSlicer(modelStart, modelEnd, modelStride, Slicer::endIsLast);
-
-            if (!(residualSlicer.length() == psfSlicer.length()) || !(residualSlicer.stride() == psfSlicer.stride())) {
+            const casa::IPosition patchShape(residualEnd - residualStart + 1);
+            if (!(patchShape == psfEnd - psfStart + 1) || (patchShape(0) <= 0) || (patchShape(1) <= 0)) {
                 ASKAPLOG_INFO_STR(dechogbomlogger, "Peak of PSF  : " << this->itsPeakPSFPos);
                 ASKAPLOG_INFO_STR(dechogbomlogger, "Peak of residual: " << absPeakPos);
                 ASKAPLOG_INFO_STR(dechogbomlogger, "Residual start  : " << residualStart << " end: " << residualEnd);
                 ASKAPLOG_INFO_STR(dechogbomlogger, "PSF   start  : " << psfStart << " end: " << psfEnd);
-                ASKAPLOG_INFO_STR(dechogbomlogger, "Residual slicer : " << residualSlicer);
-                ASKAPLOG_INFO_STR(dechogbomlogger, "PSF slicer   : " << psfSlicer);
                 throw AskapError("Mismatch in slicers for residual and psf images");
             }
 
             // Add to model
             this->model()(absPeakPos) = this->model()(absPeakPos) + this->control()->gain() * absPeakVal;
+            this->state()->setTotalFlux(this->state()->totalFlux() + this->control()->gain() * absPeakVal);
 
-            // Subtract entire PSF from residual image
-
-            this->dirty()(residualSlicer) = this->dirty()(residualSlicer)
-                                            - this->control()->gain() * absPeakVal * this->psf()(psfSlicer);
+            // Subtract entire PSF from residual image, only the affected part
+            // of the residual is searched again at the next iteration
+            itsPeakFinder.subtract(this->psf(), psfStart, residualStart, patchShape,
+                                   this->control()->gain() * absPeakVal);
 
             return True;
         }
@@ -34,6 +34,7 @@
 
 #include <casa/aips.h>
 #include <askap/AskapLogging.h>
+#include <profile/Metrics.h>
 ASKAP_LOGGER(decmonlogger, ".deconvolution.monitor");
 
 #include <deconvolution/DeconvolverMonitor.h>
@@ -52,6 +53,7 @@ namespace askap {
         template<class T>
         void DeconvolverMonitor<T>::monitor(const DeconvolverState<T>& ds)
         {
+            ASKAPMETRICS_COUNT("deconvolver.iterations", 1);
             if (itsVerbose) {
                 ASKAPLOG_INFO_STR(decmonlogger, "Iteration " << ds.currentIter()
                                       << ", Peak residual " << ds.peakResidual()
@@ -46,6 +46,7 @@ ASKAP_LOGGER(decmtbflogger, ".deconvolution.multitermbasisfunction");
 
 #include <deconvolution/DeconvolverMultiTermBasisFunction.h>
 #include <deconvolution/MultiScaleBasisFunction.h>
+#include <profile/Metrics.h>
 
 namespace askap {
 
@@ -431,6 +432,7 @@ namespace askap {
         template<class T, class FT>
         bool DeconvolverMultiTermBasisFunction<T, FT>::deconvolve()
         {
+            ASKAPMETRICS_TIMER("deconvolver.deconvolve");
             ASKAPTRACE("DeconvolverMultiTermBasisFunction::deconvolve");
             this->initialise();
 
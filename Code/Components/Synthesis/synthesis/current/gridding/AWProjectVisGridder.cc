@@ -602,7 +602,21 @@ void AWProjectVisGridder::finaliseWeights(casa::Array<double>& out)
     }
 
     //SphFuncVisGridder::correctConvolution(cOut);
-    scimath::PaddingUtils::fftPad(cOut, out, paddingFactor());
+    if (gridSlabs()) {
+        // the weights are interpolated to the full image and the columns of the local slab
+        // are cut out (the sums of weights are already summed across slabs in finaliseGrid).
+        // The temporary has the size of the full image, but it is held only briefly.
+        casa::Array<double> full(fullImageShape(itsAxes, out.shape()));
+        scimath::PaddingUtils::fftPad(cOut, full, paddingFactor());
+        const std::pair<int,int> cols = localImageColumns(out.shape());
+        if (cols.first < cols.second) {
+            casa::IPosition start(full.shape().nelements(), 0);
+            start(0) = cols.first;
+            out = full(casa::Slicer(start, out.shape()));
+        }
+    } else {
+        scimath::PaddingUtils::fftPad(cOut, out, paddingFactor());
+    }
 
     ASKAPLOG_DEBUG_STR(logger,
         "Finished finalising the weights, the sum over all convolution functions is "
@@ -0,0 +1,402 @@
+/// @file
+///
+/// @brief Slab decomposition of a uv-grid and its distributed FFT
+/// @details A very large grid may not fit into the memory of a single process.
+/// This class splits the grid into slabs of rows (v-axis), so each process only
+/// holds its own rows (plus a halo for the support of the gridding kernel), and
+/// implements the FFT of such a distributed grid. The transform is done in two
+/// passes: along u for the local rows, then, after an all-to-all transpose, along
+/// v for a slab of columns. Therefore, each process ends up with a slab of image
+/// columns and the full grid is never held in one place.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+
+#include <gridding/GridSlabFFT.h>
+
+#include <askap_synthesis.h>
+#include <askap/AskapLogging.h>
+ASKAP_LOGGER(logger, ".gridding.gridslabfft");
+
+#include <askap/AskapError.h>
+#include <profile/AskapProfiler.h>
+#include <fft/FFTWrapper.h>
+
+#include <casa/Arrays/Matrix.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief constructor
+/// @param[in] comms communication interface
+/// @param[in] halo number of halo rows on either side of the slab
+GridSlabFFT::GridSlabFFT(const boost::shared_ptr<IGridSlabComms> &comms, const casa::uInt halo) :
+     itsComms(comms), itsHalo(halo)
+{
+  ASKAPCHECK(itsComms, "Communication interface is required for the slab decomposition of the grid");
+  ASKAPCHECK(itsComms->slab() < itsComms->nSlabs(), "Slab number "<<itsComms->slab()<<
+             " exceeds the number of slabs ("<<itsComms->nSlabs()<<")");
+  ASKAPLOG_DEBUG_STR(logger, "Grid is split into "<<itsComms->nSlabs()<<" slabs, this process holds slab "<<
+                     itsComms->slab()<<" with "<<itsHalo<<" halo rows");
+}
+
+/// @brief number of slabs
+/// @return number of processes sharing the grid
+casa::uInt GridSlabFFT::nSlabs() const
+{
+  return itsComms->nSlabs();
+}
+
+/// @brief slab held by this process
+/// @return slab number
+casa::uInt GridSlabFFT::slab() const
+{
+  return itsComms->slab();
+}
+
+/// @brief part of an axis assigned to the given slab
+/// @param[in] length length of the axis
+/// @param[in] nSlabs number of slabs
+/// @param[in] slab slab number
+/// @return a pair with the first element and the element past the last
+std::pair<int,int> GridSlabFFT::range(const int length, const casa::uInt nSlabs, const casa::uInt slab)
+{
+  ASKAPDEBUGASSERT(nSlabs > 0);
+  ASKAPDEBUGASSERT(slab < nSlabs);
+  const int base = length / int(nSlabs);
+  const int remainder = length % int(nSlabs);
+  const int first = int(slab) * base + std::min(int(slab), remainder);
+  const int last = first + base + (int(slab) < remainder ? 1 : 0);
+  return std::pair<int,int>(first, last);
+}
+
+/// @brief rows of the grid owned by this process
+/// @param[in] shape shape of the full grid
+/// @return a pair with the first row and the row past the last
+std::pair<int,int> GridSlabFFT::rows(const casa::IPosition &shape) const
+{
+  checkShape(shape);
+  return range(shape(1), nSlabs(), slab());
+}
+
+/// @brief first row of the local grid
+/// @details The local grid starts with the halo, so this can be negative.
+/// @param[in] shape shape of the full grid
+/// @return row of the full grid corresponding to the first row of the local grid
+int GridSlabFFT::firstLocalRow(const casa::IPosition &shape) const
+{
+  return rows(shape).first - int(itsHalo);
+}
+
+/// @brief shape of the local grid
+/// @param[in] shape shape of the full grid
+/// @return shape of the part of the grid held by this process (including the halo)
+casa::IPosition GridSlabFFT::localShape(const casa::IPosition &shape) const
+{
+  const std::pair<int,int> owned = rows(shape);
+  casa::IPosition result(shape);
+  result(1) = owned.second - owned.first + 2 * int(itsHalo);
+  return result;
+}
+
+/// @brief columns of the image held by this process
+/// @param[in] shape shape of the full grid
+/// @return a pair with the first column and the column past the last
+std::pair<int,int> GridSlabFFT::columns(const casa::IPosition &shape) const
+{
+  checkShape(shape);
+  return range(shape(0), nSlabs(), slab());
+}
+
+/// @brief columns of the image before padding assigned to the given slab
+/// @details The padded image is split as the grid, see columns. The image is the
+/// centred part of it, so the outer slabs may get fewer columns (or none).
+/// @param[in] nx number of columns of the image before padding
+/// @param[in] paddedNx number of columns of the padded image (grid)
+/// @param[in] nSlabs number of slabs
+/// @param[in] slab slab number
+/// @return a pair with the first column and the column past the last
+std::pair<int,int> GridSlabFFT::imageColumns(const int nx, const int paddedNx, const casa::uInt nSlabs, 
+                                             const casa::uInt slab)
+{
+  ASKAPDEBUGASSERT(paddedNx >= nx);
+  // the same offset as used by PaddingUtils::extract
+  const int offset = (paddedNx - nx) / 2;
+  const std::pair<int,int> padded = range(paddedNx, nSlabs, slab);
+  const int first = std::min(nx, std::max(0, padded.first - offset));
+  const int last = std::max(first, std::min(nx, padded.second - offset));
+  return std::pair<int,int>(first, last);
+}
+
+/// @brief shape of the local image slab
+/// @param[in] shape shape of the full grid
+/// @return shape of the transposed slab of columns held by this process
+casa::IPosition GridSlabFFT::imageShape(const casa::IPosition &shape) const
+{
+  const std::pair<int,int> cols = columns(shape);
+  casa::IPosition result(shape);
+  result(0) = shape(1);
+  result(1) = cols.second - cols.first;
+  return result;
+}
+
+/// @brief rows of the full grid held by the given slab
+/// @details These are the owned rows plus the halo, clipped to the grid.
+/// @param[in] ny number of rows in the full grid
+/// @param[in] slab slab number
+/// @return a pair with the first row and the row past the last
+std::pair<int,int> GridSlabFFT::heldRows(const int ny, const casa::uInt slab) const
+{
+  const std::pair<int,int> owned = range(ny, nSlabs(), slab);
+  return std::pair<int,int>(std::max(0, owned.first - int(itsHalo)), std::min(ny, owned.second + int(itsHalo)));
+}
+
+/// @brief check the shape of the full grid
+/// @param[in] shape shape to test
+void GridSlabFFT::checkShape(const casa::IPosition &shape) const
+{
+  ASKAPCHECK(shape.nelements() >= 2, "Grid is expected to have at least 2 dimensions, you have "<<shape);
+  ASKAPCHECK((shape(0) >= int(nSlabs())) && (shape(1) >= int(nSlabs())), "Grid of shape "<<shape<<
+             " is too small to be split into "<<nSlabs()<<" slabs");
+}
+
+/// @brief sum an array across all slabs
+/// @details All processes have to call this method with arrays of the same shape.
+/// It is used for the quantities which are accumulated separately for each slab
+/// (e.g. the sums of weights).
+/// @param[in] values array to sum, replaced by the sum on output
+void GridSlabFFT::sum(casa::Array<double> &values) const
+{
+  ASKAPTRACE("GridSlabFFT::sum");
+  // every round exchanges the local values, so each slab gets the values of all others once
+  std::vector<double> local;
+  local.reserve(values.nelements());
+  for (casa::Array<double>::iterator it = values.begin(); it != values.end(); ++it) {
+       local.push_back(*it);
+  }
+  std::vector<double> received(local.size());
+  for (casa::uInt round = 0; round < nRounds(nSlabs()); ++round) {
+       const casa::uInt other = partner(slab(), nSlabs(), round);
+       if (other == nSlabs() || local.empty()) {
+           continue;
+       }
+       itsComms->exchange(other, &local[0], local.size() * sizeof(double),
+                          &received[0], received.size() * sizeof(double));
+       std::vector<double>::const_iterator ci = received.begin();
+       for (casa::Array<double>::iterator it = values.begin(); it != values.end(); ++it,++ci) {
+            *it += *ci;
+       }
+  }
+}
+
+/// @brief number of exchange rounds
+/// @param[in] nSlabs number of slabs
+/// @return number of rounds required for every pair of slabs to exchange data
+casa::uInt GridSlabFFT::nRounds(const casa::uInt nSlabs)
+{
+  // an odd number of slabs is padded with a dummy slab
+  const casa::uInt nEven = nSlabs + nSlabs % 2;
+  return nEven > 1 ? nEven - 1 : 0;
+}
+
+/// @brief partner for the given round
+/// @details Slabs are paired up with a round-robin schedule, so each slab
+/// talks to exactly one other slab in every round.
+/// @param[in] slab slab number
+/// @param[in] nSlabs number of slabs
+/// @param[in] round round number (0..nRounds-1)
+/// @return slab number of the partner or nSlabs if this slab is idle in the given round
+casa::uInt GridSlabFFT::partner(const casa::uInt slab, const casa::uInt nSlabs, const casa::uInt round)
+{
+  ASKAPDEBUGASSERT(slab < nSlabs);
+  ASKAPDEBUGASSERT(round < nRounds(nSlabs));
+  // the circle method: slabs 0..nEven-2 are paired as slab + partner = round (mod nEven-1),
+  // the slab left without a partner is paired with the last (fixed) slab
+  const int nEven = int(nSlabs + nSlabs % 2);
+  const int modulo = nEven - 1;
+  int result = 0;
+  if (int(slab) == modulo) {
+      for (; result < modulo; ++result) {
+           if ((2 * result) % modulo == int(round)) {
+               break;
+           }
+      }
+      ASKAPDEBUGASSERT(result < modulo);
+  } else {
+      result = ((int(round) - int(slab)) % modulo + modulo) % modulo;
+      if (result == int(slab)) {
+          result = modulo;
+      }
+  }
+  return result < int(nSlabs) ? casa::uInt(result) : nSlabs;
+}
+
+/// @brief transform the distributed grid into image
+/// @param[in] shape shape of the full grid
+/// @param[in] grid local grid (the shape is given by localShape)
+/// @param[out] image local image slab (resized to imageShape)
+void GridSlabFFT::toImage(const casa::IPosition &shape, const casa::Array<casa::Complex> &grid,
+                          casa::Array<casa::DComplex> &image) const
+{
+  ASKAPTRACE("GridSlabFFT::toImage");
+  const casa::IPosition local = localShape(shape);
+  ASKAPCHECK(grid.shape() == local, "Local grid is expected to have the shape of "<<local<<
+             ", you have "<<grid.shape());
+  const int nx = shape(0);
+  const int ny = shape(1);
+  const size_t nPlanes = size_t(shape.product()) / (size_t(nx) * size_t(ny));
+  const int first = firstLocalRow(shape);
+  const std::pair<int,int> held = heldRows(ny, slab());
+  const std::pair<int,int> cols = columns(shape);
+  const int nCols = cols.second - cols.first;
+
+  image.resize(imageShape(shape));
+  image.set(casa::DComplex(0.));
+  casa::DComplex *imageData = image.data();
+
+  // rows held by this process, transformed along the first axis
+  casa::Matrix<casa::DComplex> rowsBuf(nx, held.second - held.first);
+  std::vector<casa::DComplex> sendBuf, recvBuf;
+
+  casa::Bool deleteIt;
+  const casa::Complex *gridData = grid.getStorage(deleteIt);
+  for (size_t plane = 0; plane < nPlanes; ++plane) {
+       const casa::Complex *gridPlane = gridData + plane * size_t(nx) * size_t(local(1));
+       for (int y = held.first; y < held.second; ++y) {
+            const casa::Complex *src = gridPlane + size_t(y - first) * size_t(nx);
+            for (int x = 0; x < nx; ++x) {
+                 rowsBuf(x, y - held.first) = casa::DComplex(src[x]);
+            }
+       }
+       scimath::fft1d(rowsBuf, false);
+
+       // transpose into the local image slab, halo rows are added to the rows of the owner
+       casa::DComplex *imagePlane = imageData + plane * size_t(ny) * size_t(nCols);
+       for (int y = held.first; y < held.second; ++y) {
+            for (int x = cols.first; x < cols.second; ++x) {
+                 imagePlane[y + size_t(ny) * (x - cols.first)] += rowsBuf(x, y - held.first);
+            }
+       }
+       for (casa::uInt round = 0; round < nRounds(nSlabs()); ++round) {
+            const casa::uInt other = partner(slab(), nSlabs(), round);
+            if (other == nSlabs()) {
+                continue;
+            }
+            const std::pair<int,int> otherHeld = heldRows(ny, other);
+            const std::pair<int,int> otherCols = range(nx, nSlabs(), other);
+            sendBuf.resize(size_t(held.second - held.first) * size_t(otherCols.second - otherCols.first));
+            recvBuf.resize(size_t(otherHeld.second - otherHeld.first) * size_t(nCols));
+            std::vector<casa::DComplex>::iterator sendIt = sendBuf.begin();
+            for (int y = held.first; y < held.second; ++y) {
+                 for (int x = otherCols.first; x < otherCols.second; ++x, ++sendIt) {
+                      *sendIt = rowsBuf(x, y - held.first);
+                 }
+            }
+            itsComms->exchange(other, sendBuf.empty() ? 0 : &sendBuf[0], sendBuf.size() * sizeof(casa::DComplex),
+                               recvBuf.empty() ? 0 : &recvBuf[0], recvBuf.size() * sizeof(casa::DComplex));
+            std::vector<casa::DComplex>::const_iterator recvIt = recvBuf.begin();
+            for (int y = otherHeld.first; y < otherHeld.second; ++y) {
+                 for (int x = cols.first; x < cols.second; ++x, ++recvIt) {
+                      imagePlane[y + size_t(ny) * (x - cols.first)] += *recvIt;
+                 }
+            }
+       }
+
+       // second pass along the original second axis
+       casa::Array<casa::DComplex> columnsBuf(casa::IPosition(2, ny, nCols), imagePlane, casa::SHARE);
+       scimath::fft1d(columnsBuf, false);
+  }
+  grid.freeStorage(gridData, deleteIt);
+}
+
+/// @brief transform the distributed image into grid
+/// @param[in] shape shape of the full grid
+/// @param[in] image local image slab (the shape is given by imageShape)
+/// @param[out] grid local grid including the halo (resized to localShape)
+void GridSlabFFT::toGrid(const casa::IPosition &shape, const casa::Array<casa::DComplex> &image,
+                         casa::Array<casa::Complex> &grid) const
+{
+  ASKAPTRACE("GridSlabFFT::toGrid");
+  const casa::IPosition slabShape = imageShape(shape);
+  ASKAPCHECK(image.shape() == slabShape, "Local image slab is expected to have the shape of "<<slabShape<<
+             ", you have "<<image.shape());
+  const int nx = shape(0);
+  const int ny = shape(1);
+  const size_t nPlanes = size_t(shape.product()) / (size_t(nx) * size_t(ny));
+  const int first = firstLocalRow(shape);
+  const std::pair<int,int> held = heldRows(ny, slab());
+  const std::pair<int,int> cols = columns(shape);
+  const int nCols = cols.second - cols.first;
+
+  grid.resize(localShape(shape));
+  grid.set(casa::Complex(0.));
+  casa::Complex *gridData = grid.data();
+
+  casa::Matrix<casa::DComplex> columnsBuf(ny, nCols);
+  casa::Matrix<casa::DComplex> rowsBuf(nx, held.second - held.first);
+  std::vector<casa::DComplex> sendBuf, recvBuf;
+
+  casa::Bool deleteIt;
+  const casa::DComplex *imageData = image.getStorage(deleteIt);
+  for (size_t plane = 0; plane < nPlanes; ++plane) {
+       const casa::DComplex *imagePlane = imageData + plane * size_t(ny) * size_t(nCols);
+       std::copy(imagePlane, imagePlane + size_t(ny) * size_t(nCols), columnsBuf.data());
+       scimath::fft1d(columnsBuf, true);
+
+       // transpose into the rows held by this process, halo rows are filled from the neighbours
+       for (int y = held.first; y < held.second; ++y) {
+            for (int x = cols.first; x < cols.second; ++x) {
+                 rowsBuf(x, y - held.first) = columnsBuf(y, x - cols.first);
+            }
+       }
+       for (casa::uInt round = 0; round < nRounds(nSlabs()); ++round) {
+            const casa::uInt other = partner(slab(), nSlabs(), round);
+            if (other == nSlabs()) {
+                continue;
+            }
+            const std::pair<int,int> otherHeld = heldRows(ny, other);
+            const std::pair<int,int> otherCols = range(nx, nSlabs(), other);
+            sendBuf.resize(size_t(otherHeld.second - otherHeld.first) * size_t(nCols));
+            recvBuf.resize(size_t(held.second - held.first) * size_t(otherCols.second - otherCols.first));
+            std::vector<casa::DComplex>::iterator sendIt = sendBuf.begin();
+            for (int y = otherHeld.first; y < otherHeld.second; ++y) {
+                 for (int x = cols.first; x < cols.second; ++x, ++sendIt) {
+                      *sendIt = columnsBuf(y, x - cols.first);
+                 }
+            }
+            itsComms->exchange(other, sendBuf.empty() ? 0 : &sendBuf[0], sendBuf.size() * sizeof(casa::DComplex),
+                               recvBuf.empty() ? 0 : &recvBuf[0], recvBuf.size() * sizeof(casa::DComplex));
+            std::vector<casa::DComplex>::const_iterator recvIt = recvBuf.begin();
+            for (int y = held.first; y < held.second; ++y) {
+                 for (int x = otherCols.first; x < otherCols.second; ++x, ++recvIt) {
+                      rowsBuf(x, y - held.first) = *recvIt;
+                 }
+            }
+       }
+
+       // second pass along the first axis
+       scimath::fft1d(rowsBuf, true);
+       casa::Complex *gridPlane = gridData + plane * size_t(nx) * size_t(grid.shape()(1));
+       for (int y = held.first; y < held.second; ++y) {
+            casa::Complex *dst = gridPlane + size_t(y - first) * size_t(nx);
+            for (int x = 0; x < nx; ++x) {
+                 const casa::DComplex &val = rowsBuf(x, y - held.first);
+                 dst[x] = casa::Complex(float(val.real()), float(val.imag()));
+            }
+       }
+  }
+  image.freeStorage(imageData, deleteIt);
+}
+
+} // namespace synthesis
+
+} // namespace askap
+
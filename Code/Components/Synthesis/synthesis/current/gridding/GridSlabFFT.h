@@ -0,0 +1,182 @@
+/// @file
+///
+/// @brief Slab decomposition of a uv-grid and its distributed FFT
+/// @details A very large grid may not fit into the memory of a single process.
+/// This class splits the grid into slabs of rows (v-axis), so each process only
+/// holds its own rows (plus a halo for the support of the gridding kernel), and
+/// implements the FFT of such a distributed grid. The transform is done in two
+/// passes: along u for the local rows, then, after an all-to-all transpose, along
+/// v for a slab of columns. Therefore, each process ends up with a slab of image
+/// columns and the full grid is never held in one place.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+
+#ifndef GRID_SLAB_FFT_H
+#define GRID_SLAB_FFT_H
+
+// own includes
+#include <gridding/IGridSlabComms.h>
+
+// casa includes
+#include <casa/aips.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+#include <casa/BasicSL/Complex.h>
+
+// boost includes
+#include <boost/shared_ptr.hpp>
+
+// std includes
+#include <utility>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief Slab decomposition of a uv-grid and its distributed FFT
+/// @details Rows (the second axis) of the grid are split as evenly as possible
+/// between nSlabs processes. Each process holds its rows and the given number of
+/// halo rows on either side, so the gridding kernel of every sample with the centre
+/// in the owned rows fits into the local grid. Contributions gridded into the halo are
+/// added to the owner's rows during the transform. For the inverse operation (used
+/// for degridding), the halo is filled with the neighbours' values.
+///
+/// The image is returned split into slabs of columns (the first axis) in the
+/// transposed order, i.e. the first axis of the local image slab is the second axis
+/// of the image. Therefore, both passes transform contiguous vectors. Any other axes
+/// (polarisation, channel) are transformed plane by plane. The direction and
+/// normalisation of the transform is the same as for scimath::fft2d.
+///
+/// This class holds no shape-dependent state, so the same object can be shared
+/// by all gridders of the process. All processes are expected to call the transforms
+/// for the same sequence of grids.
+/// @ingroup gridding
+class GridSlabFFT {
+public:
+   /// @brief constructor
+   /// @param[in] comms communication interface
+   /// @param[in] halo number of halo rows on either side of the slab
+   GridSlabFFT(const boost::shared_ptr<IGridSlabComms> &comms, const casa::uInt halo);
+
+   /// @brief number of slabs
+   /// @return number of processes sharing the grid
+   casa::uInt nSlabs() const;
+
+   /// @brief slab held by this process
+   /// @return slab number
+   casa::uInt slab() const;
+
+   /// @brief number of halo rows
+   /// @return number of rows held on either side of the slab
+   inline casa::uInt halo() const { return itsHalo; }
+
+   /// @brief part of an axis assigned to the given slab
+   /// @param[in] length length of the axis
+   /// @param[in] nSlabs number of slabs
+   /// @param[in] slab slab number
+   /// @return a pair with the first element and the element past the last
+   static std::pair<int,int> range(const int length, const casa::uInt nSlabs, const casa::uInt slab);
+
+   /// @brief rows of the grid owned by this process
+   /// @param[in] shape shape of the full grid
+   /// @return a pair with the first row and the row past the last
+   std::pair<int,int> rows(const casa::IPosition &shape) const;
+
+   /// @brief first row of the local grid
+   /// @details The local grid starts with the halo, so this can be negative.
+   /// @param[in] shape shape of the full grid
+   /// @return row of the full grid corresponding to the first row of the local grid
+   int firstLocalRow(const casa::IPosition &shape) const;
+
+   /// @brief shape of the local grid
+   /// @param[in] shape shape of the full grid
+   /// @return shape of the part of the grid held by this process (including the halo)
+   casa::IPosition localShape(const casa::IPosition &shape) const;
+
+   /// @brief columns of the image held by this process
+   /// @param[in] shape shape of the full grid
+   /// @return a pair with the first column and the column past the last
+   std::pair<int,int> columns(const casa::IPosition &shape) const;
+
+   /// @brief columns of the image before padding assigned to the given slab
+   /// @details The padded image is split as the grid, see columns. The image is the
+   /// centred part of it, so the outer slabs may get fewer columns (or none).
+   /// @param[in] nx number of columns of the image before padding
+   /// @param[in] paddedNx number of columns of the padded image (grid)
+   /// @param[in] nSlabs number of slabs
+   /// @param[in] slab slab number
+   /// @return a pair with the first column and the column past the last
+   static std::pair<int,int> imageColumns(const int nx, const int paddedNx, const casa::uInt nSlabs, 
+                                          const casa::uInt slab);
+
+   /// @brief shape of the local image slab
+   /// @param[in] shape shape of the full grid
+   /// @return shape of the transposed slab of columns held by this process
+   casa::IPosition imageShape(const casa::IPosition &shape) const;
+
+   /// @brief transform the distributed grid into image
+   /// @param[in] shape shape of the full grid
+   /// @param[in] grid local grid (the shape is given by localShape)
+   /// @param[out] image local image slab (resized to imageShape)
+   void toImage(const casa::IPosition &shape, const casa::Array<casa::Complex> &grid,
+                casa::Array<casa::DComplex> &image) const;
+
+   /// @brief transform the distributed image into grid
+   /// @param[in] shape shape of the full grid
+   /// @param[in] image local image slab (the shape is given by imageShape)
+   /// @param[out] grid local grid including the halo (resized to localShape)
+   void toGrid(const casa::IPosition &shape, const casa::Array<casa::DComplex> &image,
+               casa::Array<casa::Complex> &grid) const;
+
+   /// @brief sum an array across all slabs
+   /// @details All processes have to call this method with arrays of the same shape.
+   /// It is used for the quantities which are accumulated separately for each slab
+   /// (e.g. the sums of weights).
+   /// @param[in] values array to sum, replaced by the sum on output
+   void sum(casa::Array<double> &values) const;
+
+   /// @brief number of exchange rounds
+   /// @param[in] nSlabs number of slabs
+   /// @return number of rounds required for every pair of slabs to exchange data
+   static casa::uInt nRounds(const casa::uInt nSlabs);
+
+   /// @brief partner for the given round
+   /// @details Slabs are paired up with a round-robin schedule, so each slab
+   /// talks to exactly one other slab in every round.
+   /// @param[in] slab slab number
+   /// @param[in] nSlabs number of slabs
+   /// @param[in] round round number (0..nRounds-1)
+   /// @return slab number of the partner or nSlabs if this slab is idle in the given round
+   static casa::uInt partner(const casa::uInt slab, const casa::uInt nSlabs, const casa::uInt round);
+
+protected:
+   /// @brief rows of the full grid held by the given slab
+   /// @details These are the owned rows plus the halo, clipped to the grid.
+   /// @param[in] ny number of rows in the full grid
+   /// @param[in] slab slab number
+   /// @return a pair with the first row and the row past the last
+   std::pair<int,int> heldRows(const int ny, const casa::uInt slab) const;
+
+   /// @brief check the shape of the full grid
+   /// @param[in] shape shape to test
+   void checkShape(const casa::IPosition &shape) const;
+
+private:
+   /// @brief communication interface
+   boost::shared_ptr<IGridSlabComms> itsComms;
+
+   /// @brief number of halo rows
+   casa::uInt itsHalo;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
+#endif // #ifndef GRID_SLAB_FFT_H
+
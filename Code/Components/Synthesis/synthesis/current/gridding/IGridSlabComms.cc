@@ -0,0 +1,47 @@
+/// @file
+/// 
+/// @brief Interface to exchange parts of a grid distributed between processes
+/// @details A large uv-grid can be split into slabs of rows held by different
+/// processes. Gridders only need a very limited set of operations to work with
+/// such a grid (e.g. to do the distributed FFT), so they talk to other processes
+/// via this interface rather than directly. This keeps gridders independent of the
+/// actual communication layer.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <gridding/IGridSlabComms.h>
+
+namespace askap {
+
+namespace synthesis {
+
+
+/// @brief virtual destructor (does nothing in this class)
+IGridSlabComms::~IGridSlabComms() {}
+
+
+} // namespace synthesis
+
+} // namespace askap
+
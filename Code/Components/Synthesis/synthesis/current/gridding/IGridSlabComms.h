@@ -0,0 +1,80 @@
+/// @file
+/// 
+/// @brief Interface to exchange parts of a grid distributed between processes
+/// @details A large uv-grid can be split into slabs of rows held by different
+/// processes. Gridders only need a very limited set of operations to work with
+/// such a grid (e.g. to do the distributed FFT), so they talk to other processes
+/// via this interface rather than directly. This keeps gridders independent of the
+/// actual communication layer.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef I_GRID_SLAB_COMMS_H
+#define I_GRID_SLAB_COMMS_H
+
+// casa includes
+#include <casa/aips.h>
+
+// std includes
+#include <cstddef>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief Interface to exchange parts of a grid distributed between processes
+/// @details Each participating process holds one slab of the grid. Slabs are
+/// numbered from 0 to nSlabs()-1. All processes are expected to call exchange for
+/// the same sequence of partners (in a consistent order), as in a collective operation.
+/// @ingroup gridding
+struct IGridSlabComms {
+
+  /// @brief virtual destructor (does nothing in this class)
+  virtual ~IGridSlabComms();
+  
+  /// @brief number of slabs the grid is split into
+  /// @return number of participating processes
+  virtual casa::uInt nSlabs() const = 0;
+  
+  /// @brief slab held by this process
+  /// @return slab number (0..nSlabs()-1)
+  virtual casa::uInt slab() const = 0;
+  
+  /// @brief exchange raw buffers with another process
+  /// @details Both processes are expected to call this method with each other as a partner.
+  /// @param[in] partner slab number of the other process (not equal to slab())
+  /// @param[in] sendBuf buffer to send
+  /// @param[in] sendSize number of bytes to send
+  /// @param[in] recvBuf buffer to receive into
+  /// @param[in] recvSize number of bytes to receive
+  virtual void exchange(casa::uInt partner, const void *sendBuf, size_t sendSize, 
+                        void *recvBuf, size_t recvSize) const = 0;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
+#endif // #ifndef I_GRID_SLAB_COMMS_H
+
@@ -81,7 +81,8 @@ SnapShotImagingGridderAdapter::SnapShotImagingGridderAdapter(const boost::shared
      itsFirstAccessor(true), itsBuffersFinalised(false), itsNumOfImageRegrids(0), itsTimeImageRegrid(0.),
      itsNumOfInitialisations(0), itsLastFitTimeStamp(0.), itsShortestIntervalBetweenFits(3e7),
      itsLongestIntervalBetweenFits(-1.), itsModelIsEmpty(false), itsClippingFactor(0.), itsNoPSFReprojection(true),
-     itsDecimationFactor(decimate), itsInterpolationMethod(method)
+     itsDecimationFactor(decimate), itsInterpolationMethod(method), itsFastRegridding(true),
+     itsToTargetRegridder(decimate, method), itsFromTargetRegridder(decimate, method)
 {
   ASKAPCHECK(gridder, "SnapShotImagingGridderAdapter should only be initialised with a valid gridder");
   itsGridder = gridder->clone();
@@ -102,7 +103,9 @@ SnapShotImagingGridderAdapter::SnapShotImagingGridderAdapter(const SnapShotImagi
     itsLongestIntervalBetweenFits(other.itsLongestIntervalBetweenFits), 
     itsTempInImg(), itsTempOutImg(), itsModelIsEmpty(other.itsModelIsEmpty), itsClippingFactor(other.itsClippingFactor),
     itsNoPSFReprojection(other.itsNoPSFReprojection), itsDecimationFactor(other.itsDecimationFactor),
-    itsInterpolationMethod(other.itsInterpolationMethod)
+    itsInterpolationMethod(other.itsInterpolationMethod), itsFastRegridding(other.itsFastRegridding),
+    itsToTargetRegridder(other.itsDecimationFactor, other.itsInterpolationMethod),
+    itsFromTargetRegridder(other.itsDecimationFactor, other.itsInterpolationMethod)
 {
   ASKAPCHECK(other.itsGridder, 
        "copy constructor of SnapShotImagingGridderAdapter got an object somehow set up with an empty gridder");
@@ -125,6 +128,10 @@ SnapShotImagingGridderAdapter::~SnapShotImagingGridderAdapter()
       ASKAPLOG_INFO_STR(logger, "   or "<<double(itsNumOfImageRegrids)/double(itsNumOfInitialisations)<<
                         " times per grid/degrid pass");      
       ASKAPLOG_INFO_STR(logger, "   Image clipping factor (clipping during regrids) is "<< itsClippingFactor);
+      if (itsFastRegridding) {
+          ASKAPLOG_INFO_STR(logger, "   Pixel mapping has been computed "<<
+              itsToTargetRegridder.numOfMappings() + itsFromTargetRegridder.numOfMappings()<<" times");
+      }
       if (itsNumOfImageRegrids > 0) {
           ASKAPLOG_INFO_STR(logger, "   Average time spent per image plane regridding is "<<
                       itsTimeImageRegrid/double(itsNumOfImageRegrids)<<" (s)");
@@ -502,6 +509,25 @@ void SnapShotImagingGridderAdapter::imageRegrid(const casa::Array<double> &input
    
    // iterator over planes
    scimath::MultiDimArrayPlaneIter planeIter(input.shape());
+
+   if (itsFastRegridding) {
+       // the mapping is only recomputed if the fitted plane has changed since the last call
+       SnapShotRegridder &regridder = toTarget ? itsToTargetRegridder : itsFromTargetRegridder;
+       if (toTarget) {
+           regridder.setup(dcCurrent, dcTarget, planeIter.planeShape().nonDegenerate());
+       } else {
+           regridder.setup(dcTarget, dcCurrent, planeIter.planeShape().nonDegenerate());
+       }
+       for (; planeIter.hasMore(); planeIter.next()) {
+            // the next line does not do any copying (reference semantics)
+            casa::Array<double> outRef(planeIter.getPlane(output).nonDegenerate());
+            regridder.regrid(planeIter.getPlane(inRef).nonDegenerate(), outRef, toTarget);
+            // optional clipping
+            imageClip(outRef);
+       }
+       itsTimeImageRegrid += timer.real();
+       return;
+   }
    
    // regridder
    casa::ImageRegrid<double> regridder;
@@ -613,6 +639,19 @@ void SnapShotImagingGridderAdapter::setPSFReprojection(const bool doIt)
   }
 }
 
+/// @brief control which regridder is used
+/// @details By default the image plane regridding is done by SnapShotRegridder, which
+/// computes the pixel mapping once per change of the fitted plane. The general casa
+/// ImageRegrid can be selected with this configuration method instead.
+/// @param[in] doIt if true (the default), SnapShotRegridder is used, otherwise casa's ImageRegrid
+void SnapShotImagingGridderAdapter::setFastRegridding(const bool doIt)
+{
+  itsFastRegridding = doIt;
+  if (!doIt) {
+      ASKAPLOG_INFO_STR(logger, "Image plane regridding will be done with casa's ImageRegrid");
+  }
+}
+
 /// @brief check whether the model is empty
 /// @details A simple check allows us to bypass heavy calculations if the input model
 /// is empty (all pixels are zero). This makes sense for degridding only.
@@ -42,6 +42,7 @@
 #define SNAP_SHOT_IMAGING_GRIDDER_ADAPTER_H
 
 #include <gridding/IVisGridder.h>
+#include <gridding/SnapShotRegridder.h>
 #include <boost/shared_ptr.hpp>
 #include <dataaccess/BestWPlaneDataAccessor.h>
 #include <fitting/Axes.h>
@@ -156,6 +157,13 @@ public:
    /// @param[in] doIt if true, image reprojection will be done for PSF the same way dirty image and weight are processed,
    ///                 otherwise (the default), the wrapped gridder is used directly without any reprojection
    void setPSFReprojection(const bool doIt);
+
+   /// @brief control which regridder is used
+   /// @details By default the image plane regridding is done by SnapShotRegridder, which
+   /// computes the pixel mapping once per change of the fitted plane. The general casa
+   /// ImageRegrid can be selected with this configuration method instead.
+   /// @param[in] doIt if true (the default), SnapShotRegridder is used, otherwise casa's ImageRegrid
+   void setFastRegridding(const bool doIt);
    
    /// @brief check whether the model is empty
    /// @details A simple check allows us to bypass heavy calculations if the input model
@@ -359,6 +367,17 @@ private:
    // Interpolation method used for regridding
    casa::Interpolate2D::Method itsInterpolationMethod;
 
+   /// @brief if true, SnapShotRegridder is used instead of casa's ImageRegrid
+   bool itsFastRegridding;
+
+   /// @brief regridder from the frame of the fitted plane into the target frame
+   /// @details The pixel mapping is cached, so it is computed once for image and
+   /// weights and all planes of the cube
+   mutable SnapShotRegridder itsToTargetRegridder;
+
+   /// @brief regridder from the target frame into the frame of the fitted plane
+   mutable SnapShotRegridder itsFromTargetRegridder;
+
    #ifdef _OPENMP
    /// @brief mutex to deal with lack of thread safety in casa's regrid
    static boost::mutex theirMutex;
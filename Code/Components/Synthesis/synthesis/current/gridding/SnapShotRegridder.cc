@@ -0,0 +1,366 @@
+/// @file
+///
+/// @brief Image plane regridding between two direction coordinates
+/// @details SnapShotImagingGridderAdapter regrids images every time the best
+/// fit w-plane changes. Both frames differ only by the projection parameters,
+/// so the pixel mapping is smooth and the same for all planes of the cube.
+/// This class computes the mapping once and applies it to raw buffers, avoiding
+/// the overheads of the general casa ImageRegrid.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <gridding/SnapShotRegridder.h>
+#include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
+
+#include <casa/Arrays/Vector.h>
+#include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <casa/BasicSL/Constants.h>
+#include <coordinates/Coordinates/Projection.h>
+
+#include <boost/bind.hpp>
+
+#include <cmath>
+#include <limits>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief constructor
+/// @param[in] decimate spacing of the nodes where the mapping is computed exactly
+/// (0 or 1 means every pixel)
+/// @param[in] method interpolation method
+SnapShotRegridder::SnapShotRegridder(const casa::uInt decimate, const casa::Interpolate2D::Method method) :
+     itsStep(decimate > 1 ? decimate : 1), itsMethod(method), itsNTaps(1), itsValid(false),
+     itsNx(0), itsNy(0), itsNNodesX(0), itsNumOfMappings(0)
+{
+  switch (method) {
+     case casa::Interpolate2D::NEAREST:
+          itsNTaps = 1;
+          break;
+     case casa::Interpolate2D::LINEAR:
+          itsNTaps = 2;
+          break;
+     case casa::Interpolate2D::CUBIC:
+          itsNTaps = 4;
+          break;
+     case casa::Interpolate2D::LANCZOS:
+          itsNTaps = 6;
+          break;
+     default:
+          ASKAPTHROW(AskapError, "Interpolation method "<<int(method)<<" is not supported by SnapShotRegridder");
+  }
+}
+
+/// @brief check whether two direction coordinates are the same
+/// @param[in] dc1 first coordinate
+/// @param[in] dc2 second coordinate
+/// @return true if the coordinates give the same pixel to world mapping
+bool SnapShotRegridder::sameCoordinate(const casa::DirectionCoordinate &dc1, const casa::DirectionCoordinate &dc2)
+{
+  if ((dc1.directionType() != dc2.directionType()) || (dc1.projection().type() != dc2.projection().type())) {
+      return false;
+  }
+  const casa::Vector<casa::Double> par1 = dc1.projection().parameters();
+  const casa::Vector<casa::Double> par2 = dc2.projection().parameters();
+  if ((par1.nelements() != par2.nelements()) || !casa::allEQ(par1, par2)) {
+      return false;
+  }
+  const casa::Matrix<casa::Double> xform1 = dc1.linearTransform();
+  const casa::Matrix<casa::Double> xform2 = dc2.linearTransform();
+  if (!xform1.shape().isEqual(xform2.shape()) || !casa::allEQ(xform1, xform2)) {
+      return false;
+  }
+  return casa::allEQ(dc1.referenceValue(), dc2.referenceValue()) &&
+         casa::allEQ(dc1.referencePixel(), dc2.referencePixel()) &&
+         casa::allEQ(dc1.increment(), dc2.increment()) &&
+         casa::allEQ(dc1.worldAxisUnits(), dc2.worldAxisUnits());
+}
+
+/// @brief compute node positions along one axis
+/// @param[in] n number of pixels
+/// @param[out] nodes pixel index of each node
+/// @param[out] cell node cell of each pixel
+/// @param[out] frac position of each pixel within its cell
+void SnapShotRegridder::setupAxis(const casa::uInt n, std::vector<casa::uInt> &nodes,
+                  std::vector<casa::uInt> &cell, std::vector<double> &frac) const
+{
+  ASKAPDEBUGASSERT(n > 1);
+  nodes.clear();
+  for (casa::uInt pix = 0; pix + 1 < n; pix += itsStep) {
+       nodes.push_back(pix);
+  }
+  // the last pixel is always a node, so no extrapolation is required
+  nodes.push_back(n - 1);
+  ASKAPDEBUGASSERT(nodes.size() > 1);
+  cell.resize(n);
+  frac.resize(n);
+  for (casa::uInt pix = 0; pix < n; ++pix) {
+       casa::uInt c = pix / itsStep;
+       if (c + 1 >= nodes.size()) {
+           c = nodes.size() - 2;
+       }
+       cell[pix] = c;
+       frac[pix] = double(pix - nodes[c]) / double(nodes[c + 1] - nodes[c]);
+  }
+}
+
+/// @brief set up the mapping
+/// @details Nothing is done if the mapping is already set up for the same
+/// coordinates and shape.
+/// @param[in] input coordinate of the input image
+/// @param[in] output coordinate of the output image
+/// @param[in] shape shape of the 2D plane (the same for input and output)
+void SnapShotRegridder::setup(const casa::DirectionCoordinate &input, const casa::DirectionCoordinate &output,
+              const casa::IPosition &shape)
+{
+  ASKAPCHECK(shape.nelements() == 2, "SnapShotRegridder expects a 2D shape, you have "<<shape);
+  ASKAPCHECK((shape(0) > 1) && (shape(1) > 1), "Each axis should have at least 2 pixels for regridding, you have "<<shape);
+  const casa::uInt nx = shape(0);
+  const casa::uInt ny = shape(1);
+  if (itsValid && (nx == itsNx) && (ny == itsNy) && sameCoordinate(input, itsInput) &&
+      sameCoordinate(output, itsOutput)) {
+      return;
+  }
+  ASKAPCHECK(input.directionType() == output.directionType(),
+             "Input and output coordinates should have the same direction frame for regridding");
+  itsValid = false;
+  itsInput = input;
+  itsOutput = output;
+  itsNx = nx;
+  itsNy = ny;
+  ++itsNumOfMappings;
+
+  // work with radians on both sides
+  casa::DirectionCoordinate dcIn(input);
+  casa::DirectionCoordinate dcOut(output);
+  const casa::Vector<casa::String> units(2, "rad");
+  ASKAPCHECK(dcIn.setWorldAxisUnits(units) && dcOut.setWorldAxisUnits(units),
+             "Unable to set world axis units for regridding");
+
+  std::vector<casa::uInt> nodesX;
+  std::vector<casa::uInt> nodesY;
+  setupAxis(nx, nodesX, itsCellX, itsFracX);
+  setupAxis(ny, nodesY, itsCellY, itsFracY);
+  itsNNodesX = nodesX.size();
+  itsMapX.resize(nodesX.size() * nodesY.size());
+  itsMapY.resize(itsMapX.size());
+
+  // convert one row of nodes at a time to keep the scratch buffers small
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  casa::Matrix<casa::Double> pixel(2, nodesX.size());
+  casa::Matrix<casa::Double> world;
+  casa::Matrix<casa::Double> inPixel;
+  casa::Vector<casa::Bool> worldFailures;
+  casa::Vector<casa::Bool> pixelFailures;
+  for (casa::uInt i = 0; i < nodesX.size(); ++i) {
+       pixel(0, i) = nodesX[i];
+  }
+  for (size_t j = 0; j < nodesY.size(); ++j) {
+       pixel.row(1) = double(nodesY[j]);
+       dcOut.toWorldMany(world, pixel, worldFailures);
+       dcIn.toPixelMany(inPixel, world, pixelFailures);
+       for (casa::uInt i = 0; i < nodesX.size(); ++i) {
+            const size_t index = j * nodesX.size() + i;
+            if (worldFailures[i] || pixelFailures[i]) {
+                itsMapX[index] = nan;
+                itsMapY[index] = nan;
+            } else {
+                itsMapX[index] = inPixel(0, i);
+                itsMapY[index] = inPixel(1, i);
+            }
+       }
+  }
+  itsValid = true;
+}
+
+/// @brief interpolation weights along one axis
+/// @param[in] pos input pixel position
+/// @param[out] weights weights of itsNTaps pixels
+/// @return index of the first pixel
+int SnapShotRegridder::kernel(const double pos, double *weights) const
+{
+  const double base = floor(pos);
+  const double t = pos - base;
+  const int index = static_cast<int>(base);
+  switch (itsMethod) {
+     case casa::Interpolate2D::NEAREST:
+          weights[0] = 1.;
+          return t < 0.5 ? index : index + 1;
+     case casa::Interpolate2D::LINEAR:
+          weights[0] = 1. - t;
+          weights[1] = t;
+          return index;
+     case casa::Interpolate2D::CUBIC:
+          // cubic convolution kernel of Keys (1981) with a = -0.5
+          weights[0] = ((-0.5 * t + 1.) * t - 0.5) * t;
+          weights[1] = (1.5 * t - 2.5) * t * t + 1.;
+          weights[2] = ((-1.5 * t + 2.) * t + 0.5) * t;
+          weights[3] = (0.5 * t - 0.5) * t * t;
+          return index - 1;
+     default:
+          break;
+  }
+  ASKAPDEBUGASSERT(itsMethod == casa::Interpolate2D::LANCZOS);
+  if (t == 0.) {
+      for (int k = 0; k < 6; ++k) {
+           weights[k] = (k == 2) ? 1. : 0.;
+      }
+      return index - 2;
+  }
+  // 3-lobe Lanczos kernel for the distances t - m, m = -2..3. The sines of the
+  // shifted arguments follow from sin(pi t) and sin(pi t / 3) by angle addition.
+  static const double cosM[6] = {-0.5, 0.5, 1., 0.5, -0.5, -1.};
+  static const double sinM[6] = {-0.8660254037844386, -0.8660254037844386, 0.,
+                                  0.8660254037844386, 0.8660254037844386, 0.};
+  const double sin1 = sin(casa::C::pi * t);
+  const double sin3 = sin(casa::C::pi * t / 3.);
+  const double cos3 = cos(casa::C::pi * t / 3.);
+  double sum = 0.;
+  for (int k = 0; k < 6; ++k) {
+       const double d = t - double(k - 2);
+       const double sinPiD = (k % 2 == 0) ? sin1 : -sin1;
+       const double sinPiD3 = sin3 * cosM[k] - cos3 * sinM[k];
+       weights[k] = 3. * sinPiD * sinPiD3 / (casa::C::pi * casa::C::pi * d * d);
+       sum += weights[k];
+  }
+  // normalise, so a constant image stays constant
+  for (int k = 0; k < 6; ++k) {
+       weights[k] /= sum;
+  }
+  return index - 2;
+}
+
+/// @brief regrid a range of output rows
+/// @param[in] in input plane
+/// @param[in] out output plane
+/// @param[in] add if true, the result is added to the output
+/// @param[in] begin first row
+/// @param[in] end row past the last one
+void SnapShotRegridder::regridRows(const double *in, double *out, const bool add, size_t begin, size_t end) const
+{
+  std::vector<double> wx(itsNTaps);
+  std::vector<double> wy(itsNTaps);
+  const int nx = static_cast<int>(itsNx);
+  const int ny = static_cast<int>(itsNy);
+  for (size_t y = begin; y < end; ++y) {
+       const size_t nodeRow = itsCellY[y] * itsNNodesX;
+       const double fy = itsFracY[y];
+       const double *mapX0 = &itsMapX[nodeRow];
+       const double *mapX1 = mapX0 + itsNNodesX;
+       const double *mapY0 = &itsMapY[nodeRow];
+       const double *mapY1 = mapY0 + itsNNodesX;
+       double *outRow = out + y * itsNx;
+       for (casa::uInt x = 0; x < itsNx; ++x) {
+            const casa::uInt cx = itsCellX[x];
+            const double fx = itsFracX[x];
+            // the mapping is affine within the node cell
+            double px = (1. - fy) * ((1. - fx) * mapX0[cx] + fx * mapX0[cx + 1]) +
+                              fy * ((1. - fx) * mapX1[cx] + fx * mapX1[cx + 1]);
+            double py = (1. - fy) * ((1. - fx) * mapY0[cx] + fx * mapY0[cx + 1]) +
+                              fy * ((1. - fx) * mapY1[cx] + fx * mapY1[cx + 1]);
+            // written to be false for NaN (failed conversion)
+            if (!((px > -1.) && (px < double(nx)) && (py > -1.) && (py < double(ny)))) {
+                if (!add) {
+                    outRow[x] = 0.;
+                }
+                continue;
+            }
+            // positions within the rounding error of the coordinate conversion from
+            // an input pixel are taken as exact, so an unchanged frame is a plain copy
+            const double pxRound = floor(px + 0.5);
+            const double pyRound = floor(py + 0.5);
+            if (fabs(px - pxRound) < 1e-6) {
+                px = pxRound;
+            }
+            if (fabs(py - pyRound) < 1e-6) {
+                py = pyRound;
+            }
+            double value = 0.;
+            const double pxBase = floor(px);
+            const double pyBase = floor(py);
+            if ((px == pxBase) && (py == pyBase)) {
+                // exactly on an input pixel, all kernels reduce to the pixel value
+                if ((px < 0.) || (py < 0.)) {
+                    if (!add) {
+                        outRow[x] = 0.;
+                    }
+                    continue;
+                }
+                value = in[static_cast<size_t>(pyBase) * itsNx + static_cast<size_t>(pxBase)];
+            } else {
+                const int x0 = kernel(px, &wx[0]);
+                const int y0 = kernel(py, &wy[0]);
+                if ((x0 < 0) || (y0 < 0) || (x0 + itsNTaps > nx) || (y0 + itsNTaps > ny)) {
+                    if (!add) {
+                        outRow[x] = 0.;
+                    }
+                    continue;
+                }
+                const double *inPtr = in + size_t(y0) * itsNx + size_t(x0);
+                for (int j = 0; j < itsNTaps; ++j, inPtr += itsNx) {
+                     double rowSum = 0.;
+                     for (int i = 0; i < itsNTaps; ++i) {
+                          rowSum += wx[i] * inPtr[i];
+                     }
+                     value += wy[j] * rowSum;
+                }
+            }
+            if (add) {
+                outRow[x] += value;
+            } else {
+                outRow[x] = value;
+            }
+       }
+  }
+}
+
+/// @brief regrid one plane
+/// @param[in] input 2D input plane
+/// @param[in] output 2D output plane
+/// @param[in] add if true, the result is added to the output, otherwise it replaces it
+void SnapShotRegridder::regrid(const casa::Array<double> &input, casa::Array<double> &output, const bool add) const
+{
+  ASKAPCHECK(itsValid, "SnapShotRegridder::regrid is called before the mapping is set up");
+  ASKAPCHECK((input.nelements() == size_t(itsNx) * itsNy) && (input.shape()(0) == int(itsNx)),
+             "Input plane shape "<<input.shape()<<" doesn't match the mapping set up for "<<itsNx<<" x "<<itsNy);
+  ASKAPCHECK(input.shape().isEqual(output.shape()),
+             "The shape of input and output planes should be identical, input.shape()="<<
+              input.shape()<<", output.shape()="<<output.shape());
+
+  casa::Bool deleteIn;
+  casa::Bool deleteOut;
+  const double *in = input.getStorage(deleteIn);
+  double *out = output.getStorage(deleteOut);
+  TaskScheduler::instance().parallelFor(0, itsNy, boost::bind(&SnapShotRegridder::regridRows, this,
+                   in, out, add, _1, _2), "snapshotregrid");
+  input.freeStorage(in, deleteIn);
+  output.putStorage(out, deleteOut);
+}
+
+} // namespace synthesis
+
+} // namespace askap
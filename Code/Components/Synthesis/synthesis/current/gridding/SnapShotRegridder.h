@@ -0,0 +1,163 @@
+/// @file
+///
+/// @brief Image plane regridding between two direction coordinates
+/// @details SnapShotImagingGridderAdapter regrids images every time the best
+/// fit w-plane changes. Both frames differ only by the projection parameters,
+/// so the pixel mapping is smooth and the same for all planes of the cube.
+/// This class computes the mapping once and applies it to raw buffers, avoiding
+/// the overheads of the general casa ImageRegrid.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef SNAP_SHOT_REGRIDDER_H
+#define SNAP_SHOT_REGRIDDER_H
+
+#include <casa/aips.h>
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/IPosition.h>
+#include <coordinates/Coordinates/DirectionCoordinate.h>
+#include <scimath/Mathematics/Interpolate2D.h>
+
+#include <vector>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief Image plane regridding between two direction coordinates
+/// @details The input pixel position is computed exactly (via the coordinates)
+/// on a grid of nodes spaced by the decimation factor and interpolated bilinearly
+/// in between, i.e. the mapping is affine within each cell of the node grid.
+/// This is the same decimation scheme as used by casa's ImageRegrid. The mapping
+/// is only recomputed if the coordinates or the shape change, so it is shared by
+/// all planes of the cube and by the image and weights.
+///
+/// The interpolation kernel is separable: nearest neighbour, bilinear, cubic
+/// convolution (Keys, a = -0.5) or 3-lobe Lanczos, selected with the casa
+/// interpolation method. Output pixels for which the kernel doesn't fit into the
+/// input image are set to zero (or left unchanged, if the result is added).
+/// Rows of the output are processed concurrently with askap::TaskScheduler tasks.
+/// @ingroup gridding
+class SnapShotRegridder {
+public:
+   /// @brief constructor
+   /// @param[in] decimate spacing of the nodes where the mapping is computed exactly
+   /// (0 or 1 means every pixel)
+   /// @param[in] method interpolation method
+   explicit SnapShotRegridder(const casa::uInt decimate = 0,
+                     const casa::Interpolate2D::Method method = casa::Interpolate2D::CUBIC);
+
+   /// @brief set up the mapping
+   /// @details Nothing is done if the mapping is already set up for the same
+   /// coordinates and shape.
+   /// @param[in] input coordinate of the input image
+   /// @param[in] output coordinate of the output image
+   /// @param[in] shape shape of the 2D plane (the same for input and output)
+   void setup(const casa::DirectionCoordinate &input, const casa::DirectionCoordinate &output,
+              const casa::IPosition &shape);
+
+   /// @brief regrid one plane
+   /// @param[in] input 2D input plane
+   /// @param[in] output 2D output plane
+   /// @param[in] add if true, the result is added to the output, otherwise it replaces it
+   void regrid(const casa::Array<double> &input, casa::Array<double> &output, const bool add) const;
+
+   /// @brief number of times the mapping has been computed
+   /// @return number of setups which were not cached
+   inline unsigned long numOfMappings() const { return itsNumOfMappings; }
+
+protected:
+   /// @brief regrid a range of output rows
+   /// @param[in] in input plane
+   /// @param[in] out output plane
+   /// @param[in] add if true, the result is added to the output
+   /// @param[in] begin first row
+   /// @param[in] end row past the last one
+   void regridRows(const double *in, double *out, const bool add, size_t begin, size_t end) const;
+
+   /// @brief interpolation weights along one axis
+   /// @param[in] pos input pixel position
+   /// @param[out] weights weights of itsNTaps pixels
+   /// @return index of the first pixel
+   int kernel(const double pos, double *weights) const;
+
+   /// @brief compute node positions along one axis
+   /// @param[in] n number of pixels
+   /// @param[out] nodes pixel index of each node
+   /// @param[out] cell node cell of each pixel
+   /// @param[out] frac position of each pixel within its cell
+   void setupAxis(const casa::uInt n, std::vector<casa::uInt> &nodes,
+                  std::vector<casa::uInt> &cell, std::vector<double> &frac) const;
+
+   /// @brief check whether two direction coordinates are the same
+   /// @param[in] dc1 first coordinate
+   /// @param[in] dc2 second coordinate
+   /// @return true if the coordinates give the same pixel to world mapping
+   static bool sameCoordinate(const casa::DirectionCoordinate &dc1, const casa::DirectionCoordinate &dc2);
+
+private:
+   /// @brief spacing of nodes in pixels
+   casa::uInt itsStep;
+
+   /// @brief interpolation method
+   casa::Interpolate2D::Method itsMethod;
+
+   /// @brief number of pixels used by the kernel along each axis
+   int itsNTaps;
+
+   /// @brief true, if the mapping has been set up
+   bool itsValid;
+
+   /// @brief coordinates the mapping has been set up for
+   casa::DirectionCoordinate itsInput;
+   casa::DirectionCoordinate itsOutput;
+
+   /// @brief shape of the plane
+   casa::uInt itsNx;
+   casa::uInt itsNy;
+
+   /// @brief node cell and position within the cell for each output column
+   std::vector<casa::uInt> itsCellX;
+   std::vector<double> itsFracX;
+
+   /// @brief node cell and position within the cell for each output row
+   std::vector<casa::uInt> itsCellY;
+   std::vector<double> itsFracY;
+
+   /// @brief number of nodes along x
+   casa::uInt itsNNodesX;
+
+   /// @brief input pixel position at each node, x varying fastest (NaN where the conversion failed)
+   std::vector<double> itsMapX;
+   std::vector<double> itsMapY;
+
+   /// @brief number of times the mapping has been computed
+   unsigned long itsNumOfMappings;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
+#endif // #ifndef SNAP_SHOT_REGRIDDER_H
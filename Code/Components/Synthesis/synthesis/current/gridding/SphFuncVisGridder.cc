@@ -148,17 +148,21 @@ namespace askap
         ccfy(iy) = casa::abs(val) > 1e-10 ? 1.0/val : 0.;                     
       }
 
+      // if the grid is split into slabs, only the columns of the local slab are held
+      const casa::Int xOffset = gridSlabs() && (grid.shape()(0) < itsShape(0)) ? 
+                                gridSlabs()->columns(itsShape).first : 0;
+
       casa::ArrayIterator<double> it(grid, 2);
       while (!it.pastEnd())
       {
         casa::Matrix<double> mat(it.array());
-        ASKAPDEBUGASSERT(int(mat.nrow()) <= itsShape(0));
+        ASKAPDEBUGASSERT(int(mat.nrow()) + xOffset <= itsShape(0));
         ASKAPDEBUGASSERT(int(mat.ncolumn()) <= itsShape(1));        
-        for (int ix=0; ix<itsShape(0); ix++)
+        for (int ix=0; ix<int(mat.nrow()); ix++)
         {
-          for (int iy=0; iy<itsShape(1); iy++)
+          for (int iy=0; iy<int(mat.ncolumn()); iy++)
           {
-            mat(ix, iy)*=ccfx(ix)*ccfy(iy);
+            mat(ix, iy)*=ccfx(ix + xOffset)*ccfy(iy);
           }
         }
         it.next();
@@ -52,6 +52,7 @@ ASKAP_LOGGER(logger, ".gridding.tablevisgridder");
 
 #include <askap/CasaSyncHelper.h>
 #include <profile/AskapProfiler.h>
+#include <profile/Metrics.h>
 
 using namespace askap::scimath;
 using namespace askap;
@@ -142,7 +143,8 @@ TableVisGridder::TableVisGridder(const int overSample, const int support,
      itsMaxPointingSeparation(other.itsMaxPointingSeparation),
      itsRowsRejectedDueToMaxPointingSeparation(other.itsRowsRejectedDueToMaxPointingSeparation),
      itsConvFuncOffsets(other.itsConvFuncOffsets), 
-     itsTrackWeightPerOversamplePlane(other.itsTrackWeightPerOversamplePlane)
+     itsTrackWeightPerOversamplePlane(other.itsTrackWeightPerOversamplePlane),
+     itsGridSlabs(other.itsGridSlabs)
 {
    deepCopyOfSTDVector(other.itsConvFunc,itsConvFunc);
    deepCopyOfSTDVector(other.itsGrid, itsGrid);   
@@ -401,6 +403,15 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
    if (forward && isPSFGridder()) {
        ASKAPTHROW(AskapError, "Logic error: the gridder is not supposed to be used for degridding in the PSF mode")
    }
+
+   static const Metrics::Id gridTimer = Metrics::instance().timer("gridder.grid");
+   static const Metrics::Id degridTimer = Metrics::instance().timer("gridder.degrid");
+   static const Metrics::Id gridSamples = Metrics::instance().counter("gridder.grid.samples");
+   static const Metrics::Id degridSamples = Metrics::instance().counter("gridder.degrid.samples");
+   static const Metrics::Id cfTimer = Metrics::instance().timer("gridder.cf");
+   const ScopedTimer metricsTimer(forward ? degridTimer : gridTimer);
+   const uint nSelected = itsSelectedRows ? uint(itsSelectedRows->size()) : acc.nRow();
+   Metrics::instance().add(forward ? degridSamples : gridSamples, nSelected * acc.nChannel() * acc.nPol());
       
    casa::Timer timer;
 
@@ -414,6 +425,7 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
    }
 	  
    itsTimeConvFunctions += timer.real();
+   Metrics::instance().addTime(cfTimer, timer.real());
    
    // Now time the coordinate conversions, etc.
    // some conversion may have already happened during CF calculation
@@ -426,13 +438,11 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
    // inside the section protected by the lock and make a copy of the returned vector
    const casa::Vector<casa::RigidVector<double, 3> > &outUVW = acc.rotatedUVW(tangentPoint);
 
-   #ifdef _OPENMP
+   // gridders may share the accessor with other threads (openmp or the task scheduler),
+   // so the delays are copied under the lock
    boost::unique_lock<boost::mutex> lock(itsMutex);
    const casa::Vector<double> delay = acc.uvwRotationDelay(tangentPoint, imageCentre).copy();
    lock.unlock();
-   #else
-   const casa::Vector<double> &delay = acc.uvwRotationDelay(tangentPoint, imageCentre);
-   #endif
 
    itsTimeCoordinates += timer.real();
 
@@ -441,6 +451,10 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
 
    ASKAPCHECK(itsSupport>0, "Support must be greater than 0");
    ASKAPCHECK(itsUVCellSize.size()==2, "UV cell sizes not yet set");
+   // itsSupport is the maximum support across all CFs, so this check covers every sample
+   ASKAPCHECK(!itsGridSlabs || (itsSupport <= int(itsGridSlabs->halo())), "Support of "<<itsSupport<<
+              " exceeds the halo of the grid slab ("<<(itsGridSlabs ? itsGridSlabs->halo() : 0u)<<
+              " rows), increase the halo");
    
    const uint nSamples = acc.nRow();
    const uint nChan = acc.nChannel();
@@ -452,17 +466,19 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
    // of the matrices for every accessor. More intelligent caching is possible with a bit
    // more effort (i.e. one has to detect whether polarisation frames change from the
    // previous call). Need to think about parallactic angle dependence.
-   #ifdef _OPENMP
    scimath::PolConverter gridPolConv(syncHelper.copy(acc.stokes()), getStokes());
    scimath::PolConverter degridPolConv(getStokes(),syncHelper.copy(acc.stokes()), false);
-   #else
-   scimath::PolConverter gridPolConv(acc.stokes(), getStokes());
-   scimath::PolConverter degridPolConv(getStokes(),acc.stokes(), false);
-   #endif   
 			      
    ASKAPDEBUGASSERT(itsShape.nelements()>=2);
-   const casa::IPosition onePlane4D(4, itsShape(0), itsShape(1), 1, 1);
+   const casa::IPosition localShape = localGridShape();
+   const casa::IPosition onePlane4D(4, localShape(0), localShape(1), 1, 1);
    const casa::IPosition onePlane(2, itsShape(0), itsShape(1));
+
+   // rows of the grid owned by this gridder, if the grid is split between processes
+   // the samples centred on other rows are processed elsewhere
+   const std::pair<int,int> ownedRows = itsGridSlabs ? itsGridSlabs->rows(itsShape) : 
+                                        std::pair<int,int>(0, itsShape(1));
+   const int firstLocalRow = itsGridSlabs ? itsGridSlabs->firstLocalRow(itsShape) : 0;
    
    // Loop over all samples adding them to the grid
    // First scale to the correct pixel location
@@ -474,7 +490,9 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
    ASKAPDEBUGASSERT(casa::uInt(nChan) <= frequencyList.nelements());
    ASKAPDEBUGASSERT(casa::uInt(nSamples) == acc.uvw().nelements());
    
-   for (uint i=0; i<nSamples; ++i) {
+   for (uint sample=0; sample<nSelected; ++sample) {
+       const uint i = itsSelectedRows ? (*itsSelectedRows)[sample] : sample;
+       ASKAPDEBUGASSERT(i < nSamples);
        if (itsMaxPointingSeparation > 0.) {
            // need to reject samples, if too far from the image centre
            const casa::MVDirection thisPointing  = acc.pointingDir1()(i);
@@ -587,7 +605,11 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
 	         // Lookup the portion of grid to be
 	         // used for this row, polarisation and channel
                  const int gInd=gIndex(i, pol, chan);
-	         ASKAPCHECK(gInd>-1,"Index into image grid is less than zero");
+                 // negative index means that this sample is processed in a different pass
+                 // (e.g. the w-plane it belongs to is not held in memory at the moment)
+                 if (gInd < 0) {
+                     continue;
+                 }
                  ASKAPCHECK(gInd<int(itsGrid.size()), "Index into image grid exceeds number of planes");
 			   			   
                  /// Make a slicer to extract just this plane
@@ -625,6 +647,8 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
                  const std::pair<int,int> cfOffset = getConvFuncOffset(beforeOversamplePlaneIndex);
                  const int iuOffset = iu + cfOffset.first;
                  const int ivOffset = iv + cfOffset.second;
+                 // row of the local grid
+                 const int ivLocal = ivOffset - firstLocalRow;
 
                  
                  
@@ -641,10 +665,11 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
                  /// Need to check if this point lies on the grid (taking into 
                  /// account the support)
 	         if (((iuOffset-support)>0)&&((ivOffset-support)>0)&&
-	             ((iuOffset+support) <itsShape(0))&&((ivOffset+support)<itsShape(1))) {
+	             ((iuOffset+support) <itsShape(0))&&((ivOffset+support)<itsShape(1)) &&
+                     (ivOffset >= ownedRows.first) && (ivOffset < ownedRows.second)) {
                      if (forward) {
                          casa::Complex cVis(0.,0.);
-                         GridKernel::degrid(cVis, convFunc, grid, iuOffset, ivOffset, support);
+                         GridKernel::degrid(cVis, convFunc, grid, iuOffset, ivLocal, support);
                          itsSamplesDegridded+=1.0;
                          itsNumberDegridded+=double((2*support+1)*(2*support+1));
                          if (itsVisWeight) {
@@ -678,7 +703,7 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
                                  rVis *= itsVisWeight->getWeight(i,frequencyList[chan],pol);
                              }
 				   
-                             GridKernel::grid(grid, convFunc, rVis, iuOffset, ivOffset, support);
+                             GridKernel::grid(grid, convFunc, rVis, iuOffset, ivLocal, support);
           
                              itsSamplesGridded+=1.0;
                              itsNumberGridded+=double((2*support+1)*(2*support+1));
@@ -693,7 +718,7 @@ void TableVisGridder::generic(accessors::IDataAccessor& acc, bool forward) {
                               if (itsVisWeight) {
                                   uVis *= itsVisWeight->getWeight(i,frequencyList[chan],pol);
                               }
-                              GridKernel::grid(grid, convFunc, uVis, iuOffset, ivOffset, support);
+                              GridKernel::grid(grid, convFunc, uVis, iuOffset, ivLocal, support);
                       
                               itsSamplesGridded+=1.0;
                               itsNumberGridded+=double((2*support+1)*(2*support+1));
@@ -786,6 +811,28 @@ casa::MVDirection TableVisGridder::getTangentPoint() const
    return out;
 }
 
+/// @brief rotate uvw's in the calling thread
+/// @details The rotated uvw's and delays for the tangent point and image centre of 
+/// this gridder are computed and cached by the accessor. Gridding the same accessor 
+/// in another thread only reads the cache then and doesn't touch measures, as long as
+/// the tangent point and image centre are the same (see sameRotation).
+/// @param[in] acc accessor to work with
+void TableVisGridder::rotateUVW(const accessors::IConstDataAccessor &acc) const
+{
+   const casa::MVDirection tangentPoint = getTangentPoint();
+   acc.rotatedUVW(tangentPoint);
+   acc.uvwRotationDelay(tangentPoint, getImageCentre());
+}
+
+/// @brief check whether rotated uvw's can be shared with another gridder
+/// @param[in] other gridder to compare with
+/// @return true, if both gridders have the same tangent point and image centre
+bool TableVisGridder::sameRotation(const TableVisGridder &other) const
+{
+   return (getTangentPoint().separation(other.getTangentPoint()) < 1e-12) &&
+          (getImageCentre().separation(other.getImageCentre()) < 1e-12);
+}
+
 /// @brief Conversion helper function
 /// @details Copies in to out expanding double into complex values and
 /// padding appropriately if necessary (itsPaddingFactor is more than 1)
@@ -838,7 +885,7 @@ void TableVisGridder::initialiseGrid(const scimath::Axes& axes,
      ASKAPTRACE("TableVisGridder::initialiseGrid");
 
      ASKAPDEBUGASSERT(shape.nelements()>=2);
-     itsShape=scimath::PaddingUtils::paddedShape(shape,paddingFactor());
+     itsShape=scimath::PaddingUtils::paddedShape(fullImageShape(axes, shape),paddingFactor());
 
      initialiseCellSize(axes);
 	
@@ -848,7 +895,7 @@ void TableVisGridder::initialiseGrid(const scimath::Axes& axes,
 
      /// We only need one grid
      itsGrid.resize(1);
-     itsGrid[0].resize(itsShape);
+     itsGrid[0].resize(localGridShape());
      itsGrid[0].set(0.0);
      if (isPSFGridder()) {
          // for a proper PSF calculation
@@ -863,6 +910,78 @@ void TableVisGridder::initialiseGrid(const scimath::Axes& axes,
              printDirection(getImageCentre())); 
 }
 
+/// @brief shape of the grid held by this gridder
+/// @details Without the slab decomposition it is the same as shape(). Otherwise, 
+/// only the rows of the local slab and the halo are held.
+/// @return the shape of the local grid
+casa::IPosition TableVisGridder::localGridShape() const
+{
+  return itsGridSlabs ? itsGridSlabs->localShape(itsShape) : itsShape;
+}
+
+/// @brief full shape of the image
+/// @details If the grid is split into slabs, the image covers only the columns of the
+/// local slab. The SLAB axis then gives the first column (start) and the number of 
+/// columns of the full image (end).
+/// @param[in] axes axes of the image
+/// @param[in] shape shape of the image (or its slab)
+/// @return shape of the full image
+casa::IPosition TableVisGridder::fullImageShape(const scimath::Axes &axes, const casa::IPosition &shape)
+{
+  casa::IPosition result(shape);
+  if (axes.has("SLAB")) {
+      ASKAPDEBUGASSERT(result.nelements() >= 1);
+      result(0) = int(axes.end("SLAB"));
+  }
+  return result;
+}
+
+/// @brief columns of the image held by this process
+/// @details If the grid is split into slabs, each process gets the columns of the padded
+/// image from its slab. This method returns the part of them within the image before 
+/// padding and checks that it matches the SLAB axis of the image.
+/// @param[in] shape shape of the slab of the image
+/// @return a pair with the first column of the full image and the column past the last
+std::pair<int,int> TableVisGridder::localImageColumns(const casa::IPosition &shape) const
+{
+  ASKAPDEBUGASSERT(itsGridSlabs);
+  ASKAPCHECK(itsAxes.has("SLAB"), "The image is expected to cover only the columns of the local grid slab, "
+             "the SLAB axis is missing");
+  const std::pair<int,int> cols = GridSlabFFT::imageColumns(int(itsAxes.end("SLAB")), itsShape(0),
+                                  itsGridSlabs->nSlabs(), itsGridSlabs->slab());
+  ASKAPCHECK((int(itsAxes.start("SLAB")) == cols.first) && (shape(0) == cols.second - cols.first),
+             "The image slab has "<<shape(0)<<" columns starting from "<<int(itsAxes.start("SLAB"))<<
+             ", grid slab "<<itsGridSlabs->slab()<<" expects columns ["<<cols.first<<","<<cols.second<<")");
+  return cols;
+}
+
+/// @brief slicers for the local columns of the image
+/// @details If the grid is split into slabs, this process works with the columns of the
+/// padded image from its slab. This method returns slicers selecting the pixels of the
+/// image before padding held by this process, both in the slab of the image and in the
+/// slab of the padded image (all rows, columns of the local slab).
+/// @param[in] shape shape of the slab of the image
+/// @param[out] image slicer for the slab of the image
+/// @param[out] padded slicer for the slab of the padded image
+/// @return false, if this process holds no pixels of the image
+bool TableVisGridder::slabSlicers(const casa::IPosition &shape, casa::Slicer &image, casa::Slicer &padded) const
+{
+  const std::pair<int,int> imageCols = localImageColumns(shape);
+  if (imageCols.first == imageCols.second) {
+      return false;
+  }
+  const std::pair<int,int> cols = itsGridSlabs->columns(itsShape);
+  const casa::IPosition full = fullImageShape(itsAxes, shape);
+  ASKAPDEBUGASSERT(full.nelements() >= 2);
+  casa::IPosition start(shape.nelements(), 0);
+  image = casa::Slicer(start, shape);
+  // the image is in the centre of the padded image, see PaddingUtils::extract
+  start(0) = imageCols.first + (itsShape(0) - full(0)) / 2 - cols.first;
+  start(1) = (itsShape(1) - full(1)) / 2;
+  padded = casa::Slicer(start, shape);
+  return true;
+}
+
 /// @brief helper method to set up cell size
 /// @details Similar action is required to calculate uv-cell size for gridding and degridding.
 /// Moreover, derived gridders may override initialiseGrid and initialiseDegrid and we don't want
@@ -943,10 +1062,47 @@ void TableVisGridder::initRepresentativeFieldAndFeed()
 void TableVisGridder::finaliseGrid(casa::Array<double>& out) {
     ASKAPTRACE("TableVisGridder::finaliseGrid");
     ASKAPDEBUGASSERT(itsGrid.size() > 0);
+    ASKAPDEBUGASSERT(itsShape == scimath::PaddingUtils::paddedShape(fullImageShape(itsAxes, out.shape()),
+                     paddingFactor()));
+
+    if (itsGridSlabs) {
+        // the grid is split between processes, this process gets the columns of the image
+        // from its slab, the buffer has only these columns of the padded image
+        ASKAPCHECK(itsGrid.size() == 1, "Slab decomposition is only supported for gridders with a single grid");
+        casa::Array<casa::DComplex> slab;
+        itsGridSlabs->toImage(itsShape, itsGrid[0], slab);
+        const std::pair<int,int> cols = itsGridSlabs->columns(itsShape);
+        casa::IPosition slabShape(itsShape);
+        slabShape(0) = cols.second - cols.first;
+        casa::Array<double> dBuffer(slabShape);
+        const size_t nCols = slabShape(0);
+        const size_t ny = itsShape(1);
+        const size_t nPlanes = itsShape.product() / (itsShape(0) * itsShape(1));
+        double *dData = dBuffer.data();
+        const casa::DComplex *slabData = slab.data();
+        for (size_t plane = 0; plane < nPlanes; ++plane) {
+             for (size_t col = 0; col < nCols; ++col) {
+                  const casa::DComplex *src = slabData + ny * (col + nCols * plane);
+                  double *dst = dData + col + nCols * ny * plane;
+                  for (size_t y = 0; y < ny; ++y) {
+                       dst[nCols * y] = src[y].real();
+                  }
+             }
+        }
+        correctConvolution(dBuffer);
+        dBuffer*=double(itsShape(0))*double(itsShape(1));
+        casa::Slicer imageSlicer, paddedSlicer;
+        if (slabSlicers(out.shape(), imageSlicer, paddedSlicer)) {
+            out(imageSlicer) = dBuffer(paddedSlicer);
+        }
+        // each process has the weights of the samples it gridded, finaliseWeights needs the totals
+        itsGridSlabs->sum(itsSumWeights);
+        return;
+    }
+
 	// buffer for result as doubles
-	casa::Array<double> dBuffer(itsGrid[0].shape());
+	casa::Array<double> dBuffer(itsShape);
 	ASKAPDEBUGASSERT(dBuffer.shape().nelements()>=2);
-    ASKAPDEBUGASSERT(itsShape == scimath::PaddingUtils::paddedShape(out.shape(),paddingFactor()));	
 
     /// Loop over all grids Fourier transforming and accumulating
 	for (unsigned int i=0; i<itsGrid.size(); i++) {
@@ -1034,7 +1190,8 @@ void TableVisGridder::storeGrid(const std::string &name, casa::uInt numGrid) con
 void TableVisGridder::finaliseWeights(casa::Array<double>& out) {
    ASKAPTRACE("TableVisGridder::finaliseWeights"); 
    ASKAPDEBUGASSERT(itsShape.nelements() >= 4);
-	ASKAPDEBUGASSERT(itsShape == scimath::PaddingUtils::paddedShape(out.shape(),paddingFactor()));
+	ASKAPDEBUGASSERT(itsShape == scimath::PaddingUtils::paddedShape(fullImageShape(itsAxes, out.shape()),
+	                 paddingFactor()));
 
 	int nPol=itsShape(2);
 	int nChan=itsShape(3);
@@ -1063,7 +1220,7 @@ void TableVisGridder::initialiseDegrid(const scimath::Axes& axes,
 		const casa::Array<double>& in) {
    ASKAPTRACE("TableVisGridder::initialiseDegrid");
     configureForPSF(false);
-	itsShape = scimath::PaddingUtils::paddedShape(in.shape(),paddingFactor());
+	itsShape = scimath::PaddingUtils::paddedShape(fullImageShape(axes, in.shape()),paddingFactor());
 	
 	initialiseCellSize(axes);
     initStokes();
@@ -1072,17 +1229,55 @@ void TableVisGridder::initialiseDegrid(const scimath::Axes& axes,
  
 	/// We only need one grid
 	itsGrid.resize(1);
-	itsGrid[0].resize(itsShape);
-
-	if (casa::max(casa::abs(in))>0.0) {
+	itsGrid[0].resize(localGridShape());
+
+	double peak = in.nelements() > 0 ? casa::max(casa::abs(in)) : 0.;
+	if (itsGridSlabs) {
+	    // the transform is done jointly, so all slabs have to agree whether the model is empty
+	    casa::Array<double> buf(casa::IPosition(1,1), peak);
+	    itsGridSlabs->sum(buf);
+	    peak = buf(casa::IPosition(1,0));
+	}
+	if (peak>0.0) {
 		itsModelIsEmpty=false;
-		casa::Array<double> scratch(itsShape,0.);
-		scimath::PaddingUtils::extract(scratch, paddingFactor()) = in;
-		correctConvolution(scratch);
-		casa::Array<casa::DComplex> scratch2(itsGrid[0].shape());
-		toComplex(scratch2, scratch);
-		fft2d(scratch2, true);
-		casa::convertArray<casa::Complex,casa::DComplex>(itsGrid[0],scratch2);
+		if (itsGridSlabs) {
+		    // the grid is split between processes, the image has only the columns of the
+		    // local slab, they are transformed jointly with other processes to get the local
+		    // rows of the grid
+		    const std::pair<int,int> cols = itsGridSlabs->columns(itsShape);
+		    casa::IPosition slabShape(itsShape);
+		    slabShape(0) = cols.second - cols.first;
+		    casa::Array<double> scratch(slabShape, 0.);
+		    casa::Slicer imageSlicer, paddedSlicer;
+		    if (slabSlicers(in.shape(), imageSlicer, paddedSlicer)) {
+		        scratch(paddedSlicer) = in(imageSlicer);
+		    }
+		    correctConvolution(scratch);
+		    const size_t nCols = slabShape(0);
+		    const size_t ny = itsShape(1);
+		    const size_t nPlanes = itsShape.product() / (itsShape(0) * itsShape(1));
+		    casa::Array<casa::DComplex> slab(itsGridSlabs->imageShape(itsShape));
+		    casa::DComplex *slabData = slab.data();
+		    const double *sData = scratch.data();
+		    for (size_t plane = 0; plane < nPlanes; ++plane) {
+		         for (size_t col = 0; col < nCols; ++col) {
+		              const double *src = sData + col + nCols * ny * plane;
+		              casa::DComplex *dst = slabData + ny * (col + nCols * plane);
+		              for (size_t y = 0; y < ny; ++y) {
+		                   dst[y] = casa::DComplex(src[nCols * y], 0.);
+		              }
+		         }
+		    }
+		    itsGridSlabs->toGrid(itsShape, slab, itsGrid[0]);
+		} else {
+		    casa::Array<double> scratch(itsShape,0.);
+		    scimath::PaddingUtils::extract(scratch, paddingFactor()) = in;
+		    correctConvolution(scratch);
+		    casa::Array<casa::DComplex> scratch2(itsGrid[0].shape());
+		    toComplex(scratch2, scratch);
+		    fft2d(scratch2, true);
+		    casa::convertArray<casa::Complex,casa::DComplex>(itsGrid[0],scratch2);
+		}
 	} else {
 		ASKAPLOG_DEBUG_STR(logger, "No need to degrid: model is empty");
 		itsModelIsEmpty=true;
@@ -36,17 +36,18 @@
 #include <gridding/VisGridderWithPadding.h>
 #include <dataaccess/IDataAccessor.h>
 #include <gridding/FrequencyMapper.h>
+#include <gridding/GridSlabFFT.h>
 
 // std includes
 #include <string>
 
 // casa includes
 #include <casa/BasicSL/Complex.h>
+#include <casa/Arrays/Slicer.h>
 
-#ifdef _OPENMP
 // boost includes
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
-#endif
 
 namespace askap
 {
@@ -179,6 +180,22 @@ namespace askap
       /// environment (we don't want all workers to write CFs)
       /// @param[in] name table name to store the CFs to (or an empty string if CFs are not to be stored)
       void setTableName(const std::string &name) { itsName = name; }
+
+      /// @brief split the grid between processes
+      /// @details If set, this gridder holds only the rows of the local slab (plus the halo)
+      /// and grids or degrids only the samples with the kernel centred on these rows. The FFT
+      /// is done jointly with the other processes, so the images passed to initialiseDegrid and
+      /// returned by finaliseGrid and finaliseWeights cover only the image columns of this slab.
+      /// Their axes must have the SLAB axis, see GridSlabFFT::imageColumns. The sums of weights
+      /// are summed across slabs in finaliseGrid, so it has to be called before finaliseWeights.
+      /// The degridded visibilities have to be summed across slabs. An empty shared pointer 
+      /// (default) means that the whole grid is held by this gridder.
+      /// @param[in] slabs slab decomposition (can be shared by all gridders of the process)
+      void setGridSlabs(const boost::shared_ptr<GridSlabFFT> &slabs) { itsGridSlabs = slabs; }
+
+      /// @brief obtain the slab decomposition of the grid
+      /// @return shared pointer to the slab decomposition (empty if the whole grid is held)
+      inline const boost::shared_ptr<GridSlabFFT>& gridSlabs() const { return itsGridSlabs; }
       
       /// @brief check whether the model is empty
       /// @details A simple check allows us to bypass heavy calculations if the input model
@@ -186,6 +203,19 @@ namespace askap
       /// @brief true, if the model is empty
       virtual bool isModelEmpty() const; 
       
+      /// @brief rotate uvw's in the calling thread
+      /// @details The rotated uvw's and delays for the tangent point and image centre of 
+      /// this gridder are computed and cached by the accessor. Gridding the same accessor 
+      /// in another thread only reads the cache then and doesn't touch measures, as long as
+      /// the tangent point and image centre are the same (see sameRotation).
+      /// @param[in] acc accessor to work with
+      void rotateUVW(const accessors::IConstDataAccessor &acc) const;
+      
+      /// @brief check whether rotated uvw's can be shared with another gridder
+      /// @param[in] other gridder to compare with
+      /// @return true, if both gridders have the same tangent point and image centre
+      bool sameRotation(const TableVisGridder &other) const;
+      
   protected:
       /// @brief helper method to print CF cache stats in the log
       /// @details This method is largely intended for debugging. It writes down
@@ -200,6 +230,40 @@ namespace askap
       /// @return the shape of grid owned by this gridder
       inline const casa::IPosition& shape() const { return itsShape;}
 
+      /// @brief shape of the grid held by this gridder
+      /// @details Without the slab decomposition it is the same as shape(). Otherwise, 
+      /// only the rows of the local slab and the halo are held.
+      /// @return the shape of the local grid
+      casa::IPosition localGridShape() const;
+
+      /// @brief full shape of the image
+      /// @details If the grid is split into slabs, the image covers only the columns of the
+      /// local slab. The SLAB axis then gives the first column (start) and the number of 
+      /// columns of the full image (end).
+      /// @param[in] axes axes of the image
+      /// @param[in] shape shape of the image (or its slab)
+      /// @return shape of the full image
+      static casa::IPosition fullImageShape(const scimath::Axes &axes, const casa::IPosition &shape);
+
+      /// @brief columns of the image held by this process
+      /// @details If the grid is split into slabs, each process gets the columns of the padded
+      /// image from its slab. This method returns the part of them within the image before 
+      /// padding and checks that it matches the SLAB axis of the image.
+      /// @param[in] shape shape of the slab of the image
+      /// @return a pair with the first column of the full image and the column past the last
+      std::pair<int,int> localImageColumns(const casa::IPosition &shape) const;
+
+      /// @brief slicers for the local columns of the image
+      /// @details If the grid is split into slabs, this process works with the columns of the
+      /// padded image from its slab. This method returns slicers selecting the pixels of the
+      /// image before padding held by this process, both in the slab of the image and in the
+      /// slab of the padded image (all rows, columns of the local slab).
+      /// @param[in] shape shape of the slab of the image
+      /// @param[out] image slicer for the slab of the image
+      /// @param[out] padded slicer for the slab of the padded image
+      /// @return false, if this process holds no pixels of the image
+      bool slabSlicers(const casa::IPosition &shape, casa::Slicer &image, casa::Slicer &padded) const;
+
 
       /// @brief correct visibilities, if necessary
       /// @details This method is intended for on-the-fly correction of visibilities (i.e. 
@@ -358,6 +422,8 @@ protected:
       /// @param row Row of accessor
       /// @param pol Polarisation
       /// @param chan Channel
+      /// @return index of the grid, negative value means the sample is skipped
+      /// (it is gridded or degridded in a different pass)
       virtual int gIndex(int row, int pol, int chan);
 
       /// @brief Initialize the convolution function - this is the key function to override.
@@ -419,6 +485,11 @@ protected:
 
       /// The grid is stored as a cube as well so we can index into that as well.
       std::vector<casa::Array<casa::Complex> > itsGrid;
+
+      /// @brief rows of the accessor processed by grid and degrid
+      /// @details An empty pointer means all rows. Derived classes which bucket the data
+      /// (e.g. by w-plane) set it to process a subset of rows without copying them.
+      boost::shared_ptr<const std::vector<casa::uInt> > itsSelectedRows;
             
   private:
 
@@ -538,10 +609,11 @@ protected:
       /// @brief true, if itsSumWeights tracks weights per oversampling plane
       bool itsTrackWeightPerOversamplePlane;
 
-      #ifdef _OPENMP
+      /// @brief slab decomposition of the grid (empty if the whole grid is held)
+      boost::shared_ptr<GridSlabFFT> itsGridSlabs;
+
       /// @brief synchronisation mutex
       mutable boost::mutex itsMutex;
-      #endif
     };
   }
 }
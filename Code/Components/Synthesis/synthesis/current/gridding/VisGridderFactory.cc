@@ -210,6 +210,8 @@ IVisGridder::ShPtr VisGridderFactory::make(const LOFAR::ParameterSet &parset) {
         adapter->setClippingFactor(float(clippingFactor));
         const bool doPSFReprojection = parset.getBool("gridder.snapshotimaging.reprojectpsf", false);
         adapter->setPSFReprojection(doPSFReprojection);
+        const bool fastRegridding = parset.getBool("gridder.snapshotimaging.fastregrid", true);
+        adapter->setFastRegridding(fastRegridding);
         // possible additional configuration comes here
         gridder = adapter;
     }
@@ -29,17 +29,20 @@ ASKAP_LOGGER(logger, ".gridding.wstackgridder");
 
 #include <askap/AskapError.h>
 #include <askap/AskapUtil.h>
+#include <dataaccess/AveragedDataAccessor.h>
 
 #include <casa/Arrays/Array.h>
 #include <casa/Arrays/ArrayMath.h>
 
 #include <casa/BasicSL/Constants.h>
+#include <casa/Arrays/ArrayIter.h>
 #include <fft/FFTWrapper.h>
 #include <utils/PaddingUtils.h>
 #include <profile/AskapProfiler.h>
 
 using namespace askap;
 
+#include <algorithm>
 #include <cmath>
 
 namespace askap
@@ -47,17 +50,21 @@ namespace askap
   namespace synthesis
   {
 
-    WStackVisGridder::WStackVisGridder(const double wmax, const int nwplanes) :
-           WDependentGridderBase(wmax,nwplanes) {}
+    WStackVisGridder::WStackVisGridder(const double wmax, const int nwplanes, const int maxPlanes) :
+           WDependentGridderBase(wmax,nwplanes), itsMaxPlanes(maxPlanes > 0 ? std::min(maxPlanes, nwplanes) : 0),
+           itsSharedBuckets(new SharedBuckets) {}
 
     WStackVisGridder::~WStackVisGridder() {}
     
     /// @brief copy constructor
     /// @details It is required to decouple internal arrays between
-    /// input object and the copy
+    /// input object and the copy. The bucketed row indices are shared,
+    /// queued data are not copied.
     /// @param[in] other input object
     WStackVisGridder::WStackVisGridder(const WStackVisGridder &other) :
-       IVisGridder(other), WDependentGridderBase(other), itsGMap(other.itsGMap.copy()) {}
+       IVisGridder(other), WDependentGridderBase(other), itsGMap(other.itsGMap.copy()),
+       itsMaxPlanes(other.itsMaxPlanes), itsSharedBuckets(other.itsSharedBuckets),
+       itsActivePlanes(other.itsActivePlanes), itsModel(other.itsModel.copy()) {}
     
     
     /// Clone a copy of this Gridder
@@ -99,6 +106,7 @@ namespace askap
         const casa::IPosition& shape, const bool dopsf)
     {
       ASKAPTRACE("WStackVisGridder::initialiseGrid");
+      ASKAPCHECK(!gridSlabs(), "Slab decomposition of the grid is not supported by the w-stacking gridders");
       ASKAPDEBUGASSERT(shape.nelements()>=2);
       itsShape=scimath::PaddingUtils::paddedShape(shape,paddingFactor());
 
@@ -109,10 +117,22 @@ namespace askap
 
       /// We need one grid for each plane
       itsGrid.resize(nWPlanes());
-      for (int i=0; i<nWPlanes(); ++i)
-      {
-        itsGrid[i].resize(itsShape);
-        itsGrid[i].set(0.0);
+      itsActivePlanes.clear();
+      itsGridQueue.clear();
+      if (isStreamed()) {
+          // planes are allocated in finaliseGrid, a batch at a time
+          for (int i=0; i<nWPlanes(); ++i) {
+               itsGrid[i].resize(casa::IPosition(1, 1));
+               itsGrid[i].set(0.0);
+          }
+          ASKAPLOG_INFO_STR(logger, "At most "<<itsMaxPlanes<<" w-planes will be held in memory, data are kept and "
+                            "gridded in "<<nBatches()<<" batches");
+      } else {
+          for (int i=0; i<nWPlanes(); ++i)
+          {
+            itsGrid[i].resize(itsShape);
+            itsGrid[i].set(0.0);
+          }
       }
       if (isPSFGridder())
       {
@@ -182,27 +202,48 @@ namespace askap
       }
       ASKAPDEBUGASSERT(itsGrid.size()>0);
       // buffer for the result as doubles
-      casa::Array<double> dBuffer(itsGrid[0].shape());
+      casa::Array<double> dBuffer(itsShape);
       ASKAPDEBUGASSERT(dBuffer.shape().nelements()>=2);
       
       /// Loop over all grids Fourier transforming and accumulating
       bool first=true;
-      for (unsigned int i=0; i<itsGrid.size(); i++)
-      {
-        if (casa::max(casa::amplitude(itsGrid[i]))>0.0)
-        {
-          casa::Array<casa::DComplex> scratch(itsGrid[i].shape());
-          casa::convertArray<casa::DComplex,casa::Complex>(scratch,itsGrid[i]);
-          scimath::fft2d(scratch, false);
-          multiply(scratch, i);
-
-          if (first)  {
-            first=false;
-            dBuffer = real(scratch);
-          } else {
-            dBuffer += real(scratch);
+      if (isStreamed()) {
+          for (int batch = 0; batch < nBatches(); ++batch) {
+               const int startPlane = batch * itsMaxPlanes;
+               const int endPlane = std::min(startPlane + itsMaxPlanes, nWPlanes());
+               activateBatch(batch);
+               for (int i = startPlane; i < endPlane; ++i) {
+                    itsGrid[i].resize(itsShape);
+                    itsGrid[i].set(0.0);
+               }
+               for (size_t chunk = 0; chunk < itsGridQueue.size(); ++chunk) {
+                    const BucketedRows &entry = *itsGridQueue[chunk];
+                    if (entry.itsRows[batch]) {
+                        itsSelectedRows = entry.itsRows[batch];
+                        TableVisGridder::grid(*entry.itsAccessor);
+                    }
+               }
+               itsSelectedRows.reset();
+               for (int i = startPlane; i < endPlane; ++i) {
+                    if (stackPlane(i, dBuffer, first)) {
+                        first = false;
+                    }
+                    itsGrid[i].resize(casa::IPosition(1, 1));
+                    itsGrid[i].set(0.0);
+               }
+          }
+          itsActivePlanes.clear();
+          // release the data as soon as possible
+          itsGridQueue.clear();
+      } else {
+          for (int i=0; i<int(itsGrid.size()); ++i) {
+               if (stackPlane(i, dBuffer, first)) {
+                   first = false;
+               }
           }
-        }
+      }
+      if (first) {
+          dBuffer.set(0.);
       }
       // Now we can do the convolution correction
       correctConvolution(dBuffer);
@@ -210,10 +251,108 @@ namespace askap
       out = scimath::PaddingUtils::extract(dBuffer, paddingFactor());
     }
 
+    bool WStackVisGridder::stackPlane(int plane, casa::Array<double> &dBuffer, bool first)
+    {
+      ASKAPDEBUGASSERT((plane >= 0) && (plane < int(itsGrid.size())));
+      if (itsGrid[plane].shape() != dBuffer.shape() || casa::max(casa::amplitude(itsGrid[plane])) <= 0.0) {
+          return false;
+      }
+      casa::Array<casa::DComplex> scratch(itsGrid[plane].shape());
+      casa::convertArray<casa::DComplex,casa::Complex>(scratch,itsGrid[plane]);
+      scimath::fft2d(scratch, false);
+      multiply(scratch, plane);
+
+      if (first)  {
+          dBuffer = real(scratch);
+      } else {
+          dBuffer += real(scratch);
+      }
+      return true;
+    }
+
+    void WStackVisGridder::finaliseWeights(casa::Array<double>& out)
+    {
+      ASKAPCHECK(itsGridQueue.size() == 0, "finaliseGrid has to be called before finaliseWeights "
+                 "if the number of w-planes in memory is limited");
+      WDependentGridderBase::finaliseWeights(out);
+    }
+
+    void WStackVisGridder::grid(accessors::IConstDataAccessor& acc)
+    {
+      if (!isStreamed()) {
+          WDependentGridderBase::grid(acc);
+          return;
+      }
+      // the accessor may change after this call, so the data are copied
+      boost::shared_ptr<accessors::AveragedDataAccessor> copy(new accessors::AveragedDataAccessor);
+      copy->assign(acc);
+      gridShared(copy);
+    }
+
+    void WStackVisGridder::gridShared(const boost::shared_ptr<accessors::IConstDataAccessor> &acc)
+    {
+      ASKAPDEBUGASSERT(acc);
+      if (!isStreamed()) {
+          WDependentGridderBase::grid(*acc);
+          return;
+      }
+      ASKAPTRACE("WStackVisGridder::gridShared");
+      itsGridQueue.push_back(bucketRows(acc));
+    }
+
+    boost::shared_ptr<WStackVisGridder::BucketedRows> WStackVisGridder::bucketRows(
+           const boost::shared_ptr<accessors::IConstDataAccessor> &acc)
+    {
+      ASKAPDEBUGASSERT(itsSharedBuckets);
+      const casa::MVDirection tangentPoint = getTangentPoint();
+      // clones use the accessor concurrently, so the lock is held while the rows are bucketed
+      boost::lock_guard<boost::mutex> lock(itsSharedBuckets->itsMutex);
+      typedef std::multimap<const accessors::IConstDataAccessor*, boost::weak_ptr<BucketedRows> > EntryMap;
+      EntryMap &entries = itsSharedBuckets->itsEntries;
+      const std::pair<EntryMap::iterator, EntryMap::iterator> range = entries.equal_range(acc.get());
+      for (EntryMap::iterator it = range.first; it != range.second;) {
+           const boost::shared_ptr<BucketedRows> entry = it->second.lock();
+           if (!entry) {
+               entries.erase(it++);
+               continue;
+           }
+           if (entry->itsTangentPoint.separation(tangentPoint) < 1e-12) {
+               return entry;
+           }
+           ++it;
+      }
+      // the first clone to see this accessor buckets its rows
+      boost::shared_ptr<BucketedRows> entry(new BucketedRows);
+      entry->itsAccessor = acc;
+      entry->itsTangentPoint = tangentPoint;
+      initIndices(*acc);
+      std::vector<std::vector<casa::uInt> > rows(nBatches());
+      for (casa::uInt row = 0; row < itsGMap.nrow(); ++row) {
+           for (casa::uInt chan = 0; chan < itsGMap.nplane(); ++chan) {
+                for (casa::uInt pol = 0; pol < itsGMap.ncolumn(); ++pol) {
+                     const size_t batch = size_t(itsGMap(row, pol, chan) / itsMaxPlanes);
+                     ASKAPDEBUGASSERT(batch < rows.size());
+                     if ((rows[batch].size() == 0) || (rows[batch].back() != row)) {
+                         rows[batch].push_back(row);
+                     }
+                }
+           }
+      }
+      entry->itsRows.resize(rows.size());
+      for (size_t batch = 0; batch < rows.size(); ++batch) {
+           if (rows[batch].size() > 0) {
+               entry->itsRows[batch].reset(new std::vector<casa::uInt>(rows[batch]));
+           }
+      }
+      entries.insert(std::make_pair(acc.get(), boost::weak_ptr<BucketedRows>(entry)));
+      return entry;
+    }
+
     void WStackVisGridder::initialiseDegrid(const scimath::Axes& axes,
         const casa::Array<double>& in)
     {
       ASKAPTRACE("WStackVisGridder::initialiseDegrid");
+      ASKAPCHECK(!gridSlabs(), "Slab decomposition of the grid is not supported by the w-stacking gridders");
       itsShape = scimath::PaddingUtils::paddedShape(in.shape(),paddingFactor());
       configureForPSF(false);
 
@@ -223,23 +362,30 @@ namespace askap
       initialiseFreqMapping();      
 
       itsGrid.resize(nWPlanes());
+      itsActivePlanes.clear();
+      itsDegridQueue.clear();
+      itsModel.resize();
       if (casa::max(casa::abs(in))>0.0) {
         itsModelIsEmpty=false;
-        ASKAPLOG_INFO_STR(logger, "Filling " << nWPlanes()
-                           << " planes of W stack with model");
         casa::Array<double> scratch(itsShape,0.);
         scimath::PaddingUtils::extract(scratch, paddingFactor()) = in;
         correctConvolution(scratch);
-        for (int i=0; i<nWPlanes(); ++i)
-        {
-          casa::Array<casa::DComplex> work(itsShape);          
-          toComplex(work, scratch);
-          multiply(work, i);
-          /// Need to conjugate to get sense of w correction correct
-          work = casa::conj(work);
-          scimath::fft2d(work, true);
-          itsGrid[i].resize(itsShape);
-          casa::convertArray<casa::Complex,casa::DComplex>(itsGrid[i],work);
+        if (isStreamed()) {
+          ASKAPLOG_INFO_STR(logger, "Planes of W stack will be filled with model in "<<nBatches()<<
+                            " batches of at most "<<itsMaxPlanes<<" planes");
+          itsModel.reference(scratch);
+          for (int i=0; i<nWPlanes(); ++i) {
+            itsGrid[i].resize(casa::IPosition(1, 1));
+            itsGrid[i].set(casa::Complex(0.0));
+          }
+          itsActivePlanes.assign(nWPlanes(), false);
+        } else {
+          ASKAPLOG_INFO_STR(logger, "Filling " << nWPlanes()
+                             << " planes of W stack with model");
+          for (int i=0; i<nWPlanes(); ++i)
+          {
+            fillPlane(i, scratch);
+          }
         }
       } else {
         itsModelIsEmpty=true;
@@ -251,9 +397,109 @@ namespace askap
       }
     }
 
+    void WStackVisGridder::fillPlane(int plane, const casa::Array<double> &model)
+    {
+      ASKAPDEBUGASSERT((plane >= 0) && (plane < int(itsGrid.size())));
+      casa::Array<casa::DComplex> work(itsShape);          
+      toComplex(work, model);
+      multiply(work, plane);
+      /// Need to conjugate to get sense of w correction correct
+      work = casa::conj(work);
+      scimath::fft2d(work, true);
+      itsGrid[plane].resize(itsShape);
+      casa::convertArray<casa::Complex,casa::DComplex>(itsGrid[plane],work);
+    }
+
+    void WStackVisGridder::activateBatch(int batch)
+    {
+      ASKAPDEBUGASSERT((batch >= 0) && (batch < nBatches()));
+      itsActivePlanes.assign(nWPlanes(), false);
+      const int startPlane = batch * itsMaxPlanes;
+      const int endPlane = std::min(startPlane + itsMaxPlanes, nWPlanes());
+      for (int i = startPlane; i < endPlane; ++i) {
+           itsActivePlanes[i] = true;
+      }
+    }
+
+    void WStackVisGridder::degrid(accessors::IDataAccessor& acc)
+    {
+      if (!isStreamed() || itsModelIsEmpty) {
+          WDependentGridderBase::degrid(acc);
+          return;
+      }
+      // the accessor is only used until flushDegrid returns
+      degridShared(boost::shared_ptr<accessors::IDataAccessor>(&acc, utility::NullDeleter()));
+      flushDegrid();
+    }
+
+    void WStackVisGridder::degridShared(const boost::shared_ptr<accessors::IDataAccessor> &acc)
+    {
+      ASKAPDEBUGASSERT(acc);
+      if (!isStreamed() || itsModelIsEmpty) {
+          WDependentGridderBase::degrid(*acc);
+          return;
+      }
+      ASKAPTRACE("WStackVisGridder::degridShared");
+      itsDegridQueue.push_back(std::make_pair(acc, bucketRows(acc)));
+    }
+
+    void WStackVisGridder::flushDegrid()
+    {
+      if (itsDegridQueue.size() == 0) {
+          return;
+      }
+      ASKAPTRACE("WStackVisGridder::flushDegrid");
+      ASKAPDEBUGASSERT(isStreamed());
+      // each plane is filled once and all rows touching it are degridded, results are
+      // accumulated in the accessors
+      for (int batch = 0; batch < nBatches(); ++batch) {
+           bool used = false;
+           for (size_t chunk = 0; chunk < itsDegridQueue.size() && !used; ++chunk) {
+                used = (itsDegridQueue[chunk].second->itsRows[batch].get() != 0);
+           }
+           if (!used) {
+               continue;
+           }
+           const int startPlane = batch * itsMaxPlanes;
+           const int endPlane = std::min(startPlane + itsMaxPlanes, nWPlanes());
+           activateBatch(batch);
+           for (int i = startPlane; i < endPlane; ++i) {
+                fillPlane(i, itsModel);
+           }
+           for (size_t chunk = 0; chunk < itsDegridQueue.size(); ++chunk) {
+                const boost::shared_ptr<const std::vector<casa::uInt> > &rows = itsDegridQueue[chunk].second->itsRows[batch];
+                if (rows) {
+                    itsSelectedRows = rows;
+                    WDependentGridderBase::degrid(*itsDegridQueue[chunk].first);
+                }
+           }
+           itsSelectedRows.reset();
+           for (int i = startPlane; i < endPlane; ++i) {
+                itsGrid[i].resize(casa::IPosition(1, 1));
+                itsGrid[i].set(casa::Complex(0.0));
+           }
+      }
+      itsActivePlanes.assign(nWPlanes(), false);
+      itsDegridQueue.clear();
+    }
+
+    void WStackVisGridder::finaliseDegrid()
+    {
+      if (isStreamed()) {
+          ASKAPCHECK(itsDegridQueue.size() == 0, "flushDegrid has to be called before finaliseDegrid");
+          itsActivePlanes.clear();
+          itsModel.resize();
+      }
+      WDependentGridderBase::finaliseDegrid();
+    }
+
     int WStackVisGridder::gIndex(int row, int pol, int chan)
     {
       const int plane = itsGMap(row, pol, chan);
+      if ((itsActivePlanes.size() > 0) && !itsActivePlanes[plane]) {
+          // this plane is not in memory at the moment, the sample is processed in another pass
+          return -1;
+      }
       notifyOfWPlaneUse(plane);
       return plane;
     }
@@ -270,8 +516,9 @@ namespace askap
     {
       double wmax=parset.getDouble("wmax", 35000.0);
       int nwplanes=parset.getInt32("nwplanes", 65);
+      const int maxPlanes = parset.getInt32("maxplanes", 0);
       ASKAPLOG_INFO_STR(logger, "Gridding using W stacking with "<<nwplanes<<" w-planes in the stack");
-      boost::shared_ptr<WStackVisGridder> gridder(new WStackVisGridder(wmax, nwplanes)); 
+      boost::shared_ptr<WStackVisGridder> gridder(new WStackVisGridder(wmax, nwplanes, maxPlanes)); 
       gridder->configureWSampling(parset);       
       return gridder;
     }
@@ -30,7 +30,15 @@
 #define ASKAP_SYNTHESIS_WSTACKVISGRIDDER_H_
 
 #include <gridding/WDependentGridderBase.h>
-#include <dataaccess/IConstDataAccessor.h>
+#include <dataaccess/IDataAccessor.h>
+#include <casa/Quanta/MVDirection.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+#include <vector>
 
 namespace askap
 {
@@ -46,6 +54,19 @@ namespace askap
 		///
 		/// The scaling is fast in data points, slow in w planes.
 		///
+		/// By default all planes are held in memory. If the maximum number of
+		/// planes in memory is given, the planes are processed in batches of that size.
+		/// The data are kept until all batches are processed and only the indices of
+		/// their rows are bucketed by batch. For gridding, the batches are gridded in
+		/// finaliseGrid and each plane is Fourier transformed and added to the image as
+		/// soon as its batch is gridded. For degridding, the data are queued and each
+		/// batch of model planes is filled once in flushDegrid, which degrids all queued
+		/// rows touching the batch. Clones of the gridder share the bucketed row indices,
+		/// so the data given via gridShared and degridShared (e.g. to the model, residual
+		/// and PSF gridders of the same image) are held once, by the caller. The memory
+		/// used for grids is then independent of the number of w-planes, at the expense
+		/// of keeping the data.
+		///
 		/// @ingroup gridding
 		class WStackVisGridder : public WDependentGridderBase
 		{
@@ -54,7 +75,9 @@ namespace askap
 				/// @brief Construct a gridder for W stacking
 				/// @param wmax Maximum baseline (wavelengths)
 				/// @param nwplanes Number of w planes
-				WStackVisGridder(const double wmax, const int nwplanes);
+				/// @param maxPlanes maximum number of w planes held in memory,
+				/// zero or negative value means all planes are kept
+				WStackVisGridder(const double wmax, const int nwplanes, const int maxPlanes = 0);
 
 				virtual ~WStackVisGridder();
 				
@@ -71,16 +94,66 @@ namespace askap
 				virtual void initialiseGrid(const scimath::Axes& axes,
 				    const casa::IPosition& shape, const bool dopsf=true);
 				
+				/// @brief Grid the visibility data
+				/// @details If the number of planes in memory is limited, the data are
+				/// copied, bucketed and gridded in finaliseGrid. Use gridShared to avoid
+				/// the copy.
+				/// @param acc const data accessor to work with
+				virtual void grid(accessors::IConstDataAccessor& acc);
+
 				/// Form the final output image
 				/// @param out Output double precision image or PSF
 				virtual void finaliseGrid(casa::Array<double>& out);
 
+				/// @brief form the sum of weights
+				/// @details If the number of planes in memory is limited, finaliseGrid
+				/// has to be called first, as the weights are accumulated there.
+				/// @param out output array
+				virtual void finaliseWeights(casa::Array<double>& out);
+
 				/// @brief Initialise the degridding
 				/// @param axes axes specifications
 				/// @param image Input image: cube: u,v,pol,chan
 				virtual void initialiseDegrid(const scimath::Axes& axes,
 				    const casa::Array<double>& image);
 
+				/// @brief Degrid the visibility data
+				/// @details If the number of planes in memory is limited, this is
+				/// degridShared followed by flushDegrid, i.e. all model planes required
+				/// by this accessor are filled. Use degridShared for all accessors and
+				/// flushDegrid once to fill each plane only once.
+				/// @param[in] acc non-const data accessor to work with
+				virtual void degrid(accessors::IDataAccessor& acc);
+
+				/// @brief Finalise degridding
+				/// @details Data queued for degridding are released here.
+				virtual void finaliseDegrid();
+
+				/// @brief check whether the number of planes in memory is limited
+				/// @return true, if planes are processed in batches
+				bool isStreamed() const { return itsMaxPlanes > 0; }
+
+				/// @brief grid the data kept by the caller
+				/// @details If the number of planes in memory is limited, only the row
+				/// indices are bucketed here and the accessor is referenced until
+				/// finaliseGrid, so it must not be changed until then. Otherwise, it
+				/// is the same as grid.
+				/// @param[in] acc shared pointer to the accessor
+				void gridShared(const boost::shared_ptr<accessors::IConstDataAccessor> &acc);
+
+				/// @brief queue the data kept by the caller for degridding
+				/// @details If the number of planes in memory is limited, the row indices
+				/// are bucketed here and the model visibilities are added to the accessor
+				/// by flushDegrid. Otherwise, it is the same as degrid.
+				/// @param[in] acc shared pointer to the accessor
+				void degridShared(const boost::shared_ptr<accessors::IDataAccessor> &acc);
+
+				/// @brief degrid all queued data
+				/// @details Model planes are filled a batch at a time, each plane once,
+				/// and all queued rows touching the batch are degridded. The queue is
+				/// empty afterwards.
+				void flushDegrid();
+
 				/// Clone a copy of this Gridder
 				virtual IVisGridder::ShPtr clone();
 
@@ -118,7 +191,74 @@ namespace askap
 				
 				/// Mapping from row, pol, and channel to planes of grid
 				casa::Cube<int> itsGMap;
+
             private:
+				/// @brief row indices of an accessor bucketed by batches of w-planes
+				struct BucketedRows {
+				   /// @brief the accessor
+				   boost::shared_ptr<accessors::IConstDataAccessor> itsAccessor;
+				   /// @brief tangent point the w-planes are computed for
+				   casa::MVDirection itsTangentPoint;
+				   /// @brief rows touching each batch (empty pointer if there are none)
+				   std::vector<boost::shared_ptr<const std::vector<casa::uInt> > > itsRows;
+				};
+
+				/// @brief bucketed row indices shared between the clones of a gridder
+				/// @details Entries are weak pointers, so the data are released when no
+				/// clone holds them any more. The w-planes only depend on the tangent
+				/// point for clones, as the w-sampling is the same.
+				struct SharedBuckets {
+				   /// @brief mutex protecting the map and the bucketing
+				   boost::mutex itsMutex;
+				   /// @brief entries for each accessor
+				   std::multimap<const accessors::IConstDataAccessor*, boost::weak_ptr<BucketedRows> > itsEntries;
+				};
+				/// @brief Fourier transform one plane and add it to the image
+				/// @param[in] plane index of the w-plane
+				/// @param[in] dBuffer image to add to
+				/// @param[in] first true, if this is the first plane added
+				/// @return true, if the plane was not empty and has been added
+				bool stackPlane(int plane, casa::Array<double> &dBuffer, bool first);
+
+				/// @brief fill one plane from the model
+				/// @param[in] plane index of the w-plane
+				/// @param[in] model padded model image with convolution correction applied
+				void fillPlane(int plane, const casa::Array<double> &model);
+
+				/// @brief number of batches of w-planes
+				int nBatches() const { return (nWPlanes() + itsMaxPlanes - 1) / itsMaxPlanes; }
+
+				/// @brief make only the planes of the given batch active
+				/// @param[in] batch batch index
+				void activateBatch(int batch);
+
+				/// @brief bucket the rows of an accessor by batches of w-planes
+				/// @details The result is shared with the clones of this gridder, so the
+				/// rows are bucketed once per accessor and tangent point.
+				/// @param[in] acc shared pointer to the accessor
+				/// @return bucketed row indices
+				boost::shared_ptr<BucketedRows> bucketRows(const boost::shared_ptr<accessors::IConstDataAccessor> &acc);
+
+				/// @brief maximum number of planes in memory, zero means no limit
+				int itsMaxPlanes;
+
+				/// @brief bucketed row indices shared with clones
+				boost::shared_ptr<SharedBuckets> itsSharedBuckets;
+
+				/// @brief data to be gridded in finaliseGrid
+				std::vector<boost::shared_ptr<BucketedRows> > itsGridQueue;
+
+				/// @brief data to be degridded in flushDegrid with the accessors to write to
+				std::vector<std::pair<boost::shared_ptr<accessors::IDataAccessor>,
+				                      boost::shared_ptr<BucketedRows> > > itsDegridQueue;
+
+				/// @brief flags of the planes which are processed at the moment
+				/// @details empty vector means all planes are active
+				std::vector<bool> itsActivePlanes;
+
+				/// @brief padded model with the convolution correction (degridding only)
+				casa::Array<double> itsModel;
+
     	        /// @brief assignment operator
 				/// @details It is required as private to avoid being called
 				/// @param[in] other input object
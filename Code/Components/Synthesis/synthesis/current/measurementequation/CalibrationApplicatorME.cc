@@ -38,6 +38,7 @@
 #include <scimath/Mathematics/MatrixMathLA.h>
 #include <scimath/Mathematics/RigidVector.h>
 #include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
 #include <utils/PolConverter.h>
 #include <dataaccess/IFlagAndNoiseDataAccessor.h>
 
@@ -48,6 +49,8 @@
 ASKAP_LOGGER(logger, ".measurementequation");
 
 #include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 namespace askap {
 
@@ -70,6 +73,10 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
   casa::Cube<casa::Complex> &rwVis = chunk.rwVisibility();
   ASKAPDEBUGASSERT(rwVis.nelements());
   updateAccessor(chunk.time());
+  if (itsCacheChangeMonitor != changeMonitor()) {
+      itsJonesCache.clear();
+      itsCacheChangeMonitor = changeMonitor();
+  }
   const casa::Vector<casa::uInt>& antenna1 = chunk.antenna1();
   const casa::Vector<casa::uInt>& antenna2 = chunk.antenna2();
   const casa::Vector<casa::uInt>& beam1 = chunk.feed1();
@@ -77,13 +84,20 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
   const casa::Vector<casa::Stokes::StokesTypes> stokes = chunk.stokes();   
   
   const casa::uInt nPol = chunk.nPol();
+  const casa::uInt nRow = chunk.nRow();
+  const casa::uInt nChan = chunk.nChannel();
   ASKAPDEBUGASSERT(nPol <= 4);
-  casa::Matrix<casa::Complex> mueller(nPol, nPol);
-  casa::Matrix<casa::Complex> reciprocal(nPol, nPol);
+  if ((nRow == 0) || (nChan == 0)) {
+      return;
+  }
   
   casa::RigidVector<casa::uInt, 4> indices(0u);
+  // bit mask of the polarisation products present
+  casa::uInt productsPresent = 0;
   for (casa::uInt pol = 0; pol<nPol; ++pol) {
        indices(pol) = scimath::PolConverter::getIndex(stokes[pol]);
+       ASKAPDEBUGASSERT(indices(pol) < 4);
+       productsPresent |= 1u << indices(pol);
   }
   
   boost::shared_ptr<accessors::IFlagAndNoiseDataAccessor> noiseAndFlagDA;
@@ -93,22 +107,78 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
       ASKAPDEBUGASSERT(chunkPtr);
       noiseAndFlagDA = boost::dynamic_pointer_cast<accessors::IFlagAndNoiseDataAccessor>(chunkPtr);
   }
+
+  // get jones matrices for all rows first, the solution accessor need not be thread-safe
+  // (the cache is not resized after the first access in this loop, so the pointers stay valid)
+  CorrectionContext ctx;
+  ctx.jones1.resize(nRow);
+  ctx.jones2.resize(nRow);
+  for (casa::uInt row = 0; row < nRow; ++row) {
+       ctx.jones1[row] = &(cachedJones(antenna1[row], itsBeamIndependent ? 0 : beam1[row], nChan)[0]);
+       ctx.jones2[row] = &(cachedJones(antenna2[row], itsBeamIndependent ? 0 : beam2[row], nChan)[0]);
+  }
   
-  // full 4x4 Mueller matrix
-  casa::SquareMatrix<casa::Complex, 2> fullMueller(casa::SquareMatrix<casa::Complex, 2>::General);
+  const float detThreshold = 1e-25;
+
+  if (productsPresent == 0xf) {
+      // all four products are present, apply inv(J1) V inv(J2)^H in parallel
+      ASKAPDEBUGASSERT(nPol == 4);
+      ASKAPDEBUGASSERT(rwVis.contiguousStorage());
+      ctx.nRow = nRow;
+      ctx.nChan = nChan;
+      ctx.antenna1 = &antenna1;
+      ctx.antenna2 = &antenna2;
+      ctx.beam1 = &beam1;
+      ctx.beam2 = &beam2;
+      ctx.time = chunk.time();
+      for (casa::uInt pol = 0; pol < nPol; ++pol) {
+           ctx.indices[pol] = indices(pol);
+           ctx.offsets[indices(pol)] = size_t(pol) * nRow * nChan;
+      }
+      ctx.vis = rwVis.data();
+      ctx.noise = 0;
+      if (itsScaleNoise) {
+          ASKAPCHECK(noiseAndFlagDA, "Accessor type passed to CalibrationApplicatorME does not support change of the noise estimate");
+          casa::Cube<casa::Complex> &rwNoise = noiseAndFlagDA->rwNoise();
+          ASKAPDEBUGASSERT(rwNoise.shape() == rwVis.shape());
+          ASKAPDEBUGASSERT(rwNoise.contiguousStorage());
+          ctx.noise = rwNoise.data();
+      }
+      if (itsFlagAllowed) {
+          ctx.toFlag.assign(size_t(nRow) * nChan, 0);
+      }
+      TaskScheduler::instance().parallelFor(0, nRow, boost::bind(&CalibrationApplicatorME::correctRows,
+                 this, boost::ref(ctx), _1, _2), "calapply");
+
+      // flags are changed in the accessor only if necessary
+      casa::Cube<casa::Bool> *rwFlag = 0;
+      for (size_t index = 0; index < ctx.toFlag.size(); ++index) {
+           if (ctx.toFlag[index]) {
+               if (rwFlag == 0) {
+                   ASKAPCHECK(noiseAndFlagDA, "Accessor type passed to CalibrationApplicatorME does not support change of flags");
+                   rwFlag = &(noiseAndFlagDA->rwFlag());
+               }
+               rwFlag->yzPlane(index / nChan).row(index % nChan).set(true);
+           }
+      }
+      return;
+  }
+  
+  // general case, a subset of polarisation products
+  casa::Matrix<casa::Complex> mueller(nPol, nPol);
+  casa::Matrix<casa::Complex> reciprocal(nPol, nPol);
   
-  for (casa::uInt row = 0; row < chunk.nRow(); ++row) {
+  for (casa::uInt row = 0; row < nRow; ++row) {
        casa::Matrix<casa::Complex> thisRow = rwVis.yzPlane(row);
-       for (casa::uInt chan = 0; chan < chunk.nChannel(); ++chan) {
-            casa::SquareMatrix<casa::Complex, 2> jones1 = calSolution().jones(antenna1[row], 
-                             itsBeamIndependent ? 0 : beam1[row], chan);
-            casa::SquareMatrix<casa::Complex, 2> jones2 = calSolution().jones(antenna2[row],
-                             itsBeamIndependent ? 0 : beam2[row], chan);
+       for (casa::uInt chan = 0; chan < nChan; ++chan) {
+            const CachedJones &jones1 = ctx.jones1[row][chan];
+            const CachedJones &jones2 = ctx.jones2[row][chan];
             for (casa::uInt i = 0; i < nPol; ++i) {
                  for (casa::uInt j = 0; j < nPol; ++j) {
                       const casa::uInt index1 = indices(i);
                       const casa::uInt index2 = indices(j);
-                      mueller(i,j) = jones1(index1 / 2, index2 / 2) * conj(jones2(index1 % 2, index2 % 2));
+                      mueller(i,j) = jones1.jones[(index1 / 2) * 2 + index2 / 2] * 
+                                     conj(jones2.jones[(index1 % 2) * 2 + index2 % 2]);
                  }
             }
             
@@ -117,7 +187,6 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
 
             casa::Vector<casa::Complex> thisChan = thisRow.row(chan);
 
-            const float detThreshold = 1e-25;
             if (itsFlagAllowed) {
                 if (casa::abs(det)<detThreshold) {
                     ASKAPCHECK(noiseAndFlagDA, "Accessor type passed to CalibrationApplicatorME does not support change of flags");
@@ -128,7 +197,9 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
             } else {
               ASKAPCHECK(casa::abs(det)>detThreshold, "Unable to apply calibration for (antenna1,beam1)=("<<antenna1[row]<<","<<beam1[row]<<") and (antenna2,beam2)=("<<antenna2[row]<<
                                ","<<beam2[row]<<"), time="<<chunk.time()/86400.-55000<<" determinate is too close to 0. D="<<casa::abs(det)<<" matrix="<<mueller
-                       <<" jones1="<<jones1.matrix()<<" jones2="<<jones2.matrix()<<" dir="<<askap::printDirection(chunk.pointingDir1()[row]));           
+                       <<" jones1="<<calSolution().jones(antenna1[row], itsBeamIndependent ? 0 : beam1[row], chan).matrix()
+                       <<" jones2="<<calSolution().jones(antenna2[row], itsBeamIndependent ? 0 : beam2[row], chan).matrix()
+                       <<" dir="<<askap::printDirection(chunk.pointingDir1()[row]));           
             }           
             const casa::Vector<casa::Complex> origVis = thisChan.copy();
             ASKAPDEBUGASSERT(thisChan.nelements() == nPol);
@@ -161,6 +232,122 @@ void CalibrationApplicatorME::correct(accessors::IDataAccessor &chunk) const
   }
 }
 
+/// @brief obtain cached jones matrices for the given antenna and beam
+/// @details The cache is extended if necessary. It is not thread-safe as
+/// the solution accessor is used to fill it.
+/// @param[in] ant antenna index
+/// @param[in] beam beam index
+/// @param[in] nChan number of channels required
+/// @return reference to the vector with at least nChan elements
+const std::vector<CalibrationApplicatorME::CachedJones>& 
+CalibrationApplicatorME::cachedJones(casa::uInt ant, casa::uInt beam, casa::uInt nChan) const
+{
+  std::vector<CachedJones> &cache = itsJonesCache[std::make_pair(ant, beam)];
+  if (cache.size() < nChan) {
+      cache.reserve(nChan);
+      for (casa::uInt chan = cache.size(); chan < nChan; ++chan) {
+           const casa::SquareMatrix<casa::Complex, 2> jones = calSolution().jones(ant, beam, chan);
+           CachedJones entry;
+           entry.jones[0] = jones(0,0);
+           entry.jones[1] = jones(0,1);
+           entry.jones[2] = jones(1,0);
+           entry.jones[3] = jones(1,1);
+           entry.det = entry.jones[0] * entry.jones[3] - entry.jones[1] * entry.jones[2];
+           if (entry.det != casa::Complex(0.,0.)) {
+               const casa::Complex invDet = casa::Complex(1.,0.) / entry.det;
+               entry.inverse[0] = entry.jones[3] * invDet;
+               entry.inverse[1] = -entry.jones[1] * invDet;
+               entry.inverse[2] = -entry.jones[2] * invDet;
+               entry.inverse[3] = entry.jones[0] * invDet;
+           } else {
+               for (int i = 0; i < 4; ++i) {
+                    entry.inverse[i] = casa::Complex(0.,0.);
+               }
+           }
+           cache.push_back(entry);
+      }
+  }
+  return cache;
+}
+
+/// @brief apply the correction to the given range of rows
+/// @details This method is called for all four polarisation products only.
+/// @param[in] ctx data shared by all threads
+/// @param[in] begin first row
+/// @param[in] end row past the last one
+void CalibrationApplicatorME::correctRows(CorrectionContext &ctx, size_t begin, size_t end) const
+{
+  const float detThreshold = 1e-25;
+  const size_t o00 = ctx.offsets[0];
+  const size_t o01 = ctx.offsets[1];
+  const size_t o10 = ctx.offsets[2];
+  const size_t o11 = ctx.offsets[3];
+  for (size_t row = begin; row < end; ++row) {
+       const CachedJones *jones1 = ctx.jones1[row];
+       const CachedJones *jones2 = ctx.jones2[row];
+       for (casa::uInt chan = 0; chan < ctx.nChan; ++chan) {
+            const CachedJones &j1 = jones1[chan];
+            const CachedJones &j2 = jones2[chan];
+            casa::Complex *vis = ctx.vis + row + size_t(ctx.nRow) * chan;
+            // the determinant of the 4x4 Mueller matrix is det(J1)^2 conj(det(J2))^2
+            const float det = casa::norm(j1.det) * casa::norm(j2.det);
+            if (ctx.toFlag.size() > 0) {
+                if (det < detThreshold) {
+                    ctx.toFlag[row * ctx.nChan + chan] = 1;
+                    vis[o00] = vis[o01] = vis[o10] = vis[o11] = casa::Complex(0.,0.);
+                    continue;
+                }
+            } else {
+              ASKAPCHECK(det > detThreshold, "Unable to apply calibration for (antenna1,beam1)=("<<(*ctx.antenna1)[row]<<
+                         ","<<(*ctx.beam1)[row]<<") and (antenna2,beam2)=("<<(*ctx.antenna2)[row]<<","<<(*ctx.beam2)[row]<<
+                         "), time="<<ctx.time/86400.-55000<<" channel="<<chan<<" determinate is too close to 0. D="<<det<<
+                         " det(jones1)="<<j1.det<<" det(jones2)="<<j2.det);
+            }
+            const casa::Complex *a = j1.inverse;
+            const casa::Complex *b = j2.inverse;
+            // inv(J1) V
+            const casa::Complex t00 = a[0] * vis[o00] + a[1] * vis[o10];
+            const casa::Complex t01 = a[0] * vis[o01] + a[1] * vis[o11];
+            const casa::Complex t10 = a[2] * vis[o00] + a[3] * vis[o10];
+            const casa::Complex t11 = a[2] * vis[o01] + a[3] * vis[o11];
+            // times inv(J2)^H
+            const casa::Complex cb0 = conj(b[0]);
+            const casa::Complex cb1 = conj(b[1]);
+            const casa::Complex cb2 = conj(b[2]);
+            const casa::Complex cb3 = conj(b[3]);
+            vis[o00] = t00 * cb0 + t01 * cb1;
+            vis[o01] = t00 * cb2 + t01 * cb3;
+            vis[o10] = t10 * cb0 + t11 * cb1;
+            vis[o11] = t10 * cb2 + t11 * cb3;
+
+            if (ctx.noise != 0) {
+                casa::Complex *noise = ctx.noise + row + size_t(ctx.nRow) * chan;
+                const size_t polStride = size_t(ctx.nRow) * ctx.nChan;
+                casa::Complex origNoise[4];
+                for (casa::uInt k = 0; k < 4; ++k) {
+                     origNoise[k] = noise[k * polStride];
+                }
+                // propagating noise estimate through the matrix multiplication,
+                // element (i,k) of the inverse Mueller matrix is inv(J1)(i/2,k/2) conj(inv(J2)(i%2,k%2))
+                for (casa::uInt pol = 0; pol < 4; ++pol) {
+                     const casa::uInt index1 = ctx.indices[pol];
+                     float tempRe = 0., tempIm = 0.;
+                     for (casa::uInt k = 0; k < 4; ++k) {
+                          const casa::uInt index2 = ctx.indices[k];
+                          const casa::Complex reciprocal = a[(index1 / 2) * 2 + index2 / 2] * 
+                                    conj(b[(index1 % 2) * 2 + index2 % 2]);
+                          tempRe += casa::square(casa::real(reciprocal) * casa::real(origNoise[k])) + 
+                                    casa::square(casa::imag(reciprocal) * casa::imag(origNoise[k]));
+                          tempIm += casa::square(casa::real(reciprocal) * casa::imag(origNoise[k])) + 
+                                    casa::square(casa::imag(reciprocal) * casa::real(origNoise[k]));
+                     }
+                     noise[pol * polStride] = casa::Complex(sqrt(tempRe), sqrt(tempIm));
+                }
+            }
+       }
+  }
+}
+
 /// @brief determines whether to scale the noise estimate
 /// @details This is one of the configuration methods, it controlls
 /// whether the noise estimate is scaled aggording to applied calibration
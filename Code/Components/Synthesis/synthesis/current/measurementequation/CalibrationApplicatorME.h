@@ -42,10 +42,20 @@
 #include <calibaccess/ICalSolutionConstAccessor.h>
 #include <measurementequation/CalibrationSolutionHandler.h>
 #include <dataaccess/IDataAccessor.h>
+#include <utils/ChangeMonitor.h>
+
+// casa includes
+#include <casa/aips.h>
+#include <casa/BasicSL/Complex.h>
 
 // boost includes
 #include <boost/shared_ptr.hpp>
 
+// std includes
+#include <map>
+#include <utility>
+#include <vector>
+
 namespace askap {
 
 namespace synthesis {
@@ -59,6 +69,12 @@ namespace synthesis {
 /// (essentially implemented by the solution access class returning a complete
 /// jones matrix for each antenna/beam combination). This class handles time-dependence
 /// properly provided the solution source interface supports it as well.
+///
+/// Jones matrices and their inverses are cached per (antenna, beam, channel) until
+/// the solution accessor changes. If all four polarisation products are present,
+/// the correction is applied as inv(J1) V inv(J2)^H with a fixed-size 2x2 kernel
+/// and rows are distributed between threads of askap::TaskScheduler. Otherwise,
+/// the generic Mueller matrix inversion is used.
 /// @ingroup measurementequation
 class CalibrationApplicatorME : virtual public ICalibrationApplicator,
                                 protected CalibrationSolutionHandler {
@@ -99,6 +115,73 @@ public:
   virtual void beamIndependent(bool flag);
 
 private:
+  /// @brief cached jones matrix for one antenna, beam and channel
+  struct CachedJones {
+     /// @brief elements of the jones matrix in row-major order
+     casa::Complex jones[4];
+
+     /// @brief elements of the inverse matrix in row-major order (zeros if singular)
+     casa::Complex inverse[4];
+
+     /// @brief determinant of the jones matrix
+     casa::Complex det;
+  };
+
+  /// @brief data shared by the threads applying the correction
+  struct CorrectionContext {
+     /// @brief number of rows in the chunk
+     casa::uInt nRow;
+
+     /// @brief number of channels in the chunk
+     casa::uInt nChan;
+
+     /// @brief offset of each linear polarisation product (XX, XY, YX, YY order) in the cubes
+     size_t offsets[4];
+
+     /// @brief index of the linear polarisation product for each polarisation of the chunk
+     casa::uInt indices[4];
+
+     /// @brief antenna and beam indices of each row (for error messages)
+     const casa::Vector<casa::uInt> *antenna1;
+     const casa::Vector<casa::uInt> *antenna2;
+     const casa::Vector<casa::uInt> *beam1;
+     const casa::Vector<casa::uInt> *beam2;
+
+     /// @brief time of the chunk (for error messages)
+     double time;
+
+     /// @brief cached jones matrices (array over channels) for the first antenna of each row
+     std::vector<const CachedJones*> jones1;
+
+     /// @brief cached jones matrices (array over channels) for the second antenna of each row
+     std::vector<const CachedJones*> jones2;
+
+     /// @brief visibility cube
+     casa::Complex *vis;
+
+     /// @brief noise cube, zero if the noise is not to be scaled
+     casa::Complex *noise;
+
+     /// @brief flags for each (row, channel) which have to be set after the correction
+     std::vector<unsigned char> toFlag;
+  };
+
+  /// @brief obtain cached jones matrices for the given antenna and beam
+  /// @details The cache is extended if necessary. It is not thread-safe as
+  /// the solution accessor is used to fill it.
+  /// @param[in] ant antenna index
+  /// @param[in] beam beam index
+  /// @param[in] nChan number of channels required
+  /// @return reference to the vector with at least nChan elements
+  const std::vector<CachedJones>& cachedJones(casa::uInt ant, casa::uInt beam, casa::uInt nChan) const;
+
+  /// @brief apply the correction to the given range of rows
+  /// @details This method is called for all four polarisation products only.
+  /// @param[in] ctx data shared by all threads
+  /// @param[in] begin first row
+  /// @param[in] end row past the last one
+  void correctRows(CorrectionContext &ctx, size_t begin, size_t end) const;
+
   /// @brief true, if correct method is to scale the noise estimate
   bool itsScaleNoise;
   
@@ -107,6 +190,12 @@ private:
   
   /// @brief true, if beam index should be ignored and beam=0 corrections applied to all beams
   bool itsBeamIndependent;
+
+  /// @brief cached jones matrices indexed by (antenna, beam), vectors run over channels
+  mutable std::map<std::pair<casa::uInt, casa::uInt>, std::vector<CachedJones> > itsJonesCache;
+
+  /// @brief change monitor of the solution accessor the cache corresponds to
+  mutable scimath::ChangeMonitor itsCacheChangeMonitor;
 };
 
 } // namespace synthesis
@@ -53,6 +53,7 @@
 #include <dataaccess/IConstDataAccessor.h>
 #include <fitting/ComplexDiffMatrix.h>
 #include <fitting/ComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 #include <measurementequation/CalibrationMEBase.h>
 #include <measurementequation/PreAvgCalMEBase.h>
 
@@ -148,6 +149,21 @@ protected:
                     casa::uInt row) const
       {   return itsEffect.get(acc,row); }
 
+  /// @brief a helper method to form an integer-indexed matrix for a given row and channel
+  /// @details This method overrides the pure virtual method of PreAvgCalMEBase. It is
+  /// deliberately declared without the virtual keyword, so for CalibrationMEBase (which 
+  /// doesn't have such method) it is just an ordinary member and is not compiled unless
+  /// used. This way effects without the getFixed method can still be used with 
+  /// CalibrationMEBase.
+  /// @param[in] acc input data accessor with the perfect visibilities
+  /// @param[in] row the row number to work with
+  /// @param[in] chan the channel number to work with
+  /// @return FixedComplexDiffMatrix encapsulating information about measurement 
+  ///         equation corresponding to the given row and channel
+  scimath::FixedComplexDiffMatrix<8> buildFixedComplexDiffMatrix(const accessors::IConstDataAccessor &acc,
+                    casa::uInt row, casa::uInt chan) const
+      {   return itsEffect.template getFixed<8>(acc,row,chan); }
+
   /// @brief check whether the measurement equation is frequency-dependent
   /// @details For frequency-dependent effects the buildComplexDiffMatrix method returns block matrix with 
   /// one block corresponding to every channel (i.e. the size is nPol x nPol*nChannel 
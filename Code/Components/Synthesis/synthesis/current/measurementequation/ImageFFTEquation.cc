@@ -26,6 +26,8 @@
 ASKAP_LOGGER(logger, ".measurementequation.imagefftequation");
 
 #include <askap/AskapError.h>
+#include <askap/TaskScheduler.h>
+#include <askap/CasaTableLock.h>
 //#include <fft/FFTWrapper.h>
 
 #include <dataaccess/SharedIter.h>
@@ -51,6 +53,9 @@ ASKAP_LOGGER(logger, ".measurementequation.imagefftequation");
 
 #include <stdexcept>
 
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
 using askap::scimath::Params;
 using askap::scimath::Axes;
 using askap::scimath::ImagingNormalEquations;
@@ -64,7 +69,8 @@ namespace askap
 
     ImageFFTEquation::ImageFFTEquation(const askap::scimath::Params& ip,
         IDataSharedIter& idi) : scimath::Equation(ip),
-      askap::scimath::ImagingEquation(ip), itsIdi(idi), itsSphFuncPSFGridder(false)
+      askap::scimath::ImagingEquation(ip), itsIdi(idi), itsSphFuncPSFGridder(false),
+      itsUVWCacheSize(1), itsUVWCacheTolerance(1e-6)
     {
       itsGridder = IVisGridder::ShPtr(new SphFuncVisGridder());
       init();
@@ -72,7 +78,8 @@ namespace askap
     
 
     ImageFFTEquation::ImageFFTEquation(IDataSharedIter& idi) :
-      itsIdi(idi), itsSphFuncPSFGridder(false)
+      itsIdi(idi), itsSphFuncPSFGridder(false),
+      itsUVWCacheSize(1), itsUVWCacheTolerance(1e-6)
     {
       itsGridder = IVisGridder::ShPtr(new SphFuncVisGridder());
       reference(defaultParameters().clone());
@@ -81,7 +88,8 @@ namespace askap
 
     ImageFFTEquation::ImageFFTEquation(const askap::scimath::Params& ip,
         IDataSharedIter& idi, IVisGridder::ShPtr gridder) : scimath::Equation(ip),
-      askap::scimath::ImagingEquation(ip), itsGridder(gridder), itsIdi(idi), itsSphFuncPSFGridder(false)
+      askap::scimath::ImagingEquation(ip), itsGridder(gridder), itsIdi(idi), itsSphFuncPSFGridder(false),
+      itsUVWCacheSize(1), itsUVWCacheTolerance(1e-6)
     {
       init();
     }
@@ -89,7 +97,8 @@ namespace askap
 
     ImageFFTEquation::ImageFFTEquation(IDataSharedIter& idi,
         IVisGridder::ShPtr gridder) :
-      itsGridder(gridder), itsIdi(idi), itsSphFuncPSFGridder(false)
+      itsGridder(gridder), itsIdi(idi), itsSphFuncPSFGridder(false),
+      itsUVWCacheSize(1), itsUVWCacheTolerance(1e-6)
     {
       reference(defaultParameters().clone());
       init();
@@ -139,6 +148,8 @@ namespace askap
         itsGridder = other.itsGridder;
         itsSphFuncPSFGridder = other.itsSphFuncPSFGridder;
         itsVisUpdateObject = other.itsVisUpdateObject;
+        itsUVWCacheSize = other.itsUVWCacheSize;
+        itsUVWCacheTolerance = other.itsUVWCacheTolerance;
       }
       return *this;
     }
@@ -166,6 +177,27 @@ namespace askap
       itsVisUpdateObject = obj;
     }
     
+    /// @brief configure uvw machine cache of the detached chunks
+    /// @details Chunks are copied from the iterator, so the uvw machine cache
+    /// configured for the data source is not used for them. 
+    /// @param[in] cacheSize a number of uvw machines in the cache (default is 1)
+    /// @param[in] tolerance pointing direction tolerance in radians, exceeding which leads 
+    /// to initialisation of a new UVW Machine
+    void ImageFFTEquation::setUVWMachineCache(size_t cacheSize, double tolerance)
+    {
+      itsUVWCacheSize = cacheSize;
+      itsUVWCacheTolerance = tolerance;
+    }
+    
+    /// @brief allocate a detached copy of a chunk
+    /// @details The copy is set up with the uvw machine cache configured for this equation.
+    /// @return shared pointer to an empty accessor
+    boost::shared_ptr<accessors::AveragedDataAccessor> ImageFFTEquation::newChunk() const
+    {
+      return boost::shared_ptr<accessors::AveragedDataAccessor>(
+                 new accessors::AveragedDataAccessor(itsUVWCacheSize, itsUVWCacheTolerance));
+    }
+    
     /// @brief helper method to verify whether a parameter had been changed 
     /// @details This method checks whether a particular parameter is tracked. If 
     /// yes, its change monitor is used to verify the status since the last call of
@@ -217,6 +249,17 @@ namespace askap
       }
       // Loop through degridding the data
       ASKAPLOG_DEBUG_STR(logger, "Starting to degrid model" );
+      bool streamed = false;
+      for (vector<string>::const_iterator it=completions.begin();it!=completions.end();it++) {
+           if (streamedWStack(itsModelGridders["image"+(*it)])) {
+               streamed = true;
+           }
+      }
+      if (streamed) {
+          predictStreamed(completions);
+          ASKAPLOG_DEBUG_STR(logger, "Finished degridding model" );
+          return;
+      }
       
       // report every 5000000 degridded rows into log in the debug mode
       #ifdef ASKAP_DEBUG
@@ -251,6 +294,149 @@ namespace askap
       }
       ASKAPLOG_DEBUG_STR(logger, "Finished degridding model" );
     };
+
+    /// @brief predict model visibilities with w-planes processed in batches
+    /// @details All data are kept in memory, so each batch of model planes is
+    /// filled only once. The data are then iterated again to write the result.
+    /// @param[in] completions image parameters to predict
+    void ImageFFTEquation::predictStreamed(const std::vector<std::string> &completions) const
+    {
+      std::vector<boost::shared_ptr<accessors::AveragedDataAccessor> > chunks;
+      std::vector<boost::shared_ptr<MemBufferDataAccessor> > buffers;
+      for (itsIdi.init();itsIdi.hasMore();itsIdi.next()) {
+           chunks.push_back(newChunk());
+           chunks.back()->assign(*itsIdi);
+           buffers.push_back(boost::shared_ptr<MemBufferDataAccessor>(new MemBufferDataAccessor(*chunks.back())));
+           buffers.back()->rwVisibility().set(0.0);
+           for (vector<string>::const_iterator it=completions.begin();it!=completions.end();it++) {
+                degridShared(itsModelGridders["image"+(*it)], buffers.back());
+           }
+      }
+      for (vector<string>::const_iterator it=completions.begin();it!=completions.end();it++) {
+           const boost::shared_ptr<WStackVisGridder> wsg = streamedWStack(itsModelGridders["image"+(*it)]);
+           if (wsg) {
+               wsg->flushDegrid();
+           }
+      }
+      size_t chunk = 0;
+      for (itsIdi.init();itsIdi.hasMore();itsIdi.next(),++chunk) {
+           ASKAPCHECK(chunk < buffers.size(), "The number of iterations has changed between passes over the data");
+           ASKAPDEBUGASSERT(buffers[chunk]->nRow() == itsIdi->nRow());
+           itsIdi->rwVisibility() = buffers[chunk]->visibility();
+      }
+      ASKAPCHECK(chunk == buffers.size(), "The number of iterations has changed between passes over the data");
+    }
+
+    /// @brief check whether the gridder processes w-planes in batches
+    /// @param[in] gridder gridder to check
+    /// @return the w-stacking gridder, if it is streamed, empty pointer otherwise
+    boost::shared_ptr<WStackVisGridder> ImageFFTEquation::streamedWStack(const IVisGridder::ShPtr &gridder)
+    {
+      const boost::shared_ptr<WStackVisGridder> wsg = boost::dynamic_pointer_cast<WStackVisGridder>(gridder);
+      if (wsg && wsg->isStreamed()) {
+          return wsg;
+      }
+      return boost::shared_ptr<WStackVisGridder>();
+    }
+
+    /// @brief degrid data kept by the caller
+    /// @details Streamed w-stacking gridders queue the data until flushDegrid,
+    /// other gridders degrid them straight away.
+    /// @param[in] gridder gridder to use
+    /// @param[in] acc data to degrid
+    void ImageFFTEquation::degridShared(const IVisGridder::ShPtr &gridder, 
+                                        const boost::shared_ptr<accessors::IDataAccessor> &acc)
+    {
+      const boost::shared_ptr<WStackVisGridder> wsg = streamedWStack(gridder);
+      if (wsg) {
+          wsg->degridShared(acc);
+      } else {
+          gridder->degrid(*acc);
+      }
+    }
+    
+    /// @brief read stage of the major cycle pipeline
+    /// @details The iterator is advanced (or rewound) and the current chunk is copied,
+    /// so the copy stays valid while the iterator moves on. The iterator reads tables and
+    /// may use measures, so this is done with the table lock held.
+    /// @param[in] it iterator to read from
+    /// @param[in] first if true, the iterator is rewound, otherwise it is advanced
+    /// @param[out] chunk detached copy of the current chunk
+    /// @param[out] valid set to false, if there are no more data
+    void ImageFFTEquation::readChunk(IDataSharedIter &it, const bool first, 
+                                     accessors::AveragedDataAccessor &chunk, bool &valid)
+    {
+      CasaTableLock lock;
+      if (first) {
+          it.init();
+      } else {
+          it.next();
+      }
+      valid = it.hasMore();
+      if (valid) {
+          chunk.assign(*it);
+      }
+    }
+
+    /// @brief rotate uvw's for all gridders in the calling thread
+    /// @details The rotated uvw's and delays are computed (using measures) and cached by the
+    /// chunk, so gridding (or degridding) only reads them. This is possible if all gridders have 
+    /// the same tangent point and image centre, as the chunk caches one rotation only.
+    /// @param[in] gridders gridders to rotate uvw's for
+    /// @param[in] acc chunk to work with
+    /// @return true, if the chunk can be gridded without using measures
+    bool ImageFFTEquation::rotateUVW(const std::vector<IVisGridder::ShPtr> &gridders, 
+                                     const accessors::IConstDataAccessor &acc)
+    {
+      bool shared = true;
+      boost::shared_ptr<TableVisGridder> first;
+      for (size_t i = 0; i<gridders.size(); ++i) {
+           const boost::shared_ptr<TableVisGridder> tvg = boost::dynamic_pointer_cast<TableVisGridder>(gridders[i]);
+           if (!tvg) {
+               shared = false;
+               continue;
+           }
+           if (!first) {
+               first = tvg;
+           } else if (!tvg->sameRotation(*first)) {
+               shared = false;
+           }
+      }
+      if (shared && first) {
+          first->rotateUVW(acc);
+      }
+      return shared;
+    }
+
+    /// @brief grid stage of the major cycle pipeline
+    /// @details Gridders are independent, so they run as separate tasks if the rotated uvw's
+    /// are cached by the chunk (see rotateUVW). Otherwise, they run one after another
+    /// in the calling thread. Streamed w-stacking gridders only reference the chunk, 
+    /// so it has to be kept until the grids are finalised.
+    /// @param[in] gridders residual and PSF gridders
+    /// @param[in] acc chunk with residual visibilities
+    /// @param[in] concurrent if true, the gridders run as separate tasks
+    void ImageFFTEquation::gridChunk(const std::vector<IVisGridder::ShPtr> &gridders, 
+                                     const boost::shared_ptr<accessors::IConstDataAccessor> &acc,
+                                     const bool concurrent)
+    {
+      TaskScheduler::TaskGroup gridTasks;
+      for (size_t i = 0; i<gridders.size(); ++i) {
+           const boost::shared_ptr<WStackVisGridder> wsg = streamedWStack(gridders[i]);
+           if (!concurrent) {
+               if (wsg) {
+                   wsg->gridShared(acc);
+               } else {
+                   gridders[i]->grid(*acc);
+               }
+           } else if (wsg) {
+               gridTasks.run(boost::bind(&WStackVisGridder::gridShared, wsg, acc), "grid");
+           } else {
+               gridTasks.run(boost::bind(&IVisGridder::grid, gridders[i], boost::ref(*acc)), "grid");
+           }
+      }
+      gridTasks.wait();
+    }
     
     /// @brief assign a different iterator
     /// @details This is a temporary method to assign a different iterator.
@@ -291,6 +477,12 @@ namespace askap
         if(itsPSFGridders.count(imageName)==0) {
           if (itsSphFuncPSFGridder) {
              boost::shared_ptr<SphFuncVisGridder> psfGridder(new SphFuncVisGridder);
+             // the PSF gridder has to use the same grid decomposition as the main one
+             const boost::shared_ptr<TableVisGridder> tvg =
+                   boost::dynamic_pointer_cast<TableVisGridder>(itsGridder);
+             if (tvg) {
+                 psfGridder->setGridSlabs(tvg->gridSlabs());
+             }
              itsPSFGridders[imageName] = psfGridder;
           } else {
              itsPSFGridders[imageName] = itsGridder->clone();
@@ -326,64 +518,174 @@ namespace askap
       if (itsVisUpdateObject) {
           itsVisUpdateObject->aggregateFlag(somethingHasToBeDegridded);
       }      
-      // Now we loop through all the data
+      // Gridders are looked up here, as the maps must not be modified concurrently.
+      std::vector<IVisGridder::ShPtr> degridders;
+      std::vector<IVisGridder::ShPtr> gridders;
+      for (vector<string>::const_iterator it=completions.begin();it!=completions.end();++it) {
+           const std::string imageName("image"+(*it));
+           const std::map<std::string, IVisGridder::ShPtr>::iterator grdIt = itsModelGridders.find(imageName);
+           ASKAPDEBUGASSERT(grdIt != itsModelGridders.end());
+           ASKAPDEBUGASSERT(grdIt->second);
+           if (somethingHasToBeDegridded && !grdIt->second->isModelEmpty()) {
+               degridders.push_back(grdIt->second);
+           }
+           if (parameters().isFree(imageName)) {
+               gridders.push_back(itsResidualGridders[imageName]);
+               gridders.push_back(itsPSFGridders[imageName]);
+           }
+      }
+      const size_t nFreeImages = gridders.size() / 2;
+
+      // Streamed w-stacking gridders keep references to the data, which are therefore
+      // not reused and are held until the grids are finalised. Streamed degridders need
+      // all the data before any model visibility is complete.
+      bool streamedGrid = false;
+      for (size_t i = 0; i<gridders.size(); ++i) {
+           if (streamedWStack(gridders[i])) {
+               streamedGrid = true;
+           }
+      }
+      bool streamedDegrid = false;
+      for (size_t i = 0; i<degridders.size(); ++i) {
+           if (streamedWStack(degridders[i])) {
+               streamedDegrid = true;
+           }
+      }
+      std::vector<boost::shared_ptr<accessors::AveragedDataAccessor> > retainedChunks;
+
       ASKAPLOG_DEBUG_STR(logger, "Starting degridding model and gridding residuals" );
       size_t counterGrid = 0, counterDegrid = 0;
-      for (itsIdi.init();itsIdi.hasMore();itsIdi.next())
-      {
-        // buffer-accessor, used as a replacement for proper buffers held in the subtable
-        // effectively, an array with the same shape as the visibility cube is held by this class
-        MemBufferDataAccessor accBuffer(*itsIdi);
-         
-        // Accumulate model visibility for all models
-        accBuffer.rwVisibility().set(0.0);
-        if (somethingHasToBeDegridded) {
-            for (vector<string>::const_iterator it=completions.begin();it!=completions.end();++it) {
-                 const std::string imageName("image"+(*it));
-                 const std::map<std::string, IVisGridder::ShPtr>::iterator grdIt = itsModelGridders.find(imageName);
-                 ASKAPDEBUGASSERT(grdIt != itsModelGridders.end());
-                 const IVisGridder::ShPtr degridder = grdIt->second;
-                 ASKAPDEBUGASSERT(degridder);
-                 if (!degridder->isModelEmpty()) {
-                     degridder->degrid(accBuffer);
-                     counterDegrid+=accBuffer.nRow();
+      if (streamedDegrid) {
+          // each batch of model planes is filled once for all the data, so the data are
+          // read and queued for degridding first and the residuals are gridded afterwards
+          ASKAPLOG_DEBUG_STR(logger, "Model planes are processed in batches, all data are kept in memory");
+          std::vector<boost::shared_ptr<MemBufferDataAccessor> > buffers;
+          for (itsIdi.init(); itsIdi.hasMore(); itsIdi.next()) {
+               retainedChunks.push_back(newChunk());
+               retainedChunks.back()->assign(*itsIdi);
+               buffers.push_back(boost::shared_ptr<MemBufferDataAccessor>(
+                                 new MemBufferDataAccessor(*retainedChunks.back())));
+               buffers.back()->rwVisibility().set(0.0);
+               for (size_t i = 0; i<degridders.size(); ++i) {
+                    degridShared(degridders[i], buffers.back());
+                    counterDegrid += buffers.back()->nRow();
+               }
+          }
+          for (size_t i = 0; i<degridders.size(); ++i) {
+               const boost::shared_ptr<WStackVisGridder> wsg = streamedWStack(degridders[i]);
+               if (wsg) {
+                   wsg->flushDegrid();
+               }
+          }
+          TaskScheduler::TaskGroup gridStage;
+          for (size_t chunk = 0; chunk < buffers.size(); ++chunk) {
+               MemBufferDataAccessor &accBuffer = *buffers[chunk];
+               // optional aggregation of visibilities in the case of distributed model, done in order
+               if (itsVisUpdateObject) {
+                   itsVisUpdateObject->update(accBuffer.rwVisibility());
+               }
+               accBuffer.rwVisibility() -= retainedChunks[chunk]->visibility();
+               accBuffer.rwVisibility() *= float(-1.);
+               const bool concurrent = rotateUVW(gridders, accBuffer);
+               gridStage.wait();
+               if (!streamedGrid && (chunk > 0)) {
+                   // the previous chunk has been gridded and is not needed any more
+                   buffers[chunk - 1].reset();
+                   retainedChunks[chunk - 1].reset();
+               }
+               if (concurrent) {
+                   gridStage.run(boost::bind(&ImageFFTEquation::gridChunk, boost::cref(gridders),
+                                 boost::shared_ptr<accessors::IConstDataAccessor>(buffers[chunk]), true), "gridchunk");
+               } else {
+                   gridChunk(gridders, buffers[chunk], false);
+               }
+               counterGrid += nFreeImages * accBuffer.nRow();
+          }
+          gridStage.wait();
+      } else {
+          // Now we loop through all the data. The major cycle is pipelined: while the current chunk
+          // is degridded, the next one is read and the previous one is gridded. Each stage works on
+          // its own detached copy of the data and the stages are connected by queues of length one,
+          // so at most three chunks are held in memory (unless streamed gridders keep them). 
+          // Degridding and the aggregation of visibilities (a collective operation in the distributed
+          // case) stay in the calling thread and process chunks in order. Casacore tables and measures
+          // are not thread-safe, so the read stage and the uvw rotation (see rotateUVW) hold the table
+          // lock. Gridding and degridding proper only read the rotated uvw's cached by the chunk.
+          const size_t nSlots = 3;
+          std::vector<boost::shared_ptr<accessors::AveragedDataAccessor> > chunks(nSlots);
+          // buffer-accessors, used as a replacement for proper buffers held in the subtable
+          // effectively, an array with the same shape as the visibility cube is held by this class
+          std::vector<boost::shared_ptr<MemBufferDataAccessor> > buffers(nSlots);
+          bool valid[nSlots] = {false, false, false};
+          for (size_t slot = 0; slot < nSlots; ++slot) {
+               chunks[slot] = newChunk();
+          }
+          {
+            TaskScheduler::TaskGroup readStage;
+            TaskScheduler::TaskGroup gridStage;
+            readStage.run(boost::bind(&ImageFFTEquation::readChunk, boost::ref(itsIdi), true,
+                          boost::ref(*chunks[0]), boost::ref(valid[0])), "read");
+            for (size_t chunk = 0; ; ++chunk) {
+                 const size_t current = chunk % nSlots;
+                 readStage.wait();
+                 if (!valid[current]) {
+                     break;
                  }
+                 // prefetch the next chunk, the chunk held in this slot before has already been gridded
+                 // or is kept by streamed gridders
+                 const size_t next = (chunk + 1) % nSlots;
+                 if (streamedGrid) {
+                     retainedChunks.push_back(chunks[current]);
+                     chunks[next] = newChunk();
+                 }
+                 readStage.run(boost::bind(&ImageFFTEquation::readChunk, boost::ref(itsIdi), false,
+                               boost::ref(*chunks[next]), boost::ref(valid[next])), "read");
+
+                 buffers[current].reset(new MemBufferDataAccessor(*chunks[current]));
+                 MemBufferDataAccessor &accBuffer = *buffers[current];
+             
+                 // Accumulate model visibility for all models
+                 accBuffer.rwVisibility().set(0.0);
+                 if (somethingHasToBeDegridded) {
+                     // degridders which can't share the rotated uvw's use measures, so they
+                     // run with the table lock held (i.e. not overlapped with reading)
+                     boost::unique_lock<boost::mutex> lock(CasaTableLock::mutex());
+                     if (rotateUVW(degridders, accBuffer)) {
+                         lock.unlock();
+                     }
+                     for (size_t i = 0; i<degridders.size(); ++i) {
+                          degridders[i]->degrid(accBuffer);
+                          counterDegrid+=accBuffer.nRow();
+                     }
+                     if (lock.owns_lock()) {
+                         lock.unlock();
+                     }
+                     // optional aggregation of visibilities in the case of distributed model        
+                     // somethingHasToBeDegridded is supposed to have consistent value across all participating ranks
+                     if (itsVisUpdateObject) {
+                         itsVisUpdateObject->update(accBuffer.rwVisibility());
+                     }
+                     //            
+                 }
+                 accBuffer.rwVisibility() -= chunks[current]->visibility();
+                 accBuffer.rwVisibility() *= float(-1.);
+
+                 /// Now we can calculate the residual visibility and image. Gridders are not thread-safe,
+                 /// so the previous chunk has to be finished first.
+                 gridStage.wait();
+                 boost::unique_lock<boost::mutex> lock(CasaTableLock::mutex());
+                 const bool concurrent = rotateUVW(gridders, accBuffer);
+                 if (concurrent) {
+                     lock.unlock();
+                     gridStage.run(boost::bind(&ImageFFTEquation::gridChunk, boost::cref(gridders),
+                                   boost::shared_ptr<accessors::IConstDataAccessor>(buffers[current]), true), "gridchunk");
+                 } else {
+                     gridChunk(gridders, buffers[current], false);
+                 }
+                 counterGrid += nFreeImages * accBuffer.nRow();
             }
-            // optional aggregation of visibilities in the case of distributed model        
-            // somethingHasToBeDegridded is supposed to have consistent value across all participating ranks
-            if (itsVisUpdateObject) {
-                itsVisUpdateObject->update(accBuffer.rwVisibility());
-            }
-            //            
-        }
-        accBuffer.rwVisibility() -= itsIdi->visibility();
-        accBuffer.rwVisibility() *= float(-1.);
-
-        /// Now we can calculate the residual visibility and image
-        size_t tempCounter = 0; 
-#ifdef _OPENMP
-        #pragma omp parallel default(shared)
-        {
-           #pragma omp for reduction(+:tempCounter)
-#endif
-           for (size_t i = 0; i<completions.size(); ++i) {
-                const string imageName("image"+completions[i]);
-                if (parameters().isFree(imageName)) {
-                    #ifdef _OPENMP
-                    #pragma omp task
-                    #endif
-                    itsResidualGridders[imageName]->grid(accBuffer);
-                    #ifdef _OPENMP
-                    #pragma omp task
-                    #endif
-                    itsPSFGridders[imageName]->grid(accBuffer);
-                    tempCounter += accBuffer.nRow();
-                }
-           }
-#ifdef _OPENMP
-        }
-#endif
-        counterGrid += tempCounter;
+            gridStage.wait();
+          }
       }
       ASKAPLOG_DEBUG_STR(logger, "Finished degridding model and gridding residuals" );
       ASKAPLOG_DEBUG_STR(logger, "Number of accessor rows iterated through is "<<counterGrid<<" (gridding) and "<<
@@ -35,8 +35,10 @@
 #include <utils/ChangeMonitor.h>
 
 #include <gridding/IVisGridder.h>
+#include <gridding/WStackVisGridder.h>
 #include <dataaccess/SharedIter.h>
 #include <dataaccess/IDataIterator.h>
+#include <dataaccess/AveragedDataAccessor.h>
 #include <measurementequation/IVisCubeUpdate.h>
 
 #include <casa/aips.h>
@@ -46,6 +48,7 @@
 #include <casa/Arrays/Cube.h>
 
 #include <map>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -135,6 +138,14 @@ namespace askap
         /// @param[in] obj new object function (or an empty shared pointer to turn this option off)
         void setVisUpdateObject(const boost::shared_ptr<IVisCubeUpdate> &obj);
         
+        /// @brief configure uvw machine cache of the detached chunks
+        /// @details Chunks are copied from the iterator, so the uvw machine cache
+        /// configured for the data source is not used for them. 
+        /// @param[in] cacheSize a number of uvw machines in the cache (default is 1)
+        /// @param[in] tolerance pointing direction tolerance in radians, exceeding which leads 
+        /// to initialisation of a new UVW Machine
+        void setUVWMachineCache(size_t cacheSize, double tolerance);
+        
       private:
       
       /// Pointer to prototype gridder
@@ -168,6 +179,63 @@ namespace askap
         bool notYetDegridded(const std::string &name) const;
         
         void init();
+
+        /// @brief allocate a detached copy of a chunk
+        /// @details The copy is set up with the uvw machine cache configured for this equation.
+        /// @return shared pointer to an empty accessor
+        boost::shared_ptr<accessors::AveragedDataAccessor> newChunk() const;
+
+        /// @brief read stage of the major cycle pipeline
+        /// @details The iterator is advanced (or rewound) and the current chunk is copied,
+        /// so the copy stays valid while the iterator moves on. The iterator reads tables and
+        /// may use measures, so this is done with the table lock held.
+        /// @param[in] it iterator to read from
+        /// @param[in] first if true, the iterator is rewound, otherwise it is advanced
+        /// @param[out] chunk detached copy of the current chunk
+        /// @param[out] valid set to false, if there are no more data
+        static void readChunk(accessors::IDataSharedIter &it, const bool first, 
+                              accessors::AveragedDataAccessor &chunk, bool &valid);
+
+        /// @brief rotate uvw's for all gridders in the calling thread
+        /// @details The rotated uvw's and delays are computed (using measures) and cached by the
+        /// chunk, so gridding (or degridding) only reads them. This is possible if all gridders have 
+        /// the same tangent point and image centre, as the chunk caches one rotation only.
+        /// @param[in] gridders gridders to rotate uvw's for
+        /// @param[in] acc chunk to work with
+        /// @return true, if the chunk can be gridded without using measures
+        static bool rotateUVW(const std::vector<IVisGridder::ShPtr> &gridders, 
+                              const accessors::IConstDataAccessor &acc);
+
+        /// @brief grid stage of the major cycle pipeline
+        /// @details Gridders are independent, so they run as separate tasks if the rotated uvw's
+        /// are cached by the chunk (see rotateUVW). Otherwise, they run one after another
+        /// in the calling thread. Streamed w-stacking gridders only reference the chunk, 
+        /// so it has to be kept until the grids are finalised.
+        /// @param[in] gridders residual and PSF gridders
+        /// @param[in] acc chunk with residual visibilities
+        /// @param[in] concurrent if true, the gridders run as separate tasks
+        static void gridChunk(const std::vector<IVisGridder::ShPtr> &gridders, 
+                              const boost::shared_ptr<accessors::IConstDataAccessor> &acc,
+                              const bool concurrent);
+
+        /// @brief predict model visibilities with w-planes processed in batches
+        /// @details All data are kept in memory, so each batch of model planes is
+        /// filled only once. The data are then iterated again to write the result.
+        /// @param[in] completions image parameters to predict
+        void predictStreamed(const std::vector<std::string> &completions) const;
+
+        /// @brief check whether the gridder processes w-planes in batches
+        /// @param[in] gridder gridder to check
+        /// @return the w-stacking gridder, if it is streamed, empty pointer otherwise
+        static boost::shared_ptr<WStackVisGridder> streamedWStack(const IVisGridder::ShPtr &gridder);
+
+        /// @brief degrid data kept by the caller
+        /// @details Streamed w-stacking gridders queue the data until flushDegrid,
+        /// other gridders degrid them straight away.
+        /// @param[in] gridder gridder to use
+        /// @param[in] acc data to degrid
+        static void degridShared(const IVisGridder::ShPtr &gridder, 
+                                 const boost::shared_ptr<accessors::IDataAccessor> &acc);
         
         /// @brief true, if the PSF is built using the default spheroidal function gridder
         /// @details We have an option to build PSF using the default spheriodal function
@@ -182,6 +250,12 @@ namespace askap
         /// equation and the MPI one can use polymorphic object function to sum degridded visibilities 
         /// across all required ranks in the distributed case and do nothing otherwise.
         boost::shared_ptr<IVisCubeUpdate> itsVisUpdateObject;
+        
+        /// @brief number of uvw machines cached by detached chunks
+        size_t itsUVWCacheSize;
+        
+        /// @brief pointing direction tolerance (in radians) of the uvw machine cache of detached chunks
+        double itsUVWCacheTolerance;
     };
 
   }
@@ -115,6 +115,83 @@ inline scimath::ComplexDiffMatrix LeakageTerm::get(const accessors::IConstDataAc
    return calFactor;
 }
 
+/// @brief integer-indexed Mueller matrix and derivatives
+/// @details This is the counterpart of the get method for the pre-averaged normal
+/// equations. Parameter names are resolved into indices once for the matrix, so
+/// the normal equations are built without searching parameter maps.
+/// @param[in] chunk accessor to work with
+/// @param[in] row row of the chunk to work with
+/// @param[in] chan channel to work with (ignored, the effect is frequency-independent)
+/// @return FixedComplexDiffMatrix filled with Mueller matrix corresponding to
+/// this effect (nPol x nPol)
+template<size_t N>
+inline scimath::FixedComplexDiffMatrix<N> LeakageTerm::getFixed(const accessors::IConstDataAccessor &chunk, 
+                                      casa::uInt row, casa::uInt) const
+{
+   const casa::uInt nPol = chunk.nPol();
+   ASKAPDEBUGASSERT(nPol != 0);   
+   const casa::Vector<casa::Stokes::StokesTypes> stokes = chunk.stokes();   
+   ASKAPDEBUGASSERT(stokes.nelements() == nPol);
+   ASKAPDEBUGASSERT(!scimath::PolConverter::isStokes(stokes));
+   
+   const casa::uInt ant1 = chunk.antenna1()[row];
+   const casa::uInt ant2 = chunk.antenna2()[row];
+   
+   const casa::uInt beam1 = chunk.feed1()[row];
+   const casa::uInt beam2 = chunk.feed2()[row];
+  
+   // main diagonal is always 1.
+   scimath::FixedComplexDiffMatrix<N> calFactor(4, 4);
+   for (casa::uInt pol=0; pol<4; ++pol) {
+        calFactor(pol, pol) = scimath::FixedComplexDiff<N>(1.);
+   }
+   
+   // leakages are resolved into indices once
+   const scimath::FixedComplexDiff<N> d12ant1 = getParameter(accessors::CalParamNameHelper::paramName(ant1, beam1, casa::Stokes::XY), calFactor);
+   const scimath::FixedComplexDiff<N> d21ant1 = getParameter(accessors::CalParamNameHelper::paramName(ant1, beam1, casa::Stokes::YX), calFactor);
+   const scimath::FixedComplexDiff<N> d12ant2 = conj(getParameter(accessors::CalParamNameHelper::paramName(ant2, beam2, casa::Stokes::XY), calFactor));
+   const scimath::FixedComplexDiff<N> d21ant2 = conj(getParameter(accessors::CalParamNameHelper::paramName(ant2, beam2, casa::Stokes::YX), calFactor));
+   const scimath::FixedComplexDiff<N> minusOne(-1.);
+   
+   // flag showing that the polarisation products are present
+   // in the canonic form (e.g. XX,XY,YX,YY for linears)
+   bool canonicPolOrder = (nPol == 4);
+   
+   calFactor(3, 1) = minusOne * d21ant1;
+   calFactor(1, 3) = d12ant1;
+   
+   calFactor(3, 2) = minusOne * d21ant2;
+   calFactor(2, 3) = d12ant2;
+   
+   for (casa::uInt pol=0; pol<4; ++pol) {
+        
+        if (pol<nPol) {
+            const casa::uInt polIndex = scimath::PolConverter::getIndex(stokes[pol]);
+            ASKAPDEBUGASSERT(polIndex<4);
+            // polIndex is index in the polarisation frame, i.e.
+            // XX is 0, XY is 1, YX is 2 and YY is 3
+            // we need an index into matrix 
+            if (polIndex != pol) {
+                canonicPolOrder = false;
+            }
+        } else {
+              canonicPolOrder = false;
+        }
+
+        // cross-diagonal terms                   
+        calFactor(pol, 3 - pol) = (pol % 3 == 0 ? scimath::FixedComplexDiff<N>(1.) : minusOne) *
+                            (pol < 2 ? d12ant1 : d21ant1) * (pol % 2 == 0 ? d12ant2 : d21ant2);
+        if (pol % 3 != 0) {
+            // middle rows and columns of the 4x4 matrix (index is 0-based)
+            // exploit the symmetries
+            calFactor(0, pol) = calFactor(3 - pol, 3);
+            calFactor(pol,0) = calFactor(3, 3 - pol);            
+        }
+   }
+   ASKAPCHECK(canonicPolOrder, "Only canonic order of polarisation products (e.g. XX,XY,YX,YY) is currently supported");
+   return calFactor;
+}
+
 } // namespace synthesis
 
 } // namespace askap
@@ -34,6 +34,7 @@
 // own includes
 #include <fitting/ComplexDiffMatrix.h>
 #include <fitting/ComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 #include <fitting/Params.h>
 #include <dataaccess/IConstDataAccessor.h>
 #include <askap/AskapError.h>
@@ -69,6 +70,19 @@ struct NoXPolBeamIndependentGain : public ParameterizedMEComponent<false> {
    /// this effect
    inline scimath::ComplexDiffMatrix get(const accessors::IConstDataAccessor &chunk, 
                                 casa::uInt row) const;   
+
+   /// @brief integer-indexed Mueller matrix and derivatives
+   /// @details This is the counterpart of the get method for the pre-averaged normal
+   /// equations. Parameter names are resolved into indices once for the matrix, so
+   /// the normal equations are built without searching parameter maps.
+   /// @param[in] chunk accessor to work with
+   /// @param[in] row row of the chunk to work with
+   /// @param[in] chan channel to work with (ignored, the effect is frequency-independent)
+   /// @return FixedComplexDiffMatrix filled with Mueller matrix corresponding to
+   /// this effect (nPol x nPol)
+   template<size_t N>
+   inline scimath::FixedComplexDiffMatrix<N> getFixed(const accessors::IConstDataAccessor &chunk, 
+                                casa::uInt row, casa::uInt chan) const;
 };
 
 } // namespace synthesis
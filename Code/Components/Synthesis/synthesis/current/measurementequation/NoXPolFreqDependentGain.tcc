@@ -101,6 +101,54 @@ inline scimath::ComplexDiffMatrix NoXPolFreqDependentGain::get(const accessors::
    return calFactor;
 }
 
+/// @brief integer-indexed Mueller matrix and derivatives
+/// @details This is the counterpart of the get method for the pre-averaged normal
+/// equations. Parameter names are resolved into indices once for the matrix, so
+/// the normal equations are built without searching parameter maps.
+/// @param[in] chunk accessor to work with
+/// @param[in] row row of the chunk to work with
+/// @param[in] chan channel to work with
+/// @return FixedComplexDiffMatrix filled with Mueller matrix corresponding to
+/// this effect (nPol x nPol)
+template<size_t N>
+inline scimath::FixedComplexDiffMatrix<N> NoXPolFreqDependentGain::getFixed(const accessors::IConstDataAccessor &chunk, 
+                                      casa::uInt row, casa::uInt chan) const
+{
+   const casa::uInt chanOffset = static_cast<casa::uInt>(parameters()->has("chan_offset") ? parameters()->scalarValue("chan_offset") : 0);
+   const casa::uInt nPol = chunk.nPol();
+   ASKAPDEBUGASSERT(nPol != 0);   
+   ASKAPDEBUGASSERT(chan < chunk.nChannel());
+   const casa::Vector<casa::Stokes::StokesTypes> stokes = chunk.stokes();   
+   ASKAPDEBUGASSERT(stokes.nelements() == nPol);
+   ASKAPDEBUGASSERT(!scimath::PolConverter::isStokes(stokes));
+   
+   const casa::uInt ant1 = chunk.antenna1()[row];
+   const casa::uInt ant2 = chunk.antenna2()[row];
+   
+   const casa::uInt beam1 = chunk.feed1()[row];
+   const casa::uInt beam2 = chunk.feed2()[row];
+   
+   // only the block of the given channel is formed
+   scimath::FixedComplexDiffMatrix<N> calFactor(nPol, nPol);
+
+   for (casa::uInt pol=0; pol<nPol; ++pol) {
+        
+        const casa::uInt polIndex = scimath::PolConverter::getIndex(stokes[pol]);
+
+        // gains for antenna 1, polarisation X if XX or XY, or Y if YX or YY
+        const std::string g1name = accessors::CalParamNameHelper::paramName(ant1, beam1, 
+                      polIndex / 2 == 0 ? casa::Stokes::XX : casa::Stokes::YY, true);
+            
+        // gains for antenna 2, polarisation X if XX or YX, or Y if XY or YY
+        const std::string g2name = accessors::CalParamNameHelper::paramName(ant2, beam2, 
+                      polIndex % 2 == 0 ? casa::Stokes::XX : casa::Stokes::YY, true);
+                                                      
+        calFactor(pol, pol) = getParameter(accessors::CalParamNameHelper::addChannelInfo(g1name,chan+chanOffset), calFactor) *
+                   conj(getParameter(accessors::CalParamNameHelper::addChannelInfo(g2name,chan+chanOffset), calFactor));
+   }
+   return calFactor;
+}
+
 } // namespace synthesis
 
 } // namespace askap
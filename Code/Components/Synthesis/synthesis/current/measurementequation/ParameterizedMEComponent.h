@@ -39,6 +39,7 @@
 #include <fitting/Params.h>
 #include <measurementequation/MEComponent.h>
 #include <fitting/ComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 #include <askap/AskapError.h>
 
 
@@ -70,6 +71,17 @@ protected:
    /// @param[in] name parameter name
    /// @return value of the parameter wrapped in a complex diff object
    inline scimath::ComplexDiff getParameter(const std::string &name) const;
+
+   /// @brief obtain a value of the parameter for an integer-indexed matrix
+   /// @details This helper method resolves the name into an index of the given
+   /// matrix and returns the parameter wrapped around in a FixedComplexDiff class.
+   /// An exception is thrown if the parameter is not defined.
+   /// @param[in] name parameter name
+   /// @param[in] cdm matrix the parameter is used in
+   /// @return value of the parameter wrapped in a fixed complex diff object
+   template<size_t N>
+   inline scimath::FixedComplexDiff<N> getParameter(const std::string &name, 
+                                        scimath::FixedComplexDiffMatrix<N> &cdm) const;
    
 private:
    /// @brief shared pointer to paramters
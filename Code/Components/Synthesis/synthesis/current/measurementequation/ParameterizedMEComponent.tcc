@@ -53,6 +53,22 @@ inline scimath::ComplexDiff ParameterizedMEComponent<FDP>::getParameter(const st
    return scimath::ComplexDiff(name, gain);
 }
 
+/// @brief obtain a value of the parameter for an integer-indexed matrix
+/// @details This helper method resolves the name into an index of the given
+/// matrix and returns the parameter wrapped around in a FixedComplexDiff class.
+/// An exception is thrown if the parameter is not defined.
+/// @param[in] name parameter name
+/// @param[in] cdm matrix the parameter is used in
+/// @return value of the parameter wrapped in a fixed complex diff object
+template<bool FDP> template<size_t N>
+inline scimath::FixedComplexDiff<N> ParameterizedMEComponent<FDP>::getParameter(const std::string &name,
+                                    scimath::FixedComplexDiffMatrix<N> &cdm) const
+{
+   ASKAPDEBUGASSERT(parameters());
+   ASKAPCHECK(parameters()->has(name), "Parameter "<<name<<" is not defined in ParameterizedMEComponent::getParameter");
+   return cdm.parameter(name, parameters()->complexValue(name));
+}
+
 
 } // namespace synthesis
 
@@ -40,13 +40,18 @@
 #include <dataaccess/MemBufferDataAccessor.h>
 #include <utils/PolConverter.h>
 
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace askap;
 using namespace askap::synthesis;
 
 /// @brief default constructor
 /// @details preaveraging is initialised based on the first encountered accessor
-PreAvgCalBuffer::PreAvgCalBuffer() : itsPolXProducts(0), // set nPol = 0 for now as a proper initialisation is pending
+PreAvgCalBuffer::PreAvgCalBuffer() : itsIndexNAnt(0), itsIndexNBeam(0), itsPolXProducts(0), // set nPol = 0 for now as a proper initialisation is pending
     itsVisTypeIgnored(0), itsNoMatchIgnored(0), itsFlagIgnored(0), itsBeamIndependent(false) {}
    
 /// @brief constructor with explicit averaging parameters
@@ -56,7 +61,8 @@ PreAvgCalBuffer::PreAvgCalBuffer() : itsPolXProducts(0), // set nPol = 0 for now
 /// @param[in] nBeam number of beams, indices are expected to run from 0 to nBeam-1
 /// @param[in] nChan number of channels to buffer, 1 (default) is a special case
 /// assuming that measurement equation is frequency-independent
-PreAvgCalBuffer::PreAvgCalBuffer(casa::uInt nAnt, casa::uInt nBeam, casa::uInt nChan) : itsAntenna1(nBeam*nAnt*(nAnt-1)/2), 
+PreAvgCalBuffer::PreAvgCalBuffer(casa::uInt nAnt, casa::uInt nBeam, casa::uInt nChan) : itsIndexNAnt(0), itsIndexNBeam(0),
+      itsAntenna1(nBeam*nAnt*(nAnt-1)/2), 
       itsAntenna2(nBeam*nAnt*(nAnt-1)/2), itsBeam(nBeam*nAnt*(nAnt-1)/2), itsFlag(nBeam*nAnt*(nAnt-1)/2,casa::Int(nChan),4),
       // npol=4
       itsStokes(4), itsPolXProducts(4,casa::IPosition(2,int(nBeam*nAnt*(nAnt-1)/2),casa::Int(nChan))),
@@ -71,7 +77,7 @@ PreAvgCalBuffer::PreAvgCalBuffer(casa::uInt nAnt, casa::uInt nBeam, casa::uInt n
 /// explicitly given number of beams with nBeam set to 1, this constructor configures
 /// the buffer to ignore the beam index (i.e. assuming the measurement equation is beam-independent)
 /// @param[in] nAnt number of antennas, indices are expected to run from 0 to nAnt-1
-PreAvgCalBuffer::PreAvgCalBuffer(casa::uInt nAnt) : itsAntenna1(nAnt*(nAnt-1)/2), 
+PreAvgCalBuffer::PreAvgCalBuffer(casa::uInt nAnt) : itsIndexNAnt(0), itsIndexNBeam(0), itsAntenna1(nAnt*(nAnt-1)/2), 
       itsAntenna2(nAnt*(nAnt-1)/2), itsBeam(nAnt*(nAnt-1)/2), itsFlag(nAnt*(nAnt-1)/2,1,4),
       // npol=4
       itsStokes(4), itsPolXProducts(4,casa::IPosition(2,int(nAnt*(nAnt-1)/2),1)),
@@ -117,7 +123,8 @@ void PreAvgCalBuffer::initialise(const IConstDataAccessor &acc, const bool fdp)
   } else {
       itsBeam = acc.feed1();
   }
-  casa::uInt unusedBeamId = casa::max(itsBeam)*10;
+  const casa::uInt maxBeamId = casa::max(itsBeam);
+  casa::uInt unusedBeamId = maxBeamId*10;
   const casa::Vector<casa::uInt>& feed2 = acc.feed2();
   for (casa::uInt row=0; row<numberOfRows; ++row) {
        if ((itsBeam[row] != feed2[row]) || (itsBeamIndependent && (itsBeam[row] != 0))) {
@@ -126,6 +133,7 @@ void PreAvgCalBuffer::initialise(const IConstDataAccessor &acc, const bool fdp)
            itsBeam[row] = unusedBeamId;
        }
   }
+  buildRowIndex(maxBeamId + 1);
   itsStokes = acc.stokes();
   // all elements are flagged until at least something is averaged in
   itsFlag.set(true); 
@@ -172,6 +180,8 @@ void PreAvgCalBuffer::initialise(casa::uInt nAnt, casa::uInt nBeam, casa::uInt n
        }
   }
   
+  buildRowIndex(nBeam);
+  
   // we don't track polarisation at this stage leaving this up to the user of this class
   // just fill the vector with Linear Stokes
   for (casa::uInt pol = 0; pol<itsStokes.nelements(); ++pol) {
@@ -257,26 +267,48 @@ const casa::Vector<casa::Stokes::StokesTypes>& PreAvgCalBuffer::stokes() const
   return itsStokes;
 }
 
+/// @brief build the lookup table used by findMatch
+/// @details The table is indexed by (antenna1, antenna2, beam) and contains the
+/// buffer row for this combination of indices or -1 if there is no match. If more
+/// than one buffer row has the same indices, the first one is used.
+/// @param[in] nBeam number of beams to include into the table, buffer rows with
+/// beam index of nBeam or larger are never matched
+void PreAvgCalBuffer::buildRowIndex(casa::uInt nBeam)
+{
+  ASKAPDEBUGASSERT(itsAntenna1.nelements() == itsAntenna2.nelements());
+  ASKAPDEBUGASSERT(itsAntenna1.nelements() == itsBeam.nelements());
+  itsIndexNBeam = nBeam;
+  itsIndexNAnt = 0;
+  for (casa::uInt row=0; row<itsAntenna1.nelements(); ++row) {
+       if (itsBeam[row] < nBeam) {
+           itsIndexNAnt = std::max(itsIndexNAnt, std::max(itsAntenna1[row], itsAntenna2[row]) + 1);
+       }
+  }
+  itsRowIndex.assign(itsIndexNAnt * itsIndexNAnt * itsIndexNBeam, -1);
+  for (casa::uInt row=0; row<itsAntenna1.nelements(); ++row) {
+       if (itsBeam[row] < nBeam) {
+           int &entry = itsRowIndex[itsAntenna1[row] + itsIndexNAnt * (itsAntenna2[row] + itsIndexNAnt * itsBeam[row])];
+           if (entry < 0) {
+               entry = int(row);
+           }
+       }
+  }
+}
+
 /// @brief helper method to find a match row in the buffer
-/// @details It goes over antenna and beam indices and finds a buffer row which 
-/// corresponds to the given indices.
+/// @details It uses the lookup table to find a buffer row which corresponds to the given indices.
 /// @param[in] ant1 index of the first antenna
 /// @param[in] ant2 index of the second antenna
 /// @param[in] beam beam index
 /// @return row number in the buffer corresponding to the given (ant1,ant2,beam) or -1 if 
 /// there is no match
-int PreAvgCalBuffer::findMatch(casa::uInt ant1, casa::uInt ant2, casa::uInt beam)
+int PreAvgCalBuffer::findMatch(casa::uInt ant1, casa::uInt ant2, casa::uInt beam) const
 {
-  ASKAPDEBUGASSERT(itsAntenna1.nelements() == itsAntenna2.nelements());
-  ASKAPDEBUGASSERT(itsAntenna1.nelements() == itsBeam.nelements());
-  // we can probably implement a more clever search algorithm here because the 
-  // metadata are almost always ordered
-  for (casa::uInt row=0; row<itsAntenna1.nelements(); ++row) {
-       if ((itsAntenna1[row] == ant1) && (itsAntenna2[row] == ant2) && (itsBeam[row] == (itsBeamIndependent ? 0 : beam))) {
-           return int(row);
-       }
-  } 
-  return -1;
+  const casa::uInt matchBeam = itsBeamIndependent ? 0 : beam;
+  if ((ant1 >= itsIndexNAnt) || (ant2 >= itsIndexNAnt) || (matchBeam >= itsIndexNBeam)) {
+      return -1;
+  }
+  return itsRowIndex[ant1 + itsIndexNAnt * (ant2 + itsIndexNAnt * matchBeam)];
 }
 
 /// @brief process one accessor
@@ -314,8 +346,7 @@ void PreAvgCalBuffer::accumulate(const IConstDataAccessor &acc, const boost::sha
   ASKAPDEBUGASSERT(measuredFlag.nrow() == acc.nRow());
   ASKAPDEBUGASSERT(measuredFlag.ncolumn() == acc.nChannel());
   ASKAPDEBUGASSERT(measuredFlag.nplane() == acc.nPol());
-  const casa::uInt bufferNPol = nPol();
-  ASKAPDEBUGASSERT(bufferNPol == itsPolXProducts.nPol());
+  ASKAPDEBUGASSERT(nPol() == itsPolXProducts.nPol());
   ASKAPDEBUGASSERT(modelVis.shape() == measuredVis.shape());
   ASKAPDEBUGASSERT(modelVis.shape() == measuredNoise.shape());
   ASKAPDEBUGASSERT(modelVis.shape() == measuredFlag.shape());
@@ -329,6 +360,16 @@ void PreAvgCalBuffer::accumulate(const IConstDataAccessor &acc, const boost::sha
   
   ASKAPCHECK(fdp || (nChannel() == 1), 
      "Only single spectral channel is supported by the pre-averaging calibration buffer in the frequency-independent mode");
+
+  // match accessor rows to buffer rows and split them into groups of neighbouring buffer rows,
+  // so every group updates a disjoint part of the buffer
+  #ifdef _OPENMP
+  const casa::uInt nGroups = casa::uInt(omp_get_max_threads());
+  #else
+  const casa::uInt nGroups = 1;
+  #endif
+  std::vector<std::vector<casa::uInt> > groupRows(nGroups);
+  std::vector<casa::uInt> bufRows(acc.nRow(), 0);
   for (casa::uInt row = 0; row<acc.nRow(); ++row) {
        if ((beam1[row] != beam2[row]) || (antenna1[row] == antenna2[row])) {
            // cross-beam correlations and auto-correlations are not supported
@@ -344,63 +385,137 @@ void PreAvgCalBuffer::accumulate(const IConstDataAccessor &acc, const boost::sha
        }
        const casa::uInt bufRow = casa::uInt(matchRow);
        ASKAPDEBUGASSERT(bufRow < itsFlag.nrow());
-       // making a slice referenced to the full cross-product buffer
-       // in the frequency-independent mode do averaging of all frequency channels together
-       scimath::PolXProducts pxpSlice = itsPolXProducts.slice(bufRow,0);
-       // the code below works with this 1D slice
-       for (casa::uInt chan = 0; chan<acc.nChannel(); ++chan) {
-            const casa::uInt bufChan = fdp ? chan : 0;
-            if (fdp && (chan > 0)) {
-                // update the slice to point to the correct channel of the buffer
-                pxpSlice = itsPolXProducts.slice(bufRow,chan);
-            }
-            for (casa::uInt pol = 0; pol<acc.nPol(); ++pol) {
-                 // input visibility vector has indexed pol2, but most of the
-                 // gain should be for pol2=pol. So it makes sense to flag this
-                 // output visibility element if the corresponding input element
-                 // is flagged.
-                 // Note: if some of the input data are flagged it might be best
-                 //       to flagged the output. Depends on how much gain is in
-                 //       the off-diagonal terms.
-                 if ((pol < bufferNPol) && !measuredFlag(row,chan,pol)) {
-                     const casa::Complex model = modelVis(row,chan,pol);
-                     const float visNoise =
-                         casa::square(casa::real(measuredNoise(row,chan,pol)));
+       bufRows[row] = bufRow;
+       groupRows[size_t(bufRow) * nGroups / itsFlag.nrow()].push_back(row);
+  }
+
+  // raw access to the data, copies are only made if the cubes are not contiguous 
+  bool deleteVis, deleteModel, deleteNoise, deleteFlag;
+  const casa::Complex *measuredVisPtr = measuredVis.getStorage(deleteVis);
+  const casa::Complex *modelVisPtr = modelVis.getStorage(deleteModel);
+  const casa::Complex *measuredNoisePtr = measuredNoise.getStorage(deleteNoise);
+  const casa::Bool *measuredFlagPtr = measuredFlag.getStorage(deleteFlag);
+  const casa::IPosition shape = measuredVis.shape();
+
+  std::vector<casa::uInt> flagIgnored(nGroups, 0);
+  #ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic)
+  #endif
+  for (int group = 0; group < int(nGroups); ++group) {
+       flagIgnored[group] = accumulateRows(groupRows[group], bufRows, shape, measuredVisPtr, 
+                                           modelVisPtr, measuredNoisePtr, measuredFlagPtr, fdp);
+  }
+
+  measuredVis.freeStorage(measuredVisPtr, deleteVis);
+  modelVis.freeStorage(modelVisPtr, deleteModel);
+  measuredNoise.freeStorage(measuredNoisePtr, deleteNoise);
+  measuredFlag.freeStorage(measuredFlagPtr, deleteFlag);
+
+  for (casa::uInt group = 0; group < nGroups; ++group) {
+       itsFlagIgnored += flagIgnored[group];
+  }
+}
+
+/// @brief accumulate a group of accessor rows
+/// @details This is a helper method which does the actual summing for the given 
+/// rows of the accessor. Visibilities of each row are first rearranged so that spectral
+/// channels are contiguous for every polarisation which allows the compiler to vectorise
+/// the loops forming cross-products. It is safe to call this method concurrently 
+/// for groups which do not share any buffer row.
+/// @param[in] rows indices of the accessor rows to process
+/// @param[in] bufRows buffer row corresponding to each row of the accessor
+/// @param[in] shape shape of the accessor cubes (nRow, nChannel, nPol)
+/// @param[in] measuredVis pointer to the contiguous storage of measured visibilities
+/// @param[in] modelVis pointer to the contiguous storage of model visibilities
+/// @param[in] measuredNoise pointer to the contiguous storage of visibility noise
+/// @param[in] measuredFlag pointer to the contiguous storage of flags
+/// @param[in] fdp frequency dependency flag (see accumulate)
+/// @return number of visibilities ignored due to flags
+casa::uInt PreAvgCalBuffer::accumulateRows(const std::vector<casa::uInt> &rows, 
+           const std::vector<casa::uInt> &bufRows, const casa::IPosition &shape, 
+           const casa::Complex *measuredVis, const casa::Complex *modelVis, 
+           const casa::Complex *measuredNoise, const casa::Bool *measuredFlag, const bool fdp)
+{
+  const casa::uInt nAccRow = casa::uInt(shape(0));
+  const casa::uInt nChan = casa::uInt(shape(1));
+  const casa::uInt nAccPol = casa::uInt(shape(2));
+  const casa::uInt bufferNPol = nPol();
+  // cross-products are formed for polarisations present in both the accessor and the buffer
+  const casa::uInt nProdPol = std::min(nAccPol, bufferNPol);
+
+  // per row buffers, spectral channels are contiguous for each polarisation. Flagged
+  // samples are zeroed, so they don't contribute to the sums.
+  std::vector<casa::Complex> weightedModel(nAccPol * nChan);
+  std::vector<casa::Complex> model(nAccPol * nChan);
+  std::vector<casa::Complex> measured(nAccPol * nChan);
+  std::vector<unsigned char> valid(nAccPol * nChan);
+  // products for all pairs of polarisations, indexed by pol1 + bufferNPol * pol2 
+  std::vector<casa::Complex> modelProducts(bufferNPol * bufferNPol);
+  std::vector<casa::Complex> modelMeasProducts(bufferNPol * bufferNPol);
+
+  casa::uInt flagIgnored = 0;
+  for (std::vector<casa::uInt>::const_iterator ci = rows.begin(); ci != rows.end(); ++ci) {
+       const casa::uInt row = *ci;
+       const casa::uInt bufRow = bufRows[row];
+
+       for (casa::uInt pol = 0; pol<nAccPol; ++pol) {
+            for (casa::uInt chan = 0; chan<nChan; ++chan) {
+                 const size_t inIndex = size_t(row) + size_t(nAccRow) * (size_t(chan) + size_t(nChan) * pol);
+                 const casa::uInt index = pol * nChan + chan;
+                 const bool isValid = !measuredFlag[inIndex];
+                 valid[index] = (isValid && (pol < bufferNPol)) ? 1 : 0;
+                 model[index] = isValid ? modelVis[inIndex] : casa::Complex(0., 0.);
+                 measured[index] = isValid ? measuredVis[inIndex] : casa::Complex(0., 0.);
+                 if (valid[index] != 0) {
+                     // different polarisations can have different weight?
+                     // ignoring for now
+                     const float visNoise = casa::square(casa::real(measuredNoise[inIndex]));
                      const float weight = (visNoise > 0.) ? 1./visNoise : 0.;
-                     for (casa::uInt pol2 = 0; pol2<acc.nPol(); ++pol2) {
-                          // ignore this column if flagged
-                          if (measuredFlag(row,chan,pol2)) {
-                              continue;
-                          }
-                          /*
-                          // temporary hack
-                          if (((pol != 0) && (pol != 3)) ||
-                              ((pol2 != 0) && (pol2 != 3))) {
-                              continue;
-                          }
-                          //
-                          */
-                          // different polarisations can have different weight?
-                          // ignoring for now
-                          pxpSlice.addModelMeasProduct(pol,pol2,
-                              weight * std::conj(model) * measuredVis(row,chan,pol2));
-                          //pxpSlice.addModelMeasProduct(pol,pol2,weight * std::conj(model) *
-                          //    (pol == pol2 ? measuredVis(row,chan,pol2) : casa::Complex(0.,0.)));
-                          if (pol2<=pol) {
-                              pxpSlice.addModelProduct(pol,pol2,
-                                  weight * std::conj(model) * modelVis(row,chan,pol2));
-                          }
-                     }
-                     //std::cout<<"accumulated ("<<bufRow<<","<<pol<<"): "<<model<<
-                     //    " "<<measuredVis(row,chan,pol)<<std::endl;
-                     // unflag this row because it now has some data
-                     itsFlag(bufRow,bufChan,pol) = false;
+                     weightedModel[index] = weight * std::conj(modelVis[inIndex]);
                  } else {
-                     ++itsFlagIgnored;
+                     weightedModel[index] = casa::Complex(0., 0.);
+                     ++flagIgnored;
                  }
             }
        }
-  }
-}
 
+       // sum over channels which are accumulated into the same buffer element
+       const casa::uInt nChanPerSum = fdp ? 1 : nChan;
+       for (casa::uInt startChan = 0; startChan < nChan; startChan += nChanPerSum) {
+            std::fill(modelProducts.begin(), modelProducts.end(), casa::Complex(0., 0.));
+            std::fill(modelMeasProducts.begin(), modelMeasProducts.end(), casa::Complex(0., 0.));
+            for (casa::uInt pol = 0; pol < nProdPol; ++pol) {
+                 const casa::Complex *wm = &weightedModel[pol * nChan + startChan];
+                 for (casa::uInt pol2 = 0; pol2 < nProdPol; ++pol2) {
+                      const casa::Complex *meas = &measured[pol2 * nChan + startChan];
+                      casa::Complex sum(0., 0.);
+                      for (casa::uInt chan = 0; chan < nChanPerSum; ++chan) {
+                           sum += wm[chan] * meas[chan];
+                      }
+                      modelMeasProducts[pol + bufferNPol * pol2] = sum;
+                      if (pol2 <= pol) {
+                          const casa::Complex *mod = &model[pol2 * nChan + startChan];
+                          casa::Complex modelSum(0., 0.);
+                          for (casa::uInt chan = 0; chan < nChanPerSum; ++chan) {
+                               modelSum += wm[chan] * mod[chan];
+                          }
+                          modelProducts[pol + bufferNPol * pol2] = modelSum;
+                      }
+                 }
+            }
+            const casa::uInt bufChan = fdp ? startChan : 0;
+            itsPolXProducts.addProducts(bufRow, bufChan, &modelProducts[0], &modelMeasProducts[0]);
 
+            // unflag the buffer elements which now have some data
+            for (casa::uInt pol = 0; pol < nProdPol; ++pol) {
+                 for (casa::uInt chan = startChan; chan < startChan + nChanPerSum; ++chan) {
+                      if (valid[pol * nChan + chan] != 0) {
+                          itsFlag(bufRow, bufChan, pol) = false;
+                          break;
+                      }
+                 }
+            }
+       }
+  }
+  return flagIgnored;
+}
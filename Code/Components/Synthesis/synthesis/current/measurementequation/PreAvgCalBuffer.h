@@ -45,6 +45,8 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 namespace askap {
 
 namespace synthesis {
@@ -61,6 +63,10 @@ namespace synthesis {
 /// in the detached state.
 /// @note At the moment all frequency channels are summed up together. Later we may want
 /// to implement a partial averaging in frequency.
+/// @note Rows of the accessor are matched to the buffer rows via a lookup table indexed by
+/// (antenna1, antenna2, beam). The accessor rows are then split into groups by the buffer 
+/// row they contribute to, and the groups are accumulated concurrently if OpenMP is enabled.
+/// As groups correspond to disjoint sets of buffer rows, no locking is required.
 /// @ingroup measurementequation
 class PreAvgCalBuffer : public accessors::DataAccessorAdapter {
 public:
@@ -209,9 +215,47 @@ protected:
    /// @param[in] beam beam index
    /// @return row number in the buffer corresponding to the given (ant1,ant2,beam) or -1 if 
    /// there is no match
-   int findMatch(casa::uInt ant1, casa::uInt ant2, casa::uInt beam); 
+   int findMatch(casa::uInt ant1, casa::uInt ant2, casa::uInt beam) const; 
       
 private:
+   /// @brief build the lookup table used by findMatch
+   /// @details The table is indexed by (antenna1, antenna2, beam) and contains the
+   /// buffer row for this combination of indices or -1 if there is no match. If more
+   /// than one buffer row has the same indices, the first one is used.
+   /// @param[in] nBeam number of beams to include into the table, buffer rows with
+   /// beam index of nBeam or larger are never matched
+   void buildRowIndex(casa::uInt nBeam);
+
+   /// @brief accumulate a group of accessor rows
+   /// @details This is a helper method which does the actual summing for the given 
+   /// rows of the accessor. Visibilities of each row are first rearranged so that spectral
+   /// channels are contiguous for every polarisation which allows the compiler to vectorise
+   /// the loops forming cross-products. It is safe to call this method concurrently 
+   /// for groups which do not share any buffer row.
+   /// @param[in] rows indices of the accessor rows to process
+   /// @param[in] bufRows buffer row corresponding to each row of the accessor
+   /// @param[in] shape shape of the accessor cubes (nRow, nChannel, nPol)
+   /// @param[in] measuredVis pointer to the contiguous storage of measured visibilities
+   /// @param[in] modelVis pointer to the contiguous storage of model visibilities
+   /// @param[in] measuredNoise pointer to the contiguous storage of visibility noise
+   /// @param[in] measuredFlag pointer to the contiguous storage of flags
+   /// @param[in] fdp frequency dependency flag (see accumulate)
+   /// @return number of visibilities ignored due to flags
+   casa::uInt accumulateRows(const std::vector<casa::uInt> &rows, const std::vector<casa::uInt> &bufRows,
+                             const casa::IPosition &shape, const casa::Complex *measuredVis, 
+                             const casa::Complex *modelVis, const casa::Complex *measuredNoise, 
+                             const casa::Bool *measuredFlag, const bool fdp);
+
+   /// @brief lookup table of buffer rows
+   /// @details Indexed by antenna1 + nAnt * (antenna2 + nAnt * beam), -1 means no match
+   std::vector<int> itsRowIndex;
+
+   /// @brief number of antennas covered by the lookup table
+   casa::uInt itsIndexNAnt;
+
+   /// @brief number of beams covered by the lookup table
+   casa::uInt itsIndexNBeam;
+
    /// @brief indices of the first antenna for all rows
    casa::Vector<casa::uInt> itsAntenna1;   
    
@@ -37,6 +37,7 @@
 #include <askap/AskapError.h>
 #include <fitting/ComplexDiffMatrix.h>
 #include <fitting/ComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 #include <fitting/DesignMatrix.h>
 #include <fitting/PolXProducts.h>
 #include <fitting/Params.h>
@@ -177,19 +178,15 @@ void PreAvgCalMEBase::calcGenericEquations(scimath::GenericNormalEquations &ne)
   
   for (casa::uInt row = 0; row < itsBuffer.nRow(); ++row) { 
 
-       scimath::ComplexDiffMatrix cdm = buildComplexDiffMatrix(itsBuffer, row); 
+       if (!fdp) {
+           // the same matrix is used for all channels, parameter names are resolved once per row
+           ne.add(buildFixedComplexDiffMatrix(itsBuffer, row, 0), polXProducts, row, itsBuffer.nChannel());
+           continue;
+       }
        for (casa::uInt chan = 0; chan < itsBuffer.nChannel(); ++chan) {
-            
             // take a slice, this takes care of indices along the first two axes (row and channel)
             const scimath::PolXProducts pxpSlice = polXProducts.roSlice(row,chan);
-            if (fdp) {
-               // cdm is a block matrix
-               const scimath::ComplexDiffMatrix thisChanCDM = cdm.extractBlock(chan * itsBuffer.nPol(),itsBuffer.nPol());
-               ne.add(thisChanCDM,pxpSlice);
-            } else {
-               // cdm is a normal matrix
-               ne.add(cdm,pxpSlice);
-            }
+            ne.add(buildFixedComplexDiffMatrix(itsBuffer, row, chan),pxpSlice);
        }
   }
   updateMetadata(ne,"min_time",itsMinTime);
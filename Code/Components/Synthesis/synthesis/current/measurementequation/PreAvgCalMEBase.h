@@ -43,6 +43,7 @@
 #include <fitting/GenericNormalEquations.h>
 #include <fitting/ComplexDiffMatrix.h>
 #include <fitting/ComplexDiff.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 
 #include <boost/shared_ptr.hpp>
 
@@ -127,24 +128,27 @@ public:
   void beamIndependent(const bool flag);
   
 protected:  
-  /// @brief a helper method to form a ComplexDiffMatrix for a given row
+  /// @brief a helper method to form an integer-indexed matrix for a given row and channel
   /// @details This is the only method which depends on the template type.
   /// Therefore in this class it is just declared pure virtual. This method
   /// is used on the most outer level of the measurement equation chain. Therefore,
   /// making it virtual doesn't cause problems with the compile time building of
-  /// the measurement equation.
+  /// the measurement equation. Parameter names are resolved into indices while
+  /// the matrix is built, so the normal equations are accumulated without
+  /// looking up parameters by name. Up to 8 parameters (e.g. gains and leakages
+  /// of two antennas) are supported.
   /// @param[in] acc input data accessor (to define metadata for a given row)
   /// @param[in] row the row number to work with
-  /// @return ComplexDiffMatrix encapsulating information about measurement 
-  ///         equation corresponding to the given row
-  virtual scimath::ComplexDiffMatrix buildComplexDiffMatrix(const accessors::IConstDataAccessor &acc,
-                    casa::uInt row) const = 0;
+  /// @param[in] chan the channel number to work with (for frequency-dependent effects,
+  ///            the block corresponding to this channel is returned)
+  /// @return FixedComplexDiffMatrix encapsulating information about measurement 
+  ///         equation corresponding to the given row and channel
+  virtual scimath::FixedComplexDiffMatrix<8> buildFixedComplexDiffMatrix(const accessors::IConstDataAccessor &acc,
+                    casa::uInt row, casa::uInt chan) const = 0;
   
   /// @brief check whether the measurement equation is frequency-dependent
-  /// @details For frequency-dependent effects the buildComplexDiffMatrix method returns block matrix with 
-  /// one block corresponding to every channel (i.e. the size is nPol x nPol*nChannel 
-  /// instead of simply nPol x nPol). We need this flag to unroll the matrix multiplication
-  /// correctly.
+  /// @details For frequency-dependent effects the matrix has to be formed for every
+  /// channel, otherwise the same matrix is used for all channels of a row.
   /// @return true, if the effect is frequency-dependent
   virtual bool isFrequencyDependent() const = 0;
   
@@ -35,6 +35,7 @@
 #include <measurementequation/MEComponent.h>
 #include <dataaccess/IConstDataAccessor.h>
 #include <measurementequation/BlockCDMOperations.h>
+#include <fitting/FixedComplexDiffMatrix.h>
 
 namespace askap {
 
@@ -66,6 +67,22 @@ struct Product  : public MEComponent<Effect1::theirFDPFlag || Effect2::theirFDPF
                                 casa::uInt row) const
    {  return BlockCDMOperations<Effect1::theirFDPFlag,Effect2::theirFDPFlag,Effect3::theirFDPFlag>::product( 
            itsEffect1.get(chunk,row), itsEffect2.get(chunk,row), itsEffect3.get(chunk,row)); }
+
+   /// @brief integer-indexed Mueller matrix and derivatives for one channel
+   /// @details This is the counterpart of the get method used with the pre-averaged
+   /// normal equations. For frequency-dependent effects only the block corresponding
+   /// to the given channel is formed, so the product is a simple matrix product for
+   /// any combination of effects.
+   /// @param[in] chunk accessor to work with
+   /// @param[in] row row of the chunk to work with
+   /// @param[in] chan channel to work with
+   /// @return FixedComplexDiffMatrix filled with Mueller matrix corresponding to
+   /// this effect (nPol x nPol)
+   template<size_t N>
+   inline scimath::FixedComplexDiffMatrix<N> getFixed(const accessors::IConstDataAccessor &chunk, 
+                                casa::uInt row, casa::uInt chan) const
+   {  return itsEffect1.template getFixed<N>(chunk,row,chan) * itsEffect2.template getFixed<N>(chunk,row,chan) *
+             itsEffect3.template getFixed<N>(chunk,row,chan); }
    
 private:
    /// @brief buffer for the first effect
@@ -97,6 +114,21 @@ struct Product<Effect1, Effect2, MEComponent<false> > : public MEComponent<Effec
                                 casa::uInt row) const
    {  return BlockCDMOperations<Effect1::theirFDPFlag,Effect2::theirFDPFlag,false>::product( 
            itsEffect1.get(chunk,row), itsEffect2.get(chunk,row)); }
+
+   /// @brief integer-indexed Mueller matrix and derivatives for one channel
+   /// @details This is the counterpart of the get method used with the pre-averaged
+   /// normal equations. For frequency-dependent effects only the block corresponding
+   /// to the given channel is formed, so the product is a simple matrix product for
+   /// any combination of effects.
+   /// @param[in] chunk accessor to work with
+   /// @param[in] row row of the chunk to work with
+   /// @param[in] chan channel to work with
+   /// @return FixedComplexDiffMatrix filled with Mueller matrix corresponding to
+   /// this effect (nPol x nPol)
+   template<size_t N>
+   inline scimath::FixedComplexDiffMatrix<N> getFixed(const accessors::IConstDataAccessor &chunk, 
+                                casa::uInt row, casa::uInt chan) const
+   {  return itsEffect1.template getFixed<N>(chunk,row,chan) * itsEffect2.template getFixed<N>(chunk,row,chan); }
    
 private:
    /// @buffer first effect
@@ -58,6 +58,7 @@ ASKAP_LOGGER(logger, ".measurementequation.synthesisparamshelper");
 
 #include <measures/Measures/Stokes.h>
 
+#include <cstdlib>
 #include <vector>
 #include <algorithm>
 #include <set>
@@ -719,8 +720,21 @@ namespace askap
     /// casa image handler is created (however, a call to this method is still required)
     void SynthesisParamsHelper::setUpImageHandler(const LOFAR::ParameterSet &parset)
     {
+      if (!theirImageAccessor) {
+          // images are kept open by the handler, close them while casacore is still alive
+          std::atexit(releaseImageHandler);
+      }
       theirImageAccessor = accessors::imageAccessFactory(parset);
     }
+
+    /// @brief release the image handler
+    /// @details Registered with atexit by setUpImageHandler, so the images kept
+    /// open by the handler are closed before static objects
+    /// (including those of casacore) are destroyed.
+    void SynthesisParamsHelper::releaseImageHandler()
+    {
+      theirImageAccessor.reset();
+    }
  
     
     void SynthesisParamsHelper::loadImageParameter(askap::scimath::Params& ip, const string& name,
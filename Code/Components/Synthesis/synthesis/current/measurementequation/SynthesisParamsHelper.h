@@ -416,6 +416,12 @@ namespace askap
         static casa::Projection getProjection(const bool ewprojection, const double dec = 0.);
         
     private:    
+        /// @brief release the image handler
+        /// @details Registered with atexit by setUpImageHandler, so the images kept
+        /// open by the handler are closed before static objects
+        /// (including those of casacore) are destroyed.
+        static void releaseImageHandler();
+
         /// @brief image accessor
         static boost::shared_ptr<accessors::IImageAccess> theirImageAccessor;              
 
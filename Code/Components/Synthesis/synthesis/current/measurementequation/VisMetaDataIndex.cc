@@ -0,0 +1,346 @@
+/// @file
+///
+/// @brief Per-chunk summary of the metadata of a measurement set
+/// @details The advise utility (see VisMetaDataStats) only needs the extremes of
+/// the metadata, but getting them requires a pass over all metadata columns of
+/// the measurement set. This class holds a compact summary of each chunk of data
+/// (i.e. each accessor returned by the iterator) which can be stored in a small
+/// table next to the measurement set and used instead of the data pass.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <measurementequation/VisMetaDataIndex.h>
+#include <askap_synthesis.h>
+#include <askap/AskapError.h>
+#include <askap/AskapLogging.h>
+
+#include <casa/Arrays/Vector.h>
+#include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
+#include <casa/BasicMath/Math.h>
+#include <tables/Tables/Table.h>
+#include <tables/Tables/TableDesc.h>
+#include <tables/Tables/SetupNewTab.h>
+#include <tables/Tables/ScaColDesc.h>
+#include <tables/Tables/ArrColDesc.h>
+#include <tables/Tables/ScalarColumn.h>
+#include <tables/Tables/ArrayColumn.h>
+#include <tables/Tables/TableRecord.h>
+#include <casa/OS/File.h>
+#include <casa/OS/Directory.h>
+#include <casa/OS/DirectoryIterator.h>
+
+#include <set>
+#include <algorithm>
+
+ASKAP_LOGGER(logger, ".measurementequation.vismetadataindex");
+
+namespace askap {
+
+namespace synthesis {
+
+// increment the number when format changes
+#define VIS_META_DATA_INDEX_VERSION 2
+
+/// @brief constructor
+/// @param[in] msRows number of rows in the main table of the measurement set
+/// @param[in] freqFrame name of the frequency frame used by the accessors
+/// @param[in] msModified modification time of the measurement set (see modificationTime)
+VisMetaDataIndex::VisMetaDataIndex(casa::uInt msRows, const std::string &freqFrame,
+                                   casa::uInt msModified) :
+     itsMSRows(msRows), itsMSModified(msModified), itsFreqFrame(freqFrame) {}
+
+/// @brief summarise one accessor and add it as a new chunk
+/// @details Accessors without rows are ignored
+/// @param[in] acc read-only accessor with data
+void VisMetaDataIndex::add(const accessors::IConstDataAccessor &acc)
+{
+  if (acc.nRow() == 0) {
+      return;
+  }
+  Chunk chunk;
+  chunk.itsTime = acc.time();
+  chunk.itsNRow = acc.nRow();
+  chunk.itsNChannel = acc.nChannel();
+  chunk.itsMinFreq = casa::min(acc.frequency());
+  chunk.itsMaxFreq = casa::max(acc.frequency());
+  chunk.itsMaxAntenna = casa::max(casa::max(acc.antenna1()), casa::max(acc.antenna2()));
+
+  std::set<casa::uInt> beams(acc.feed1().begin(), acc.feed1().end());
+  beams.insert(acc.feed2().begin(), acc.feed2().end());
+  chunk.itsBeams.assign(beams.begin(), beams.end());
+
+  const casa::Cube<casa::Bool> &flags = acc.flag();
+  chunk.itsFlaggedFraction = flags.nelements() > 0 ? double(casa::ntrue(flags)) / flags.nelements() : 0.;
+
+  chunk.itsMaxU = chunk.itsMaxV = chunk.itsMaxW = 0.;
+  const casa::Vector<casa::RigidVector<casa::Double, 3> > &uvw = acc.uvw();
+  for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+       chunk.itsMaxU = std::max(chunk.itsMaxU, casa::abs(uvw[row](0)));
+       chunk.itsMaxV = std::max(chunk.itsMaxV, casa::abs(uvw[row](1)));
+       chunk.itsMaxW = std::max(chunk.itsMaxW, casa::abs(uvw[row](2)));
+  }
+
+  chunk.itsFirstDishPointing = acc.dishPointing1()[0];
+  // there are only a few distinct pointings (one per beam), so a linear search is fine
+  const casa::Vector<casa::MVDirection> &pointingDir = acc.pointingDir1();
+  for (casa::uInt row = 0; row < acc.nRow(); ++row) {
+       const casa::Vector<casa::Double> &xyz = pointingDir[row].getValue();
+       bool found = false;
+       for (size_t i = 0; i < chunk.itsPointings.size() && !found; ++i) {
+            found = casa::allEQ(xyz, chunk.itsPointings[i].getValue());
+       }
+       if (!found) {
+           chunk.itsPointings.push_back(pointingDir[row]);
+       }
+  }
+  itsChunks.push_back(chunk);
+}
+
+/// @brief find chunks overlapping with the given frequency range
+/// @param[in] minFreq smallest frequency of interest
+/// @param[in] maxFreq largest frequency of interest
+/// @param[in] beam beam index of interest, or a negative value for all beams
+/// @return indices of the matching chunks in increasing order
+std::vector<size_t> VisMetaDataIndex::select(double minFreq, double maxFreq, int beam) const
+{
+  std::vector<size_t> result;
+  for (size_t i = 0; i < itsChunks.size(); ++i) {
+       const Chunk &chunk = itsChunks[i];
+       if ((chunk.itsMaxFreq < minFreq) || (chunk.itsMinFreq > maxFreq)) {
+           continue;
+       }
+       if ((beam >= 0) && !std::binary_search(chunk.itsBeams.begin(), chunk.itsBeams.end(), casa::uInt(beam))) {
+           continue;
+       }
+       result.push_back(i);
+  }
+  return result;
+}
+
+/// @brief write the index to a table, replacing an existing one
+/// @param[in] name table name
+void VisMetaDataIndex::write(const std::string &name) const
+{
+  casa::TableDesc td("VisMetaDataIndex", "1", casa::TableDesc::Scratch);
+  td.addColumn(casa::ScalarColumnDesc<casa::Double>("TIME"));
+  td.addColumn(casa::ScalarColumnDesc<casa::uInt>("NROW"));
+  td.addColumn(casa::ScalarColumnDesc<casa::uInt>("NCHAN"));
+  td.addColumn(casa::ScalarColumnDesc<casa::Double>("MIN_FREQ"));
+  td.addColumn(casa::ScalarColumnDesc<casa::Double>("MAX_FREQ"));
+  td.addColumn(casa::ArrayColumnDesc<casa::Double>("MAX_UVW", 1));
+  td.addColumn(casa::ScalarColumnDesc<casa::uInt>("MAX_ANTENNA"));
+  td.addColumn(casa::ArrayColumnDesc<casa::uInt>("BEAMS", 1));
+  td.addColumn(casa::ScalarColumnDesc<casa::Double>("FLAGGED_FRACTION"));
+  td.addColumn(casa::ArrayColumnDesc<casa::Double>("DISH_POINTING", 1));
+  td.addColumn(casa::ArrayColumnDesc<casa::Double>("POINTINGS", 2));
+
+  casa::SetupNewTable newTab(name, td, casa::Table::New);
+  casa::Table table(newTab, itsChunks.size());
+  table.rwKeywordSet().define("VERSION", casa::Int(VIS_META_DATA_INDEX_VERSION));
+  table.rwKeywordSet().define("MS_NROW", itsMSRows);
+  table.rwKeywordSet().define("MS_MTIME", itsMSModified);
+  table.rwKeywordSet().define("FREQ_FRAME", casa::String(itsFreqFrame));
+
+  casa::ScalarColumn<casa::Double> timeCol(table, "TIME");
+  casa::ScalarColumn<casa::uInt> nRowCol(table, "NROW");
+  casa::ScalarColumn<casa::uInt> nChanCol(table, "NCHAN");
+  casa::ScalarColumn<casa::Double> minFreqCol(table, "MIN_FREQ");
+  casa::ScalarColumn<casa::Double> maxFreqCol(table, "MAX_FREQ");
+  casa::ArrayColumn<casa::Double> maxUVWCol(table, "MAX_UVW");
+  casa::ScalarColumn<casa::uInt> maxAntCol(table, "MAX_ANTENNA");
+  casa::ArrayColumn<casa::uInt> beamsCol(table, "BEAMS");
+  casa::ScalarColumn<casa::Double> flaggedCol(table, "FLAGGED_FRACTION");
+  casa::ArrayColumn<casa::Double> dishPointingCol(table, "DISH_POINTING");
+  casa::ArrayColumn<casa::Double> pointingsCol(table, "POINTINGS");
+
+  for (casa::uInt row = 0; row < itsChunks.size(); ++row) {
+       const Chunk &chunk = itsChunks[row];
+       timeCol.put(row, chunk.itsTime);
+       nRowCol.put(row, chunk.itsNRow);
+       nChanCol.put(row, chunk.itsNChannel);
+       minFreqCol.put(row, chunk.itsMinFreq);
+       maxFreqCol.put(row, chunk.itsMaxFreq);
+       casa::Vector<casa::Double> maxUVW(3);
+       maxUVW[0] = chunk.itsMaxU;
+       maxUVW[1] = chunk.itsMaxV;
+       maxUVW[2] = chunk.itsMaxW;
+       maxUVWCol.put(row, maxUVW);
+       maxAntCol.put(row, chunk.itsMaxAntenna);
+       beamsCol.put(row, casa::Vector<casa::uInt>(chunk.itsBeams));
+       flaggedCol.put(row, chunk.itsFlaggedFraction);
+       dishPointingCol.put(row, chunk.itsFirstDishPointing.getValue());
+       // direction cosines are stored to reproduce the directions exactly
+       casa::Matrix<casa::Double> pointings(3, chunk.itsPointings.size());
+       for (casa::uInt i = 0; i < chunk.itsPointings.size(); ++i) {
+            pointings.column(i) = chunk.itsPointings[i].getValue();
+       }
+       pointingsCol.put(row, pointings);
+  }
+}
+
+/// @brief read the index from a table
+/// @param[in] name table name
+void VisMetaDataIndex::read(const std::string &name)
+{
+  ASKAPCHECK(casa::Table::isReadable(name), "Metadata index table "<<name<<" is not readable");
+  const casa::Table table(name);
+  const casa::TableRecord &keywords = table.keywordSet();
+  ASKAPCHECK(keywords.isDefined("VERSION") && (keywords.asInt("VERSION") == VIS_META_DATA_INDEX_VERSION),
+             "Metadata index table "<<name<<" has the wrong version, expected "<<VIS_META_DATA_INDEX_VERSION);
+  itsMSRows = keywords.asuInt("MS_NROW");
+  itsMSModified = keywords.asuInt("MS_MTIME");
+  itsFreqFrame = keywords.asString("FREQ_FRAME");
+
+  const casa::ROScalarColumn<casa::Double> timeCol(table, "TIME");
+  const casa::ROScalarColumn<casa::uInt> nRowCol(table, "NROW");
+  const casa::ROScalarColumn<casa::uInt> nChanCol(table, "NCHAN");
+  const casa::ROScalarColumn<casa::Double> minFreqCol(table, "MIN_FREQ");
+  const casa::ROScalarColumn<casa::Double> maxFreqCol(table, "MAX_FREQ");
+  const casa::ROArrayColumn<casa::Double> maxUVWCol(table, "MAX_UVW");
+  const casa::ROScalarColumn<casa::uInt> maxAntCol(table, "MAX_ANTENNA");
+  const casa::ROArrayColumn<casa::uInt> beamsCol(table, "BEAMS");
+  const casa::ROScalarColumn<casa::Double> flaggedCol(table, "FLAGGED_FRACTION");
+  const casa::ROArrayColumn<casa::Double> dishPointingCol(table, "DISH_POINTING");
+  const casa::ROArrayColumn<casa::Double> pointingsCol(table, "POINTINGS");
+
+  itsChunks.resize(table.nrow());
+  for (casa::uInt row = 0; row < table.nrow(); ++row) {
+       Chunk &chunk = itsChunks[row];
+       chunk.itsTime = timeCol(row);
+       chunk.itsNRow = nRowCol(row);
+       chunk.itsNChannel = nChanCol(row);
+       chunk.itsMinFreq = minFreqCol(row);
+       chunk.itsMaxFreq = maxFreqCol(row);
+       const casa::Vector<casa::Double> maxUVW(maxUVWCol(row));
+       ASKAPCHECK(maxUVW.nelements() == 3, "Expect 3 elements in MAX_UVW, row "<<row<<" has "<<maxUVW.nelements());
+       chunk.itsMaxU = maxUVW[0];
+       chunk.itsMaxV = maxUVW[1];
+       chunk.itsMaxW = maxUVW[2];
+       chunk.itsMaxAntenna = maxAntCol(row);
+       const casa::Vector<casa::uInt> beams(beamsCol(row));
+       chunk.itsBeams.assign(beams.begin(), beams.end());
+       chunk.itsFlaggedFraction = flaggedCol(row);
+       chunk.itsFirstDishPointing = casa::MVDirection(casa::Vector<casa::Double>(dishPointingCol(row)));
+       const casa::Matrix<casa::Double> pointings(pointingsCol(row));
+       ASKAPCHECK(pointings.nrow() == 3, "Expect direction cosines in POINTINGS, row "<<row<<" has shape "<<pointings.shape());
+       chunk.itsPointings.resize(pointings.ncolumn());
+       for (casa::uInt i = 0; i < pointings.ncolumn(); ++i) {
+            chunk.itsPointings[i] = casa::MVDirection(pointings.column(i));
+       }
+  }
+}
+
+/// @brief name of the index table associated with a measurement set
+/// @param[in] ms measurement set name
+/// @return table name
+std::string VisMetaDataIndex::indexName(const std::string &ms)
+{
+  return ms + ".metaidx";
+}
+
+namespace {
+
+/// @brief latest modification time of a file or a directory tree
+/// @details Only regular files count and lock files are skipped. Opening a table
+/// touches its lock file (and creates it the first time, which changes the time of
+/// the directory), but does not change the table.
+/// @param[in] file file or directory
+/// @return modification time in seconds
+casa::uInt latestModificationTime(const casa::File &file)
+{
+  if (!file.isDirectory(casa::False)) {
+      return file.modifyTime();
+  }
+  casa::uInt result = 0;
+  for (casa::DirectoryIterator it((casa::Directory(file))); !it.pastEnd(); ++it) {
+       if (it.name() != "table.lock") {
+           result = std::max(result, latestModificationTime(it.file()));
+       }
+  }
+  return result;
+}
+
+} // anonymous namespace
+
+/// @brief modification time of a measurement set
+/// @details The latest modification time (in seconds) of all files of the table
+/// and its subtables, so changes to the data or to a subtable are detected even if
+/// the number of rows stays the same.
+/// @param[in] ms measurement set name
+/// @return modification time
+casa::uInt VisMetaDataIndex::modificationTime(const std::string &ms)
+{
+  return latestModificationTime(casa::File(ms));
+}
+
+/// @brief load the index of a measurement set if it is present and up to date
+/// @details The index is only used if it was built for the current number of rows
+/// and modification time of the measurement set and for the same frequency frame.
+/// An index which cannot be read is ignored, so it is rebuilt by the caller.
+/// @param[in] ms measurement set name
+/// @param[in] freqFrame name of the frequency frame required
+/// @param[out] index the index, valid if true is returned
+/// @return true if a usable index has been loaded
+bool VisMetaDataIndex::load(const std::string &ms, const std::string &freqFrame, VisMetaDataIndex &index)
+{
+  const std::string name = indexName(ms);
+  if (!casa::Table::isReadable(name)) {
+      return false;
+  }
+  try {
+     index.read(name);
+  }
+  catch (const AskapError &ae) {
+     ASKAPLOG_WARN_STR(logger, "Ignoring metadata index "<<name<<": "<<ae.what());
+     return false;
+  }
+  catch (const casa::AipsError &ae) {
+     ASKAPLOG_WARN_STR(logger, "Ignoring unreadable metadata index "<<name<<": "<<ae.what());
+     return false;
+  }
+  const casa::uInt msRows = casa::Table(ms).nrow();
+  if (index.msRows() != msRows) {
+      ASKAPLOG_WARN_STR(logger, "Ignoring metadata index "<<name<<" which was built for "<<index.msRows()<<
+                        " rows, the measurement set has "<<msRows);
+      return false;
+  }
+  const casa::uInt msModified = modificationTime(ms);
+  if (index.msModified() != msModified) {
+      ASKAPLOG_WARN_STR(logger, "Ignoring metadata index "<<name<<" which was built for the measurement set modified at "<<
+                        index.msModified()<<", it has been modified at "<<msModified);
+      return false;
+  }
+  if (index.freqFrame() != freqFrame) {
+      ASKAPLOG_INFO_STR(logger, "Ignoring metadata index "<<name<<" which was built for the "<<index.freqFrame()<<
+                        " frequency frame, "<<freqFrame<<" is required");
+      return false;
+  }
+  return true;
+}
+
+} // namespace synthesis
+
+} // namespace askap
@@ -0,0 +1,167 @@
+/// @file
+///
+/// @brief Per-chunk summary of the metadata of a measurement set
+/// @details The advise utility (see VisMetaDataStats) only needs the extremes of
+/// the metadata, but getting them requires a pass over all metadata columns of
+/// the measurement set. This class holds a compact summary of each chunk of data
+/// (i.e. each accessor returned by the iterator) which can be stored in a small
+/// table next to the measurement set and used instead of the data pass.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef SYNTHESIS_VIS_METADATA_INDEX_H
+#define SYNTHESIS_VIS_METADATA_INDEX_H
+
+#include <dataaccess/IConstDataAccessor.h>
+#include <casa/aips.h>
+#include <casa/Quanta/MVDirection.h>
+
+#include <vector>
+#include <string>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief Per-chunk summary of the metadata of a measurement set
+/// @details Each chunk corresponds to one accessor, so the statistics derived from
+/// the index are the same as those obtained by iterating over the data with the
+/// same selection and conversion (i.e. no data selection, J2000 directions and
+/// frequencies in Hz in the frame stored with the index). The index is stored as
+/// a casa table with one row per chunk. The number of rows of the measurement set,
+/// its latest modification time and the frequency frame are stored as table keywords
+/// and checked before the index is used, so a stale index is ignored rather than
+/// giving wrong results.
+/// @ingroup measurementequation
+class VisMetaDataIndex {
+public:
+   /// @brief summary of one chunk of data
+   struct Chunk {
+      /// @brief time of the chunk (in the units of the accessor)
+      double itsTime;
+      /// @brief number of rows
+      casa::uInt itsNRow;
+      /// @brief number of spectral channels
+      casa::uInt itsNChannel;
+      /// @brief smallest frequency
+      double itsMinFreq;
+      /// @brief largest frequency
+      double itsMaxFreq;
+      /// @brief largest absolute values of u, v and w (in metres)
+      double itsMaxU;
+      double itsMaxV;
+      double itsMaxW;
+      /// @brief largest antenna index
+      casa::uInt itsMaxAntenna;
+      /// @brief beam indices present in the chunk, in increasing order
+      std::vector<casa::uInt> itsBeams;
+      /// @brief fraction of flagged visibilities (all polarisations counted)
+      double itsFlaggedFraction;
+      /// @brief dish pointing of the first row
+      casa::MVDirection itsFirstDishPointing;
+      /// @brief distinct pointing directions, in the order they first appear
+      std::vector<casa::MVDirection> itsPointings;
+   };
+
+   /// @brief constructor
+   /// @param[in] msRows number of rows in the main table of the measurement set
+   /// @param[in] freqFrame name of the frequency frame used by the accessors
+   /// @param[in] msModified modification time of the measurement set (see modificationTime)
+   explicit VisMetaDataIndex(casa::uInt msRows = 0, const std::string &freqFrame = "",
+                             casa::uInt msModified = 0);
+
+   /// @brief summarise one accessor and add it as a new chunk
+   /// @details Accessors without rows are ignored
+   /// @param[in] acc read-only accessor with data
+   void add(const accessors::IConstDataAccessor &acc);
+
+   /// @brief all chunks in the order they were added
+   inline const std::vector<Chunk>& chunks() const { return itsChunks; }
+
+   /// @brief number of rows of the measurement set this index describes
+   inline casa::uInt msRows() const { return itsMSRows; }
+
+   /// @brief modification time of the measurement set this index describes
+   inline casa::uInt msModified() const { return itsMSModified; }
+
+   /// @brief frequency frame used to build the index
+   inline const std::string& freqFrame() const { return itsFreqFrame; }
+
+   /// @brief find chunks overlapping with the given frequency range
+   /// @param[in] minFreq smallest frequency of interest
+   /// @param[in] maxFreq largest frequency of interest
+   /// @param[in] beam beam index of interest, or a negative value for all beams
+   /// @return indices of the matching chunks in increasing order
+   std::vector<size_t> select(double minFreq, double maxFreq, int beam = -1) const;
+
+   /// @brief write the index to a table, replacing an existing one
+   /// @param[in] name table name
+   void write(const std::string &name) const;
+
+   /// @brief read the index from a table
+   /// @param[in] name table name
+   void read(const std::string &name);
+
+   /// @brief name of the index table associated with a measurement set
+   /// @param[in] ms measurement set name
+   /// @return table name
+   static std::string indexName(const std::string &ms);
+
+   /// @brief modification time of a measurement set
+   /// @details The latest modification time (in seconds) of all files of the table
+   /// and its subtables, so changes to the data or to a subtable are detected even if
+   /// the number of rows stays the same.
+   /// @param[in] ms measurement set name
+   /// @return modification time
+   static casa::uInt modificationTime(const std::string &ms);
+
+   /// @brief load the index of a measurement set if it is present and up to date
+   /// @details The index is only used if it was built for the current number of rows
+   /// and modification time of the measurement set and for the same frequency frame.
+   /// An index which cannot be read is ignored, so it is rebuilt by the caller.
+   /// @param[in] ms measurement set name
+   /// @param[in] freqFrame name of the frequency frame required
+   /// @param[out] index the index, valid if true is returned
+   /// @return true if a usable index has been loaded
+   static bool load(const std::string &ms, const std::string &freqFrame, VisMetaDataIndex &index);
+
+private:
+   /// @brief number of rows in the main table of the measurement set
+   casa::uInt itsMSRows;
+
+   /// @brief modification time of the measurement set
+   casa::uInt itsMSModified;
+
+   /// @brief frequency frame used to build the index
+   std::string itsFreqFrame;
+
+   /// @brief summaries of all chunks
+   std::vector<Chunk> itsChunks;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
+#endif // #ifndef SYNTHESIS_VIS_METADATA_INDEX_H
@@ -36,6 +36,8 @@
 #include <askap/AskapError.h>
 #include <Blob/BlobArray.h>
 
+#include <algorithm>
+
 namespace askap {
 
 namespace synthesis {
@@ -365,6 +367,62 @@ void VisMetaDataStats::process(const accessors::IConstDataAccessor &acc)
   itsNVis += acc.nRow() * acc.nChannel();
 }
 
+
+/// @brief process one chunk of a metadata index updating statistics
+/// @details The result is the same as processing the accessor the chunk was built
+/// from. Only the statistics which don't depend on the tangent point can be obtained
+/// this way, so this method can't be used if the tangent point is set.
+/// @param[in] chunk summary of one accessor
+void VisMetaDataStats::process(const VisMetaDataIndex::Chunk &chunk)
+{
+  ASKAPCHECK(!itsTangentSet, "Statistics for a given tangent point can't be obtained from the metadata index");
+  ASKAPDEBUGASSERT(chunk.itsNRow > 0);
+  ASKAPDEBUGASSERT(chunk.itsPointings.size() > 0);
+  ASKAPDEBUGASSERT(chunk.itsBeams.size() > 0);
+
+  if (!itsRefDirValid) {
+      itsReferenceDir = chunk.itsFirstDishPointing;
+      itsRefDirValid = true;
+  }
+
+  for (size_t i = 0; i < chunk.itsPointings.size(); ++i) {
+       const std::pair<double,double> offsets = getOffsets(chunk.itsPointings[i]);
+       if ( (itsNVis == 0ul) && (i == 0) ) {
+            itsFieldBLC = itsFieldTRC = offsets;
+       } else {
+            itsFieldBLC.first = std::min(itsFieldBLC.first, offsets.first);
+            itsFieldTRC.first = std::max(itsFieldTRC.first, offsets.first);
+            itsFieldBLC.second = std::min(itsFieldBLC.second, offsets.second);
+            itsFieldTRC.second = std::max(itsFieldTRC.second, offsets.second);
+       }
+  }
+
+  const casa::uInt currentMaxBeamIndex = chunk.itsBeams.back();
+  const double reciprocalToShortestWavelength = chunk.itsMaxFreq / casa::C::c;
+  const double currentU = chunk.itsMaxU * reciprocalToShortestWavelength;
+  const double currentV = chunk.itsMaxV * reciprocalToShortestWavelength;
+  const double currentW = chunk.itsMaxW * reciprocalToShortestWavelength;
+
+  if (itsNVis == 0ul) {
+      itsMinFreq = chunk.itsMinFreq;
+      itsMaxFreq = chunk.itsMaxFreq;
+      itsMaxAntennaIndex = chunk.itsMaxAntenna;
+      itsMaxBeamIndex = currentMaxBeamIndex;
+      itsMaxU = currentU;
+      itsMaxV = currentV;
+      itsMaxW = currentW;
+  } else {
+      itsMinFreq = std::min(itsMinFreq, chunk.itsMinFreq);
+      itsMaxFreq = std::max(itsMaxFreq, chunk.itsMaxFreq);
+      itsMaxAntennaIndex = std::max(itsMaxAntennaIndex, chunk.itsMaxAntenna);
+      itsMaxBeamIndex = std::max(itsMaxBeamIndex, currentMaxBeamIndex);
+      itsMaxU = std::max(itsMaxU, currentU);
+      itsMaxV = std::max(itsMaxV, currentV);
+      itsMaxW = std::max(itsMaxW, currentW);
+  }
+
+  itsNVis += chunk.itsNRow * chunk.itsNChannel;
+}
          
 /// @brief largest residual w-term (for snap-shotting)
 /// @return largest value of residual w in wavelengths
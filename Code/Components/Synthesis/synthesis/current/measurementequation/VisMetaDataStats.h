@@ -37,6 +37,7 @@
 
 #include <dataaccess/IConstDataAccessor.h>
 #include <dataaccess/BestWPlaneDataAccessor.h>
+#include <measurementequation/VisMetaDataIndex.h>
 #include <measures/Measures/MDirection.h>
 #include <fitting/ISerializable.h>
 #include <Blob/BlobOStream.h>
@@ -111,6 +112,13 @@ public:
    /// @details 
    /// @param[in] acc read-only accessor with data
    void process(const accessors::IConstDataAccessor &acc);
+
+   /// @brief process one chunk of a metadata index updating statistics
+   /// @details The result is the same as processing the accessor the chunk was built
+   /// from. Only the statistics which don't depend on the tangent point can be obtained
+   /// this way, so this method can't be used if the tangent point is set.
+   /// @param[in] chunk summary of one accessor
+   void process(const VisMetaDataIndex::Chunk &chunk);
    
    // access to the data
    
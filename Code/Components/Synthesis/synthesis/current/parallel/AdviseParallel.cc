@@ -30,6 +30,7 @@
 #include <parallel/AdviseParallel.h>
 #include <askap/AskapError.h>
 #include <measurementequation/SynthesisParamsHelper.h>
+#include <measurementequation/VisMetaDataIndex.h>
 #include <dataaccess/TableDataSource.h>
 #include <dataaccess/ParsetInterface.h>
 #include <dataaccess/SharedIter.h>
@@ -44,6 +45,8 @@ ASKAP_LOGGER(logger, ".parallel");
 
 #include <casa/aips.h>
 #include <casa/OS/Timer.h>
+#include <tables/Tables/Table.h>
+#include <measures/Measures/MFrequency.h>
 
 #include <Blob/BlobString.h>
 #include <Blob/BlobIBufString.h>
@@ -56,6 +59,7 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <string>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace askap {
 
@@ -157,6 +161,8 @@ AdviseParallel::AdviseParallel(askap::askapparallel::AskapParallel& comms, const
     MEParallelApp(comms, addMissingFields(parset)), itsTangentDefined(false)
 {
    itsWTolerance = parset.getDouble("wtolerance",-1.);
+   itsUseIndex = parset.getBool("useindex", true);
+   itsWriteIndex = parset.getBool("writeindex", false);
    if (parset.isDefined("tangent")) {
        const std::vector<std::string> direction = parset.getStringVector("tangent");
        ASKAPCHECK(direction.size() == 3, "Direction should have exactly 3 parameters, you have "<<direction.size());
@@ -254,8 +260,35 @@ void AdviseParallel::calcOne(const std::string &ms)
 {
    casa::Timer timer;
    timer.mark();
-   ASKAPLOG_INFO_STR(logger, "Performing iteration to accumulate metadata statistics for " << ms );
    ASKAPDEBUGASSERT(itsEstimator);
+
+   // the index only gives statistics which don't depend on the tangent point
+   const bool indexApplicable = !hasDataSelection(parset());
+   const std::string freqFrame = casa::MFrequency::showType(getFreqRefFrame().getType());
+   if (indexApplicable && itsUseIndex && !itsTangentDefined) {
+       VisMetaDataIndex index;
+       if (VisMetaDataIndex::load(ms, freqFrame, index)) {
+           const std::vector<VisMetaDataIndex::Chunk> &chunks = index.chunks();
+           for (size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+                itsEstimator->process(chunks[chunk]);
+           }
+           ASKAPLOG_INFO_STR(logger, "Used metadata index " << VisMetaDataIndex::indexName(ms) << " with " <<
+                             chunks.size() << " chunks for " << ms << " in " << timer.real() << " seconds");
+           return;
+       }
+   }
+
+   // build the index during this pass if requested and there is no usable one already
+   boost::scoped_ptr<VisMetaDataIndex> newIndex;
+   if (indexApplicable && itsWriteIndex) {
+       VisMetaDataIndex existing;
+       if (!VisMetaDataIndex::load(ms, freqFrame, existing)) {
+           newIndex.reset(new VisMetaDataIndex(casa::Table(ms).nrow(), freqFrame,
+                                                VisMetaDataIndex::modificationTime(ms)));
+       }
+   }
+
+   ASKAPLOG_INFO_STR(logger, "Performing iteration to accumulate metadata statistics for " << ms );
    
    accessors::TableDataSource ds(ms, accessors::TableDataSource::MEMORY_BUFFERS, dataColumn());
    ds.configureUVWMachineCache(uvwMachineCacheSize(),uvwMachineCacheTolerance());      
@@ -269,6 +302,14 @@ void AdviseParallel::calcOne(const std::string &ms)
    for (; it.hasMore(); it.next()) {
         // iteration over the dataset
         itsEstimator->process(*it);
+        if (newIndex) {
+            newIndex->add(*it);
+        }
+   }
+   if (newIndex) {
+       newIndex->write(VisMetaDataIndex::indexName(ms));
+       ASKAPLOG_INFO_STR(logger, "Wrote metadata index " << VisMetaDataIndex::indexName(ms) << " with " <<
+                         newIndex->chunks().size() << " chunks");
    }
    
    ASKAPLOG_INFO_STR(logger, "Finished iteration for "<< ms << " in "<< timer.real()
@@ -361,6 +402,24 @@ void AdviseParallel::summary() const
    }
 } 
 
+/// @brief check whether the parset selects a subset of data
+/// @details The metadata index describes the whole measurement set, so it can
+/// only be used if no data selection is done.
+/// @param parset ParameterSet for inputs
+/// @return true if any of the data selection keywords is present
+bool AdviseParallel::hasDataSelection(const LOFAR::ParameterSet& parset)
+{
+  // keywords understood by the data selector (see dataaccess/ParsetInterface.cc)
+  const char* keywords[] = {"Feed", "Baseline", "Channels", "SpectralWindow", "Polarizations",
+                            "Cycles", "TimeRange", "CorrelationType", "MinUV", "MaxUV", "ScanNumber"};
+  for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+       if (parset.isDefined(keywords[i])) {
+           return true;
+       }
+  }
+  return false;
+}
+
 /// @brief a hopefully temporary method to define missing fields in parset
 /// @details We reuse some code for general synthesis application, but it requires some
 /// parameters (like gridder) to be defined. This method fills the parset with stubbed fields.
@@ -108,6 +108,13 @@ protected:
    /// @return new parset 
    static LOFAR::ParameterSet addMissingFields(const LOFAR::ParameterSet& parset);
 
+   /// @brief check whether the parset selects a subset of data
+   /// @details The metadata index describes the whole measurement set, so it can
+   /// only be used if no data selection is done.
+   /// @param parset ParameterSet for inputs
+   /// @return true if any of the data selection keywords is present
+   static bool hasDataSelection(const LOFAR::ParameterSet& parset);
+
 
    /// @brief helper method to broadcast statistics to all workers
    /// @details It seems better conceptually, if all ranks hold the same statistics at the end of
@@ -129,6 +136,12 @@ private:
    /// @details Or a negative value if no snap-shot imaging is required.
    double itsWTolerance;
    
+   /// @brief true, if the metadata index is used when available
+   bool itsUseIndex;
+
+   /// @brief true, if the metadata index is written while iterating over the data
+   bool itsWriteIndex;
+
    /// @brief statistics estimator
   boost::shared_ptr<VisMetaDataStats> itsEstimator;    
 };
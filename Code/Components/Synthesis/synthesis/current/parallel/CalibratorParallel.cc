@@ -56,6 +56,7 @@ ASKAP_LOGGER(logger, ".parallel");
 // own includes
 #include <askap/AskapError.h>
 #include <askap/AskapUtil.h>
+#include <askap/CasaTableLock.h>
 
 #include <dataaccess/TableDataSource.h>
 #include <dataaccess/ParsetInterface.h>
@@ -88,6 +89,9 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <casa/aips.h>
 #include <casa/OS/Timer.h>
 
+// boost includes
+#include <boost/bind.hpp>
+
 using namespace askap;
 using namespace askap::scimath;
 using namespace askap::synthesis;
@@ -105,7 +109,8 @@ CalibratorParallel::CalibratorParallel(askap::askapparallel::AskapParallel& comm
       MEParallelApp(comms,parset), 
       itsPerfectModel(new scimath::Params()), itsSolveGains(false), itsSolveLeakage(false),
       itsSolveBandpass(false), itsChannelsPerWorker(0), itsStartChan(0),
-      itsBeamIndependentGains(false), itsSolutionInterval(-1.)
+      itsBeamIndependentGains(false), itsSolutionInterval(-1.), itsPrefetch(false),
+      itsSolutionBatchSize(1)
 {  
   const std::string what2solve = parset.getString("solve","gains");
   if (what2solve.find("gains") != std::string::npos) {
@@ -143,6 +148,13 @@ CalibratorParallel::CalibratorParallel(askap::askapparallel::AskapParallel& comm
       // setup solution source (or sink to be exact, because we're writing the solution here)
       itsSolutionSource = CalibAccessFactory::rwCalSolutionSource(parset);
       ASKAPASSERT(itsSolutionSource);
+
+      const int batchSize = parset.getInt32("solutionbatch",1);
+      ASKAPCHECK(batchSize > 0, "Number of solutions written in one batch should be positive, you have "<<batchSize);
+      itsSolutionBatchSize = static_cast<casa::uInt>(batchSize);
+      if (itsSolutionBatchSize > 1) {
+          ASKAPLOG_INFO_STR(logger, "Calibration solutions will be written in batches of "<<itsSolutionBatchSize<<" intervals");
+      }
   }
   if (itsComms.isWorker()) {
   
@@ -163,10 +175,30 @@ CalibratorParallel::CalibratorParallel(askap::askapparallel::AskapParallel& comm
           ASKAPLOG_INFO_STR(logger, "A single solution will be made for the whole duration of the dataset");
       } else {
           ASKAPLOG_INFO_STR(logger, "Solution will be made for each "<<itsSolutionInterval<<" seconds chunk of the dataset");
+          itsPrefetch = parset.getBool("prefetch", false);
+          if (itsPrefetch) {
+              ASKAPLOG_INFO_STR(logger, "Next time chunk will be pre-averaged in the background while the current one is solved");
+          }
       }
   }
 }
 
+/// @brief destructor
+/// @details Waits for the background pre-averaging (if any) to finish and
+/// writes solutions still held in the buffer.
+CalibratorParallel::~CalibratorParallel()
+{
+  try {
+     if (itsPrefetchThread) {
+         itsPrefetchThread->join();
+     }
+     flushSolutions();
+  }
+  catch (const std::exception &ex) {
+     ASKAPLOG_ERROR_STR(logger, "Error in CalibratorParallel destructor: "<<ex.what());
+  }
+}
+
 /// @brief initalise measurement equation and model
 /// @details This method is indended to be called if this object is reused to
 /// get more than one solution. It initialises the model and normal equations.
@@ -359,6 +391,37 @@ void CalibratorParallel::createCalibrationME(const IDataSharedIter &dsi,
    // code with pre-averaging
    // it is handy to have a shared pointer to the base type because it is
    // not templated
+   boost::shared_ptr<PreAvgCalMEBase> preAvgME = waitForPrefetch();
+   if (preAvgME) {
+       ASKAPLOG_INFO_STR(logger, "Using the data pre-averaged in the background for this solution interval");
+   } else {
+       preAvgME = createPreAvgME();
+       preAvgME->accumulate(dsi,perfectME);
+   }
+   itsEquation = preAvgME;
+ 
+   // set helper parameter controlling which part of bandpass is solved for (ignored in all other cases)
+   setChannelOffsetInModel();
+          
+   // this is just because we bypass setting the model for the first major cycle
+   // in the case without pre-averaging
+   itsEquation->setParameters(*itsModel);
+   // set the next chunk flag, if necessary (time-dependent solution is supported only with pre-averaging)
+   const bool moreData = nextChunk();
+   setNextChunkFlag(moreData);
+   // pre-averaging doesn't depend on the model being solved for, so the next chunk can be
+   // processed while this one is iterated upon 
+   if (moreData && itsPrefetch) {
+       startPrefetch();
+   }
+  }
+}
+
+/// @brief create an empty pre-averaging measurement equation
+/// @details The type of the calibration effect is chosen according to the internal flags.
+/// @return shared pointer to the new measurement equation (not yet filled with data)
+boost::shared_ptr<PreAvgCalMEBase> CalibratorParallel::createPreAvgME() const
+{
    boost::shared_ptr<PreAvgCalMEBase> preAvgME;
    if (itsSolveGains && !itsSolveLeakage) {
        if (itsBeamIndependentGains) {
@@ -382,20 +445,74 @@ void CalibratorParallel::createCalibrationME(const IDataSharedIter &dsi,
    ASKAPDEBUGASSERT(preAvgME);
    // this is just an optimisation, should work without this line
    preAvgME->beamIndependent(itsBeamIndependentGains);
-   preAvgME->accumulate(dsi,perfectME);
-   itsEquation = preAvgME;
- 
-   // set helper parameter controlling which part of bandpass is solved for (ignored in all other cases)
-   setChannelOffsetInModel();
-          
-   // this is just because we bypass setting the model for the first major cycle
-   // in the case without pre-averaging
-   itsEquation->setParameters(*itsModel);
-   // set the next chunk flag, if necessary (time-dependent solution is supported only with pre-averaging)
-   setNextChunkFlag(nextChunk());
+   return preAvgME;
+}
+
+/// @brief start pre-averaging of the next time chunk in the background
+/// @details The iterator adapter should have been resumed already. The result is
+/// picked up by waitForPrefetch.
+void CalibratorParallel::startPrefetch()
+{
+  ASKAPDEBUGASSERT(itsComms.isWorker());
+  ASKAPCHECK(!itsPrefetchThread, "Background pre-averaging is already in progress");
+  ASKAPCHECK(itsIteratorAdapter, "Iterator adapter is not defined in startPrefetch!");
+  ASKAPCHECK(itsPerfectME, "Uncorrupted measurement equation is not defined in startPrefetch!");
+  itsPrefetchedME.reset();
+  itsPrefetchError = "";
+  ASKAPLOG_INFO_STR(logger, "Starting pre-averaging of the next solution interval in the background");
+  itsPrefetchThread.reset(new boost::thread(boost::bind(&CalibratorParallel::prefetchNextChunk, this)));
+}
+
+/// @brief body of the background pre-averaging thread
+/// @details Fills itsPrefetchedME or sets itsPrefetchError. No synchronisation is
+/// required for the result as it is only accessed after the thread has been joined.
+/// The measurement set is read (and measures are used for the prediction) with the
+/// table lock held, one iteration at a time, because in the serial mode the same
+/// process writes calibration tables at the same time (see flushSolutions).
+void CalibratorParallel::prefetchNextChunk()
+{
+  try {
+     boost::shared_ptr<PreAvgCalMEBase> preAvgME = createPreAvgME();
+     IDataSharedIter it(itsIteratorAdapter);
+     while (true) {
+        CasaTableLock lock;
+        if (!it.hasMore()) {
+            break;
+        }
+        preAvgME->accumulate(*it, itsPerfectME);
+        it.next();
+     }
+     itsPrefetchedME = preAvgME;
+  }
+  catch (const std::exception &ex) {
+     itsPrefetchError = ex.what();
+  }
+  catch (...) {
+     itsPrefetchError = "unknown exception";
   }
 }
 
+/// @brief wait for the background pre-averaging to finish
+/// @details Any exception thrown in the background thread is rethrown here as AskapError.
+/// @return measurement equation filled with the data of the next time chunk or an empty 
+/// shared pointer if no pre-averaging has been started
+boost::shared_ptr<PreAvgCalMEBase> CalibratorParallel::waitForPrefetch()
+{
+  boost::shared_ptr<PreAvgCalMEBase> result;
+  if (itsPrefetchThread) {
+      casa::Timer timer;
+      timer.mark();
+      itsPrefetchThread->join();
+      itsPrefetchThread.reset();
+      ASKAPLOG_INFO_STR(logger, "Waited "<<timer.real()<<" seconds for the background pre-averaging to finish");
+      ASKAPCHECK(itsPrefetchError == "", "Background pre-averaging of the next solution interval failed: "<<itsPrefetchError);
+      result = itsPrefetchedME;
+      itsPrefetchedME.reset();
+      ASKAPDEBUGASSERT(result);
+  }
+  return result;
+}
+
 /// @brief helper method to update channel offset
 /// @details To be able to process a subset of channels we specify the offset
 /// in the model. However, this offset needs to be reset per worker in the 
@@ -644,40 +761,74 @@ bool CalibratorParallel::nextChunk() const
 
 /// @brief Write the results (runs in the solver)
 /// @details The solution (calibration parameters) is written into 
-/// an external file in the parset file format.
+/// an external file in the parset file format. Solutions are buffered
+/// and written in batches (see flushSolutions).
 /// @param[in] postfix a string to be added to the file name
 void CalibratorParallel::writeModel(const std::string &postfix)
 {
   if (itsComms.isMaster()) {
-      ASKAPLOG_INFO_STR(logger, "Writing results of the calibration");
       ASKAPCHECK(postfix == "", "postfix parameter is not supposed to be used in the calibration code");
+      ASKAPDEBUGASSERT(itsModel);
+      itsPendingSolutions.push_back(std::make_pair(solutionTime(), itsModel->clone()));
+      if (itsPendingSolutions.size() >= itsSolutionBatchSize) {
+          flushSolutions();
+      }
+  }
+}
+
+/// @brief write all buffered solutions
+/// @details Solutions are accumulated by writeModel in the master and written
+/// to the solution source in batches. This method writes whatever is left in the
+/// buffer. It does nothing in workers or if the buffer is empty. The solutions are
+/// written with the table lock held as the background pre-averaging may be reading
+/// the measurement set in the same process.
+void CalibratorParallel::flushSolutions()
+{
+  if (itsComms.isMaster() && (itsPendingSolutions.size() > 0)) {
+      ASKAPLOG_INFO_STR(logger, "Writing results of the calibration for "<<itsPendingSolutions.size()<<" solution interval(s)");
+      casa::Timer timer;
+      timer.mark();
+      std::vector<std::pair<double, scimath::Params::ShPtr> > solutions;
+      solutions.swap(itsPendingSolutions);
+      CasaTableLock lock;
+      for (std::vector<std::pair<double, scimath::Params::ShPtr> >::const_iterator ci = solutions.begin();
+           ci != solutions.end(); ++ci) {
+           ASKAPDEBUGASSERT(ci->second);
+           writeSolution(ci->first, *(ci->second));
+      }
+      ASKAPLOG_INFO_STR(logger, "Wrote calibration solutions in "<<timer.real()<<" seconds");
+  }
+}
 
-      ASKAPCHECK(itsSolutionSource, "Solution source has to be defined by this stage");
+/// @brief write one solution into the solution source
+/// @param[in] time time tag of the solution (seconds since 0 MJD)
+/// @param[in] model parameters to write (only free parameters are written)
+void CalibratorParallel::writeSolution(double time, const scimath::Params &model) const
+{
+  ASKAPCHECK(itsSolutionSource, "Solution source has to be defined by this stage");
 
-      const long solutionID = itsSolutionSource->newSolutionID(solutionTime());
-      boost::shared_ptr<ICalSolutionAccessor> solAcc = itsSolutionSource->rwSolution(solutionID);
-      ASKAPASSERT(solAcc);
+  const long solutionID = itsSolutionSource->newSolutionID(time);
+  boost::shared_ptr<ICalSolutionAccessor> solAcc = itsSolutionSource->rwSolution(solutionID);
+  ASKAPASSERT(solAcc);
       
-      ASKAPDEBUGASSERT(itsModel);
-      std::vector<std::string> parlist = itsModel->freeNames();
-      for (std::vector<std::string>::const_iterator it = parlist.begin(); 
-           it != parlist.end(); ++it) {
-           const casa::Complex val = itsModel->complexValue(*it);
-           if (itsSolveBandpass) {
-               ASKAPCHECK(it->find(accessors::CalParamNameHelper::bpPrefix()) == 0, 
-                       "Expect parameter name starting from "<<accessors::CalParamNameHelper::bpPrefix()<<
-                       " for the bandpass calibration, you have "<<*it);
-               const std::pair<casa::uInt, std::string> parsedParam = 
-                       accessors::CalParamNameHelper::extractChannelInfo(*it);
-               const std::pair<accessors::JonesIndex, casa::Stokes::StokesTypes> paramType = 
-                    accessors::CalParamNameHelper::parseParam(parsedParam.second);
-               solAcc->setBandpassElement(paramType.first, paramType.second, parsedParam.first, val);                 
-           } else {
-               const std::pair<accessors::JonesIndex, casa::Stokes::StokesTypes> paramType = 
-                    accessors::CalParamNameHelper::parseParam(*it);
-               solAcc->setJonesElement(paramType.first, paramType.second, val);
-           }
-      }
+  std::vector<std::string> parlist = model.freeNames();
+  for (std::vector<std::string>::const_iterator it = parlist.begin(); 
+       it != parlist.end(); ++it) {
+       const casa::Complex val = model.complexValue(*it);
+       if (itsSolveBandpass) {
+           ASKAPCHECK(it->find(accessors::CalParamNameHelper::bpPrefix()) == 0, 
+                   "Expect parameter name starting from "<<accessors::CalParamNameHelper::bpPrefix()<<
+                   " for the bandpass calibration, you have "<<*it);
+           const std::pair<casa::uInt, std::string> parsedParam = 
+                   accessors::CalParamNameHelper::extractChannelInfo(*it);
+           const std::pair<accessors::JonesIndex, casa::Stokes::StokesTypes> paramType = 
+                accessors::CalParamNameHelper::parseParam(parsedParam.second);
+           solAcc->setBandpassElement(paramType.first, paramType.second, parsedParam.first, val);                 
+       } else {
+           const std::pair<accessors::JonesIndex, casa::Stokes::StokesTypes> paramType = 
+                accessors::CalParamNameHelper::parseParam(*it);
+           solAcc->setJonesElement(paramType.first, paramType.second, val);
+       }
   }
 }
 
@@ -39,8 +39,10 @@
 #include <Common/ParameterSet.h>
 #include <gridding/IVisGridder.h>
 #include <measurementequation/IMeasurementEquation.h>
+#include <measurementequation/PreAvgCalMEBase.h>
 #include <dataaccess/SharedIter.h>
 #include <fitting/Solver.h>
+#include <fitting/Params.h>
 #include <calibaccess/ICalSolutionSource.h>
 #include <dataaccess/TimeChunkIteratorAdapter.h>
 
@@ -48,9 +50,11 @@
 // std includes
 #include <string>
 #include <vector>
+#include <utility>
 
 // boost includes
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 namespace askap
 {
@@ -76,7 +80,14 @@ namespace askap
     ///  	Ccalibrator.gridder.WProject.oversample     = 1
     ///  	Ccalibrator.gridder.WProject.cutoff         = 0.001
     ///
+    ///  	Ccalibrator.interval                     = 10min
+    ///  	Ccalibrator.prefetch                     = true  # default is false
+    ///  	Ccalibrator.solutionbatch                = 16    # default is 1
     /// @endcode
+    /// With a finite solution interval and prefetch = true, workers pre-average the next
+    /// time chunk in a background thread while the current interval is being iterated on,
+    /// solved and written by the master. Solutions are buffered by the master and written 
+    /// to the solution source in batches of solutionbatch intervals.
     /// @ingroup parallel
     class CalibratorParallel : public MEParallelApp
     {
@@ -92,6 +103,11 @@ namespace askap
       CalibratorParallel(askap::askapparallel::AskapParallel& comms,
           const LOFAR::ParameterSet& parset);
 
+      /// @brief destructor
+      /// @details Waits for the background pre-averaging (if any) to finish and
+      /// writes solutions still held in the buffer.
+      virtual ~CalibratorParallel();
+
       /// @brief Calculate the normal equations (runs in the prediffers)
       /// @details ImageFFTEquation and the specified gridder (set in the parset
       /// file) are used in conjunction with CalibrationME to calculate 
@@ -108,6 +124,14 @@ namespace askap
       /// an external file in the parset file format.
       /// @param[in] postfix a string to be added to the file name
 	  virtual void writeModel(const std::string &postfix = std::string());
+
+      /// @brief write all buffered solutions
+      /// @details Solutions are accumulated by writeModel in the master and written
+      /// to the solution source in batches. This method writes whatever is left in the
+      /// buffer. It does nothing in workers or if the buffer is empty. The solutions are
+      /// written with the table lock held as the background pre-averaging may be reading
+      /// the measurement set in the same process.
+      void flushSolutions();
   
       /// @brief helper method to extract next chunk flag
       /// @details This method is a reverse operation to that of setNextChunkFlag. It
@@ -160,6 +184,29 @@ namespace askap
       /// @param[in] perfectME uncorrupted measurement equation
       void createCalibrationME(const accessors::IDataSharedIter &dsi, 
                 const boost::shared_ptr<IMeasurementEquation const> &perfectME);
+
+      /// @brief create an empty pre-averaging measurement equation
+      /// @details The type of the calibration effect is chosen according to the internal flags.
+      /// @return shared pointer to the new measurement equation (not yet filled with data)
+      boost::shared_ptr<PreAvgCalMEBase> createPreAvgME() const;
+
+      /// @brief start pre-averaging of the next time chunk in the background
+      /// @details The iterator adapter should have been resumed already. The result is
+      /// picked up by waitForPrefetch.
+      void startPrefetch();
+
+      /// @brief wait for the background pre-averaging to finish
+      /// @details Any exception thrown in the background thread is rethrown here as AskapError.
+      /// @return measurement equation filled with the data of the next time chunk or an empty 
+      /// shared pointer if no pre-averaging has been started
+      boost::shared_ptr<PreAvgCalMEBase> waitForPrefetch();
+
+      /// @brief body of the background pre-averaging thread
+      /// @details Fills itsPrefetchedME or sets itsPrefetchError. No synchronisation is
+      /// required for the result as it is only accessed after the thread has been joined.
+      /// The measurement set is read with the table lock held, one iteration at a time,
+      /// as the master may write calibration tables in the same process (serial mode).
+      void prefetchNextChunk();
   
       /// @brief helper method to rotate all phases
       /// @details This method rotates the phases of all gains in itsModel
@@ -188,6 +235,11 @@ namespace askap
       /// parallel case for the correct operation. This method encapsulates the required
       /// code of setting the channel offset to the value of itsStartChan
       void setChannelOffsetInModel() const; 
+
+      /// @brief write one solution into the solution source
+      /// @param[in] time time tag of the solution (seconds since 0 MJD)
+      /// @param[in] model parameters to write (only free parameters are written)
+      void writeSolution(double time, const scimath::Params &model) const;
          
   private:
       /// @brief read the model from parset file and populate itsPerfectModel
@@ -249,6 +301,27 @@ namespace askap
       /// @details It is handy to store the perfect measurement equation, so it is not
       /// recreated every time for each solution interval. 
       boost::shared_ptr<IMeasurementEquation const> itsPerfectME;
+
+      /// @brief true, if the next time chunk is to be pre-averaged in the background
+      /// @details Only used in workers with a finite solution interval.
+      bool itsPrefetch;
+
+      /// @brief thread doing the pre-averaging of the next time chunk
+      /// @details empty shared pointer means no background pre-averaging is in progress
+      boost::shared_ptr<boost::thread> itsPrefetchThread;
+
+      /// @brief measurement equation filled by the background thread
+      boost::shared_ptr<PreAvgCalMEBase> itsPrefetchedME;
+
+      /// @brief error message from the background thread, empty if no error occurred
+      std::string itsPrefetchError;
+
+      /// @brief number of solution intervals to buffer before writing
+      casa::uInt itsSolutionBatchSize;
+
+      /// @brief solutions waiting to be written (time tag and a copy of the model)
+      /// @details This buffer is only used in the master.
+      std::vector<std::pair<double, scimath::Params::ShPtr> > itsPendingSolutions;
     };
 
   }
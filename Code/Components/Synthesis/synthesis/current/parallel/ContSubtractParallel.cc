@@ -113,7 +113,10 @@ void ContSubtractParallel::initMeasurementEquation()
    if (SynthesisParamsHelper::hasImage(itsModel)) {
        ASKAPLOG_INFO_STR(logger, "Sky model contains at least one image, building an image-specific equation");
        // it should ignore parameters which are not applicable (e.g. components)
-       imgEquation.reset(new ImageFFTEquation(*itsModel, stubIter, gridder()));
+       boost::shared_ptr<ImageFFTEquation> fftEquation(new ImageFFTEquation(*itsModel, stubIter, gridder()));
+       ASKAPDEBUGASSERT(fftEquation);
+       fftEquation->setUVWMachineCache(uvwMachineCacheSize(),uvwMachineCacheTolerance());
+       imgEquation = fftEquation;
    }
 
    // a part of the equation defined via components
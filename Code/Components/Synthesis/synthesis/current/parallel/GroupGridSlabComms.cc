@@ -0,0 +1,106 @@
+/// @file
+/// 
+/// @brief Exchange of grid slabs between groups of workers
+/// @details If the uv-grid is split into slabs, each group of workers holds one slab 
+/// and the ranks at the same position in each group exchange parts of their slabs
+/// via the intergroup communicator during the distributed FFT.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <parallel/GroupGridSlabComms.h>
+
+#include <askap_synthesis.h>
+#include <askap/AskapLogging.h>
+ASKAP_LOGGER(logger, ".parallel.groupgridslabcomms");
+
+#include <askap/AskapError.h>
+
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief constructor, sets up communication class
+/// @param[in] comms communication object
+GroupGridSlabComms::GroupGridSlabComms(askap::askapparallel::AskapParallel& comms) : itsComms(comms), itsCommIndex(0)
+{
+  ASKAPCHECK(itsComms.isWorker(), "Grid slabs are only held by workers");
+  itsCommIndex = itsComms.interGroupCommIndex();
+  ASKAPLOG_DEBUG_STR(logger, "Grid slab "<<itsComms.group()<<" out of "<<itsComms.nGroups()<<
+                     ", intergroup communicator index: "<<itsCommIndex);
+}
+
+/// @brief number of slabs the grid is split into
+/// @return number of groups of workers
+casa::uInt GroupGridSlabComms::nSlabs() const
+{
+  return casa::uInt(itsComms.nGroups());
+}
+
+/// @brief slab held by this process
+/// @return group number of this worker
+casa::uInt GroupGridSlabComms::slab() const
+{
+  return casa::uInt(itsComms.group());
+}
+
+/// @brief exchange raw buffers with another group
+/// @param[in] partner slab number of the other process (not equal to slab())
+/// @param[in] sendBuf buffer to send
+/// @param[in] sendSize number of bytes to send
+/// @param[in] recvBuf buffer to receive into
+/// @param[in] recvSize number of bytes to receive
+void GroupGridSlabComms::exchange(casa::uInt partner, const void *sendBuf, size_t sendSize, 
+                                  void *recvBuf, size_t recvSize) const
+{
+  ASKAPDEBUGASSERT(partner < nSlabs());
+  ASKAPDEBUGASSERT(partner != slab());
+  if (slab() < partner) {
+      itsComms.send(sendBuf, sendSize, int(partner), 0, itsCommIndex);
+      itsComms.receive(recvBuf, recvSize, int(partner), 0, itsCommIndex);
+  } else {
+      itsComms.receive(recvBuf, recvSize, int(partner), 0, itsCommIndex);
+      itsComms.send(sendBuf, sendSize, int(partner), 0, itsCommIndex);
+  }
+}
+
+/// @brief helper method to create an instance of this class
+/// @details An empty shared pointer is returned if there is no groupping of workers
+/// or if this rank is the master
+/// @param[in] comms communication object
+/// @return shared pointer to an instance of this class  
+boost::shared_ptr<GroupGridSlabComms> GroupGridSlabComms::create(askap::askapparallel::AskapParallel& comms)
+{
+  if ((comms.nGroups() > 1) && comms.isWorker()) {
+      boost::shared_ptr<GroupGridSlabComms> result(new GroupGridSlabComms(comms));
+      return result;
+  }
+  ASKAPLOG_DEBUG_STR(logger, "No groupping of workers on this rank, the grid is not split into slabs");
+  return boost::shared_ptr<GroupGridSlabComms>();
+}
+
+} // namespace synthesis
+
+} // namespace askap
+
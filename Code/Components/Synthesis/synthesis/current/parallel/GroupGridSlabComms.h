@@ -0,0 +1,93 @@
+/// @file
+/// 
+/// @brief Exchange of grid slabs between groups of workers
+/// @details If the uv-grid is split into slabs, each group of workers holds one slab 
+/// and the ranks at the same position in each group exchange parts of their slabs
+/// via the intergroup communicator during the distributed FFT.
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef GROUP_GRID_SLAB_COMMS_H
+#define GROUP_GRID_SLAB_COMMS_H
+
+#include <gridding/IGridSlabComms.h>
+#include <askapparallel/AskapParallel.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief Exchange of grid slabs between groups of workers
+/// @details The slab number is the group number, the rank in the intergroup
+/// communicator is the same as the group number. MPI calls are blocking, so
+/// within each pair the lower slab sends first and the other one receives first.
+/// @ingroup parallel
+class GroupGridSlabComms : public IGridSlabComms {
+public:
+
+  /// @brief constructor, sets up communication class
+  /// @param[in] comms communication object
+  explicit GroupGridSlabComms(askap::askapparallel::AskapParallel& comms);
+
+  /// @brief number of slabs the grid is split into
+  /// @return number of groups of workers
+  virtual casa::uInt nSlabs() const;
+  
+  /// @brief slab held by this process
+  /// @return group number of this worker
+  virtual casa::uInt slab() const;
+  
+  /// @brief exchange raw buffers with another group
+  /// @param[in] partner slab number of the other process (not equal to slab())
+  /// @param[in] sendBuf buffer to send
+  /// @param[in] sendSize number of bytes to send
+  /// @param[in] recvBuf buffer to receive into
+  /// @param[in] recvSize number of bytes to receive
+  virtual void exchange(casa::uInt partner, const void *sendBuf, size_t sendSize, 
+                        void *recvBuf, size_t recvSize) const;
+
+  /// @brief helper method to create an instance of this class
+  /// @details An empty shared pointer is returned if there is no groupping of workers
+  /// or if this rank is the master
+  /// @param[in] comms communication object
+  /// @return shared pointer to an instance of this class  
+  static boost::shared_ptr<GroupGridSlabComms> create(askap::askapparallel::AskapParallel& comms);
+
+private:
+  
+  /// @brief class for communications
+  askap::askapparallel::AskapParallel& itsComms;  
+  
+  /// @brief communicator index
+  size_t itsCommIndex;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
+
+#endif // #ifndef GROUP_GRID_SLAB_COMMS_H
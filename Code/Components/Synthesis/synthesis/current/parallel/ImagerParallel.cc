@@ -42,11 +42,13 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <askap/AskapError.h>
 // need it just for null deleter
 #include <askap/AskapUtil.h>
+#include <askap/TaskScheduler.h>
 
 #include <askapparallel/AskapParallel.h>
 #include <dataaccess/DataAccessError.h>
 #include <dataaccess/TableDataSource.h>
 #include <dataaccess/ParsetInterface.h>
+#include <dataaccess/BaselineAveragingIterator.h>
 
 #include <measurementequation/ImageFFTEquation.h>
 #include <measurementequation/SynthesisParamsHelper.h>
@@ -56,6 +58,7 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <measurementequation/NoXPolGain.h>
 #include <measurementequation/ImageParamsHelper.h>
 #include <fitting/Params.h>
+#include <fitting/ImagingNormalEquations.h>
 #include <utils/MultiDimArrayPlaneIter.h>
 
 #include <measurementequation/ImageSolverFactory.h>
@@ -63,6 +66,10 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <measurementequation/CalibrationApplicatorME.h>
 #include <profile/AskapProfiler.h>
 #include <parallel/GroupVisAggregator.h>
+#include <parallel/GroupGridSlabComms.h>
+#include <gridding/TableVisGridder.h>
+#include <gridding/GridSlabFFT.h>
+#include <utils/PaddingUtils.h>
 #include <parallel/AdviseParallel.h>
 
 #include <casa/aips.h>
@@ -74,6 +81,7 @@ ASKAP_LOGGER(logger, ".parallel");
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
 
 using namespace askap;
 using namespace askap::scimath;
@@ -90,8 +98,23 @@ namespace askap
     ImagerParallel::ImagerParallel(askap::askapparallel::AskapParallel& comms,
         const LOFAR::ParameterSet& parset) :
       MEParallelApp(comms,parset),
-      itsExportSensitivityImage(false), itsExpSensitivityCutoff(0.)
+      itsExportSensitivityImage(false), itsExpSensitivityCutoff(0.), itsDistributeGrid(false)
     {
+      // thread budget of this rank, shared by all parallel stages (by default, the cores of 
+      // the node are shared evenly between the ranks running on it)
+      const casa::uInt nThreads = parset.getUint("nthreads", 0);
+      const bool pinThreads = parset.getBool("nthreads.pin", TaskScheduler::defaultPinning());
+      if ((nThreads > 0) || pinThreads) {
+          TaskScheduler::instance().setThreadBudget(nThreads, pinThreads);
+      }
+      ASKAPLOG_INFO_STR(logger, "Thread budget of rank "<<itsComms.rank()<<" is "<<
+                        TaskScheduler::instance().threadBudget()<<(pinThreads ? ", threads are pinned to cores" : ""));
+
+      itsDistributeGrid = parset.getBool("distributegrid", false) && (itsComms.nGroups() > 1);
+      if (parset.getBool("distributegrid", false) && !itsDistributeGrid) {
+          ASKAPLOG_WARN_STR(logger, "distributegrid=true requires multiple groups of workers (nworkergroups), "
+                            "the grid will not be split");
+      }
       if (itsComms.isMaster())
       {      
         itsRestore=parset.getBool("restore", false);
@@ -156,6 +179,19 @@ namespace askap
         } else {
             ASKAPLOG_INFO_STR(logger, "No calibration will be performed");
         }         
+        if (itsDistributeGrid) {
+            // each group of workers holds a slab of the uv-grid, the degridded visibilities
+            // are summed up across the groups by GroupVisAggregator
+            const boost::shared_ptr<TableVisGridder> tvg = 
+                  boost::dynamic_pointer_cast<TableVisGridder>(gridder());
+            ASKAPCHECK(tvg, "Splitting the grid into slabs requires a gridder derived from TableVisGridder, "
+                       "gridder adapters (e.g. snapshot imaging) are not supported");
+            const casa::uInt halo = parset.getUint("distributegrid.halo", 64);
+            const boost::shared_ptr<GridSlabFFT> slabs(new GridSlabFFT(GroupGridSlabComms::create(itsComms), halo));
+            ASKAPLOG_INFO_STR(logger, "The uv-grid will be split into "<<slabs->nSlabs()<<
+                              " slabs, this worker holds slab "<<slabs->slab()<<" with the halo of "<<halo<<" rows");
+            tvg->setGridSlabs(slabs);
+        }
       }
     }
 
@@ -446,6 +482,27 @@ namespace askap
 
     }
 
+    /// @brief wrap the iterator into the baseline-dependent averaging adapter, if required
+    /// @details The adapter is only set up if bdaveraging=true in the parset. It is applied
+    /// after calibration, so time-dependent gains are taken out before averaging.
+    /// @param[in] it input iterator
+    /// @return either the same iterator or the averaging adapter
+    IDataSharedIter ImagerParallel::averagingAdapter(const IDataSharedIter &it) const
+    {
+      if (!parset().getBool("bdaveraging", false)) {
+          return it;
+      }
+      const double fov = asQuantity(parset().getString("bdaveraging.fov", "1deg")).getValue("rad");
+      const double maxDecorrelation = parset().getDouble("bdaveraging.maxdecorr", 0.01);
+      const double maxInterval = asQuantity(parset().getString("bdaveraging.maxinterval", "60s")).getValue("s");
+      const casa::uInt maxChannels = parset().getUint("bdaveraging.maxchannels", 1);
+      ASKAPLOG_INFO_STR(logger, "Baseline-dependent averaging is done up to "<<maxDecorrelation*100.<<
+            "% decorrelation across "<<fov/casa::C::pi*180.<<" deg field of view, maximum interval is "<<
+            maxInterval<<" s, up to "<<maxChannels<<" channels are averaged together");
+      return IDataSharedIter(new BaselineAveragingIterator(it, fov, maxDecorrelation, maxInterval, maxChannels,
+                                                           uvwMachineCacheSize(), uvwMachineCacheTolerance()));
+    }
+
     void ImagerParallel::calcOne(const string& ms, bool discard)
     {
       ASKAPDEBUGTRACE("ImagerParallel::calcOne");
@@ -481,10 +538,12 @@ namespace askap
         ASKAPCHECK(gridder(), "Gridder not defined");
         if (!itsSolutionSource) {
             ASKAPLOG_INFO_STR(logger, "No calibration is applied" );
+            it = averagingAdapter(it);
             boost::shared_ptr<ImageFFTEquation> fftEquation(new ImageFFTEquation (*itsModel, it, gridder()));
             ASKAPDEBUGASSERT(fftEquation);
             fftEquation->useSphFuncForPSF(parset().getBool("sphfuncforpsf", false));
             fftEquation->setVisUpdateObject(GroupVisAggregator::create(itsComms));
+            fftEquation->setUVWMachineCache(uvwMachineCacheSize(),uvwMachineCacheTolerance());
             itsEquation = fftEquation;
         } else {
             ASKAPLOG_INFO_STR(logger, "Calibration will be performed using solution source");
@@ -496,11 +555,13 @@ namespace askap
             calME->beamIndependent(parset().getBool("calibrate.ignorebeam", false));
             //
             IDataSharedIter calIter(new CalibrationIterator(it,calME));
+            calIter = averagingAdapter(calIter);
             boost::shared_ptr<ImageFFTEquation> fftEquation(
                           new ImageFFTEquation (*itsModel, calIter, gridder()));
             ASKAPDEBUGASSERT(fftEquation);
             fftEquation->useSphFuncForPSF(parset().getBool("sphfuncforpsf", false));
             fftEquation->setVisUpdateObject(GroupVisAggregator::create(itsComms));
+            fftEquation->setUVWMachineCache(uvwMachineCacheSize(),uvwMachineCacheTolerance());
             itsEquation = fftEquation;
         }
       }
@@ -570,6 +631,174 @@ namespace askap
        }
        return result;
     }
+
+    /// @brief helper method to build the part of the model sent to a group of workers
+    /// @details If the uv-grid is split into slabs, each group gets all parameters, but the
+    /// image parameters are cut down to the image columns of the group's slab. The SLAB axis
+    /// added to their axes gives the first column and the width of the full image (see 
+    /// TableVisGridder::setGridSlabs). Otherwise, the model is distributed between groups
+    /// as in the base class.
+    /// @param[in] names names of the parameters to broadcast
+    /// @param[in] group group of workers
+    /// @param[out] buffer the model to send to the given group
+    void ImagerParallel::groupModel(const std::vector<std::string> &names, size_t group, 
+                                    scimath::Params &buffer) const
+    {
+      if (!itsDistributeGrid) {
+          SynParallel::groupModel(names, group, buffer);
+          return;
+      }
+      ASKAPDEBUGASSERT(itsModel);
+      std::vector<std::string> images;
+      std::vector<std::string> others;
+      for (std::vector<std::string>::const_iterator ci = names.begin(); ci != names.end(); ++ci) {
+           if (ci->find("image") == 0) {
+               images.push_back(*ci);
+           } else {
+               others.push_back(*ci);
+           }
+      }
+      buffer.makeSlice(*itsModel, others);
+      for (std::vector<std::string>::const_iterator ci = images.begin(); ci != images.end(); ++ci) {
+           scimath::Axes axes = itsModel->axes(*ci);
+           ASKAPCHECK(!axes.has("FACETSTEP"), "Faceting is not supported if the uv-grid is split into slabs, "
+                      "image parameter "<<*ci<<" is a facet");
+           const casa::Array<double> &value = itsModel->value(*ci);
+           const casa::IPosition shape = value.shape();
+           ASKAPDEBUGASSERT(shape.nelements() >= 2);
+           const std::pair<int,int> cols = slabColumns(shape(0), group);
+           axes.add("SLAB", cols.first, shape(0));
+           casa::IPosition slabShape(shape);
+           slabShape(0) = cols.second - cols.first;
+           if (slabShape(0) > 0) {
+               casa::IPosition start(shape.nelements(), 0);
+               start(0) = cols.first;
+               buffer.add(*ci, value(casa::Slicer(start, slabShape)), axes);
+           } else {
+               buffer.add(*ci, slabShape, axes);
+           }
+           if (!itsModel->isFree(*ci)) {
+               buffer.fix(*ci);
+           }
+      }
+    }
+
+    /// @brief image columns held by the given group of workers
+    /// @details This method is used if the uv-grid is split into slabs.
+    /// @param[in] nx number of columns of the full image
+    /// @param[in] group group of workers
+    /// @return a pair with the first column and the column past the last
+    std::pair<int,int> ImagerParallel::slabColumns(int nx, size_t group) const
+    {
+      // workers pad the image as set up by VisGridderFactory
+      const float padding = parset().getFloat("gridder.padding", 1.);
+      const int paddedNx = scimath::PaddingUtils::paddedShape(casa::IPosition(2, nx, nx), padding)(0);
+      return GridSlabFFT::imageColumns(nx, paddedNx, itsComms.nGroups(), group);
+    }
+
+    /// @brief Send the normal equations from this worker to the master
+    /// @details If the uv-grid is split into slabs, the normal equations of different
+    /// groups cover different image columns. They are reduced within each group and the 
+    /// first worker of the group sends the result to the master. Otherwise, the reduction
+    /// is done as in the base class.
+    void ImagerParallel::sendNE()
+    {
+      ASKAPTRACE("ImagerParallel::sendNE");
+      if (!itsDistributeGrid) {
+          MEParallelApp::sendNE();
+          return;
+      }
+      if (itsComms.isParallel() && itsComms.isWorker()) {
+          casa::Timer timer;
+          timer.mark();
+          const int nWorkersPerGroup = (itsComms.nProcs() - 1) / int(itsComms.nGroups());
+          const int first = 1 + int(itsComms.group()) * nWorkersPerGroup;
+          ASKAPLOG_DEBUG_STR(logger, "Reducing normal equations within the group of workers starting from rank "<<
+                             first);
+          reduceNE(itsNe, first, nWorkersPerGroup);
+          if (itsComms.rank() == first) {
+              sendNormalEquations(itsNe, 0);
+          }
+          ASKAPLOG_DEBUG_STR(logger, "Reduced normal equations to the solver in "
+                             << timer.real() << " seconds ");
+      }
+    }
+
+    /// @brief Receive the normal equations from all workers into this master
+    /// @details If the uv-grid is split into slabs, the normal equations received from
+    /// the groups are assembled into the normal equations for the full images. Otherwise,
+    /// the reduction is done as in the base class.
+    void ImagerParallel::receiveNE()
+    {
+      ASKAPTRACE("ImagerParallel::receiveNE");
+      if (!itsDistributeGrid) {
+          MEParallelApp::receiveNE();
+          return;
+      }
+      ASKAPCHECK(itsSolver, "Solver not yet defined");
+      if (itsComms.isParallel() && itsComms.isMaster()) {
+          ASKAPLOG_INFO_STR(logger, "Initialising solver");
+          itsSolver->init();
+          ASKAPLOG_INFO_STR(logger, "Waiting for normal equations from "<<itsComms.nGroups()<<" groups of workers");
+          casa::Timer timer;
+          timer.mark();
+          ASKAPDEBUGASSERT(itsModel);
+          // full-size buffers for the normal matrix slice (psf), diagonal (weights) and data vector 
+          std::map<std::string, casa::Vector<double> > slices, diagonals, data;
+          const int nWorkersPerGroup = (itsComms.nProcs() - 1) / int(itsComms.nGroups());
+          for (size_t group = 0; group < itsComms.nGroups(); ++group) {
+               const scimath::INormalEquations::ShPtr groupNE = 
+                     receiveNormalEquations(1 + int(group) * nWorkersPerGroup);
+               const boost::shared_ptr<ImagingNormalEquations> ne = 
+                     boost::dynamic_pointer_cast<ImagingNormalEquations>(groupNE);
+               ASKAPCHECK(ne, "Imaging normal equations are expected if the uv-grid is split into slabs");
+               const std::map<std::string, casa::Vector<double> > &slabData = ne->dataVector();
+               for (std::map<std::string, casa::Vector<double> >::const_iterator ci = slabData.begin();
+                    ci != slabData.end(); ++ci) {
+                    if (ci->second.nelements() == 0) {
+                        continue;
+                    }
+                    const casa::IPosition shape = itsModel->value(ci->first).shape();
+                    const std::pair<int,int> cols = slabColumns(shape(0), group);
+                    const size_t nCols = cols.second - cols.first;
+                    ASKAPCHECK(ci->second.nelements() * shape(0) == nCols * shape.product(), 
+                               "Normal equations for "<<ci->first<<" received from group "<<group<<
+                               " do not match columns ["<<cols.first<<","<<cols.second<<") of the image");
+                    const casa::Vector<double> *slab[3] = {&ne->normalMatrixSlice().find(ci->first)->second,
+                          &ne->normalMatrixDiagonal().find(ci->first)->second, &ci->second};
+                    casa::Vector<double> *full[3] = {&slices[ci->first], &diagonals[ci->first], &data[ci->first]};
+                    for (int i = 0; i < 3; ++i) {
+                         ASKAPCHECK(slab[i]->nelements() == ci->second.nelements(), 
+                                    "Unexpected size of normal equations for "<<ci->first);
+                         if (full[i]->nelements() == 0) {
+                             full[i]->resize(shape.product());
+                             full[i]->set(0.);
+                         }
+                         // copy the image columns of this group, all other axes are the same
+                         const size_t nRows = slab[i]->nelements() / nCols;
+                         for (size_t row = 0; row < nRows; ++row) {
+                              for (size_t col = 0; col < nCols; ++col) {
+                                   (*full[i])[cols.first + col + row * shape(0)] = (*slab[i])[col + row * nCols];
+                              }
+                         }
+                    }
+               }
+          }
+          const boost::shared_ptr<ImagingNormalEquations> ne(new ImagingNormalEquations);
+          for (std::map<std::string, casa::Vector<double> >::const_iterator ci = data.begin(); 
+               ci != data.end(); ++ci) {
+               const casa::IPosition shape = itsModel->value(ci->first).shape();
+               casa::IPosition reference(shape.nelements(), 0);
+               reference(0) = shape(0) / 2;
+               reference(1) = shape(1) / 2;
+               ne->addSlice(ci->first, slices[ci->first], diagonals[ci->first], ci->second, shape, reference);
+          }
+          itsNe = ne;
+          itsSolver->addNormalEquations(*itsNe);
+          ASKAPLOG_INFO_STR(logger, "Received normal equations from all groups of workers in "
+                            << timer.real() << " seconds");
+      }
+    }
     
 
     void ImagerParallel::solveNE()
@@ -126,6 +126,19 @@ namespace askap
       /// multiscale clean can be used, as specified in the parset file.
       virtual void solveNE();
 
+      /// @brief Send the normal equations from this worker to the master
+      /// @details If the uv-grid is split into slabs, the normal equations of different
+      /// groups cover different image columns. They are reduced within each group and the 
+      /// first worker of the group sends the result to the master. Otherwise, the reduction
+      /// is done as in the base class.
+      virtual void sendNE();
+
+      /// @brief Receive the normal equations from all workers into this master
+      /// @details If the uv-grid is split into slabs, the normal equations received from
+      /// the groups are assembled into the normal equations for the full images. Otherwise,
+      /// the reduction is done as in the base class.
+      virtual void receiveNE();
+
       /// @brief Write the results (runs in the solver)
       /// @details The model images are written as AIPS++ images. In addition,
       /// the images may be restored using the specified beam.
@@ -167,9 +180,28 @@ namespace askap
       /// model images and the peak_residual metadata.
       /// @return a vector with parameters to broadcast
       virtual std::vector<std::string> parametersToBroadcast() const;
+
+      /// @brief helper method to build the part of the model sent to a group of workers
+      /// @details If the uv-grid is split into slabs, each group gets all parameters, but the
+      /// image parameters are cut down to the image columns of the group's slab. The SLAB axis
+      /// added to their axes gives the first column and the width of the full image (see 
+      /// TableVisGridder::setGridSlabs). Otherwise, the model is distributed between groups
+      /// as in the base class.
+      /// @param[in] names names of the parameters to broadcast
+      /// @param[in] group group of workers
+      /// @param[out] buffer the model to send to the given group
+      virtual void groupModel(const std::vector<std::string> &names, size_t group, 
+                              scimath::Params &buffer) const;
       
       
   private:
+      /// @brief image columns held by the given group of workers
+      /// @details This method is used if the uv-grid is split into slabs.
+      /// @param[in] nx number of columns of the full image
+      /// @param[in] group group of workers
+      /// @return a pair with the first column and the column past the last
+      std::pair<int,int> slabColumns(int nx, size_t group) const;
+
 
       /// @brief check whether any preProcess advice is needed.
       /// @param parset initial ParameterSet
@@ -194,6 +226,12 @@ namespace askap
       /// @return if advice is needed, returns the name of the gridder. Otherwise, returns an empty string.
       static string wMaxAdviceNeeded(LOFAR::ParameterSet &parset);
 
+      /// @brief wrap the iterator into the baseline-dependent averaging adapter, if required
+      /// @details The adapter is only set up if bdaveraging=true in the parset.
+      /// @param[in] it input iterator
+      /// @return either the same iterator or the averaging adapter
+      accessors::IDataSharedIter averagingAdapter(const accessors::IDataSharedIter &it) const;
+
       /// Calculate normal equations for one data set
       /// @param ms Name of data set
       /// @param discard Discard old equation?
@@ -230,6 +268,11 @@ namespace askap
       /// sensitivity images. This field gives the fraction of the maximum weight
       /// below which the sensitivity image will be set to 0.
       double itsExpSensitivityCutoff;
+
+      /// @brief true, if the uv-grid is split into slabs between groups of workers
+      /// @details In this mode, groups of workers are used to distribute the grid (and
+      /// the FFT), each group gets only the image columns of its slab.
+      bool itsDistributeGrid;
     };
 
   }
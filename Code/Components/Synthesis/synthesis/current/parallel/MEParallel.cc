@@ -55,6 +55,7 @@
 #include <fitting/ImagingNormalEquations.h>
 #include <fitting/GenericNormalEquations.h>
 #include <profile/AskapProfiler.h>
+#include <profile/Metrics.h>
 #include <casa/OS/Timer.h>
 
 ASKAP_LOGGER(logger, ".parallel");
@@ -115,9 +116,15 @@ void MEParallel::receiveNE()
     }
 }
 
+void MEParallel::reduceNE(askap::scimath::INormalEquations::ShPtr ne)
+{
+    reduceNE(ne, 0, itsComms.nProcs());
+}
+
 /*
  * This method performs a graph reduction (using a binary tree topology)
- * from all processes to rank zero. The sequence of workers is mapped to
+ * from all processes in the range to the first of them. The rank relative
+ * to the first process is used below. The sequence of workers is mapped to
  * a binary tree like so:
  * - Rank 0 is the root
  * - To find the parent of a node: floor((rank - 1) / 2)
@@ -139,13 +146,13 @@ void MEParallel::receiveNE()
  * In the above case the result is a perfect binary tree (all leaves are at the
  * same depth) however this method will also handle the imperfect case.
  */ 
-void MEParallel::reduceNE(askap::scimath::INormalEquations::ShPtr ne)
+void MEParallel::reduceNE(askap::scimath::INormalEquations::ShPtr ne, int first, int nProcs)
 {
-    // Number of processes in the reduction
-    const int nProcs = itsComms.nProcs();
+    ASKAPMETRICS_TIMER("normalequations.reduce");
+    ASKAPDEBUGASSERT((itsComms.rank() >= first) && (itsComms.rank() < first + nProcs));
 
-    // Rank (zero-based)
-    const int rank = itsComms.rank();
+    // Rank (zero-based) relative to the root of the tree
+    const int rank = itsComms.rank() - first;
 
     // This is the height of the binary tree. For example:
     // floor(log2(1)) == 0
@@ -171,7 +178,7 @@ void MEParallel::reduceNE(askap::scimath::INormalEquations::ShPtr ne)
         if (depth == level) {
             // This round I am a sender
             const int parent = int(floor((rank - 1) / 2));
-            sendNormalEquations(ne, parent);
+            sendNormalEquations(ne, first + parent);
 
         } else if (depth == level - 1) {
             // This round I am a receiver
@@ -179,13 +186,13 @@ void MEParallel::reduceNE(askap::scimath::INormalEquations::ShPtr ne)
             // Receive from the left child if it exists
             const int left = (2 * rank) + 1;
             if (left < nProcs) {
-                ne->merge(*receiveNormalEquations(left));
+                ne->merge(*receiveNormalEquations(first + left));
             }
 
             // Receive from the right child if it exists
             const int right = (2 * rank) + 2;
             if (right < nProcs) {
-                ne->merge(*receiveNormalEquations(right));
+                ne->merge(*receiveNormalEquations(first + right));
             }
         } else {
             // This round I am a non-participant
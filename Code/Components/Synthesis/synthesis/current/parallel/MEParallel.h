@@ -107,15 +107,23 @@ namespace askap
 				virtual void writeModel(const std::string &postfix = std::string()) = 0;
 
 				/// @brief Send the normal equations from this worker to the master
-				void sendNE();
+				virtual void sendNE();
 
                 /// @brief Receive the normal equations from all workers into this master
-                void receiveNE();
+                virtual void receiveNE();
 
                 /// @brief Perform a reduction for normal equations from all
                 /// workers to the master.
                 void reduceNE(askap::scimath::INormalEquations::ShPtr ne);
 
+                /// @brief Perform a reduction for normal equations within a range of ranks
+                /// @details The binary tree reduction is done for the processes with
+                /// consecutive ranks, the result ends up at the first of them.
+                /// @param[in] ne normal equations to reduce (updated in the root process)
+                /// @param[in] first rank of the root process
+                /// @param[in] nProcs number of processes in the reduction
+                void reduceNE(askap::scimath::INormalEquations::ShPtr ne, int first, int nProcs);
+
 			protected:
 		
                 // Point-to-point send normal equations
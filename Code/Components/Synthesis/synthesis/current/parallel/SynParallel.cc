@@ -127,7 +127,7 @@ namespace askap
         timer.mark();
 
         const std::vector<std::string> names = parametersToBroadcast();
-        if (itsComms.nGroups() == 1) {
+        if (!distributeModel()) {
             ASKAPLOG_INFO_STR(logger, "Sending the whole model to all workers");
             if (names.size() == itsModel->names().size()) {
                 ASKAPLOG_INFO_STR(logger, "About to broadcast all model parameters: "<<names);
@@ -141,54 +141,9 @@ namespace askap
         } else {
             ASKAPLOG_INFO_STR(logger, "Distribute model between "<<itsComms.nGroups()<<
                   " groups of workers");
-            // build two lists of parameters: parameters to distribute and parameters to send to all groups
-            std::vector<std::string> names2distribute;
-            std::vector<std::string> names2keep;
-            names2distribute.reserve(names.size());
-            names2keep.reserve(names.size());            
-            for (std::vector<std::string>::const_iterator ci = names.begin(); ci!=names.end(); ++ci) {
-                 // distribute only parameters starting with "image" for now
-                 if (ci->find("image") == 0) {
-                     names2distribute.push_back(*ci);
-                 } else {
-                     names2keep.push_back(*ci);
-                 }
-            }
-            //
-            ASKAPDEBUGASSERT(itsComms.nGroups() > 1);
-            // number of parameters per group (note the last group can have more)
-            const size_t nPerGroup = names2distribute.size() / itsComms.nGroups();
-            // this check is not relevant if all parameters are in names2keep
-            if (names2distribute.size() > 0) {
-                ASKAPCHECK(nPerGroup > 0, "The model has too few parameters ("<<
-                      names2distribute.size()<<") to distribute between "<< itsComms.nGroups()<<" groups");
-            } else {
-                ASKAPCHECK(names2keep.size() > 0, "The model has too few parameters ("<<
-                      names2keep.size()<<")");
-            }
-            
-            std::vector<std::string> currentNames;
-            currentNames.reserve(itsComms.nGroups() + nPerGroup - 1 + names2keep.size());
             scimath::Params buffer;
-            for (size_t group = 0, index = 0; group<itsComms.nGroups(); ++group, index+=nPerGroup) {
-                 const size_t nPerCurrentGroup = (group + 1 < itsComms.nGroups()) ? 
-                          nPerGroup : names2distribute.size() - index; 
-                 ASKAPDEBUGASSERT((names2distribute.size() > index) || (names2distribute.size() == 0));
-                 if (nPerCurrentGroup != nPerGroup) {
-                     ASKAPLOG_WARN_STR(logger, "An unbalanced distribution of the model has been detected. "
-                                       " the last group ("<<group<<") will have "<<nPerCurrentGroup<<
-                                       " parameters vs. "<<nPerGroup<<" for other groups");
-                 }
-                 currentNames.resize(nPerCurrentGroup + names2keep.size());
-                 for (size_t i = 0; i<nPerCurrentGroup; ++i) {
-                      currentNames[i] = names2distribute[index + i];
-                 }
-                 for (size_t i = 0; i<names2keep.size(); ++i) {
-                      currentNames[nPerCurrentGroup + i] = names2keep[i];
-                 }
-                 ASKAPLOG_INFO_STR(logger, "Group "<<group<<
-                        " will get the following parameters: "<<currentNames);
-                 buffer.makeSlice(*itsModel, currentNames);
+            for (size_t group = 0; group<itsComms.nGroups(); ++group) {
+                 groupModel(names, group, buffer);
                  ASKAPLOG_INFO_STR(logger, "Sending the model to appropriate workers (group "<<
                                  group<<") ");
                  itsComms.useGroupOfWorkers(group);
@@ -219,7 +174,7 @@ namespace askap
         casa::Timer timer;
         timer.mark();
 
-        if (itsComms.nGroups() == 1) {
+        if (!distributeModel()) {
             ASKAPLOG_INFO_STR(logger, "Wait to receive the whole model from the master");
             receiveModelImpl(*itsModel);
         } else {
@@ -307,6 +262,73 @@ namespace askap
        ASKAPDEBUGASSERT(itsModel);
        return itsModel->names();
     }
+
+    /// @brief helper method to build the part of the model sent to a group of workers
+    /// @details By default, parameters starting with "image" are distributed between groups
+    /// and all other parameters are sent to every group. This method is supposed to be 
+    /// overridden in derived classes where groups are used in a different way.
+    /// @param[in] names names of the parameters to broadcast
+    /// @param[in] group group of workers
+    /// @param[out] buffer the model to send to the given group
+    void SynParallel::groupModel(const std::vector<std::string> &names, size_t group, 
+                                 scimath::Params &buffer) const
+    {
+        // build two lists of parameters: parameters to distribute and parameters to send to all groups
+        std::vector<std::string> names2distribute;
+        std::vector<std::string> names2keep;
+        names2distribute.reserve(names.size());
+        names2keep.reserve(names.size());            
+        for (std::vector<std::string>::const_iterator ci = names.begin(); ci!=names.end(); ++ci) {
+             // distribute only parameters starting with "image" for now
+             if (ci->find("image") == 0) {
+                 names2distribute.push_back(*ci);
+             } else {
+                 names2keep.push_back(*ci);
+             }
+        }
+        //
+        ASKAPDEBUGASSERT(itsComms.nGroups() > 1);
+        // number of parameters per group (note the last group can have more)
+        const size_t nPerGroup = names2distribute.size() / itsComms.nGroups();
+        // this check is not relevant if all parameters are in names2keep
+        if (names2distribute.size() > 0) {
+            ASKAPCHECK(nPerGroup > 0, "The model has too few parameters ("<<
+                  names2distribute.size()<<") to distribute between "<< itsComms.nGroups()<<" groups");
+        } else {
+            ASKAPCHECK(names2keep.size() > 0, "The model has too few parameters ("<<
+                  names2keep.size()<<")");
+        }
+        
+        const size_t index = group * nPerGroup;
+        const size_t nPerCurrentGroup = (group + 1 < itsComms.nGroups()) ? 
+                 nPerGroup : names2distribute.size() - index; 
+        ASKAPDEBUGASSERT((names2distribute.size() > index) || (names2distribute.size() == 0));
+        if (nPerCurrentGroup != nPerGroup) {
+            ASKAPLOG_WARN_STR(logger, "An unbalanced distribution of the model has been detected. "
+                              " the last group ("<<group<<") will have "<<nPerCurrentGroup<<
+                              " parameters vs. "<<nPerGroup<<" for other groups");
+        }
+        std::vector<std::string> currentNames(nPerCurrentGroup + names2keep.size());
+        for (size_t i = 0; i<nPerCurrentGroup; ++i) {
+             currentNames[i] = names2distribute[index + i];
+        }
+        for (size_t i = 0; i<names2keep.size(); ++i) {
+             currentNames[nPerCurrentGroup + i] = names2keep[i];
+        }
+        ASKAPLOG_INFO_STR(logger, "Group "<<group<<
+               " will get the following parameters: "<<currentNames);
+        buffer.makeSlice(*itsModel, currentNames);
+    }
+
+    /// @brief helper method to check whether the model is distributed between groups
+    /// @details If workers are split into groups, by default each group gets its own part 
+    /// of the model (see groupModel). This method is supposed to be overridden in derived classes
+    /// where groups are used for a different purpose and every worker needs the whole model.
+    /// @return true, if the model is distributed between groups of workers
+    bool SynParallel::distributeModel() const
+    {
+       return itsComms.nGroups() > 1;
+    }
     
 
     std::string SynParallel::substitute(const std::string& s) const
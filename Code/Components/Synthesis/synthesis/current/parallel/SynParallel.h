@@ -94,6 +94,23 @@ namespace askap
       /// derived classes (e.g. ImagerParallel) where a different behavior is needed.
       /// @return a vector with parameters to broadcast
       virtual std::vector<std::string> parametersToBroadcast() const;
+
+      /// @brief helper method to check whether the model is distributed between groups
+      /// @details If workers are split into groups, by default each group gets its own part 
+      /// of the model (see groupModel). This method is supposed to be overridden in derived classes
+      /// where groups are used for a different purpose and every worker needs the whole model.
+      /// @return true, if the model is distributed between groups of workers
+      virtual bool distributeModel() const;
+
+      /// @brief helper method to build the part of the model sent to a group of workers
+      /// @details By default, parameters starting with "image" are distributed between groups
+      /// and all other parameters are sent to every group. This method is supposed to be 
+      /// overridden in derived classes where groups are used in a different way.
+      /// @param[in] names names of the parameters to broadcast
+      /// @param[in] group group of workers
+      /// @param[out] buffer the model to send to the given group
+      virtual void groupModel(const std::vector<std::string> &names, size_t group, 
+                              scimath::Params &buffer) const;
   
       /// @brief actual implementation of the model broadcast
       /// @details This method is only supposed to be called from the master.
@@ -0,0 +1,155 @@
+/// @file
+///
+/// Unit test for the incremental peak search used in the minor cycle
+///
+///
+/// @copyright (c) 2007 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <deconvolution/BlockedPeakFinder.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/Slicer.h>
+
+#include <cmath>
+
+using namespace casa;
+
+namespace askap {
+
+namespace synthesis {
+
+class BlockedPeakFinderTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE(BlockedPeakFinderTest);
+  CPPUNIT_TEST(testFindPeaks);
+  CPPUNIT_TEST(testWeighted);
+  CPPUNIT_TEST(testSubtract);
+  CPPUNIT_TEST(testTies);
+  CPPUNIT_TEST_SUITE_END();
+public:
+
+  void setUp() {
+    // shape deliberately not a multiple of the block size
+    itsResidual.resize(IPosition(2, 70, 45));
+    for (uInt y = 0; y < 45; ++y) {
+         for (uInt x = 0; x < 70; ++x) {
+              itsResidual(IPosition(2, x, y)) = sin(0.37 * x) * cos(0.21 * y + 0.3) + 0.001 * x;
+         }
+    }
+  }
+
+  void testFindPeaks() {
+    BlockedPeakFinder<Float> finder(16);
+    finder.attach(itsResidual);
+    compareWithMinMax(finder, Array<Float>());
+  }
+
+  void testWeighted() {
+    Array<Float> weight(itsResidual.shape());
+    for (uInt y = 0; y < 45; ++y) {
+         for (uInt x = 0; x < 70; ++x) {
+              weight(IPosition(2, x, y)) = (x + y) % 7 == 0 ? 0. : 1. + 0.01 * y;
+         }
+    }
+    BlockedPeakFinder<Float> finder(16);
+    finder.attach(itsResidual, weight);
+    compareWithMinMax(finder, weight);
+  }
+
+  void testSubtract() {
+    BlockedPeakFinder<Float> finder(8);
+    finder.attach(itsResidual);
+    Array<Float> psf(IPosition(2, 20, 20));
+    for (uInt y = 0; y < 20; ++y) {
+         for (uInt x = 0; x < 20; ++x) {
+              psf(IPosition(2, x, y)) = exp(-0.05 * ((x - 10.) * (x - 10.) + (y - 10.) * (y - 10.)));
+         }
+    }
+    Array<Float> expected = itsResidual.copy();
+    const IPosition psfStart(2, 3, 1);
+    const IPosition residualStart(2, 50, 30);
+    const IPosition length(2, 17, 15);
+    const Float factor = 2.5;
+    Array<Float> expectedSlice = expected(Slicer(residualStart, length));
+    expectedSlice -= factor * psf(Slicer(psfStart, length));
+    finder.subtract(psf, psfStart, residualStart, length, factor);
+    for (uInt y = 0; y < 45; ++y) {
+         for (uInt x = 0; x < 70; ++x) {
+              const IPosition pos(2, x, y);
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(expected(pos), itsResidual(pos), 1e-6);
+         }
+    }
+    // the peak is expected to move into the patch after the subtraction
+    compareWithMinMax(finder, Array<Float>());
+
+    // change the residual directly and declare the change
+    itsResidual(IPosition(2, 2, 40)) = 10.;
+    finder.invalidate(IPosition(2, 2, 40), IPosition(2, 2, 40));
+    compareWithMinMax(finder, Array<Float>());
+  }
+
+  void testTies() {
+    itsResidual.set(0.);
+    itsResidual(IPosition(2, 60, 40)) = 1.;
+    itsResidual(IPosition(2, 5, 40)) = 1.;
+    itsResidual(IPosition(2, 30, 2)) = -1.;
+    itsResidual(IPosition(2, 31, 2)) = -1.;
+    BlockedPeakFinder<Float> finder(16);
+    finder.attach(itsResidual);
+    Float minVal, maxVal;
+    IPosition minPos, maxPos;
+    finder.findPeaks(minVal, maxVal, minPos, maxPos);
+    // first occurrence in storage order wins
+    CPPUNIT_ASSERT(maxPos == IPosition(2, 5, 40));
+    CPPUNIT_ASSERT(minPos == IPosition(2, 30, 2));
+  }
+
+private:
+
+  void compareWithMinMax(BlockedPeakFinder<Float> &finder, const Array<Float> &weight) {
+    Float minVal, maxVal;
+    IPosition minPos, maxPos;
+    finder.findPeaks(minVal, maxVal, minPos, maxPos);
+    Float expectedMin, expectedMax;
+    IPosition expectedMinPos, expectedMaxPos;
+    if (weight.nelements() > 0) {
+        minMaxMasked(expectedMin, expectedMax, expectedMinPos, expectedMaxPos, itsResidual, weight);
+    } else {
+        minMax(expectedMin, expectedMax, expectedMinPos, expectedMaxPos, itsResidual);
+    }
+    CPPUNIT_ASSERT(minPos == expectedMinPos);
+    CPPUNIT_ASSERT(maxPos == expectedMaxPos);
+    // values are returned without weights
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(itsResidual(expectedMinPos), minVal, 1e-6);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(itsResidual(expectedMaxPos), maxVal, 1e-6);
+  }
+
+  Array<Float> itsResidual;
+};
+
+} // namespace synthesis
+
+} // namespace askap
@@ -31,6 +31,7 @@ ASKAP_LOGGER(logger, ".deconvolution");
 // Test includes
 #include <EntropyTest.h>
 #include <BasisFunctionTest.h>
+#include <BlockedPeakFinderTest.h>
 #include <DeconvolverBaseTest.h>
 #include <DeconvolverFistaTest.h>
 #include <DeconvolverHogbomTest.h>
@@ -52,6 +53,7 @@ int main(int argc, char *argv[])
     runner.addTest( askap::synthesis::DeconvolverStateTest::suite());
     runner.addTest( askap::synthesis::EntropyTest::suite());
     runner.addTest( askap::synthesis::BasisFunctionTest::suite());
+    runner.addTest( askap::synthesis::BlockedPeakFinderTest::suite());
     bool wasSuccessful = runner.run();
 
     return wasSuccessful ? 0 : 1;
@@ -0,0 +1,345 @@
+/// @file
+///
+/// Unit test for the slab decomposition of the grid and its distributed FFT
+///
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+
+#include <gridding/GridSlabFFT.h>
+#include <gridding/IGridSlabComms.h>
+#include <fft/FFTWrapper.h>
+#include <askap/AskapError.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <casa/Arrays/Array.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/IPosition.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <map>
+#include <vector>
+#include <set>
+#include <cstring>
+
+namespace askap {
+
+namespace synthesis {
+
+/// @brief messages exchanged between threads emulating processes
+struct SlabMailbox {
+   /// @brief synchronisation mutex
+   boost::mutex itsMutex;
+   /// @brief condition signalled when a message is posted
+   boost::condition_variable itsCondition;
+   /// @brief messages indexed by the sender and the receiver
+   std::map<std::pair<casa::uInt, casa::uInt>, std::vector<char> > itsMessages;
+};
+
+/// @brief implementation of the communication interface for threads in one process
+class ThreadedSlabComms : public IGridSlabComms {
+public:
+   ThreadedSlabComms(SlabMailbox &mailbox, casa::uInt nSlabs, casa::uInt slab) :
+        itsMailbox(mailbox), itsNSlabs(nSlabs), itsSlab(slab) {}
+
+   virtual casa::uInt nSlabs() const { return itsNSlabs; }
+
+   virtual casa::uInt slab() const { return itsSlab; }
+
+   virtual void exchange(casa::uInt partner, const void *sendBuf, size_t sendSize,
+                         void *recvBuf, size_t recvSize) const {
+       ASKAPCHECK(partner != itsSlab, "Exchange with itself is not expected");
+       boost::unique_lock<boost::mutex> lock(itsMailbox.itsMutex);
+       const char *sendPtr = static_cast<const char*>(sendBuf);
+       itsMailbox.itsMessages[std::make_pair(itsSlab, partner)].assign(sendPtr, sendPtr + sendSize);
+       itsMailbox.itsCondition.notify_all();
+       const std::pair<casa::uInt, casa::uInt> key(partner, itsSlab);
+       while (itsMailbox.itsMessages.find(key) == itsMailbox.itsMessages.end()) {
+              itsMailbox.itsCondition.wait(lock);
+       }
+       const std::vector<char> &msg = itsMailbox.itsMessages[key];
+       ASKAPCHECK(msg.size() == recvSize, "Received "<<msg.size()<<" bytes, expected "<<recvSize);
+       if (recvSize > 0) {
+           std::memcpy(recvBuf, &msg[0], recvSize);
+       }
+       itsMailbox.itsMessages.erase(key);
+   }
+private:
+   SlabMailbox &itsMailbox;
+   casa::uInt itsNSlabs;
+   casa::uInt itsSlab;
+};
+
+class GridSlabFFTTest : public CppUnit::TestFixture 
+{
+   CPPUNIT_TEST_SUITE(GridSlabFFTTest);
+   CPPUNIT_TEST(testRanges);
+   CPPUNIT_TEST(testPartners);
+   CPPUNIT_TEST(testToImage);
+   CPPUNIT_TEST(testToGrid);
+   CPPUNIT_TEST(testImageColumns);
+   CPPUNIT_TEST(testSum);
+   CPPUNIT_TEST_SUITE_END();
+protected:
+   /// @brief number of slabs in the tests of the transforms
+   static const casa::uInt itsNSlabs = 3;
+
+   /// @brief number of halo rows in the tests of the transforms
+   static const casa::uInt itsHalo = 2;
+
+   /// @brief shape of the full grid
+   static casa::IPosition gridShape() { return casa::IPosition(4, 20, 18, 2, 1); }
+
+   /// @brief set up decompositions for all slabs sharing one mailbox
+   void setupSlabs() {
+       itsSlabs.resize(itsNSlabs);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            boost::shared_ptr<IGridSlabComms> comms(new ThreadedSlabComms(itsMailbox, itsNSlabs, slab));
+            itsSlabs[slab].reset(new GridSlabFFT(comms, itsHalo));
+       }
+   }
+
+   /// @brief test grid with pseudo-random values
+   static casa::Array<casa::Complex> testGrid() {
+       casa::Array<casa::Complex> grid(gridShape());
+       casa::uInt seed = 1;
+       for (casa::Array<casa::Complex>::iterator it = grid.begin(); it != grid.end(); ++it) {
+            seed = seed * 1103515245u + 12345u;
+            const float re = float((seed >> 8) % 1000) / 1000. - 0.5;
+            seed = seed * 1103515245u + 12345u;
+            const float im = float((seed >> 8) % 1000) / 1000. - 0.5;
+            *it = casa::Complex(re, im);
+       }
+       return grid;
+   }
+
+   /// @brief run toImage for one slab (thread body)
+   void runToImage(casa::uInt slab) {
+       itsSlabs[slab]->toImage(gridShape(), itsGrids[slab], itsImages[slab]);
+   }
+
+   /// @brief run toGrid for one slab (thread body)
+   void runToGrid(casa::uInt slab) {
+       itsSlabs[slab]->toGrid(gridShape(), itsImages[slab], itsGrids[slab]);
+   }
+
+   /// @brief sum the values of one slab (thread body)
+   void runSum(casa::uInt slab) {
+       itsSlabs[slab]->sum(itsValues[slab]);
+   }
+
+   /// @brief run the given method for all slabs concurrently
+   void runAll(void (GridSlabFFTTest::*method)(casa::uInt)) {
+       boost::thread_group threads;
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            threads.create_thread(boost::bind(method, this, slab));
+       }
+       threads.join_all();
+       CPPUNIT_ASSERT(itsMailbox.itsMessages.empty());
+   }
+
+public:
+   void testRanges() {
+       for (casa::uInt nSlabs = 1; nSlabs < 6; ++nSlabs) {
+            int expected = 0;
+            for (casa::uInt slab = 0; slab < nSlabs; ++slab) {
+                 const std::pair<int,int> r = GridSlabFFT::range(17, nSlabs, slab);
+                 CPPUNIT_ASSERT_EQUAL(expected, r.first);
+                 CPPUNIT_ASSERT(r.second - r.first >= 17 / int(nSlabs));
+                 CPPUNIT_ASSERT(r.second - r.first <= 17 / int(nSlabs) + 1);
+                 expected = r.second;
+            }
+            CPPUNIT_ASSERT_EQUAL(17, expected);
+       }
+   }
+
+   void testPartners() {
+       CPPUNIT_ASSERT_EQUAL(0u, GridSlabFFT::nRounds(1));
+       for (casa::uInt nSlabs = 2; nSlabs < 8; ++nSlabs) {
+            std::set<std::pair<casa::uInt, casa::uInt> > pairs;
+            for (casa::uInt round = 0; round < GridSlabFFT::nRounds(nSlabs); ++round) {
+                 for (casa::uInt slab = 0; slab < nSlabs; ++slab) {
+                      const casa::uInt other = GridSlabFFT::partner(slab, nSlabs, round);
+                      if (other == nSlabs) {
+                          continue;
+                      }
+                      CPPUNIT_ASSERT(other != slab);
+                      CPPUNIT_ASSERT_EQUAL(slab, GridSlabFFT::partner(other, nSlabs, round));
+                      if (slab < other) {
+                          CPPUNIT_ASSERT(pairs.insert(std::make_pair(slab, other)).second);
+                      }
+                 }
+            }
+            // every pair meets exactly once
+            CPPUNIT_ASSERT_EQUAL(size_t(nSlabs * (nSlabs - 1) / 2), pairs.size());
+       }
+   }
+
+   void testToImage() {
+       setupSlabs();
+       const casa::IPosition shape = gridShape();
+       const casa::Array<casa::Complex> grid = testGrid();
+       // number of slabs holding each row, the value is split between them to test
+       // the accumulation of the halo
+       std::vector<int> nHolders(shape(1), 0);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            const int first = itsSlabs[slab]->firstLocalRow(shape);
+            const int nLocal = itsSlabs[slab]->localShape(shape)(1);
+            for (int y = std::max(0, first); y < std::min(int(shape(1)), first + nLocal); ++y) {
+                 ++nHolders[y];
+            }
+       }
+       itsGrids.resize(itsNSlabs);
+       itsImages.resize(itsNSlabs);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            const casa::IPosition local = itsSlabs[slab]->localShape(shape);
+            const int first = itsSlabs[slab]->firstLocalRow(shape);
+            itsGrids[slab].resize(local);
+            itsGrids[slab].set(casa::Complex(0.));
+            for (int y = 0; y < local(1); ++y) {
+                 if ((first + y < 0) || (first + y >= shape(1))) {
+                     continue;
+                 }
+                 for (int x = 0; x < shape(0); ++x) {
+                      for (int pol = 0; pol < shape(2); ++pol) {
+                           itsGrids[slab](casa::IPosition(4, x, y, pol, 0)) = 
+                               grid(casa::IPosition(4, x, first + y, pol, 0)) / float(nHolders[first + y]);
+                      }
+                 }
+            }
+       }
+       runAll(&GridSlabFFTTest::runToImage);
+
+       casa::Array<casa::DComplex> expected(shape);
+       casa::convertArray(expected, grid);
+       scimath::fft2d(expected, false);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            const std::pair<int,int> cols = itsSlabs[slab]->columns(shape);
+            CPPUNIT_ASSERT(itsImages[slab].shape() == itsSlabs[slab]->imageShape(shape));
+            for (int x = cols.first; x < cols.second; ++x) {
+                 for (int y = 0; y < shape(1); ++y) {
+                      for (int pol = 0; pol < shape(2); ++pol) {
+                           const casa::DComplex diff = itsImages[slab](casa::IPosition(4, y, x - cols.first, pol, 0)) -
+                                 expected(casa::IPosition(4, x, y, pol, 0));
+                           CPPUNIT_ASSERT_DOUBLES_EQUAL(0., std::abs(diff), 1e-6);
+                      }
+                 }
+            }
+       }
+   }
+
+   void testToGrid() {
+       setupSlabs();
+       const casa::IPosition shape = gridShape();
+       const casa::Array<casa::Complex> grid = testGrid();
+       casa::Array<casa::DComplex> image(shape);
+       casa::convertArray(image, grid);
+       scimath::fft2d(image, false);
+       itsGrids.resize(itsNSlabs);
+       itsImages.resize(itsNSlabs);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            const std::pair<int,int> cols = itsSlabs[slab]->columns(shape);
+            itsImages[slab].resize(itsSlabs[slab]->imageShape(shape));
+            for (int x = cols.first; x < cols.second; ++x) {
+                 for (int y = 0; y < shape(1); ++y) {
+                      for (int pol = 0; pol < shape(2); ++pol) {
+                           itsImages[slab](casa::IPosition(4, y, x - cols.first, pol, 0)) = 
+                                 image(casa::IPosition(4, x, y, pol, 0));
+                      }
+                 }
+            }
+       }
+       runAll(&GridSlabFFTTest::runToGrid);
+
+       // the original grid is recovered, including the halo
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            const casa::IPosition local = itsSlabs[slab]->localShape(shape);
+            const int first = itsSlabs[slab]->firstLocalRow(shape);
+            CPPUNIT_ASSERT(itsGrids[slab].shape() == local);
+            for (int y = 0; y < local(1); ++y) {
+                 const bool onGrid = (first + y >= 0) && (first + y < shape(1));
+                 for (int x = 0; x < shape(0); ++x) {
+                      for (int pol = 0; pol < shape(2); ++pol) {
+                           const casa::Complex expected = onGrid ? 
+                                 grid(casa::IPosition(4, x, first + y, pol, 0)) : casa::Complex(0.);
+                           const casa::Complex diff = itsGrids[slab](casa::IPosition(4, x, y, pol, 0)) - expected;
+                           CPPUNIT_ASSERT_DOUBLES_EQUAL(0., std::abs(diff), 1e-5);
+                      }
+                 }
+            }
+       }
+   }
+
+   void testImageColumns() {
+       // the image columns of all slabs cover the image without gaps, the outer slabs 
+       // get fewer columns as they hold mostly padding
+       for (casa::uInt nSlabs = 1; nSlabs < 6; ++nSlabs) {
+            int expected = 0;
+            for (casa::uInt slab = 0; slab < nSlabs; ++slab) {
+                 const std::pair<int,int> padded = GridSlabFFT::range(30, nSlabs, slab);
+                 const std::pair<int,int> cols = GridSlabFFT::imageColumns(17, 30, nSlabs, slab);
+                 CPPUNIT_ASSERT_EQUAL(expected, cols.first);
+                 CPPUNIT_ASSERT(cols.second >= cols.first);
+                 CPPUNIT_ASSERT(cols.second - cols.first <= padded.second - padded.first);
+                 if (cols.second > cols.first) {
+                     // the same pixels as extracted from the centre of the padded image
+                     CPPUNIT_ASSERT(cols.first + 6 >= padded.first);
+                     CPPUNIT_ASSERT(cols.second + 6 <= padded.second);
+                 }
+                 expected = cols.second;
+            }
+            CPPUNIT_ASSERT_EQUAL(17, expected);
+       }
+       // no padding
+       const std::pair<int,int> cols = GridSlabFFT::imageColumns(20, 20, 3, 1);
+       CPPUNIT_ASSERT(cols == GridSlabFFT::range(20, 3, 1));
+   }
+
+   void testSum() {
+       setupSlabs();
+       itsValues.resize(itsNSlabs);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            itsValues[slab].resize(casa::IPosition(3, 2, 3, 1));
+            for (int i = 0; i < 6; ++i) {
+                 itsValues[slab](casa::IPosition(3, i % 2, i / 2, 0)) = double(i + 10 * slab);
+            }
+       }
+       runAll(&GridSlabFFTTest::runSum);
+       for (casa::uInt slab = 0; slab < itsNSlabs; ++slab) {
+            for (int i = 0; i < 6; ++i) {
+                 CPPUNIT_ASSERT_DOUBLES_EQUAL(double(3 * i + 30), 
+                       itsValues[slab](casa::IPosition(3, i % 2, i / 2, 0)), 1e-10);
+            }
+       }
+   }
+
+private:
+   /// @brief mailbox shared by all slabs
+   SlabMailbox itsMailbox;
+
+   /// @brief decompositions for all slabs
+   std::vector<boost::shared_ptr<GridSlabFFT> > itsSlabs;
+
+   /// @brief local grids of all slabs
+   std::vector<casa::Array<casa::Complex> > itsGrids;
+
+   /// @brief local image slabs of all slabs
+   std::vector<casa::Array<casa::DComplex> > itsImages;
+
+   /// @brief values summed across slabs
+   std::vector<casa::Array<double> > itsValues;
+};
+
+} // namespace synthesis
+
+} // namespace askap
+
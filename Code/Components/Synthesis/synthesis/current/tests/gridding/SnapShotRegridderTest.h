@@ -0,0 +1,148 @@
+/// @file
+///
+/// Unit test for the image plane regridder used in snap-shot imaging
+///
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#include <gridding/SnapShotRegridder.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/IPosition.h>
+#include <coordinates/Coordinates/DirectionCoordinate.h>
+#include <coordinates/Coordinates/Projection.h>
+#include <measures/Measures/MDirection.h>
+
+namespace askap {
+
+namespace synthesis {
+
+class SnapShotRegridderTest : public CppUnit::TestFixture 
+{
+   CPPUNIT_TEST_SUITE(SnapShotRegridderTest);
+   CPPUNIT_TEST(testIdentity);
+   CPPUNIT_TEST(testShift);
+   CPPUNIT_TEST(testHalfPixelShift);
+   CPPUNIT_TEST(testCaching);
+   CPPUNIT_TEST_SUITE_END();
+protected:
+   /// @brief direction coordinate of the test images
+   /// @param[in] refPixX reference pixel along x
+   /// @param[in] refPixY reference pixel along y
+   static casa::DirectionCoordinate coordinate(double refPixX, double refPixY) {
+       casa::Matrix<casa::Double> xform(2,2,0.);
+       xform.diagonal() = 1.;
+       return casa::DirectionCoordinate(casa::MDirection::J2000, casa::Projection(casa::Projection::SIN),
+                    0., 0., -1e-4, 1e-4, xform, refPixX, refPixY);
+   }
+
+   /// @brief test image, linear along x and quadratic along y
+   static casa::Matrix<double> testImage() {
+       casa::Matrix<double> img(itsSize, itsSize);
+       for (casa::uInt x = 0; x < itsSize; ++x) {
+            for (casa::uInt y = 0; y < itsSize; ++y) {
+                 img(x,y) = double(x) + 0.01 * y * y;
+            }
+       }
+       return img;
+   }
+
+   /// @brief size of the test image
+   static const casa::uInt itsSize = 32;
+public:
+   void testIdentity() {
+       const casa::Interpolate2D::Method methods[4] = {casa::Interpolate2D::NEAREST,
+            casa::Interpolate2D::LINEAR, casa::Interpolate2D::CUBIC, casa::Interpolate2D::LANCZOS};
+       const casa::Matrix<double> in = testImage();
+       for (int method = 0; method < 4; ++method) {
+            SnapShotRegridder regridder(3, methods[method]);
+            const casa::DirectionCoordinate dc = coordinate(16., 16.);
+            regridder.setup(dc, dc, in.shape());
+            casa::Matrix<double> out(in.shape(), -1.);
+            regridder.regrid(in, out, false);
+            for (casa::uInt x = 0; x < itsSize; ++x) {
+                 for (casa::uInt y = 0; y < itsSize; ++y) {
+                      CPPUNIT_ASSERT_DOUBLES_EQUAL(in(x,y), out(x,y), 1e-6);
+                 }
+            }
+       }
+   }
+
+   void testShift() {
+       const casa::Matrix<double> in = testImage();
+       SnapShotRegridder regridder(0, casa::Interpolate2D::CUBIC);
+       // output pixel x corresponds to input pixel x + 1
+       regridder.setup(coordinate(17., 16.), coordinate(16., 16.), in.shape());
+       casa::Matrix<double> out(in.shape(), 1.);
+       regridder.regrid(in, out, true);
+       for (casa::uInt x = 1; x + 3 < itsSize; ++x) {
+            for (casa::uInt y = 2; y + 2 < itsSize; ++y) {
+                 CPPUNIT_ASSERT_DOUBLES_EQUAL(in(x + 1, y) + 1., out(x,y), 1e-6);
+            }
+       }
+       // nothing is added if the input pixel is outside the image
+       for (casa::uInt y = 0; y < itsSize; ++y) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(1., out(itsSize - 1, y), 1e-6);
+       }
+   }
+
+   void testHalfPixelShift() {
+       const casa::Matrix<double> in = testImage();
+       const casa::Interpolate2D::Method methods[2] = {casa::Interpolate2D::LINEAR, casa::Interpolate2D::CUBIC};
+       for (int method = 0; method < 2; ++method) {
+            SnapShotRegridder regridder(4, methods[method]);
+            // output pixel x corresponds to input pixel x + 0.5
+            regridder.setup(coordinate(16.5, 16.), coordinate(16., 16.), in.shape());
+            casa::Matrix<double> out(in.shape(), 1.);
+            regridder.regrid(in, out, false);
+            for (casa::uInt x = 2; x + 3 < itsSize; ++x) {
+                 for (casa::uInt y = 2; y + 3 < itsSize; ++y) {
+                      // both kernels reproduce linear functions exactly
+                      CPPUNIT_ASSERT_DOUBLES_EQUAL(in(x,y) + 0.5, out(x,y), 1e-6);
+                 }
+            }
+            // no data to interpolate from
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(0., out(itsSize - 1, 5), 1e-6);
+       }
+   }
+
+   void testCaching() {
+       const casa::Matrix<double> in = testImage();
+       SnapShotRegridder regridder(3, casa::Interpolate2D::LANCZOS);
+       CPPUNIT_ASSERT_EQUAL(0ul, regridder.numOfMappings());
+       regridder.setup(coordinate(16.5, 16.), coordinate(16., 16.), in.shape());
+       CPPUNIT_ASSERT_EQUAL(1ul, regridder.numOfMappings());
+       regridder.setup(coordinate(16.5, 16.), coordinate(16., 16.), in.shape());
+       CPPUNIT_ASSERT_EQUAL(1ul, regridder.numOfMappings());
+       regridder.setup(coordinate(16., 16.5), coordinate(16., 16.), in.shape());
+       CPPUNIT_ASSERT_EQUAL(2ul, regridder.numOfMappings());
+       regridder.setup(coordinate(16., 16.5), coordinate(16., 16.), casa::IPosition(2, 16, 16));
+       CPPUNIT_ASSERT_EQUAL(3ul, regridder.numOfMappings());
+   }
+};
+    
+} // namespace synthesis
+
+} // namespace askap
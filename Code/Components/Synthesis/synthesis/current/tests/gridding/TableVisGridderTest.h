@@ -35,11 +35,14 @@
 #include <dataaccess/DataIteratorStub.h>
 #include <casa/aips.h>
 #include <casa/Arrays/Matrix.h>
+#include <casa/Arrays/Cube.h>
+#include <casa/Arrays/ArrayMath.h>
 #include <measures/Measures/MPosition.h>
 #include <casa/Quanta/Quantum.h>
 #include <casa/Quanta/MVPosition.h>
 #include <casa/BasicSL/Constants.h>
 #include <askap/AskapError.h>
+#include <askap/AskapUtil.h>
 #include <gridding/VisGridderFactory.h>
 
 #include <cppunit/extensions/HelperMacros.h>
@@ -70,6 +73,7 @@ namespace askap
       CPPUNIT_TEST(testReverseWProject);
       CPPUNIT_TEST(testForwardWStack);
       CPPUNIT_TEST(testReverseWStack);
+      CPPUNIT_TEST(testStreamedWStack);
       CPPUNIT_TEST(testForwardAWProject);
       CPPUNIT_TEST(testReverseAWProject);
       CPPUNIT_TEST(testForwardAProjectWStack);
@@ -232,6 +236,62 @@ namespace askap
         itsWStack->initialiseDegrid(*itsAxes, *itsModel);
         itsWStack->degrid(*idi);
       }
+      void testStreamedWStack()
+      {
+        // only 2 out of 9 planes are held in memory, results should be the same
+        WStackVisGridder streamed(10000.0, 9, 2);
+        itsWStack->initialiseGrid(*itsAxes, itsModel->shape(), false);
+        itsWStack->grid(*idi);
+        itsWStack->finaliseGrid(*itsModel);
+        itsWStack->finaliseWeights(*itsModelWeights);
+        casa::Array<double> image(itsModel->shape());
+        casa::Array<double> weights(itsModelWeights->shape());
+        streamed.initialiseGrid(*itsAxes, itsModel->shape(), false);
+        streamed.grid(*idi);
+        streamed.finaliseGrid(image);
+        streamed.finaliseWeights(weights);
+        const double peak = casa::max(casa::abs(*itsModel));
+        CPPUNIT_ASSERT(peak > 0.);
+        CPPUNIT_ASSERT(casa::max(casa::abs(image - *itsModel)) < 1e-5 * peak);
+        CPPUNIT_ASSERT(casa::max(casa::abs(weights - *itsModelWeights)) < 1e-5);
+
+        // data kept by the caller are gridded by a clone without a copy
+        const boost::shared_ptr<accessors::IDataAccessor> acc(&(*idi), utility::NullDeleter());
+        const boost::shared_ptr<WStackVisGridder> clone = 
+                  boost::dynamic_pointer_cast<WStackVisGridder>(streamed.clone());
+        CPPUNIT_ASSERT(clone);
+        CPPUNIT_ASSERT(clone->isStreamed());
+        clone->initialiseGrid(*itsAxes, itsModel->shape(), false);
+        clone->gridShared(acc);
+        clone->finaliseGrid(image);
+        CPPUNIT_ASSERT(casa::max(casa::abs(image - *itsModel)) < 1e-5 * peak);
+
+        // degridding
+        idi->rwVisibility().set(0.);
+        itsWStack->initialiseDegrid(*itsAxes, *itsModel);
+        itsWStack->degrid(*idi);
+        itsWStack->finaliseDegrid();
+        const casa::Cube<casa::Complex> vis = idi->visibility().copy();
+        idi->rwVisibility().set(0.);
+        streamed.initialiseDegrid(*itsAxes, *itsModel);
+        streamed.degrid(*idi);
+        streamed.finaliseDegrid();
+        const float visPeak = casa::max(casa::amplitude(vis));
+        CPPUNIT_ASSERT(visPeak > 0.);
+        CPPUNIT_ASSERT(casa::max(casa::amplitude(idi->visibility() - vis)) < 1e-5 * visPeak);
+
+        // queued data of both the gridder and its clone are degridded with shared row buckets
+        idi->rwVisibility().set(0.);
+        streamed.initialiseDegrid(*itsAxes, *itsModel);
+        clone->initialiseDegrid(*itsAxes, *itsModel);
+        streamed.degridShared(acc);
+        clone->degridShared(acc);
+        streamed.flushDegrid();
+        clone->flushDegrid();
+        streamed.finaliseDegrid();
+        clone->finaliseDegrid();
+        CPPUNIT_ASSERT(casa::max(casa::amplitude(idi->visibility() - vis * casa::Complex(2.))) < 2e-5 * visPeak);
+      }
       void testReverseAProjectWStack()
       {
         itsAProjectWStack->initialiseGrid(*itsAxes, itsModel->shape(), false);
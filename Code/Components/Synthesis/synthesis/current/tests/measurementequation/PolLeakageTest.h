@@ -43,6 +43,7 @@
 
 #include <fitting/LinearSolver.h>
 #include <dataaccess/DataIteratorStub.h>
+#include <dataaccess/OnDemandNoiseAndFlagDA.h>
 #include <measurementequation/CalibrationApplicatorME.h>
 #include <calibaccess/CachedCalSolutionAccessor.h>
 #include <calibaccess/CalSolutionSourceStub.h>
@@ -51,6 +52,8 @@
 
 #include <askap/AskapError.h>
 #include <askap/AskapUtil.h>
+#include <askap/TaskScheduler.h>
+#include <scimath/Mathematics/MatrixMathLA.h>
 
 #include <boost/shared_ptr.hpp>
 
@@ -68,6 +71,8 @@ namespace askap
       CPPUNIT_TEST(testSolve);
       CPPUNIT_TEST(testSolvePreAvg);
       CPPUNIT_TEST(testApplication);
+      CPPUNIT_TEST(testCachedApplication);
+      CPPUNIT_TEST(testSingularApplication);
       CPPUNIT_TEST(testSimulation);            
       CPPUNIT_TEST_SUITE_END();
      
@@ -424,6 +429,125 @@ namespace askap
           }
         }
         
+        void testCachedApplication() {
+          // the cached 2x2 kernel used for all four polarisation products is compared
+          // against the explicit inversion of the 4x4 Mueller matrix built from
+          // the solution accessor for every row and channel
+          CPPUNIT_ASSERT(itsIter);
+          accessors::DataAccessorStub &da = dynamic_cast<accessors::DataAccessorStub&>(*itsIter);
+          CPPUNIT_ASSERT(da.itsStokes.nelements() == 4);
+          casa::Cube<casa::Complex> origVis(da.nRow(), da.nChannel(), da.nPol());
+          casa::Cube<casa::Complex> origNoise(origVis.shape());
+          for (casa::uInt row = 0; row < da.nRow(); ++row) {
+               for (casa::uInt chan = 0; chan < da.nChannel(); ++chan) {
+                    for (casa::uInt pol = 0; pol < da.nPol(); ++pol) {
+                         origVis(row,chan,pol) = casa::Complex(float(row % 7) - 3. + pol, float(chan) + 0.1 * pol);
+                         origNoise(row,chan,pol) = casa::Complex(1. + 0.1 * pol, 0.5 + 0.1 * chan);
+                    }
+               }
+          }
+
+          fillGainsAndLeakages();
+          CPPUNIT_ASSERT(itsParams1);
+          accessors::CachedCalSolutionAccessor acc(itsParams1);
+          accessors::CalSolutionSourceStub src(boost::shared_ptr<accessors::CachedCalSolutionAccessor>(&acc,utility::NullDeleter()));
+
+          // reference result, uncached
+          casa::Cube<casa::Complex> expectedVis(origVis.shape());
+          casa::Cube<casa::Complex> expectedNoise(origVis.shape());
+          casa::Matrix<casa::Complex> mueller(4,4);
+          casa::Matrix<casa::Complex> reciprocal(4,4);
+          for (casa::uInt row = 0; row < da.nRow(); ++row) {
+               for (casa::uInt chan = 0; chan < da.nChannel(); ++chan) {
+                    const casa::SquareMatrix<casa::Complex, 2> jones1 = acc.jones(da.antenna1()[row], 0, chan);
+                    const casa::SquareMatrix<casa::Complex, 2> jones2 = acc.jones(da.antenna2()[row], 0, chan);
+                    for (casa::uInt i = 0; i < 4; ++i) {
+                         for (casa::uInt j = 0; j < 4; ++j) {
+                              mueller(i,j) = jones1(i / 2, j / 2) * conj(jones2(i % 2, j % 2));
+                         }
+                    }
+                    casa::Complex det = 0.;
+                    invert(reciprocal, det, mueller);
+                    CPPUNIT_ASSERT(casa::abs(det) > 1e-25);
+                    for (casa::uInt pol = 0; pol < 4; ++pol) {
+                         casa::Complex temp(0.,0.);
+                         float tempRe = 0., tempIm = 0.;
+                         for (casa::uInt k = 0; k < 4; ++k) {
+                              temp += reciprocal(pol,k) * origVis(row,chan,k);
+                              tempRe += casa::square(casa::real(reciprocal(pol,k)) * casa::real(origNoise(row,chan,k))) +
+                                        casa::square(casa::imag(reciprocal(pol,k)) * casa::imag(origNoise(row,chan,k)));
+                              tempIm += casa::square(casa::real(reciprocal(pol,k)) * casa::imag(origNoise(row,chan,k))) +
+                                        casa::square(casa::imag(reciprocal(pol,k)) * casa::real(origNoise(row,chan,k)));
+                         }
+                         expectedVis(row,chan,pol) = temp;
+                         expectedNoise(row,chan,pol) = casa::Complex(sqrt(tempRe), sqrt(tempIm));
+                    }
+               }
+          }
+
+          const size_t oldBudget = TaskScheduler::instance().threadBudget();
+          const size_t budgets[2] = {1, 4};
+          for (size_t test = 0; test < 2; ++test) {
+               TaskScheduler::instance().setThreadBudget(budgets[test]);
+               CalibrationApplicatorME calME(boost::shared_ptr<accessors::CalSolutionSourceStub>(&src,utility::NullDeleter()));
+               calME.scaleNoise(true);
+               // the second pass uses the jones matrices cached by the first one
+               for (int pass = 0; pass < 2; ++pass) {
+                    // noise scaling requires an accessor with writable noise
+                    accessors::OnDemandNoiseAndFlagDA noiseDA(da);
+                    noiseDA.rwVisibility() = origVis;
+                    noiseDA.rwNoise() = origNoise;
+                    calME.correct(noiseDA);
+                    const casa::Cube<casa::Complex>& vis = noiseDA.visibility();
+                    const casa::Cube<casa::Complex>& noise = noiseDA.noise();
+                    const casa::Cube<casa::Bool>& flag = noiseDA.flag();
+                    for (casa::uInt row = 0; row < da.nRow(); ++row) {
+                         for (casa::uInt chan = 0; chan < da.nChannel(); ++chan) {
+                              for (casa::uInt pol = 0; pol < da.nPol(); ++pol) {
+                                   CPPUNIT_ASSERT_DOUBLES_EQUAL(real(expectedVis(row,chan,pol)), real(vis(row,chan,pol)), 1e-4);
+                                   CPPUNIT_ASSERT_DOUBLES_EQUAL(imag(expectedVis(row,chan,pol)), imag(vis(row,chan,pol)), 1e-4);
+                                   CPPUNIT_ASSERT_DOUBLES_EQUAL(real(expectedNoise(row,chan,pol)), real(noise(row,chan,pol)), 1e-4);
+                                   CPPUNIT_ASSERT_DOUBLES_EQUAL(imag(expectedNoise(row,chan,pol)), imag(noise(row,chan,pol)), 1e-4);
+                                   CPPUNIT_ASSERT(!flag(row,chan,pol));
+                              }
+                         }
+                    }
+               }
+          }
+          TaskScheduler::instance().setThreadBudget(oldBudget);
+        }
+
+        void testSingularApplication() {
+          // a singular jones matrix for one antenna can't be applied without flagging,
+          // the error has to identify the antenna, beam and time
+          CPPUNIT_ASSERT(itsIter);
+          accessors::DataAccessorStub &da = dynamic_cast<accessors::DataAccessorStub&>(*itsIter);
+          CPPUNIT_ASSERT(da.itsStokes.nelements() == 4);
+          fillGainsAndLeakages();
+          CPPUNIT_ASSERT(itsParams1);
+          const casa::Stokes::StokesTypes products[4] = {casa::Stokes::XX, casa::Stokes::XY,
+                                                         casa::Stokes::YX, casa::Stokes::YY};
+          for (casa::uInt pol = 0; pol < 4; ++pol) {
+               itsParams1->update(accessors::CalParamNameHelper::paramName(3,0,products[pol]), casa::Complex(0.,0.));
+          }
+          accessors::CachedCalSolutionAccessor acc(itsParams1);
+          accessors::CalSolutionSourceStub src(boost::shared_ptr<accessors::CachedCalSolutionAccessor>(&acc,utility::NullDeleter()));
+          CalibrationApplicatorME calME(boost::shared_ptr<accessors::CalSolutionSourceStub>(&src,utility::NullDeleter()));
+          bool caught = false;
+          try {
+             calME.correct(da);
+          }
+          catch (const AskapError &ae) {
+             caught = true;
+             const std::string msg = ae.what();
+             CPPUNIT_ASSERT(msg.find("(antenna1,beam1)=(") != std::string::npos);
+             CPPUNIT_ASSERT(msg.find("(antenna2,beam2)=(") != std::string::npos);
+             CPPUNIT_ASSERT(msg.find("3,0)") != std::string::npos);
+             CPPUNIT_ASSERT(msg.find("time=") != std::string::npos);
+          }
+          CPPUNIT_ASSERT(caught);
+        }
+
         void checkTwoParamsClasses(const scimath::Params &param1, const scimath::Params &param2) {
             const std::vector<string> names = param1.names();
             CPPUNIT_ASSERT_EQUAL(names.size(), param2.names().size());
@@ -0,0 +1,241 @@
+/// @file
+/// 
+/// @brief Unit tests for VisMetaDataIndex class
+/// @details VisMetaDataIndex keeps a per-chunk summary of the metadata which can be used
+/// by the advise utility instead of iterating over the data.
+/// 
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef VIS_META_DATA_INDEX_ME_TEST_H
+#define VIS_META_DATA_INDEX_ME_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <measurementequation/VisMetaDataIndex.h>
+#include <measurementequation/VisMetaDataStats.h>
+#include <dataaccess/DataAccessorStub.h>
+#include <casa/Quanta/MVDirection.h>
+#include <tables/Tables/Table.h>
+#include <tables/Tables/TableDesc.h>
+#include <tables/Tables/SetupNewTab.h>
+#include <tables/Tables/ScaColDesc.h>
+#include <tables/Tables/TableRecord.h>
+
+#include <vector>
+#include <string>
+
+namespace askap
+{
+  namespace synthesis
+  {
+    class VisMetaDataIndexTest : public CppUnit::TestFixture
+    {
+      CPPUNIT_TEST_SUITE(VisMetaDataIndexTest);
+      CPPUNIT_TEST(testAdd);
+      CPPUNIT_TEST(testStats);
+      CPPUNIT_TEST(testSelect);
+      CPPUNIT_TEST(testReadWrite);
+      CPPUNIT_TEST(testLoad);
+      CPPUNIT_TEST_EXCEPTION(testTangentCheck,AskapError);
+      CPPUNIT_TEST_SUITE_END();
+    protected:
+      // same modification as in VisMetaDataStatsTest
+      static void modifyStubbedData(accessors::DataAccessorStub &acc) {
+         for (casa::uInt row=0; row<acc.nRow(); ++row) {
+            ++acc.itsFeed1[row];
+            ++acc.itsFeed2[row];
+            ++acc.itsAntenna1[row];
+            ++acc.itsAntenna2[row];
+            for (casa::uInt dim=0; dim<3; ++dim) {
+                 acc.itsUVW[row](dim) *= 10.;
+            }
+            acc.itsPointingDir1[row].shift(-0.001,0.001,casa::True);
+            acc.itsPointingDir2[row].shift(-0.001,0.001,casa::True);            
+         }
+         for (casa::uInt chan=0; chan<acc.nChannel(); ++chan) {
+              acc.itsFrequency[chan] += 10e6;
+         }
+      }  
+
+      static VisMetaDataIndex makeIndex() {
+         VisMetaDataIndex index(2 * 435, "TOPO");
+         accessors::DataAccessorStub acc(true);
+         index.add(acc);
+         modifyStubbedData(acc);
+         index.add(acc);
+         return index;
+      }
+
+      static void compareStats(const VisMetaDataStats &expected, const VisMetaDataStats &result) {
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxFreq(),result.maxFreq(),1e-3);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.minFreq(),result.minFreq(),1e-3);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxU(),result.maxU(),1e-6);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxV(),result.maxV(),1e-6);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxW(),result.maxW(),1e-6);
+         CPPUNIT_ASSERT_EQUAL(expected.nAntennas(), result.nAntennas());
+         CPPUNIT_ASSERT_EQUAL(expected.nBeams(), result.nBeams());
+         CPPUNIT_ASSERT_EQUAL(expected.nVis(), result.nVis());
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(0., expected.centre().separation(result.centre()), 1e-9);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxOffsets().first,result.maxOffsets().first,1e-9);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.maxOffsets().second,result.maxOffsets().second,1e-9);
+      }
+    public:
+      void testAdd() {
+         const VisMetaDataIndex index = makeIndex();
+         CPPUNIT_ASSERT_EQUAL(870u, index.msRows());
+         CPPUNIT_ASSERT_EQUAL(std::string("TOPO"), index.freqFrame());
+         const std::vector<VisMetaDataIndex::Chunk> &chunks = index.chunks();
+         CPPUNIT_ASSERT_EQUAL(size_t(2), chunks.size());
+         CPPUNIT_ASSERT_EQUAL(435u, chunks[0].itsNRow);
+         CPPUNIT_ASSERT_EQUAL(8u, chunks[0].itsNChannel);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.26e9, chunks[0].itsMinFreq, 1.);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.4e9, chunks[0].itsMaxFreq, 1.);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.27e9, chunks[1].itsMinFreq, 1.);
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(1.41e9, chunks[1].itsMaxFreq, 1.);
+         CPPUNIT_ASSERT_EQUAL(29u, chunks[0].itsMaxAntenna);
+         CPPUNIT_ASSERT_EQUAL(30u, chunks[1].itsMaxAntenna);
+         CPPUNIT_ASSERT_EQUAL(size_t(1), chunks[0].itsBeams.size());
+         CPPUNIT_ASSERT_EQUAL(0u, chunks[0].itsBeams[0]);
+         CPPUNIT_ASSERT_EQUAL(1u, chunks[1].itsBeams[0]);
+         CPPUNIT_ASSERT_EQUAL(size_t(1), chunks[0].itsPointings.size());
+         CPPUNIT_ASSERT_DOUBLES_EQUAL(0., chunks[0].itsFlaggedFraction, 1e-6);
+         // accessors without rows are ignored
+         accessors::DataAccessorStub empty(false);
+         VisMetaDataIndex index2;
+         index2.add(empty);
+         CPPUNIT_ASSERT_EQUAL(size_t(0), index2.chunks().size());
+      }
+
+      void testStats() {
+         accessors::DataAccessorStub acc(true);
+         VisMetaDataStats expected;
+         expected.process(acc);
+         modifyStubbedData(acc);
+         expected.process(acc);
+
+         const VisMetaDataIndex index = makeIndex();
+         VisMetaDataStats result;
+         for (size_t chunk = 0; chunk < index.chunks().size(); ++chunk) {
+              result.process(index.chunks()[chunk]);
+         }
+         compareStats(expected, result);
+      }
+
+      void testSelect() {
+         const VisMetaDataIndex index = makeIndex();
+         CPPUNIT_ASSERT_EQUAL(size_t(2), index.select(1.3e9, 1.35e9).size());
+         std::vector<size_t> selected = index.select(1.405e9, 1.5e9);
+         CPPUNIT_ASSERT_EQUAL(size_t(1), selected.size());
+         CPPUNIT_ASSERT_EQUAL(size_t(1), selected[0]);
+         selected = index.select(1.3e9, 1.35e9, 0);
+         CPPUNIT_ASSERT_EQUAL(size_t(1), selected.size());
+         CPPUNIT_ASSERT_EQUAL(size_t(0), selected[0]);
+         CPPUNIT_ASSERT_EQUAL(size_t(0), index.select(1.5e9, 1.6e9).size());
+         CPPUNIT_ASSERT_EQUAL(size_t(0), index.select(1.3e9, 1.35e9, 2).size());
+      }
+
+      void testReadWrite() {
+         const std::string name = "tVisMetaDataIndex.tab";
+         const VisMetaDataIndex index = makeIndex();
+         index.write(name);
+         VisMetaDataIndex index2;
+         index2.read(name);
+         casa::Table::deleteTable(name);
+         CPPUNIT_ASSERT_EQUAL(index.msRows(), index2.msRows());
+         CPPUNIT_ASSERT_EQUAL(index.freqFrame(), index2.freqFrame());
+         CPPUNIT_ASSERT_EQUAL(index.chunks().size(), index2.chunks().size());
+         VisMetaDataStats stats, stats2;
+         for (size_t chunk = 0; chunk < index.chunks().size(); ++chunk) {
+              const VisMetaDataIndex::Chunk &c1 = index.chunks()[chunk];
+              const VisMetaDataIndex::Chunk &c2 = index2.chunks()[chunk];
+              CPPUNIT_ASSERT(c1.itsBeams == c2.itsBeams);
+              CPPUNIT_ASSERT_EQUAL(c1.itsPointings.size(), c2.itsPointings.size());
+              CPPUNIT_ASSERT_DOUBLES_EQUAL(c1.itsTime, c2.itsTime, 1e-6);
+              stats.process(c1);
+              stats2.process(c2);
+         }
+         compareStats(stats, stats2);
+      }
+
+      void testLoad() {
+         // a plain table with the right number of rows stands in for the measurement set
+         const std::string ms = "tVisMetaDataIndex.ms";
+         {
+            casa::TableDesc td("", "1", casa::TableDesc::Scratch);
+            td.addColumn(casa::ScalarColumnDesc<casa::Double>("TIME"));
+            casa::SetupNewTable newTab(ms, td, casa::Table::New);
+            casa::Table table(newTab, 2 * 435);
+         }
+         const casa::uInt msModified = VisMetaDataIndex::modificationTime(ms);
+         const std::string name = VisMetaDataIndex::indexName(ms);
+         VisMetaDataIndex loaded;
+         CPPUNIT_ASSERT(!VisMetaDataIndex::load(ms, "TOPO", loaded));
+
+         VisMetaDataIndex index(2 * 435, "TOPO", msModified);
+         accessors::DataAccessorStub acc(true);
+         index.add(acc);
+         index.write(name);
+         CPPUNIT_ASSERT(VisMetaDataIndex::load(ms, "TOPO", loaded));
+         CPPUNIT_ASSERT_EQUAL(msModified, loaded.msModified());
+         CPPUNIT_ASSERT_EQUAL(size_t(1), loaded.chunks().size());
+         // opening the measurement set doesn't make the index stale
+         CPPUNIT_ASSERT_EQUAL(870u, casa::Table(ms).nrow());
+         CPPUNIT_ASSERT(VisMetaDataIndex::load(ms, "TOPO", loaded));
+         CPPUNIT_ASSERT(!VisMetaDataIndex::load(ms, "LSRK", loaded));
+
+         // built for an earlier version of the measurement set with the same number of rows
+         VisMetaDataIndex(2 * 435, "TOPO", msModified - 1).write(name);
+         CPPUNIT_ASSERT(!VisMetaDataIndex::load(ms, "TOPO", loaded));
+
+         // a damaged index with the right version but missing columns is ignored
+         {
+            casa::TableDesc td("", "1", casa::TableDesc::Scratch);
+            td.addColumn(casa::ScalarColumnDesc<casa::Double>("TIME"));
+            casa::SetupNewTable newTab(name, td, casa::Table::New);
+            casa::Table table(newTab, 1);
+            table.rwKeywordSet().define("VERSION", casa::Int(2));
+            table.rwKeywordSet().define("MS_NROW", casa::uInt(2 * 435));
+            table.rwKeywordSet().define("MS_MTIME", msModified);
+            table.rwKeywordSet().define("FREQ_FRAME", casa::String("TOPO"));
+         }
+         CPPUNIT_ASSERT(!VisMetaDataIndex::load(ms, "TOPO", loaded));
+         casa::Table::deleteTable(name);
+         casa::Table::deleteTable(ms);
+      }
+
+      void testTangentCheck() {
+         const VisMetaDataIndex index = makeIndex();
+         const casa::MVDirection tangent(casa::Quantity(0, "deg"), casa::Quantity(0, "deg"));
+         VisMetaDataStats stats(tangent);
+         // chunks don't have uvw per row, so they can't be rotated to a tangent point
+         stats.process(index.chunks()[0]);
+      }
+    };
+  
+  } // namespace synthesis
+
+} // namespace askap
+
+#endif // #ifndef VIS_META_DATA_INDEX_ME_TEST_H
@@ -154,3 +154,21 @@ spr.addToParset("Cimager.calibaccess.table = \"caldata.tab\"")
 spr.addToParset("Cimager.calibrate.ignorebeam = true")
 spr.runImager()
 analyseResult(spr)
+
+# the same time-dependent solution with the next interval pre-averaged in the background
+# and solutions written in batches (the last batch is incomplete)
+spr.initParset()
+spr.addToParset("Ccalibrator.calibaccess = table")
+spr.addToParset("Ccalibrator.interval = 600s")
+spr.addToParset("Ccalibrator.solve = antennagains")
+spr.addToParset("Ccalibrator.prefetch = true")
+spr.addToParset("Ccalibrator.solutionbatch = 4")
+os.system("rm -rf caldata.tab")
+spr.runCalibrator()
+
+spr.addToParset("Cimager.calibrate = true")
+spr.addToParset("Cimager.calibaccess = table")
+spr.addToParset("Cimager.calibaccess.table = \"caldata.tab\"")
+spr.addToParset("Cimager.calibrate.ignorebeam = true")
+spr.runImager()
+analyseResult(spr)
@@ -0,0 +1,52 @@
+# regression tests of msmerge and msconcat
+# the simulated measurement set is combined with a copy of itself and the
+# result is imaged, the source is expected to have the same position and flux
+# some fixed parameters are given in calibratortest_template.in
+
+from synthprogrunner import *
+
+def analyseResult(spr):
+   '''
+      spr - synthesis program runner (to run imageStats)
+
+      throws exceptions if something is wrong, otherwise just
+      returns
+   '''
+   src_offset = 0.004/math.pi*180.
+   psf_peak=[-172.5,-45]
+   true_peak=sinProjection(psf_peak,src_offset,src_offset)
+   stats = spr.imageStats('image.field1.restored')
+   print "Statistics for restored image: ",stats
+   disterr = getDistance(stats,true_peak[0],true_peak[1])*3600.
+   if disterr > 8:
+      raise RuntimeError, "Offset between true and expected position exceeds 1 cell size (8 arcsec), d=%f, true_peak=%s" % (disterr,true_peak)
+   if abs(stats['peak']-1.)>0.1:
+      raise RuntimeError, "Peak flux in the image is notably different from 1 Jy, F=%f" % stats['peak']
+
+   stats = spr.imageStats('residual.field1')
+   print "Statistics for residual image: ",stats
+   if stats['rms']>0.01 or abs(stats['median'])>0.0001:
+      raise RuntimeError, "Residual image has too high rms or median. Please verify"
+
+spr = SynthesisProgramRunner(template_parset = 'calibratortest_template.in')
+spr.addToParset("Csimulator.corrupt = false")
+spr.runSimulator()
+
+# the imager reads field1.ms, keep the simulated data under different names
+os.system("rm -rf msmerge_in1.ms msmerge_in2.ms")
+os.system("mv field1.ms msmerge_in1.ms")
+os.system("cp -r msmerge_in1.ms msmerge_in2.ms")
+
+# merge in frequency, the inputs are read concurrently
+spr.initParset()
+spr.runMSMerge("field1.ms", ["msmerge_in1.ms", "msmerge_in2.ms"])
+spr.runImager()
+analyseResult(spr)
+
+# concatenate in time, the next block is read while the current one is written
+os.system("rm -rf field1.ms")
+spr.runMSConcat("field1.ms", ["msmerge_in1.ms", "msmerge_in2.ms"])
+spr.runImager()
+analyseResult(spr)
+
+os.system("rm -rf msmerge_in1.ms msmerge_in2.ms")
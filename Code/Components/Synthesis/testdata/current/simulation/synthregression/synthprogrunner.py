@@ -25,6 +25,8 @@ class SynthesisProgramRunner:
       self.imager = os.path.join(os.environ['ASKAP_ROOT'],'Code/Components/Synthesis/synthesis/current/apps/cimager.sh')
       self.calibrator = os.path.join(os.environ['ASKAP_ROOT'],'Code/Components/Synthesis/synthesis/current/apps/ccalibrator.sh')
       self.imgstat = os.path.join(os.environ['ASKAP_ROOT'],'Code/Components/Synthesis/synthesis/current/apps/imgstat.sh')
+      self.msmerge = os.path.join(os.environ['ASKAP_ROOT'],'Code/Components/Synthesis/synthesis/current/apps/msmerge.sh')
+      self.msconcat = os.path.join(os.environ['ASKAP_ROOT'],'Code/Components/Synthesis/synthesis/current/apps/msconcat.sh')
 
       if not os.path.exists(self.simulator):
           raise RuntimeError, "csimulator is missing at %s" % self.simulator
@@ -38,6 +40,12 @@ class SynthesisProgramRunner:
       if not os.path.exists(self.imgstat):
           raise RuntimeError, "imgstat is missing at %s" % self.imgstat
 
+      if not os.path.exists(self.msmerge):
+          raise RuntimeError, "msmerge is missing at %s" % self.msmerge
+
+      if not os.path.exists(self.msconcat):
+          raise RuntimeError, "msconcat is missing at %s" % self.msconcat
+
       self.tmp_parset = "temp_parset.in"
       self.initParset()
       
@@ -92,6 +100,30 @@ class SynthesisProgramRunner:
       '''
       self.runCommand(self.imager)
 
+   def runMSTool(self, cmd, out, inputs):
+      '''
+         Run a tool combining measurement sets (msmerge or msconcat)
+
+         cmd - command
+         out - name of the output measurement set, must not exist
+         inputs - list with the names of the input measurement sets
+      '''
+      res = os.system("%s -o %s %s" % (cmd, out, " ".join(inputs)))
+      if res != 0:
+         raise RuntimeError, "Command %s failed with error %s" % (cmd,res)
+
+   def runMSMerge(self, out, inputs):
+      '''
+         Run msmerge to merge the inputs in frequency
+      '''
+      self.runMSTool(self.msmerge, out, inputs)
+
+   def runMSConcat(self, out, inputs):
+      '''
+         Run msconcat to concatenate the inputs in time
+      '''
+      self.runMSTool(self.msconcat, out, inputs)
+
    def imageStats(self, name):
       '''
          Get image statistics
@@ -10,5 +10,7 @@ print "calibratortest: test of ccalibrator"
 import calibratortest
 print "leakagecalibtest: test of polarisation leakage calibration"
 import leakagecalibtest
+print "msmergetest: test of msmerge and msconcat"
+import msmergetest
 print "1934-638: test source position and flux on real ATCA data"
 import test1934
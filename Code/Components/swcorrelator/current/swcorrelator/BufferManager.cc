@@ -69,13 +69,18 @@ BufferManager::BufferManager(const size_t nBeam, const size_t nChan, const size_
      const boost::shared_ptr<HeaderPreprocessor> &hdrProc) : itsNBuf(2*nBeam*nChan*nAnt),
      itsBufferSize(2*nSamples + int(sizeof(BufferHeader)/sizeof(float))),
      itsBuffer(new float[(2*nSamples + int(sizeof(BufferHeader)/sizeof(float)))*itsNBuf]),
-     itsStatus(itsNBuf, BUF_FREE),
+     itsStatus(new boost::atomic<BufferStatus>[itsNBuf]), itsFreeBuffers(itsNBuf),
      itsReadyBuffers(nAnt, nChan, nBeam, -1), itsHeaderPreprocessor(hdrProc),
      itsDuplicate2nd(false)
 {
    ASKAPCHECK(sizeof(BufferHeader) % sizeof(float) == 0, "Some padding is required");
    ASKAPCHECK(sizeof(std::complex<float>) == 2*sizeof(float), "std::complex<float> is not just two floats!");
    ASKAPCHECK(nAnt >= 3, "This code doesn't support less than 3 antennas");
+   // push in reverse order, so the buffers are handed out starting from the first one
+   for (int id = itsNBuf - 1; id >= 0; --id) {
+        itsStatus[id] = BUF_FREE;
+        ASKAPCHECK(itsFreeBuffers.bounded_push(id), "Unable to populate the list of free buffers");
+   }
 }
 
 /// @brief destructor to keep the compiler happy
@@ -131,12 +136,11 @@ int BufferManager::bufferSize() const
 /// @return an ID of the buffer
 int BufferManager::getBufferToFill() const
 {
-  boost::lock_guard<boost::mutex> lock(itsStatusCVMutex);  
-  for (int id = 0; id < itsNBuf; ++id) {
-     if (itsStatus[id] == BUF_FREE) {
-         itsStatus[id] = BUF_BEING_FILLED;
-         return id;
-     }
+  int id = -1;
+  if (itsFreeBuffers.pop(id)) {
+      ASKAPDEBUGASSERT((id >= 0) && (id < itsNBuf));
+      itsStatus[id] = BUF_BEING_FILLED;
+      return id;
   }
   return -1;
 }
@@ -339,7 +343,7 @@ void BufferManager::bufferFilled(const int id) const
     boost::lock_guard<boost::mutex> lock(itsStatusCVMutex);  
     try {
       ASKAPCHECK(itsStatus[id] == BUF_BEING_FILLED, "An attempt to release the buffer which is not being filled, status="<<
-                 itsStatus[id]);
+                 itsStatus[id].load());
       itsStatus[id] = BUF_READY;       
       //((BufferHeader*)buffer(id))->beam-=2;
       if (preprocessIndices(id)) {
@@ -383,7 +387,7 @@ void BufferManager::bufferFilled(const int id) const
                        ASKAPLOG_WARN_STR(logger, "Incomplete old data detected in buffer "<<thisID<<" corresponding to antenna "<<
                               ant<<", beam "<<hdr.beam<<", channel "<<hdr.freqId<<" - cleaning up");
                        itsReadyBuffers(ant, hdr.freqId, hdr.beam) = -1;
-                       itsStatus[thisID] = BUF_FREE;
+                       freeBuffer(thisID);
                    } else {
                       ASKAPDEBUGASSERT(itsStatus[thisID] == BUF_BEING_PROCESSED);
                       ASKAPLOG_WARN_STR(logger, "Not keeping up - the data in buffer "<<thisID<<" corresponding to antenna "<<
@@ -400,7 +404,7 @@ void BufferManager::bufferFilled(const int id) const
       }
       //
     } catch (const BufferManager::HelperException &) {
-      itsStatus[id] = BUF_FREE;          
+      freeBuffer(id);
     }
   }
   itsStatusCV.notify_all();
@@ -414,7 +418,20 @@ void BufferManager::bufferFilled(const int id) const
 void BufferManager::releaseOneBuffer(const int id) const
 {
    ASKAPDEBUGASSERT(id < itsNBuf);
-   itsStatus[id] = BUF_FREE;   
+   freeBuffer(id);
+}
+
+/// @brief mark the buffer as free and return it to the free list
+/// @details Buffers which are already free are left alone, so the
+/// same ID can never appear twice in the free list.
+/// @param[in] id buffer ID to free
+void BufferManager::freeBuffer(const int id) const
+{
+   ASKAPDEBUGASSERT((id >= 0) && (id < itsNBuf));
+   if (itsStatus[id].exchange(BUF_FREE) != BUF_FREE) {
+       // the list is preallocated for all buffers, so this can't fail unless an ID is pushed twice
+       ASKAPCHECK(itsFreeBuffers.bounded_push(id), "Unable to return buffer "<<id<<" to the list of free buffers");
+   }
 }
 
 
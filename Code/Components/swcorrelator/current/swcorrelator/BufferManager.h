@@ -42,6 +42,8 @@
 #include <boost/thread/thread.hpp>
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/lockfree/stack.hpp>
 
 // std includes
 #include <complex>
@@ -119,7 +121,9 @@ public:
    /// @brief obtain a buffer to receive data
    /// @details This method returns an ID of a free buffer used to
    /// receive the data. If no free buffer is available (i.e. an
-   /// overflow situation), a negative value is returned.
+   /// overflow situation), a negative value is returned. Free buffers
+   /// are kept in a lock-free stack, so this method doesn't need the
+   /// status mutex and can be called from many stream threads at once.
    /// @return an ID of the buffer
    int getBufferToFill() const;
    
@@ -206,6 +210,12 @@ protected:
    /// been acquired.
    /// @param[in] id buffer ID to release
    void releaseOneBuffer(const int id) const;
+
+   /// @brief mark the buffer as free and return it to the free list
+   /// @details Buffers which are already free are left alone, so the
+   /// same ID can never appear twice in the free list.
+   /// @param[in] id buffer ID to free
+   void freeBuffer(const int id) const;
    
    /// @brief find a complete set of data 
    /// @details We process all antennas simultaneously (for speed). This method
@@ -248,7 +258,14 @@ private:
    boost::scoped_array<float> itsBuffer;
    
    /// @brief flags with the buffer status for each buffer
-   mutable std::vector<BufferStatus> itsStatus;   
+   /// @details The status is atomic because buffers are acquired
+   /// without the mutex. All other transitions still happen under
+   /// itsStatusCVMutex.
+   boost::scoped_array<boost::atomic<BufferStatus> > itsStatus;
+
+   /// @brief IDs of all buffers in the BUF_FREE state
+   mutable boost::lockfree::stack<int> itsFreeBuffers;
+
    /// @brief buffer status condition variable
    mutable boost::condition_variable itsStatusCV;
    /// @brief mutex associated with status condition variable
@@ -39,6 +39,12 @@
 #include <askap/AskapLogging.h>
 #include <boost/thread.hpp>
 
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 ASKAP_LOGGER(logger, ".corrworker");
 
 namespace askap {
@@ -66,7 +72,7 @@ void StreamConnection::operator()()
     ASKAPDEBUGASSERT(itsBufferManager); 
     bool haveData = true;
     const int msgSize =sizeof(BufferHeader)/sizeof(int16_t) + 2*BufferManager::NumberOfSamples();
-    boost::scoped_array<int16_t> tmpbuf(new int16_t[msgSize]);
+    ASKAPDEBUGASSERT(int(msgSize*sizeof(int16_t)) <= itsBufferManager->bufferSize());
     while (haveData && !boost::this_thread::interruption_requested()) {
        /* 
        boost::this_thread::sleep(boost::posix_time::seconds(1));       
@@ -80,9 +86,9 @@ void StreamConnection::operator()()
        //ASKAPLOG_DEBUG_STR(logger, "Got bufId="<<bufId<<" from the manager");
        size_t replyLength = 0;
        try {
-          replyLength = boost::asio::read(*itsSocket,boost::asio::buffer((void*)tmpbuf.get(), msgSize*sizeof(int16_t)));
-          //boost::asio::read(*itsSocket,boost::asio::buffer(itsBufferManager->buffer(bufId), 
-          //                itsBufferManager->bufferSize()));
+          // the message is half the size of the buffer, samples are expanded in place afterwards
+          replyLength = boost::asio::read(*itsSocket,boost::asio::buffer(itsBufferManager->buffer(bufId), 
+                          msgSize*sizeof(int16_t)));
        } catch (const std::exception &ex) {
           haveData = false;
           // release the buffer back without raising a valid flag
@@ -92,17 +98,7 @@ void StreamConnection::operator()()
           ASKAPLOG_DEBUG_STR(logger, "Data stream thread (id="<<boost::this_thread::get_id()<<") got reading error: "<<ex.what()<<" read "<<replyLength/sizeof(int16_t)<<" words out of "<<msgSize);
        }
        if (haveData) {
-           int16_t *outbuf = (int16_t*)(itsBufferManager->buffer(bufId));
-           int16_t *inbuf = (int16_t*)tmpbuf.get();
-           for (size_t i=0; i<sizeof(BufferHeader); i+=sizeof(int16_t)) {
-                *(outbuf++) = *(inbuf++);
-           }
-           std::complex<float>* outbuf2 = (std::complex<float>*)(outbuf);
-           for (int i=0; i<BufferManager::NumberOfSamples(); ++i) {
-                const int16_t im = *(inbuf++);
-                const int16_t rl = *(inbuf++);
-                *(outbuf2++) = std::complex<float>(float(rl),float(im));
-           }
+           unpackSamples(itsBufferManager->data(bufId), BufferManager::NumberOfSamples());
            // this releases the buffer, but marks it as valid for further processing
            itsBufferManager->bufferFilled(bufId);                 
        }
@@ -116,6 +112,51 @@ void StreamConnection::operator()()
   }  
 }
 
+/// @brief expand received 16-bit samples to complex floats in place
+/// @details On input, the memory starting at data holds nSamples pairs of
+/// 16-bit integers (imaginary part first), as they come from the stream.
+/// On output, it holds nSamples complex floats. The conversion goes from the
+/// last sample to the first, so no input is overwritten before it is read.
+/// SSE2 is used when available.
+/// @param[in] data pointer to the start of the data (should have space for
+/// nSamples complex floats)
+/// @param[in] nSamples number of samples
+void StreamConnection::unpackSamples(std::complex<float> *data, const size_t nSamples)
+{
+  // input and output overlap, so they are only accessed via memcpy and intrinsics
+  // (which are allowed to alias) rather than through two pointers of different types
+  char *buf = (char*)data;
+  size_t sample = nSamples;
+#ifdef __SSE2__
+  // 4 samples at a time, the remainder is done by the scalar loop first
+  const size_t nVectorised = nSamples - nSamples % 4;
+#else
+  const size_t nVectorised = 0;
+#endif
+  // sample i is read from bytes [4i, 4i+4) and written to [8i, 8i+8), so going 
+  // backwards never overwrites samples yet to be read
+  for (; sample > nVectorised; --sample) {
+       int16_t in[2]; // imaginary, real
+       memcpy(in, buf + 4 * (sample - 1), sizeof(in));
+       const float out[2] = {float(in[1]), float(in[0])};
+       memcpy(buf + 8 * (sample - 1), out, sizeof(out));
+  }
+#ifdef __SSE2__
+  for (; sample > 0; sample -= 4) {
+       // im0 rl0 im1 rl1 im2 rl2 im3 rl3
+       __m128i raw = _mm_loadu_si128((const __m128i*)(buf + 4 * (sample - 4)));
+       // rl0 im0 rl1 im1 rl2 im2 rl3 im3
+       raw = _mm_shufflelo_epi16(raw, _MM_SHUFFLE(2, 3, 0, 1));
+       raw = _mm_shufflehi_epi16(raw, _MM_SHUFFLE(2, 3, 0, 1));
+       // sign extension to 32 bits
+       const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);
+       const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);
+       _mm_storeu_ps((float*)(buf + 8 * (sample - 4)), _mm_cvtepi32_ps(lo));
+       _mm_storeu_ps((float*)(buf + 8 * (sample - 2)), _mm_cvtepi32_ps(hi));
+  }
+#endif
+}
+
 } // namespace swcorrelator
 
 } // namespace askap
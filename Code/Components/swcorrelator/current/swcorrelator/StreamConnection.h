@@ -38,6 +38,8 @@
 #include <boost/asio.hpp>
 #include <swcorrelator/BufferManager.h>
 
+#include <complex>
+
 namespace askap {
 
 namespace swcorrelator {
@@ -48,6 +50,8 @@ namespace swcorrelator {
 /// manager. Each instance (executed as a separate thread), obtains a buffer from 
 /// the manager, fills it with new data and de-allocates it. The correlator thread
 /// is responsible for further processing when sufficient data are accumulated.
+/// Each message is received straight into the buffer obtained from the manager
+/// and the 16-bit samples are then expanded to complex floats in place.
 /// @ingroup swcorrelator
 struct StreamConnection {
 
@@ -61,6 +65,17 @@ struct StreamConnection {
   /// @brief parallel thread
   /// @details This is the main entry point to the code executed in a parallel thread
   void operator()();
+
+  /// @brief expand received 16-bit samples to complex floats in place
+  /// @details On input, the memory starting at data holds nSamples pairs of
+  /// 16-bit integers (imaginary part first), as they come from the stream.
+  /// On output, it holds nSamples complex floats. The conversion goes from the
+  /// last sample to the first, so no input is overwritten before it is read.
+  /// SSE2 is used when available.
+  /// @param[in] data pointer to the start of the data (should have space for
+  /// nSamples complex floats)
+  /// @param[in] nSamples number of samples
+  static void unpackSamples(std::complex<float> *data, const size_t nSamples);
     
 private:
   /// @details shared pointer to the socket corresponding connection managed by this instance
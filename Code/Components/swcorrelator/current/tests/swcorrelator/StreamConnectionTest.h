@@ -0,0 +1,79 @@
+/// @file
+///
+/// @brief Test of the sample conversion in StreamConnection
+///
+/// @copyright (c) 2014 CSIRO
+/// Australia Telescope National Facility (ATNF)
+/// Commonwealth Scientific and Industrial Research Organisation (CSIRO)
+/// PO Box 76, Epping NSW 1710, Australia
+/// atnf-enquiries@csiro.au
+///
+/// This file is part of the ASKAP software distribution.
+///
+/// The ASKAP software distribution is free software: you can redistribute it
+/// and/or modify it under the terms of the GNU General Public License as
+/// published by the Free Software Foundation; either version 2 of the License,
+/// or (at your option) any later version.
+///
+/// This program is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with this program; if not, write to the Free Software
+/// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+///
+
+#ifndef ASKAP_SWCORRELATOR_STREAM_CONNECTION_TEST_H
+#define ASKAP_SWCORRELATOR_STREAM_CONNECTION_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <askap/AskapError.h>
+
+// Class under test
+#include <swcorrelator/StreamConnection.h>
+
+#include <vector>
+#include <complex>
+#include <cstring>
+
+namespace askap {
+
+namespace swcorrelator {
+
+class StreamConnectionTest : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(StreamConnectionTest);
+  CPPUNIT_TEST(testUnpackSamples);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  
+  void testUnpackSamples() {
+     // cover both the vectorised part and the remainder
+     const size_t sizes[] = {0, 1, 3, 4, 5, 17, 1024, 1027};
+     for (size_t test = 0; test < sizeof(sizes) / sizeof(size_t); ++test) {
+          const size_t nSamples = sizes[test];
+          std::vector<int16_t> raw(2 * nSamples);
+          for (size_t i = 0; i < raw.size(); ++i) {
+               // both signs and the extremes of the range
+               raw[i] = int16_t(int((i * 7919) % 65536) - 32768);
+          }
+          std::vector<std::complex<float> > buf(nSamples + 1);
+          if (nSamples > 0) {
+              memcpy(&buf[0], &raw[0], raw.size() * sizeof(int16_t));
+          }
+          StreamConnection::unpackSamples(&buf[0], nSamples);
+          for (size_t i = 0; i < nSamples; ++i) {
+               // imaginary part comes first in the stream
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(double(raw[2 * i + 1]), double(real(buf[i])), 1e-6);
+               CPPUNIT_ASSERT_DOUBLES_EQUAL(double(raw[2 * i]), double(imag(buf[i])), 1e-6);
+          }
+     }
+  }
+};
+
+} // namespace swcorrelator
+
+} // namespace askap
+
+#endif // #ifndef ASKAP_SWCORRELATOR_STREAM_CONNECTION_TEST_H